@@ -9,6 +9,7 @@ use AnyEvent::Socket;
 use AnyEvent;
 use Encode;
 use Scalar::Util qw(tainted);
+use List::Util qw(min);
 use Carp;
 
 =head1 NAME
@@ -101,17 +102,26 @@ use constant TYPE_GET_BINDING_MODES => 8;
 use constant TYPE_GET_CONFIG => 9;
 use constant TYPE_SEND_TICK => 10;
 use constant TYPE_SYNC => 11;
+use constant TYPE_GET_STATS => 12;
+use constant TYPE_SET_ENCODING => 13;
+use constant TYPE_RUN_COMMANDS => 14;
+use constant TYPE_GET_CLIENTS => 15;
 
 our %EXPORT_TAGS = ( 'all' => [
     qw(i3 TYPE_RUN_COMMAND TYPE_COMMAND TYPE_GET_WORKSPACES TYPE_SUBSCRIBE TYPE_GET_OUTPUTS
        TYPE_GET_TREE TYPE_GET_MARKS TYPE_GET_BAR_CONFIG TYPE_GET_VERSION
-       TYPE_GET_BINDING_MODES TYPE_GET_CONFIG TYPE_SEND_TICK TYPE_SYNC)
+       TYPE_GET_BINDING_MODES TYPE_GET_CONFIG TYPE_SEND_TICK TYPE_SYNC
+       TYPE_GET_STATS TYPE_SET_ENCODING TYPE_RUN_COMMANDS TYPE_GET_CLIENTS)
 ] );
 
 our @EXPORT_OK = ( @{ $EXPORT_TAGS{all} } );
 
 my $magic = "i3-ipc";
 
+# Replies which are larger than this are decoded while they are being received
+# (see _read_incremental).
+my $incremental_threshold = 64 * 1024;
+
 # TODO: auto-generate this from the header file? (i3/ipc.h)
 my $event_mask = (1 << 31);
 my %events = (
@@ -123,6 +133,7 @@ my %events = (
     binding => ($event_mask | 5),
     shutdown => ($event_mask | 6),
     tick => ($event_mask | 7),
+    tree => ($event_mask | 8),
     _error => 0xFFFFFFFF,
 );
 
@@ -228,11 +239,10 @@ sub connect {
 
                 my $cb = $self->{callbacks};
 
-                # Trigger all one-time callbacks with undef
-                for my $type (keys %{$cb}) {
-                    next if ($type & $event_mask) == $event_mask;
-                    $cb->{$type}->();
-                    delete $cb->{$type};
+                # Trigger the callbacks of all outstanding requests with undef
+                my $pending = delete $self->{pending} // {};
+                for my $type (keys %{$pending}) {
+                    $_->() for @{$pending->{$type}};
                 }
 
                 # Trigger _error callback, if set
@@ -257,6 +267,12 @@ sub _data_available {
             my $header = $_[1];
             # Unpack message length and read the payload
             my ($len, $type) = unpack("LL", substr($header, length($magic)));
+            if ($len > $incremental_threshold &&
+                $self->_encoding eq 'json' &&
+                $self->_has_callback($type)) {
+                $self->_read_incremental($hdl, $type, $len, JSON::XS->new->utf8);
+                return;
+            }
             $hdl->unshift_read(
                 chunk => $len,
                 sub { $self->_handle_i3_message($type, $_[1]) }
@@ -265,19 +281,78 @@ sub _data_available {
     );
 }
 
+# Reads a large JSON payload in pieces and feeds them to the incremental
+# parser of JSON::XS as they arrive, so that the whole payload does not need to
+# be buffered (and scanned) again once the last piece was received.
+sub _read_incremental {
+    my ($self, $hdl, $type, $remaining, $json) = @_;
+
+    $hdl->unshift_read(
+        chunk => min($remaining, $incremental_threshold),
+        sub {
+            my $chunk = $_[1];
+            $remaining -= length($chunk);
+            if ($remaining > 0) {
+                $json->incr_parse($chunk);
+                $self->_read_incremental($hdl, $type, $remaining, $json);
+                return;
+            }
+            $self->_dispatch($type, scalar $json->incr_parse($chunk));
+        }
+    );
+}
+
+# The encoding of the messages which are received next, see set_encoding.
+sub _encoding {
+    my ($self) = @_;
+
+    return $self->{encoding} // 'json';
+}
+
+sub _has_callback {
+    my ($self, $type) = @_;
+
+    return defined($self->{callbacks}->{$type}) if ($type & $event_mask) == $event_mask;
+    return @{$self->{pending}->{$type} // []} > 0;
+}
+
+sub _decode {
+    my ($self, $payload) = @_;
+
+    return $self->{cbor}->decode($payload) if $self->_encoding eq 'cbor';
+    return decode_json $payload;
+}
+
 sub _handle_i3_message {
     my ($self, $type, $payload) = @_;
 
-    return unless defined($self->{callbacks}->{$type});
+    return unless $self->_has_callback($type);
 
-    my $cb = $self->{callbacks}->{$type};
-    $cb->(decode_json $payload);
+    $self->_dispatch($type, $self->_decode($payload));
+}
 
-    return if ($type & $event_mask) == $event_mask;
+sub _dispatch {
+    my ($self, $type, $reply) = @_;
+
+    if (($type & $event_mask) == $event_mask) {
+        my $cb = $self->{callbacks}->{$type};
+        $cb->($reply) if defined($cb);
+        return;
+    }
 
-    # If this was a one-time callback, we delete it
-    # (when connection is lost, all one-time callbacks get triggered)
-    delete $self->{callbacks}->{$type};
+    # i3 replies in the order of the requests, so this reply belongs to the
+    # oldest outstanding request of this type.
+    my $cb = shift @{$self->{pending}->{$type} // []};
+    return unless defined($cb);
+
+    # All following messages use the new encoding (the SET_ENCODING reply
+    # itself is still sent in the previous one).
+    if ($type == TYPE_SET_ENCODING) {
+        my $encoding = shift @{$self->{requested_encodings}};
+        $self->{encoding} = $encoding if $reply->{success};
+    }
+
+    $cb->($reply);
 }
 
 =head2 $i3->subscribe(\%callbacks)
@@ -331,6 +406,13 @@ scalar), if specified.
         say "Configuration successfully reloaded";
     }
 
+Messages can be sent without waiting for the replies to the previous ones.
+i3 replies in order, so each returned condvar receives the reply to its own
+message:
+
+    my @cvs = map { $i3->command("workspace $_") } 1 .. 3;
+    $_->recv for @cvs;
+
 =cut
 sub message {
     my ($self, $type, $content) = @_;
@@ -353,14 +435,7 @@ sub message {
 
     my $cv = AnyEvent->condvar;
 
-    # We don’t preserve the old callback as it makes no sense to
-    # have a callback on message reply types (only on events)
-    $self->{callbacks}->{$type} =
-        sub {
-            my ($reply) = @_;
-            $cv->send($reply);
-            undef $self->{callbacks}->{$type};
-        };
+    push @{$self->{pending}->{$type}}, sub { $cv->send(@_) };
 
     $cv
 }
@@ -548,6 +623,119 @@ sub sync {
     $self->message(TYPE_SYNC, $payload);
 }
 
+=head2 get_stats
+
+Gets the timing counters of the render pipeline. Requires i3 >= 4.18
+
+=cut
+sub get_stats {
+    my ($self) = @_;
+
+    $self->_ensure_connection;
+
+    $self->message(TYPE_GET_STATS);
+}
+
+=head2 set_encoding($encoding)
+
+Switches the encoding of all following replies and events on this connection
+to C<json> (the default) or C<cbor>. CBOR is cheaper to decode for large
+replies like the tree, but requires L<CBOR::XS>. Requires i3 >= 4.18
+
+    i3->set_encoding('cbor')->recv->{success} or die "Could not switch to CBOR";
+
+=cut
+sub set_encoding {
+    my ($self, $encoding) = @_;
+
+    $self->_ensure_connection;
+
+    if ($encoding eq 'cbor' && !defined($self->{cbor})) {
+        eval { require CBOR::XS; 1 } or confess "CBOR::XS is required for the cbor encoding";
+        $self->{cbor} = CBOR::XS->new;
+    }
+
+    push @{$self->{requested_encodings}}, $encoding;
+    $self->message(TYPE_SET_ENCODING, $encoding);
+}
+
+=head2 apply_tree_diff($tree, $event)
+
+Applies a tree event (see C<tree> in L</subscribe>) to a copy of the tree
+which was requested with L</get_tree> after subscribing, so that the copy
+stays up to date without requesting the whole tree again. Returns C<$tree>,
+which is modified in place.
+
+    my $tree;
+    $i3->subscribe({
+        tree => sub { $i3->apply_tree_diff($tree, shift) if $tree },
+    })->recv;
+    $tree = $i3->get_tree->recv;
+
+=cut
+sub apply_tree_diff {
+    my ($self, $tree, $event) = @_;
+
+    # Index the copy by container ID.
+    my (%nodes, %parents);
+    my @todo = ($tree);
+    while (my $node = shift @todo) {
+        $nodes{$node->{id}} = $node;
+        for my $list (qw(nodes floating_nodes)) {
+            for my $child (@{$node->{$list} // []}) {
+                $parents{$child->{id}} = [ $node, $list ];
+                push @todo, $child;
+            }
+        }
+    }
+
+    my $detach = sub {
+        my ($id) = @_;
+        my $parent = delete $parents{$id} or return;
+        my ($node, $list) = @{$parent};
+        $node->{$list} = [ grep { $_->{id} != $id } @{$node->{$list}} ];
+    };
+
+    for my $id (@{$event->{removed}}) {
+        $detach->($id);
+        delete $nodes{$id};
+    }
+
+    for my $added (@{$event->{added}}) {
+        $nodes{$added->{node}->{id}} = {
+            nodes => [],
+            floating_nodes => [],
+            %{$added->{node}},
+        };
+    }
+
+    # Every container whose position changed is part of the event, so
+    # inserting them in the order of their new index puts them (and all
+    # others) at the right position.
+    my @inserts = (
+        (map { [ $_->{node}->{id}, $_ ] } @{$event->{added}}),
+        (map { [ $_->{id}, $_ ] } @{$event->{moved}}),
+    );
+    $detach->($_->[0]) for @inserts;
+    for my $insert (sort { $a->[1]->{index} <=> $b->[1]->{index} } @inserts) {
+        my ($id, $position) = @{$insert};
+        my $node = $nodes{$id};
+        my $parent = $nodes{$position->{parent} // ''};
+        next unless defined($node) && defined($parent);
+        my $list = $position->{list};
+        my $index = min($position->{index}, scalar @{$parent->{$list} //= []});
+        splice(@{$parent->{$list}}, $index, 0, $node);
+        $parents{$id} = [ $parent, $list ];
+    }
+
+    for my $changed (@{$event->{changed}}) {
+        my $node = $nodes{$changed->{id}} or next;
+        $node->{$_} = $changed->{$_} for keys %{$changed};
+    }
+
+    return $tree;
+}
+
 =head2 command($content)
 
 Makes i3 execute the given command
@@ -0,0 +1,55 @@
+#!perl -T
+# vim:ts=4:sw=4:expandtab
+
+use Test::More tests => 4;
+use AnyEvent::I3;
+
+my $i3 = AnyEvent::I3->new('/dev/null');
+
+sub ids {
+    my ($node, $list) = @_;
+    return [ map { $_->{id} } @{$node->{$list // 'nodes'}} ];
+}
+
+my $tree = {
+    id => 1,
+    nodes => [
+        { id => 2, name => 'a', nodes => [], floating_nodes => [] },
+        { id => 3, name => 'b', nodes => [], floating_nodes => [] },
+        { id => 4, name => 'c', nodes => [], floating_nodes => [] },
+    ],
+    floating_nodes => [],
+};
+
+# Close 'a', open 'd' at the end and swap 'b' and 'c'.
+$i3->apply_tree_diff($tree, {
+    change => 'diff',
+    added => [
+        { parent => 1, list => 'nodes', index => 2, node => { id => 5, name => 'd' } },
+    ],
+    removed => [ 2 ],
+    moved => [
+        { id => 4, parent => 1, list => 'nodes', index => 0 },
+        { id => 3, parent => 1, list => 'nodes', index => 1 },
+    ],
+    changed => [
+        { id => 3, name => 'b2' },
+    ],
+});
+
+is_deeply(ids($tree), [ 4, 3, 5 ], 'removed, moved and added containers in place');
+is($tree->{nodes}->[1]->{name}, 'b2', 'changed fields applied');
+
+# Move 'd' into a floating container below 'c'.
+$i3->apply_tree_diff($tree, {
+    change => 'diff',
+    added => [],
+    removed => [],
+    moved => [
+        { id => 5, parent => 4, list => 'floating_nodes', index => 0 },
+    ],
+    changed => [],
+});
+
+is_deeply(ids($tree), [ 4, 3 ], 'moved container removed from its old parent');
+is_deeply(ids($tree->{nodes}->[0], 'floating_nodes'), [ 5 ], 'moved container attached to its new parent');
@@ -134,6 +134,8 @@ my $resultname = uc(substr($prefix, 0, 1)) . substr($prefix, 1) . 'ResultIR';
 say $callfh "static void GENERATED_call(const int call_identifier, struct $resultname *result) {";
 say $callfh '    switch (call_identifier) {';
 my $call_id = 0;
+my @call_next_states;
+my @call_functions;
 for my $state (@keys) {
     my $tokens = $states{$state};
     for my $token (@$tokens) {
@@ -168,6 +170,8 @@ for my $state (@keys) {
 
         $fmt = $funcname . $fmt;
 
+        push @call_next_states, $next_state;
+        push @call_functions, $funcname;
         say $callfh "         case $call_id:";
         say $callfh "             result->next_state = $next_state;";
         say $callfh '#ifndef TEST_PARSER';
@@ -201,6 +205,34 @@ say $callfh '            printf("BUG in the parser. state = %d\n", call_identifi
 say $callfh '            assert(false);';
 say $callfh '    }';
 say $callfh '}';
+
+# The state which GENERATED_call() transitions to, without calling anything.
+# Used to parse commands ahead of time (see command_ir_compile()).
+say $callfh '';
+say $callfh 'static inline int GENERATED_call_next_state(const int call_identifier) {';
+say $callfh '    switch (call_identifier) {';
+for my $id (0 .. $#call_next_states) {
+    say $callfh "        case $id:";
+    say $callfh "            return $call_next_states[$id];";
+}
+say $callfh '        default:';
+say $callfh '            return INITIAL;';
+say $callfh '    }';
+say $callfh '}';
+
+# The name of the function which GENERATED_call() calls. Used to find out
+# whether a precompiled command can be coalesced (see command_ir_compile()).
+say $callfh '';
+say $callfh 'static inline const char *GENERATED_call_function(const int call_identifier) {';
+say $callfh '    switch (call_identifier) {';
+for my $id (0 .. $#call_functions) {
+    say $callfh "        case $id:";
+    say $callfh qq|            return "$call_functions[$id]";|;
+}
+say $callfh '        default:';
+say $callfh '            return NULL;';
+say $callfh '    }';
+say $callfh '}';
 close($callfh);
 
 # Fourth step: Generate the token datastructures.
@@ -237,3 +269,67 @@ for my $state (@keys) {
 say $tokfh '};';
 
 close($tokfh);
+
+# Fifth step: Generate the dispatch tables, which let the parser find the
+# literal token matching the input with a binary search instead of comparing
+# against every literal of the current state.
+#
+# The literals of each state are sorted case-insensitively. Since literals
+# match when the input starts with them, several can match at once: they are
+# then all prefixes of each other. Each entry therefore links to the longest
+# other entry which is a prefix of it (parent), and stores the lowest token
+# index along that chain (first), since the literal which comes first in the
+# specification wins.
+
+open(my $dispatchfh, '>', "GENERATED_${prefix}_dispatch.h");
+
+for my $state (@keys) {
+    my $tokens = $states{$state};
+    my @literals;
+    my @others;
+    for my $idx (0 .. $#$tokens) {
+        my $name = $tokens->[$idx]->{token};
+        if ($name =~ /^'(.*)'$/) {
+            push @literals, { name => $1, folded => lc($1), index => $idx };
+        } else {
+            push @others, $idx;
+        }
+    }
+    @literals = sort { ($a->{folded} cmp $b->{folded}) or ($a->{index} <=> $b->{index}) } @literals;
+    for my $i (0 .. $#literals) {
+        my $entry = $literals[$i];
+        $entry->{parent} = -1;
+        $entry->{first} = $entry->{index};
+        for (my $j = $i - 1; $j >= 0; $j--) {
+            my $folded = $literals[$j]->{folded};
+            next unless substr($entry->{folded}, 0, length($folded)) eq $folded;
+            $entry->{parent} = $j;
+            $entry->{first} = $literals[$j]->{first} if $literals[$j]->{first} < $entry->{first};
+            last;
+        }
+    }
+
+    if (@literals > 0) {
+        say $dispatchfh 'static const cmdp_literal literals_' . $state . '[' . scalar @literals . '] = {';
+        for my $entry (@literals) {
+            say $dispatchfh qq|    { "$entry->{name}", | . length($entry->{name}) . ", $entry->{index}, $entry->{parent}, $entry->{first} },";
+        }
+        say $dispatchfh '};';
+    }
+    if (@others > 0) {
+        say $dispatchfh 'static const int others_' . $state . '[' . scalar @others . '] = { ' . join(', ', @others) . ' };';
+    }
+}
+
+say $dispatchfh 'static const cmdp_dispatch dispatch[' . scalar @keys . '] = {';
+for my $state (@keys) {
+    my $tokens = $states{$state};
+    my $num_literals = grep { $_->{token} =~ /^'/ } @$tokens;
+    my $num_others = scalar @$tokens - $num_literals;
+    my $literals = ($num_literals > 0 ? "literals_$state" : 'NULL');
+    my $others = ($num_others > 0 ? "others_$state" : 'NULL');
+    say $dispatchfh "    { $literals, $num_literals, $others, $num_others },";
+}
+say $dispatchfh '};';
+
+close($dispatchfh);
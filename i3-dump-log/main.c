@@ -26,6 +26,8 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <signal.h>
+#include <time.h>
+#include <inttypes.h>
 
 #include "libi3.h"
 #include "shmlog.h"
@@ -39,6 +41,8 @@ static uint32_t wrap_count;
 static i3_shmlog_header *header;
 static char *logbuffer,
     *walk;
+/* The time (in milliseconds since the epoch) of the record before walk. */
+static uint64_t walk_time;
 static int ipcfd = -1;
 
 static volatile bool interrupted = false;
@@ -47,6 +51,30 @@ static void sighandler(int signal) {
     interrupted = true;
 }
 
+/*
+ * Prints the memory usage snapshot which i3 publishes in the header.
+ *
+ */
+static void print_memory(void) {
+    const i3_shmlog_memory *memory = &(header->memory);
+    if (memory->sampled_at == 0) {
+        printf("No memory usage was published yet.\n");
+        return;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    const uint64_t now_ms = (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+    printf("sampled:          %.1f s ago\n",
+           (now_ms > memory->sampled_at ? (now_ms - memory->sampled_at) / 1000.0 : 0.0));
+    printf("allocations:      %" PRIu64 " calls, %" PRIu64 " bytes\n",
+           memory->allocation_calls, memory->allocation_bytes);
+    printf("heap in use:      %" PRIu64 " bytes\n", memory->heap_in_use);
+    printf("heap peak in use: %" PRIu64 " bytes\n", memory->heap_peak_in_use);
+    printf("heap free:        %" PRIu64 " bytes\n", memory->heap_free);
+    printf("heap mmapped:     %" PRIu64 " bytes\n", memory->heap_mmapped);
+}
+
 static void disable_shmlog(void) {
     const char *disablecmd = "debuglog off; shmlog off";
     if (ipc_send_message(ipcfd, strlen(disablecmd),
@@ -63,6 +91,190 @@ static void disable_shmlog(void) {
     free(reply);
 }
 
+/*
+ * Prints a single conversion of a format string, with the arguments unpacked
+ * from the record (see i3_shmlog_record). Returns false if the record is
+ * malformed.
+ *
+ */
+static bool print_conversion(const char *spec, const printf_conversion_t *conv,
+                             const uint8_t **data, const uint8_t *end) {
+    uint64_t value;
+    size_t n;
+    int args[2];
+    int num_args = 0;
+
+#define GET_VARINT()                                                 \
+    do {                                                             \
+        if ((n = shmlog_get_varint(*data, end - *data, &value)) == 0) \
+            return false;                                            \
+        *data += n;                                                  \
+    } while (0)
+
+    if (conv->width_arg) {
+        GET_VARINT();
+        args[num_args++] = shmlog_unzigzag(value);
+    }
+    if (conv->precision_arg) {
+        GET_VARINT();
+        args[num_args++] = shmlog_unzigzag(value);
+    }
+
+    /* The arguments are stored in a fixed size, so replace the length
+     * modifier of the specification accordingly. */
+    char format[conv->length + 2];
+    memcpy(format, spec, conv->modifier_offset);
+    char *walk_format = format + conv->modifier_offset;
+
+#define PRINT(...)                                                     \
+    do {                                                               \
+        if (num_args == 0)                                             \
+            printf(format, __VA_ARGS__);                               \
+        else if (num_args == 1)                                        \
+            printf(format, args[0], __VA_ARGS__);                      \
+        else                                                           \
+            printf(format, args[0], args[1], __VA_ARGS__);             \
+    } while (0)
+
+    switch (conv->specifier) {
+        case 'd':
+        case 'i':
+            GET_VARINT();
+            *(walk_format++) = 'j';
+            *(walk_format++) = conv->specifier;
+            *walk_format = '\0';
+            PRINT((intmax_t)shmlog_unzigzag(value));
+            break;
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+            GET_VARINT();
+            *(walk_format++) = 'j';
+            *(walk_format++) = conv->specifier;
+            *walk_format = '\0';
+            PRINT((uintmax_t)value);
+            break;
+        case 'c':
+            GET_VARINT();
+            *(walk_format++) = 'c';
+            *walk_format = '\0';
+            PRINT((int)shmlog_unzigzag(value));
+            break;
+        case 'p':
+            GET_VARINT();
+            *(walk_format++) = 'p';
+            *walk_format = '\0';
+            PRINT((void *)(uintptr_t)value);
+            break;
+        case 's': {
+            GET_VARINT();
+            if (value > (uint64_t)(end - *data))
+                return false;
+            char *str = sstrndup((const char *)*data, value);
+            *data += value;
+            *(walk_format++) = 's';
+            *walk_format = '\0';
+            PRINT(str);
+            free(str);
+            break;
+        }
+        default: {
+            double d;
+            if ((size_t)(end - *data) < sizeof(double))
+                return false;
+            memcpy(&d, *data, sizeof(double));
+            *data += sizeof(double);
+            *(walk_format++) = conv->specifier;
+            *walk_format = '\0';
+            PRINT(d);
+            break;
+        }
+    }
+#undef PRINT
+#undef GET_VARINT
+
+    return true;
+}
+
+/*
+ * Prints the record at walk, prefixed with its time like i3 does when logging
+ * to stdout. Returns the size of the record or 0 if it is malformed (or walk
+ * points to the unused part of the ringbuffer).
+ *
+ */
+static size_t print_record(const char *end) {
+    i3_shmlog_record record;
+    if ((size_t)(end - walk) < sizeof(record))
+        return 0;
+    memcpy(&record, walk, sizeof(record));
+    if (record.size <= sizeof(record) || record.size > (size_t)(end - walk))
+        return 0;
+
+    const uint8_t *data = (const uint8_t *)walk + sizeof(record);
+    const uint8_t *data_end = (const uint8_t *)walk + record.size;
+    uint64_t value;
+    size_t n;
+    if ((n = shmlog_get_varint(data, data_end - data, &value)) == 0)
+        return 0;
+    data += n;
+    walk_time += shmlog_unzigzag(value);
+
+    /* Same as log_time_prefix() in i3 */
+    const time_t t = walk_time / 1000;
+    struct tm result;
+    char prefix[128];
+    if (strftime(prefix, sizeof(prefix), "%x %X - ", localtime_r(&t, &result)) > 0)
+        fputs(prefix, stdout);
+
+    if (record.type == SHMLOG_RECORD_TEXT) {
+        fwrite(data, data_end - data, 1, stdout);
+        return record.size;
+    }
+
+    if ((n = shmlog_get_varint(data, data_end - data, &value)) == 0 ||
+        value >= header->formats_size)
+        return 0;
+    data += n;
+
+    const char *fmt = logbuffer + header->offset_formats + value;
+    while (*fmt != '\0') {
+        const char *percent = strchr(fmt, '%');
+        if (percent == NULL) {
+            fputs(fmt, stdout);
+            break;
+        }
+        fwrite(fmt, percent - fmt, 1, stdout);
+
+        printf_conversion_t conv;
+        if (!parse_printf_conversion(percent, &conv))
+            return 0;
+        if (conv.specifier == '%') {
+            putchar('%');
+        } else if (!print_conversion(percent, &conv, &data, data_end)) {
+            fprintf(stderr, "\ni3-dump-log: malformed log record\n");
+            return record.size;
+        }
+        fmt = percent + conv.length;
+    }
+
+    return record.size;
+}
+
+/*
+ * Prints all records from walk up to end.
+ *
+ */
+static void print_records(const char *end) {
+    while (walk < end) {
+        const size_t size = print_record(end);
+        if (size == 0)
+            break;
+        walk += size;
+    }
+    walk = (char *)end;
+}
+
 static int check_for_wrap(void) {
     if (wrap_count == header->wrap_count)
         return 0;
@@ -70,17 +282,15 @@ static int check_for_wrap(void) {
     /* The log wrapped. Print the remaining content and reset walk to the top
      * of the log. */
     wrap_count = header->wrap_count;
-    const int len = (logbuffer + header->offset_last_wrap) - walk;
-    swrite(STDOUT_FILENO, walk, len);
-    walk = logbuffer + sizeof(i3_shmlog_header);
+    print_records(logbuffer + header->offset_last_wrap);
+    walk = logbuffer + header->offset_formats + header->formats_size;
     return 1;
 }
 
 static void print_till_end(void) {
     check_for_wrap();
-    const int len = (logbuffer + header->offset_next_write) - walk;
-    swrite(STDOUT_FILENO, walk, len);
-    walk += len;
+    print_records(logbuffer + header->offset_next_write);
+    fflush(stdout);
 }
 
 void errorlog(char *fmt, ...) {
@@ -94,6 +304,7 @@ void errorlog(char *fmt, ...) {
 int main(int argc, char *argv[]) {
     int o, option_index = 0;
     bool verbose = false;
+    bool memory = false;
 #if !defined(__OpenBSD__)
     bool follow = false;
 #endif
@@ -101,6 +312,7 @@ int main(int argc, char *argv[]) {
     static struct option long_options[] = {
         {"version", no_argument, 0, 'v'},
         {"verbose", no_argument, 0, 'V'},
+        {"memory", no_argument, 0, 'm'},
 #if !defined(__OpenBSD__)
         {"follow", no_argument, 0, 'f'},
 #endif
@@ -109,9 +321,9 @@ int main(int argc, char *argv[]) {
     };
 
 #if !defined(__OpenBSD__)
-    char *options_string = "s:vfVh";
+    char *options_string = "s:vfmVh";
 #else
-    char *options_string = "vVh";
+    char *options_string = "vmVh";
 #endif
 
     while ((o = getopt_long(argc, argv, options_string, long_options, &option_index)) != -1) {
@@ -120,6 +332,8 @@ int main(int argc, char *argv[]) {
             return 0;
         } else if (o == 'V') {
             verbose = true;
+        } else if (o == 'm') {
+            memory = true;
 #if !defined(__OpenBSD__)
         } else if (o == 'f') {
             follow = true;
@@ -127,9 +341,9 @@ int main(int argc, char *argv[]) {
         } else if (o == 'h') {
             printf("i3-dump-log " I3_VERSION "\n");
 #if !defined(__OpenBSD__)
-            printf("i3-dump-log [-fhVv]\n");
+            printf("i3-dump-log [-fhmVv]\n");
 #else
-            printf("i3-dump-log [-hVv]\n");
+            printf("i3-dump-log [-hmVv]\n");
 #endif
             return 0;
         }
@@ -210,27 +424,29 @@ int main(int argc, char *argv[]) {
         printf("next_write = %d, last_wrap = %d, logbuffer_size = %d, shmname = %s\n",
                header->offset_next_write, header->offset_last_wrap, header->size, shmname);
     free(shmname);
-    walk = logbuffer + header->offset_next_write;
-
-    /* We first need to print old content in case there was at least one
-     * wrapping already. */
-
-    if (*walk != '\0') {
-        /* In case there was a write to the buffer already, skip the first
-         * old line, it very likely is mangled. Not a problem, though, the log
-         * is chatty enough to have plenty lines left. */
-        while (*walk != '\n')
-            walk++;
-        walk++;
+
+    if (memory) {
+        print_memory();
+        return 0;
     }
 
-    /* In case there was no wrapping, this is a no-op, otherwise it prints the
-     * old lines. */
+#if !defined(__OpenBSD__)
+    /* i3 only wakes up followers when there are any. Register before printing
+     * the existing content, so that we cannot miss a wakeup in between. */
+    if (follow)
+        __atomic_fetch_add(&(header->followers), 1, __ATOMIC_RELEASE);
+#endif
+
+    /* In case there was a wrap already, we first need to print the records of
+     * the previous pass which were not overwritten yet. Otherwise, this
+     * points to the end of the log and the first record is relative to 0. */
+    walk = logbuffer + header->offset_first_record;
+    walk_time = header->first_record_base;
     wrap_count = 0;
     check_for_wrap();
 
-    /* Then start from the beginning and print the newer lines */
-    walk = logbuffer + sizeof(i3_shmlog_header);
+    /* Then start from the beginning and print the newer records */
+    walk = logbuffer + header->offset_formats + header->formats_size;
     print_till_end();
 
 #if !defined(__OpenBSD__)
@@ -258,6 +474,7 @@ int main(int argc, char *argv[]) {
             print_till_end();
         }
     }
+    __atomic_fetch_sub(&(header->followers), 1, __ATOMIC_RELEASE);
 
 #endif
     exit(0);
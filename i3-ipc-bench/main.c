@@ -0,0 +1,630 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * i3-ipc-bench/main.c: Generates IPC load on a running i3 instance: a number
+ * of clients send RUN_COMMAND, GET_TREE and GET_WORKSPACES requests at fixed
+ * rates while a number of subscribers receive events. Reports the throughput
+ * and latency percentiles as seen by the clients and i3’s own counters.
+ *
+ */
+#include "libi3.h"
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <err.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <time.h>
+
+#include <yajl/yajl_parse.h>
+
+#include <i3/ipc.h>
+
+/*
+ * Having verboselog() and errorlog() is necessary when using libi3.
+ *
+ */
+void verboselog(char *fmt, ...) {
+    va_list args;
+
+    va_start(args, fmt);
+    vfprintf(stdout, fmt, args);
+    va_end(args);
+}
+
+void errorlog(char *fmt, ...) {
+    va_list args;
+
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+}
+
+typedef enum {
+    REQUEST_COMMAND = 0,
+    REQUEST_TREE = 1,
+    REQUEST_WORKSPACES = 2,
+    NUM_REQUESTS = 3,
+} request_type_t;
+
+static const char *request_names[NUM_REQUESTS] = {
+    [REQUEST_COMMAND] = "run_command",
+    [REQUEST_TREE] = "get_tree",
+    [REQUEST_WORKSPACES] = "get_workspaces",
+};
+
+static const uint32_t request_message_types[NUM_REQUESTS] = {
+    [REQUEST_COMMAND] = I3_IPC_MESSAGE_TYPE_RUN_COMMAND,
+    [REQUEST_TREE] = I3_IPC_MESSAGE_TYPE_GET_TREE,
+    [REQUEST_WORKSPACES] = I3_IPC_MESSAGE_TYPE_GET_WORKSPACES,
+};
+
+/* Requests per second and client, 0 disables the request type. */
+static double request_rates[NUM_REQUESTS] = {
+    [REQUEST_COMMAND] = 10,
+    [REQUEST_TREE] = 1,
+    [REQUEST_WORKSPACES] = 10,
+};
+
+/* The round trip times of all answered requests, in nanoseconds. */
+static struct latencies {
+    uint64_t *values;
+    size_t num;
+    size_t size;
+} latencies[NUM_REQUESTS];
+
+typedef struct bench_client {
+    int fd;
+    ipc_reader_t *reader;
+
+    /* The request which was sent and is not answered yet, if any. Every
+     * client has at most one request in flight, like a typical IPC client. */
+    bool in_flight;
+    request_type_t in_flight_type;
+    uint64_t sent_at;
+
+    /* When the next request of each type is due. */
+    uint64_t next_due[NUM_REQUESTS];
+} bench_client;
+
+typedef struct bench_subscriber {
+    int fd;
+    ipc_reader_t *reader;
+} bench_subscriber;
+
+static uint64_t events_received = 0;
+static uint64_t event_bytes_received = 0;
+static uint64_t replies_failed = 0;
+
+/*
+ * Sets O_NONBLOCK on the given connection, so that its input can be read as it
+ * arrives without waiting for complete messages.
+ *
+ */
+static void set_nonblock(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1)
+        err(EXIT_FAILURE, "fcntl(O_NONBLOCK)");
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void latency_add(request_type_t type, uint64_t value) {
+    struct latencies *l = &latencies[type];
+    if (l->num == l->size) {
+        l->size = (l->size == 0 ? 1024 : l->size * 2);
+        l->values = srealloc(l->values, l->size * sizeof(uint64_t));
+    }
+    l->values[l->num++] = value;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    const uint64_t x = *(const uint64_t *)a;
+    const uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Returns the given percentile (0-100) of the sorted values in milliseconds.
+ *
+ */
+static double percentile_ms(const struct latencies *l, int p) {
+    if (l->num == 0)
+        return 0;
+    return l->values[(l->num - 1) * p / 100] / 1e6;
+}
+
+/*
+ * Reads what is available on the given connection and returns the next
+ * complete message, if any. Exits when the connection is closed by i3.
+ *
+ */
+static int read_message(int fd, ipc_reader_t *reader, uint32_t *type, uint32_t *size, uint8_t **payload) {
+    const int ret = ipc_reader_next_message(reader, type, size, payload);
+    if (ret != 0)
+        return ret;
+
+    const ssize_t n = ipc_reader_read(reader, fd);
+    if (n == -1) {
+        if (errno == EINTR || errno == EAGAIN)
+            return 0;
+        err(EXIT_FAILURE, "IPC: read()");
+    }
+    if (n == -2)
+        errx(EXIT_FAILURE, "IPC: i3 closed the connection");
+    if (n == -3)
+        exit(EXIT_FAILURE);
+    return ipc_reader_next_message(reader, type, size, payload);
+}
+
+/*
+ * Sends the request which is due first if its time has come. The next request
+ * of the same type is due one interval later, unless the client fell behind by
+ * more than one interval, in which case the missed requests are skipped instead
+ * of being sent in a burst.
+ *
+ */
+static void client_send_due(bench_client *client, uint64_t now, const char *command) {
+    if (client->in_flight)
+        return;
+
+    int due = -1;
+    for (int type = 0; type < NUM_REQUESTS; type++) {
+        if (request_rates[type] <= 0)
+            continue;
+        if (due == -1 || client->next_due[type] < client->next_due[due])
+            due = type;
+    }
+    if (due == -1 || client->next_due[due] > now)
+        return;
+
+    const char *payload = (due == REQUEST_COMMAND ? command : "");
+    if (ipc_send_message(client->fd, strlen(payload), request_message_types[due], (const uint8_t *)payload) == -1)
+        err(EXIT_FAILURE, "IPC: write()");
+
+    const uint64_t interval = 1e9 / request_rates[due];
+    client->next_due[due] += interval;
+    if (client->next_due[due] + interval < now)
+        client->next_due[due] = now;
+
+    client->in_flight = true;
+    client->in_flight_type = due;
+    client->sent_at = now;
+}
+
+static void client_handle_input(bench_client *client) {
+    uint32_t type;
+    uint32_t size;
+    uint8_t *payload;
+    while (read_message(client->fd, client->reader, &type, &size, &payload) == 1) {
+        if (client->in_flight && type == request_message_types[client->in_flight_type]) {
+            latency_add(client->in_flight_type, now_ns() - client->sent_at);
+            client->in_flight = false;
+            if (client->in_flight_type == REQUEST_COMMAND && strstr((const char *)payload, "\"success\":false") != NULL)
+                replies_failed++;
+        }
+        free(payload);
+    }
+}
+
+static void subscriber_handle_input(bench_subscriber *subscriber) {
+    uint32_t type;
+    uint32_t size;
+    uint8_t *payload;
+    while (read_message(subscriber->fd, subscriber->reader, &type, &size, &payload) == 1) {
+        if (type & I3_IPC_EVENT_MASK) {
+            events_received++;
+            event_bytes_received += size;
+        }
+        free(payload);
+    }
+}
+
+/*******************************************************************************
+ * Server-side statistics (GET_STATS and GET_CLIENTS)
+ *******************************************************************************/
+
+typedef struct server_stats {
+    long long x_push_changes;
+    long long slow_frames;
+
+    /* Summed up over the connections of this process (except for the one
+     * which sent GET_CLIENTS). */
+    long long handler_ns;
+    long long bytes_sent;
+    long long events_coalesced;
+    long long events_dropped;
+    long long queued_bytes_max;
+} server_stats;
+
+/* The state of the reply parsers: the current nesting depth, the key on the
+ * top level and the last key. */
+static int parse_depth;
+static char *top_key;
+static char *last_key;
+
+/* The values of the GET_CLIENTS entry which is currently parsed. */
+static server_stats client_entry;
+static bool client_entry_self;
+static long long client_entry_pid;
+
+static int stats_map_key_cb(void *params, const unsigned char *val, size_t len) {
+    free(last_key);
+    last_key = sstrndup((const char *)val, len);
+    if (parse_depth == 1) {
+        free(top_key);
+        top_key = sstrdup(last_key);
+    }
+    return 1;
+}
+
+static int stats_start_cb(void *params) {
+    parse_depth++;
+    return 1;
+}
+
+static int stats_end_cb(void *params) {
+    parse_depth--;
+    return 1;
+}
+
+static int stats_integer_cb(void *params, long long val) {
+    server_stats *stats = params;
+    if (parse_depth != 2 || top_key == NULL || last_key == NULL)
+        return 1;
+    if (strcmp(top_key, "x_push_changes") == 0 && strcmp(last_key, "calls") == 0)
+        stats->x_push_changes = val;
+    else if (strcmp(top_key, "slow_frames") == 0 && strcmp(last_key, "count") == 0)
+        stats->slow_frames = val;
+    return 1;
+}
+
+static yajl_callbacks stats_callbacks = {
+    .yajl_integer = stats_integer_cb,
+    .yajl_start_map = stats_start_cb,
+    .yajl_map_key = stats_map_key_cb,
+    .yajl_end_map = stats_end_cb,
+    .yajl_start_array = stats_start_cb,
+    .yajl_end_array = stats_end_cb,
+};
+
+static int clients_start_map_cb(void *params) {
+    if (++parse_depth == 2) {
+        memset(&client_entry, 0, sizeof(client_entry));
+        client_entry_self = false;
+        client_entry_pid = -1;
+    }
+    return 1;
+}
+
+static int clients_end_map_cb(void *params) {
+    server_stats *stats = params;
+    if (parse_depth-- == 2 && !client_entry_self && client_entry_pid == getpid()) {
+        stats->handler_ns += client_entry.handler_ns;
+        stats->bytes_sent += client_entry.bytes_sent;
+        stats->events_coalesced += client_entry.events_coalesced;
+        stats->events_dropped += client_entry.events_dropped;
+        if (client_entry.queued_bytes_max > stats->queued_bytes_max)
+            stats->queued_bytes_max = client_entry.queued_bytes_max;
+    }
+    return 1;
+}
+
+static int clients_map_key_cb(void *params, const unsigned char *val, size_t len) {
+    free(last_key);
+    last_key = sstrndup((const char *)val, len);
+    return 1;
+}
+
+static int clients_boolean_cb(void *params, int val) {
+    if (parse_depth == 2 && strcmp(last_key, "self") == 0)
+        client_entry_self = val;
+    return 1;
+}
+
+static int clients_integer_cb(void *params, long long val) {
+    if (parse_depth != 2)
+        return 1;
+    if (strcmp(last_key, "pid") == 0)
+        client_entry_pid = val;
+    else if (strcmp(last_key, "handler_ns") == 0)
+        client_entry.handler_ns = val;
+    else if (strcmp(last_key, "bytes_sent") == 0)
+        client_entry.bytes_sent = val;
+    else if (strcmp(last_key, "events_coalesced") == 0)
+        client_entry.events_coalesced = val;
+    else if (strcmp(last_key, "events_dropped") == 0)
+        client_entry.events_dropped = val;
+    else if (strcmp(last_key, "queued_bytes_max") == 0)
+        client_entry.queued_bytes_max = val;
+    return 1;
+}
+
+static yajl_callbacks clients_callbacks = {
+    .yajl_boolean = clients_boolean_cb,
+    .yajl_integer = clients_integer_cb,
+    .yajl_start_map = clients_start_map_cb,
+    .yajl_map_key = clients_map_key_cb,
+    .yajl_end_map = clients_end_map_cb,
+    .yajl_start_array = stats_start_cb,
+    .yajl_end_array = stats_end_cb,
+};
+
+/*
+ * Sends the given message on the (blocking) control connection and parses the
+ * reply with the given callbacks. Returns false when i3 does not understand the
+ * message, e.g. because it is an older version.
+ *
+ */
+static bool query_server(int fd, uint32_t message_type, yajl_callbacks *callbacks, server_stats *stats) {
+    if (ipc_send_message(fd, 0, message_type, (const uint8_t *)"") == -1)
+        err(EXIT_FAILURE, "IPC: write()");
+
+    uint32_t reply_type;
+    uint32_t reply_length;
+    uint8_t *reply;
+    int ret;
+    if ((ret = ipc_recv_message(fd, &reply_type, &reply_length, &reply)) != 0) {
+        if (ret == -1)
+            err(EXIT_FAILURE, "IPC: read()");
+        exit(EXIT_FAILURE);
+    }
+    if (reply_type != message_type) {
+        free(reply);
+        return false;
+    }
+
+    parse_depth = 0;
+    yajl_handle handle = yajl_alloc(callbacks, NULL, stats);
+    yajl_status state = yajl_parse(handle, reply, reply_length);
+    if (state == yajl_status_ok)
+        state = yajl_complete_parse(handle);
+    yajl_free(handle);
+    free(reply);
+    FREE(top_key);
+    FREE(last_key);
+    return (state == yajl_status_ok);
+}
+
+int main(int argc, char *argv[]) {
+#if defined(__OpenBSD__)
+    if (pledge("stdio rpath unix", NULL) == -1)
+        err(EXIT_FAILURE, "pledge");
+#endif
+    char *socket_path = NULL;
+    int num_clients = 4;
+    int num_subscribers = 1;
+    double duration = 10;
+    char *command = sstrdup("nop i3-ipc-bench");
+    char *events = sstrdup("[\"workspace\",\"window\"]");
+
+    enum {
+        OPT_COMMAND_RATE = 256,
+        OPT_TREE_RATE,
+        OPT_WORKSPACES_RATE,
+    };
+    static struct option long_options[] = {
+        {"socket", required_argument, 0, 's'},
+        {"clients", required_argument, 0, 'c'},
+        {"subscribers", required_argument, 0, 'm'},
+        {"duration", required_argument, 0, 'd'},
+        {"command", required_argument, 0, 'C'},
+        {"events", required_argument, 0, 'e'},
+        {"command-rate", required_argument, 0, OPT_COMMAND_RATE},
+        {"tree-rate", required_argument, 0, OPT_TREE_RATE},
+        {"workspaces-rate", required_argument, 0, OPT_WORKSPACES_RATE},
+        {"version", no_argument, 0, 'v'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}};
+
+    char *options_string = "s:c:m:d:C:e:vh";
+    int o, option_index = 0;
+
+    while ((o = getopt_long(argc, argv, options_string, long_options, &option_index)) != -1) {
+        if (o == 's') {
+            free(socket_path);
+            socket_path = sstrdup(optarg);
+        } else if (o == 'c') {
+            num_clients = atoi(optarg);
+        } else if (o == 'm') {
+            num_subscribers = atoi(optarg);
+        } else if (o == 'd') {
+            duration = atof(optarg);
+        } else if (o == 'C') {
+            free(command);
+            command = sstrdup(optarg);
+        } else if (o == 'e') {
+            free(events);
+            events = sstrdup(optarg);
+        } else if (o == OPT_COMMAND_RATE) {
+            request_rates[REQUEST_COMMAND] = atof(optarg);
+        } else if (o == OPT_TREE_RATE) {
+            request_rates[REQUEST_TREE] = atof(optarg);
+        } else if (o == OPT_WORKSPACES_RATE) {
+            request_rates[REQUEST_WORKSPACES] = atof(optarg);
+        } else if (o == 'v') {
+            printf("i3-ipc-bench " I3_VERSION "\n");
+            return 0;
+        } else if (o == 'h') {
+            printf("i3-ipc-bench " I3_VERSION "\n");
+            printf("i3-ipc-bench [-s <socket>] [-c <clients>] [-m <subscribers>] [-d <seconds>]\n"
+                   "             [--command-rate <n>] [--tree-rate <n>] [--workspaces-rate <n>]\n"
+                   "             [-C <command>] [-e <events>]\n");
+            return 0;
+        } else if (o == '?') {
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (num_clients < 0 || num_subscribers < 0 || duration <= 0)
+        errx(EXIT_FAILURE, "The number of clients and subscribers must not be negative, the duration must be positive.");
+
+    const int control = ipc_connect(socket_path);
+    server_stats before = {0};
+    const bool have_stats = query_server(control, I3_IPC_MESSAGE_TYPE_GET_STATS, &stats_callbacks, &before);
+
+    bench_subscriber *subscribers = scalloc(num_subscribers, sizeof(bench_subscriber));
+    for (int i = 0; i < num_subscribers; i++) {
+        bench_subscriber *subscriber = &subscribers[i];
+        subscriber->fd = ipc_connect(socket_path);
+        subscriber->reader = ipc_reader_new();
+        if (ipc_send_message(subscriber->fd, strlen(events), I3_IPC_MESSAGE_TYPE_SUBSCRIBE, (const uint8_t *)events) == -1)
+            err(EXIT_FAILURE, "IPC: write()");
+
+        uint32_t reply_type;
+        uint32_t reply_length;
+        uint8_t *reply;
+        if (ipc_recv_message(subscriber->fd, &reply_type, &reply_length, &reply) != 0)
+            errx(EXIT_FAILURE, "IPC: Could not subscribe");
+        if (strstr((const char *)reply, "\"success\":true") == NULL)
+            errx(EXIT_FAILURE, "IPC: Could not subscribe to %s: %s", events, reply);
+        free(reply);
+        set_nonblock(subscriber->fd);
+    }
+
+    /* The requests of the clients are spread over the first interval, so that
+     * the clients do not all send at the same time. */
+    const uint64_t start = now_ns();
+    bench_client *clients = scalloc(num_clients, sizeof(bench_client));
+    for (int i = 0; i < num_clients; i++) {
+        bench_client *client = &clients[i];
+        client->fd = ipc_connect(socket_path);
+        client->reader = ipc_reader_new();
+        set_nonblock(client->fd);
+        for (int type = 0; type < NUM_REQUESTS; type++) {
+            if (request_rates[type] > 0)
+                client->next_due[type] = start + (uint64_t)(1e9 / request_rates[type]) * i / num_clients;
+        }
+    }
+
+    const int num_fds = num_clients + num_subscribers;
+    struct pollfd *fds = scalloc(num_fds, sizeof(struct pollfd));
+    for (int i = 0; i < num_clients; i++) {
+        fds[i].fd = clients[i].fd;
+        fds[i].events = POLLIN;
+    }
+    for (int i = 0; i < num_subscribers; i++) {
+        fds[num_clients + i].fd = subscribers[i].fd;
+        fds[num_clients + i].events = POLLIN;
+    }
+
+    /* After the deadline, no new requests are sent, but the ones in flight are
+     * still waited for (at most one second). */
+    const uint64_t deadline = start + (uint64_t)(duration * 1e9);
+    const uint64_t drain_deadline = deadline + 1000000000ULL;
+    uint64_t end;
+    while (true) {
+        const uint64_t now = now_ns();
+        end = now;
+        bool any_in_flight = false;
+        uint64_t next_wakeup = (now < deadline ? deadline : drain_deadline);
+        for (int i = 0; i < num_clients; i++) {
+            bench_client *client = &clients[i];
+            if (now < deadline)
+                client_send_due(client, now, command);
+            any_in_flight |= client->in_flight;
+            if (client->in_flight || now >= deadline)
+                continue;
+            for (int type = 0; type < NUM_REQUESTS; type++) {
+                if (request_rates[type] > 0 && client->next_due[type] < next_wakeup)
+                    next_wakeup = client->next_due[type];
+            }
+        }
+        if (now >= drain_deadline || (now >= deadline && !any_in_flight))
+            break;
+
+        const int timeout = (next_wakeup > now ? (next_wakeup - now + 999999) / 1000000 : 0);
+        if (poll(fds, num_fds, timeout) == -1) {
+            if (errno == EINTR)
+                continue;
+            err(EXIT_FAILURE, "poll()");
+        }
+
+        for (int i = 0; i < num_fds; i++) {
+            if (fds[i].revents == 0)
+                continue;
+            if (i < num_clients)
+                client_handle_input(&clients[i]);
+            else
+                subscriber_handle_input(&subscribers[i - num_clients]);
+        }
+    }
+
+    /* Give the subscribers a chance to receive the events caused by the last
+     * commands. */
+    for (int i = 0; i < num_subscribers; i++) {
+        fds[i].fd = subscribers[i].fd;
+        fds[i].events = POLLIN;
+    }
+    while (num_subscribers > 0 && poll(fds, num_subscribers, 100) > 0) {
+        for (int i = 0; i < num_subscribers; i++) {
+            if (fds[i].revents != 0)
+                subscriber_handle_input(&subscribers[i]);
+        }
+    }
+
+    const double elapsed = (end - start) / 1e9;
+    printf("%d clients, %d subscribers, %.1f s\n\n", num_clients, num_subscribers, elapsed);
+    printf("%-16s %8s %10s %9s %9s %9s %9s\n", "request", "count", "req/s", "p50 ms", "p90 ms", "p99 ms", "max ms");
+    for (int type = 0; type < NUM_REQUESTS; type++) {
+        struct latencies *l = &latencies[type];
+        if (request_rates[type] <= 0)
+            continue;
+        qsort(l->values, l->num, sizeof(uint64_t), compare_u64);
+        printf("%-16s %8zu %10.1f %9.3f %9.3f %9.3f %9.3f\n",
+               request_names[type], l->num, l->num / elapsed,
+               percentile_ms(l, 50), percentile_ms(l, 90), percentile_ms(l, 99), percentile_ms(l, 100));
+    }
+    if (replies_failed > 0)
+        printf("\n%" PRIu64 " commands failed\n", replies_failed);
+    printf("\nevents: %" PRIu64 " (%.1f/s per subscriber), %" PRIu64 " bytes\n",
+           events_received, (num_subscribers > 0 ? events_received / elapsed / num_subscribers : 0),
+           event_bytes_received);
+
+    server_stats after = {0};
+    if (have_stats && query_server(control, I3_IPC_MESSAGE_TYPE_GET_STATS, &stats_callbacks, &after)) {
+        printf("\ni3: %lld x_push_changes calls, %lld slow frames\n",
+               after.x_push_changes - before.x_push_changes,
+               after.slow_frames - before.slow_frames);
+    }
+    server_stats connections = {0};
+    if (query_server(control, I3_IPC_MESSAGE_TYPE_GET_CLIENTS, &clients_callbacks, &connections)) {
+        printf("i3: %.3f ms handling requests, %lld bytes sent, %lld events coalesced, %lld events dropped, %lld bytes queued at most\n",
+               connections.handler_ns / 1e6, connections.bytes_sent,
+               connections.events_coalesced, connections.events_dropped,
+               connections.queued_bytes_max);
+    }
+
+    for (int i = 0; i < num_clients; i++) {
+        close(clients[i].fd);
+        ipc_reader_free(clients[i].reader);
+    }
+    for (int i = 0; i < num_subscribers; i++) {
+        close(subscribers[i].fd);
+        ipc_reader_free(subscribers[i].reader);
+    }
+    for (int type = 0; type < NUM_REQUESTS; type++)
+        free(latencies[type].values);
+    close(control);
+    free(clients);
+    free(subscribers);
+    free(fds);
+    free(command);
+    free(events);
+    free(socket_path);
+    return 0;
+}
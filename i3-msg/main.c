@@ -58,6 +58,34 @@ void errorlog(char *fmt, ...) {
     va_end(args);
 }
 
+/* Whether i3 sends replies and events encoded as CBOR on this connection. */
+static bool use_cbor = false;
+
+/*
+ * Receives the next message and exits on errors. When the connection uses
+ * CBOR, the payload is converted back to JSON, so that the rest of i3-msg only
+ * needs to deal with JSON.
+ *
+ */
+static void recv_message(int sockfd, uint32_t *reply_type, uint32_t *reply_length, uint8_t **reply) {
+    int ret;
+    if ((ret = ipc_recv_message(sockfd, reply_type, reply_length, reply)) != 0) {
+        if (ret == -1)
+            err(EXIT_FAILURE, "IPC: read()");
+        exit(1);
+    }
+    if (!use_cbor)
+        return;
+
+    size_t json_len;
+    char *json = cbor_to_json(*reply, *reply_length, &json_len);
+    if (json == NULL)
+        errx(EXIT_FAILURE, "IPC: Could not decode CBOR reply.");
+    free(*reply);
+    *reply = (uint8_t *)json;
+    *reply_length = json_len;
+}
+
 static char *last_key = NULL;
 
 typedef struct reply_t {
@@ -155,6 +183,107 @@ static yajl_callbacks config_callbacks = {
     .yajl_end_map = config_end_map_cb,
 };
 
+/*
+ * Prints the given reply (or, for failed commands, the error) unless quiet is
+ * set.
+ *
+ */
+static void print_reply(uint32_t reply_type, uint32_t reply_length, uint8_t *reply, bool quiet) {
+    /* For the reply of commands, have a look if that command was successful.
+     * If not, nicely format the error message. */
+    if (reply_type == I3_IPC_REPLY_TYPE_COMMAND) {
+        /* Don’t report errors of an earlier reply in batch mode. */
+        free(last_reply.error);
+        free(last_reply.input);
+        free(last_reply.errorposition);
+        last_reply = (reply_t){.success = true};
+        yajl_handle handle = yajl_alloc(&reply_callbacks, NULL, NULL);
+        yajl_status state = yajl_parse(handle, (const unsigned char *)reply, reply_length);
+        yajl_free(handle);
+
+        switch (state) {
+            case yajl_status_ok:
+                break;
+            case yajl_status_client_canceled:
+            case yajl_status_error:
+                errx(EXIT_FAILURE, "IPC: Could not parse JSON reply.");
+        }
+
+        if (!quiet) {
+            printf("%.*s\n", reply_length, reply);
+        }
+    } else if (reply_type == I3_IPC_REPLY_TYPE_CONFIG) {
+        yajl_handle handle = yajl_alloc(&config_callbacks, NULL, NULL);
+        yajl_status state = yajl_parse(handle, (const unsigned char *)reply, reply_length);
+        yajl_free(handle);
+
+        switch (state) {
+            case yajl_status_ok:
+                break;
+            case yajl_status_client_canceled:
+            case yajl_status_error:
+                errx(EXIT_FAILURE, "IPC: Could not parse JSON reply.");
+        }
+    } else {
+        if (!quiet) {
+            printf("%.*s\n", reply_length, reply);
+        }
+    }
+}
+
+/* The maximum number of messages sent in batch mode before waiting for the
+ * oldest reply. */
+#define BATCH_MAX_PENDING 64
+
+/*
+ * Receives the reply to the oldest pending message in batch mode and prints
+ * it.
+ *
+ */
+static void recv_batch_reply(int sockfd, uint32_t message_type, bool quiet) {
+    uint32_t reply_length;
+    uint32_t reply_type;
+    uint8_t *reply;
+
+    recv_message(sockfd, &reply_type, &reply_length, &reply);
+    if (reply_type != message_type)
+        errx(EXIT_FAILURE, "IPC: Received reply of type %d but expected %d", reply_type, message_type);
+    print_reply(reply_type, reply_length, reply, quiet);
+    free(reply);
+}
+
+/*
+ * Sends every line read from stdin as one message of the given type over the
+ * same connection and prints the replies in order. Messages are pipelined:
+ * up to BATCH_MAX_PENDING of them are sent before waiting for a reply.
+ *
+ */
+static void run_batch(int sockfd, uint32_t message_type, bool quiet) {
+    char *line = NULL;
+    size_t line_size = 0;
+    ssize_t len;
+    int pending = 0;
+
+    while ((len = getline(&line, &line_size, stdin)) != -1) {
+        if (len > 0 && line[len - 1] == '\n')
+            line[--len] = '\0';
+
+        if (ipc_send_message(sockfd, len, message_type, (uint8_t *)line) == -1)
+            err(EXIT_FAILURE, "IPC: write()");
+
+        if (++pending == BATCH_MAX_PENDING) {
+            /* Make sure all replies so far are visible before blocking. */
+            fflush(stdout);
+            recv_batch_reply(sockfd, message_type, quiet);
+            pending--;
+        }
+    }
+    free(line);
+
+    while (pending-- > 0)
+        recv_batch_reply(sockfd, message_type, quiet);
+}
+
 int main(int argc, char *argv[]) {
 #if defined(__OpenBSD__)
     if (pledge("stdio rpath unix", NULL) == -1)
@@ -166,6 +295,8 @@ int main(int argc, char *argv[]) {
     char *payload = NULL;
     bool quiet = false;
     bool monitor = false;
+    bool want_cbor = false;
+    bool batch = false;
 
     static struct option long_options[] = {
         {"socket", required_argument, 0, 's'},
@@ -173,10 +304,12 @@ int main(int argc, char *argv[]) {
         {"version", no_argument, 0, 'v'},
         {"quiet", no_argument, 0, 'q'},
         {"monitor", no_argument, 0, 'm'},
+        {"encoding", required_argument, 0, 'e'},
+        {"batch", no_argument, 0, 'b'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}};
 
-    char *options_string = "s:t:vhqm";
+    char *options_string = "s:t:e:vhqmb";
 
     while ((o = getopt_long(argc, argv, options_string, long_options, &option_index)) != -1) {
         if (o == 's') {
@@ -187,6 +320,8 @@ int main(int argc, char *argv[]) {
                 message_type = I3_IPC_MESSAGE_TYPE_RUN_COMMAND;
             } else if (strcasecmp(optarg, "run_command") == 0) {
                 message_type = I3_IPC_MESSAGE_TYPE_RUN_COMMAND;
+            } else if (strcasecmp(optarg, "run_commands") == 0) {
+                message_type = I3_IPC_MESSAGE_TYPE_RUN_COMMANDS;
             } else if (strcasecmp(optarg, "get_workspaces") == 0) {
                 message_type = I3_IPC_MESSAGE_TYPE_GET_WORKSPACES;
             } else if (strcasecmp(optarg, "get_outputs") == 0) {
@@ -205,23 +340,40 @@ int main(int argc, char *argv[]) {
                 message_type = I3_IPC_MESSAGE_TYPE_GET_CONFIG;
             } else if (strcasecmp(optarg, "send_tick") == 0) {
                 message_type = I3_IPC_MESSAGE_TYPE_SEND_TICK;
+            } else if (strcasecmp(optarg, "get_stats") == 0) {
+                message_type = I3_IPC_MESSAGE_TYPE_GET_STATS;
+            } else if (strcasecmp(optarg, "get_clients") == 0) {
+                message_type = I3_IPC_MESSAGE_TYPE_GET_CLIENTS;
             } else if (strcasecmp(optarg, "subscribe") == 0) {
                 message_type = I3_IPC_MESSAGE_TYPE_SUBSCRIBE;
             } else {
                 printf("Unknown message type\n");
-                printf("Known types: run_command, get_workspaces, get_outputs, get_tree, get_marks, get_bar_config, get_binding_modes, get_version, get_config, send_tick, subscribe\n");
+                printf("Known types: run_command, run_commands, get_workspaces, get_outputs, get_tree, get_marks, get_bar_config, get_binding_modes, get_version, get_config, send_tick, get_stats, get_clients, subscribe\n");
+                exit(EXIT_FAILURE);
+            }
+        } else if (o == 'e') {
+            if (strcasecmp(optarg, "json") == 0) {
+                want_cbor = false;
+            } else if (strcasecmp(optarg, "cbor") == 0) {
+                want_cbor = true;
+            } else {
+                printf("Unknown encoding\n");
+                printf("Known encodings: json, cbor\n");
                 exit(EXIT_FAILURE);
             }
         } else if (o == 'q') {
             quiet = true;
         } else if (o == 'm') {
             monitor = true;
+        } else if (o == 'b') {
+            batch = true;
         } else if (o == 'v') {
             printf("i3-msg " I3_VERSION "\n");
             return 0;
         } else if (o == 'h') {
             printf("i3-msg " I3_VERSION "\n");
-            printf("i3-msg [-s <socket>] [-t <type>] [-m] <message>\n");
+            printf("i3-msg [-s <socket>] [-t <type>] [-e <encoding>] [-m] <message>\n");
+            printf("i3-msg [-s <socket>] [-t <type>] [-e <encoding>] -b < <messages>\n");
             return 0;
         } else if (o == '?') {
             exit(EXIT_FAILURE);
@@ -233,6 +385,16 @@ int main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
 
+    if (batch && message_type == I3_IPC_MESSAGE_TYPE_SUBSCRIBE) {
+        fprintf(stderr, "The batch option -b cannot be used with -t SUBSCRIBE.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (batch && optind < argc) {
+        fprintf(stderr, "The batch option -b reads the messages from stdin, no message can be given as argument.\n");
+        exit(EXIT_FAILURE);
+    }
+
     /* Use all arguments, separated by whitespace, as payload.
      * This way, you don’t have to do i3-msg 'mark foo', you can use
      * i3-msg mark foo */
@@ -251,60 +413,44 @@ int main(int argc, char *argv[]) {
     if (!payload)
         payload = sstrdup("");
 
-    int sockfd = ipc_connect(socket_path);
-    if (ipc_send_message(sockfd, strlen(payload), message_type, (uint8_t *)payload) == -1)
-        err(EXIT_FAILURE, "IPC: write()");
-    free(payload);
-
     uint32_t reply_length;
     uint32_t reply_type;
     uint8_t *reply;
-    int ret;
-    if ((ret = ipc_recv_message(sockfd, &reply_type, &reply_length, &reply)) != 0) {
-        if (ret == -1)
-            err(EXIT_FAILURE, "IPC: read()");
-        exit(1);
+
+    int sockfd = ipc_connect(socket_path);
+    if (want_cbor) {
+        const char *encoding = "cbor";
+        if (ipc_send_message(sockfd, strlen(encoding), I3_IPC_MESSAGE_TYPE_SET_ENCODING, (const uint8_t *)encoding) == -1)
+            err(EXIT_FAILURE, "IPC: write()");
+        /* The reply is still sent as JSON. */
+        recv_message(sockfd, &reply_type, &reply_length, &reply);
+        const char *success = "{\"success\":true}";
+        if (reply_type != I3_IPC_REPLY_TYPE_SET_ENCODING ||
+            reply_length != strlen(success) ||
+            memcmp(reply, success, reply_length) != 0)
+            errx(EXIT_FAILURE, "IPC: i3 does not support the CBOR encoding");
+        free(reply);
+        use_cbor = true;
     }
-    if (reply_type != message_type)
-        errx(EXIT_FAILURE, "IPC: Received reply of type %d but expected %d", reply_type, message_type);
-    /* For the reply of commands, have a look if that command was successful.
-     * If not, nicely format the error message. */
-    if (reply_type == I3_IPC_REPLY_TYPE_COMMAND) {
-        yajl_handle handle = yajl_alloc(&reply_callbacks, NULL, NULL);
-        yajl_status state = yajl_parse(handle, (const unsigned char *)reply, reply_length);
-        yajl_free(handle);
 
-        switch (state) {
-            case yajl_status_ok:
-                break;
-            case yajl_status_client_canceled:
-            case yajl_status_error:
-                errx(EXIT_FAILURE, "IPC: Could not parse JSON reply.");
-        }
+    if (batch) {
+        free(payload);
+        run_batch(sockfd, message_type, quiet);
+        close(sockfd);
+        return exit_code;
+    }
 
-        if (!quiet) {
-            printf("%.*s\n", reply_length, reply);
-        }
-    } else if (reply_type == I3_IPC_REPLY_TYPE_CONFIG) {
-        yajl_handle handle = yajl_alloc(&config_callbacks, NULL, NULL);
-        yajl_status state = yajl_parse(handle, (const unsigned char *)reply, reply_length);
-        yajl_free(handle);
+    if (ipc_send_message(sockfd, strlen(payload), message_type, (uint8_t *)payload) == -1)
+        err(EXIT_FAILURE, "IPC: write()");
+    free(payload);
 
-        switch (state) {
-            case yajl_status_ok:
-                break;
-            case yajl_status_client_canceled:
-            case yajl_status_error:
-                errx(EXIT_FAILURE, "IPC: Could not parse JSON reply.");
-        }
-    } else if (reply_type == I3_IPC_REPLY_TYPE_SUBSCRIBE) {
+    recv_message(sockfd, &reply_type, &reply_length, &reply);
+    if (reply_type != message_type)
+        errx(EXIT_FAILURE, "IPC: Received reply of type %d but expected %d", reply_type, message_type);
+    if (reply_type == I3_IPC_REPLY_TYPE_SUBSCRIBE) {
         do {
             free(reply);
-            if ((ret = ipc_recv_message(sockfd, &reply_type, &reply_length, &reply)) != 0) {
-                if (ret == -1)
-                    err(EXIT_FAILURE, "IPC: read()");
-                exit(1);
-            }
+            recv_message(sockfd, &reply_type, &reply_length, &reply);
 
             if (!(reply_type & I3_IPC_EVENT_MASK)) {
                 errx(EXIT_FAILURE, "IPC: Received reply of type %d but expected an event", reply_type);
@@ -316,9 +462,7 @@ int main(int argc, char *argv[]) {
             }
         } while (monitor);
     } else {
-        if (!quiet) {
-            printf("%.*s\n", reply_length, reply);
-        }
+        print_reply(reply_type, reply_length, reply, quiet);
     }
 
     free(reply);
@@ -15,6 +15,9 @@
 
 #define STDIN_CHUNK_SIZE 1024
 
+/* Incremented whenever the status line changes. */
+extern uint32_t statusline_generation;
+
 typedef struct {
     pid_t pid;
 
@@ -40,6 +43,11 @@ typedef struct {
      */
     bool click_events;
     bool click_events_init;
+
+    /**
+     * Whether the child may send single blocks to update the status line
+     */
+    bool partial_updates;
 } i3bar_child;
 
 /*
@@ -34,11 +34,14 @@ typedef enum {
 } blockalign_t;
 
 /* This data structure describes the way a status block should be rendered. These
- * variables are updated each time the statusline is re-rendered. */
+ * variables are computed when the statusline is rendered for the first time
+ * after the block changed. */
 struct status_block_render_desc {
     uint32_t width;
     uint32_t x_offset;
     uint32_t x_append;
+    /* Whether the values above have been computed. */
+    bool valid;
 };
 
 /* This data structure represents one JSON dictionary, multiple of these make
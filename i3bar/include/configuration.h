@@ -54,6 +54,7 @@ typedef struct config_t {
     bool disable_ws;
     bool strip_ws_numbers;
     bool strip_ws_name;
+    bool share_status_command;
     char *bar_id;
     char *command;
     char *fontname;
@@ -63,6 +64,7 @@ typedef struct config_t {
     tray_outputs;
 
     int tray_padding;
+    int status_redraw_interval;
     int num_outputs;
     char **outputs;
 
@@ -81,6 +83,13 @@ config_t config;
  */
 void parse_config_json(char *json);
 
+/**
+ * Parses only the mode and hidden_state of the received bar configuration and
+ * leaves the rest of the configuration alone.
+ *
+ */
+void parse_config_visibility_json(char *json);
+
 /**
  * free()s the color strings as soon as they are not needed anymore.
  *
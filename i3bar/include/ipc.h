@@ -13,6 +13,9 @@
 
 #include <stdint.h>
 
+/* Path of the i3 IPC socket i3bar is connected to. */
+extern char *sock_path;
+
 /*
  * Initiate a connection to i3.
  * socket_path must be a valid path to the ipc_socket of i3
@@ -20,6 +23,14 @@
  */
 int init_connection(const char *socket_path);
 
+/*
+ * Requests the configuration of our bar, followed by the outputs and the
+ * workspaces. i3 answers them in order, so everything needed to draw the bars
+ * arrives with the first reply instead of one round trip after another.
+ *
+ */
+void request_bar_config(void);
+
 /*
  * Destroy the connection to i3.
  *
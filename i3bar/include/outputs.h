@@ -24,6 +24,10 @@ struct outputs_head* outputs;
 /*
  * Start parsing the received JSON string
  *
+ * The outputs are merged into the existing list: outputs which are not part
+ * of the reply anymore are removed (destroying their bar), and outputs whose
+ * geometry, active state or primary flag changed are marked as changed.
+ *
  */
 void parse_outputs_json(char* json);
 
@@ -51,11 +55,41 @@ i3_output* get_output_by_name(char* name);
  */
 bool output_has_focus(i3_output* output);
 
+/* Where draw_statusline() drew a status block, relative to the start of the
+ * (unclipped) status line. Used to find the block which was clicked. */
+struct block_extent {
+    uint32_t x;
+    uint32_t width;
+    struct status_block* block;
+};
+
+/* What draw_bars() drew into the buffer of an output the last time. */
+struct bar_drawn_state {
+    /* The bar_generation and focus state the buffer was drawn for. If either
+     * changed, the bar is redrawn completely. */
+    uint32_t generation;
+    bool focus_colors;
+
+    /* The workspace buttons and binding mode indicator. */
+    uint64_t left_hash;
+    int workspace_width;
+
+    /* The status line. */
+    uint32_t statusline_generation;
+    int statusline_x;
+    int statusline_visible_width;
+    uint32_t statusline_clip_left;
+    bool statusline_short_text;
+};
+
 struct i3_output {
     char* name;   /* Name of the output */
     bool active;  /* If the output is active */
     bool primary; /* If it is the primary output */
     bool visible; /* If the bar is visible on this output */
+    bool mapped;  /* If the bar window is mapped */
+    bool changed; /* If the bar has to be reconfigured, see reconfig_windows() */
+    bool seen;    /* If the output was part of the last GET_OUTPUTS reply */
     int ws;       /* The number of the currently visible ws */
     rect rect;    /* The rect (relative to the root window) */
 
@@ -69,6 +103,12 @@ struct i3_output {
     bool statusline_short_text;
     /* The actual window on which we draw. */
     surface_t bar;
+    /* What is currently drawn in buffer, see draw_bars(). */
+    struct bar_drawn_state drawn;
+    /* The blocks of the statusline which is currently drawn, sorted by x. */
+    struct block_extent* block_extents;
+    int num_block_extents;
+    int block_extents_size;
 
     struct ws_head* workspaces;  /* The workspaces on this output */
     struct tc_head* trayclients; /* The tray clients on this output */
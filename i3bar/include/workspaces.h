@@ -23,13 +23,28 @@ TAILQ_HEAD(ws_head, i3_ws);
  */
 void parse_workspaces_json(char *json);
 
+/*
+ * Updates the workspaces according to the given workspace event. Returns false
+ * if the event cannot be applied (or is not understood), in which case the
+ * workspaces have to be requested again.
+ *
+ */
+bool update_workspaces_from_event(const char *json);
+
 /*
  * free() all workspace data structures
  *
  */
 void free_workspaces(void);
 
+/*
+ * free() the workspace data structures of the given output
+ *
+ */
+void free_output_workspaces(i3_output *output);
+
 struct i3_ws {
+    long long id;             /* The id of the ws container in i3 */
     int num;                  /* The internal number of the ws */
     char *canonical_name;     /* The true name of the ws according to the ipc */
     i3String *name;           /* The name of the ws that is displayed on the bar */
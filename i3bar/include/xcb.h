@@ -57,10 +57,11 @@ int separator_symbol_width;
 
 /*
  * Early initialization of the connection to X11: Everything which does not
- * depend on 'config'.
+ * depend on 'config'. Returns the i3 socket path stored on the root window if
+ * get_socket_path is set, NULL otherwise.
  *
  */
-char *init_xcb_early(void);
+char *init_xcb_early(bool get_socket_path);
 
 /**
  * Initialization which depends on 'config' being usable. Called after the
@@ -123,6 +124,9 @@ void realloc_sl_buffer(void);
 /*
  * Reconfigure all bars and create new for newly activated outputs
  *
+ * Unless redraw_bars is set, only the bars of outputs which changed since the
+ * last call (see parse_outputs_json()) are reconfigured.
+ *
  */
 void reconfig_windows(bool redraw_bars);
 
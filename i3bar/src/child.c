@@ -14,6 +14,8 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdarg.h>
@@ -21,6 +23,7 @@
 #include <string.h>
 #include <errno.h>
 #include <err.h>
+#include <pthread.h>
 #include <ev.h>
 #include <yajl/yajl_common.h>
 #include <yajl/yajl_parse.h>
@@ -38,65 +41,336 @@ ev_io *stdin_io;
 int stdin_fd;
 ev_child *child_sig;
 
-/* JSON parser for stdin */
-yajl_handle parser;
-
 /* JSON generator for stdout */
 yajl_gen gen;
 
+/* The state of the parser thread, see status_parser_thread(). */
 typedef struct parser_ctx {
-    /* True if one of the parsed blocks was urgent */
+    /* JSON parser for stdin */
+    yajl_handle parser;
+
+    /* The status command output being parsed, see status_stream. */
+    uint32_t stream;
+
+    /* Snapshots of the configuration which the main thread may change while
+     * we parse. */
+    uint32_t sep_block_width;
+    bool partial_updates;
+
+    /* True if one of the blocks of the current status line was urgent */
     bool has_urgent;
 
+    /* Nesting of arrays and maps, 1 being the endless array of status
+     * lines. */
+    int depth;
+
     /* A copy of the last JSON map key. */
     char *last_map_key;
 
     /* The current block. Will be filled, then copied and put into the list of
      * blocks. */
     struct status_block block;
+
+    /* The status line being read. */
+    struct statusline_head line;
 } parser_ctx;
 
-parser_ctx parser_context;
+static parser_ctx parser_context = {.line = TAILQ_HEAD_INITIALIZER(parser_context.line)};
 
 struct statusline_head statusline_head = TAILQ_HEAD_INITIALIZER(statusline_head);
-/* Used temporarily while reading a statusline */
-struct statusline_head statusline_buffer = TAILQ_HEAD_INITIALIZER(statusline_buffer);
+
+/* The JSON output of the status command is parsed in a separate thread, so
+ * that large or slowly trickling status lines do not delay handling X events,
+ * clicks and i3’s IPC messages. The main thread reads the output, appends it to
+ * status_input and takes back complete status lines and single block updates
+ * from status_updates, which it only needs to merge into statusline_head and
+ * draw. status_lock protects both queues and spare_blocks. */
+typedef struct status_update {
+    /* Whether this is a complete status line rather than a single block
+     * update, see update_status_block(). */
+    bool is_line;
+    bool has_urgent;
+    /* Set instead of blocks if the input could not be parsed. */
+    char *error;
+    uint32_t stream;
+    struct statusline_head blocks;
+
+    TAILQ_ENTRY(status_update)
+    updates;
+} status_update;
+
+static pthread_mutex_t status_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t status_input_cond = PTHREAD_COND_INITIALIZER;
+static bool status_thread_started;
+static ev_async status_async;
+
+static unsigned char *status_input;
+static size_t status_input_len;
+static size_t status_input_size;
+static uint32_t status_sep_block_width;
+static bool status_partial_updates;
+
+/* Incremented whenever the status command is (re)started, so that the parser
+ * thread starts over and updates for the previous output are dropped. */
+static uint32_t status_stream;
+
+static TAILQ_HEAD(status_updates_head, status_update) status_updates = TAILQ_HEAD_INITIALIZER(status_updates);
 
 int child_stdin;
 
+/* Set when a status line was read which differs from the previous one, see
+ * merge_statusline(). */
+static bool statusline_changed;
+
+uint32_t statusline_generation = 0;
+
+/* Input read from the child, see get_buffer(). */
+static unsigned char *stdin_buffer;
+static int stdin_buffer_size;
+static int stdin_buffer_len;
+
+/* Bars with share_status_command enabled and the same status command use one
+ * instance of it: the first i3bar runs the command and listens on a socket
+ * next to the i3 IPC socket (see start_child()). The others connect to that
+ * socket and read from it like from a status command of their own, while
+ * their click events are forwarded to the status command. */
+typedef struct status_subscriber {
+    int fd;
+    ev_io *io;
+
+    /* Whether the subscriber got the header and the current status line
+     * already, see sync_subscribers(). */
+    bool synced;
+
+    /* Incomplete line of click events. */
+    char *clicks;
+    size_t clicks_len;
+
+    TAILQ_ENTRY(status_subscriber)
+    subscribers;
+} status_subscriber;
+
+static TAILQ_HEAD(subscribers_head, status_subscriber) subscribers = TAILQ_HEAD_INITIALIZER(subscribers);
+
+/* Path of the socket for the shared status command. */
+static char *shared_path;
+/* Accepts subscribers if we run the shared status command. */
+static ev_io *shared_listen_io;
+/* Whether we read the status command output of another i3bar. */
+static bool following;
+/* The status command, to take over when the i3bar we follow exits. */
+static char *shared_command;
+
+/* What we need to send to bars which subscribe after the status command
+ * started: its JSON header and its last complete status line. */
+static bool shared_output_started;
+static unsigned char *shared_header;
+static int shared_header_len;
+static struct {
+    /* Nesting of arrays and maps, 1 being the endless array of status
+     * lines. */
+    int depth;
+    bool in_string;
+    bool escaped;
+    /* Whether the last status line was followed by a comma. */
+    bool comma_pending;
+    /* Whether the element being read is a single block (see
+     * update_status_block()) instead of a status line. */
+    bool line_is_update;
+
+    /* The status line being read and the last complete one. */
+    char *line;
+    size_t line_len;
+    size_t line_size;
+    char *last_line;
+    size_t last_line_len;
+    size_t last_line_size;
+} shared_stream;
+
+/* The last single block update for each block since the last complete status
+ * line, see keep_update(). */
+typedef struct shared_update {
+    char *name;
+    char *instance;
+    char *json;
+    size_t json_len;
+
+    TAILQ_ENTRY(shared_update)
+    updates;
+} shared_update;
+
+static TAILQ_HEAD(shared_updates_head, shared_update) shared_updates = TAILQ_HEAD_INITIALIZER(shared_updates);
+
+/* Delays redraws caused by the status command, see
+ * schedule_statusline_redraw(). */
+static ev_timer redraw_timer;
+/* Time of the last redraw caused by the status command. */
+static ev_tstamp last_statusline_redraw;
+/* Whether one of the status lines coalesced into the pending redraw had an
+ * urgent block. */
+static bool redraw_has_urgent;
+
+/* Blocks which were replaced or parsed again unchanged. They are reused for
+ * the following status lines instead of being allocated for every block of
+ * every status line. The parser thread takes them, the main thread returns
+ * them, so they are protected by status_lock. */
+static struct statusline_head spare_blocks = TAILQ_HEAD_INITIALIZER(spare_blocks);
+
+static void free_status_block_fields(struct status_block *block) {
+    I3STRING_FREE(block->full_text);
+    I3STRING_FREE(block->short_text);
+    FREE(block->color);
+    FREE(block->name);
+    FREE(block->instance);
+    FREE(block->min_width_str);
+    FREE(block->background);
+    FREE(block->border);
+}
+
+/*
+ * Frees the given status block and its fields.
+ *
+ */
+static void free_status_block(struct status_block *block) {
+    free_status_block_fields(block);
+    free(block);
+}
+
+/*
+ * Frees the fields of the given status block and keeps the block itself for
+ * reuse, see new_status_block().
+ *
+ */
+static void recycle_status_block(struct status_block *block) {
+    free_status_block_fields(block);
+    pthread_mutex_lock(&status_lock);
+    TAILQ_INSERT_HEAD(&spare_blocks, block, blocks);
+    pthread_mutex_unlock(&status_lock);
+}
+
+static struct status_block *new_status_block(void) {
+    pthread_mutex_lock(&status_lock);
+    struct status_block *block = TAILQ_FIRST(&spare_blocks);
+    if (block != NULL)
+        TAILQ_REMOVE(&spare_blocks, block, blocks);
+    pthread_mutex_unlock(&status_lock);
+
+    if (block == NULL)
+        return smalloc(sizeof(struct status_block));
+    return block;
+}
+
 /*
- * Remove all blocks from the given statusline.
- * If free_resources is set, the fields of each status block will be free'd.
+ * Remove all blocks from the given statusline and free them.
  */
-static void clear_statusline(struct statusline_head *head, bool free_resources) {
+static void clear_statusline(struct statusline_head *head) {
     struct status_block *first;
     while (!TAILQ_EMPTY(head)) {
         first = TAILQ_FIRST(head);
-        if (free_resources) {
-            I3STRING_FREE(first->full_text);
-            I3STRING_FREE(first->short_text);
-            FREE(first->color);
-            FREE(first->name);
-            FREE(first->instance);
-            FREE(first->min_width_str);
-            FREE(first->background);
-            FREE(first->border);
-        }
-
         TAILQ_REMOVE(head, first, blocks);
-        free(first);
+        free_status_block(first);
     }
 }
 
-static void copy_statusline(struct statusline_head *from, struct statusline_head *to) {
-    struct status_block *current;
-    TAILQ_FOREACH(current, from, blocks) {
-        struct status_block *new_block = smalloc(sizeof(struct status_block));
-        memcpy(new_block, current, sizeof(struct status_block));
-        TAILQ_INSERT_TAIL(to, new_block, blocks);
+/*
+ * Moves all blocks of a status line to the end of another one.
+ *
+ */
+static void move_statusline(struct statusline_head *to, struct statusline_head *from) {
+    struct status_block *block;
+    while ((block = TAILQ_FIRST(from)) != NULL) {
+        TAILQ_REMOVE(from, block, blocks);
+        TAILQ_INSERT_TAIL(to, block, blocks);
     }
 }
 
+static void free_status_update(status_update *update) {
+    clear_statusline(&(update->blocks));
+    FREE(update->error);
+    free(update);
+}
+
+/*
+ * Drops the status command output which was not parsed yet and the updates
+ * which were not applied yet, and makes the parser thread start over with the
+ * next input.
+ *
+ */
+static void reset_status_parser(void) {
+    struct status_updates_head dropped = TAILQ_HEAD_INITIALIZER(dropped);
+    status_update *update;
+
+    pthread_mutex_lock(&status_lock);
+    status_stream++;
+    status_input_len = 0;
+    while ((update = TAILQ_FIRST(&status_updates)) != NULL) {
+        TAILQ_REMOVE(&status_updates, update, updates);
+        TAILQ_INSERT_TAIL(&dropped, update, updates);
+    }
+    pthread_mutex_unlock(&status_lock);
+
+    while ((update = TAILQ_FIRST(&dropped)) != NULL) {
+        TAILQ_REMOVE(&dropped, update, updates);
+        free_status_update(update);
+    }
+}
+
+static bool strings_equal(const char *a, const char *b) {
+    if (a == NULL || b == NULL)
+        return (a == b);
+    return (strcmp(a, b) == 0);
+}
+
+static bool i3strings_equal(i3String *a, i3String *b) {
+    if (a == NULL || b == NULL)
+        return (a == b);
+    return (i3string_is_markup(a) == i3string_is_markup(b) &&
+            i3string_get_num_bytes(a) == i3string_get_num_bytes(b) &&
+            memcmp(i3string_as_utf8(a), i3string_as_utf8(b), i3string_get_num_bytes(a)) == 0);
+}
+
+/*
+ * Sets the min_width of a block whose min_width was given as a string to the
+ * width of that string. This is done only for new or changed blocks, see
+ * merge_statusline().
+ *
+ */
+static void measure_min_width(struct status_block *block) {
+    if (block->min_width_str == NULL)
+        return;
+
+    i3String *text = i3string_from_utf8(block->min_width_str);
+    i3string_set_markup(text, block->pango_markup);
+    block->min_width = (uint32_t)predict_text_width(text);
+    i3string_free(text);
+}
+
+/*
+ * Returns true if both status blocks are rendered identically, that is, they
+ * have the same name, instance, texts and attributes.
+ *
+ */
+static bool status_blocks_equal(struct status_block *a, struct status_block *b) {
+    return (strings_equal(a->name, b->name) &&
+            strings_equal(a->instance, b->instance) &&
+            i3strings_equal(a->full_text, b->full_text) &&
+            i3strings_equal(a->short_text, b->short_text) &&
+            strings_equal(a->color, b->color) &&
+            strings_equal(a->background, b->background) &&
+            strings_equal(a->border, b->border) &&
+            strings_equal(a->min_width_str, b->min_width_str) &&
+            (a->min_width_str != NULL || a->min_width == b->min_width) &&
+            a->align == b->align &&
+            a->urgent == b->urgent &&
+            a->no_separator == b->no_separator &&
+            a->border_top == b->border_top &&
+            a->border_right == b->border_right &&
+            a->border_bottom == b->border_bottom &&
+            a->border_left == b->border_left &&
+            a->pango_markup == b->pango_markup &&
+            a->sep_block_width == b->sep_block_width);
+}
+
 /*
  * Replaces the statusline in memory with an error message. Pass a format
  * string and format parameters as you would in `printf'. The next time
@@ -104,7 +378,8 @@ static void copy_statusline(struct statusline_head *from, struct statusline_head
  * the space allocated for the statusline.
  */
 __attribute__((format(printf, 1, 2))) static void set_statusline_error(const char *format, ...) {
-    clear_statusline(&statusline_head, true);
+    clear_statusline(&statusline_head);
+    statusline_generation++;
 
     char *message;
     va_list args;
@@ -133,6 +408,57 @@ finish:
     va_end(args);
 }
 
+static void clear_shared_updates(void) {
+    shared_update *update;
+    while ((update = TAILQ_FIRST(&shared_updates)) != NULL) {
+        TAILQ_REMOVE(&shared_updates, update, updates);
+        FREE(update->name);
+        FREE(update->instance);
+        FREE(update->json);
+        free(update);
+    }
+}
+
+static void remove_subscriber(status_subscriber *subscriber) {
+    ev_io_stop(main_loop, subscriber->io);
+    FREE(subscriber->io);
+    close(subscriber->fd);
+    FREE(subscriber->clicks);
+    TAILQ_REMOVE(&subscribers, subscriber, subscribers);
+    free(subscriber);
+}
+
+/*
+ * Disconnects from the shared status command, or, if we run it, stops
+ * listening for and disconnects all subscribers.
+ *
+ */
+static void stop_sharing(void) {
+    if (shared_listen_io != NULL) {
+        ev_io_stop(main_loop, shared_listen_io);
+        close(shared_listen_io->fd);
+        FREE(shared_listen_io);
+        unlink(shared_path);
+    }
+
+    while (!TAILQ_EMPTY(&subscribers))
+        remove_subscriber(TAILQ_FIRST(&subscribers));
+
+    if (following) {
+        close(stdin_fd);
+        following = false;
+    }
+
+    FREE(shared_path);
+    FREE(shared_header);
+    shared_header_len = 0;
+    shared_output_started = false;
+    FREE(shared_stream.line);
+    FREE(shared_stream.last_line);
+    memset(&shared_stream, 0, sizeof(shared_stream));
+    clear_shared_updates();
+}
+
 /*
  * Stop and free() the stdin- and SIGCHLD-watchers
  *
@@ -148,17 +474,28 @@ static void cleanup(void) {
         FREE(child_sig);
     }
 
+    ev_timer_stop(main_loop, &redraw_timer);
+    reset_status_parser();
+
+    FREE(stdin_buffer);
+    stdin_buffer_size = 0;
+    stdin_buffer_len = 0;
+
+    stop_sharing();
+
     memset(&child, 0, sizeof(i3bar_child));
 }
 
 /*
  * The start of a new array is the start of a new status line, so we clear all
- * previous entries from the buffer.
+ * previous entries from the buffer (there are only leftovers of a status line
+ * which could not be parsed completely).
  */
 static int stdin_start_array(void *context) {
-    // the blocks are still used by statusline_head, so we won't free the
-    // resources here.
-    clear_statusline(&statusline_buffer, false);
+    parser_ctx *ctx = context;
+    ctx->depth++;
+    ctx->has_urgent = false;
+    clear_statusline(&(ctx->line));
     return 1;
 }
 
@@ -168,13 +505,11 @@ static int stdin_start_array(void *context) {
  */
 static int stdin_start_map(void *context) {
     parser_ctx *ctx = context;
+    ctx->depth++;
     memset(&(ctx->block), '\0', sizeof(struct status_block));
 
     /* Default width of the separator block. */
-    if (config.separator_symbol == NULL)
-        ctx->block.sep_block_width = logical_px(9);
-    else
-        ctx->block.sep_block_width = logical_px(8) + separator_symbol_width;
+    ctx->block.sep_block_width = ctx->sep_block_width;
 
     /* By default we draw all four borders if a border is set. */
     ctx->block.border_top = 1;
@@ -288,13 +623,76 @@ static int stdin_integer(void *context, long long val) {
     return 1;
 }
 
+/*
+ * Hands an update to the main thread, unless the status command was restarted
+ * in the meantime.
+ *
+ */
+static void queue_status_update(parser_ctx *ctx, status_update *update) {
+    update->stream = ctx->stream;
+
+    pthread_mutex_lock(&status_lock);
+    const bool current = (update->stream == status_stream);
+    if (current)
+        TAILQ_INSERT_TAIL(&status_updates, update, updates);
+    pthread_mutex_unlock(&status_lock);
+
+    if (!current) {
+        free_status_update(update);
+        return;
+    }
+    ev_async_send(main_loop, &status_async);
+}
+
+static status_update *new_status_update(void) {
+    status_update *update = scalloc(1, sizeof(status_update));
+    TAILQ_INIT(&(update->blocks));
+    return update;
+}
+
+/*
+ * With partial_updates enabled in the header, the status command can send
+ * single blocks in between status lines. Such a block replaces the block with
+ * the same name and instance in the current status line.
+ *
+ */
+static void update_status_block(struct status_block *new) {
+    struct status_block *old;
+    TAILQ_FOREACH(old, &statusline_head, blocks) {
+        if (old->name != NULL &&
+            strings_equal(old->name, new->name) &&
+            strings_equal(old->instance, new->instance))
+            break;
+    }
+
+    if (old == NULL) {
+        DLOG("No block with name = %s, instance = %s to update\n", new->name, new->instance);
+        recycle_status_block(new);
+        return;
+    }
+
+    if (status_blocks_equal(old, new)) {
+        recycle_status_block(new);
+        return;
+    }
+
+    measure_min_width(new);
+    TAILQ_INSERT_BEFORE(old, new, blocks);
+    TAILQ_REMOVE(&statusline_head, old, blocks);
+    recycle_status_block(old);
+    statusline_changed = true;
+    statusline_generation++;
+}
+
 /*
  * When a map is finished, we have an entire status block.
- * Move it from the parser's context to the statusline buffer.
+ * Move it from the parser's context to the status line being read, or hand it
+ * to the main thread if it is a single block update.
  */
 static int stdin_end_map(void *context) {
     parser_ctx *ctx = context;
-    struct status_block *new_block = smalloc(sizeof(struct status_block));
+    ctx->depth--;
+    struct status_block *new_block = new_status_block();
     memcpy(new_block, &(ctx->block), sizeof(struct status_block));
     /* Ensure we have a full_text set, so that when it is missing (or null),
      * i3bar doesn’t crash and the user gets an annoying message. */
@@ -303,30 +701,80 @@ static int stdin_end_map(void *context) {
     if (new_block->urgent)
         ctx->has_urgent = true;
 
-    if (new_block->min_width_str) {
-        i3String *text = i3string_from_utf8(new_block->min_width_str);
-        i3string_set_markup(text, new_block->pango_markup);
-        new_block->min_width = (uint32_t)predict_text_width(text);
-        i3string_free(text);
-    }
-
     i3string_set_markup(new_block->full_text, new_block->pango_markup);
 
     if (new_block->short_text != NULL)
         i3string_set_markup(new_block->short_text, new_block->pango_markup);
 
-    TAILQ_INSERT_TAIL(&statusline_buffer, new_block, blocks);
+    if (ctx->depth == 1 && ctx->partial_updates) {
+        status_update *update = new_status_update();
+        update->has_urgent = new_block->urgent;
+        TAILQ_INSERT_TAIL(&(update->blocks), new_block, blocks);
+        queue_status_update(ctx, update);
+        return 1;
+    }
+
+    TAILQ_INSERT_TAIL(&(ctx->line), new_block, blocks);
     return 1;
 }
 
 /*
- * When an array is finished, we have an entire statusline.
- * Copy it from the buffer to the actual statusline.
+ * When an array is finished, we have an entire statusline, which is handed
+ * to the main thread, see merge_statusline().
  */
 static int stdin_end_array(void *context) {
-    DLOG("copying statusline_buffer to statusline_head\n");
-    clear_statusline(&statusline_head, true);
-    copy_statusline(&statusline_buffer, &statusline_head);
+    parser_ctx *ctx = context;
+    ctx->depth--;
+    status_update *update = new_status_update();
+    update->is_line = true;
+    update->has_urgent = ctx->has_urgent;
+    move_statusline(&(update->blocks), &(ctx->line));
+    queue_status_update(ctx, update);
+    return 1;
+}
+
+/*
+ * Moves a new status line to the actual statusline. Blocks which did not
+ * change keep their old copy, including its measured width, so that e.g.
+ * only the clock needs to be measured again every second.
+ */
+static void merge_statusline(struct statusline_head *line) {
+    DLOG("merging the new status line into statusline_head\n");
+    struct status_block *old = TAILQ_FIRST(&statusline_head);
+    struct status_block *new;
+    while ((new = TAILQ_FIRST(line)) != NULL) {
+        TAILQ_REMOVE(line, new, blocks);
+        if (old != NULL && status_blocks_equal(old, new)) {
+            recycle_status_block(new);
+            old = TAILQ_NEXT(old, blocks);
+            continue;
+        }
+
+        statusline_changed = true;
+        measure_min_width(new);
+        if (old == NULL) {
+            TAILQ_INSERT_TAIL(&statusline_head, new, blocks);
+            continue;
+        }
+
+        TAILQ_INSERT_BEFORE(old, new, blocks);
+        struct status_block *next = TAILQ_NEXT(old, blocks);
+        TAILQ_REMOVE(&statusline_head, old, blocks);
+        recycle_status_block(old);
+        old = next;
+    }
+
+    /* The new status line has fewer blocks than the old one. */
+    while (old != NULL) {
+        struct status_block *next = TAILQ_NEXT(old, blocks);
+        TAILQ_REMOVE(&statusline_head, old, blocks);
+        recycle_status_block(old);
+        old = next;
+        statusline_changed = true;
+    }
+
+    if (statusline_changed)
+        statusline_generation++;
 
     DLOG("dumping statusline:\n");
     struct status_block *current;
@@ -336,89 +784,605 @@ static int stdin_end_array(void *context) {
         DLOG("color = %s\n", current->color);
     }
     DLOG("end of dump\n");
-    return 1;
 }
 
 /*
- * Helper function to read stdin
+ * Helper function to read stdin. Everything which is available is appended to
+ * stdin_buffer, which grows geometrically and is reused across reads. Callers
+ * consume the data and reset stdin_buffer_len, except for an incomplete line
+ * of plain text input, which is kept for the next read.
  *
- * Returns NULL on EOF.
+ * Returns NULL on EOF or if nothing could be read.
  *
  */
 static unsigned char *get_buffer(ev_io *watcher, int *ret_buffer_len) {
     int fd = watcher->fd;
     int n = 0;
     int rec = 0;
-    int buffer_len = STDIN_CHUNK_SIZE;
-    unsigned char *buffer = smalloc(buffer_len + 1);
-    buffer[0] = '\0';
     while (1) {
-        n = read(fd, buffer + rec, buffer_len - rec);
+        if (stdin_buffer_len == stdin_buffer_size) {
+            stdin_buffer_size = (stdin_buffer_size == 0 ? STDIN_CHUNK_SIZE : 2 * stdin_buffer_size);
+            /* One more byte so that read_flat_input() can always terminate
+             * the string. */
+            stdin_buffer = srealloc(stdin_buffer, stdin_buffer_size + 1);
+        }
+        n = read(fd, stdin_buffer + stdin_buffer_len, stdin_buffer_size - stdin_buffer_len);
         if (n == -1) {
             if (errno == EAGAIN) {
                 /* finish up */
                 break;
             }
             ELOG("read() failed!: %s\n", strerror(errno));
-            FREE(buffer);
-            exit(EXIT_FAILURE);
+            /* A connection reset by the i3bar we follow is handled like
+             * EOF. */
+            if (!following)
+                exit(EXIT_FAILURE);
         }
-        if (n == 0) {
+        if (n <= 0) {
             ELOG("stdin: received EOF\n");
-            FREE(buffer);
             *ret_buffer_len = -1;
+            if (following) {
+                /* The i3bar which ran the shared status command went away,
+                 * so we connect to whichever bar takes over (or take over
+                 * ourselves). */
+                char *command = shared_command;
+                shared_command = NULL;
+                cleanup();
+                clear_statusline(&statusline_head);
+                start_child(command);
+                free(command);
+            }
             return NULL;
         }
+        stdin_buffer_len += n;
         rec += n;
-
-        if (rec == buffer_len) {
-            buffer_len += STDIN_CHUNK_SIZE;
-            buffer = srealloc(buffer, buffer_len);
-        }
     }
-    if (*buffer == '\0') {
-        FREE(buffer);
-        rec = -1;
+    if (rec == 0) {
+        *ret_buffer_len = -1;
+        return NULL;
     }
-    *ret_buffer_len = rec;
-    return buffer;
+    *ret_buffer_len = stdin_buffer_len;
+    return stdin_buffer;
 }
 
-static void read_flat_input(char *buffer, int length) {
+/*
+ * Returns the length of buffer up to and including its last newline.
+ *
+ */
+static int complete_lines_length(const unsigned char *buffer, int length) {
+    while (length > 0 && buffer[length - 1] != '\n')
+        length--;
+    return length;
+}
+
+/*
+ * Displays the last complete line of plain text input. An incomplete line at
+ * the end of the buffer is moved to its beginning to be completed by the next
+ * read. Returns false if there was no complete line yet.
+ *
+ */
+static bool read_flat_input(char *buffer, int length) {
+    char *line_end = buffer + complete_lines_length((unsigned char *)buffer, length);
+    if (line_end == buffer)
+        return false;
+    line_end--;
+
+    /* The last complete line starts after the preceding newline, if any. */
+    char *line = line_end;
+    while (line > buffer && line[-1] != '\n')
+        line--;
+
+    *line_end = '\0';
+    if (line_end > line && line_end[-1] == '\r')
+        line_end[-1] = '\0';
+
     struct status_block *first = TAILQ_FIRST(&statusline_head);
     /* Clear the old buffer if any. */
     I3STRING_FREE(first->full_text);
-    /* Remove the trailing newline and terminate the string at the same
-     * time. */
-    if (buffer[length - 1] == '\n' || buffer[length - 1] == '\r') {
-        buffer[length - 1] = '\0';
-    } else {
-        buffer[length] = '\0';
+    first->full_text = i3string_from_utf8(line);
+    first->full_render.valid = false;
+    statusline_generation++;
+
+    int remaining = length - (line_end + 1 - buffer);
+    memmove(buffer, line_end + 1, remaining);
+    stdin_buffer_len = remaining;
+    return true;
+}
+
+static void read_json_input(parser_ctx *ctx, unsigned char *input, int length) {
+    yajl_status status = yajl_parse(ctx->parser, input, length);
+    if (status == yajl_status_ok)
+        return;
+
+    char *message = (char *)yajl_get_error(ctx->parser, 0, input, length);
+
+    /* strip the newline yajl adds to the error message */
+    if (message[strlen(message) - 1] == '\n')
+        message[strlen(message) - 1] = '\0';
+
+    fprintf(stderr, "[i3bar] Could not parse JSON input (code = %d, message = %s): %.*s\n",
+            status, message, length, input);
+
+    status_update *update = new_status_update();
+    update->error = sstrdup(message);
+    yajl_free_error(ctx->parser, (unsigned char *)message);
+    queue_status_update(ctx, update);
+}
+
+static yajl_callbacks status_callbacks = {
+    .yajl_boolean = stdin_boolean,
+    .yajl_integer = stdin_integer,
+    .yajl_string = stdin_string,
+    .yajl_start_map = stdin_start_map,
+    .yajl_map_key = stdin_map_key,
+    .yajl_end_map = stdin_end_map,
+    .yajl_start_array = stdin_start_array,
+    .yajl_end_array = stdin_end_array,
+};
+
+/*
+ * The parser thread: waits for input from the main thread and parses it. The
+ * input buffer is swapped with a second one, so that the main thread can keep
+ * appending to it while we parse.
+ *
+ */
+static void *status_parser_thread(void *data) {
+    parser_ctx *ctx = &parser_context;
+    unsigned char *input = NULL;
+    size_t input_size = 0;
+
+    pthread_mutex_lock(&status_lock);
+    while (true) {
+        while (status_input_len == 0)
+            pthread_cond_wait(&status_input_cond, &status_lock);
+
+        unsigned char *buffer = status_input;
+        const size_t buffer_size = status_input_size;
+        const size_t length = status_input_len;
+        status_input = input;
+        status_input_size = input_size;
+        status_input_len = 0;
+        input = buffer;
+        input_size = buffer_size;
+
+        if (ctx->parser == NULL || ctx->stream != status_stream) {
+            if (ctx->parser != NULL)
+                yajl_free(ctx->parser);
+            ctx->parser = yajl_alloc(&status_callbacks, NULL, ctx);
+            ctx->stream = status_stream;
+            ctx->depth = 0;
+            clear_statusline(&(ctx->line));
+        }
+        ctx->sep_block_width = status_sep_block_width;
+        ctx->partial_updates = status_partial_updates;
+        pthread_mutex_unlock(&status_lock);
+
+        read_json_input(ctx, input, length);
+
+        pthread_mutex_lock(&status_lock);
+    }
+
+    return NULL;
+}
+
+/*
+ * Sends data to a subscriber of the shared status command. Subscribers which
+ * cannot keep up are disconnected (and will reconnect).
+ *
+ */
+static bool send_to_subscriber(status_subscriber *subscriber, const void *data, size_t length) {
+    if (length == 0)
+        return true;
+    if (writeall_nonblock(subscriber->fd, data, length) == (ssize_t)length)
+        return true;
+
+    ELOG("Could not send the status line to subscriber (fd %d), disconnecting it\n", subscriber->fd);
+    remove_subscriber(subscriber);
+    return false;
+}
+
+/*
+ * Brings subscribers which connected while the status command was running up
+ * to date, so that they can read its output from now on. This is only
+ * possible between two status lines.
+ *
+ */
+static void sync_subscribers(void) {
+    if (shared_stream.in_string || shared_stream.depth > 1)
+        return;
+
+    status_subscriber *subscriber, *next;
+    for (subscriber = TAILQ_FIRST(&subscribers); subscriber != NULL; subscriber = next) {
+        next = TAILQ_NEXT(subscriber, subscribers);
+        if (subscriber->synced)
+            continue;
+
+        subscriber->synced = true;
+        if (child.version == 0) {
+            if (shared_stream.last_line_len > 0 &&
+                send_to_subscriber(subscriber, shared_stream.last_line, shared_stream.last_line_len))
+                send_to_subscriber(subscriber, "\n", 1);
+            continue;
+        }
+
+        /* The header, the start of the endless array and the last status line
+         * make the following output of the status command valid JSON. */
+        if (!send_to_subscriber(subscriber, shared_header, shared_header_len) ||
+            !send_to_subscriber(subscriber, "\n", 1) ||
+            shared_stream.depth == 0)
+            continue;
+        if (!send_to_subscriber(subscriber, "[\n", 2) ||
+            !send_to_subscriber(subscriber, shared_stream.last_line, shared_stream.last_line_len))
+            continue;
+        if (shared_stream.last_line_len > 0) {
+            bool sent = true;
+            shared_update *update;
+            TAILQ_FOREACH(update, &shared_updates, updates) {
+                if (!(sent = send_to_subscriber(subscriber, ",", 1) &&
+                             send_to_subscriber(subscriber, update->json, update->json_len)))
+                    break;
+            }
+            if (!sent)
+                continue;
+        }
+        if (shared_stream.comma_pending)
+            send_to_subscriber(subscriber, ",", 1);
+    }
+}
+
+/* Context for finding the name and instance of a block update. */
+struct update_ctx {
+    int depth;
+    char **value;
+    shared_update *update;
+};
+
+static int update_start(void *context) {
+    struct update_ctx *ctx = context;
+    ctx->depth++;
+    return 1;
+}
+
+static int update_end(void *context) {
+    struct update_ctx *ctx = context;
+    ctx->depth--;
+    return 1;
+}
+
+static int update_map_key(void *context, const unsigned char *key, size_t len) {
+    struct update_ctx *ctx = context;
+    ctx->value = NULL;
+    if (ctx->depth != 1)
+        return 1;
+    if (len == strlen("name") && !strncmp((const char *)key, "name", len))
+        ctx->value = &(ctx->update->name);
+    else if (len == strlen("instance") && !strncmp((const char *)key, "instance", len))
+        ctx->value = &(ctx->update->instance);
+    return 1;
+}
+
+static int update_string(void *context, const unsigned char *val, size_t len) {
+    struct update_ctx *ctx = context;
+    if (ctx->value != NULL) {
+        FREE(*(ctx->value));
+        sasprintf(ctx->value, "%.*s", len, val);
+    }
+    return 1;
+}
+
+/*
+ * Keeps the single block update read so far, replacing an earlier update of
+ * the same block, so that it can be sent to subscribers together with the
+ * last complete status line.
+ *
+ */
+static void keep_update(void) {
+    static yajl_callbacks callbacks = {
+        .yajl_start_map = update_start,
+        .yajl_end_map = update_end,
+        .yajl_start_array = update_start,
+        .yajl_end_array = update_end,
+        .yajl_map_key = update_map_key,
+        .yajl_string = update_string,
+    };
+    shared_update *new = scalloc(1, sizeof(shared_update));
+    struct update_ctx ctx = {.update = new};
+    yajl_handle handle = yajl_alloc(&callbacks, NULL, &ctx);
+    yajl_status state = yajl_parse(handle, (const unsigned char *)shared_stream.line, shared_stream.line_len);
+    if (state == yajl_status_ok)
+        state = yajl_complete_parse(handle);
+    yajl_free(handle);
+
+    /* i3bar ignores updates without a name, see update_status_block(). */
+    if (state != yajl_status_ok || new->name == NULL) {
+        shared_stream.line_len = 0;
+        FREE(new->name);
+        FREE(new->instance);
+        free(new);
+        return;
+    }
+
+    new->json = smalloc(shared_stream.line_len);
+    memcpy(new->json, shared_stream.line, shared_stream.line_len);
+    new->json_len = shared_stream.line_len;
+    shared_stream.line_len = 0;
+
+    shared_update *update;
+    TAILQ_FOREACH(update, &shared_updates, updates) {
+        if (strings_equal(update->name, new->name) &&
+            strings_equal(update->instance, new->instance))
+            break;
     }
+    if (update == NULL) {
+        TAILQ_INSERT_TAIL(&shared_updates, new, updates);
+        return;
+    }
+
+    TAILQ_INSERT_BEFORE(update, new, updates);
+    TAILQ_REMOVE(&shared_updates, update, updates);
+    FREE(update->name);
+    FREE(update->instance);
+    FREE(update->json);
+    free(update);
+}
+
+/*
+ * Makes the line read so far the last complete line.
+ *
+ */
+static void keep_line(void) {
+    char *last_line = shared_stream.last_line;
+    size_t last_line_size = shared_stream.last_line_size;
+    shared_stream.last_line = shared_stream.line;
+    shared_stream.last_line_len = shared_stream.line_len;
+    shared_stream.last_line_size = shared_stream.line_size;
+    shared_stream.line = last_line;
+    shared_stream.line_len = 0;
+    shared_stream.line_size = last_line_size;
+}
 
-    first->full_text = i3string_from_utf8(buffer);
+static void append_to_line(char c) {
+    if (shared_stream.line_len == shared_stream.line_size) {
+        shared_stream.line_size = (shared_stream.line_size == 0 ? STDIN_CHUNK_SIZE : 2 * shared_stream.line_size);
+        shared_stream.line = srealloc(shared_stream.line, shared_stream.line_size);
+    }
+    shared_stream.line[shared_stream.line_len++] = c;
 }
 
-static bool read_json_input(unsigned char *input, int length) {
-    yajl_status status = yajl_parse(parser, input, length);
+/*
+ * Follows the JSON output of the status command (after the header) to know
+ * where status lines end and to keep a copy of the last one, see
+ * sync_subscribers().
+ *
+ */
+static void scan_json_output(const unsigned char *data, int length) {
+    for (int i = 0; i < length; i++) {
+        char c = data[i];
+        if (shared_stream.in_string) {
+            append_to_line(c);
+            if (shared_stream.escaped)
+                shared_stream.escaped = false;
+            else if (c == '\\')
+                shared_stream.escaped = true;
+            else if (c == '"')
+                shared_stream.in_string = false;
+            continue;
+        }
+
+        bool in_line = (shared_stream.depth >= 2);
+        switch (c) {
+            case '"':
+                shared_stream.in_string = true;
+                break;
+            case '[':
+            case '{':
+                if (++shared_stream.depth == 2) {
+                    shared_stream.line_len = 0;
+                    shared_stream.line_is_update = (c == '{');
+                }
+                break;
+            case ']':
+            case '}':
+                shared_stream.depth--;
+                break;
+            case ',':
+                if (shared_stream.depth == 1)
+                    shared_stream.comma_pending = true;
+                break;
+        }
+
+        if (in_line || shared_stream.depth >= 2)
+            append_to_line(c);
+
+        if (in_line && shared_stream.depth == 1) {
+            if (shared_stream.line_is_update) {
+                keep_update();
+            } else {
+                keep_line();
+                clear_shared_updates();
+            }
+            shared_stream.comma_pending = false;
+        }
+    }
+}
+
+static void forward_to_subscribers(const unsigned char *data, int length) {
+    status_subscriber *subscriber, *next;
+    for (subscriber = TAILQ_FIRST(&subscribers); subscriber != NULL; subscriber = next) {
+        next = TAILQ_NEXT(subscriber, subscribers);
+        if (subscriber->synced)
+            send_to_subscriber(subscriber, data, length);
+    }
+}
+
+/*
+ * Forwards output of the shared status command to the subscribers. For plain
+ * text, data must end with a complete line.
+ *
+ */
+static void share_status_output(const unsigned char *data, int length) {
+    forward_to_subscribers(data, length);
+
+    if (child.version > 0) {
+        scan_json_output(data, length);
+    } else if (length > 0) {
+        /* Keep the last line, without its newline. */
+        int start = length - 1;
+        while (start > 0 && data[start - 1] != '\n')
+            start--;
+        shared_stream.line_len = 0;
+        for (int i = start; i < length - 1; i++)
+            append_to_line(data[i]);
+        keep_line();
+    }
+
+    sync_subscribers();
+}
+
+static void redraw_statusline(bool has_urgent) {
+    last_statusline_redraw = ev_now(main_loop);
+    draw_bars(has_urgent);
+}
+
+static void redraw_timer_cb(struct ev_loop *loop, ev_timer *watcher, int revents) {
+    bool has_urgent = redraw_has_urgent;
+    redraw_has_urgent = false;
+    redraw_statusline(has_urgent);
+}
+
+/*
+ * Redraws the bars for a new status line. With status_redraw_interval set,
+ * redraws happen at most once per interval: a status line arriving earlier
+ * only (re)arms a timer, and the timer draws whatever status line is current
+ * by then.
+ *
+ */
+static void schedule_statusline_redraw(bool has_urgent) {
+    if (config.status_redraw_interval <= 0) {
+        draw_bars(has_urgent);
+        return;
+    }
+
+    if (ev_is_active(&redraw_timer)) {
+        redraw_has_urgent |= has_urgent;
+        return;
+    }
+
+    ev_tstamp interval = config.status_redraw_interval / 1000.0;
+    ev_tstamp elapsed = ev_now(main_loop) - last_statusline_redraw;
+    if (elapsed >= interval) {
+        redraw_statusline(has_urgent);
+        return;
+    }
+
+    redraw_has_urgent = has_urgent;
+    ev_timer_init(&redraw_timer, &redraw_timer_cb, interval - elapsed, 0.);
+    ev_timer_start(main_loop, &redraw_timer);
+}
+
+/*
+ * Applies the status lines and single block updates of the parser thread.
+ * Only the last complete status line (or parse error) matters, so the updates
+ * before it are dropped if the parser thread got ahead of us.
+ *
+ */
+static void status_async_cb(struct ev_loop *loop, ev_async *watcher, int revents) {
+    struct status_updates_head updates = TAILQ_HEAD_INITIALIZER(updates);
+    status_update *update;
+
+    pthread_mutex_lock(&status_lock);
+    while ((update = TAILQ_FIRST(&status_updates)) != NULL) {
+        TAILQ_REMOVE(&status_updates, update, updates);
+        TAILQ_INSERT_TAIL(&updates, update, updates);
+    }
+    pthread_mutex_unlock(&status_lock);
+
+    status_update *last_line = NULL;
+    TAILQ_FOREACH(update, &updates, updates) {
+        if (update->is_line || update->error != NULL)
+            last_line = update;
+    }
+
+    statusline_changed = false;
     bool has_urgent = false;
-    if (status != yajl_status_ok) {
-        char *message = (char *)yajl_get_error(parser, 0, input, length);
+    bool superseded = (last_line != NULL);
+    while ((update = TAILQ_FIRST(&updates)) != NULL) {
+        TAILQ_REMOVE(&updates, update, updates);
+        if (update == last_line)
+            superseded = false;
+
+        if (!superseded && update->stream == status_stream) {
+            if (update->error != NULL) {
+                set_statusline_error("Could not parse JSON (%s)", update->error);
+                statusline_changed = true;
+            } else if (update->is_line) {
+                merge_statusline(&(update->blocks));
+            } else {
+                struct status_block *block = TAILQ_FIRST(&(update->blocks));
+                TAILQ_REMOVE(&(update->blocks), block, blocks);
+                update_status_block(block);
+            }
+            has_urgent |= update->has_urgent;
+        }
+        free_status_update(update);
+    }
 
-        /* strip the newline yajl adds to the error message */
-        if (message[strlen(message) - 1] == '\n')
-            message[strlen(message) - 1] = '\0';
+    /* Status commands typically print their whole status line every second
+     * or so, even if only the clock (or nothing at all) changed. */
+    if (statusline_changed)
+        schedule_statusline_redraw(has_urgent);
+}
+
+static void start_status_parser_thread(void) {
+    ev_async_init(&status_async, &status_async_cb);
+    ev_async_start(main_loop, &status_async);
+
+    /* Signals are handled by the main thread. */
+    sigset_t all_signals;
+    sigset_t old_signals;
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_SETMASK, &all_signals, &old_signals);
 
-        fprintf(stderr, "[i3bar] Could not parse JSON input (code = %d, message = %s): %.*s\n",
-                status, message, length, input);
+    pthread_t thread;
+    int ret = pthread_create(&thread, NULL, status_parser_thread, NULL);
+    if (ret != 0)
+        errx(EXIT_FAILURE, "Could not create the status parser thread: %s", strerror(ret));
+    pthread_detach(thread);
 
-        set_statusline_error("Could not parse JSON (%s)", message);
-        yajl_free_error(parser, (unsigned char *)message);
-        draw_bars(false);
-    } else if (parser_context.has_urgent) {
-        has_urgent = true;
+    pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+    status_thread_started = true;
+}
+
+/*
+ * Hands JSON input of the status command to the parser thread. yajl keeps
+ * its own state across calls, so incomplete JSON does not need to be kept in
+ * our buffer.
+ *
+ */
+static void submit_json_input(const unsigned char *input, int length) {
+    if (length <= 0)
+        return;
+    if (!status_thread_started)
+        start_status_parser_thread();
+
+    pthread_mutex_lock(&status_lock);
+    if (status_input_len + length > status_input_size) {
+        while (status_input_len + length > status_input_size)
+            status_input_size = (status_input_size == 0 ? STDIN_CHUNK_SIZE : 2 * status_input_size);
+        status_input = srealloc(status_input, status_input_size);
     }
-    return has_urgent;
+    memcpy(status_input + status_input_len, input, length);
+    status_input_len += length;
+
+    /* Default width of the separator block. */
+    if (config.separator_symbol == NULL)
+        status_sep_block_width = logical_px(9);
+    else
+        status_sep_block_width = logical_px(8) + separator_symbol_width;
+    status_partial_updates = child.partial_updates;
+
+    pthread_cond_signal(&status_input_cond);
+    pthread_mutex_unlock(&status_lock);
 }
 
 /*
@@ -431,14 +1395,18 @@ static void stdin_io_cb(struct ev_loop *loop, ev_io *watcher, int revents) {
     unsigned char *buffer = get_buffer(watcher, &rec);
     if (buffer == NULL)
         return;
-    bool has_urgent = false;
     if (child.version > 0) {
-        has_urgent = read_json_input(buffer, rec);
-    } else {
-        read_flat_input((char *)buffer, rec);
+        if (shared_listen_io != NULL)
+            share_status_output(buffer, rec);
+        submit_json_input(buffer, rec);
+        stdin_buffer_len = 0;
+        return;
     }
-    free(buffer);
-    draw_bars(has_urgent);
+
+    if (shared_listen_io != NULL)
+        share_status_output(buffer, complete_lines_length(buffer, rec));
+    if (read_flat_input((char *)buffer, rec))
+        schedule_statusline_redraw(false);
 }
 
 /*
@@ -463,15 +1431,27 @@ static void stdin_io_first_line_cb(struct ev_loop *loop, ev_io *watcher, int rev
         if (config.hide_on_modifier) {
             stop_child();
         }
-        draw_bars(read_json_input(buffer + consumed, rec - consumed));
+        if (shared_listen_io != NULL) {
+            shared_header = smalloc(consumed);
+            memcpy(shared_header, buffer, consumed);
+            shared_header_len = consumed;
+            forward_to_subscribers(buffer, consumed);
+            share_status_output(buffer + consumed, rec - consumed);
+        }
+        submit_json_input(buffer + consumed, rec - consumed);
+        stdin_buffer_len = 0;
     } else {
         /* In case of plaintext, we just add a single block and change its
          * full_text pointer later. */
         struct status_block *new_block = scalloc(1, sizeof(struct status_block));
+        /* Stays empty until the first line is complete. */
+        new_block->full_text = i3string_from_utf8("");
         TAILQ_INSERT_TAIL(&statusline_head, new_block, blocks);
+        if (shared_listen_io != NULL)
+            share_status_output(buffer, complete_lines_length(buffer, rec));
         read_flat_input((char *)buffer, rec);
     }
-    free(buffer);
+    shared_output_started = true;
     ev_io_stop(main_loop, stdin_io);
     ev_io_init(stdin_io, &stdin_io_cb, stdin_fd, EV_READ);
     ev_io_start(main_loop, stdin_io);
@@ -526,6 +1506,160 @@ static void child_write_output(void) {
     }
 }
 
+static void child_click_events_initialize(void) {
+    if (!child.click_events_init) {
+        yajl_gen_array_open(gen);
+        child_write_output();
+        child.click_events_init = true;
+    }
+}
+
+/*
+ * Forwards a click event a subscriber sent us to the status command. The
+ * subscriber writes the same stream of click events it would write to a
+ * status command of its own, so we drop the opening bracket and the commas
+ * and let our generator insert them again.
+ *
+ */
+static void forward_click_event(char *line) {
+    while (*line == ' ' || *line == '\t' || *line == ',')
+        line++;
+    if (*line == '\0' || *line == '[' || !child.click_events)
+        return;
+
+    child_click_events_initialize();
+    /* yajl_gen_number() writes the string unchanged, which is what we need
+     * to pass on an already encoded map. */
+    yajl_gen_number(gen, line, strlen(line));
+    child_write_output();
+}
+
+static void subscriber_read_cb(struct ev_loop *loop, ev_io *watcher, int revents) {
+    status_subscriber *subscriber = watcher->data;
+    char buffer[STDIN_CHUNK_SIZE];
+    ssize_t n = read(subscriber->fd, buffer, sizeof(buffer));
+    if (n == -1 && (errno == EAGAIN || errno == EINTR))
+        return;
+    if (n <= 0) {
+        DLOG("Subscriber (fd %d) disconnected\n", subscriber->fd);
+        remove_subscriber(subscriber);
+        return;
+    }
+
+    subscriber->clicks = srealloc(subscriber->clicks, subscriber->clicks_len + n + 1);
+    memcpy(subscriber->clicks + subscriber->clicks_len, buffer, n);
+    subscriber->clicks_len += n;
+    subscriber->clicks[subscriber->clicks_len] = '\0';
+
+    char *line = subscriber->clicks;
+    char *newline;
+    while ((newline = strchr(line, '\n')) != NULL) {
+        *newline = '\0';
+        forward_click_event(line);
+        line = newline + 1;
+    }
+    subscriber->clicks_len = strlen(line);
+    memmove(subscriber->clicks, line, subscriber->clicks_len + 1);
+}
+
+static void shared_accept_cb(struct ev_loop *loop, ev_io *watcher, int revents) {
+    int fd = accept(watcher->fd, NULL, NULL);
+    if (fd == -1) {
+        if (errno != EAGAIN && errno != EINTR)
+            ELOG("accept(): %s\n", strerror(errno));
+        return;
+    }
+
+    (void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+
+    status_subscriber *subscriber = scalloc(1, sizeof(status_subscriber));
+    subscriber->fd = fd;
+    /* Before the status command printed anything, subscribers just get all
+     * of its output. */
+    subscriber->synced = !shared_output_started;
+    subscriber->io = smalloc(sizeof(ev_io));
+    subscriber->io->data = subscriber;
+    ev_io_init(subscriber->io, &subscriber_read_cb, fd, EV_READ);
+    ev_io_start(main_loop, subscriber->io);
+    TAILQ_INSERT_TAIL(&subscribers, subscriber, subscribers);
+    DLOG("New subscriber (fd %d) for the shared status command\n", fd);
+
+    sync_subscribers();
+}
+
+static bool fill_shared_address(struct sockaddr_un *addr) {
+    memset(addr, 0, sizeof(struct sockaddr_un));
+    addr->sun_family = AF_LOCAL;
+    if (strlen(shared_path) >= sizeof(addr->sun_path)) {
+        ELOG("Socket path %s for the shared status command is too long\n", shared_path);
+        return false;
+    }
+    strncpy(addr->sun_path, shared_path, sizeof(addr->sun_path) - 1);
+    return true;
+}
+
+/*
+ * Connects to the i3bar which runs the shared status command, if any. Its
+ * output is then read like the output of a status command of our own.
+ *
+ */
+static bool follow_shared_status(void) {
+    struct sockaddr_un addr;
+    if (!fill_shared_address(&addr))
+        return false;
+
+    int fd = socket(AF_LOCAL, SOCK_STREAM, 0);
+    if (fd == -1) {
+        ELOG("socket(): %s\n", strerror(errno));
+        return false;
+    }
+    (void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    if (connect(fd, (const struct sockaddr *)&addr, sizeof(struct sockaddr_un)) < 0) {
+        close(fd);
+        return false;
+    }
+
+    DLOG("Following the shared status command on %s\n", shared_path);
+    following = true;
+    stdin_fd = fd;
+    child_stdin = fd;
+    return true;
+}
+
+/*
+ * Listens for other bars which want to share our status command.
+ *
+ */
+static bool listen_shared_status(void) {
+    struct sockaddr_un addr;
+    if (!fill_shared_address(&addr))
+        return false;
+
+    int fd = socket(AF_LOCAL, SOCK_STREAM, 0);
+    if (fd == -1) {
+        ELOG("socket(): %s\n", strerror(errno));
+        return false;
+    }
+    (void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    /* Nobody accepted our connection, so the socket is a leftover. */
+    unlink(shared_path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(struct sockaddr_un)) < 0 ||
+        listen(fd, 5) < 0) {
+        ELOG("Could not listen on %s: %s\n", shared_path, strerror(errno));
+        close(fd);
+        return false;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+
+    shared_listen_io = smalloc(sizeof(ev_io));
+    ev_io_init(shared_listen_io, &shared_accept_cb, fd, EV_READ);
+    ev_io_start(main_loop, shared_listen_io);
+    return true;
+}
+
 /*
  * Start a child process with the specified command and reroute stdin.
  * We actually start a $SHELL to execute the command so we don't have to care
@@ -539,21 +1673,33 @@ void start_child(char *command) {
     if (command == NULL)
         return;
 
-    /* Allocate a yajl parser which will be used to parse stdin. */
-    static yajl_callbacks callbacks = {
-        .yajl_boolean = stdin_boolean,
-        .yajl_integer = stdin_integer,
-        .yajl_string = stdin_string,
-        .yajl_start_map = stdin_start_map,
-        .yajl_map_key = stdin_map_key,
-        .yajl_end_map = stdin_end_map,
-        .yajl_start_array = stdin_start_array,
-        .yajl_end_array = stdin_end_array,
-    };
-    parser = yajl_alloc(&callbacks, NULL, &parser_context);
-
     gen = yajl_gen_alloc(NULL);
 
+    if (config.share_status_command) {
+        /* Bars of other i3 instances must not share with us, so the socket
+         * is named after the i3 IPC socket. */
+        uint32_t hash = 2166136261u;
+        for (const char *c = command; *c != '\0'; c++)
+            hash = (hash ^ (unsigned char)*c) * 16777619u;
+        sasprintf(&shared_path, "%s.status-%08x", sock_path, hash);
+        FREE(shared_command);
+        shared_command = sstrdup(command);
+
+        /* Writing to a subscriber which went away must not kill us. */
+        signal(SIGPIPE, SIG_IGN);
+
+        if (follow_shared_status()) {
+            fcntl(stdin_fd, F_SETFL, O_NONBLOCK);
+            stdin_io = smalloc(sizeof(ev_io));
+            ev_io_init(stdin_io, &stdin_io_first_line_cb, stdin_fd, EV_READ);
+            ev_io_start(main_loop, stdin_io);
+            return;
+        }
+
+        if (!listen_shared_status())
+            FREE(shared_path);
+    }
+
     int pipe_in[2];  /* pipe we read from */
     int pipe_out[2]; /* pipe we write to */
 
@@ -576,6 +1722,8 @@ void start_child(char *command) {
             dup2(pipe_in[1], STDOUT_FILENO);
             dup2(pipe_out[0], STDIN_FILENO);
 
+            signal(SIGPIPE, SIG_DFL);
+
             setpgid(child.pid, 0);
             execl(_PATH_BSHELL, _PATH_BSHELL, "-c", command, (char *)NULL);
             return;
@@ -606,14 +1754,6 @@ void start_child(char *command) {
     atexit(kill_child_at_exit);
 }
 
-static void child_click_events_initialize(void) {
-    if (!child.click_events_init) {
-        yajl_gen_array_open(gen);
-        child_write_output();
-        child.click_events_init = true;
-    }
-}
-
 /*
  * Generates a click event, if enabled.
  *
@@ -690,6 +1830,9 @@ void kill_child_at_exit(void) {
             killpg(child.pid, child.cont_signal);
         killpg(child.pid, SIGTERM);
     }
+
+    if (shared_listen_io != NULL)
+        unlink(shared_path);
 }
 
 /*
@@ -705,6 +1848,8 @@ void kill_child(void) {
         int status;
         waitpid(child.pid, &status, 0);
         cleanup();
+    } else if (following) {
+        cleanup();
     }
 }
 
@@ -713,7 +1858,11 @@ void kill_child(void) {
  *
  */
 void stop_child(void) {
-    if (child.stop_signal > 0 && !child.stopped) {
+    /* Other bars may still display the output of a shared status command. */
+    if (!TAILQ_EMPTY(&subscribers))
+        return;
+
+    if (child.pid > 0 && child.stop_signal > 0 && !child.stopped) {
         child.stopped = true;
         killpg(child.pid, child.stop_signal);
     }
@@ -724,7 +1873,7 @@ void stop_child(void) {
  *
  */
 void cont_child(void) {
-    if (child.cont_signal > 0 && child.stopped) {
+    if (child.pid > 0 && child.cont_signal > 0 && child.stopped) {
         child.stopped = false;
         killpg(child.pid, child.cont_signal);
     }
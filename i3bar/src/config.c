@@ -22,6 +22,9 @@
 static char *cur_key;
 static bool parsing_bindings;
 static bool parsing_tray_outputs;
+/* Set while parsing only the mode and hidden_state, see
+ * parse_config_visibility_json(). */
+static bool visibility_only;
 
 /*
  * Parse a key.
@@ -76,6 +79,9 @@ static int config_string_cb(void *params_, const unsigned char *val, size_t _len
     if (!strcmp(cur_key, "id") || !strcmp(cur_key, "socket_path"))
         return 1;
 
+    if (visibility_only && strcmp(cur_key, "mode") != 0 && strcmp(cur_key, "hidden_state") != 0)
+        return 1;
+
     if (parsing_bindings) {
         if (strcmp(cur_key, "command") == 0) {
             binding_t *binding = TAILQ_LAST(&(config.bindings), bindings_head);
@@ -265,6 +271,9 @@ static int config_string_cb(void *params_, const unsigned char *val, size_t _len
  *
  */
 static int config_boolean_cb(void *params_, int val) {
+    if (visibility_only)
+        return 1;
+
     if (parsing_bindings) {
         if (strcmp(cur_key, "release") == 0) {
             binding_t *binding = TAILQ_LAST(&(config.bindings), bindings_head);
@@ -304,6 +313,12 @@ static int config_boolean_cb(void *params_, int val) {
         return 1;
     }
 
+    if (!strcmp(cur_key, "share_status_command")) {
+        DLOG("share_status_command = %d\n", val);
+        config.share_status_command = val;
+        return 1;
+    }
+
     if (!strcmp(cur_key, "verbose")) {
         if (!config.verbose) {
             DLOG("verbose = %d\n", val);
@@ -320,6 +335,9 @@ static int config_boolean_cb(void *params_, int val) {
  *
  */
 static int config_integer_cb(void *params_, long long val) {
+    if (visibility_only)
+        return 1;
+
     if (parsing_bindings) {
         if (strcmp(cur_key, "input_code") == 0) {
             binding_t *binding = scalloc(1, sizeof(binding_t));
@@ -339,6 +357,12 @@ static int config_integer_cb(void *params_, long long val) {
         return 1;
     }
 
+    if (!strcmp(cur_key, "status_redraw_interval")) {
+        DLOG("status_redraw_interval = %lld\n", val);
+        config.status_redraw_interval = val;
+        return 1;
+    }
+
     if (!strcmp(cur_key, "modifier")) {
         DLOG("modifier = %lld\n", val);
         config.modifier = (uint32_t)val;
@@ -386,6 +410,26 @@ void parse_config_json(char *json) {
     yajl_free(handle);
 }
 
+/*
+ * Parses only the mode and hidden_state of the received bar configuration and
+ * leaves the rest of the configuration alone.
+ *
+ */
+void parse_config_visibility_json(char *json) {
+    yajl_handle handle = yajl_alloc(&outputs_callbacks, NULL, NULL);
+
+    visibility_only = true;
+    yajl_status state = yajl_parse(handle, (const unsigned char *)json, strlen(json));
+    visibility_only = false;
+
+    if (state != yajl_status_ok) {
+        ELOG("Could not parse config reply!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    yajl_free(handle);
+}
+
 /*
  * free()s the color strings as soon as they are not needed anymore.
  *
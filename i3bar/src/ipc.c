@@ -15,6 +15,8 @@
 #include <stdint.h>
 #include <string.h>
 #include <errno.h>
+#include <err.h>
+#include <fcntl.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <i3/ipc.h>
@@ -25,10 +27,21 @@
 
 ev_io *i3_connection;
 
-const char *sock_path;
+/* Collects the messages from i3 as they arrive, see got_data(). */
+static ipc_reader_t *i3_reader;
+
+char *sock_path;
 
 typedef void (*handler_t)(char *);
 
+/* Whether a GET_WORKSPACES request is on its way, see got_output_reply(). */
+static bool workspaces_requested = false;
+
+static void request_workspaces(void) {
+    i3_send_msg(I3_IPC_MESSAGE_TYPE_GET_WORKSPACES, NULL);
+    workspaces_requested = true;
+}
+
 /*
  * Called, when we get a reply to a command from i3.
  * Since i3 does not give us much feedback on commands, we do not much
@@ -44,6 +57,11 @@ static void got_command_reply(char *reply) {
  */
 static void got_workspace_reply(char *reply) {
     DLOG("Got workspace data!\n");
+    workspaces_requested = false;
+    /* Requested before the configuration arrived, see
+     * request_bar_config(). */
+    if (config.disable_ws)
+        return;
     parse_workspaces_json(reply);
     draw_bars(false);
 }
@@ -63,21 +81,25 @@ static void got_subscribe_reply(char *reply) {
  *
  */
 static void got_output_reply(char *reply) {
-    DLOG("Clearing old output configuration...\n");
-    free_outputs();
-
     DLOG("Parsing outputs JSON...\n");
     parse_outputs_json(reply);
-    DLOG("Reconfiguring windows...\n");
-    reconfig_windows(false);
 
+    /* Only the bars of outputs which changed are touched, so that e.g. DPMS
+     * events do not cause all bars to flicker. */
     i3_output *o_walk;
     SLIST_FOREACH(o_walk, outputs, slist) {
-        kick_tray_clients(o_walk);
+        if (o_walk->changed) {
+            kick_tray_clients(o_walk);
+        }
     }
 
-    if (!config.disable_ws) {
-        i3_send_msg(I3_IPC_MESSAGE_TYPE_GET_WORKSPACES, NULL);
+    DLOG("Reconfiguring windows...\n");
+    reconfig_windows(false);
+
+    /* A pending request was answered after the outputs changed, so its reply
+     * will already reflect them. */
+    if (!config.disable_ws && !workspaces_requested) {
+        request_workspaces();
     }
 
     draw_bars(false);
@@ -87,29 +109,53 @@ static void got_output_reply(char *reply) {
  * Called when we get the configuration for our bar instance
  *
  */
+/* The last received bar configuration, see bar_config_without_visibility(). */
+static char *last_bar_config;
+
+/*
+ * Returns a copy of the given bar configuration without the values of "mode"
+ * and "hidden_state", so that configurations which only differ in whether the
+ * bar is shown compare equal. i3 serializes the configuration without
+ * whitespace and escapes all quotes within strings, so the keys cannot be
+ * confused with the contents of a string.
+ *
+ */
+static char *bar_config_without_visibility(const char *json) {
+    static const char *keys[] = {"\"mode\":\"", "\"hidden_state\":\""};
+    char *result = sstrdup(json);
+
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        char *value = strstr(result, keys[i]);
+        if (value == NULL)
+            continue;
+        value += strlen(keys[i]);
+        char *end = strchr(value, '"');
+        if (end != NULL)
+            memmove(value, end, strlen(end) + 1);
+    }
+    return result;
+}
+
 static void got_bar_config(char *reply) {
     DLOG("Received bar config \"%s\"\n", reply);
-    /* We initiate the main function by requesting infos about the outputs and
-     * workspaces. Everything else (creating the bars, showing the right workspace-
-     * buttons and more) is taken care of by the event-drivenness of the code */
-    i3_send_msg(I3_IPC_MESSAGE_TYPE_GET_OUTPUTS, NULL);
-
     free_colors(&(config.colors));
     parse_config_json(reply);
+    last_bar_config = bar_config_without_visibility(reply);
 
     /* Now we can actually use 'config', so let's subscribe to the appropriate
-     * events and request the workspaces if necessary. */
+     * events. The outputs and workspaces were requested together with the
+     * configuration, their replies are handled next. */
     subscribe_events();
-    if (!config.disable_ws)
-        i3_send_msg(I3_IPC_MESSAGE_TYPE_GET_WORKSPACES, NULL);
+
+    /* Start the status command first, so that it starts up while we load the
+     * font. */
+    start_child(config.command);
 
     /* Initialize the rest of XCB */
     init_xcb_late(config.fontname);
 
     /* Resolve color strings to colorpixels and save them, then free the strings. */
     init_colors(&(config.colors));
-
-    start_child(config.command);
 }
 
 /* Data structure to easily call the reply handlers later */
@@ -134,7 +180,11 @@ handler_t reply_handlers[] = {
  */
 static void got_workspace_event(char *event) {
     DLOG("Got workspace event!\n");
-    i3_send_msg(I3_IPC_MESSAGE_TYPE_GET_WORKSPACES, NULL);
+    if (update_workspaces_from_event(event)) {
+        draw_bars(false);
+        return;
+    }
+    request_workspaces();
 }
 
 /*
@@ -145,7 +195,7 @@ static void got_output_event(char *event) {
     DLOG("Got output event!\n");
     i3_send_msg(I3_IPC_MESSAGE_TYPE_GET_OUTPUTS, NULL);
     if (!config.disable_ws) {
-        i3_send_msg(I3_IPC_MESSAGE_TYPE_GET_WORKSPACES, NULL);
+        request_workspaces();
     }
 }
 
@@ -172,6 +222,25 @@ static void got_bar_config_update(char *event) {
     if (found_id == NULL)
         return;
 
+    /* Toggling the mode or hidden_state (e.g. "bar mode toggle") sends the
+     * whole configuration again. In that case, the bars only need to be
+     * (un)mapped, or reconfigured for the new mode, without reloading the
+     * fonts and colors or waiting for the outputs. */
+    char *new_config = bar_config_without_visibility(event);
+    if (last_bar_config != NULL && strcmp(last_bar_config, new_config) == 0) {
+        free(new_config);
+        DLOG("Received bar config update for mode or hidden_state \"%s\"\n", event);
+        bar_display_mode_t old_mode = config.hide_on_modifier;
+        parse_config_visibility_json(event);
+        if (old_mode != config.hide_on_modifier) {
+            reconfig_windows(true);
+        }
+        draw_bars(false);
+        return;
+    }
+    free(last_bar_config);
+    last_bar_config = new_config;
+
     /* reconfigure the bar based on the current outputs */
     i3_send_msg(I3_IPC_MESSAGE_TYPE_GET_OUTPUTS, NULL);
 
@@ -190,6 +259,13 @@ static void got_bar_config_update(char *event) {
     init_xcb_late(config.fontname);
     init_colors(&(config.colors));
 
+    /* The position or height of the bars might have changed, so all bars are
+     * reconfigured once the GET_OUTPUTS reply arrives. */
+    i3_output *o_walk;
+    SLIST_FOREACH(o_walk, outputs, slist) {
+        o_walk->changed = true;
+    }
+
     /* restart status command process */
     if (old_command && strcmp(old_command, config.command) != 0) {
         kill_child();
@@ -212,25 +288,26 @@ handler_t event_handlers[] = {
 /*
  * Called, when we get a message from i3
  *
+ * The socket is non-blocking: we read whatever is available and dispatch all
+ * complete messages, so that a large reply does not block the event loop
+ * while it trickles in.
+ *
  */
 static void got_data(struct ev_loop *loop, ev_io *watcher, int events) {
     DLOG("Got data!\n");
     int fd = watcher->fd;
 
-    /* First we only read the header, because we know its length */
-    uint32_t header_len = strlen(I3_IPC_MAGIC) + sizeof(uint32_t) * 2;
-    char *header = smalloc(header_len);
-
-    /* We first parse the fixed-length IPC header, to know, how much data
-     * we have to expect */
-    uint32_t rec = 0;
-    while (rec < header_len) {
-        int n = read(fd, header + rec, header_len - rec);
+    while (true) {
+        const ssize_t n = ipc_reader_read(i3_reader, fd);
         if (n == -1) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN)
+                return;
             ELOG("read() failed: %s\n", strerror(errno));
             exit(EXIT_FAILURE);
         }
-        if (n == 0) {
+        if (n == -2) {
             /* EOF received. Since i3 will restart i3bar instances as appropriate,
              * we exit here. */
             DLOG("EOF received, exiting...\n");
@@ -240,54 +317,26 @@ static void got_data(struct ev_loop *loop, ev_io *watcher, int events) {
             clean_xcb();
             exit(EXIT_SUCCESS);
         }
-        rec += n;
-    }
-
-    if (strncmp(header, I3_IPC_MAGIC, strlen(I3_IPC_MAGIC))) {
-        ELOG("Wrong magic code: %.*s\n Expected: %s\n",
-             (int)strlen(I3_IPC_MAGIC),
-             header,
-             I3_IPC_MAGIC);
-        exit(EXIT_FAILURE);
-    }
-
-    char *walk = header + strlen(I3_IPC_MAGIC);
-    uint32_t size;
-    memcpy(&size, (uint32_t *)walk, sizeof(uint32_t));
-    walk += sizeof(uint32_t);
-    uint32_t type;
-    memcpy(&type, (uint32_t *)walk, sizeof(uint32_t));
-
-    /* Now that we know, what to expect, we can start read()ing the rest
-     * of the message */
-    char *buffer = smalloc(size + 1);
-    rec = 0;
-
-    while (rec < size) {
-        int n = read(fd, buffer + rec, size - rec);
-        if (n == -1) {
-            ELOG("read() failed: %s\n", strerror(errno));
-            exit(EXIT_FAILURE);
-        }
-        if (n == 0) {
-            ELOG("Nothing to read!\n");
+        if (n == -3)
             exit(EXIT_FAILURE);
+
+        uint32_t type;
+        uint32_t size;
+        uint8_t *buffer;
+        if (ipc_reader_next_message(i3_reader, &type, &size, &buffer) != 1)
+            continue;
+
+        /* And call the callback (indexed by the type) */
+        if (type & (1UL << 31)) {
+            type ^= 1UL << 31;
+            event_handlers[type]((char *)buffer);
+        } else {
+            if (reply_handlers[type])
+                reply_handlers[type]((char *)buffer);
         }
-        rec += n;
-    }
-    buffer[size] = '\0';
 
-    /* And call the callback (indexed by the type) */
-    if (type & (1UL << 31)) {
-        type ^= 1UL << 31;
-        event_handlers[type](buffer);
-    } else {
-        if (reply_handlers[type])
-            reply_handlers[type](buffer);
+        FREE(buffer);
     }
-
-    FREE(header);
-    FREE(buffer);
 }
 
 /*
@@ -331,9 +380,29 @@ int i3_send_msg(uint32_t type, const char *payload) {
  * socket_path must be a valid path to the ipc_socket of i3
  *
  */
+/*
+ * Requests the configuration of our bar, followed by the outputs and the
+ * workspaces. i3 answers them in order, so everything needed to draw the bars
+ * arrives with the first reply instead of one round trip after another.
+ *
+ */
+void request_bar_config(void) {
+    const ipc_message_t requests[] = {
+        {I3_IPC_MESSAGE_TYPE_GET_BAR_CONFIG, strlen(config.bar_id), (const uint8_t *)config.bar_id},
+        {I3_IPC_MESSAGE_TYPE_GET_OUTPUTS, 0, NULL},
+        {I3_IPC_MESSAGE_TYPE_GET_WORKSPACES, 0, NULL},
+    };
+    if (ipc_send_messages(i3_connection->fd, requests, sizeof(requests) / sizeof(requests[0])) == -1)
+        err(EXIT_FAILURE, "Failed to write %d", i3_connection->fd);
+    workspaces_requested = true;
+}
+
 int init_connection(const char *socket_path) {
-    sock_path = socket_path;
+    sock_path = sstrdup(socket_path);
     int sockfd = ipc_connect(socket_path);
+    /* We set O_NONBLOCK because blocking is evil in event-driven software */
+    fcntl(sockfd, F_SETFL, O_NONBLOCK);
+    i3_reader = ipc_reader_new();
     i3_connection = smalloc(sizeof(ev_io));
     ev_io_init(i3_connection, &got_data, sockfd, EV_READ);
     ev_io_start(main_loop, i3_connection);
@@ -346,6 +415,8 @@ int init_connection(const char *socket_path) {
 void destroy_connection(void) {
     close(i3_connection->fd);
     ev_io_stop(main_loop, i3_connection);
+    ipc_reader_free(i3_reader);
+    i3_reader = NULL;
 }
 
 /*
@@ -356,6 +427,9 @@ void subscribe_events(void) {
     if (config.disable_ws) {
         i3_send_msg(I3_IPC_MESSAGE_TYPE_SUBSCRIBE, "[ \"output\", \"mode\", \"barconfig_update\" ]");
     } else {
-        i3_send_msg(I3_IPC_MESSAGE_TYPE_SUBSCRIBE, "[ \"workspace\", \"output\", \"mode\", \"barconfig_update\" ]");
+        /* Workspace events are only used for the fields of the workspaces
+         * themselves (see update_workspaces_from_event()), not for the
+         * windows on them. */
+        i3_send_msg(I3_IPC_MESSAGE_TYPE_SUBSCRIBE, "[ { \"event\": \"workspace\", \"payload\": \"shallow\" }, \"output\", \"mode\", \"barconfig_update\" ]");
     }
 }
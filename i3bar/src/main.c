@@ -146,12 +146,19 @@ int main(int argc, char **argv) {
 
     main_loop = ev_default_loop(0);
 
-    char *atom_sock_path = init_xcb_early();
+    /* i3 passes its socket path when starting i3bar. Request the bar
+     * configuration right away then, so that i3 answers while we set up the
+     * connection to X11. The replies are handled once the event loop runs. */
+    bool connected = false;
+    if (socket_path != NULL && init_connection(socket_path)) {
+        request_bar_config();
+        connected = true;
+    }
+
+    char *atom_sock_path = init_xcb_early(socket_path == NULL);
 
     if (socket_path == NULL) {
         socket_path = atom_sock_path;
-    } else {
-        free(atom_sock_path);
     }
 
     if (socket_path == NULL) {
@@ -162,9 +169,8 @@ int main(int argc, char **argv) {
     init_dpi();
 
     init_outputs();
-    if (init_connection(socket_path)) {
-        /* Request the bar configuration. When it arrives, we fill the config array. */
-        i3_send_msg(I3_IPC_MESSAGE_TYPE_GET_BAR_CONFIG, config.bar_id);
+    if (!connected && init_connection(socket_path)) {
+        request_bar_config();
     }
     free(socket_path);
 
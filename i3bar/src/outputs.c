@@ -147,6 +147,9 @@ static int outputs_start_map_cb(void *params_) {
         new_output->active = false;
         new_output->primary = false;
         new_output->visible = false;
+        new_output->mapped = false;
+        new_output->changed = true;
+        new_output->seen = true;
         new_output->ws = 0,
         new_output->statusline_width = 0;
         new_output->statusline_short_text = false;
@@ -154,6 +157,10 @@ static int outputs_start_map_cb(void *params_) {
         memset(&new_output->bar, 0, sizeof(surface_t));
         memset(&new_output->buffer, 0, sizeof(surface_t));
         memset(&new_output->statusline_buffer, 0, sizeof(surface_t));
+        memset(&new_output->drawn, 0, sizeof(struct bar_drawn_state));
+        new_output->block_extents = NULL;
+        new_output->num_block_extents = 0;
+        new_output->block_extents_size = 0;
 
         new_output->workspaces = smalloc(sizeof(struct ws_head));
         TAILQ_INIT(new_output->workspaces);
@@ -177,6 +184,18 @@ static void clear_output(i3_output *output) {
     FREE(output->name);
     FREE(output->workspaces);
     FREE(output->trayclients);
+    FREE(output->block_extents);
+}
+
+/*
+ * Destroys the bar of an output which was removed from the list and frees it.
+ *
+ */
+static void free_output(i3_output *output) {
+    destroy_window(output);
+    free_output_workspaces(output);
+    clear_output(output);
+    free(output);
 }
 
 /*
@@ -217,6 +236,15 @@ static int outputs_end_map_cb(void *params_) {
     if (target == NULL) {
         SLIST_INSERT_HEAD(outputs, params->outputs_walk, slist);
     } else {
+        i3_output *new_output = params->outputs_walk;
+        if (target->active != new_output->active ||
+            target->primary != new_output->primary ||
+            memcmp(&(target->rect), &(new_output->rect), sizeof(rect)) != 0) {
+            DLOG("Output %s changed\n", target->name);
+            target->changed = true;
+        }
+        target->seen = true;
+
         target->active = params->outputs_walk->active;
         target->primary = params->outputs_walk->primary;
         target->ws = params->outputs_walk->ws;
@@ -266,6 +294,11 @@ void init_outputs(void) {
  *
  */
 void parse_outputs_json(char *json) {
+    i3_output *walk;
+    SLIST_FOREACH(walk, outputs, slist) {
+        walk->seen = false;
+    }
+
     struct outputs_json_params params;
     params.outputs_walk = NULL;
     params.cur_key = NULL;
@@ -290,6 +323,19 @@ void parse_outputs_json(char *json) {
     }
 
     yajl_free(handle);
+
+    /* Remove the outputs which are gone (or which we do not handle anymore,
+     * e.g. because the primary output changed). */
+    i3_output *next;
+    for (walk = SLIST_FIRST(outputs); walk != NULL; walk = next) {
+        next = SLIST_NEXT(walk, slist);
+        if (walk->seen) {
+            continue;
+        }
+        DLOG("Removing output %s\n", walk->name);
+        SLIST_REMOVE(outputs, walk, i3_output, slist);
+        free_output(walk);
+    }
 }
 
 /*
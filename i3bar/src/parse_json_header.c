@@ -32,6 +32,7 @@ static enum {
     KEY_STOP_SIGNAL,
     KEY_CONT_SIGNAL,
     KEY_CLICK_EVENTS,
+    KEY_PARTIAL_UPDATES,
     NO_KEY
 } current_key;
 
@@ -62,6 +63,9 @@ static int header_boolean(void *ctx, int val) {
         case KEY_CLICK_EVENTS:
             child->click_events = val;
             break;
+        case KEY_PARTIAL_UPDATES:
+            child->partial_updates = val;
+            break;
         default:
             break;
     }
@@ -81,6 +85,10 @@ static int header_map_key(void *ctx, const unsigned char *stringval, size_t stri
         current_key = KEY_CONT_SIGNAL;
     } else if (CHECK_KEY("click_events")) {
         current_key = KEY_CLICK_EVENTS;
+    } else if (CHECK_KEY("partial_updates")) {
+        current_key = KEY_PARTIAL_UPDATES;
+    } else {
+        current_key = NO_KEY;
     }
     return 1;
 }
@@ -89,6 +97,7 @@ static void child_init(i3bar_child *child) {
     child->version = 0;
     child->stop_signal = SIGSTOP;
     child->cont_signal = SIGCONT;
+    child->partial_updates = false;
 }
 
 /*
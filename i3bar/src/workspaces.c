@@ -24,6 +24,53 @@ struct workspaces_json_params {
     char *json;
 };
 
+/*
+ * Sets the canonical name of the given workspace and the name displayed on
+ * the bar (stripped according to the configuration), and measures the latter.
+ * The workspace number must already be set.
+ *
+ */
+static void set_workspace_name(i3_ws *ws, const char *ws_name, size_t len) {
+    FREE(ws->canonical_name);
+    I3STRING_FREE(ws->name);
+    ws->canonical_name = sstrndup(ws_name, len);
+
+    if ((config.strip_ws_numbers || config.strip_ws_name) && ws->num >= 0) {
+        /* Special case: strip off the workspace number/name */
+        static char ws_num[10];
+
+        snprintf(ws_num, sizeof(ws_num), "%d", ws->num);
+
+        /* Calculate the length of the number str in the name */
+        size_t offset = strspn(ws_name, ws_num);
+
+        /* Also strip off the conventional ws name delimiter */
+        if (offset && ws_name[offset] == ':')
+            offset += 1;
+
+        if (config.strip_ws_numbers) {
+            /* Offset may be equal to length, in which case display the number */
+            ws->name = (offset < len
+                            ? i3string_from_markup_with_length(ws_name + offset, len - offset)
+                            : i3string_from_markup(ws_num));
+        } else {
+            ws->name = i3string_from_markup(ws_num);
+        }
+    } else {
+        /* Default case: just save the name */
+        ws->name = i3string_from_markup_with_length(ws_name, len);
+    }
+
+    /* Save its rendered width */
+    ws->name_width = predict_text_width(ws->name);
+
+    DLOG("Got workspace canonical: %s, name: '%s', name_width: %d, glyphs: %zu\n",
+         ws->canonical_name,
+         i3string_as_utf8(ws->name),
+         ws->name_width,
+         i3string_get_num_glyphs(ws->name));
+}
+
 /*
  * Parse a boolean value (visible, focused, urgent)
  *
@@ -61,6 +108,12 @@ static int workspaces_boolean_cb(void *params_, int val) {
 static int workspaces_integer_cb(void *params_, long long val) {
     struct workspaces_json_params *params = (struct workspaces_json_params *)params_;
 
+    if (!strcmp(params->cur_key, "id")) {
+        params->workspaces_walk->id = val;
+        FREE(params->cur_key);
+        return 1;
+    }
+
     if (!strcmp(params->cur_key, "num")) {
         params->workspaces_walk->num = (int)val;
         FREE(params->cur_key);
@@ -103,44 +156,7 @@ static int workspaces_string_cb(void *params_, const unsigned char *val, size_t
     struct workspaces_json_params *params = (struct workspaces_json_params *)params_;
 
     if (!strcmp(params->cur_key, "name")) {
-        const char *ws_name = (const char *)val;
-        params->workspaces_walk->canonical_name = sstrndup(ws_name, len);
-
-        if ((config.strip_ws_numbers || config.strip_ws_name) && params->workspaces_walk->num >= 0) {
-            /* Special case: strip off the workspace number/name */
-            static char ws_num[10];
-
-            snprintf(ws_num, sizeof(ws_num), "%d", params->workspaces_walk->num);
-
-            /* Calculate the length of the number str in the name */
-            size_t offset = strspn(ws_name, ws_num);
-
-            /* Also strip off the conventional ws name delimiter */
-            if (offset && ws_name[offset] == ':')
-                offset += 1;
-
-            if (config.strip_ws_numbers) {
-                /* Offset may be equal to length, in which case display the number */
-                params->workspaces_walk->name = (offset < len
-                                                     ? i3string_from_markup_with_length(ws_name + offset, len - offset)
-                                                     : i3string_from_markup(ws_num));
-            } else {
-                params->workspaces_walk->name = i3string_from_markup(ws_num);
-            }
-        } else {
-            /* Default case: just save the name */
-            params->workspaces_walk->name = i3string_from_markup_with_length(ws_name, len);
-        }
-
-        /* Save its rendered width */
-        params->workspaces_walk->name_width =
-            predict_text_width(params->workspaces_walk->name);
-
-        DLOG("Got workspace canonical: %s, name: '%s', name_width: %d, glyphs: %zu\n",
-             params->workspaces_walk->canonical_name,
-             i3string_as_utf8(params->workspaces_walk->name),
-             params->workspaces_walk->name_width,
-             i3string_get_num_glyphs(params->workspaces_walk->name));
+        set_workspace_name(params->workspaces_walk, (const char *)val, len);
         FREE(params->cur_key);
 
         return 1;
@@ -178,8 +194,10 @@ static int workspaces_start_map_cb(void *params_) {
 
     if (params->cur_key == NULL) {
         new_workspace = smalloc(sizeof(i3_ws));
+        new_workspace->id = 0;
         new_workspace->num = -1;
         new_workspace->name = NULL;
+        new_workspace->canonical_name = NULL;
         new_workspace->visible = 0;
         new_workspace->focused = 0;
         new_workspace->urgent = 0;
@@ -252,6 +270,254 @@ void parse_workspaces_json(char *json) {
     FREE(params.cur_key);
 }
 
+/* The workspace in a workspace event ("current"). */
+struct workspace_event_node {
+    bool present;
+    long long id;
+    int num;
+    char *name;
+    size_t name_len;
+    char *output;
+    bool urgent;
+};
+
+/* The state of parsing a workspace event. Only the keys of the event itself
+ * (depth 1) and of the workspaces (depth 2) are of interest, not the ones of
+ * the containers within the workspaces. */
+struct workspace_event_params {
+    int depth;
+    char *top_key;
+    char *cur_key;
+    char *change;
+    struct workspace_event_node current;
+    struct workspace_event_node *node;
+};
+
+static int workspace_event_start_map_cb(void *params_) {
+    struct workspace_event_params *params = params_;
+    params->depth++;
+    if (params->depth == 2) {
+        params->node = NULL;
+        if (params->top_key != NULL && !strcmp(params->top_key, "current"))
+            params->node = &(params->current);
+        if (params->node != NULL) {
+            params->node->present = true;
+            params->node->num = -1;
+        }
+    }
+    return 1;
+}
+
+static int workspace_event_end_map_cb(void *params_) {
+    struct workspace_event_params *params = params_;
+    params->depth--;
+    return 1;
+}
+
+static int workspace_event_map_key_cb(void *params_, const unsigned char *keyVal, size_t keyLen) {
+    struct workspace_event_params *params = params_;
+    if (params->depth == 1) {
+        FREE(params->top_key);
+        params->top_key = sstrndup((const char *)keyVal, keyLen);
+    } else if (params->depth == 2) {
+        FREE(params->cur_key);
+        params->cur_key = sstrndup((const char *)keyVal, keyLen);
+    }
+    return 1;
+}
+
+static int workspace_event_string_cb(void *params_, const unsigned char *val, size_t len) {
+    struct workspace_event_params *params = params_;
+    if (params->depth == 1 && params->top_key != NULL && !strcmp(params->top_key, "change")) {
+        FREE(params->change);
+        params->change = sstrndup((const char *)val, len);
+    } else if (params->depth == 2 && params->node != NULL && params->cur_key != NULL) {
+        if (!strcmp(params->cur_key, "name")) {
+            FREE(params->node->name);
+            params->node->name = sstrndup((const char *)val, len);
+            params->node->name_len = len;
+        } else if (!strcmp(params->cur_key, "output")) {
+            FREE(params->node->output);
+            params->node->output = sstrndup((const char *)val, len);
+        }
+    }
+    return 1;
+}
+
+static int workspace_event_integer_cb(void *params_, long long val) {
+    struct workspace_event_params *params = params_;
+    if (params->depth == 2 && params->node != NULL && params->cur_key != NULL) {
+        if (!strcmp(params->cur_key, "id"))
+            params->node->id = val;
+        else if (!strcmp(params->cur_key, "num"))
+            params->node->num = (int)val;
+    }
+    return 1;
+}
+
+static int workspace_event_boolean_cb(void *params_, int val) {
+    struct workspace_event_params *params = params_;
+    if (params->depth == 2 && params->node != NULL && params->cur_key != NULL &&
+        !strcmp(params->cur_key, "urgent"))
+        params->node->urgent = val;
+    return 1;
+}
+
+static yajl_callbacks workspace_event_callbacks = {
+    .yajl_boolean = workspace_event_boolean_cb,
+    .yajl_integer = workspace_event_integer_cb,
+    .yajl_string = workspace_event_string_cb,
+    .yajl_start_map = workspace_event_start_map_cb,
+    .yajl_end_map = workspace_event_end_map_cb,
+    .yajl_map_key = workspace_event_map_key_cb,
+};
+
+static i3_ws *get_workspace_by_id(long long id) {
+    i3_output *outputs_walk;
+    i3_ws *ws_walk;
+    SLIST_FOREACH(outputs_walk, outputs, slist) {
+        TAILQ_FOREACH(ws_walk, outputs_walk->workspaces, tailq) {
+            if (ws_walk->id == id)
+                return ws_walk;
+        }
+    }
+    return NULL;
+}
+
+static void free_workspace(i3_ws *ws) {
+    I3STRING_FREE(ws->name);
+    FREE(ws->canonical_name);
+    free(ws);
+}
+
+/*
+ * Inserts a new workspace into the list of its output at the same position
+ * as i3 puts it (see _con_attach()): numbered workspaces are sorted by their
+ * number, named ones are appended.
+ *
+ */
+static void insert_workspace(i3_output *output, i3_ws *ws) {
+    struct ws_head *head = output->workspaces;
+    i3_ws *current = TAILQ_FIRST(head);
+    if (ws->num == -1 || current == NULL) {
+        TAILQ_INSERT_TAIL(head, ws, tailq);
+        return;
+    }
+    if (ws->num < current->num) {
+        TAILQ_INSERT_HEAD(head, ws, tailq);
+        return;
+    }
+    while (current != NULL && current->num != -1 && ws->num > current->num)
+        current = TAILQ_NEXT(current, tailq);
+    if (current != NULL)
+        TAILQ_INSERT_BEFORE(current, ws, tailq);
+    else
+        TAILQ_INSERT_TAIL(head, ws, tailq);
+}
+
+/*
+ * Applies a parsed workspace event, see update_workspaces_from_event(). The
+ * changes which only affect a single workspace are applied directly, others
+ * (like moving workspaces between outputs) are not.
+ *
+ */
+static bool apply_workspace_event(struct workspace_event_params *params) {
+    struct workspace_event_node *current = &(params->current);
+    if (outputs == NULL || params->change == NULL || !current->present)
+        return false;
+
+    i3_ws *ws = get_workspace_by_id(current->id);
+
+    if (!strcmp(params->change, "focus")) {
+        if (ws == NULL)
+            return false;
+
+        i3_output *outputs_walk;
+        i3_ws *ws_walk;
+        SLIST_FOREACH(outputs_walk, outputs, slist) {
+            TAILQ_FOREACH(ws_walk, outputs_walk->workspaces, tailq) {
+                ws_walk->focused = (ws_walk == ws);
+                if (outputs_walk == ws->output)
+                    ws_walk->visible = (ws_walk == ws);
+            }
+        }
+        ws->urgent = current->urgent;
+        return true;
+    }
+
+    if (!strcmp(params->change, "urgent")) {
+        if (ws == NULL)
+            return false;
+        ws->urgent = current->urgent;
+        return true;
+    }
+
+    if (!strcmp(params->change, "rename")) {
+        /* A different number can move the workspace to another position. */
+        if (ws == NULL || current->name == NULL || ws->num != current->num)
+            return false;
+        set_workspace_name(ws, current->name, current->name_len);
+        return true;
+    }
+
+    if (!strcmp(params->change, "empty")) {
+        if (ws != NULL) {
+            TAILQ_REMOVE(ws->output->workspaces, ws, tailq);
+            free_workspace(ws);
+        }
+        return true;
+    }
+
+    if (!strcmp(params->change, "init")) {
+        if (ws != NULL)
+            return true;
+
+        i3_output *output = (current->output == NULL ? NULL : get_output_by_name(current->output));
+        /* The first workspace of an output is visible right away. */
+        if (output == NULL || current->name == NULL || TAILQ_EMPTY(output->workspaces))
+            return false;
+
+        ws = scalloc(1, sizeof(i3_ws));
+        ws->id = current->id;
+        ws->num = current->num;
+        ws->urgent = current->urgent;
+        ws->output = output;
+        set_workspace_name(ws, current->name, current->name_len);
+        insert_workspace(output, ws);
+        return true;
+    }
+
+    return false;
+}
+
+/*
+ * Updates the workspaces according to the given workspace event. Returns false
+ * if the event cannot be applied (or is not understood), in which case the
+ * workspaces have to be requested again.
+ *
+ */
+bool update_workspaces_from_event(const char *json) {
+    struct workspace_event_params params;
+    memset(&params, 0, sizeof(struct workspace_event_params));
+
+    yajl_handle handle = yajl_alloc(&workspace_event_callbacks, NULL, (void *)&params);
+    yajl_status state = yajl_parse(handle, (const unsigned char *)json, strlen(json));
+    if (state == yajl_status_ok)
+        state = yajl_complete_parse(handle);
+    yajl_free(handle);
+
+    bool applied = (state == yajl_status_ok && apply_workspace_event(&params));
+    DLOG("Workspace event \"%s\" %s\n", (params.change == NULL ? "" : params.change),
+         (applied ? "applied" : "not applied, requesting workspaces"));
+
+    FREE(params.top_key);
+    FREE(params.cur_key);
+    FREE(params.change);
+    FREE(params.current.name);
+    FREE(params.current.output);
+    return applied;
+}
+
 /*
  * free() all workspace data structures. Does not free() the heads of the tailqueues.
  *
@@ -261,15 +527,25 @@ void free_workspaces(void) {
     if (outputs == NULL) {
         return;
     }
-    i3_ws *ws_walk;
 
     SLIST_FOREACH(outputs_walk, outputs, slist) {
-        if (outputs_walk->workspaces != NULL && !TAILQ_EMPTY(outputs_walk->workspaces)) {
-            TAILQ_FOREACH(ws_walk, outputs_walk->workspaces, tailq) {
-                I3STRING_FREE(ws_walk->name);
-                FREE(ws_walk->canonical_name);
-            }
-            FREE_TAILQ(outputs_walk->workspaces, i3_ws);
+        free_output_workspaces(outputs_walk);
+    }
+}
+
+/*
+ * free() the workspace data structures of the given output. Does not free()
+ * the head of the tailqueue.
+ *
+ */
+void free_output_workspaces(i3_output *output) {
+    i3_ws *ws_walk;
+
+    if (output->workspaces != NULL && !TAILQ_EMPTY(output->workspaces)) {
+        TAILQ_FOREACH(ws_walk, output->workspaces, tailq) {
+            I3STRING_FREE(ws_walk->name);
+            FREE(ws_walk->canonical_name);
         }
+        FREE_TAILQ(output->workspaces, i3_ws);
     }
 }
@@ -95,6 +95,10 @@ bool activated_mode = false;
 /* The output in which the tray should be displayed. */
 static i3_output *output_for_tray;
 
+/* Incremented whenever the bars have to be redrawn completely (their buffers
+ * were recreated, or the colors or font changed), see draw_bars(). */
+static uint32_t bar_generation = 1;
+
 /* The parsed colors */
 struct xcb_colors_t {
     color_t bar_fg;
@@ -211,28 +215,33 @@ static uint32_t predict_statusline_length(bool use_short_text) {
         if (i3string_get_num_bytes(text) == 0)
             continue;
 
-        render->width = predict_text_width(text);
-        if (block->border)
-            render->width += logical_px(block->border_left + block->border_right);
-
-        /* Compute offset and append for text aligment in min_width. */
-        if (block->min_width <= render->width) {
-            render->x_offset = 0;
-            render->x_append = 0;
-        } else {
-            uint32_t padding_width = block->min_width - render->width;
-            switch (block->align) {
-                case ALIGN_LEFT:
-                    render->x_append = padding_width;
-                    break;
-                case ALIGN_RIGHT:
-                    render->x_offset = padding_width;
-                    break;
-                case ALIGN_CENTER:
-                    render->x_offset = padding_width / 2;
-                    render->x_append = padding_width / 2 + padding_width % 2;
-                    break;
+        /* Blocks keep their measurements until they change, see
+         * stdin_end_array(). */
+        if (!render->valid) {
+            render->width = predict_text_width(text);
+            if (block->border)
+                render->width += logical_px(block->border_left + block->border_right);
+
+            /* Compute offset and append for text aligment in min_width. */
+            if (block->min_width <= render->width) {
+                render->x_offset = 0;
+                render->x_append = 0;
+            } else {
+                uint32_t padding_width = block->min_width - render->width;
+                switch (block->align) {
+                    case ALIGN_LEFT:
+                        render->x_append = padding_width;
+                        break;
+                    case ALIGN_RIGHT:
+                        render->x_offset = padding_width;
+                        break;
+                    case ALIGN_CENTER:
+                        render->x_offset = padding_width / 2;
+                        render->x_append = padding_width / 2 + padding_width % 2;
+                        break;
+                }
             }
+            render->valid = true;
         }
 
         width += render->width + render->x_offset + render->x_append;
@@ -246,11 +255,14 @@ static uint32_t predict_statusline_length(bool use_short_text) {
 }
 
 /*
- * Redraws the statusline to the output's statusline_buffer
+ * Redraws the statusline to the output's statusline_buffer and records where
+ * each block was drawn, see child_handle_button().
  */
 static void draw_statusline(i3_output *output, uint32_t clip_left, bool use_focus_colors, bool use_short_text) {
     struct status_block *block;
 
+    output->num_block_extents = 0;
+
     color_t bar_color = (use_focus_colors ? colors.focus_bar_bg : colors.bar_bg);
     draw_util_clear_surface(&output->statusline_buffer, bar_color);
 
@@ -289,6 +301,18 @@ static void draw_statusline(i3_output *output, uint32_t clip_left, bool use_focu
 
         int full_render_width = render->width + render->x_offset + render->x_append;
         int has_border = block->border ? 1 : 0;
+
+        if (output->num_block_extents == output->block_extents_size) {
+            output->block_extents_size = MAX(16, 2 * output->block_extents_size);
+            output->block_extents = srealloc(output->block_extents,
+                                             output->block_extents_size * sizeof(struct block_extent));
+        }
+        output->block_extents[output->num_block_extents++] = (struct block_extent){
+            .x = x + clip_left,
+            .width = full_render_width,
+            .block = block,
+        };
+
         if (block->border || block->background || block->urgent) {
             /* Let's determine the colors first. */
             color_t border_color = bar_color;
@@ -345,6 +369,7 @@ static void hide_bars(void) {
             continue;
         }
         xcb_unmap_window(xcb_connection, walk->bar.id);
+        walk->mapped = false;
     }
     stop_child();
 }
@@ -352,6 +377,11 @@ static void hide_bars(void) {
 /*
  * Unhides all bars (maps them)
  *
+ * The buffers are kept up to date by draw_bars() while the bars are hidden,
+ * so the content is copied to the bar right after mapping it instead of
+ * waiting for the Expose event (and without any round trip to the X server),
+ * which makes the bar appear as soon as the modifier is pressed.
+ *
  */
 static void unhide_bars(void) {
     if (config.hide_on_modifier != M_HIDE) {
@@ -359,7 +389,6 @@ static void unhide_bars(void) {
     }
 
     i3_output *walk;
-    xcb_void_cookie_t cookie;
     uint32_t mask;
     uint32_t values[5];
 
@@ -383,16 +412,22 @@ static void unhide_bars(void) {
         values[3] = bar_height;
         values[4] = XCB_STACK_MODE_ABOVE;
         DLOG("Reconfiguring window for output %s to %d,%d\n", walk->name, values[0], values[1]);
-        cookie = xcb_configure_window_checked(xcb_connection,
-                                              walk->bar.id,
-                                              mask,
-                                              values);
+        xcb_configure_window(xcb_connection,
+                             walk->bar.id,
+                             mask,
+                             values);
 
-        if (xcb_request_failed(cookie, "Could not reconfigure window")) {
-            exit(EXIT_FAILURE);
-        }
+        if (walk->mapped)
+            continue;
+
+        /* The bar window is override_redirect, so it is viewable right after
+         * the MapWindow request and the copy is not discarded. */
         xcb_map_window(xcb_connection, walk->bar.id);
+        draw_util_copy_surface(&(walk->buffer), &(walk->bar), 0, 0,
+                               0, 0, walk->rect.w, bar_height);
+        walk->mapped = true;
     }
+    xcb_flush(xcb_connection);
 }
 
 /*
@@ -400,6 +435,7 @@ static void unhide_bars(void) {
  *
  */
 void init_colors(const struct xcb_color_strings_t *new_colors) {
+    bar_generation++;
 #define PARSE_COLOR(name, def)                                                           \
     do {                                                                                 \
         colors.name = draw_util_hex_to_color(new_colors->name ? new_colors->name : def); \
@@ -455,48 +491,51 @@ static bool execute_custom_command(xcb_keycode_t input_code, bool event_is_relea
     return false;
 }
 
+/*
+ * Sends a click event for the status block at the given x coordinate
+ * (relative to the start of the statusline), if any. The block is looked up
+ * in the extents recorded by draw_statusline().
+ *
+ */
 static void child_handle_button(xcb_button_press_event_t *event, i3_output *output, uint32_t statusline_x) {
+    /* The blocks changed since they were drawn, so the recorded extents
+     * might refer to blocks which are gone. */
+    if (output->drawn.statusline_generation != statusline_generation) {
+        draw_bars(false);
+    }
+
     if (statusline_x > (uint32_t)output->statusline_width) {
         return;
     }
 
-    /* x of the start of the current block relative to the statusline. */
-    uint32_t last_block_x = 0;
-    struct status_block *block;
-    TAILQ_FOREACH(block, &statusline_head, blocks) {
-        i3String *text;
-        struct status_block_render_desc *render;
-        if (output->statusline_short_text && block->short_text != NULL) {
-            text = block->short_text;
-            render = &block->short_render;
+    /* Find the last block which starts at or before the click. */
+    int lo = 0, hi = output->num_block_extents;
+    while (lo < hi) {
+        const int mid = lo + (hi - lo) / 2;
+        if (output->block_extents[mid].x <= statusline_x) {
+            lo = mid + 1;
         } else {
-            text = block->full_text;
-            render = &block->full_render;
-        }
-
-        if (i3string_get_num_bytes(text) == 0) {
-            continue;
-        }
-
-        /* Include the whole block in our calculations: when min_width is
-         * specified, we have to take padding width into account. */
-        const uint32_t full_render_width = render->width + render->x_offset + render->x_append;
-        /* x of the click event relative to the current block. */
-        const uint32_t relative_x = statusline_x - last_block_x;
-        if (relative_x <= full_render_width) {
-            send_block_clicked(event->detail, block->name, block->instance,
-                               event->root_x, event->root_y, relative_x,
-                               event->event_y, full_render_width, bar_height,
-                               event->state);
-            return;
+            hi = mid;
         }
+    }
+    if (lo == 0) {
+        return;
+    }
 
-        last_block_x += full_render_width + block->sep_block_width;
-        if (last_block_x > statusline_x) {
-            /* Click was on a separator. */
-            return;
-        }
+    const struct block_extent *extent = &(output->block_extents[lo - 1]);
+    /* x of the click event relative to the block. The extent includes the
+     * padding when min_width is specified. */
+    const uint32_t relative_x = statusline_x - extent->x;
+    if (relative_x > extent->width) {
+        /* Click was on a separator. */
+        return;
     }
+
+    struct status_block *block = extent->block;
+    send_block_clicked(event->detail, block->name, block->instance,
+                       event->root_x, event->root_y, relative_x,
+                       event->event_y, extent->width, bar_height,
+                       event->state);
 }
 
 /*
@@ -686,7 +725,9 @@ static void handle_visibility_notify(xcb_visibility_notify_event_t *event) {
 /*
  * Adjusts the size of the tray window and alignment of the tray clients by
  * configuring their respective x coordinates. To be called when mapping or
- * unmapping a tray client window.
+ * unmapping a tray client window. Only the tray clients whose position
+ * actually changed are configured, so that an icon which blinks (maps and
+ * unmaps itself) does not cause ConfigureWindow requests for all others.
  *
  */
 static void configure_trayclients(void) {
@@ -702,13 +743,16 @@ static void configure_trayclients(void) {
                 continue;
             clients++;
 
-            DLOG("Configuring tray window %08x to x=%d\n",
-                 trayclient->win, output->rect.w - (clients * (icon_size + logical_px(config.tray_padding))));
             uint32_t x = output->rect.w - (clients * (icon_size + logical_px(config.tray_padding)));
+            if (trayclient->x == (int)x)
+                continue;
+
+            DLOG("Configuring tray window %08x to x=%d\n", trayclient->win, x);
             xcb_configure_window(xcb_connection,
                                  trayclient->win,
                                  XCB_CONFIG_WINDOW_X,
                                  &x);
+            trayclient->x = x;
         }
     }
 }
@@ -847,6 +891,7 @@ static void handle_client_message(xcb_client_message_event_t *event) {
             tc->win = client;
             tc->xe_version = xe_version;
             tc->mapped = false;
+            tc->x = output_for_tray->rect.w - icon_size - logical_px(config.tray_padding);
             TAILQ_INSERT_TAIL(output_for_tray->trayclients, tc, tailq);
 
             if (map_it) {
@@ -1071,6 +1116,25 @@ static void handle_resize_request(xcb_resize_request_event_t *event) {
  * events from X11, handle them, then flush our outgoing queue.
  *
  */
+/*
+ * Handles Expose events by copying the exposed region of the bar from its
+ * buffer. When a tray client unmaps its window, only the area it occupied is
+ * exposed, so there is no need to copy the whole bar.
+ *
+ */
+static void handle_expose(xcb_expose_event_t *event) {
+    i3_output *walk;
+    SLIST_FOREACH(walk, outputs, slist) {
+        if (!walk->active || walk->bar.id != event->window)
+            continue;
+
+        draw_util_copy_surface(&(walk->buffer), &(walk->bar), event->x, event->y,
+                               event->x, event->y, event->width, event->height);
+        xcb_flush(xcb_connection);
+        return;
+    }
+}
+
 static void xcb_prep_cb(struct ev_loop *loop, ev_prepare *watcher, int revents) {
     xcb_generic_event_t *event;
 
@@ -1120,11 +1184,8 @@ static void xcb_prep_cb(struct ev_loop *loop, ev_prepare *watcher, int revents)
                 handle_visibility_notify((xcb_visibility_notify_event_t *)event);
                 break;
             case XCB_EXPOSE:
-                if (((xcb_expose_event_t *)event)->count == 0) {
-                    /* Expose-events happen, when the window needs to be redrawn */
-                    redraw_bars();
-                }
-
+                /* Expose-events happen, when the window needs to be redrawn */
+                handle_expose((xcb_expose_event_t *)event);
                 break;
             case XCB_BUTTON_RELEASE:
             case XCB_BUTTON_PRESS:
@@ -1179,7 +1240,7 @@ static void xcb_io_cb(struct ev_loop *loop, ev_io *watcher, int revents) {
  * depend on 'config'.
  *
  */
-char *init_xcb_early(void) {
+char *init_xcb_early(bool get_socket_path) {
     /* FIXME: xcb_connect leaks memory */
     xcb_connection = xcb_connect(NULL, &screen);
     if (xcb_connection_has_error(xcb_connection)) {
@@ -1245,9 +1306,10 @@ char *init_xcb_early(void) {
     /* Now we get the atoms and save them in a nice data structure */
     get_atoms();
 
-    char *path = root_atom_contents("I3_SOCKET_PATH", xcb_connection, screen);
+    if (!get_socket_path)
+        return NULL;
 
-    return path;
+    return root_atom_contents("I3_SOCKET_PATH", xcb_connection, screen);
 }
 
 /*
@@ -1297,6 +1359,7 @@ static void deregister_xkb_keyevents(void) {
  *
  */
 void init_xcb_late(char *fontname) {
+    bar_generation++;
     if (fontname == NULL)
         fontname = "-misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1";
 
@@ -1571,6 +1634,7 @@ void destroy_window(i3_output *output) {
     kick_tray_clients(output);
     xcb_destroy_window(xcb_connection, output->bar.id);
     output->bar.id = XCB_NONE;
+    output->mapped = false;
 }
 
 /* Strut partial tells i3 where to reserve space for i3bar. This is determined
@@ -1670,13 +1734,22 @@ static i3_output *get_tray_output(void) {
 /*
  * Reconfigure all bars and create new bars for recently activated outputs
  *
+ * Unless redraw_bars is set, only the bars of outputs which changed since the
+ * last call (see parse_outputs_json()) are reconfigured.
+ *
  */
 void reconfig_windows(bool redraw_bars) {
     uint32_t mask;
     uint32_t values[6];
 
+    if (redraw_bars) {
+        bar_generation++;
+    }
+
     i3_output *walk;
     SLIST_FOREACH(walk, outputs, slist) {
+        const bool changed = walk->changed;
+        walk->changed = false;
         if (!walk->active) {
             /* If an output is not active, we destroy its bar */
             /* FIXME: Maybe we rather want to unmap? */
@@ -1686,6 +1759,7 @@ void reconfig_windows(bool redraw_bars) {
         }
         if (walk->bar.id == XCB_NONE) {
             DLOG("Creating window for output %s\n", walk->name);
+            walk->drawn.generation = 0;
 
             xcb_window_t bar_id = xcb_generate_id(xcb_connection);
             xcb_pixmap_t buffer_id = xcb_generate_id(xcb_connection);
@@ -1789,6 +1863,7 @@ void reconfig_windows(bool redraw_bars) {
             if (config.hide_on_modifier == M_DOCK) {
                 map_cookie = xcb_map_window_checked(xcb_connection, bar_id);
             }
+            walk->mapped = (config.hide_on_modifier == M_DOCK);
 
             if (xcb_request_failed(win_cookie, "Could not create window") ||
                 xcb_request_failed(pm_cookie, "Could not create pixmap") ||
@@ -1801,8 +1876,9 @@ void reconfig_windows(bool redraw_bars) {
                 exit(EXIT_FAILURE);
             }
 
-        } else {
+        } else if (redraw_bars || changed) {
             /* We already have a bar, so we just reconfigure it */
+            walk->drawn.generation = 0;
             mask = XCB_CONFIG_WINDOW_X |
                    XCB_CONFIG_WINDOW_Y |
                    XCB_CONFIG_WINDOW_WIDTH |
@@ -1873,6 +1949,7 @@ void reconfig_windows(bool redraw_bars) {
                 } else {
                     stop_child();
                 }
+                walk->mapped = (config.hide_on_modifier == M_DOCK);
 
                 if (config.hide_on_modifier == M_HIDE) {
                     /* Switching to hide mode, register for keyevents */
@@ -1910,7 +1987,155 @@ void reconfig_windows(bool redraw_bars) {
 }
 
 /*
- * Render the bars, with buttons and statusline
+ * Returns a hash of everything which is drawn in the left part of the bar of
+ * the given output, that is the workspace buttons and the binding mode
+ * indicator, so that draw_bars() can tell whether it changed. Sets *unhide if
+ * the left part requires the bar to be shown.
+ *
+ */
+static uint64_t hash_left_part(i3_output *output, bool *unhide) {
+    /* FNV-1a */
+    uint64_t hash = 14695981039346656037ULL;
+#define HASH_BYTES(data, len)                              \
+    do {                                                   \
+        const unsigned char *_bytes = (const void *)(data); \
+        for (size_t _i = 0; _i < (len); _i++) {            \
+            hash ^= _bytes[_i];                            \
+            hash *= 1099511628211ULL;                      \
+        }                                                  \
+    } while (0)
+
+    if (!config.disable_ws) {
+        i3_ws *ws_walk;
+        TAILQ_FOREACH(ws_walk, output->workspaces, tailq) {
+            const char *name = i3string_as_utf8(ws_walk->name);
+            const bool state[] = {ws_walk->visible, ws_walk->focused, ws_walk->urgent,
+                                  i3string_is_markup(ws_walk->name)};
+            HASH_BYTES(name, strlen(name) + 1);
+            HASH_BYTES(&(ws_walk->name_width), sizeof(ws_walk->name_width));
+            HASH_BYTES(state, sizeof(state));
+            if (ws_walk->urgent)
+                *unhide = true;
+        }
+    }
+
+    if (binding.name && !config.disable_binding_mode_indicator) {
+        const char *name = i3string_as_utf8(binding.name);
+        HASH_BYTES(name, strlen(name) + 1);
+        HASH_BYTES(&(binding.width), sizeof(binding.width));
+        *unhide = true;
+    }
+#undef HASH_BYTES
+
+    return hash;
+}
+
+/*
+ * Draws the workspace buttons and the binding mode indicator of the given
+ * output into its buffer. Returns the width of the drawn part.
+ *
+ */
+static int draw_left_part(i3_output *output) {
+    int workspace_width = 0;
+
+    if (!config.disable_ws) {
+        i3_ws *ws_walk;
+        TAILQ_FOREACH(ws_walk, output->workspaces, tailq) {
+            DLOG("Drawing button for WS %s at x = %d, len = %d\n",
+                 i3string_as_utf8(ws_walk->name), workspace_width, ws_walk->name_width);
+            color_t fg_color = colors.inactive_ws_fg;
+            color_t bg_color = colors.inactive_ws_bg;
+            color_t border_color = colors.inactive_ws_border;
+            if (ws_walk->visible) {
+                if (!ws_walk->focused) {
+                    fg_color = colors.active_ws_fg;
+                    bg_color = colors.active_ws_bg;
+                    border_color = colors.active_ws_border;
+                } else {
+                    fg_color = colors.focus_ws_fg;
+                    bg_color = colors.focus_ws_bg;
+                    border_color = colors.focus_ws_border;
+                }
+            }
+            if (ws_walk->urgent) {
+                DLOG("WS %s is urgent!\n", i3string_as_utf8(ws_walk->name));
+                fg_color = colors.urgent_ws_fg;
+                bg_color = colors.urgent_ws_bg;
+                border_color = colors.urgent_ws_border;
+            }
+
+            /* Draw the border of the button. */
+            draw_util_rectangle(&(output->buffer), border_color,
+                                workspace_width,
+                                logical_px(1),
+                                ws_walk->name_width + 2 * logical_px(ws_hoff_px) + 2 * logical_px(1),
+                                font.height + 2 * logical_px(ws_voff_px) - 2 * logical_px(1));
+
+            /* Draw the inside of the button. */
+            draw_util_rectangle(&(output->buffer), bg_color,
+                                workspace_width + logical_px(1),
+                                2 * logical_px(1),
+                                ws_walk->name_width + 2 * logical_px(ws_hoff_px),
+                                font.height + 2 * logical_px(ws_voff_px) - 4 * logical_px(1));
+
+            draw_util_text(ws_walk->name, &(output->buffer), fg_color, bg_color,
+                           workspace_width + logical_px(ws_hoff_px) + logical_px(1),
+                           logical_px(ws_voff_px),
+                           ws_walk->name_width);
+
+            workspace_width += 2 * logical_px(ws_hoff_px) + 2 * logical_px(1) + ws_walk->name_width;
+            if (TAILQ_NEXT(ws_walk, tailq) != NULL)
+                workspace_width += logical_px(ws_spacing_px);
+        }
+    }
+
+    if (binding.name && !config.disable_binding_mode_indicator) {
+        workspace_width += logical_px(ws_spacing_px);
+
+        color_t fg_color = colors.binding_mode_fg;
+        color_t bg_color = colors.binding_mode_bg;
+
+        draw_util_rectangle(&(output->buffer), colors.binding_mode_border,
+                            workspace_width,
+                            logical_px(1),
+                            binding.width + 2 * logical_px(ws_hoff_px) + 2 * logical_px(1),
+                            font.height + 2 * logical_px(ws_voff_px) - 2 * logical_px(1));
+
+        draw_util_rectangle(&(output->buffer), bg_color,
+                            workspace_width + logical_px(1),
+                            2 * logical_px(1),
+                            binding.width + 2 * logical_px(ws_hoff_px),
+                            font.height + 2 * logical_px(ws_voff_px) - 4 * logical_px(1));
+
+        draw_util_text(binding.name, &(output->buffer), fg_color, bg_color,
+                       workspace_width + logical_px(ws_hoff_px) + logical_px(1),
+                       logical_px(ws_voff_px),
+                       binding.width);
+
+        workspace_width += 2 * logical_px(ws_hoff_px) + 2 * logical_px(1) + binding.width;
+    }
+
+    return workspace_width;
+}
+
+/*
+ * Copies the given horizontal range of the output's buffer to its bar. Hidden
+ * bars are only drawn into their buffer, which unhide_bars() copies once they
+ * are mapped again.
+ *
+ */
+static void copy_to_bar(i3_output *output, int x, int width) {
+    if (width <= 0 || !output->mapped)
+        return;
+    draw_util_copy_surface(&(output->buffer), &(output->bar), x, 0, x, 0, width, bar_height);
+}
+
+/*
+ * Draws the bars. Every bar consists of two parts which are only redrawn (and
+ * copied to the bar window) if they changed since the last call: the
+ * workspace buttons and binding mode indicator on the left, and the status
+ * line on the right. Everything is redrawn after the bar was reconfigured,
+ * the colors or font changed, or the output gained or lost focus.
  *
  */
 void draw_bars(bool unhide) {
@@ -1921,8 +2146,6 @@ void draw_bars(bool unhide) {
 
     i3_output *outputs_walk;
     SLIST_FOREACH(outputs_walk, outputs, slist) {
-        int workspace_width = 0;
-
         if (!outputs_walk->active) {
             DLOG("Output %s inactive, skipping...\n", outputs_walk->name);
             continue;
@@ -1933,98 +2156,41 @@ void draw_bars(bool unhide) {
         }
 
         bool use_focus_colors = output_has_focus(outputs_walk);
+        color_t bar_color = (use_focus_colors ? colors.focus_bar_bg : colors.bar_bg);
+        struct bar_drawn_state *drawn = &(outputs_walk->drawn);
 
-        /* First things first: clear the backbuffer */
-        draw_util_clear_surface(&(outputs_walk->buffer), (use_focus_colors ? colors.focus_bar_bg : colors.bar_bg));
-
-        if (!config.disable_ws) {
-            i3_ws *ws_walk;
-            TAILQ_FOREACH(ws_walk, outputs_walk->workspaces, tailq) {
-                DLOG("Drawing button for WS %s at x = %d, len = %d\n",
-                     i3string_as_utf8(ws_walk->name), workspace_width, ws_walk->name_width);
-                color_t fg_color = colors.inactive_ws_fg;
-                color_t bg_color = colors.inactive_ws_bg;
-                color_t border_color = colors.inactive_ws_border;
-                if (ws_walk->visible) {
-                    if (!ws_walk->focused) {
-                        fg_color = colors.active_ws_fg;
-                        bg_color = colors.active_ws_bg;
-                        border_color = colors.active_ws_border;
-                    } else {
-                        fg_color = colors.focus_ws_fg;
-                        bg_color = colors.focus_ws_bg;
-                        border_color = colors.focus_ws_border;
-                    }
-                }
-                if (ws_walk->urgent) {
-                    DLOG("WS %s is urgent!\n", i3string_as_utf8(ws_walk->name));
-                    fg_color = colors.urgent_ws_fg;
-                    bg_color = colors.urgent_ws_bg;
-                    border_color = colors.urgent_ws_border;
-                    unhide = true;
-                }
-
-                /* Draw the border of the button. */
-                draw_util_rectangle(&(outputs_walk->buffer), border_color,
-                                    workspace_width,
-                                    logical_px(1),
-                                    ws_walk->name_width + 2 * logical_px(ws_hoff_px) + 2 * logical_px(1),
-                                    font.height + 2 * logical_px(ws_voff_px) - 2 * logical_px(1));
-
-                /* Draw the inside of the button. */
-                draw_util_rectangle(&(outputs_walk->buffer), bg_color,
-                                    workspace_width + logical_px(1),
-                                    2 * logical_px(1),
-                                    ws_walk->name_width + 2 * logical_px(ws_hoff_px),
-                                    font.height + 2 * logical_px(ws_voff_px) - 4 * logical_px(1));
-
-                draw_util_text(ws_walk->name, &(outputs_walk->buffer), fg_color, bg_color,
-                               workspace_width + logical_px(ws_hoff_px) + logical_px(1),
-                               logical_px(ws_voff_px),
-                               ws_walk->name_width);
-
-                workspace_width += 2 * logical_px(ws_hoff_px) + 2 * logical_px(1) + ws_walk->name_width;
-                if (TAILQ_NEXT(ws_walk, tailq) != NULL)
-                    workspace_width += logical_px(ws_spacing_px);
-            }
+        const bool full = (drawn->generation != bar_generation ||
+                           drawn->focus_colors != use_focus_colors);
+        if (full) {
+            draw_util_clear_surface(&(outputs_walk->buffer), bar_color);
         }
 
-        if (binding.name && !config.disable_binding_mode_indicator) {
-            workspace_width += logical_px(ws_spacing_px);
-
-            color_t fg_color = colors.binding_mode_fg;
-            color_t bg_color = colors.binding_mode_bg;
-
-            draw_util_rectangle(&(outputs_walk->buffer), colors.binding_mode_border,
-                                workspace_width,
-                                logical_px(1),
-                                binding.width + 2 * logical_px(ws_hoff_px) + 2 * logical_px(1),
-                                font.height + 2 * logical_px(ws_voff_px) - 2 * logical_px(1));
-
-            draw_util_rectangle(&(outputs_walk->buffer), bg_color,
-                                workspace_width + logical_px(1),
-                                2 * logical_px(1),
-                                binding.width + 2 * logical_px(ws_hoff_px),
-                                font.height + 2 * logical_px(ws_voff_px) - 4 * logical_px(1));
-
-            draw_util_text(binding.name, &(outputs_walk->buffer), fg_color, bg_color,
-                           workspace_width + logical_px(ws_hoff_px) + logical_px(1),
-                           logical_px(ws_voff_px),
-                           binding.width);
-
-            unhide = true;
-            workspace_width += 2 * logical_px(ws_hoff_px) + 2 * logical_px(1) + binding.width;
+        /* The workspace buttons and the binding mode indicator. */
+        int workspace_width = drawn->workspace_width;
+        uint64_t left_hash = hash_left_part(outputs_walk, &unhide);
+        if (full || left_hash != drawn->left_hash) {
+            if (!full) {
+                draw_util_rectangle(&(outputs_walk->buffer), bar_color,
+                                    0, 0, drawn->workspace_width, bar_height);
+            }
+            workspace_width = draw_left_part(outputs_walk);
+            if (!full) {
+                copy_to_bar(outputs_walk, 0, MAX(workspace_width, drawn->workspace_width));
+            }
+            drawn->left_hash = left_hash;
+            drawn->workspace_width = workspace_width;
         }
 
+        /* The status line. */
+        int x_dest = 0;
+        int16_t visible_statusline_width = 0;
+        uint32_t clip_left = 0;
+        bool use_short_text = false;
         if (!TAILQ_EMPTY(&statusline_head)) {
-            DLOG("Printing statusline!\n");
-
             int tray_width = get_tray_width(outputs_walk->trayclients);
             uint32_t hoff = logical_px(((workspace_width > 0) + (tray_width > 0)) * sb_hoff_px);
             uint32_t max_statusline_width = outputs_walk->rect.w - workspace_width - tray_width - hoff;
-            uint32_t clip_left = 0;
             uint32_t statusline_width = full_statusline_width;
-            bool use_short_text = false;
 
             if (statusline_width > max_statusline_width) {
                 statusline_width = short_statusline_width;
@@ -2034,16 +2200,48 @@ void draw_bars(bool unhide) {
                 }
             }
 
-            int16_t visible_statusline_width = MIN(statusline_width, max_statusline_width);
-            int x_dest = outputs_walk->rect.w - tray_width - logical_px((tray_width > 0) * sb_hoff_px) - visible_statusline_width;
-
-            draw_statusline(outputs_walk, clip_left, use_focus_colors, use_short_text);
-            draw_util_copy_surface(&outputs_walk->statusline_buffer, &outputs_walk->buffer, 0, 0,
-                                   x_dest, 0, visible_statusline_width, (int16_t)bar_height);
+            visible_statusline_width = MIN(statusline_width, max_statusline_width);
+            x_dest = outputs_walk->rect.w - tray_width - logical_px((tray_width > 0) * sb_hoff_px) - visible_statusline_width;
 
             outputs_walk->statusline_width = statusline_width;
             outputs_walk->statusline_short_text = use_short_text;
         }
+
+        if (full ||
+            drawn->statusline_generation != statusline_generation ||
+            drawn->statusline_x != x_dest ||
+            drawn->statusline_visible_width != visible_statusline_width ||
+            drawn->statusline_clip_left != clip_left ||
+            drawn->statusline_short_text != use_short_text) {
+            if (!full) {
+                /* Clear (and later copy) where the old status line was. */
+                draw_util_rectangle(&(outputs_walk->buffer), bar_color,
+                                    drawn->statusline_x, 0, drawn->statusline_visible_width, bar_height);
+            }
+            if (visible_statusline_width > 0) {
+                DLOG("Printing statusline!\n");
+                draw_statusline(outputs_walk, clip_left, use_focus_colors, use_short_text);
+                draw_util_copy_surface(&outputs_walk->statusline_buffer, &outputs_walk->buffer, 0, 0,
+                                       x_dest, 0, visible_statusline_width, (int16_t)bar_height);
+            } else {
+                outputs_walk->num_block_extents = 0;
+            }
+            if (!full) {
+                copy_to_bar(outputs_walk, drawn->statusline_x, drawn->statusline_visible_width);
+                copy_to_bar(outputs_walk, x_dest, visible_statusline_width);
+            }
+            drawn->statusline_generation = statusline_generation;
+            drawn->statusline_x = x_dest;
+            drawn->statusline_visible_width = visible_statusline_width;
+            drawn->statusline_clip_left = clip_left;
+            drawn->statusline_short_text = use_short_text;
+        }
+
+        if (full) {
+            copy_to_bar(outputs_walk, 0, outputs_walk->rect.w);
+            drawn->generation = bar_generation;
+            drawn->focus_colors = use_focus_colors;
+        }
     }
 
     /* Assure the bar is hidden/unhidden according to the specified hidden_state and mode */
@@ -2055,7 +2253,7 @@ void draw_bars(bool unhide) {
         hide_bars();
     }
 
-    redraw_bars();
+    xcb_flush(xcb_connection);
 }
 
 /*
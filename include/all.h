@@ -79,8 +79,16 @@
 #include "bindings.h"
 #include "config_directives.h"
 #include "config_parser.h"
+#include "config_cache.h"
 #include "fake_outputs.h"
 #include "display_version.h"
 #include "restore_layout.h"
 #include "sync.h"
-#include "main.h"
+#include "sync_request.h"
+#include "stats.h"
+#include "probes.h"
+#include "shmstate.h"
+#include "intern.h"
+#include "timer_wheel.h"
+#include "x_requests.h"
+#include "event_trace.h"
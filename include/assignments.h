@@ -11,6 +11,20 @@
 
 #include <config.h>
 
+/**
+ * (Re-)builds the index used by run_assignments() and assignment_for(). Must
+ * be called whenever the list of assignments changed.
+ *
+ */
+void assignment_index_rebuild(void);
+
+/**
+ * Frees the assignment index. Must be called before the assignments are
+ * freed.
+ *
+ */
+void assignment_index_free(void);
+
 /**
  * Checks the list of assignments for the given window and runs all matching
  * ones (unless they have already been run for this specific window).
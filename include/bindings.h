@@ -33,12 +33,30 @@ Binding *configure_binding(const char *bindtype, const char *modifiers, const ch
 /**
  * Grab the bound keys (tell X to send us keypress events for those keycodes)
  *
+ * Only the difference to the currently active grabs is sent to the X server,
+ * so this is cheap when switching between modes or XKB groups which share most
+ * of their bindings.
+ *
  */
 void grab_all_keys(xcb_connection_t *conn);
 
 /**
- * Release the button grabs on all managed windows and regrab them,
- * reevaluating which buttons need to be grabbed.
+ * Forgets which keys are grabbed. Called after all keys were ungrabbed.
+ *
+ */
+void key_grabs_reset(void);
+
+/**
+ * Grabs the buttons which are currently grabbed on all managed windows on the
+ * given (newly managed) window.
+ *
+ */
+void grab_buttons_on_window(xcb_connection_t *conn, xcb_window_t window);
+
+/**
+ * Reevaluates which buttons need to be grabbed and updates the button grabs on
+ * all managed windows. Only the difference to the currently grabbed buttons is
+ * sent to the X server.
  *
  */
 void regrab_all_buttons(xcb_connection_t *conn);
@@ -91,6 +109,13 @@ void check_for_duplicate_bindings(struct context *context);
  */
 void binding_free(Binding *bind);
 
+/**
+ * Frees the binding index. Must be called before the bindings it refers to
+ * are freed.
+ *
+ */
+void binding_index_free(void);
+
 /**
  * Runs the given binding and handles parse errors. If con is passed, it will
  * execute the command binding with that container selected by criteria.
@@ -100,11 +125,39 @@ void binding_free(Binding *bind);
  */
 CommandResult *run_binding(Binding *bind, Con *con);
 
+/**
+ * Like run_binding(), but runs the binding's command as if the binding was
+ * triggered repeat times in a row (see command_ir_run_repeated()). The binding
+ * must be repeatable (see binding_is_repeatable()) unless repeat is 1.
+ *
+ */
+CommandResult *run_binding_repeated(Binding *bind, Con *con, int repeat);
+
+/**
+ * Like run_binding_repeated() (without a container), but instead of sending
+ * the binding event right away, the command's timestamps and a copy of the
+ * binding are stored in trace. The caller sends the event once the result was
+ * flushed to X11 and frees trace->binding.
+ *
+ */
+CommandResult *run_binding_traced(Binding *bind, int repeat, struct binding_trace *trace);
+
+/**
+ * Returns true if triggering the given binding several times in a row can be
+ * coalesced into one run_binding_repeated() call.
+ *
+ */
+bool binding_is_repeatable(Binding *bind);
+
 /**
  * Loads the XKB keymap from the X11 server and feeds it to xkbcommon.
  *
+ * If changed is not NULL, it is set to whether the keymap differs from the
+ * previously loaded one. If it does not, the previous keymap is kept, so that
+ * callers can skip translate_keysyms() and re-grabbing the keys.
+ *
  */
-bool load_keymap(void);
+bool load_keymap(bool *changed);
 
 /**
  * Returns a list of buttons that should be grabbed on a window.
@@ -325,3 +325,9 @@ void cmd_shmlog(I3_CMD, const char *argument);
  *
  */
 void cmd_debuglog(I3_CMD, const char *argument);
+
+/**
+ * Implementation of 'debuglog <category> toggle|on|off'
+ *
+ */
+void cmd_debuglog_category(I3_CMD, const char *category, const char *argument);
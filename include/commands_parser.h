@@ -33,6 +33,11 @@ struct CommandResultIR {
 
     /* Whether the command requires calling tree_render. */
     bool needs_tree_render;
+
+    /* How many times the command is to be applied. Greater than 1 only for
+     * coalesced key repeats of a resize or move binding (see
+     * command_ir_run_repeated()). */
+    int repeat;
 };
 
 typedef struct CommandResult CommandResult;
@@ -71,3 +76,53 @@ CommandResult *parse_command(const char *input, yajl_gen gen, ipc_client *client
  * Frees a CommandResult
  */
 void command_result_free(CommandResult *result);
+
+/**
+ * Parses the given command once and returns its precompiled form, which can be
+ * run any number of times with command_ir_run(). Returns NULL if the command
+ * contains a parse error; such commands need to be run with parse_command(),
+ * which reports the error.
+ *
+ * Release the returned CommandIR with command_ir_unref().
+ *
+ */
+CommandIR *command_ir_compile(const char *input);
+
+/**
+ * Takes another reference to the given precompiled command.
+ *
+ */
+CommandIR *command_ir_ref(CommandIR *ir);
+
+/**
+ * Releases a reference to the given precompiled command, freeing it when this
+ * was the last one.
+ *
+ */
+void command_ir_unref(CommandIR *ir);
+
+/**
+ * Runs the given precompiled command like parse_command() would run its text.
+ * If con or window are given, the first command operates on that container or
+ * window, like it would with a [con_id=…] or [id=…] criterion prepended.
+ *
+ * Free the returned CommandResult with command_result_free().
+ *
+ */
+CommandResult *command_ir_run(CommandIR *ir, Con *con, xcb_window_t window);
+
+/**
+ * Returns true if running the given precompiled command n times in a row can
+ * be replaced by running it once with command_ir_run_repeated(), which is the
+ * case for a single 'resize grow|shrink' or 'move <direction>' command.
+ *
+ */
+bool command_ir_is_repeatable(const CommandIR *ir);
+
+/**
+ * Like command_ir_run(), but the command behaves as if it was run repeat times
+ * in a row. Only valid for commands for which command_ir_is_repeatable()
+ * returns true (or with repeat = 1).
+ *
+ */
+CommandResult *command_ir_run_repeated(CommandIR *ir, Con *con, xcb_window_t window, int repeat);
@@ -82,6 +82,20 @@ bool con_is_hidden(Con *con);
  */
 bool con_is_sticky(Con *con);
 
+/**
+ * Sets the sticky flag of the container and keeps the list of sticky
+ * containers (sticky_cons) up to date.
+ *
+ */
+void con_set_sticky(Con *con, bool sticky);
+
+/**
+ * Sets the scratchpad state of the container and keeps the list of scratchpad
+ * containers (scratchpad_cons) up to date.
+ *
+ */
+void con_set_scratchpad_state(Con *con, enum scratchpad_state state);
+
 /**
  * Returns true if this node has regular or floating children.
  *
@@ -166,6 +180,25 @@ bool con_inside_focused(Con *con);
  */
 bool con_has_parent(Con *con, Con *parent);
 
+/**
+ * Adds the container to the lookup indexes for its client window ID and frame
+ * ID. Needs to be called whenever con->window or con->frame changes.
+ *
+ */
+void con_index_add(Con *con);
+
+/**
+ * Removes the given client window ID from the lookup index.
+ *
+ */
+void con_index_remove_window(xcb_window_t window);
+
+/**
+ * Removes the given frame ID from the lookup index.
+ *
+ */
+void con_index_remove_frame(xcb_window_t frame);
+
 /**
  * Returns the container with the given client window ID or NULL if no such
  * container exists.
@@ -194,6 +227,21 @@ bool con_exists(Con *con);
  */
 Con *con_by_frame_id(xcb_window_t frame);
 
+/**
+ * Records the positions of the children's decorations of the given tabbed or
+ * stacked container after rendering it, so that con_child_at_deco_position()
+ * can use a binary search.
+ *
+ */
+void con_record_deco_slots(Con *con);
+
+/**
+ * Returns the child of con whose decoration contains the given coordinates
+ * (relative to con's rect, like deco_rect), or NULL if there is none.
+ *
+ */
+Con *con_child_at_deco_position(Con *con, int32_t x, int32_t y);
+
 /**
  * Returns the container with the given mark or NULL if no such container
  * exists.
@@ -231,8 +279,30 @@ void con_mark(Con *con, const char *mark, mark_mode_t mode);
 void con_unmark(Con *con, const char *name);
 
 /**
- * Returns the first container below 'con' which wants to swallow this window
- * TODO: priority
+ * Adds the given swallow criteria of con (which must already be in
+ * con->swallow_head) to the index used by con_for_window(). The criteria must
+ * not be changed until they are removed with con_swallow_index_remove().
+ *
+ */
+void con_swallow_index_add(Con *con, Match *match);
+
+/**
+ * Removes the given swallow criteria from the index used by con_for_window().
+ * Criteria which were never added are ignored.
+ *
+ */
+void con_swallow_index_remove(Con *con, Match *match);
+
+/**
+ * Removes and frees all swallow criteria of the given container.
+ *
+ */
+void con_clear_swallows(Con *con);
+
+/**
+ * Returns the first container below 'con' which wants to swallow this window,
+ * in the order of a preorder walk of the tree. Only the criteria which could
+ * match the window are checked.
  *
  */
 Con *con_for_window(Con *con, i3Window *window, Match **store_match);
@@ -317,6 +387,21 @@ void con_enable_fullscreen(Con *con, fullscreen_mode_t fullscreen_mode);
  */
 void con_disable_fullscreen(Con *con);
 
+/**
+ * Starts a batch of moves: until con_move_end() is called, moving containers
+ * (e.g. all windows matched by the criteria of a 'move' command) neither sends
+ * window::move events nor updates _NET_WM_DESKTOP of all windows.
+ *
+ */
+void con_move_begin(void);
+
+/**
+ * Ends a batch of moves: updates _NET_WM_DESKTOP once and sends the
+ * window::move events of the containers which still exist.
+ *
+ */
+void con_move_end(void);
+
 /**
  * Moves the given container to the currently focused container on the given
  * workspace.
@@ -490,6 +575,29 @@ bool con_fullscreen_permits_focusing(Con *con);
  */
 bool con_has_urgent_child(Con *con);
 
+/**
+ * Sets the urgent flag of the given container (without any of the side effects
+ * of con_set_urgency()) and updates the urgent_descendants counters of its
+ * ancestors.
+ *
+ */
+void con_set_urgent_flag(Con *con, bool urgent);
+
+/**
+ * Accounts for the urgency of con and its descendants in the urgent_descendants
+ * counters of its parent chain. con_attach() does this automatically, so this
+ * only needs to be called by code which links a container into the tree by
+ * hand (TAILQ_INSERT_* and setting ->parent).
+ *
+ */
+void con_count_urgency(Con *con);
+
+/**
+ * Reverts con_count_urgency(). con_detach() does this automatically.
+ *
+ */
+void con_uncount_urgency(Con *con);
+
 /**
  * Make all parent containers urgent if con is urgent or clear the urgent flag
  * of all parent containers if there are no more urgent children left.
@@ -509,6 +617,36 @@ void con_set_urgency(Con *con, bool urgent);
  */
 char *con_get_tree_representation(Con *con);
 
+/**
+ * Drops the cached tree representation of the given container and of all of
+ * its parents, which contain it. Needs to be called whenever the layout,
+ * window class or children of a container change.
+ *
+ */
+void con_invalidate_tree_representation(Con *con);
+
+/**
+ * Starts a section (like a render, see tree_render()) in which the tree
+ * is mostly read, so that con_get_workspace(), con_get_output(),
+ * con_inside_focused() and con_descend_focused() can cache their results in
+ * the containers. Sections nest. Only the calling thread uses the caches.
+ *
+ */
+void con_cache_begin(void);
+
+/**
+ * Ends a section started with con_cache_begin().
+ *
+ */
+void con_cache_end(void);
+
+/**
+ * Invalidates all cached results of con_get_workspace() and friends. Called
+ * whenever the focus or the tree structure changes.
+ *
+ */
+void con_cache_invalidate(void);
+
 /**
  * force parent split containers to be redrawn
  *
@@ -516,7 +654,53 @@ char *con_get_tree_representation(Con *con);
 void con_force_split_parents_redraw(Con *con);
 
 /**
- * Returns the window title considering the current title format.
+ * Marks the decorations of the given container (and everything below it) as
+ * needing a redraw and flags all of its parents so that x_push_changes() can
+ * skip unchanged subtrees.
+ *
+ */
+void con_set_dirty(Con *con);
+
+/**
+ * Makes x_push_changes() visit the workspace of the given container again,
+ * after it was skipped because it was hidden and all of its windows were
+ * already unmapped.
+ *
+ */
+void con_wake_workspace(Con *con);
+
+/**
+ * Sets the title format of the given container (NULL removes it) and compiles
+ * it, so that con_parse_title_format() does not need to parse it again.
+ *
+ */
+void con_set_title_format(Con *con, const char *format);
+
+/**
+ * Sets the sticky group of the given container (NULL removes it) and keeps the
+ * index of group members up to date.
+ *
+ */
+void con_set_sticky_group(Con *con, const char *sticky_group);
+
+/**
+ * Callback for con_foreach_sticky_group(), called with the members of one
+ * sticky group.
+ *
+ */
+typedef void (*sticky_group_cb_t)(Con **members, int num_members, void *userdata);
+
+/**
+ * Calls cb with the members of each sticky group. The callback must not change
+ * any sticky group.
+ *
+ */
+void con_foreach_sticky_group(sticky_group_cb_t cb, void *userdata);
+
+/**
+ * Returns the window title considering the current title format. The result
+ * belongs to the container and is cached until the window's title, class or
+ * instance changes, so it must not be freed.
  *
  */
 i3String *con_parse_title_format(Con *con);
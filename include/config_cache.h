@@ -0,0 +1,60 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * config_cache.c: An on-disk cache of the configuration file after variables
+ *                 were replaced, enabled with --config-cache.
+ *
+ */
+#pragma once
+
+#include <config.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * The path of the configuration cache file, or NULL if no cache is used.
+ *
+ */
+extern char *config_cache_path;
+
+/**
+ * Looks up an X resource, returning a newly allocated string or NULL.
+ *
+ */
+typedef char *(*config_cache_resource_cb)(const char *name);
+
+/**
+ * Returns the cached result of replacing the variables in the given
+ * configuration file contents, or NULL if there is none. The cached result is
+ * only used if every X resource which the configuration used still has the
+ * same value, looking them up with get_resource.
+ *
+ * The caller has to free() the result.
+ *
+ */
+char *config_cache_load(const char *raw, size_t raw_len, int *version, config_cache_resource_cb get_resource);
+
+/**
+ * Forgets the X resources recorded by config_cache_record_resource().
+ *
+ */
+void config_cache_reset_resources(void);
+
+/**
+ * Records that the configuration used the given X resource, which had the
+ * given value (or was not set if value is NULL).
+ *
+ */
+void config_cache_record_resource(const char *name, const char *value);
+
+/**
+ * Stores the result of replacing the variables in the given configuration
+ * file contents, together with the X resources recorded since the last
+ * config_cache_reset_resources().
+ *
+ */
+void config_cache_store(const char *raw, size_t raw_len, const char *text, int version);
@@ -47,7 +47,9 @@ CFGFUN(floating_maximum_size, const long width, const long height);
 CFGFUN(default_orientation, const char *orientation);
 CFGFUN(workspace_layout, const char *layout);
 CFGFUN(workspace_back_and_forth, const char *value);
+CFGFUN(workspace_switch_grab_server, const char *value);
 CFGFUN(focus_follows_mouse, const char *value);
+CFGFUN(focus_follows_mouse_delay, const long delay_ms);
 CFGFUN(mouse_warping, const char *value);
 CFGFUN(focus_wrapping, const char *value);
 CFGFUN(force_focus_wrapping, const char *value);
@@ -55,6 +57,8 @@ CFGFUN(force_xinerama, const char *value);
 CFGFUN(disable_randr15, const char *value);
 CFGFUN(fake_outputs, const char *outputs);
 CFGFUN(force_display_urgency_hint, const long duration_ms);
+CFGFUN(title_update_interval, const long interval_ms);
+CFGFUN(slow_frame_threshold, const long threshold_ms);
 CFGFUN(focus_on_window_activation, const char *mode);
 CFGFUN(title_align, const char *alignment);
 CFGFUN(show_marks, const char *value);
@@ -69,6 +73,8 @@ CFGFUN(popup_during_fullscreen, const char *value);
 CFGFUN(color, const char *colorclass, const char *border, const char *background, const char *text, const char *indicator, const char *child_border);
 CFGFUN(color_single, const char *colorclass, const char *color);
 CFGFUN(floating_modifier, const char *modifiers);
+CFGFUN(floating_resize_preview, const char *preview);
+CFGFUN(render_pacing, const char *pacing);
 CFGFUN(default_border, const char *windowtype, const char *border, const long width);
 CFGFUN(workspace, const char *workspace, const char *output);
 CFGFUN(binding, const char *bindtype, const char *modifiers, const char *key, const char *release, const char *border, const char *whole_window, const char *exclude_titlebar, const char *command);
@@ -93,11 +99,13 @@ CFGFUN(bar_color, const char *colorclass, const char *border, const char *backgr
 CFGFUN(bar_socket_path, const char *socket_path);
 CFGFUN(bar_tray_output, const char *output);
 CFGFUN(bar_tray_padding, const long spacing_px);
+CFGFUN(bar_status_redraw_interval, const long interval_ms);
 CFGFUN(bar_color_single, const char *colorclass, const char *color);
 CFGFUN(bar_status_command, const char *command);
 CFGFUN(bar_binding_mode_indicator, const char *value);
 CFGFUN(bar_workspace_buttons, const char *value);
 CFGFUN(bar_strip_workspace_numbers, const char *value);
 CFGFUN(bar_strip_workspace_name, const char *value);
+CFGFUN(bar_share_status_command, const char *value);
 CFGFUN(bar_start);
 CFGFUN(bar_finish);
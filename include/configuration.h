@@ -67,7 +67,6 @@ struct Colortriple {
 struct Variable {
     char *key;
     char *value;
-    char *next_match;
 
     SLIST_ENTRY(Variable)
     variables;
@@ -115,6 +114,11 @@ struct Config {
      * It is not planned to add any different focus models. */
     bool disable_focus_follows_mouse;
 
+    /** Time (in seconds) the pointer needs to stay on a window before focus
+     * follows it there. Windows which the pointer only crosses on its way
+     * are not focused. 0 focuses immediately. */
+    float focus_follows_mouse_delay;
+
     /** By default, when switching focus to a window on a different output
      * (e.g. focusing a window on workspace 3 on output VGA-1, coming from
      * workspace 2 on LVDS-1), the mouse cursor is warped to the center of
@@ -178,6 +182,11 @@ struct Config {
      * between two workspaces. */
     bool workspace_auto_back_and_forth;
 
+    /** Grab the X server while pushing the changes of a workspace switch, so
+     * that other clients (like compositors) only ever see the complete
+     * switch. */
+    bool workspace_switch_grab_server;
+
     /** By default, urgency is cleared immediately when switching to another
      * workspace leads to focusing the con with the urgency hint. When having
      * multiple windows on that workspace, the user needs to guess which
@@ -185,6 +194,17 @@ struct Config {
      * flag can be delayed using an urgency timer. */
     float workspace_urgency_timer;
 
+    /** Minimum interval (in seconds) between two title redraws caused by
+     * windows changing their title. Decorations and window::title IPC events
+     * of all title changes within this interval are flushed together once it
+     * expires. 0 disables rate limiting. */
+    float title_update_interval;
+
+    /** Event loop iterations which take longer than this (in seconds) are
+     * recorded by the flight recorder (see stats_frame_end()) and logged. 0
+     * disables recording. */
+    float slow_frame_threshold;
+
     /** Behavior when a window sends a NET_ACTIVE_WINDOW message. */
     enum {
         /* Focus if the target workspace is visible, set urgency hint otherwise. */
@@ -218,6 +238,25 @@ struct Config {
      * buttons to do things with floating windows (move, resize) */
     uint32_t floating_modifier;
 
+    /** How a floating window is shown while it is resized with the mouse */
+    enum {
+        /* resize (and re-render) the window on every pointer motion */
+        FRP_LIVE = 0,
+
+        /* only move an outline during the drag and resize the window once
+         * the button is released */
+        FRP_OUTLINE = 1,
+    } floating_resize_preview;
+
+    /** When the tree is rendered after events changed it */
+    enum {
+        /* after every batch of events */
+        RENDER_PACING_NONE = 0,
+
+        /* at most once per refresh interval of the fastest output */
+        RENDER_PACING_REFRESH = 1,
+    } render_pacing;
+
     /** Maximum and minimum dimensions of a floating window */
     int32_t floating_maximum_width;
     int32_t floating_maximum_height;
@@ -281,6 +320,10 @@ struct Barconfig {
     /* Padding around the tray icons. */
     int tray_padding;
 
+    /** Minimum time between two redraws caused by the status command, in
+     * milliseconds. Status lines arriving in between are coalesced. */
+    int status_redraw_interval;
+
     /** Path to the i3 IPC socket. This option is discouraged since programs
      * can find out the path by looking for the I3_SOCKET_PATH property on the
      * root window! */
@@ -333,6 +376,10 @@ struct Barconfig {
      * 'strip_workspace_name yes'. */
     bool strip_workspace_name;
 
+    /** Share the status command with other bars which run the same command?
+     * Configuration option is 'share_status_command yes'. */
+    bool share_status_command;
+
     /** Hide mode button? Configuration option is 'binding_mode_indicator no'
      * but we invert the bool for the same reason as hide_workspace_buttons.*/
     bool hide_binding_mode_indicator;
@@ -431,3 +478,11 @@ void ungrab_all_keys(xcb_connection_t *conn);
  *
  */
 void update_barconfig(void);
+
+/**
+ * Loads the font with the given pattern into config.font. Fonts which were
+ * loaded before in this session (e.g. by the previous configuration) are
+ * reused instead of being loaded again.
+ *
+ */
+void config_load_font(const char *pattern);
@@ -15,6 +15,7 @@
 #include <libsn/sn-launcher.h>
 
 #include <xcb/randr.h>
+#include <xcb/sync.h>
 #include <stdbool.h>
 #include <pcre.h>
 #include <sys/time.h>
@@ -48,6 +49,7 @@ typedef struct Match Match;
 typedef struct Assignment Assignment;
 typedef struct Window i3Window;
 typedef struct mark_t mark_t;
+typedef struct CommandIR CommandIR;
 
 /******************************************************************************
  * Helper types
@@ -183,6 +185,18 @@ struct width_height {
     uint32_t h;
 };
 
+/**
+ * The interval which the decoration of a child of a tabbed (x axis) or stacked
+ * (y axis) container occupies, relative to the container's rect. Recorded in
+ * rendering order by con_record_deco_slots().
+ *
+ */
+struct deco_slot {
+    int32_t start;
+    int32_t end;
+    struct Con *con;
+};
+
 /**
  * Stores the parameters for rendering a window decoration. This structure is
  * cached in every Con and no re-rendering will be done if the parameters have
@@ -200,6 +214,59 @@ struct deco_render_params {
     bool con_is_leaf;
 };
 
+/**
+ * Caches the rendered title row (marks and title text) of a window decoration
+ * so that x_draw_decoration() can copy it instead of shaping the text again
+ * when the decoration has to be redrawn for other reasons.
+ *
+ */
+struct title_cache {
+    surface_t surface;
+
+    /* The parameters the surface was rendered with. */
+    char *title;
+    bool title_is_markup;
+    char *marks;
+    color_t text;
+    color_t background;
+    int width;
+    int height;
+};
+
+/**
+ * A part of a compiled title_format, see struct title_template.
+ *
+ */
+struct title_template_segment {
+    enum {
+        TT_LITERAL = 0,
+        TT_TITLE,
+        TT_CLASS,
+        TT_INSTANCE
+    } type;
+    /* Only for TT_LITERAL. */
+    char *literal;
+    size_t literal_len;
+};
+
+/**
+ * A title_format compiled into segments of literal text and placeholders (see
+ * con_set_title_format()), together with its last expansion.
+ *
+ */
+struct title_template {
+    struct title_template_segment *segments;
+    int num_segments;
+
+    /* The last expansion (see con_parse_title_format()), which stays valid
+     * until one of the window fields it was expanded from changes. */
+    i3String *expanded;
+    xcb_window_t window_id;
+    uint32_t name_generation;
+    uint32_t class_generation;
+    bool pango_markup;
+};
+
 /**
  * Stores which workspace (by name or number) goes to which output.
  *
@@ -212,13 +279,40 @@ struct Workspace_Assignment {
     ws_assignments;
 };
 
+/**
+ * An entry of the table of ignored events (see add_ignore_event()), which is
+ * indexed by the lower bits of the sequence number.
+ *
+ */
 struct Ignore_Event {
-    int sequence;
-    int response_type;
+    /* The sequence number (lower 16 bits, as carried by events) this entry
+     * currently belongs to. */
+    uint16_t sequence;
+    /* Bitmask of the ignored response types (response_type & 0x7F). */
+    uint64_t response_types[2];
     time_t added;
+};
+
+/**
+ * Called when the X server reported an error for a request which was
+ * registered with add_error_callback(). data is the pointer which was passed
+ * to add_error_callback().
+ *
+ */
+typedef void (*error_callback_t)(xcb_generic_error_t *error, void *data);
+
+/**
+ * An entry of the queue of error callbacks (see add_error_callback()), which
+ * is ordered by sequence number.
+ *
+ */
+struct Error_Callback {
+    /* The full sequence number of the request. */
+    uint32_t sequence;
+    error_callback_t callback;
+    void *data;
 
-    SLIST_ENTRY(Ignore_Event)
-    ignore_events;
+    TAILQ_ENTRY(Error_Callback) callbacks;
 };
 
 /**
@@ -239,6 +333,10 @@ struct Startup_Sequence {
 
     TAILQ_ENTRY(Startup_Sequence)
     sequences;
+
+    /** position in the queue of completed sequences, ordered by delete_at */
+    TAILQ_ENTRY(Startup_Sequence)
+    expiring;
 };
 
 /**
@@ -254,6 +352,32 @@ struct regex {
     char *pattern;
     pcre *regex;
     pcre_extra *extra;
+    /** Unique (never reused) identifier, used as the key of regex_cache. */
+    uint32_t id;
+    /** If the pattern is an anchored literal (^literal$), the interned
+     * literal, see regex_matches_interned(). NULL otherwise. */
+    const char *literal;
+};
+
+/** Number of separate damaged areas each frame buffer remembers. */
+#define FRAME_DAMAGE_RECTS 4
+
+/** Number of match results each window remembers. */
+#define REGEX_CACHE_SIZE 16
+
+/**
+ * Remembers whether a regex matched a window field, as long as the field has
+ * not changed since (see regex_matches_cached()).
+ *
+ */
+struct regex_cache {
+    struct regex_cache_entry {
+        uint32_t regex_id;
+        uint32_t generation;
+        bool matches;
+    } entries[REGEX_CACHE_SIZE];
+    /* The entry to replace next. */
+    uint32_t next;
 };
 
 /**
@@ -333,10 +457,35 @@ struct Binding {
     /** Command, like in command mode */
     char *command;
 
+    /** The command, parsed when the binding was configured (NULL if it
+     * contains a parse error, see command_ir_compile()). */
+    CommandIR *command_ir;
+
     TAILQ_ENTRY(Binding)
     bindings;
 };
 
+/**
+ * Timestamps (see stats_now_ns()) of running a key binding, from handling its
+ * key event until the result was flushed to X11. See handle_key_press() and
+ * stats_binding_phase_t.
+ *
+ */
+struct binding_trace {
+    /** X11 timestamp of the key event (of the first one, if several presses
+     * were coalesced). */
+    xcb_timestamp_t event_time;
+
+    uint64_t start_ns;
+    uint64_t lookup_done_ns;
+    uint64_t command_start_ns;
+    uint64_t command_done_ns;
+    uint64_t render_done_ns;
+
+    /** Copy of the binding which ran, for the IPC event. */
+    Binding *binding;
+};
+
 /**
  * Holds a command specified by either an:
  * - exec-line
@@ -398,6 +547,10 @@ struct xoutput {
     /** x, y, width, height */
     Rect rect;
 
+    /** Refresh rate of the current mode in Hz, or 0 if unknown (e.g. when
+     * outputs are queried using RandR 1.5 monitors). */
+    double refresh_rate;
+
     TAILQ_ENTRY(xoutput)
     outputs;
 };
@@ -420,16 +573,25 @@ struct Window {
     uint32_t nr_assignments;
     Assignment **ran_assignments;
 
-    char *class_class;
-    char *class_instance;
+    /** WM_CLASS, interned (see intern_string()). */
+    const char *class_class;
+    const char *class_instance;
 
     /** The name of the window. */
     i3String *name;
 
     /** The WM_WINDOW_ROLE of this window (for example, the pidgin buddy window
      * sets "buddy list"). Useful to match specific windows in assignments or
-     * for_window. */
-    char *role;
+     * for_window. Interned (see intern_string()). */
+    const char *role;
+
+    /** Generations of the class/instance, name and role fields, bumped
+     * (from a global counter) whenever the field changes. Together with the
+     * regex id they key the regex_cache. */
+    uint32_t class_generation;
+    uint32_t name_generation;
+    uint32_t role_generation;
+    struct regex_cache regex_cache;
 
     /** Flag to force re-rendering the decoration upon changes */
     bool name_x_changed;
@@ -437,9 +599,31 @@ struct Window {
     /** Whether the application used _NET_WM_NAME */
     bool uses_net_wm_name;
 
+    /** Whether a window::title IPC event is still to be sent because the
+     * title changed while title updates were being rate limited. */
+    bool title_event_pending;
+
     /** Whether the application needs to receive WM_TAKE_FOCUS */
     bool needs_take_focus;
 
+    /** Whether the application supports WM_DELETE_WINDOW, see
+     * x_window_kill() */
+    bool supports_delete_window;
+
+    /** Whether the application supports _NET_WM_SYNC_REQUEST and set
+     * _NET_WM_SYNC_REQUEST_COUNTER, see sync_request.c. */
+    bool supports_sync_request;
+    xcb_sync_counter_t sync_counter;
+    /** The value sent with the last _NET_WM_SYNC_REQUEST. */
+    uint64_t sync_value;
+    /** The alarm which triggers once the client updated sync_counter to
+     * sync_value, created on the first sync request. */
+    xcb_sync_alarm_t sync_alarm;
+    /** Whether the client did not yet redraw after the last resize. Further
+     * resizes are deferred until it did (or sync_timeout fired). */
+    bool sync_pending;
+    struct ev_timer *sync_timeout;
+
     /** Whether this window accepts focus. We store this inverted so that the
      * default will be 'accepts focus'. */
     bool doesnt_accept_focus;
@@ -450,6 +634,13 @@ struct Window {
     /** The _NET_WM_DESKTOP for this window. */
     uint32_t wm_desktop;
 
+    /** The geometry (absolute coordinates) and border width of the last
+     * synthetic ConfigureNotify sent to this window, so that it is only sent
+     * again when they change (see fake_absolute_configure_notify()). */
+    xcb_rectangle_t notified_rect;
+    int notified_border_width;
+    bool notified;
+
     /** Whether the window says it is a dock window */
     enum { W_NODOCK = 0,
            W_DOCK_TOP = 1,
@@ -594,6 +785,10 @@ struct Assignment {
         char *output;
     } dest;
 
+    /** For A_COMMAND, the parsed command (NULL if it contains a parse error,
+     * see command_ir_compile()). */
+    CommandIR *command_ir;
+
     TAILQ_ENTRY(Assignment)
     assignments;
 };
@@ -621,6 +816,15 @@ struct Con {
      * inside this container (if any) sets the urgency hint, for example. */
     bool urgent;
 
+    /** Number of descendants (up to the workspace level) whose urgent flag is
+     * set, so that the urgency of a subtree can be read without walking it.
+     * Maintained by con_attach(), con_detach() and the urgency setters. */
+    int urgent_descendants;
+
+    /** Whether this container’s urgency is accounted for in the
+     * urgent_descendants counter of its parent chain. */
+    bool urgency_counted;
+
     /** This counter contains the number of UnmapNotify events for this
      * container (or, more precisely, for its ->frame) which should be ignored.
      * UnmapNotify events need to be ignored when they are caused by i3 itself,
@@ -633,6 +837,12 @@ struct Con {
     surface_t frame_buffer;
     bool pixmap_recreated;
 
+    /** Areas of frame_buffer which were drawn to but not yet copied to the
+     * frame (see x_damage_frame()). When more areas are damaged, they are
+     * merged into their bounding box. */
+    Rect frame_damage[FRAME_DAMAGE_RECTS];
+    int num_frame_damage;
+
     enum {
         CT_ROOT = 0,
         CT_OUTPUT = 1,
@@ -662,12 +872,32 @@ struct Con {
 
     char *name;
 
-    /** The format with which the window's name should be displayed. */
+    /** The format with which the window's name should be displayed. Set it
+     * with con_set_title_format(), which also compiles it. */
     char *title_format;
+    struct title_template *title_template;
+
+    /** Cached result of con_get_tree_representation() for split containers,
+     * see con_invalidate_tree_representation(). */
+    char *tree_representation;
+
+    /** Cached results of con_get_workspace(), con_get_output(),
+     * con_inside_focused(), con_descend_focused() and
+     * con_num_visible_children(), used while rendering. cache_fields says
+     * which of them are valid, and only if cache_generation is current (see
+     * con_cache_begin()). */
+    uint64_t cache_generation;
+    uint8_t cache_fields;
+    bool cached_inside_focused;
+    struct Con *cached_workspace;
+    struct Con *cached_output;
+    struct Con *cached_descend_focused;
+    int cached_num_visible_children;
 
     /* a sticky-group is an identifier which bundles several containers to a
      * group. The contents are shared between all of them, that is they are
-     * displayed on whichever of the containers is currently visible */
+     * displayed on whichever of the containers is currently visible. Set with
+     * con_set_sticky_group(). */
     char *sticky_group;
 
     /* user-definable marks to jump to this container later */
@@ -685,10 +915,30 @@ struct Con {
     struct Window *window;
 
     /* timer used for disabling urgency */
-    struct ev_timer *urgency_timer;
+    struct wheel_timer *urgency_timer;
 
     /** Cache for the decoration rendering */
     struct deco_render_params *deco_render_params;
+    /** For tabbed/stacked containers: the decorations of the children, sorted
+     * by position, see con_child_at_deco_position(). num_deco_slots is 0
+     * while the table is invalid. */
+    struct deco_slot *deco_slots;
+    int num_deco_slots;
+    int deco_slots_size;
+    /** Cache for the rendered title, see struct title_cache */
+    struct title_cache *title_cache;
+
+    /** Set when the decorations of this container and everything below it
+     * need to be redrawn in the next x_push_changes(). See con_set_dirty(). */
+    bool dirty;
+    /** Set when some descendant of this container is dirty. Subtrees without
+     * this flag are skipped when redrawing decorations. */
+    bool child_dirty;
+    /** Set on hidden workspaces once all of their windows have been unmapped.
+     * x_push_changes() does not descend into dormant workspaces; they are
+     * woken up when containers are attached to them or when they are shown
+     * (see con_wake_workspace()). */
+    bool dormant;
 
     /* Only workspace-containers can have floating clients */
     TAILQ_HEAD(floating_head, Con)
@@ -696,6 +946,10 @@ struct Con {
 
     TAILQ_HEAD(nodes_head, Con)
     nodes_head;
+    /** The number of containers in nodes_head, see con_num_children(). Kept
+     * up to date by everything which inserts into or removes from
+     * nodes_head. */
+    int num_children;
 
     TAILQ_HEAD(focus_head, Con)
     focus_head;
@@ -707,7 +961,7 @@ struct Con {
 
     /* Whether this window should stick to the glass. This corresponds to
      * the _NET_WM_STATE_STICKY atom and will only be respected if the
-     * window is floating. */
+     * window is floating. Only to be changed using con_set_sticky(). */
     bool sticky;
 
     /* layout is the layout of this container: one of split[v|h], stacked or
@@ -748,13 +1002,23 @@ struct Con {
     TAILQ_ENTRY(Con)
     all_cons;
 
+    /* Entry in sticky_cons while sticky is set. */
+    TAILQ_ENTRY(Con)
+    sticky_cons;
+
+    /* Entry in scratchpad_cons while scratchpad_state is not
+     * SCRATCHPAD_NONE. */
+    TAILQ_ENTRY(Con)
+    scratchpad_cons;
+
     TAILQ_ENTRY(Con)
     floating_windows;
 
     /** callbacks */
     void (*on_remove_child)(Con *);
 
-    enum {
+    /* Set with con_set_scratchpad_state(). */
+    enum scratchpad_state {
         /* Not a scratchpad window. */
         SCRATCHPAD_NONE = 0,
 
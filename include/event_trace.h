@@ -0,0 +1,65 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * event_trace.c: Recording the X11 events and IPC commands of a session into
+ *                a trace file (--record-trace) and replaying such a trace as a
+ *                benchmark (--replay-trace).
+ *
+ */
+#pragma once
+
+#include <config.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Starts recording into the given trace file. New records are appended, so
+ * that the trace continues across in-place restarts. Needs to be called once
+ * the atoms and the extensions are set up.
+ *
+ */
+bool event_trace_open(const char *path);
+
+/**
+ * Records an X11 event right before it is passed to handle_event().
+ *
+ */
+void event_trace_record_event(const xcb_generic_event_t *event);
+
+/**
+ * Records that the events of a batch were handled, i.e. that the event loop
+ * renders before handling further events.
+ *
+ */
+void event_trace_record_batch_end(void);
+
+/**
+ * Records an IPC command and the reply which was sent for it. The reply is
+ * only compared when replaying if reply_len is not 0.
+ *
+ */
+void event_trace_record_command(const char *command, const unsigned char *reply, size_t reply_len);
+
+/**
+ * Writes the records buffered since the last call to the trace file.
+ *
+ */
+void event_trace_flush(void);
+
+/**
+ * Returns true while a trace is replayed.
+ *
+ */
+bool event_trace_replaying(void);
+
+/**
+ * Replays the given trace against the X server i3 is connected to and prints
+ * the time spent handling each kind of event, running commands and rendering
+ * as JSON to stdout. Returns false if the trace could not be read.
+ *
+ */
+bool event_trace_replay(const char *path);
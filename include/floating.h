@@ -14,12 +14,12 @@
 #include "tree.h"
 
 /** Callback for dragging */
-typedef void (*callback_t)(Con *, Rect *, uint32_t, uint32_t, const void *);
+typedef void (*callback_t)(Con *, Rect *, uint32_t, uint32_t, void *);
 
 /** Macro to create a callback function for dragging */
 #define DRAGGING_CB(name)                                      \
     static void name(Con *con, Rect *old_rect, uint32_t new_x, \
-                     uint32_t new_y, const void *extra)
+                     uint32_t new_y, void *extra)
 
 /** On which border was the dragging initiated? */
 typedef enum { BORDER_LEFT = (1 << 0),
@@ -129,6 +129,9 @@ typedef enum {
     DRAG_ABORT
 } drag_result_t;
 
+/** Callback for the end of a drag, see drag_pointer() */
+typedef void (*drag_done_t)(drag_result_t, void *);
+
 /**
  * This function grabs your pointer and keyboard and lets you drag stuff around
  * (borders). Every time you move your mouse, an XCB_MOTION_NOTIFY event will
@@ -136,10 +139,27 @@ typedef enum {
  * specified (client, border on which the click originally was), the original
  * rect of the client, the event and the new coordinates (x, y).
  *
+ * The drag is not modal: this function returns right away and the events of
+ * the drag are handled by drag_handle_event() in the main event loop. Once the
+ * drag ended (or if it could not be started), done is called with the result
+ * and extra.
+ *
+ */
+void drag_pointer(Con *con, const xcb_button_press_event_t *event,
+                  xcb_window_t confine_to, border_t border, int cursor,
+                  callback_t callback, drag_done_t done, void *extra);
+
+/**
+ * Handles the events which belong to the drag in progress, if any: pointer
+ * movements are passed to the drag's callback (at most once per frame), the
+ * button release ends the drag, a key press reverts it and unmapping a window
+ * on the current workspace aborts it.
+ *
+ * Returns true if the event was consumed; all other events are handled by
+ * handle_event() as usual, so the rest of i3 keeps running during a drag.
+ *
  */
-drag_result_t drag_pointer(Con *con, const xcb_button_press_event_t *event,
-                           xcb_window_t confine_to, border_t border, int cursor,
-                           callback_t callback, const void *extra);
+bool drag_handle_event(int type, xcb_generic_event_t *event);
 
 /**
  * Repositions the CT_FLOATING_CON to have the coordinates specified by
@@ -17,6 +17,7 @@
 extern int randr_base;
 extern int xkb_base;
 extern int shape_base;
+extern int sync_base;
 
 /**
  * Adds the given sequence to the list of events which are ignored.
@@ -28,12 +29,80 @@ extern int shape_base;
  */
 void add_ignore_event(const int sequence, const int response_type);
 
+/**
+ * Like add_ignore_event(), but ignores all sequence numbers from first up to
+ * and including last. This is used to ignore all events caused by a batch of
+ * requests.
+ *
+ */
+void add_ignore_event_range(const int first, const int last, const int response_type);
+
 /**
  * Checks if the given sequence is ignored and returns true if so.
  *
  */
 bool event_is_ignored(const int sequence, const int response_type);
 
+/**
+ * Registers a callback which is called when the X server reports an error for
+ * the request with the given sequence number. This allows sending unchecked
+ * requests instead of waiting for the result with xcb_request_check(): the
+ * error is handled once the event loop receives it.
+ *
+ * data is not owned by the queue, so it should not point to memory which
+ * needs to be freed. Callbacks of requests which succeeded are dropped once a
+ * later event arrives (see retire_error_callbacks()).
+ *
+ */
+void add_error_callback(const unsigned int sequence, error_callback_t callback, void *data);
+
+/**
+ * Drops the error callbacks of all requests sent before the request with the
+ * given full sequence number. Called for everything the X server sends: since
+ * it handles requests in order, these requests succeeded if no error arrived
+ * for them so far.
+ *
+ */
+void retire_error_callbacks(const uint32_t sequence);
+
+/**
+ * Calls the callback registered for the request the given error belongs to.
+ * Returns false if no callback was registered.
+ *
+ */
+bool handle_error_callback(xcb_generic_error_t *error);
+
+/**
+ * Sends the GetProperty request for the given PropertyNotify event right
+ * away, so that the replies for a whole batch of events can be received with
+ * a single round trip (see xcb_prepare_cb()). The reply is picked up by
+ * property_notify() when the event is handled.
+ *
+ */
+void property_notify_prefetch(xcb_property_notify_event_t *event);
+
+/**
+ * Discards the replies of all prefetched properties which were not picked up
+ * by property_notify().
+ *
+ */
+void property_notify_discard_prefetched(void);
+
+/**
+ * Handles the given reply to a GetProperty request as if the property had just
+ * been changed (see manage_handle_deferred()). Takes ownership of reply.
+ *
+ */
+void property_notify_reply(xcb_window_t window, xcb_atom_t atom, xcb_get_property_reply_t *reply);
+
+/**
+ * Writes the name of the latency histogram the given event is accounted to
+ * into buf (see stats_histogram_for()). PropertyNotify and ClientMessage
+ * events are told apart by their atom, extension events by their extension.
+ *
+ */
+void event_stats_name(int type, xcb_generic_event_t *event, char *buf, size_t len);
+
 /**
  * Takes an xcb_generic_event_t and calls the appropriate handler, based on the
  * event type.
@@ -66,6 +66,18 @@ typedef struct i3_ipc_header {
 /** Trigger an i3 sync protocol message via IPC. */
 #define I3_IPC_MESSAGE_TYPE_SYNC 11
 
+/** Request the render pipeline timing counters. */
+#define I3_IPC_MESSAGE_TYPE_GET_STATS 12
+
+/** Switch the encoding of replies and events on this connection. */
+#define I3_IPC_MESSAGE_TYPE_SET_ENCODING 13
+
+/** Run a list of commands, rendering the tree only once at the end. */
+#define I3_IPC_MESSAGE_TYPE_RUN_COMMANDS 14
+
+/** Request the traffic counters of all IPC connections. */
+#define I3_IPC_MESSAGE_TYPE_GET_CLIENTS 15
+
 /*
  * Messages from i3 to clients
  *
@@ -82,6 +94,10 @@ typedef struct i3_ipc_header {
 #define I3_IPC_REPLY_TYPE_CONFIG 9
 #define I3_IPC_REPLY_TYPE_TICK 10
 #define I3_IPC_REPLY_TYPE_SYNC 11
+#define I3_IPC_REPLY_TYPE_STATS 12
+#define I3_IPC_REPLY_TYPE_SET_ENCODING 13
+#define I3_IPC_REPLY_TYPE_COMMANDS 14
+#define I3_IPC_REPLY_TYPE_CLIENTS 15
 
 /*
  * Events from i3 to clients. Events have the first bit set high.
@@ -112,3 +128,6 @@ typedef struct i3_ipc_header {
 
 /** The tick event will be sent upon a tick IPC message */
 #define I3_IPC_EVENT_TICK (I3_IPC_EVENT_MASK | 7)
+
+/** The tree event will be sent with the changes to the tree after each render */
+#define I3_IPC_EVENT_TREE (I3_IPC_EVENT_MASK | 8)
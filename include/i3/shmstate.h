@@ -0,0 +1,83 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * This public header defines the layout of the shared memory state snapshot,
+ * which i3 publishes for status bars and similar tools (see docs/ipc for more
+ * information).
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+
+/* Increased whenever the layout of the segment changes incompatibly. */
+#define I3_SHMSTATE_VERSION 1
+
+#define I3_SHMSTATE_NAME_LEN 64
+#define I3_SHMSTATE_MAX_OUTPUTS 32
+#define I3_SHMSTATE_MAX_WORKSPACES 256
+
+/* Flags of i3_shmstate_workspace. */
+#define I3_SHMSTATE_WS_FOCUSED (1 << 0)
+#define I3_SHMSTATE_WS_VISIBLE (1 << 1)
+#define I3_SHMSTATE_WS_URGENT (1 << 2)
+
+/* Flags of i3_shmstate_output. */
+#define I3_SHMSTATE_OUTPUT_PRIMARY (1 << 0)
+
+/* Flags of i3_shmstate_header. */
+#define I3_SHMSTATE_TRUNCATED (1 << 0)
+
+typedef struct i3_shmstate_rect {
+    int32_t x;
+    int32_t y;
+    uint32_t width;
+    uint32_t height;
+} i3_shmstate_rect;
+
+typedef struct i3_shmstate_output {
+    /* NUL-terminated, truncated to I3_SHMSTATE_NAME_LEN - 1 bytes. */
+    char name[I3_SHMSTATE_NAME_LEN];
+    i3_shmstate_rect rect;
+    /* Index into workspaces of the visible workspace, or -1. */
+    int32_t current_workspace;
+    uint32_t flags;
+} i3_shmstate_output;
+
+typedef struct i3_shmstate_workspace {
+    /* NUL-terminated, truncated to I3_SHMSTATE_NAME_LEN - 1 bytes. */
+    char name[I3_SHMSTATE_NAME_LEN];
+    /* The workspace number or -1 for named workspaces. */
+    int32_t num;
+    /* Index into outputs of the output this workspace is on. */
+    int32_t output;
+    i3_shmstate_rect rect;
+    uint32_t flags;
+} i3_shmstate_workspace;
+
+/**
+ * The shared memory state segment. Its name is stored in the I3_STATE_PATH
+ * atom on the root window.
+ *
+ * The segment is protected by a seqlock: sequence is odd while i3 is writing.
+ * Readers load sequence (retrying while it is odd), copy the data they need,
+ * and retry if sequence changed in the meantime. Since i3 only writes when the
+ * state actually changed, readers can also poll sequence cheaply.
+ *
+ */
+typedef struct i3_shmstate_header {
+    uint32_t version;
+    /* The size of the segment in bytes. */
+    uint32_t size;
+    volatile uint32_t sequence;
+    uint32_t flags;
+
+    uint32_t num_outputs;
+    uint32_t num_workspaces;
+
+    i3_shmstate_output outputs[I3_SHMSTATE_MAX_OUTPUTS];
+    i3_shmstate_workspace workspaces[I3_SHMSTATE_MAX_WORKSPACES];
+} i3_shmstate_header;
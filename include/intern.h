@@ -0,0 +1,29 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * intern.c: Interned (deduplicated and reference counted) strings. Equal
+ *           interned strings are the same pointer, so they can be compared
+ *           without looking at their contents.
+ *
+ */
+#pragma once
+
+#include <config.h>
+
+/**
+ * Returns the interned copy of the first len bytes of str (which must not
+ * contain a NUL byte) and takes a reference on it. The result is
+ * NUL-terminated and must be released with intern_release().
+ *
+ */
+const char *intern_string(const char *str, size_t len);
+
+/**
+ * Releases a reference on the given interned string, freeing it when this was
+ * the last reference. Does nothing when str is NULL.
+ *
+ */
+void intern_release(const char *str);
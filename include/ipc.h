@@ -24,22 +24,165 @@
 
 extern char *current_socketpath;
 
+/* A serialized message (header and payload). Events are serialized once and
+ * shared by the queues of all subscribed clients. */
+struct ipc_message {
+    int refcount;
+    size_t size;
+    /* The same message encoded as CBOR, created when it is first queued for
+     * a client which negotiated that encoding. */
+    struct ipc_message *cbor;
+    /* Large replies are generated in fragments (see ipc_stream_print()) which
+     * are sent one after another. Only the first fragment starts with the
+     * header, its size covers all fragments. */
+    struct ipc_message *next;
+    uint8_t data[];
+};
+
+/* What happens to the events of a client which does not read them fast
+ * enough, once its queue exceeds IPC_QUEUE_LIMIT. Chosen per event type with
+ * the "backpressure" key of a subscription filter. */
+typedef enum {
+    /* The client is disconnected. */
+    IPC_BACKPRESSURE_DISCONNECT = 0,
+    /* Events which supersede a queued event (see coalesce_kind()) replace
+     * it, all others are dropped like with IPC_BACKPRESSURE_DROP. */
+    IPC_BACKPRESSURE_COALESCE,
+    /* Events are dropped. Once the queue is empty, the client receives an
+     * event with the change "events_lost" for each affected event type. */
+    IPC_BACKPRESSURE_DROP,
+} ipc_backpressure_t;
+
+/* The number of bytes of events which can be queued for a client before its
+ * backpressure policy applies. Replies are always queued. */
+#define IPC_QUEUE_LIMIT (4 * 1024 * 1024)
+
+/* A subscription to one event type which only matches some of its events.
+ * Criteria which are not set match any event. */
+struct ipc_event_filter {
+    uint32_t message_type;
+
+    /* The accepted values of the event's "change" field. */
+    char **changes;
+    int num_changes;
+
+    /* Criteria for the window of the event, see match_matches_window(). */
+    bool has_match;
+    Match match;
+
+    char *workspace;
+    char *output;
+
+    /* Whether matching workspace and window events are sent with only the
+     * IDs of the children of their containers ("payload": "shallow"). */
+    bool shallow;
+
+    /* The backpressure policy for the event type, if the filter has one. */
+    bool has_backpressure;
+    ipc_backpressure_t backpressure;
+
+    TAILQ_ENTRY(ipc_event_filter)
+    filters;
+};
+
+/* Describes an event for evaluating subscription filters. */
+struct ipc_event_info {
+    const char *change;
+    /* The container of the event. Only used to identify events which
+     * supersede each other, it is never dereferenced. */
+    Con *con;
+    /* Only valid while the container of the event exists. */
+    i3Window *window;
+    char *workspace;
+    char *output;
+};
+
+/* The encodings of replies and events, see I3_IPC_MESSAGE_TYPE_SET_ENCODING. */
+typedef enum {
+    IPC_ENCODING_JSON = 0,
+    IPC_ENCODING_CBOR = 1,
+} ipc_encoding_t;
+
+/* A message queued for sending to a client. */
+struct ipc_chunk {
+    struct ipc_message *message;
+
+    /* For events which are superseded by a later event of the same kind for
+     * the same container while messages are held (see ipc_hold_messages())
+     * or when the client's queue is full (see IPC_BACKPRESSURE_COALESCE):
+     * the kind of event (0 for all other messages), the container and the
+     * hold during which the chunk was queued. */
+    int coalesce_kind;
+    Con *coalesce_con;
+    uint64_t hold_generation;
+
+    /* Whether the message is an event (and counts towards
+     * ipc_client.queued_event_bytes). */
+    bool is_event;
+
+    TAILQ_ENTRY(ipc_chunk)
+    chunks;
+};
+
 typedef struct ipc_client {
     int fd;
 
-    /* The events which this client wants to receive */
-    int num_events;
-    char **events;
+    /* The events which this client wants to receive, as a bitmask of
+     * (1 << (I3_IPC_EVENT_* & ~I3_IPC_EVENT_MASK)). Of these, the ones in
+     * unfiltered_events are always sent, the others only when one of the
+     * filters matches. */
+    uint32_t events;
+    uint32_t unfiltered_events;
+    TAILQ_HEAD(ipc_event_filters_head, ipc_event_filter)
+    filters_head;
 
     /* For clients which subscribe to the tick event: whether the first tick
      * event has been sent by i3. */
     bool first_tick_sent;
 
+    ipc_encoding_t encoding;
+
     struct ev_io *read_callback;
     struct ev_io *write_callback;
-    struct ev_timer *timeout;
-    uint8_t *buffer;
-    size_t buffer_size;
+    struct wheel_timer *timeout;
+
+    /* Messages which were not (completely) written to the socket yet. Of the
+     * first one, first_chunk_offset bytes were written already. */
+    TAILQ_HEAD(ipc_chunks_head, ipc_chunk)
+    chunks_head;
+    size_t first_chunk_offset;
+
+    /* The backpressure policy per event type, indexed like the bits of
+     * events, and the bytes of the queued events it applies to. */
+    ipc_backpressure_t backpressure[32];
+    size_t queued_event_bytes;
+    /* The number of events per event type which were dropped since the last
+     * "events_lost" event of that type. */
+    uint32_t events_lost[32];
+    /* Set when the client exceeded IPC_QUEUE_LIMIT with the disconnect
+     * policy. Nothing is queued anymore until it is disconnected. */
+    bool overflowed;
+
+    /* Bytes received from the client which were not handled yet: possibly
+     * several complete messages, followed by the start of the next one. */
+    uint8_t *read_buffer;
+    size_t read_buffer_len;
+    size_t read_buffer_size;
+
+    /* Traffic counters, reported by GET_CLIENTS. queued_bytes is the size of
+     * the messages in chunks_head which were not written yet, and
+     * queued_bytes_max its high-water mark. events_coalesced counts the
+     * events which were dropped because a later one superseded them,
+     * events_dropped the ones dropped by the backpressure policy. */
+    uint64_t bytes_received;
+    uint64_t messages_received;
+    uint64_t bytes_sent;
+    uint64_t messages_sent;
+    uint64_t events_coalesced;
+    uint64_t events_dropped;
+    size_t queued_bytes;
+    size_t queued_bytes_max;
+    uint64_t handler_ns;
 
     TAILQ_ENTRY(ipc_client)
     clients;
@@ -89,12 +232,49 @@ ipc_client *ipc_new_client_on_fd(EV_P_ int fd);
  */
 int ipc_create_socket(const char *filename);
 
+/**
+ * Returns true if any IPC client is subscribed to the given event type
+ * (I3_IPC_EVENT_*). Used to avoid marshalling events nobody receives.
+ *
+ */
+bool ipc_has_event_listeners(uint32_t message_type);
+
+/**
+ * Fills in the description of an event concerning the given container (which
+ * may be NULL) for evaluating subscription filters. Free with
+ * ipc_event_info_free().
+ *
+ */
+void ipc_event_info_init(struct ipc_event_info *info, const char *change, Con *con);
+
+/**
+ * Frees the strings of an event description.
+ *
+ */
+void ipc_event_info_free(struct ipc_event_info *info);
+
+/**
+ * Returns true if any IPC client wants to receive the described event, i.e.
+ * is subscribed to its type and does not filter it out.
+ *
+ */
+bool ipc_event_has_recipients(uint32_t message_type, const struct ipc_event_info *info);
+
 /**
  * Sends the specified event to all IPC clients which are currently connected
- * and subscribed to this kind of event.
+ * and subscribed to this kind of event. Subscription filters are evaluated
+ * against info; if info is NULL, filters are ignored.
  *
  */
-void ipc_send_event(const char *event, uint32_t message_type, const char *payload);
+void ipc_send_event(uint32_t message_type, const char *payload, const struct ipc_event_info *info);
+
+/**
+ * Like ipc_send_event(), but with the payload generated by gen, which must
+ * have been obtained by ipc_gen_get(). Clients using CBOR get the payload
+ * which was generated along with the JSON one.
+ *
+ */
+void ipc_send_event_gen(uint32_t message_type, yajl_gen gen, const struct ipc_event_info *info);
 
 /**
  * Calls to ipc_shutdown() should provide a reason for the shutdown.
@@ -104,6 +284,19 @@ typedef enum {
     SHUTDOWN_REASON_EXIT
 } shutdown_reason_t;
 
+/**
+ * Stops writing messages (replies and events) to the clients. They are queued
+ * in order and written by ipc_release_messages().
+ *
+ */
+void ipc_hold_messages(void);
+
+/**
+ * Writes all messages queued since ipc_hold_messages().
+ *
+ */
+void ipc_release_messages(void);
+
 /**
  * Calls shutdown() on each socket and closes it. This function is to be called
  * when exiting or restarting only!
@@ -116,11 +309,36 @@ void ipc_shutdown(shutdown_reason_t reason, int exempt_fd);
 void dump_node(yajl_gen gen, Con *con, bool inplace_restart);
 
 /**
- * Generates a json workspace event. Returns a dynamically allocated yajl
- * generator. Free with yajl_gen_free().
+ * Returns a yajl generator for an IPC reply or event, reusing an idle one
+ * (and its buffer) if possible. Return it with ipc_gen_put().
+ */
+yajl_gen ipc_gen_get(void);
+
+/**
+ * Returns a generator obtained by ipc_gen_get() to the pool. Its buffer is
+ * cleared and must not be used anymore.
+ */
+void ipc_gen_put(yajl_gen gen);
+
+/**
+ * Generates a json workspace event. Returns a yajl generator obtained by
+ * ipc_gen_get(). Return it with ipc_gen_put().
  */
 yajl_gen ipc_marshal_workspace_event(const char *change, Con *current, Con *old);
 
+/**
+ * Drops the cached GET_WORKSPACES and GET_OUTPUTS replies. Must be called
+ * whenever a workspace, an output or the focus changes.
+ */
+void ipc_invalidate_cached_replies(void);
+
+/**
+ * Drops the cached GET_TREE reply. Must be called whenever anything which is
+ * part of the dump may have changed: renders (scheduled or not), changes
+ * pushed to X11, commands and window properties which are dumped.
+ */
+void ipc_invalidate_tree_reply(void);
+
 /**
  * For the workspace events we send, along with the usual "change" field, also
  * the workspace container in "current". For focus events, we send the
@@ -134,16 +352,47 @@ void ipc_send_workspace_event(const char *change, Con *current, Con *old);
  */
 void ipc_send_window_event(const char *property, Con *con);
 
+/**
+ * Sends the window "mapped" event for a new window once its frame was mapped
+ * and focused, along with how long each phase of managing it took (see
+ * stats_map_phase_t), in "latency_ns".
+ */
+void ipc_send_window_mapped_event(Con *con, const uint64_t *latency_ns);
+
 /**
  * For the barconfig update events, we send the serialized barconfig.
  */
 void ipc_send_barconfig_update_event(Barconfig *barconfig);
 
+/**
+ * Returns the bar configuration serialized like in barconfig_update events.
+ * The caller has to free() the result.
+ *
+ */
+char *ipc_bar_config_json(Barconfig *barconfig);
+
 /**
  * For the binding events, we send the serialized binding struct.
  */
 void ipc_send_binding_event(const char *event_type, Binding *bind);
 
+/**
+ * Sends the binding "run" event for a key binding once its result was flushed
+ * to X11, along with the X11 timestamp of the key event in "event_time" and
+ * how long each phase of running the binding took (see stats_binding_phase_t)
+ * in "latency_ns".
+ */
+void ipc_send_binding_run_event(Binding *bind, xcb_timestamp_t event_time, const uint64_t *latency_ns);
+
+/**
+ * Compares the tree to the snapshot taken at the last call and sends a tree
+ * event to the subscribed clients with the containers which were added,
+ * removed, moved to a different position or whose fields changed. Called after
+ * every push of changes to X11.
+ *
+ */
+void ipc_send_tree_event(void);
+
 /**
   * Set the maximum duration that we allow for a connection with an unwriteable
   * socket.
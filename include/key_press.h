@@ -18,6 +18,39 @@
  */
 void handle_key_press(xcb_key_press_event_t *event);
 
+/**
+ * Starts coalescing key presses: until key_press_coalesce_end() is called,
+ * consecutive presses of the same resize or move binding (e.g. by key
+ * autorepeat) are accumulated and run as one command.
+ *
+ * Called before handling a KeyPress or KeyRelease event of a batch, see
+ * xcb_prepare_cb().
+ *
+ */
+void key_press_coalesce_begin(void);
+
+/**
+ * Runs the coalesced binding (if any) and stops coalescing. Called before
+ * handling any other event and before rendering, so that the order of
+ * commands and other events is preserved.
+ *
+ */
+void key_press_coalesce_end(void);
+
+/**
+ * Marks the bindings which ran so far as rendered. Called after each
+ * tree_render_flush() in xcb_prepare_cb().
+ *
+ */
+void key_press_trace_rendered(void);
+
+/**
+ * Records the latency of the bindings which ran since the last call and sends
+ * their binding events. Called right after xcb_flush() in xcb_prepare_cb().
+ *
+ */
+void key_press_trace_flushed(void);
+
 /**
  * Kills the commanderror i3-nagbar process, if any.
  *
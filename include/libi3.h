@@ -21,6 +21,7 @@
 
 #include <pango/pango.h>
 #include <cairo/cairo-xcb.h>
+#include <yajl/yajl_gen.h>
 
 #define DEFAULT_DIR_MODE (S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH)
 
@@ -79,11 +80,20 @@ struct Font {
 
             /** Font table for this font (may be NULL) */
             xcb_charinfo_t *table;
+
+            /** Glyph widths queried from the server one row (first byte of
+             * the UCS-2 glyph) at a time, used when there is no font table
+             * (NULL otherwise). */
+            int **glyph_widths;
         } xcb;
 
         /** The pango font description */
         PangoFontDescription *pango_desc;
     } specific;
+
+    /** Long-lived context for measuring and drawing text with a Pango font,
+     * including a cache of shaped text layouts (NULL for other fonts). */
+    struct text_measure *measure;
 };
 
 /* Since this file also gets included by utilities which don’t use the i3 log
@@ -159,6 +169,42 @@ char *sstrndup(const char *str, size_t size);
  */
 int sasprintf(char **strp, const char *fmt, ...);
 
+/** The allocating safe-wrappers, see alloc_get_counter(). */
+typedef enum {
+    ALLOC_MALLOC = 0,
+    ALLOC_CALLOC,
+    ALLOC_REALLOC,
+    ALLOC_STRDUP,
+    ALLOC_STRNDUP,
+    ALLOC_ASPRINTF,
+    ALLOC_NUM_FUNCTIONS
+} alloc_function_t;
+
+/**
+ * Number of calls of one of the safe-wrappers and the number of bytes
+ * requested by them, since the process was started. Frees are not accounted,
+ * as memory is released with free() directly.
+ *
+ */
+typedef struct alloc_counter {
+    uint64_t calls;
+    uint64_t bytes;
+} alloc_counter_t;
+
+/**
+ * Returns the allocation counter of the given safe-wrapper. The counters are
+ * updated atomically, so this can be called while other threads allocate.
+ *
+ */
+void alloc_get_counter(alloc_function_t function, alloc_counter_t *counter);
+
+/**
+ * Returns the name of the given safe-wrapper's underlying function, like
+ * "malloc".
+ *
+ */
+const char *alloc_function_name(alloc_function_t function);
+
 /**
  * Wrapper around correct write which returns -1 (meaning that
  * write failed) or count (meaning that all bytes were written)
@@ -312,6 +358,165 @@ int ipc_send_message(int sockfd, const uint32_t message_size,
 int ipc_recv_message(int sockfd, uint32_t *message_type,
                      uint32_t *reply_length, uint8_t **reply);
 
+/**
+ * One message for ipc_send_messages().
+ *
+ */
+typedef struct ipc_message_t {
+    uint32_t type;
+    uint32_t size;
+    const uint8_t *payload;
+} ipc_message_t;
+
+/**
+ * Formats all given messages into one buffer and sends them to i3 with as
+ * few write() calls as possible, so that several requests can be pipelined
+ * and their replies read as they arrive.
+ *
+ * Returns -1 when write() fails, errno will remain.
+ * Returns 0 on success.
+ *
+ */
+int ipc_send_messages(int sockfd, const ipc_message_t *messages, size_t num_messages);
+
+/**
+ * Opaque incremental IPC message reader. Event-driven clients read whatever
+ * is available on a non-blocking socket into it and take out complete
+ * messages, instead of blocking until a whole message arrived.
+ *
+ */
+typedef struct ipc_reader ipc_reader_t;
+
+/**
+ * Creates a new IPC message reader.
+ *
+ */
+ipc_reader_t *ipc_reader_new(void);
+
+/**
+ * Frees the IPC message reader, including any partially received message.
+ *
+ */
+void ipc_reader_free(ipc_reader_t *reader);
+
+/**
+ * Feeds the given bytes to the reader. At most the bytes up to the end of the
+ * current message are consumed; the number of consumed bytes is returned, so
+ * that the caller can fetch the message with ipc_reader_next_message() and
+ * feed the remaining bytes afterwards.
+ *
+ */
+size_t ipc_reader_feed(ipc_reader_t *reader, const uint8_t *data, size_t len);
+
+/**
+ * Reads the bytes which are available on the given (non-blocking) socket file
+ * descriptor, up to the end of the current message, with a single read().
+ *
+ * Returns the number of bytes read.
+ * Returns -1 when read() fails, errno will remain (EAGAIN means that no more
+ * data is available for now).
+ * Returns -2 on EOF.
+ * Returns -3 when the IPC protocol is violated (invalid magic, EOF in the
+ * middle of a message). Additionally, the error will be printed to stderr.
+ *
+ */
+ssize_t ipc_reader_read(ipc_reader_t *reader, int sockfd);
+
+/**
+ * Returns the next complete message, if any. The payload is NUL-terminated
+ * and has to be freed by the caller.
+ *
+ * Returns 1 and stores the message when one is complete.
+ * Returns 0 when more data is needed.
+ * Returns -3 when the IPC protocol is violated.
+ *
+ */
+int ipc_reader_next_message(ipc_reader_t *reader, uint32_t *message_type,
+                            uint32_t *reply_length, uint8_t **reply);
+
+/** Generates a CBOR data item, see cbor_gen_alloc(). */
+typedef struct cbor_gen cbor_gen_t;
+
+/**
+ * Returns a new, empty CBOR generator. Values are added to it through a JSON
+ * generator it is attached to, see ygen_attach_cbor().
+ *
+ */
+cbor_gen_t *cbor_gen_alloc(void);
+
+/**
+ * Frees the given CBOR generator and its buffer.
+ *
+ */
+void cbor_gen_free(cbor_gen_t *gen);
+
+/**
+ * Empties the buffer of the given CBOR generator (keeping its allocation), so
+ * that it can generate the next data item.
+ *
+ */
+void cbor_gen_clear(cbor_gen_t *gen);
+
+/**
+ * Returns the data generated so far and stores its length in len. The buffer
+ * belongs to the generator.
+ *
+ */
+const uint8_t *cbor_gen_get_buf(cbor_gen_t *gen, size_t *len);
+
+/**
+ * Attaches the given CBOR generator to the given JSON generator, so that all
+ * values generated through the y() macro (see yajl_utils.h) are generated as
+ * CBOR, too. Returns false if too many generators have one attached already.
+ *
+ */
+bool ygen_attach_cbor(yajl_gen gen, cbor_gen_t *cbor);
+
+/**
+ * Returns the CBOR generator attached to the given JSON generator, or NULL.
+ *
+ */
+cbor_gen_t *ygen_get_cbor(yajl_gen gen);
+
+/**
+ * Detaches the CBOR generator from the given JSON generator and returns it,
+ * or returns NULL if none was attached.
+ *
+ */
+cbor_gen_t *ygen_detach_cbor(yajl_gen gen);
+
+/**
+ * The functions which y() calls: they generate a value like their
+ * yajl_gen_*() counterparts, and as CBOR if a CBOR generator is attached (see
+ * ygen_attach_cbor()).
+ *
+ */
+yajl_gen_status ygen_null(yajl_gen gen);
+yajl_gen_status ygen_bool(yajl_gen gen, int val);
+yajl_gen_status ygen_integer(yajl_gen gen, long long val);
+yajl_gen_status ygen_double(yajl_gen gen, double val);
+yajl_gen_status ygen_string(yajl_gen gen, const unsigned char *val, size_t len);
+yajl_gen_status ygen_map_open(yajl_gen gen);
+yajl_gen_status ygen_map_close(yajl_gen gen);
+yajl_gen_status ygen_array_open(yajl_gen gen);
+yajl_gen_status ygen_array_close(yajl_gen gen);
+
+/**
+ * Converts the given JSON document to CBOR. Returns a newly allocated buffer
+ * and stores its length in cbor_len, or returns NULL if the JSON could not be
+ * parsed.
+ *
+ */
+uint8_t *json_to_cbor(const uint8_t *json, size_t json_len, size_t *cbor_len);
+
+/**
+ * Converts the given CBOR data item to JSON. Returns a newly allocated,
+ * NUL-terminated string and stores its length in json_len, or returns NULL if
+ * the CBOR is malformed.
+ *
+ */
+char *cbor_to_json(const uint8_t *cbor, size_t cbor_len, size_t *json_len);
+
 /**
  * Generates a configure_notify event and sends it to the given window
  * Applications need this to think they’ve configured themselves correctly.
@@ -634,3 +839,181 @@ void draw_util_clear_surface(surface_t *surface, color_t color);
  */
 void draw_util_copy_surface(surface_t *src, surface_t *dest, double src_x, double src_y,
                             double dest_x, double dest_y, double width, double height);
+
+/**
+ * Opaque hash map which maps byte strings (window IDs, pointers, names, …) to
+ * pointers. Keys are copied, values are not owned by the hash map.
+ *
+ */
+typedef struct hashmap hashmap_t;
+
+/**
+ * Callback for hashmap_foreach().
+ *
+ */
+typedef void (*hashmap_cb_t)(const void *key, size_t keylen, void *value, void *userdata);
+
+/**
+ * Creates a new, empty hash map.
+ *
+ */
+hashmap_t *hashmap_new(void);
+
+/**
+ * Removes all entries from the hash map. The values are not freed.
+ *
+ */
+void hashmap_clear(hashmap_t *map);
+
+/**
+ * Frees the hash map and all of its entries. The values are not freed.
+ *
+ */
+void hashmap_free(hashmap_t *map);
+
+/**
+ * Returns the value stored for the given key or NULL if there is none.
+ *
+ */
+void *hashmap_get(hashmap_t *map, const void *key, size_t keylen);
+
+/**
+ * Stores the value for the given key, replacing any previous value. The key is
+ * copied, so the caller does not need to keep it around.
+ *
+ */
+void hashmap_set(hashmap_t *map, const void *key, size_t keylen, void *value);
+
+/**
+ * Removes the entry for the given key and returns its value (or NULL if there
+ * was no such entry).
+ *
+ */
+void *hashmap_remove(hashmap_t *map, const void *key, size_t keylen);
+
+/**
+ * Returns the number of entries in the hash map.
+ *
+ */
+size_t hashmap_count(hashmap_t *map);
+
+/**
+ * Calls the given callback for every entry in the hash map. The callback must
+ * not modify the hash map.
+ *
+ */
+void hashmap_foreach(hashmap_t *map, hashmap_cb_t cb, void *userdata);
+
+/**
+ * Opaque bump allocator for short-lived allocations, which are all released
+ * in one step (see arena_mark() and arena_release()).
+ *
+ */
+typedef struct arena arena_t;
+
+/**
+ * A position in an arena, see arena_mark().
+ *
+ */
+typedef struct arena_mark {
+    struct arena_block *block;
+    size_t used;
+} arena_mark_t;
+
+/**
+ * Creates a new, empty arena.
+ *
+ */
+arena_t *arena_new(void);
+
+/**
+ * Frees the arena and everything allocated from it.
+ *
+ */
+void arena_free(arena_t *arena);
+
+/**
+ * Returns size bytes of uninitialized memory, which stay valid until the arena
+ * is released to a mark taken before this call. Never returns NULL.
+ *
+ */
+void *arena_alloc(arena_t *arena, size_t size);
+
+/**
+ * Copies the first len bytes of str into the arena and NUL-terminates them.
+ *
+ */
+char *arena_strndup(arena_t *arena, const char *str, size_t len);
+
+/**
+ * Copies str into the arena.
+ *
+ */
+char *arena_strdup(arena_t *arena, const char *str);
+
+/**
+ * Returns the current position of the arena, to be passed to arena_release()
+ * later on. Marks nest: releasing to a mark invalidates all later marks.
+ *
+ */
+arena_mark_t arena_mark(arena_t *arena);
+
+/**
+ * Releases everything allocated from the arena since the given mark was taken.
+ *
+ */
+void arena_release(arena_t *arena, arena_mark_t mark);
+
+/**
+ * Opaque allocator for long-lived objects of one fixed size. Objects are
+ * carved out of contiguous slabs, and freed objects are reused (most recently
+ * freed first) before another slab is allocated. Slabs are never released.
+ *
+ */
+typedef struct slab slab_t;
+
+/**
+ * The occupancy of a slab allocator, see slab_get_stats().
+ *
+ */
+typedef struct slab_stats {
+    const char *name;
+    /* The size of an object, rounded up to the alignment. */
+    size_t object_size;
+    /* The number of objects currently allocated. */
+    size_t in_use;
+    /* The number of objects which fit into all slabs. */
+    size_t capacity;
+    size_t slabs;
+    /* The size of all slabs in bytes. */
+    size_t bytes;
+    /* The number of slab_alloc() calls so far. */
+    uint64_t allocations;
+} slab_stats_t;
+
+/**
+ * Creates a new, empty slab allocator for objects of the given size. The name
+ * is only used for reporting, see slab_get_stats().
+ *
+ */
+slab_t *slab_new(const char *name, size_t object_size);
+
+/**
+ * Returns a zero-initialized object, which stays valid until it is passed to
+ * slab_free(). Never returns NULL.
+ *
+ */
+void *slab_alloc(slab_t *slab);
+
+/**
+ * Returns the given object (which must have been allocated from this slab
+ * allocator) for reuse. Does nothing if ptr is NULL.
+ *
+ */
+void slab_free(slab_t *slab, void *ptr);
+
+/**
+ * Fills in the occupancy of the given slab allocator.
+ *
+ */
+void slab_get_stats(slab_t *slab, slab_stats_t *stats);
@@ -27,16 +27,20 @@ typedef enum {
     JSON_CONTENT_WORKSPACE = 2,
 } json_content_t;
 
-/* Parses the given JSON file until it encounters the first “type” property to
- * determine whether the file contains workspaces or regular containers, which
- * is important to know when deciding where (and how) to append the contents.
- * */
-json_content_t json_determine_content(const char *buf, const size_t len);
-
 /**
- * Returns true if the provided JSON could be parsed by yajl.
+ * Parses the given JSON and appends the containers to con.
+ *
+ * Top-level workspaces are appended to the output which con is on (next to the
+ * other workspaces) instead, so that a layout file can be appended without
+ * knowing its contents upfront.
+ *
+ * The JSON is parsed only once: if it turns out to be invalid, all containers
+ * which were appended so far are removed again and an error message is stored
+ * in errormsg (if not NULL).
+ *
+ * Returns JSON_CONTENT_WORKSPACE if a workspace was appended,
+ * JSON_CONTENT_CON if only other containers were appended or
+ * JSON_CONTENT_UNKNOWN if parsing failed.
  *
  */
-bool json_validate(const char *buf, const size_t len);
-
-void tree_append_json(Con *con, const char *buf, const size_t len, char **errormsg);
+json_content_t tree_append_json(Con *con, const char *buf, const size_t len, char **errormsg);
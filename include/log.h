@@ -13,6 +13,8 @@
 
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 /* We will include libi3.h which define its own version of LOG, ELOG.
  * We want *our* version, so we undef the libi3 one. */
@@ -25,11 +27,63 @@
 #if defined(DLOG)
 #undef DLOG
 #endif
+
+/**
+ * Log categories, which can be switched off at runtime using the debuglog
+ * command. A source file selects its category by defining LOG_CATEGORY before
+ * including all.h, all other files log in the general category.
+ *
+ */
+typedef enum {
+    LOG_CATEGORY_GENERAL = (1 << 0),
+    LOG_CATEGORY_X = (1 << 1),
+    LOG_CATEGORY_RENDER = (1 << 2),
+    LOG_CATEGORY_IPC = (1 << 3),
+    LOG_CATEGORY_BINDINGS = (1 << 4),
+    LOG_CATEGORY_MATCH = (1 << 5),
+    LOG_CATEGORY_RANDR = (1 << 6),
+    LOG_CATEGORY_FLOATING = (1 << 7),
+} log_category_t;
+
+/** Bitmask of the enabled log categories (all by default). */
+extern uint32_t log_categories;
+
+#if !defined(LOG_CATEGORY)
+#define LOG_CATEGORY LOG_CATEGORY_GENERAL
+#endif
+
 /** ##__VA_ARGS__ means: leave out __VA_ARGS__ completely if it is empty, that
-   is, delete the preceding comma */
-#define LOG(fmt, ...) verboselog(fmt, ##__VA_ARGS__)
+   is, delete the preceding comma. LOG and DLOG check the category of the
+   source file first, so that disabled messages don’t evaluate their
+   arguments. Errors are always logged. */
+#define LOG(fmt, ...)                        \
+    do {                                     \
+        if (log_categories & (LOG_CATEGORY)) \
+            verboselog(fmt, ##__VA_ARGS__);  \
+    } while (0)
 #define ELOG(fmt, ...) errorlog("ERROR: " fmt, ##__VA_ARGS__)
-#define DLOG(fmt, ...) debuglog("%s:%s:%d - " fmt, STRIPPED__FILE__, __FUNCTION__, __LINE__, ##__VA_ARGS__)
+#define DLOG(fmt, ...)                                                                            \
+    do {                                                                                          \
+        if (log_categories & (LOG_CATEGORY))                                                      \
+            debuglog("%s:%s:%d - " fmt, STRIPPED__FILE__, __FUNCTION__, __LINE__, ##__VA_ARGS__); \
+    } while (0)
+
+/**
+ * Returns the log category with the given name (like "render"), or 0 if there
+ * is no such category.
+ *
+ */
+log_category_t log_category_from_name(const char *name);
+
+/**
+ * Messages collected while a thread defers logging, see log_defer().
+ *
+ */
+typedef struct log_buffer {
+    char *data;
+    size_t len;
+    size_t size;
+} log_buffer_t;
 
 extern char *errorfilename;
 extern char *shmlogname;
@@ -97,6 +151,44 @@ void errorlog(char *fmt, ...)
 void verboselog(char *fmt, ...)
     __attribute__((format(printf, 1, 2)));
 
+/**
+ * Makes the current thread collect its messages in buffer instead of logging
+ * them, until log_defer(NULL) is called. This allows other threads to log
+ * without racing with the main thread, which logs the messages later using
+ * log_replay().
+ *
+ */
+void log_defer(log_buffer_t *buffer);
+
+/**
+ * Logs the messages collected in buffer (see log_defer()) and empties it.
+ *
+ */
+void log_replay(log_buffer_t *buffer);
+
+/**
+ * Wakes up the processes (i3-dump-log -f) following the SHM log, if any new
+ * messages were logged since the last call. Called once per event loop
+ * iteration, so that a burst of messages results in a single wakeup.
+ *
+ */
+void log_wake_followers(void);
+
+struct i3_shmlog_memory;
+
+/**
+ * Copies the given memory usage snapshot into the SHM log header (if SHM
+ * logging is enabled), see i3-dump-log -m.
+ *
+ */
+void log_publish_memory(const struct i3_shmlog_memory *memory);
+
+/**
+ * Returns the size of the SHM log in bytes, 0 if SHM logging is disabled.
+ *
+ */
+size_t log_shmlog_bytes(void);
+
 /**
  * Deletes the unused log files. Useful if i3 exits immediately, eg.
  * because --get-socketpath was called. We don't care for syscall
@@ -38,6 +38,21 @@ void manage_window(xcb_window_t window,
                    xcb_get_window_attributes_cookie_t cookie,
                    bool needs_to_be_mapped);
 
+/**
+ * Handles the replies to the requests which manage_window() sent for newly
+ * managed windows, but does not need answered to place and map them (e.g.
+ * _MOTIF_WM_HINTS). This is called in the event loop iteration after the
+ * windows were managed, i.e. after they were mapped.
+ *
+ */
+void manage_handle_deferred(void);
+
+/**
+ * Returns true if manage_handle_deferred() has replies to handle.
+ *
+ */
+bool manage_has_deferred(void);
+
 /**
  * Remanages a window: performs a swallow check and runs assignments.
  * Returns con for the window regardless if it updated.
@@ -0,0 +1,29 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * probes.h: Static tracepoints (USDT) for bpftrace, perf and SystemTap. They
+ *           are only compiled in when configured with --enable-probes.
+ *
+ */
+#pragma once
+
+#include <config.h>
+
+/* All probes belong to the “i3” provider. Following the DTrace convention, a
+ * double underscore in a probe name is turned into a dash by the tools, e.g.
+ * tree_render__entry can be attached to as usdt:i3:tree_render-entry. */
+#if defined(I3_PROBES_ENABLED)
+#include <sys/sdt.h>
+#define I3_PROBE(name) DTRACE_PROBE(i3, name)
+#define I3_PROBE1(name, arg1) DTRACE_PROBE1(i3, name, arg1)
+#define I3_PROBE2(name, arg1, arg2) DTRACE_PROBE2(i3, name, arg1, arg2)
+#define I3_PROBE3(name, arg1, arg2, arg3) DTRACE_PROBE3(i3, name, arg1, arg2, arg3)
+#else
+#define I3_PROBE(name)
+#define I3_PROBE1(name, arg1)
+#define I3_PROBE2(name, arg1, arg2)
+#define I3_PROBE3(name, arg1, arg2, arg3)
+#endif
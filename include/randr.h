@@ -59,8 +59,11 @@ void init_ws_for_output(Output *output);
 /**
  * (Re-)queries the outputs via RandR and stores them in the list of outputs.
  *
+ * Only outputs which changed are reconfigured. Returns true if anything
+ * changed (and the tree was rendered), false otherwise.
+ *
  */
-void randr_query_outputs(void);
+bool randr_query_outputs(void);
 
 /**
  * Disables the output and moves its content.
@@ -68,6 +71,14 @@ void randr_query_outputs(void);
  */
 void randr_disable_output(Output *output);
 
+/**
+ * Marks the spatial output index used by get_output_containing(),
+ * output_containing_rect() and get_output_next() as outdated. Needs to be
+ * called whenever outputs are added, (de)activated or change their rect.
+ *
+ */
+void output_index_invalidate(void);
+
 /**
  * Returns the first output which is active.
  *
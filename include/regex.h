@@ -13,9 +13,10 @@
 
 /**
  * Creates a new 'regex' struct containing the given pattern and a PCRE
- * compiled regular expression. Also, calls pcre_study because this regex will
- * most likely be used often (like for every new window and on every relevant
- * property change of existing windows).
+ * compiled regular expression. Also, calls pcre_study (JIT-compiling the
+ * regex if libpcre supports it) because this regex will most likely be used
+ * often (like for every new window and on every relevant property change of
+ * existing windows).
  *
  * Returns NULL if the pattern could not be compiled into a regular expression
  * (and ELOGs an appropriate error message).
@@ -36,3 +37,37 @@ void regex_free(struct regex *regex);
  *
  */
 bool regex_matches(struct regex *regex, const char *input);
+
+/**
+ * Returns true if the given part of a pattern only matches itself, i.e. does
+ * not contain any characters with a special meaning for PCRE.
+ *
+ */
+bool regex_is_literal(const char *pattern, size_t len);
+
+/**
+ * Returns true if the given regular expression is an anchored literal
+ * (^literal$), which only matches the literal itself (and the literal followed
+ * by a newline, since $ also matches before a trailing newline). The literal
+ * is stored in *literal and its length in *len; it is not NUL-terminated.
+ *
+ */
+bool regex_exact_literal(struct regex *regex, const char **literal, size_t *len);
+
+/**
+ * Like regex_matches(), but remembers the result in the given cache. The
+ * generation identifies the value of input: as long as the caller passes the
+ * same generation, input is assumed to be unchanged and the cached result is
+ * returned without running the regular expression again.
+ *
+ */
+bool regex_matches_cached(struct regex *regex, const char *input, struct regex_cache *cache, uint32_t generation);
+
+/**
+ * Like regex_matches_cached(), but for an interned input (see
+ * intern_string()). If the regular expression is an anchored literal, the
+ * input matches exactly if it is the interned literal, so no regular
+ * expression has to be run.
+ *
+ */
+bool regex_matches_interned(struct regex *regex, const char *input, struct regex_cache *cache, uint32_t generation);
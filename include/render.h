@@ -28,7 +28,7 @@ typedef struct render_params {
     Rect rect;
     /* The number of children of the container which is being rendered. */
     int children;
-    /* A precalculated list of sizes of each child. */
+    /* A precalculated list of sizes of each child (see render_alloc()). */
     int *sizes;
 } render_params;
 
@@ -42,8 +42,36 @@ typedef struct render_params {
  */
 void render_con(Con *con);
 
+/**
+ * Renders the floating windows of all outputs. Called after the outputs were
+ * rendered, so that the floating windows are raised above them.
+ *
+ */
+void render_floating_windows(Con *con);
+
 /**
  * Returns the height for the decorations
  *
  */
 int render_deco_height(void);
+
+/**
+ * Returns size bytes of scratch memory, which stay valid until the end of the
+ * current frame (see render_frame_end()). Outside of tree_render(), they stay
+ * valid until the outermost render_con() call returns.
+ *
+ */
+void *render_alloc(size_t size);
+
+/**
+ * Marks the beginning of a frame, called by tree_render() before rendering.
+ *
+ */
+void render_frame_begin(void);
+
+/**
+ * Marks the end of a frame, called by tree_render() once the changes were
+ * pushed to X11. Releases everything allocated with render_alloc().
+ *
+ */
+void render_frame_end(void);
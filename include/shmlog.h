@@ -12,6 +12,8 @@
 
 #include <config.h>
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #if !defined(__OpenBSD__)
 #include <pthread.h>
@@ -20,6 +22,31 @@
 /* Default shmlog size if not set by user. */
 extern const int default_shmlog_size;
 
+/**
+ * Snapshot of i3's memory usage, published in the shmlog header so that
+ * i3-dump-log -m can show it without talking to i3. All sizes are in bytes.
+ *
+ */
+typedef struct i3_shmlog_memory {
+    /* When the snapshot was taken, in milliseconds since the epoch (0 if
+     * there is none yet). */
+    uint64_t sampled_at;
+
+    /* Calls of the libi3 allocation wrappers (smalloc, scalloc, …) and bytes
+     * requested by them since i3 was started. */
+    uint64_t allocation_calls;
+    uint64_t allocation_bytes;
+
+    /* Heap statistics of the C library: bytes in use by allocations, the
+     * highest value of in_use seen when sampling, bytes which were freed but
+     * not returned to the system (fragmentation) and bytes in separately
+     * mmap()ed chunks. All 0 if the C library does not provide them. */
+    uint64_t heap_in_use;
+    uint64_t heap_peak_in_use;
+    uint64_t heap_free;
+    uint64_t heap_mmapped;
+} i3_shmlog_memory;
+
 /**
  * Header of the shmlog file. Used by i3/src/log.c and i3/i3-dump-log/main.c.
  *
@@ -41,10 +68,135 @@ typedef struct i3_shmlog_header {
      * and don’t matter — clients use an equality check (==). */
     uint32_t wrap_count;
 
+    /* Byte offset of the oldest record between offset_next_write and
+     * offset_last_wrap which was not (partially) overwritten yet, i.e. where
+     * readers start after a wrap. Equals the size when there was no wrap. */
+    uint32_t offset_first_record;
+
+    /* The time (in milliseconds since the epoch) which the time delta of the
+     * record at offset_first_record is relative to. */
+    uint64_t first_record_base;
+
+    /* Byte offset and size of the format string table. Records refer to their
+     * format string by its offset within the table. The records themselves
+     * follow after the table. */
+    uint32_t offset_formats;
+    uint32_t formats_size;
+
+    /* Updated about once per second, see stats_sample_memory(). */
+    i3_shmlog_memory memory;
+
 #if !defined(__OpenBSD__)
+    /* The number of i3-dump-log -f processes following the log. i3 only
+     * broadcasts condvar if it is non-zero. Modified atomically. */
+    uint32_t followers;
+
+
     /* pthread condvar which will be broadcasted whenever there is a new
      * message in the log. i3-dump-log uses this to implement -f (follow, like
      * tail -f) in an efficient way. */
     pthread_cond_t condvar;
 #endif
 } i3_shmlog_header;
+
+/* A record which contains the formatted message as text. */
+#define SHMLOG_RECORD_TEXT 1
+/* A record which refers to a format string in the format table and contains
+ * the packed arguments. */
+#define SHMLOG_RECORD_FORMAT 2
+
+/**
+ * Header of each record in the shmlog ring buffer. It is followed by the time
+ * delta to the previous record in milliseconds (zigzag-encoded varint), then
+ * either the message text (SHMLOG_RECORD_TEXT) or the offset of the format
+ * string (varint) and the packed arguments (SHMLOG_RECORD_FORMAT).
+ *
+ * Integer arguments are stored as varints (signed ones zigzag-encoded),
+ * floating point arguments as doubles, strings as their length (varint)
+ * followed by the bytes. Arguments for '*' widths and precisions are stored
+ * like signed integers before the argument they belong to.
+ *
+ */
+typedef struct __attribute__((packed)) i3_shmlog_record {
+    /* The size of the record in bytes, including this header. */
+    uint16_t size;
+
+    /* SHMLOG_RECORD_TEXT or SHMLOG_RECORD_FORMAT. */
+    uint8_t type;
+
+    /* The log level: 'd' (debug), 'v' (verbose) or 'e' (error). */
+    uint8_t level;
+} i3_shmlog_record;
+
+/** Length modifiers of printf conversions. */
+typedef enum {
+    PRINTF_LENGTH_NONE = 0,
+    PRINTF_LENGTH_HH,
+    PRINTF_LENGTH_H,
+    PRINTF_LENGTH_L,
+    PRINTF_LENGTH_LL,
+    PRINTF_LENGTH_J,
+    PRINTF_LENGTH_Z,
+    PRINTF_LENGTH_T,
+    PRINTF_LENGTH_LONG_DOUBLE
+} printf_length_t;
+
+/**
+ * One conversion specification of a printf format string.
+ *
+ */
+typedef struct printf_conversion_t {
+    /* The length of the whole specification, including the '%'. */
+    size_t length;
+
+    /* The offset of the length modifier (or of the conversion specifier if
+     * there is none), i.e. the length of "%", flags, width and precision. */
+    size_t modifier_offset;
+
+    printf_length_t modifier;
+
+    /* The conversion specifier, like 'd' or 's'. */
+    char specifier;
+
+    /* Whether the width and the precision are passed as arguments ('*'). */
+    bool width_arg;
+    bool precision_arg;
+
+    /* The precision if given literally, -1 otherwise. */
+    int precision;
+} printf_conversion_t;
+
+/**
+ * Parses the printf conversion specification at fmt, which must point to a
+ * '%'. Returns false for specifications which the shmlog cannot store (like
+ * %n, positional arguments or wide strings).
+ *
+ */
+bool parse_printf_conversion(const char *fmt, printf_conversion_t *conv);
+
+/**
+ * Stores value as varint at out, which needs room for 10 bytes. Returns the
+ * number of bytes written.
+ *
+ */
+size_t shmlog_put_varint(uint8_t *out, uint64_t value);
+
+/**
+ * Reads a varint from in, which is at most len bytes long. Returns the number
+ * of bytes read or 0 if the varint is truncated.
+ *
+ */
+size_t shmlog_get_varint(const uint8_t *in, size_t len, uint64_t *value);
+
+/**
+ * Zigzag-encodes a signed integer so that small negative numbers result in
+ * small varints, too.
+ *
+ */
+static inline uint64_t shmlog_zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static inline int64_t shmlog_unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
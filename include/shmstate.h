@@ -0,0 +1,41 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * shmstate.c: A shared memory snapshot of the workspaces and outputs, which
+ *             status bars and similar tools can poll without IPC round trips.
+ *
+ */
+#pragma once
+
+#include <config.h>
+
+#include "i3/shmstate.h"
+
+/**
+ * Creates the state snapshot segment and writes the initial snapshot.
+ *
+ */
+void shmstate_open(void);
+
+/**
+ * Unlinks the state snapshot segment.
+ *
+ */
+void shmstate_close(void);
+
+/**
+ * Updates the snapshot if the workspaces or outputs changed since the last
+ * update. Called at the end of every x_push_changes().
+ *
+ */
+void shmstate_update(void);
+
+/**
+ * The name of the state snapshot segment, or an empty string if there is
+ * none.
+ *
+ */
+extern char *shmstatename;
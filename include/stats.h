@@ -0,0 +1,499 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * stats.c: Timing counters for the render pipeline and event handling,
+ *          exposed via the GET_STATS IPC message.
+ *
+ */
+#pragma once
+
+#include <config.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "shmlog.h"
+
+typedef enum {
+    STATS_HANDLE_EVENT = 0,
+    STATS_RENDER_CON,
+    STATS_X_PUSH_CHANGES,
+    STATS_X_PUSH_NODE,
+    STATS_X_DECO_RECURSE,
+    STATS_X_DRAW_DECORATION,
+    STATS_NUM_COUNTERS
+} stats_counter_t;
+
+/** Kinds of X11 events which are coalesced before dispatching them. */
+typedef enum {
+    STATS_COALESCED_CONFIGURE_REQUEST = 0,
+    STATS_COALESCED_PROPERTY_NOTIFY,
+    STATS_COALESCED_MOTION_NOTIFY,
+    STATS_NUM_COALESCED
+} stats_coalesced_t;
+
+/** Number of buckets of each event latency histogram. Bucket 0 counts
+ * latencies below 1 µs, bucket i latencies from 2^(i-1) µs up to (but
+ * excluding) 2^i µs. The last bucket also counts all slower events. */
+#define STATS_HISTOGRAM_BUCKETS 20
+
+/**
+ * Latency histogram of one kind of X11 event (for example MapRequest or
+ * PropertyNotify for a specific atom), see stats_histogram_for().
+ *
+ */
+struct stats_histogram {
+    char *name;
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint64_t buckets[STATS_HISTOGRAM_BUCKETS];
+};
+
+/**
+ * Accumulated timings of one instrumented function. Recursive calls are
+ * accounted to the outermost call only, so calls counts top-level
+ * invocations.
+ *
+ */
+struct stats_counter {
+    uint64_t calls;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    /* Number of X11 requests issued, only tracked where this is cheap to
+     * determine (see x_push_changes()). */
+    uint64_t x_requests;
+
+    /* Internal: current recursion depth. */
+    int depth;
+};
+
+/**
+ * Returns the current time of the monotonic clock used for all timings, in
+ * nanoseconds.
+ *
+ */
+uint64_t stats_now_ns(void);
+
+/**
+ * Starts timing a call of the function identified by counter. The returned
+ * timestamp has to be passed to stats_end().
+ *
+ */
+uint64_t stats_begin(stats_counter_t counter);
+
+/**
+ * Stops timing a call started with stats_begin().
+ *
+ */
+void stats_end(stats_counter_t counter, uint64_t start);
+
+/**
+ * Adds the given number of X11 requests to the counter.
+ *
+ */
+void stats_add_x_requests(stats_counter_t counter, uint64_t requests);
+
+/**
+ * Returns the accumulated values of the given counter.
+ *
+ */
+const struct stats_counter *stats_get(stats_counter_t counter);
+
+/** Subsystems which X11 requests are accounted to, see stats_x_enter(). */
+typedef enum {
+    STATS_X_SUBSYSTEM_OTHER = 0,
+    STATS_X_SUBSYSTEM_RENDER,
+    STATS_X_SUBSYSTEM_DECORATION,
+    STATS_X_SUBSYSTEM_EWMH,
+    STATS_X_SUBSYSTEM_BINDINGS,
+    STATS_X_SUBSYSTEM_MANAGE,
+    STATS_X_SUBSYSTEM_FLOATING,
+    STATS_X_SUBSYSTEM_RANDR,
+    STATS_NUM_X_SUBSYSTEMS
+} stats_x_subsystem_t;
+
+/** Types of X11 requests, see x_requests.h. */
+typedef enum {
+#define xmacro(name) STATS_X_REQUEST_##name,
+#include "x_requests.xmacro"
+#undef xmacro
+    STATS_NUM_X_REQUEST_TYPES
+} stats_x_request_t;
+
+/**
+ * The X11 requests and round trips (calls waiting for a reply) of one
+ * subsystem.
+ *
+ */
+struct stats_x_traffic {
+    uint64_t requests;
+    uint64_t round_trips;
+};
+
+/**
+ * Accounts all following X11 requests to the given subsystem, until
+ * stats_x_leave() is called with the returned (previous) subsystem.
+ *
+ */
+stats_x_subsystem_t stats_x_enter(stats_x_subsystem_t subsystem);
+
+/**
+ * Restores the subsystem which was current before stats_x_enter().
+ *
+ */
+void stats_x_leave(stats_x_subsystem_t previous);
+
+/**
+ * Counts an X11 request of the given type, see x_requests.h.
+ *
+ */
+void stats_x_request(stats_x_request_t type);
+
+/**
+ * Counts a round trip, i.e. a call which blocks until X11 replied.
+ *
+ */
+void stats_x_round_trip(void);
+
+/**
+ * Marks the end of a render (x_push_changes()). The requests since the end of
+ * the previous render are kept as the last render's, see
+ * stats_get_x_traffic().
+ *
+ */
+void stats_x_render_done(void);
+
+/**
+ * Returns the X11 traffic of the given subsystem since i3 was started or, if
+ * last_render is true, between the previous and the last render (including
+ * the events and commands which caused the last render).
+ *
+ */
+const struct stats_x_traffic *stats_get_x_traffic(stats_x_subsystem_t subsystem, bool last_render);
+
+/**
+ * Returns the number of X11 requests of the given type since i3 was started.
+ *
+ */
+uint64_t stats_get_x_requests_of_type(stats_x_request_t type);
+
+/**
+ * Returns the name of the given subsystem as used in the GET_STATS reply.
+ *
+ */
+const char *stats_x_subsystem_name(stats_x_subsystem_t subsystem);
+
+/**
+ * Returns the name of the given request type as used in the GET_STATS reply.
+ *
+ */
+const char *stats_x_request_name(stats_x_request_t type);
+
+/**
+ * Returns the name of the given counter as used in the GET_STATS reply.
+ *
+ */
+const char *stats_counter_name(stats_counter_t counter);
+
+/**
+ * Counts an event of the given kind which was merged into a later one and
+ * therefore not dispatched.
+ *
+ */
+void stats_count_coalesced(stats_coalesced_t type);
+
+/**
+ * Returns the number of coalesced events of the given kind.
+ *
+ */
+uint64_t stats_get_coalesced(stats_coalesced_t type);
+
+/**
+ * Returns the name of the given kind of coalesced events as used in the
+ * GET_STATS reply.
+ *
+ */
+const char *stats_coalesced_name(stats_coalesced_t type);
+
+/**
+ * Returns the latency histogram with the given name, creating it if it does
+ * not exist yet. The returned pointer stays valid until i3 exits.
+ *
+ */
+struct stats_histogram *stats_histogram_for(const char *name);
+
+/**
+ * Records one event which took the given number of nanoseconds.
+ *
+ */
+void stats_histogram_record(struct stats_histogram *histogram, uint64_t elapsed_ns);
+
+/**
+ * Returns the number of latency histograms.
+ *
+ */
+size_t stats_num_histograms(void);
+
+/**
+ * Returns the latency histogram with the given index (in order of creation).
+ *
+ */
+const struct stats_histogram *stats_get_histogram(size_t index);
+
+/** Phases of the startup in main(), in the order in which they run. */
+typedef enum {
+    STATS_STARTUP_X_CONNECTION = 0,
+    STATS_STARTUP_ATOMS,
+    STATS_STARTUP_LOAD_CONFIGURATION,
+    STATS_STARTUP_XCURSOR,
+    STATS_STARTUP_KEYBOARD,
+    STATS_STARTUP_TREE_RESTORE,
+    STATS_STARTUP_TREE_INIT,
+    STATS_STARTUP_OUTPUTS,
+    STATS_STARTUP_FIRST_RENDER,
+    STATS_STARTUP_SOCKETS,
+    STATS_STARTUP_MANAGE_EXISTING_WINDOWS,
+    STATS_STARTUP_AUTOSTART,
+    STATS_NUM_STARTUP_PHASES
+} stats_startup_phase_t;
+
+/**
+ * When a startup phase began and how long it took, in nanoseconds. Both are
+ * 0 for phases which did not run (for example tree_restore when i3 was not
+ * restarted in-place).
+ *
+ */
+struct stats_startup_phase {
+    /* Relative to the start of main(). */
+    uint64_t start_ns;
+    uint64_t duration_ns;
+};
+
+/**
+ * Marks the start of main(), which all startup phases are relative to.
+ *
+ */
+void stats_startup_init(void);
+
+/**
+ * Marks the beginning of the given startup phase.
+ *
+ */
+void stats_startup_begin(stats_startup_phase_t phase);
+
+/**
+ * Marks the end of the given startup phase.
+ *
+ */
+void stats_startup_end(stats_startup_phase_t phase);
+
+/**
+ * Marks the end of the startup (right before entering the event loop) and
+ * logs how long each phase took.
+ *
+ */
+void stats_startup_done(void);
+
+/**
+ * Returns the timings of the given startup phase.
+ *
+ */
+const struct stats_startup_phase *stats_get_startup_phase(stats_startup_phase_t phase);
+
+/**
+ * Returns the name of the given startup phase as used in the GET_STATS reply.
+ *
+ */
+const char *stats_startup_phase_name(stats_startup_phase_t phase);
+
+/**
+ * Returns the time from the start of main() until the event loop was entered,
+ * in nanoseconds, or 0 if the startup is not done yet.
+ *
+ */
+uint64_t stats_startup_total_ns(void);
+
+/** Phases of managing a new window, from its MapRequest until its frame is
+ * mapped and focused (see manage_window()). */
+typedef enum {
+    /* Until the replies to the property requests were received. */
+    STATS_MAP_PROPERTIES = 0,
+    /* Swallowing, assignments, floating and focus decisions. */
+    STATS_MAP_PLACEMENT,
+    /* Rendering, which maps and focuses the frame (x_push_changes()). */
+    STATS_MAP_RENDER,
+    /* All of the above. */
+    STATS_MAP_TOTAL,
+    STATS_NUM_MAP_PHASES
+} stats_map_phase_t;
+
+/**
+ * Records how long the phases of managing a new window took, in nanoseconds.
+ *
+ */
+void stats_record_map_latency(const uint64_t durations_ns[STATS_NUM_MAP_PHASES]);
+
+/**
+ * Returns the histogram of the durations of the given window map phase.
+ *
+ */
+const struct stats_histogram *stats_get_map_latency(stats_map_phase_t phase);
+
+/** Phases of running a key binding, from handling its KeyPress (or
+ * KeyRelease) until the result was flushed to X11 (see handle_key_press()). */
+typedef enum {
+    /* Finding the binding for the key event. */
+    STATS_BINDING_LOOKUP = 0,
+    /* Running the binding's command. */
+    STATS_BINDING_COMMAND,
+    /* From the end of the command until the tree was rendered, including the
+     * other events of the same batch. */
+    STATS_BINDING_RENDER,
+    /* Until the requests were flushed to X11. */
+    STATS_BINDING_FLUSH,
+    /* From the key event until the flush, including time spent waiting for
+     * the command to run (e.g. when presses are coalesced). */
+    STATS_BINDING_TOTAL,
+    STATS_NUM_BINDING_PHASES
+} stats_binding_phase_t;
+
+/**
+ * Records how long the phases of running a key binding took, in nanoseconds.
+ *
+ */
+void stats_record_binding_latency(const uint64_t durations_ns[STATS_NUM_BINDING_PHASES]);
+
+/**
+ * Returns the histogram of the durations of the given key binding phase.
+ *
+ */
+const struct stats_histogram *stats_get_binding_latency(stats_binding_phase_t phase);
+
+/**
+ * Samples the memory usage of i3 if the last sample is older than a second:
+ * the allocation counters of libi3, the heap statistics of the C library and
+ * the peak heap usage. Called once per event loop iteration, it does not wake
+ * up i3 by itself. The sample is also published in the shmlog header.
+ *
+ */
+void stats_sample_memory(void);
+
+/**
+ * Takes a new memory sample (see stats_sample_memory()) and returns it.
+ *
+ */
+const i3_shmlog_memory *stats_get_memory(void);
+
+/**
+ * Adds the given slab allocator to the GET_STATS reply.
+ *
+ */
+void stats_register_slab(slab_t *slab);
+
+/**
+ * Returns the number of registered slab allocators.
+ *
+ */
+size_t stats_num_slabs(void);
+
+/**
+ * Returns the slab allocator with the given index (in order of registration).
+ *
+ */
+slab_t *stats_get_slab(size_t index);
+
+/** Number of slow frames kept by the flight recorder. */
+#define STATS_SLOW_FRAMES 16
+
+/** Number of distinct kinds of X11 events and number of commands stored per
+ * slow frame. Further ones are only counted. */
+#define STATS_SLOW_FRAME_EVENT_KINDS 16
+#define STATS_SLOW_FRAME_COMMANDS 8
+
+/**
+ * What happened during one event loop iteration which took longer than
+ * slow_frame_threshold (see stats_frame_begin()).
+ *
+ */
+struct stats_slow_frame {
+    /* When the iteration started, in milliseconds since the epoch. */
+    uint64_t started_at;
+    uint64_t duration_ns;
+
+    /* The handled X11 events, grouped by their kind (the latency histogram
+     * they are recorded in). */
+    struct {
+        const struct stats_histogram *kind;
+        uint64_t count;
+    } events[STATS_SLOW_FRAME_EVENT_KINDS];
+    int num_event_kinds;
+    uint64_t num_events;
+
+    /* The commands which were run, from bindings, IPC or for_window. */
+    char *commands[STATS_SLOW_FRAME_COMMANDS];
+    uint64_t num_commands;
+
+    uint64_t ipc_messages;
+
+    /* Renders (x_push_changes() calls), the time spent in render_con() and
+     * x_push_changes(), and the X11 requests issued by x_push_changes(). */
+    uint64_t renders;
+    uint64_t render_ns;
+    uint64_t x_requests;
+};
+
+/**
+ * Marks the start of an event loop iteration (when the loop wakes up). Until
+ * stats_frame_end() is called, the flight recorder keeps track of the handled
+ * events, the commands and the renders, so that they can be recorded if the
+ * iteration turns out to be slow.
+ *
+ */
+void stats_frame_begin(void);
+
+/**
+ * Records that an X11 event of the given kind was handled in the current
+ * event loop iteration.
+ *
+ */
+void stats_frame_event(const struct stats_histogram *kind);
+
+/**
+ * Records that the given command was run in the current event loop
+ * iteration.
+ *
+ */
+void stats_frame_command(const char *command);
+
+/**
+ * Records that an IPC message was handled in the current event loop
+ * iteration.
+ *
+ */
+void stats_frame_ipc_message(void);
+
+/**
+ * Marks the end of an event loop iteration (right before the loop sleeps).
+ * If it took longer than slow_frame_threshold, it is added to the slow
+ * frames and logged.
+ *
+ */
+void stats_frame_end(void);
+
+/**
+ * Returns the total number of slow frames since i3 was started.
+ *
+ */
+uint64_t stats_num_slow_frames(void);
+
+/**
+ * Returns the slow frame with the given index, 0 being the oldest one which
+ * is still kept, or NULL if there is no such frame.
+ *
+ */
+const struct stats_slow_frame *stats_get_slow_frame(size_t index);
@@ -0,0 +1,35 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * sync_request.c: _NET_WM_SYNC_REQUEST protocol, which paces the resizes of a
+ *                 window to the speed at which the client redraws.
+ *
+ */
+#pragma once
+
+#include <config.h>
+
+/**
+ * Sends a _NET_WM_SYNC_REQUEST to the given window, which is about to be
+ * resized, if the client supports the protocol. Further resizes are then
+ * deferred (see i3Window.sync_pending) until the client updated its counter,
+ * i.e. redrew at the new size.
+ *
+ */
+void sync_request_send(i3Window *win);
+
+/**
+ * Handles an AlarmNotify event of the Sync extension, which is sent once a
+ * client updated its counter in response to a _NET_WM_SYNC_REQUEST.
+ *
+ */
+void sync_request_handle_alarm(xcb_sync_alarm_notify_event_t *event);
+
+/**
+ * Frees the alarm and the timer of a window which is about to be freed.
+ *
+ */
+void sync_request_free(i3Window *win);
@@ -0,0 +1,52 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * timer_wheel.c: Coarse-grained timers (urgency, startup and IPC timeouts)
+ *                with O(1) start and stop, driven by a single ev_timer.
+ *
+ */
+#pragma once
+
+#include <config.h>
+
+/** Resolution of the timer wheel in seconds. Timers fire up to one tick
+ * later than requested, but never earlier. */
+#define TIMER_WHEEL_TICK 0.05
+
+typedef struct wheel_timer wheel_timer;
+typedef void (*wheel_timer_cb)(wheel_timer *timer);
+
+struct wheel_timer {
+    wheel_timer_cb cb;
+    void *data;
+
+    /* The following fields are private to timer_wheel.c. */
+    bool active;
+    /** How many more times the slot of this timer has to come around before
+     * the timer fires. */
+    uint32_t rounds;
+    LIST_ENTRY(wheel_timer) timers;
+};
+
+/**
+ * Initializes the given timer, which calls cb (with timer->data set to data)
+ * once it fires. The timer is not started.
+ *
+ */
+void wheel_timer_init(wheel_timer *timer, wheel_timer_cb cb, void *data);
+
+/**
+ * Starts the given timer so that it fires after the given number of seconds.
+ * A timer which is already running is restarted.
+ *
+ */
+void wheel_timer_start(wheel_timer *timer, ev_tstamp after);
+
+/**
+ * Stops the given timer if it is running. The timer may be freed afterwards.
+ *
+ */
+void wheel_timer_stop(wheel_timer *timer);
@@ -17,6 +17,13 @@ extern Con *croot;
 extern Con *focused;
 TAILQ_HEAD(all_cons_head, Con);
 extern struct all_cons_head all_cons;
+/* All containers whose sticky flag is set, see con_set_sticky(). */
+TAILQ_HEAD(sticky_cons_head, Con);
+extern struct sticky_cons_head sticky_cons;
+/* All scratchpad containers (shown or not), in the order in which they were
+ * moved to the scratchpad, see con_set_scratchpad_state(). */
+TAILQ_HEAD(scratchpad_cons_head, Con);
+extern struct scratchpad_cons_head scratchpad_cons;
 
 /**
  * Initializes the tree by creating the root node, adding all RandR outputs
@@ -58,6 +65,58 @@ bool level_down(void);
  */
 void tree_render(void);
 
+/**
+ * Marks the tree as needing to be rendered. The render happens once at the
+ * end of the current event loop iteration (see tree_render_flush()), no
+ * matter how many times this function was called.
+ *
+ */
+void tree_schedule_render(void);
+
+/**
+ * Marks the given output as needing to be rendered. Unlike
+ * tree_schedule_render(), only this output (and the floating windows, which
+ * need to stay on top of it) will be rendered, unless the whole tree is
+ * scheduled for rendering as well. Used for changes which cannot affect any
+ * other output, like a dock client changing its height.
+ *
+ */
+void tree_schedule_render_output(Con *output);
+
+/**
+ * Renders the tree if tree_schedule_render() was called since the last render.
+ * Called from the ev_prepare hook, and by code which needs X11 to reflect the
+ * current state of the tree right away (like the I3_SYNC protocol).
+ *
+ */
+void tree_render_flush(void);
+
+/**
+ * Like tree_render_flush(), but with render_pacing refresh, the tree is
+ * rendered at most once per refresh interval of the outputs: states which
+ * would be replaced before the screen could show them are never pushed to
+ * X11. Returns false when the render was postponed; a timer wakes up the
+ * event loop once it is due.
+ *
+ */
+bool tree_render_flush_paced(void);
+
+/**
+ * Returns whether tree_schedule_render() or tree_schedule_render_output() was
+ * called since the last render.
+ *
+ */
+bool tree_render_is_scheduled(void);
+
+/**
+ * Returns true if focusing the given container (instead of the currently
+ * focused one) only changes decorations and the input focus, not the layout.
+ * In that case, the focus change can be displayed using x_push_changes()
+ * without the render_con() pass of tree_render().
+ *
+ */
+bool tree_focus_change_is_cosmetic(Con *con);
+
 /**
  * Changes focus in the given way (next/previous) and given orientation
  * (horizontal/vertical).
@@ -65,6 +124,23 @@ void tree_render(void);
  */
 void tree_next(char way, orientation_t orientation);
 
+/**
+ * Starts a bulk close: until tree_close_end() is called, tree_close_internal()
+ * neither renders after each container nor cleans up the parents which might
+ * have become empty. Used when many containers are closed at once, e.g. by
+ * 'kill' with criteria matching many windows, or by the UnmapNotify events
+ * which follow.
+ *
+ */
+void tree_close_begin(void);
+
+/**
+ * Ends a bulk close: cleans up the parents of the closed containers (which
+ * might close further containers) and renders once if anything was closed.
+ *
+ */
+void tree_close_end(void);
+
 /**
  * Closes the given container including all children.
  * Returns true if the container was killed or false if just WM_DELETE was sent
@@ -82,6 +158,13 @@ bool tree_close_internal(Con *con, kill_window_t kill_window, bool dont_kill_par
  */
 bool tree_restore(const char *path, xcb_get_geometry_reply_t *geometry);
 
+/**
+ * Loads the tree from the layout which the previous process passed in fd
+ * (used for in-place restarts, see store_restart_layout()).
+ *
+ */
+bool tree_restore_fd(int fd, xcb_get_geometry_reply_t *geometry);
+
 /**
  * tree_flatten() removes pairs of redundant split containers, e.g.:
  *       [workspace, horizontal]
@@ -96,3 +179,12 @@ bool tree_restore(const char *path, xcb_get_geometry_reply_t *geometry);
  *
  */
 void tree_flatten(Con *child);
+
+/**
+ * Like tree_flatten(), but only checks the containers whose redundancy can
+ * have changed when con was moved, lost a child or changed its layout: the
+ * children of con, con itself and its ancestors up to the workspace. Does
+ * nothing if con was closed in the meantime.
+ *
+ */
+void tree_flatten_around(Con *con);
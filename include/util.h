@@ -175,6 +175,13 @@ bool parse_long(const char *str, long *out, int base);
  */
 ssize_t slurp(const char *path, char **buf);
 
+/**
+ * Like slurp(), but reads the (regular or memory) file referred to by fd, from
+ * its beginning and regardless of the current offset.
+ *
+ */
+ssize_t slurp_fd(int fd, char **buf);
+
 /**
  * Convert a direction to its corresponding orientation.
  *
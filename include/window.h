@@ -11,6 +11,12 @@
 
 #include <config.h>
 
+/**
+ * Allocates a new, zero-initialized i3Window, to be freed with window_free().
+ *
+ */
+i3Window *window_new(void);
+
 /**
  * Frees an i3Window and all its members.
  *
@@ -82,6 +88,21 @@ bool window_update_normal_hints(i3Window *win, xcb_get_property_reply_t *reply,
  */
 void window_update_hints(i3Window *win, xcb_get_property_reply_t *prop, bool *urgency_hint);
 
+/**
+ * Updates the supported protocols (WM_TAKE_FOCUS, WM_DELETE_WINDOW and
+ * _NET_WM_SYNC_REQUEST) from WM_PROTOCOLS.
+ *
+ */
+void window_update_protocols(i3Window *win, xcb_get_property_reply_t *prop);
+
+/**
+ * Updates the XSync counter of _NET_WM_SYNC_REQUEST_COUNTER. If the property
+ * holds two counters (extended synchronization), we only use the first one,
+ * which implements basic synchronization.
+ *
+ */
+void window_update_sync_counter(i3Window *win, xcb_get_property_reply_t *prop);
+
 /**
  * Updates the MOTIF_WM_HINTS. The container's border style should be set to
  * `motif_border_style' if border style is not BS_NORMAL.
@@ -31,6 +31,13 @@
  */
 extern char *previous_workspace_name;
 
+/**
+ * Marks the workspace lookup indexes as outdated. Needs to be called whenever
+ * workspaces are added, removed, renamed, renumbered or reordered.
+ *
+ */
+void workspace_index_invalidate(void);
+
 /**
  * Returns the workspace with the given name or NULL if such a workspace does
  * not exist.
@@ -52,6 +59,21 @@ Con *get_existing_workspace_by_num(int num);
  */
 bool output_triggers_assignment(Output *output, struct Workspace_Assignment *assignment);
 
+/**
+ * Returns the workspace assignments which trigger for the given output (see
+ * output_triggers_assignment()), in the order of the 'ws_assignments' queue.
+ * The returned array is NULL-terminated and must be freed by the caller.
+ *
+ */
+struct Workspace_Assignment **ws_assignments_for_output(Output *output);
+
+/**
+ * Marks the workspace assignment lookup indexes as outdated. Needs to be called
+ * whenever the ws_assignments queue changes.
+ *
+ */
+void ws_assignment_index_invalidate(void);
+
 /**
  * Returns a pointer to the workspace with the given number (starting at 0),
  * creating the workspace if necessary (by allocating the necessary amount of
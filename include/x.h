@@ -19,9 +19,22 @@ extern xcb_window_t focused_id;
  * Initializes the X11 part for the given container. Called exactly once for
  * every container from con_new().
  *
+ * Only the ID of the frame window is generated here, so that the container
+ * can be found by its frame and its state is tracked right away. The window
+ * itself is created by x_con_create_frame() once the container shows
+ * something, which many split containers and workspaces never do.
+ *
  */
 void x_con_init(Con *con);
 
+/**
+ * Creates the frame window of the given container, unless it exists already
+ * (see x_con_init()). This needs to happen before a client window is
+ * reparented into the frame.
+ *
+ */
+void x_con_create_frame(Con *con);
+
 /**
  * Moves a child window from Container src to Container dest.
  *
@@ -49,23 +62,41 @@ void x_reinit(Con *con);
  */
 void x_con_kill(Con *con);
 
-/*
- * Completely reinitializes the container's frame, without destroying the old window.
+/**
+ * Completely reinitializes the container's frame, without destroying the old
+ * window. Returns the old frame, which the caller needs to destroy, or
+ * XCB_NONE if it was never created.
  *
  */
-void x_con_reframe(Con *con);
+xcb_window_t x_con_reframe(Con *con);
 
 /**
- * Returns true if the client supports the given protocol atom (like WM_DELETE_WINDOW)
+ * Frees the cached title rendering of the given container (e.g. because the
+ * font changed). It will be re-rendered on the next decoration redraw.
  *
  */
-bool window_supports_protocol(xcb_window_t window, xcb_atom_t atom);
+void x_free_title_cache(Con *con);
 
 /**
  * Kills the given X11 window using WM_DELETE_WINDOW (if supported).
  *
  */
-void x_window_kill(xcb_window_t window, kill_window_t kill_window);
+void x_window_kill(i3Window *win, kill_window_t kill_window);
+
+/**
+ * Records that the given area of the container’s frame_buffer was drawn to,
+ * so that x_flush_frame() copies it to the frame. Once FRAME_DAMAGE_RECTS
+ * areas are recorded, the new area is merged with the one whose bounding box
+ * grows the least, which keeps e.g. the four borders of a window apart.
+ *
+ */
+void x_damage_frame(Con *con, int x, int y, int width, int height);
+
+/**
+ * Copies the damaged areas of the container’s frame_buffer to its frame.
+ *
+ */
+void x_flush_frame(Con *con);
 
 /**
  * Draws the decoration of the given container onto its parent.
@@ -118,11 +149,21 @@ void x_set_name(Con *con, const char *name);
 void update_shmlog_atom(void);
 
 /**
- * Sets up i3 specific atoms (I3_SOCKET_PATH and I3_CONFIG_PATH)
+ * Sets up i3 specific atoms (I3_SOCKET_PATH, I3_CONFIG_PATH and I3_STATE_PATH)
  *
  */
 void x_set_i3_atoms(void);
 
+/**
+ * Starts a workspace switch: the next x_push_changes() sends all of its
+ * requests to X11 at once (inside a server grab if workspace_switch_grab_server
+ * is enabled) and updates _NET_CURRENT_DESKTOP afterwards. IPC messages are
+ * held until then. Schedules a render, so that the switch is always
+ * completed.
+ *
+ */
+void x_begin_workspace_switch(void);
+
 /**
  * Set warp_to coordinates.  This will trigger on the next call to
  * x_push_changes().
@@ -130,6 +171,14 @@ void x_set_i3_atoms(void);
  */
 void x_set_warp_to(Rect *rect);
 
+/**
+ * Records the pointer position reported by an event (KeyPress, ButtonPress,
+ * MotionNotify, EnterNotify) with the given timestamp, so that
+ * x_push_changes() does not need to query it for warping.
+ *
+ */
+void x_set_pointer_position(int16_t root_x, int16_t root_y, xcb_timestamp_t time);
+
 /**
  * Applies the given mask to the event mask of every i3 window decoration X11
  * window. This is useful to disable EnterNotify while resizing so that focus
@@ -0,0 +1,132 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * x_requests.h: Accounting of the X11 requests issued by i3. Every xcb
+ *               function i3 uses to send a request is wrapped by a macro of
+ *               the same name which counts the request by its type (see
+ *               x_requests.xmacro, requests of extensions are counted per
+ *               extension) and the current subsystem (see stats_x_enter()).
+ *               The functions which wait for a reply count a round trip.
+ *
+ *               This file has to be included after all xcb headers, which is
+ *               why it is the last one in all.h. Requests sent by libi3 and
+ *               cairo (for example when drawing decorations) are not counted.
+ *
+ */
+#pragma once
+
+#include <config.h>
+
+#define X_REQUEST(type, call) (stats_x_request(STATS_X_REQUEST_##type), call)
+#define X_ROUND_TRIP(call) (stats_x_round_trip(), call)
+
+#define xcb_change_property(...) X_REQUEST(change_property, xcb_change_property(__VA_ARGS__))
+#define xcb_delete_property(...) X_REQUEST(delete_property, xcb_delete_property(__VA_ARGS__))
+#define xcb_get_property(...) X_REQUEST(get_property, xcb_get_property(__VA_ARGS__))
+#define xcb_get_property_unchecked(...) X_REQUEST(get_property, xcb_get_property_unchecked(__VA_ARGS__))
+#define xcb_change_window_attributes(...) X_REQUEST(change_window_attributes, xcb_change_window_attributes(__VA_ARGS__))
+#define xcb_change_window_attributes_checked(...) X_REQUEST(change_window_attributes, xcb_change_window_attributes_checked(__VA_ARGS__))
+#define xcb_get_window_attributes(...) X_REQUEST(get_window_attributes, xcb_get_window_attributes(__VA_ARGS__))
+#define xcb_get_window_attributes_unchecked(...) X_REQUEST(get_window_attributes, xcb_get_window_attributes_unchecked(__VA_ARGS__))
+#define xcb_configure_window(...) X_REQUEST(configure_window, xcb_configure_window(__VA_ARGS__))
+#define xcb_circulate_window(...) X_REQUEST(circulate_window, xcb_circulate_window(__VA_ARGS__))
+#define xcb_map_window(...) X_REQUEST(map_window, xcb_map_window(__VA_ARGS__))
+#define xcb_unmap_window(...) X_REQUEST(unmap_window, xcb_unmap_window(__VA_ARGS__))
+#define xcb_create_window(...) X_REQUEST(create_window, xcb_create_window(__VA_ARGS__))
+#define xcb_destroy_window(...) X_REQUEST(destroy_window, xcb_destroy_window(__VA_ARGS__))
+#define xcb_reparent_window(...) X_REQUEST(reparent_window, xcb_reparent_window(__VA_ARGS__))
+#define xcb_change_save_set(...) X_REQUEST(change_save_set, xcb_change_save_set(__VA_ARGS__))
+#define xcb_send_event(...) X_REQUEST(send_event, xcb_send_event(__VA_ARGS__))
+#define xcb_set_input_focus(...) X_REQUEST(set_input_focus, xcb_set_input_focus(__VA_ARGS__))
+#define xcb_get_input_focus(...) X_REQUEST(get_input_focus, xcb_get_input_focus(__VA_ARGS__))
+#define xcb_grab_key(...) X_REQUEST(grab_key, xcb_grab_key(__VA_ARGS__))
+#define xcb_ungrab_key(...) X_REQUEST(ungrab_key, xcb_ungrab_key(__VA_ARGS__))
+#define xcb_grab_button(...) X_REQUEST(grab_button, xcb_grab_button(__VA_ARGS__))
+#define xcb_ungrab_button(...) X_REQUEST(ungrab_button, xcb_ungrab_button(__VA_ARGS__))
+#define xcb_grab_pointer(...) X_REQUEST(grab_pointer, xcb_grab_pointer(__VA_ARGS__))
+#define xcb_ungrab_pointer(...) X_REQUEST(ungrab_pointer, xcb_ungrab_pointer(__VA_ARGS__))
+#define xcb_grab_keyboard(...) X_REQUEST(grab_keyboard, xcb_grab_keyboard(__VA_ARGS__))
+#define xcb_ungrab_keyboard(...) X_REQUEST(ungrab_keyboard, xcb_ungrab_keyboard(__VA_ARGS__))
+#define xcb_allow_events(...) X_REQUEST(allow_events, xcb_allow_events(__VA_ARGS__))
+#define xcb_grab_server(...) X_REQUEST(grab_server, xcb_grab_server(__VA_ARGS__))
+#define xcb_ungrab_server(...) X_REQUEST(ungrab_server, xcb_ungrab_server(__VA_ARGS__))
+#define xcb_warp_pointer(...) X_REQUEST(warp_pointer, xcb_warp_pointer(__VA_ARGS__))
+#define xcb_query_pointer(...) X_REQUEST(query_pointer, xcb_query_pointer(__VA_ARGS__))
+#define xcb_query_tree(...) X_REQUEST(query_tree, xcb_query_tree(__VA_ARGS__))
+#define xcb_get_geometry(...) X_REQUEST(get_geometry, xcb_get_geometry(__VA_ARGS__))
+#define xcb_intern_atom(...) X_REQUEST(intern_atom, xcb_intern_atom(__VA_ARGS__))
+#define xcb_get_atom_name(...) X_REQUEST(get_atom_name, xcb_get_atom_name(__VA_ARGS__))
+#define xcb_kill_client(...) X_REQUEST(kill_client, xcb_kill_client(__VA_ARGS__))
+#define xcb_create_pixmap(...) X_REQUEST(create_pixmap, xcb_create_pixmap(__VA_ARGS__))
+#define xcb_free_pixmap(...) X_REQUEST(free_pixmap, xcb_free_pixmap(__VA_ARGS__))
+#define xcb_create_gc(...) X_REQUEST(create_gc, xcb_create_gc(__VA_ARGS__))
+#define xcb_change_gc(...) X_REQUEST(change_gc, xcb_change_gc(__VA_ARGS__))
+#define xcb_free_gc(...) X_REQUEST(free_gc, xcb_free_gc(__VA_ARGS__))
+#define xcb_copy_area(...) X_REQUEST(copy_area, xcb_copy_area(__VA_ARGS__))
+#define xcb_create_colormap(...) X_REQUEST(create_colormap, xcb_create_colormap(__VA_ARGS__))
+#define xcb_create_colormap_checked(...) X_REQUEST(create_colormap, xcb_create_colormap_checked(__VA_ARGS__))
+#define xcb_free_colormap(...) X_REQUEST(free_colormap, xcb_free_colormap(__VA_ARGS__))
+#define xcb_create_glyph_cursor(...) X_REQUEST(create_glyph_cursor, xcb_create_glyph_cursor(__VA_ARGS__))
+#define xcb_free_cursor(...) X_REQUEST(free_cursor, xcb_free_cursor(__VA_ARGS__))
+#define xcb_no_operation(...) X_REQUEST(no_operation, xcb_no_operation(__VA_ARGS__))
+
+/* The ICCCM helpers send GetProperty and ChangeProperty requests. */
+#define xcb_icccm_get_wm_protocols(...) X_REQUEST(get_property, xcb_icccm_get_wm_protocols(__VA_ARGS__))
+#define xcb_icccm_get_wm_hints(...) X_REQUEST(get_property, xcb_icccm_get_wm_hints(__VA_ARGS__))
+#define xcb_icccm_get_wm_normal_hints(...) X_REQUEST(get_property, xcb_icccm_get_wm_normal_hints(__VA_ARGS__))
+#define xcb_icccm_get_wm_normal_hints_unchecked(...) X_REQUEST(get_property, xcb_icccm_get_wm_normal_hints_unchecked(__VA_ARGS__))
+#define xcb_icccm_set_wm_hints(...) X_REQUEST(change_property, xcb_icccm_set_wm_hints(__VA_ARGS__))
+
+#define xcb_randr_select_input(...) X_REQUEST(randr, xcb_randr_select_input(__VA_ARGS__))
+#define xcb_randr_query_version(...) X_REQUEST(randr, xcb_randr_query_version(__VA_ARGS__))
+#define xcb_randr_get_screen_resources_current(...) X_REQUEST(randr, xcb_randr_get_screen_resources_current(__VA_ARGS__))
+#define xcb_randr_get_output_info(...) X_REQUEST(randr, xcb_randr_get_output_info(__VA_ARGS__))
+#define xcb_randr_get_output_primary(...) X_REQUEST(randr, xcb_randr_get_output_primary(__VA_ARGS__))
+#define xcb_randr_get_crtc_info(...) X_REQUEST(randr, xcb_randr_get_crtc_info(__VA_ARGS__))
+#define xcb_randr_get_monitors(...) X_REQUEST(randr, xcb_randr_get_monitors(__VA_ARGS__))
+
+#define xcb_shape_select_input(...) X_REQUEST(shape, xcb_shape_select_input(__VA_ARGS__))
+#define xcb_shape_query_version(...) X_REQUEST(shape, xcb_shape_query_version(__VA_ARGS__))
+#define xcb_shape_query_extents(...) X_REQUEST(shape, xcb_shape_query_extents(__VA_ARGS__))
+#define xcb_shape_rectangles(...) X_REQUEST(shape, xcb_shape_rectangles(__VA_ARGS__))
+#define xcb_shape_mask(...) X_REQUEST(shape, xcb_shape_mask(__VA_ARGS__))
+#define xcb_shape_combine(...) X_REQUEST(shape, xcb_shape_combine(__VA_ARGS__))
+
+#define xcb_sync_initialize(...) X_REQUEST(sync, xcb_sync_initialize(__VA_ARGS__))
+#define xcb_sync_create_alarm_aux(...) X_REQUEST(sync, xcb_sync_create_alarm_aux(__VA_ARGS__))
+#define xcb_sync_change_alarm_aux(...) X_REQUEST(sync, xcb_sync_change_alarm_aux(__VA_ARGS__))
+#define xcb_sync_destroy_alarm(...) X_REQUEST(sync, xcb_sync_destroy_alarm(__VA_ARGS__))
+
+#define xcb_xkb_use_extension(...) X_REQUEST(xkb, xcb_xkb_use_extension(__VA_ARGS__))
+#define xcb_xkb_select_events(...) X_REQUEST(xkb, xcb_xkb_select_events(__VA_ARGS__))
+#define xcb_xkb_per_client_flags(...) X_REQUEST(xkb, xcb_xkb_per_client_flags(__VA_ARGS__))
+
+/* Waiting for a reply. xcb_aux_sync() sends a GetInputFocus request and waits
+ * for its reply, xcb_request_check() might do the same. */
+#define xcb_aux_sync(...) X_ROUND_TRIP(X_REQUEST(get_input_focus, xcb_aux_sync(__VA_ARGS__)))
+#define xcb_request_check(...) X_ROUND_TRIP(xcb_request_check(__VA_ARGS__))
+#define xcb_get_property_reply(...) X_ROUND_TRIP(xcb_get_property_reply(__VA_ARGS__))
+#define xcb_get_window_attributes_reply(...) X_ROUND_TRIP(xcb_get_window_attributes_reply(__VA_ARGS__))
+#define xcb_get_input_focus_reply(...) X_ROUND_TRIP(xcb_get_input_focus_reply(__VA_ARGS__))
+#define xcb_grab_pointer_reply(...) X_ROUND_TRIP(xcb_grab_pointer_reply(__VA_ARGS__))
+#define xcb_grab_keyboard_reply(...) X_ROUND_TRIP(xcb_grab_keyboard_reply(__VA_ARGS__))
+#define xcb_query_pointer_reply(...) X_ROUND_TRIP(xcb_query_pointer_reply(__VA_ARGS__))
+#define xcb_query_tree_reply(...) X_ROUND_TRIP(xcb_query_tree_reply(__VA_ARGS__))
+#define xcb_get_geometry_reply(...) X_ROUND_TRIP(xcb_get_geometry_reply(__VA_ARGS__))
+#define xcb_intern_atom_reply(...) X_ROUND_TRIP(xcb_intern_atom_reply(__VA_ARGS__))
+#define xcb_get_atom_name_reply(...) X_ROUND_TRIP(xcb_get_atom_name_reply(__VA_ARGS__))
+#define xcb_icccm_get_wm_protocols_reply(...) X_ROUND_TRIP(xcb_icccm_get_wm_protocols_reply(__VA_ARGS__))
+#define xcb_icccm_get_wm_normal_hints_reply(...) X_ROUND_TRIP(xcb_icccm_get_wm_normal_hints_reply(__VA_ARGS__))
+#define xcb_randr_query_version_reply(...) X_ROUND_TRIP(xcb_randr_query_version_reply(__VA_ARGS__))
+#define xcb_randr_get_screen_resources_current_reply(...) X_ROUND_TRIP(xcb_randr_get_screen_resources_current_reply(__VA_ARGS__))
+#define xcb_randr_get_output_info_reply(...) X_ROUND_TRIP(xcb_randr_get_output_info_reply(__VA_ARGS__))
+#define xcb_randr_get_output_primary_reply(...) X_ROUND_TRIP(xcb_randr_get_output_primary_reply(__VA_ARGS__))
+#define xcb_randr_get_crtc_info_reply(...) X_ROUND_TRIP(xcb_randr_get_crtc_info_reply(__VA_ARGS__))
+#define xcb_randr_get_monitors_reply(...) X_ROUND_TRIP(xcb_randr_get_monitors_reply(__VA_ARGS__))
+#define xcb_shape_query_version_reply(...) X_ROUND_TRIP(xcb_shape_query_version_reply(__VA_ARGS__))
+#define xcb_shape_query_extents_reply(...) X_ROUND_TRIP(xcb_shape_query_extents_reply(__VA_ARGS__))
+#define xcb_sync_initialize_reply(...) X_ROUND_TRIP(xcb_sync_initialize_reply(__VA_ARGS__))
+#define xcb_xkb_per_client_flags_reply(...) X_ROUND_TRIP(xcb_xkb_per_client_flags_reply(__VA_ARGS__))
@@ -70,10 +70,21 @@ extern unsigned int xcb_numlock_mask;
 xcb_window_t create_window(xcb_connection_t *conn, Rect r, uint16_t depth, xcb_visualid_t visual,
                            uint16_t window_class, enum xcursor_cursor_t cursor, bool map, uint32_t mask, uint32_t *values);
 
+/**
+ * Like create_window(), but uses an ID which was generated before, for windows
+ * which are referred to before they are created (see x_con_init()).
+ *
+ */
+void create_window_with_id(xcb_connection_t *conn, xcb_window_t id, Rect r, uint16_t depth, xcb_visualid_t visual,
+                           uint16_t window_class, enum xcursor_cursor_t cursor, bool map, uint32_t mask, uint32_t *values);
+
 /**
  * Generates a configure_notify_event with absolute coordinates (relative to
  * the X root window, not to the client’s frame) for the given client.
  *
+ * The event is only sent when the geometry differs from the one of the last
+ * event sent to the client.
+ *
  */
 void fake_absolute_configure_notify(Con *con);
 
@@ -15,9 +15,20 @@
 #include <yajl/yajl_parse.h>
 #include <yajl/yajl_version.h>
 
-/* Shorter names for all those yajl_gen_* functions */
-#define y(x, ...) yajl_gen_##x(gen, ##__VA_ARGS__)
-#define ystr(str) yajl_gen_string(gen, (unsigned char *)str, strlen(str))
+#include "libi3.h"
+
+/* Shorter names for all those yajl_gen_* functions. Values go through the
+ * ygen_* functions (see libi3.h), which also generate them as CBOR when a CBOR
+ * generator is attached to gen. */
+#define y(x, ...) ygen_##x(gen, ##__VA_ARGS__)
+#define ystr(str) ygen_string(gen, (unsigned char *)str, strlen(str))
+
+/* Functions which do not generate values are used directly. */
+#define ygen_get_buf yajl_gen_get_buf
+#define ygen_clear yajl_gen_clear
+#define ygen_reset yajl_gen_reset
+#define ygen_config yajl_gen_config
+#define ygen_free yajl_gen_free
 
 #define ygenalloc() yajl_gen_alloc(NULL)
 #define yalloc(callbacks, client) yajl_alloc(callbacks, NULL, client)
@@ -0,0 +1,152 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * arena.c: A bump allocator for short-lived allocations (like the tokens of a
+ *          single parser run), which are all released in one step.
+ *
+ */
+#include "libi3.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/* The size of a regular block. Larger allocations get a block of their own. */
+#define ARENA_BLOCK_SIZE 4096
+
+/* Allocations are aligned suitably for any of these. */
+union arena_align {
+    void *ptr;
+    long long num;
+    double dbl;
+};
+
+#define ARENA_ALIGN sizeof(union arena_align)
+
+struct arena_block {
+    struct arena_block *prev;
+    size_t size;
+    size_t used;
+    union arena_align data[];
+};
+
+struct arena {
+    /* The block allocations are currently taken from. */
+    struct arena_block *current;
+    /* One released regular block is kept around, so that a steady stream of
+     * small parses does not allocate at all. */
+    struct arena_block *spare;
+};
+
+static struct arena_block *block_new(size_t size) {
+    struct arena_block *block = smalloc(sizeof(struct arena_block) + size);
+    block->prev = NULL;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+static void block_release(arena_t *arena, struct arena_block *block) {
+    if (arena->spare == NULL && block->size == ARENA_BLOCK_SIZE) {
+        arena->spare = block;
+        return;
+    }
+    free(block);
+}
+
+/*
+ * Creates a new, empty arena.
+ *
+ */
+arena_t *arena_new(void) {
+    return scalloc(1, sizeof(arena_t));
+}
+
+/*
+ * Frees the arena and everything allocated from it.
+ *
+ */
+void arena_free(arena_t *arena) {
+    if (arena == NULL) {
+        return;
+    }
+    arena_release(arena, (arena_mark_t){NULL, 0});
+    free(arena->spare);
+    free(arena);
+}
+
+/*
+ * Returns size bytes of uninitialized memory, which stay valid until the arena
+ * is released to a mark taken before this call. Never returns NULL.
+ *
+ */
+void *arena_alloc(arena_t *arena, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    struct arena_block *block = arena->current;
+    if (block == NULL || block->size - block->used < size) {
+        if (size > ARENA_BLOCK_SIZE) {
+            block = block_new(size);
+        } else if (arena->spare != NULL) {
+            block = arena->spare;
+            arena->spare = NULL;
+            block->used = 0;
+        } else {
+            block = block_new(ARENA_BLOCK_SIZE);
+        }
+        block->prev = arena->current;
+        arena->current = block;
+    }
+    void *result = (char *)block->data + block->used;
+    block->used += size;
+    return result;
+}
+
+/*
+ * Copies the first len bytes of str into the arena and NUL-terminates them.
+ *
+ */
+char *arena_strndup(arena_t *arena, const char *str, size_t len) {
+    char *result = arena_alloc(arena, len + 1);
+    memcpy(result, str, len);
+    result[len] = '\0';
+    return result;
+}
+
+/*
+ * Copies str into the arena.
+ *
+ */
+char *arena_strdup(arena_t *arena, const char *str) {
+    return arena_strndup(arena, str, strlen(str));
+}
+
+/*
+ * Returns the current position of the arena, to be passed to arena_release()
+ * later on. Marks nest: releasing to a mark invalidates all later marks.
+ *
+ */
+arena_mark_t arena_mark(arena_t *arena) {
+    arena_mark_t mark = {arena->current, 0};
+    if (arena->current != NULL) {
+        mark.used = arena->current->used;
+    }
+    return mark;
+}
+
+/*
+ * Releases everything allocated from the arena since the given mark was taken.
+ *
+ */
+void arena_release(arena_t *arena, arena_mark_t mark) {
+    while (arena->current != mark.block) {
+        struct arena_block *block = arena->current;
+        arena->current = block->prev;
+        block_release(arena, block);
+    }
+    if (arena->current != NULL) {
+        arena->current->used = mark.used;
+    }
+}
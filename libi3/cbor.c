@@ -0,0 +1,564 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * cbor.c: Generates CBOR (RFC 7049) along with JSON and converts IPC payloads
+ *         between both. Maps and arrays are encoded with indefinite length,
+ *         so that they can be generated in a single pass, just like JSON.
+ *
+ */
+#include "libi3.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <yajl/yajl_gen.h>
+#include <yajl/yajl_parse.h>
+
+/* Nesting limit for decoding, protecting the stack from malicious input. */
+#define CBOR_MAX_DEPTH 256
+
+#define CBOR_UINT 0
+#define CBOR_NEGINT 1
+#define CBOR_BYTES 2
+#define CBOR_TEXT 3
+#define CBOR_ARRAY 4
+#define CBOR_MAP 5
+#define CBOR_SIMPLE 7
+
+#define CBOR_FALSE 0xf4
+#define CBOR_TRUE 0xf5
+#define CBOR_NULL 0xf6
+#define CBOR_DOUBLE 0xfb
+#define CBOR_ARRAY_START 0x9f
+#define CBOR_MAP_START 0xbf
+#define CBOR_BREAK 0xff
+
+struct cbor_gen {
+    uint8_t *data;
+    size_t len;
+    size_t size;
+};
+
+static void cbor_append(cbor_gen_t *buf, const void *data, size_t len) {
+    if (buf->len + len > buf->size) {
+        while (buf->len + len > buf->size)
+            buf->size = (buf->size == 0 ? 1024 : buf->size * 2);
+        buf->data = srealloc(buf->data, buf->size);
+    }
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+}
+
+static void cbor_append_byte(cbor_gen_t *buf, uint8_t byte) {
+    cbor_append(buf, &byte, 1);
+}
+
+/*
+ * Appends the initial byte of a data item with the given major type and
+ * argument, followed by the argument in the shortest big-endian form.
+ *
+ */
+static void cbor_append_head(cbor_gen_t *buf, uint8_t major, uint64_t value) {
+    uint8_t head[9];
+    size_t len;
+    if (value < 24) {
+        head[0] = (major << 5) | value;
+        len = 1;
+    } else if (value <= UINT8_MAX) {
+        head[0] = (major << 5) | 24;
+        len = 2;
+    } else if (value <= UINT16_MAX) {
+        head[0] = (major << 5) | 25;
+        len = 3;
+    } else if (value <= UINT32_MAX) {
+        head[0] = (major << 5) | 26;
+        len = 5;
+    } else {
+        head[0] = (major << 5) | 27;
+        len = 9;
+    }
+    for (size_t i = len - 1; i > 0; i--) {
+        head[i] = value & 0xff;
+        value >>= 8;
+    }
+    cbor_append(buf, head, len);
+}
+
+/*
+ * Returns a new, empty CBOR generator.
+ *
+ */
+cbor_gen_t *cbor_gen_alloc(void) {
+    return scalloc(1, sizeof(cbor_gen_t));
+}
+
+/*
+ * Frees the given CBOR generator and its buffer.
+ *
+ */
+void cbor_gen_free(cbor_gen_t *gen) {
+    free(gen->data);
+    free(gen);
+}
+
+/*
+ * Empties the buffer of the given CBOR generator (keeping its allocation), so
+ * that it can generate the next data item.
+ *
+ */
+void cbor_gen_clear(cbor_gen_t *gen) {
+    gen->len = 0;
+}
+
+/*
+ * Returns the data generated so far and stores its length in len. The buffer
+ * belongs to the generator.
+ *
+ */
+const uint8_t *cbor_gen_get_buf(cbor_gen_t *gen, size_t *len) {
+    *len = gen->len;
+    return gen->data;
+}
+
+static void cbor_gen_null(cbor_gen_t *gen) {
+    cbor_append_byte(gen, CBOR_NULL);
+}
+
+static void cbor_gen_bool(cbor_gen_t *gen, int val) {
+    cbor_append_byte(gen, (val ? CBOR_TRUE : CBOR_FALSE));
+}
+
+static void cbor_gen_integer(cbor_gen_t *gen, long long val) {
+    if (val >= 0)
+        cbor_append_head(gen, CBOR_UINT, (uint64_t)val);
+    else
+        cbor_append_head(gen, CBOR_NEGINT, (uint64_t)(-1 - val));
+}
+
+static void cbor_gen_double(cbor_gen_t *gen, double val) {
+    uint64_t bits;
+    memcpy(&bits, &val, sizeof(bits));
+    uint8_t data[9];
+    data[0] = CBOR_DOUBLE;
+    for (int i = 8; i > 0; i--) {
+        data[i] = bits & 0xff;
+        bits >>= 8;
+    }
+    cbor_append(gen, data, sizeof(data));
+}
+
+static void cbor_gen_string(cbor_gen_t *gen, const unsigned char *val, size_t len) {
+    cbor_append_head(gen, CBOR_TEXT, len);
+    cbor_append(gen, val, len);
+}
+
+static int json_null_cb(void *extra) {
+    cbor_gen_null(extra);
+    return 1;
+}
+
+static int json_boolean_cb(void *extra, int val) {
+    cbor_gen_bool(extra, val);
+    return 1;
+}
+
+static int json_integer_cb(void *extra, long long val) {
+    cbor_gen_integer(extra, val);
+    return 1;
+}
+
+static int json_double_cb(void *extra, double val) {
+    cbor_gen_double(extra, val);
+    return 1;
+}
+
+static int json_string_cb(void *extra, const unsigned char *val, size_t len) {
+    cbor_gen_string(extra, val, len);
+    return 1;
+}
+
+static int json_start_map_cb(void *extra) {
+    cbor_append_byte(extra, CBOR_MAP_START);
+    return 1;
+}
+
+static int json_start_array_cb(void *extra) {
+    cbor_append_byte(extra, CBOR_ARRAY_START);
+    return 1;
+}
+
+static int json_end_cb(void *extra) {
+    cbor_append_byte(extra, CBOR_BREAK);
+    return 1;
+}
+
+/*
+ * Converts the given JSON document to CBOR. Returns a newly allocated buffer
+ * and stores its length in cbor_len, or returns NULL if the JSON could not be
+ * parsed.
+ *
+ */
+uint8_t *json_to_cbor(const uint8_t *json, size_t json_len, size_t *cbor_len) {
+    static yajl_callbacks callbacks = {
+        .yajl_null = json_null_cb,
+        .yajl_boolean = json_boolean_cb,
+        .yajl_integer = json_integer_cb,
+        .yajl_double = json_double_cb,
+        .yajl_string = json_string_cb,
+        .yajl_start_map = json_start_map_cb,
+        .yajl_map_key = json_string_cb,
+        .yajl_end_map = json_end_cb,
+        .yajl_start_array = json_start_array_cb,
+        .yajl_end_array = json_end_cb,
+    };
+
+    cbor_gen_t buf = {NULL, 0, 0};
+    yajl_handle handle = yajl_alloc(&callbacks, NULL, &buf);
+    yajl_status state = yajl_parse(handle, json, json_len);
+    if (state == yajl_status_ok)
+        state = yajl_complete_parse(handle);
+    yajl_free(handle);
+
+    if (state != yajl_status_ok) {
+        free(buf.data);
+        return NULL;
+    }
+    *cbor_len = buf.len;
+    return buf.data;
+}
+
+/* The JSON generators to which a CBOR generator is attached, see
+ * ygen_attach_cbor(). Only a few documents are generated at the same time, so
+ * they are searched linearly. */
+#define YGEN_MAX_ATTACHED 8
+
+static struct {
+    yajl_gen json;
+    cbor_gen_t *cbor;
+} attached[YGEN_MAX_ATTACHED];
+static int num_attached = 0;
+
+/*
+ * Attaches the given CBOR generator to the given JSON generator, so that all
+ * values generated through the y() macro (see yajl_utils.h) are generated as
+ * CBOR, too. Returns false if too many generators have one attached already.
+ *
+ */
+bool ygen_attach_cbor(yajl_gen gen, cbor_gen_t *cbor) {
+    if (num_attached == YGEN_MAX_ATTACHED)
+        return false;
+    attached[num_attached].json = gen;
+    attached[num_attached].cbor = cbor;
+    num_attached++;
+    return true;
+}
+
+/*
+ * Returns the CBOR generator attached to the given JSON generator, or NULL.
+ *
+ */
+cbor_gen_t *ygen_get_cbor(yajl_gen gen) {
+    for (int i = 0; i < num_attached; i++) {
+        if (attached[i].json == gen)
+            return attached[i].cbor;
+    }
+    return NULL;
+}
+
+/*
+ * Detaches the CBOR generator from the given JSON generator and returns it,
+ * or returns NULL if none was attached.
+ *
+ */
+cbor_gen_t *ygen_detach_cbor(yajl_gen gen) {
+    for (int i = 0; i < num_attached; i++) {
+        if (attached[i].json == gen) {
+            cbor_gen_t *cbor = attached[i].cbor;
+            attached[i] = attached[--num_attached];
+            return cbor;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Returns the CBOR generator which has to generate the value the JSON
+ * generator just generated with the given result, or NULL. Values which yajl
+ * refused are skipped, so that both documents stay the same.
+ *
+ */
+static cbor_gen_t *ygen_tee(yajl_gen gen, yajl_gen_status status) {
+    if (status != yajl_gen_status_ok || num_attached == 0)
+        return NULL;
+    return ygen_get_cbor(gen);
+}
+
+/*
+ * The functions which y() calls (see yajl_utils.h): they generate a value like
+ * their yajl_gen_*() counterparts, and as CBOR if a generator is attached.
+ *
+ */
+yajl_gen_status ygen_null(yajl_gen gen) {
+    const yajl_gen_status status = yajl_gen_null(gen);
+    cbor_gen_t *cbor = ygen_tee(gen, status);
+    if (cbor != NULL)
+        cbor_gen_null(cbor);
+    return status;
+}
+
+yajl_gen_status ygen_bool(yajl_gen gen, int val) {
+    const yajl_gen_status status = yajl_gen_bool(gen, val);
+    cbor_gen_t *cbor = ygen_tee(gen, status);
+    if (cbor != NULL)
+        cbor_gen_bool(cbor, val);
+    return status;
+}
+
+yajl_gen_status ygen_integer(yajl_gen gen, long long val) {
+    const yajl_gen_status status = yajl_gen_integer(gen, val);
+    cbor_gen_t *cbor = ygen_tee(gen, status);
+    if (cbor != NULL)
+        cbor_gen_integer(cbor, val);
+    return status;
+}
+
+yajl_gen_status ygen_double(yajl_gen gen, double val) {
+    const yajl_gen_status status = yajl_gen_double(gen, val);
+    cbor_gen_t *cbor = ygen_tee(gen, status);
+    if (cbor != NULL)
+        cbor_gen_double(cbor, val);
+    return status;
+}
+
+yajl_gen_status ygen_string(yajl_gen gen, const unsigned char *val, size_t len) {
+    const yajl_gen_status status = yajl_gen_string(gen, val, len);
+    cbor_gen_t *cbor = ygen_tee(gen, status);
+    if (cbor != NULL)
+        cbor_gen_string(cbor, val, len);
+    return status;
+}
+
+yajl_gen_status ygen_map_open(yajl_gen gen) {
+    const yajl_gen_status status = yajl_gen_map_open(gen);
+    cbor_gen_t *cbor = ygen_tee(gen, status);
+    if (cbor != NULL)
+        cbor_append_byte(cbor, CBOR_MAP_START);
+    return status;
+}
+
+yajl_gen_status ygen_map_close(yajl_gen gen) {
+    const yajl_gen_status status = yajl_gen_map_close(gen);
+    cbor_gen_t *cbor = ygen_tee(gen, status);
+    if (cbor != NULL)
+        cbor_append_byte(cbor, CBOR_BREAK);
+    return status;
+}
+
+yajl_gen_status ygen_array_open(yajl_gen gen) {
+    const yajl_gen_status status = yajl_gen_array_open(gen);
+    cbor_gen_t *cbor = ygen_tee(gen, status);
+    if (cbor != NULL)
+        cbor_append_byte(cbor, CBOR_ARRAY_START);
+    return status;
+}
+
+yajl_gen_status ygen_array_close(yajl_gen gen) {
+    const yajl_gen_status status = yajl_gen_array_close(gen);
+    cbor_gen_t *cbor = ygen_tee(gen, status);
+    if (cbor != NULL)
+        cbor_append_byte(cbor, CBOR_BREAK);
+    return status;
+}
+
+struct cbor_reader {
+    const uint8_t *data;
+    size_t len;
+    size_t pos;
+};
+
+/*
+ * Reads the head of the next data item. Returns false on truncated input or
+ * reserved additional information values. For indefinite lengths, *value is
+ * set to UINT64_MAX.
+ *
+ */
+static bool cbor_read_head(struct cbor_reader *reader, uint8_t *major, uint8_t *info, uint64_t *value) {
+    if (reader->pos >= reader->len)
+        return false;
+    const uint8_t initial = reader->data[reader->pos++];
+    *major = initial >> 5;
+    *info = initial & 0x1f;
+
+    size_t len;
+    if (*info < 24) {
+        *value = *info;
+        return true;
+    } else if (*info == 31) {
+        *value = UINT64_MAX;
+        return true;
+    } else if (*info > 27) {
+        return false;
+    }
+    len = 1 << (*info - 24);
+    if (reader->len - reader->pos < len)
+        return false;
+    *value = 0;
+    for (size_t i = 0; i < len; i++) {
+        *value = (*value << 8) | reader->data[reader->pos++];
+    }
+    return true;
+}
+
+static bool cbor_peek_break(struct cbor_reader *reader) {
+    if (reader->pos < reader->len && reader->data[reader->pos] == CBOR_BREAK) {
+        reader->pos++;
+        return true;
+    }
+    return false;
+}
+
+static bool cbor_decode_item(struct cbor_reader *reader, yajl_gen gen, int depth);
+
+/*
+ * Decodes a byte or text string, which may be split into definite length
+ * chunks when its length is indefinite.
+ *
+ */
+static bool cbor_decode_string(struct cbor_reader *reader, yajl_gen gen, uint8_t major, uint64_t len) {
+    if (len != UINT64_MAX) {
+        if (reader->len - reader->pos < len)
+            return false;
+        yajl_gen_string(gen, reader->data + reader->pos, len);
+        reader->pos += len;
+        return true;
+    }
+
+    cbor_gen_t buf = {NULL, 0, 0};
+    while (!cbor_peek_break(reader)) {
+        uint8_t chunk_major, info;
+        uint64_t chunk_len;
+        if (!cbor_read_head(reader, &chunk_major, &info, &chunk_len) ||
+            chunk_major != major || chunk_len == UINT64_MAX ||
+            reader->len - reader->pos < chunk_len) {
+            free(buf.data);
+            return false;
+        }
+        cbor_append(&buf, reader->data + reader->pos, chunk_len);
+        reader->pos += chunk_len;
+    }
+    yajl_gen_string(gen, (buf.data == NULL ? (const uint8_t *)"" : buf.data), buf.len);
+    free(buf.data);
+    return true;
+}
+
+static bool cbor_decode_container(struct cbor_reader *reader, yajl_gen gen, int depth, uint8_t major, uint64_t count) {
+    const bool map = (major == CBOR_MAP);
+    if (map)
+        yajl_gen_map_open(gen);
+    else
+        yajl_gen_array_open(gen);
+
+    for (uint64_t i = 0; count == UINT64_MAX || i < count; i++) {
+        if (count == UINT64_MAX && cbor_peek_break(reader))
+            break;
+        /* JSON only allows strings as map keys. */
+        if (map && (reader->pos >= reader->len ||
+                    (reader->data[reader->pos] >> 5) != CBOR_TEXT))
+            return false;
+        if (!cbor_decode_item(reader, gen, depth + 1))
+            return false;
+        if (map && !cbor_decode_item(reader, gen, depth + 1))
+            return false;
+    }
+
+    if (map)
+        yajl_gen_map_close(gen);
+    else
+        yajl_gen_array_close(gen);
+    return true;
+}
+
+static bool cbor_decode_item(struct cbor_reader *reader, yajl_gen gen, int depth) {
+    if (depth > CBOR_MAX_DEPTH)
+        return false;
+
+    uint8_t major, info;
+    uint64_t value;
+    if (!cbor_read_head(reader, &major, &info, &value))
+        return false;
+
+    switch (major) {
+        case CBOR_UINT:
+            if (value == UINT64_MAX || value > INT64_MAX)
+                return false;
+            yajl_gen_integer(gen, (long long)value);
+            return true;
+        case CBOR_NEGINT:
+            if (value == UINT64_MAX || value > INT64_MAX)
+                return false;
+            yajl_gen_integer(gen, -1 - (long long)value);
+            return true;
+        case CBOR_BYTES:
+        case CBOR_TEXT:
+            return cbor_decode_string(reader, gen, major, value);
+        case CBOR_ARRAY:
+        case CBOR_MAP:
+            return cbor_decode_container(reader, gen, depth, major, value);
+        case CBOR_SIMPLE:
+            if (info == 20 || info == 21) {
+                yajl_gen_bool(gen, info == 21);
+                return true;
+            } else if (info == 22 || info == 23) {
+                yajl_gen_null(gen);
+                return true;
+            } else if (info == 26 || info == 27) {
+                double val;
+                if (info == 26) {
+                    const uint32_t bits = value;
+                    float f;
+                    memcpy(&f, &bits, sizeof(f));
+                    val = f;
+                } else {
+                    memcpy(&val, &value, sizeof(val));
+                }
+                yajl_gen_double(gen, val);
+                return true;
+            }
+            return false;
+        default:
+            /* Tags (major type 6) are not used by i3. */
+            return false;
+    }
+}
+
+/*
+ * Converts the given CBOR data item to JSON. Returns a newly allocated,
+ * NUL-terminated string and stores its length in json_len, or returns NULL if
+ * the CBOR is malformed.
+ *
+ */
+char *cbor_to_json(const uint8_t *cbor, size_t cbor_len, size_t *json_len) {
+    struct cbor_reader reader = {cbor, cbor_len, 0};
+    yajl_gen gen = yajl_gen_alloc(NULL);
+    /* JSON does not allow strings with invalid UTF-8, but we do not want to
+     * fail on window titles which contain some. */
+    yajl_gen_config(gen, yajl_gen_validate_utf8, 0);
+
+    char *json = NULL;
+    if (cbor_decode_item(&reader, gen, 0) && reader.pos == reader.len) {
+        const unsigned char *buf;
+        size_t len;
+        if (yajl_gen_get_buf(gen, &buf, &len) == yajl_gen_status_ok) {
+            json = smalloc(len + 1);
+            memcpy(json, buf, len);
+            json[len] = '\0';
+            *json_len = len;
+        }
+    }
+    yajl_gen_free(gen);
+    return json;
+}
@@ -121,6 +121,41 @@ static void draw_util_set_source_color(surface_t *surface, color_t color) {
     cairo_set_source_rgba(surface->cr, color.red, color.green, color.blue, color.alpha);
 }
 
+/*
+ * Returns true if the given rectangle can be filled with the given color using
+ * the core protocol instead of cairo. This is the case for opaque colors on
+ * true color screens (where the colorpixel includes a fully opaque alpha
+ * channel) at integral coordinates.
+ *
+ */
+static bool draw_util_is_solid_fill(surface_t *surface, color_t color, double x, double y, double w, double h) {
+    if (color.alpha < 1.0)
+        return false;
+
+    if (surface->visual_type != visual_type &&
+        root_screen != NULL && root_screen->root_depth != 24 && root_screen->root_depth != 32)
+        return false;
+
+    return (x == (int16_t)x && y == (int16_t)y && w == (uint16_t)w && h == (uint16_t)h);
+}
+
+/*
+ * Fills the given rectangle with the given color using a single
+ * PolyFillRectangle request.
+ *
+ */
+static void draw_util_solid_fill(surface_t *surface, color_t color, double x, double y, double w, double h) {
+    /* Flush any pending cairo drawing before we draw behind its back. */
+    cairo_surface_flush(surface->surface);
+
+    xcb_change_gc(conn, surface->gc, XCB_GC_FOREGROUND, (uint32_t[]){color.colorpixel});
+    xcb_rectangle_t rect = {x, y, w, h};
+    xcb_poly_fill_rectangle(conn, surface->id, surface->gc, 1, &rect);
+
+    /* Notify cairo that we used another way to draw on the surface. */
+    cairo_surface_mark_dirty_rectangle(surface->surface, x, y, w, h);
+}
+
 /*
  * Draw the given text using libi3.
  * This function also marks the surface dirty which is needed if other means of
@@ -149,6 +184,11 @@ void draw_util_text(i3String *text, surface_t *surface, color_t fg_color, color_
 void draw_util_rectangle(surface_t *surface, color_t color, double x, double y, double w, double h) {
     RETURN_UNLESS_SURFACE_INITIALIZED(surface);
 
+    if (draw_util_is_solid_fill(surface, color, x, y, w, h)) {
+        draw_util_solid_fill(surface, color, x, y, w, h);
+        return;
+    }
+
     cairo_save(surface->cr);
 
     /* Using the SOURCE operator will copy both color and alpha information directly
@@ -174,6 +214,11 @@ void draw_util_rectangle(surface_t *surface, color_t color, double x, double y,
 void draw_util_clear_surface(surface_t *surface, color_t color) {
     RETURN_UNLESS_SURFACE_INITIALIZED(surface);
 
+    if (draw_util_is_solid_fill(surface, color, 0, 0, surface->width, surface->height)) {
+        draw_util_solid_fill(surface, color, 0, 0, surface->width, surface->height);
+        return;
+    }
+
     cairo_save(surface->cr);
 
     /* Using the SOURCE operator will copy both color and alpha information directly
@@ -17,6 +17,53 @@
 #include <cairo/cairo-xcb.h>
 #include <pango/pangocairo.h>
 
+#include "queue.h"
+
+/* The maximum number of shaped text layouts cached per font. */
+#define TEXT_LAYOUT_CACHE_SIZE 512
+
+/*
+ * A shaped piece of text. The layout is shaped once and then used both for
+ * measuring and for drawing the text. When the text has to be drawn into less
+ * space than its width, an ellipsized copy of the layout is kept for the most
+ * recently used maximum width.
+ *
+ */
+struct text_layout {
+    int width;
+    int height;
+    bool pango_markup;
+    PangoLayout *layout;
+
+    PangoLayout *ellipsized;
+    int ellipsized_max_width;
+    int ellipsized_height;
+
+    TAILQ_ENTRY(text_layout)
+    lru;
+
+    size_t text_len;
+    char text[];
+};
+
+/*
+ * Everything needed to shape text with a Pango font without setting up a
+ * cairo surface and Pango layout for each call, plus a LRU cache of the
+ * shaped layouts. Plain text and markup are cached separately because the
+ * same string can look differently when interpreted as markup.
+ *
+ */
+struct text_measure {
+    cairo_surface_t *surface;
+    cairo_t *cr;
+    PangoLayout *layout;
+
+    hashmap_t *layouts;
+    hashmap_t *markup_layouts;
+    TAILQ_HEAD(text_layout_head, text_layout)
+    lru_head;
+};
+
 static const i3Font *savedFont = NULL;
 
 static xcb_visualtype_t *root_visual_type;
@@ -58,27 +105,109 @@ static bool load_pango_font(i3Font *font, const char *desc) {
      * that would need root_visual_type */
     root_visual_type = get_visualtype(root_screen);
 
-    /* Create a dummy Pango layout to compute the font height */
-    cairo_surface_t *surface = cairo_xcb_surface_create(conn, root_screen->root, root_visual_type, 1, 1);
-    cairo_t *cr = cairo_create(surface);
-    PangoLayout *layout = create_layout_with_dpi(cr);
-    pango_layout_set_font_description(layout, font->specific.pango_desc);
+    /* Create the Pango layout used to measure text with this font, which we
+     * also use to compute the font height */
+    struct text_measure *measure = scalloc(1, sizeof(struct text_measure));
+    measure->surface = cairo_xcb_surface_create(conn, root_screen->root, root_visual_type, 1, 1);
+    measure->cr = cairo_create(measure->surface);
+    measure->layout = create_layout_with_dpi(measure->cr);
+    pango_layout_set_font_description(measure->layout, font->specific.pango_desc);
+    measure->layouts = hashmap_new();
+    measure->markup_layouts = hashmap_new();
+    TAILQ_INIT(&(measure->lru_head));
+    font->measure = measure;
 
     /* Get the font height */
     gint height;
-    pango_layout_get_pixel_size(layout, NULL, &height);
+    pango_layout_get_pixel_size(measure->layout, NULL, &height);
     font->height = height;
 
-    /* Free resources */
-    g_object_unref(layout);
-    cairo_destroy(cr);
-    cairo_surface_destroy(surface);
-
     /* Set the font type and return successfully */
     font->type = FONT_TYPE_PANGO;
     return true;
 }
 
+/*
+ * Frees a cached text layout.
+ *
+ */
+static void free_text_layout(struct text_layout *entry) {
+    g_object_unref(entry->layout);
+    if (entry->ellipsized != NULL)
+        g_object_unref(entry->ellipsized);
+    free(entry);
+}
+
+/*
+ * Frees the measuring context and layout cache of a Pango font.
+ *
+ */
+static void free_text_measure(struct text_measure *measure) {
+    if (measure == NULL)
+        return;
+
+    while (!TAILQ_EMPTY(&(measure->lru_head))) {
+        struct text_layout *entry = TAILQ_FIRST(&(measure->lru_head));
+        TAILQ_REMOVE(&(measure->lru_head), entry, lru);
+        free_text_layout(entry);
+    }
+    hashmap_free(measure->layouts);
+    hashmap_free(measure->markup_layouts);
+
+    g_object_unref(measure->layout);
+    cairo_destroy(measure->cr);
+    cairo_surface_destroy(measure->surface);
+    free(measure);
+}
+
+/*
+ * Returns the shaped layout of the given text with the current Pango font,
+ * shaping it only if it is not cached yet.
+ *
+ */
+static struct text_layout *get_text_layout(const char *text, size_t text_len, bool pango_markup) {
+    struct text_measure *measure = savedFont->measure;
+    hashmap_t *layouts = (pango_markup ? measure->markup_layouts : measure->layouts);
+
+    struct text_layout *entry = hashmap_get(layouts, text, text_len);
+    if (entry != NULL) {
+        /* Move the entry to the front of the LRU list. */
+        TAILQ_REMOVE(&(measure->lru_head), entry, lru);
+        TAILQ_INSERT_HEAD(&(measure->lru_head), entry, lru);
+        return entry;
+    }
+
+    PangoLayout *layout = create_layout_with_dpi(measure->cr);
+    pango_layout_set_font_description(layout, savedFont->specific.pango_desc);
+    if (pango_markup)
+        pango_layout_set_markup(layout, text, text_len);
+    else
+        pango_layout_set_text(layout, text, text_len);
+
+    /* Evict the least recently used layout if the cache is full. */
+    if (hashmap_count(measure->layouts) + hashmap_count(measure->markup_layouts) >= TEXT_LAYOUT_CACHE_SIZE) {
+        struct text_layout *last = TAILQ_LAST(&(measure->lru_head), text_layout_head);
+        TAILQ_REMOVE(&(measure->lru_head), last, lru);
+        hashmap_remove((last->pango_markup ? measure->markup_layouts : measure->layouts),
+                       last->text, last->text_len);
+        free_text_layout(last);
+    }
+
+    entry = smalloc(sizeof(struct text_layout) + text_len);
+    entry->pango_markup = pango_markup;
+    entry->layout = layout;
+    entry->ellipsized = NULL;
+    entry->ellipsized_max_width = -1;
+    entry->ellipsized_height = 0;
+    pango_layout_get_pixel_size(layout, &(entry->width), &(entry->height));
+    entry->text_len = text_len;
+    memcpy(entry->text, text, text_len);
+    TAILQ_INSERT_HEAD(&(measure->lru_head), entry, lru);
+    hashmap_set(layouts, entry->text, entry->text_len, entry);
+
+    return entry;
+}
+
 /*
  * Draws text using Pango rendering.
  *
@@ -86,36 +215,42 @@ static bool load_pango_font(i3Font *font, const char *desc) {
 static void draw_text_pango(const char *text, size_t text_len,
                             xcb_drawable_t drawable, xcb_visualtype_t *visual, int x, int y,
                             int max_width, bool pango_markup) {
-    /* Create the Pango layout */
+    struct text_layout *entry = get_text_layout(text, text_len, pango_markup);
+    PangoLayout *layout = entry->layout;
+    int height = entry->height;
+
+    /* Text which does not fit is ellipsized, using a copy of the shaped layout
+     * which is kept for the next time the text is drawn with the same width. */
+    if (entry->width > max_width) {
+        if (entry->ellipsized == NULL || entry->ellipsized_max_width != max_width) {
+            if (entry->ellipsized != NULL)
+                g_object_unref(entry->ellipsized);
+            entry->ellipsized = pango_layout_copy(entry->layout);
+            pango_layout_set_width(entry->ellipsized, max_width * PANGO_SCALE);
+            pango_layout_set_wrap(entry->ellipsized, PANGO_WRAP_CHAR);
+            pango_layout_set_ellipsize(entry->ellipsized, PANGO_ELLIPSIZE_END);
+            pango_layout_get_pixel_size(entry->ellipsized, NULL, &(entry->ellipsized_height));
+            entry->ellipsized_max_width = max_width;
+        }
+        layout = entry->ellipsized;
+        height = entry->ellipsized_height;
+    }
+
     /* root_visual_type is cached in load_pango_font */
     cairo_surface_t *surface = cairo_xcb_surface_create(conn, drawable,
                                                         visual, x + max_width, y + savedFont->height);
     cairo_t *cr = cairo_create(surface);
-    PangoLayout *layout = create_layout_with_dpi(cr);
-    gint height;
-
-    pango_layout_set_font_description(layout, savedFont->specific.pango_desc);
-    pango_layout_set_width(layout, max_width * PANGO_SCALE);
-    pango_layout_set_wrap(layout, PANGO_WRAP_CHAR);
-    pango_layout_set_ellipsize(layout, PANGO_ELLIPSIZE_END);
-
-    if (pango_markup)
-        pango_layout_set_markup(layout, text, text_len);
-    else
-        pango_layout_set_text(layout, text, text_len);
 
     /* Do the drawing */
     cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
     cairo_set_source_rgb(cr, pango_font_red, pango_font_green, pango_font_blue);
     pango_cairo_update_layout(cr, layout);
-    pango_layout_get_pixel_size(layout, NULL, &height);
     /* Center the piece of text vertically. */
     int yoffset = (height - savedFont->height) / 2;
     cairo_move_to(cr, x, y - yoffset);
     pango_cairo_show_layout(cr, layout);
 
     /* Free resources */
-    g_object_unref(layout);
     cairo_destroy(cr);
     cairo_surface_destroy(surface);
 }
@@ -125,30 +260,7 @@ static void draw_text_pango(const char *text, size_t text_len,
  *
  */
 static int predict_text_width_pango(const char *text, size_t text_len, bool pango_markup) {
-    /* Create a dummy Pango layout */
-    /* root_visual_type is cached in load_pango_font */
-    cairo_surface_t *surface = cairo_xcb_surface_create(conn, root_screen->root, root_visual_type, 1, 1);
-    cairo_t *cr = cairo_create(surface);
-    PangoLayout *layout = create_layout_with_dpi(cr);
-
-    /* Get the font width */
-    gint width;
-    pango_layout_set_font_description(layout, savedFont->specific.pango_desc);
-
-    if (pango_markup)
-        pango_layout_set_markup(layout, text, text_len);
-    else
-        pango_layout_set_text(layout, text, text_len);
-
-    pango_cairo_update_layout(cr, layout);
-    pango_layout_get_pixel_size(layout, &width, NULL);
-
-    /* Free resources */
-    g_object_unref(layout);
-    cairo_destroy(cr);
-    cairo_surface_destroy(surface);
-
-    return width;
+    return get_text_layout(text, text_len, pango_markup)->width;
 }
 
 /*
@@ -164,6 +276,7 @@ i3Font load_font(const char *pattern, const bool fallback) {
     i3Font font;
     font.type = FONT_TYPE_NONE;
     font.pattern = NULL;
+    font.measure = NULL;
 
     /* No XCB connction, return early because we're just validating the
      * configuration file. */
@@ -233,11 +346,15 @@ i3Font load_font(const char *pattern, const bool fallback) {
     if (!(font.specific.xcb.info = xcb_query_font_reply(conn, info_cookie, NULL)))
         errx(EXIT_FAILURE, "Could not load font \"%s\"", pattern);
 
-    /* Get the font table, if possible */
-    if (xcb_query_font_char_infos_length(font.specific.xcb.info) == 0)
+    /* Get the font table, if possible. Otherwise, the glyph widths are
+     * queried from the server as needed. */
+    font.specific.xcb.glyph_widths = NULL;
+    if (xcb_query_font_char_infos_length(font.specific.xcb.info) == 0) {
         font.specific.xcb.table = NULL;
-    else
+        font.specific.xcb.glyph_widths = scalloc(256, sizeof(int *));
+    } else {
         font.specific.xcb.table = xcb_query_font_char_infos(font.specific.xcb.info);
+    }
 
     /* Calculate the font height */
     font.height = font.specific.xcb.info->font_ascent + font.specific.xcb.info->font_descent;
@@ -274,11 +391,17 @@ void free_font(void) {
             /* Close the font and free the info */
             xcb_close_font(conn, savedFont->specific.xcb.id);
             free(savedFont->specific.xcb.info);
+            if (savedFont->specific.xcb.glyph_widths != NULL) {
+                for (int row = 0; row < 256; row++)
+                    free(savedFont->specific.xcb.glyph_widths[row]);
+                free(savedFont->specific.xcb.glyph_widths);
+            }
             break;
         }
         case FONT_TYPE_PANGO:
             /* Free the font description */
             pango_font_description_free(savedFont->specific.pango_desc);
+            free_text_measure(savedFont->measure);
             break;
     }
 
@@ -417,7 +540,18 @@ void draw_text_ascii(const char *text, xcb_drawable_t drawable,
     }
 }
 
-static int xcb_query_text_width(const xcb_char2b_t *text, size_t text_len) {
+/*
+ * Returns the widths of all glyphs in the given row of the current font,
+ * querying them from the server the first time the row is used. All queries
+ * for a row are sent before waiting for the replies, so this takes a single
+ * round trip.
+ *
+ */
+static int *get_glyph_widths_row(int row) {
+    int **glyph_widths = savedFont->specific.xcb.glyph_widths;
+    if (glyph_widths[row] != NULL)
+        return glyph_widths[row];
+
     /* Make the user know we’re using the slow path, but only once. */
     static bool first_invocation = true;
     if (first_invocation) {
@@ -425,24 +559,36 @@ static int xcb_query_text_width(const xcb_char2b_t *text, size_t text_len) {
         first_invocation = false;
     }
 
-    /* Query the text width */
-    xcb_generic_error_t *error;
-    xcb_query_text_extents_cookie_t cookie = xcb_query_text_extents(conn,
-                                                                    savedFont->specific.xcb.id, text_len, (xcb_char2b_t *)text);
-    xcb_query_text_extents_reply_t *reply = xcb_query_text_extents_reply(conn,
-                                                                         cookie, &error);
-    if (reply == NULL) {
-        /* We return a safe estimate because a rendering error is better than
-         * a crash. Plus, the user will see the error in their log. */
-        fprintf(stderr, "Could not get text extents (X error code %d)\n",
-                error->error_code);
-        free(error);
-        return savedFont->specific.xcb.info->max_bounds.character_width * text_len;
+    xcb_query_font_reply_t *font_info = savedFont->specific.xcb.info;
+    int min_col = font_info->min_char_or_byte2;
+    int num_cols = font_info->max_char_or_byte2 - min_col + 1;
+    int *widths = scalloc(num_cols, sizeof(int));
+    xcb_query_text_extents_cookie_t *cookies = smalloc(num_cols * sizeof(xcb_query_text_extents_cookie_t));
+
+    for (int i = 0; i < num_cols; i++) {
+        xcb_char2b_t glyph = {.byte1 = row, .byte2 = min_col + i};
+        cookies[i] = xcb_query_text_extents(conn, savedFont->specific.xcb.id, 1, &glyph);
     }
 
-    int width = reply->overall_width;
-    free(reply);
-    return width;
+    for (int i = 0; i < num_cols; i++) {
+        xcb_generic_error_t *error;
+        xcb_query_text_extents_reply_t *reply = xcb_query_text_extents_reply(conn, cookies[i], &error);
+        if (reply == NULL) {
+            /* We use a safe estimate because a rendering error is better than
+             * a crash. Plus, the user will see the error in their log. */
+            fprintf(stderr, "Could not get text extents (X error code %d)\n",
+                    error->error_code);
+            free(error);
+            widths[i] = font_info->max_bounds.character_width;
+            continue;
+        }
+        widths[i] = reply->overall_width;
+        free(reply);
+    }
+    free(cookies);
+
+    glyph_widths[row] = widths;
+    return widths;
 }
 
 static int predict_text_width_xcb(const xcb_char2b_t *input, size_t text_len) {
@@ -451,8 +597,23 @@ static int predict_text_width_xcb(const xcb_char2b_t *input, size_t text_len) {
 
     int width;
     if (savedFont->specific.xcb.table == NULL) {
-        /* If we don't have a font table, fall back to querying the server */
-        width = xcb_query_text_width(input, text_len);
+        /* If we don't have a font table, use the glyph widths we got from
+         * the server */
+        xcb_query_font_reply_t *font_info = savedFont->specific.xcb.info;
+
+        width = 0;
+        for (size_t i = 0; i < text_len; i++) {
+            int row = input[i].byte1;
+            int col = input[i].byte2;
+
+            if (row < font_info->min_byte1 ||
+                row > font_info->max_byte1 ||
+                col < font_info->min_char_or_byte2 ||
+                col > font_info->max_char_or_byte2)
+                continue;
+
+            width += get_glyph_widths_row(row)[col - font_info->min_char_or_byte2];
+        }
     } else {
         /* Save some pointers for convenience */
         xcb_query_font_reply_t *font_info = savedFont->specific.xcb.info;
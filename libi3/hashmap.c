@@ -0,0 +1,194 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * hashmap.c: A small chained hash table mapping arbitrary byte strings (window
+ *            IDs, pointers, names, …) to pointers.
+ *
+ */
+#include "libi3.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/* The initial number of buckets; must be a power of two. */
+#define HASHMAP_INITIAL_SIZE 64
+
+struct hashmap_entry {
+    struct hashmap_entry *next;
+    uint32_t hash;
+    void *value;
+    size_t keylen;
+    unsigned char key[];
+};
+
+struct hashmap {
+    struct hashmap_entry **buckets;
+    size_t num_buckets;
+    size_t count;
+};
+
+/*
+ * 32-bit FNV-1a, which is cheap and distributes window IDs and pointers well
+ * enough for our purposes.
+ *
+ */
+static uint32_t hash_bytes(const void *key, size_t keylen) {
+    const unsigned char *walk = key;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < keylen; i++) {
+        hash ^= walk[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static struct hashmap_entry **find_entry(hashmap_t *map, const void *key, size_t keylen, uint32_t hash) {
+    struct hashmap_entry **walk = &(map->buckets[hash & (map->num_buckets - 1)]);
+    while (*walk != NULL) {
+        if ((*walk)->hash == hash &&
+            (*walk)->keylen == keylen &&
+            memcmp((*walk)->key, key, keylen) == 0) {
+            return walk;
+        }
+        walk = &((*walk)->next);
+    }
+    return walk;
+}
+
+static void grow(hashmap_t *map) {
+    size_t num_buckets = map->num_buckets * 2;
+    struct hashmap_entry **buckets = scalloc(num_buckets, sizeof(struct hashmap_entry *));
+    for (size_t i = 0; i < map->num_buckets; i++) {
+        struct hashmap_entry *entry = map->buckets[i];
+        while (entry != NULL) {
+            struct hashmap_entry *next = entry->next;
+            struct hashmap_entry **bucket = &(buckets[entry->hash & (num_buckets - 1)]);
+            entry->next = *bucket;
+            *bucket = entry;
+            entry = next;
+        }
+    }
+    free(map->buckets);
+    map->buckets = buckets;
+    map->num_buckets = num_buckets;
+}
+
+/*
+ * Creates a new, empty hash map.
+ *
+ */
+hashmap_t *hashmap_new(void) {
+    hashmap_t *map = scalloc(1, sizeof(hashmap_t));
+    map->num_buckets = HASHMAP_INITIAL_SIZE;
+    map->buckets = scalloc(map->num_buckets, sizeof(struct hashmap_entry *));
+    return map;
+}
+
+/*
+ * Removes all entries from the hash map. The values are not freed.
+ *
+ */
+void hashmap_clear(hashmap_t *map) {
+    for (size_t i = 0; i < map->num_buckets; i++) {
+        struct hashmap_entry *entry = map->buckets[i];
+        while (entry != NULL) {
+            struct hashmap_entry *next = entry->next;
+            free(entry);
+            entry = next;
+        }
+        map->buckets[i] = NULL;
+    }
+    map->count = 0;
+}
+
+/*
+ * Frees the hash map and all of its entries. The values are not freed.
+ *
+ */
+void hashmap_free(hashmap_t *map) {
+    if (map == NULL) {
+        return;
+    }
+    hashmap_clear(map);
+    free(map->buckets);
+    free(map);
+}
+
+/*
+ * Returns the value stored for the given key or NULL if there is none.
+ *
+ */
+void *hashmap_get(hashmap_t *map, const void *key, size_t keylen) {
+    struct hashmap_entry *entry = *find_entry(map, key, keylen, hash_bytes(key, keylen));
+    return (entry == NULL ? NULL : entry->value);
+}
+
+/*
+ * Stores the value for the given key, replacing any previous value. The key is
+ * copied, so the caller does not need to keep it around.
+ *
+ */
+void hashmap_set(hashmap_t *map, const void *key, size_t keylen, void *value) {
+    const uint32_t hash = hash_bytes(key, keylen);
+    struct hashmap_entry **slot = find_entry(map, key, keylen, hash);
+    if (*slot != NULL) {
+        (*slot)->value = value;
+        return;
+    }
+
+    struct hashmap_entry *entry = smalloc(sizeof(struct hashmap_entry) + keylen);
+    entry->next = NULL;
+    entry->hash = hash;
+    entry->value = value;
+    entry->keylen = keylen;
+    memcpy(entry->key, key, keylen);
+    *slot = entry;
+
+    if (++(map->count) > map->num_buckets) {
+        grow(map);
+    }
+}
+
+/*
+ * Removes the entry for the given key and returns its value (or NULL if there
+ * was no such entry).
+ *
+ */
+void *hashmap_remove(hashmap_t *map, const void *key, size_t keylen) {
+    struct hashmap_entry **slot = find_entry(map, key, keylen, hash_bytes(key, keylen));
+    struct hashmap_entry *entry = *slot;
+    if (entry == NULL) {
+        return NULL;
+    }
+
+    void *value = entry->value;
+    *slot = entry->next;
+    free(entry);
+    map->count--;
+    return value;
+}
+
+/*
+ * Returns the number of entries in the hash map.
+ *
+ */
+size_t hashmap_count(hashmap_t *map) {
+    return map->count;
+}
+
+/*
+ * Calls the given callback for every entry in the hash map. The callback must
+ * not modify the hash map.
+ *
+ */
+void hashmap_foreach(hashmap_t *map, hashmap_cb_t cb, void *userdata) {
+    for (size_t i = 0; i < map->num_buckets; i++) {
+        for (struct hashmap_entry *entry = map->buckets[i]; entry != NULL; entry = entry->next) {
+            cb(entry->key, entry->keylen, entry->value, userdata);
+        }
+    }
+}
@@ -0,0 +1,192 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * ipc_reader.c: Incremental decoding of IPC messages, for event-driven clients
+ *               which read from a non-blocking socket whenever it is readable.
+ *
+ */
+#include "libi3.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <inttypes.h>
+
+#include <i3/ipc.h>
+
+#define IPC_HEADER_SIZE (sizeof(i3_ipc_header_t))
+
+struct ipc_reader {
+    /* The header of the message currently being received. */
+    uint8_t header[IPC_HEADER_SIZE];
+    size_t header_read;
+
+    /* The payload of the message currently being received, allocated as soon
+     * as the header is complete (with room for a terminating NUL byte). */
+    uint8_t *payload;
+    uint32_t payload_size;
+    uint32_t payload_read;
+    uint32_t message_type;
+
+    /* Set when the header contained an invalid magic. */
+    bool invalid;
+};
+
+/*
+ * Creates a new IPC message reader.
+ *
+ */
+ipc_reader_t *ipc_reader_new(void) {
+    return scalloc(1, sizeof(ipc_reader_t));
+}
+
+/*
+ * Frees the IPC message reader, including any partially received message.
+ *
+ */
+void ipc_reader_free(ipc_reader_t *reader) {
+    if (reader == NULL)
+        return;
+    free(reader->payload);
+    free(reader);
+}
+
+/*
+ * Parses the header once it is complete and allocates the payload buffer.
+ *
+ */
+static void header_complete(ipc_reader_t *reader) {
+    if (memcmp(reader->header, I3_IPC_MAGIC, strlen(I3_IPC_MAGIC)) != 0) {
+        ELOG("IPC: invalid magic in header, got \"%.*s\", want \"%s\"\n",
+             (int)strlen(I3_IPC_MAGIC), (char *)reader->header, I3_IPC_MAGIC);
+        reader->invalid = true;
+        return;
+    }
+
+    uint8_t *walk = reader->header + strlen(I3_IPC_MAGIC);
+    memcpy(&(reader->payload_size), walk, sizeof(uint32_t));
+    walk += sizeof(uint32_t);
+    memcpy(&(reader->message_type), walk, sizeof(uint32_t));
+
+    reader->payload = smalloc(reader->payload_size + 1);
+    reader->payload_read = 0;
+}
+
+/*
+ * Returns where the next bytes of the current message go and how many bytes
+ * are still missing, so that we never consume bytes of the next message.
+ *
+ */
+static uint8_t *next_target(ipc_reader_t *reader, size_t *missing) {
+    if (reader->header_read < IPC_HEADER_SIZE) {
+        *missing = IPC_HEADER_SIZE - reader->header_read;
+        return reader->header + reader->header_read;
+    }
+    *missing = reader->payload_size - reader->payload_read;
+    return reader->payload + reader->payload_read;
+}
+
+/*
+ * Accounts for n bytes which were stored at the current target.
+ *
+ */
+static void advance(ipc_reader_t *reader, size_t n) {
+    if (reader->header_read < IPC_HEADER_SIZE) {
+        reader->header_read += n;
+        if (reader->header_read == IPC_HEADER_SIZE)
+            header_complete(reader);
+    } else {
+        reader->payload_read += n;
+    }
+}
+
+/*
+ * Feeds the given bytes to the reader. At most the bytes up to the end of the
+ * current message are consumed; the number of consumed bytes is returned, so
+ * that the caller can fetch the message with ipc_reader_next_message() and
+ * feed the remaining bytes afterwards.
+ *
+ */
+size_t ipc_reader_feed(ipc_reader_t *reader, const uint8_t *data, size_t len) {
+    size_t consumed = 0;
+    while (consumed < len && !reader->invalid) {
+        size_t missing;
+        uint8_t *target = next_target(reader, &missing);
+        if (missing == 0)
+            break;
+        const size_t n = (len - consumed < missing ? len - consumed : missing);
+        memcpy(target, data + consumed, n);
+        advance(reader, n);
+        consumed += n;
+    }
+    return consumed;
+}
+
+/*
+ * Reads the bytes which are available on the given (non-blocking) socket file
+ * descriptor, up to the end of the current message, with a single read().
+ *
+ * Returns the number of bytes read.
+ * Returns -1 when read() fails, errno will remain (EAGAIN means that no more
+ * data is available for now).
+ * Returns -2 on EOF.
+ * Returns -3 when the IPC protocol is violated (invalid magic, EOF in the
+ * middle of a message). Additionally, the error will be printed to stderr.
+ *
+ */
+ssize_t ipc_reader_read(ipc_reader_t *reader, int sockfd) {
+    if (reader->invalid)
+        return -3;
+
+    size_t missing;
+    uint8_t *target = next_target(reader, &missing);
+    if (missing == 0)
+        return 0;
+
+    const ssize_t n = read(sockfd, target, missing);
+    if (n == -1)
+        return -1;
+    if (n == 0) {
+        if (reader->header_read == 0)
+            return -2;
+        ELOG("IPC: unexpected EOF in the middle of a message\n");
+        return -3;
+    }
+
+    advance(reader, n);
+    return (reader->invalid ? -3 : n);
+}
+
+/*
+ * Returns the next complete message, if any. The payload is NUL-terminated
+ * and has to be freed by the caller.
+ *
+ * Returns 1 and stores the message when one is complete.
+ * Returns 0 when more data is needed.
+ * Returns -3 when the IPC protocol is violated.
+ *
+ */
+int ipc_reader_next_message(ipc_reader_t *reader, uint32_t *message_type,
+                            uint32_t *reply_length, uint8_t **reply) {
+    if (reader->invalid)
+        return -3;
+    if (reader->header_read < IPC_HEADER_SIZE ||
+        reader->payload_read < reader->payload_size)
+        return 0;
+
+    reader->payload[reader->payload_size] = '\0';
+    if (message_type != NULL)
+        *message_type = reader->message_type;
+    *reply_length = reader->payload_size;
+    *reply = reader->payload;
+
+    reader->payload = NULL;
+    reader->payload_size = 0;
+    reader->payload_read = 0;
+    reader->header_read = 0;
+    return 1;
+}
@@ -14,6 +14,7 @@
 #include <unistd.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <poll.h>
 
 #include <i3/ipc.h>
 
@@ -72,8 +73,16 @@ int ipc_recv_message(int sockfd, uint32_t *message_type,
     while (read_bytes < *reply_length) {
         const int n = read(sockfd, *reply + read_bytes, *reply_length - read_bytes);
         if (n == -1) {
-            if (errno == EINTR || errno == EAGAIN)
+            if (errno == EINTR)
                 continue;
+            if (errno == EAGAIN) {
+                /* Wait for the rest of the payload instead of spinning on a
+                 * non-blocking socket. */
+                struct pollfd pfd = {.fd = sockfd, .events = POLLIN};
+                if (poll(&pfd, 1, -1) == -1 && errno != EINTR)
+                    return -1;
+                continue;
+            }
             return -1;
         }
         if (n == 0) {
@@ -40,3 +40,37 @@ int ipc_send_message(int sockfd, const uint32_t message_size,
 
     return 0;
 }
+
+/*
+ * Formats all given messages into one buffer and sends them to i3 with as
+ * few write() calls as possible, so that several requests can be pipelined
+ * and their replies read as they arrive.
+ *
+ * Returns -1 when write() fails, errno will remain.
+ * Returns 0 on success.
+ *
+ */
+int ipc_send_messages(int sockfd, const ipc_message_t *messages, size_t num_messages) {
+    size_t total = 0;
+    for (size_t i = 0; i < num_messages; i++)
+        total += sizeof(i3_ipc_header_t) + messages[i].size;
+
+    uint8_t *buffer = smalloc(total);
+    uint8_t *walk = buffer;
+    for (size_t i = 0; i < num_messages; i++) {
+        const i3_ipc_header_t header = {
+            .magic = {'i', '3', '-', 'i', 'p', 'c'},
+            .size = messages[i].size,
+            .type = messages[i].type};
+        memcpy(walk, &header, sizeof(i3_ipc_header_t));
+        walk += sizeof(i3_ipc_header_t);
+        if (messages[i].size > 0) {
+            memcpy(walk, messages[i].payload, messages[i].size);
+            walk += messages[i].size;
+        }
+    }
+
+    const ssize_t n = writeall(sockfd, buffer, total);
+    free(buffer);
+    return (n == -1 ? -1 : 0);
+}
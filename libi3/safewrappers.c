@@ -15,6 +15,43 @@
 #include <err.h>
 #include <errno.h>
 
+/* Calls and requested bytes of each safe-wrapper. Updated with relaxed atomic
+ * operations, since i3 allocates from its render threads, too. */
+static alloc_counter_t alloc_counters[ALLOC_NUM_FUNCTIONS];
+
+static const char *alloc_function_names[ALLOC_NUM_FUNCTIONS] = {
+    [ALLOC_MALLOC] = "malloc",
+    [ALLOC_CALLOC] = "calloc",
+    [ALLOC_REALLOC] = "realloc",
+    [ALLOC_STRDUP] = "strdup",
+    [ALLOC_STRNDUP] = "strndup",
+    [ALLOC_ASPRINTF] = "asprintf",
+};
+
+static void count_allocation(alloc_function_t function, size_t bytes) {
+    __atomic_fetch_add(&(alloc_counters[function].calls), 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&(alloc_counters[function].bytes), bytes, __ATOMIC_RELAXED);
+}
+
+/*
+ * Returns the allocation counter of the given safe-wrapper. The counters are
+ * updated atomically, so this can be called while other threads allocate.
+ *
+ */
+void alloc_get_counter(alloc_function_t function, alloc_counter_t *counter) {
+    counter->calls = __atomic_load_n(&(alloc_counters[function].calls), __ATOMIC_RELAXED);
+    counter->bytes = __atomic_load_n(&(alloc_counters[function].bytes), __ATOMIC_RELAXED);
+}
+
+/*
+ * Returns the name of the given safe-wrapper's underlying function, like
+ * "malloc".
+ *
+ */
+const char *alloc_function_name(alloc_function_t function) {
+    return alloc_function_names[function];
+}
+
 /*
  * The s* functions (safe) are wrappers around malloc, strdup, …, which exits if one of
  * the called functions returns NULL, meaning that there is no more memory available
@@ -24,6 +61,7 @@ void *smalloc(size_t size) {
     void *result = malloc(size);
     if (result == NULL)
         err(EXIT_FAILURE, "malloc(%zd)", size);
+    count_allocation(ALLOC_MALLOC, size);
     return result;
 }
 
@@ -31,6 +69,7 @@ void *scalloc(size_t num, size_t size) {
     void *result = calloc(num, size);
     if (result == NULL)
         err(EXIT_FAILURE, "calloc(%zd, %zd)", num, size);
+    count_allocation(ALLOC_CALLOC, num * size);
     return result;
 }
 
@@ -38,6 +77,7 @@ void *srealloc(void *ptr, size_t size) {
     void *result = realloc(ptr, size);
     if (result == NULL && size > 0)
         err(EXIT_FAILURE, "realloc(%zd)", size);
+    count_allocation(ALLOC_REALLOC, size);
     return result;
 }
 
@@ -45,6 +85,7 @@ char *sstrdup(const char *str) {
     char *result = strdup(str);
     if (result == NULL)
         err(EXIT_FAILURE, "strdup()");
+    count_allocation(ALLOC_STRDUP, strlen(result) + 1);
     return result;
 }
 
@@ -52,6 +93,7 @@ char *sstrndup(const char *str, size_t size) {
     char *result = strndup(str, size);
     if (result == NULL)
         err(EXIT_FAILURE, "strndup()");
+    count_allocation(ALLOC_STRNDUP, strlen(result) + 1);
     return result;
 }
 
@@ -63,6 +105,7 @@ int sasprintf(char **strp, const char *fmt, ...) {
     if ((result = vasprintf(strp, fmt, args)) == -1)
         err(EXIT_FAILURE, "asprintf(%s)", fmt);
     va_end(args);
+    count_allocation(ALLOC_ASPRINTF, result + 1);
     return result;
 }
 
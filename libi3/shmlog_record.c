@@ -0,0 +1,142 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * shmlog_record.c: Helpers for the binary records of the shmlog, which are
+ *                  written by i3 and decoded by i3-dump-log.
+ *
+ */
+#include "libi3.h"
+#include "shmlog.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Parses the printf conversion specification at fmt, which must point to a
+ * '%'. Returns false for specifications which the shmlog cannot store (like
+ * %n, positional arguments or wide strings).
+ *
+ */
+bool parse_printf_conversion(const char *fmt, printf_conversion_t *conv) {
+    const char *walk = fmt + 1;
+
+    conv->width_arg = false;
+    conv->precision_arg = false;
+    conv->precision = -1;
+    conv->modifier = PRINTF_LENGTH_NONE;
+
+    /* Flags */
+    while (*walk != '\0' && strchr("-+ #0'", *walk) != NULL)
+        walk++;
+
+    /* Width */
+    if (*walk == '*') {
+        conv->width_arg = true;
+        walk++;
+    } else {
+        while (*walk >= '0' && *walk <= '9')
+            walk++;
+    }
+    /* Positional arguments would be consumed out of order. */
+    if (*walk == '$')
+        return false;
+
+    /* Precision */
+    if (*walk == '.') {
+        walk++;
+        if (*walk == '*') {
+            conv->precision_arg = true;
+            walk++;
+        } else {
+            conv->precision = 0;
+            while (*walk >= '0' && *walk <= '9') {
+                conv->precision = conv->precision * 10 + (*walk - '0');
+                walk++;
+            }
+        }
+    }
+
+    /* Length modifier */
+    conv->modifier_offset = walk - fmt;
+    switch (*walk) {
+        case 'h':
+            walk++;
+            conv->modifier = PRINTF_LENGTH_H;
+            if (*walk == 'h') {
+                walk++;
+                conv->modifier = PRINTF_LENGTH_HH;
+            }
+            break;
+        case 'l':
+            walk++;
+            conv->modifier = PRINTF_LENGTH_L;
+            if (*walk == 'l') {
+                walk++;
+                conv->modifier = PRINTF_LENGTH_LL;
+            }
+            break;
+        case 'q':
+            walk++;
+            conv->modifier = PRINTF_LENGTH_LL;
+            break;
+        case 'j':
+            walk++;
+            conv->modifier = PRINTF_LENGTH_J;
+            break;
+        case 'z':
+            walk++;
+            conv->modifier = PRINTF_LENGTH_Z;
+            break;
+        case 't':
+            walk++;
+            conv->modifier = PRINTF_LENGTH_T;
+            break;
+        case 'L':
+            walk++;
+            conv->modifier = PRINTF_LENGTH_LONG_DOUBLE;
+            break;
+    }
+
+    conv->specifier = *walk;
+    if (conv->specifier == '\0' || strchr("%diouxXcspfFeEgGaA", conv->specifier) == NULL)
+        return false;
+    /* Wide characters and strings are not used within i3. */
+    if ((conv->specifier == 'c' || conv->specifier == 's') && conv->modifier != PRINTF_LENGTH_NONE)
+        return false;
+
+    conv->length = walk + 1 - fmt;
+    return true;
+}
+
+/*
+ * Stores value as varint at out, which needs room for 10 bytes. Returns the
+ * number of bytes written.
+ *
+ */
+size_t shmlog_put_varint(uint8_t *out, uint64_t value) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (value & 0x7f) | 0x80;
+        value >>= 7;
+    }
+    out[n++] = value;
+    return n;
+}
+
+/*
+ * Reads a varint from in, which is at most len bytes long. Returns the number
+ * of bytes read or 0 if the varint is truncated.
+ *
+ */
+size_t shmlog_get_varint(const uint8_t *in, size_t len, uint64_t *value) {
+    *value = 0;
+    for (size_t n = 0; n < len && n < 10; n++) {
+        *value |= (uint64_t)(in[n] & 0x7f) << (7 * n);
+        if ((in[n] & 0x80) == 0)
+            return n + 1;
+    }
+    return 0;
+}
@@ -0,0 +1,141 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * slab.c: An allocator for long-lived objects of one fixed size (like
+ *         containers), which keeps them in contiguous slabs and reuses freed
+ *         objects instead of returning them to malloc().
+ *
+ */
+#include "libi3.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/* The first slab holds this many objects, every further slab twice as many as
+ * the previous one, up to SLAB_MAX_OBJECTS. */
+#define SLAB_MIN_OBJECTS 16
+#define SLAB_MAX_OBJECTS 1024
+
+/* Objects are aligned suitably for any of these. */
+union slab_align {
+    void *ptr;
+    long long num;
+    double dbl;
+};
+
+#define SLAB_ALIGN sizeof(union slab_align)
+
+struct slab_block {
+    struct slab_block *next;
+    size_t objects;
+    union slab_align data[];
+};
+
+/* Freed objects are linked through their first bytes. */
+struct slab_free_object {
+    struct slab_free_object *next;
+};
+
+struct slab {
+    char *name;
+    size_t object_size;
+    struct slab_block *blocks;
+    /* Objects which were freed, most recently freed first. */
+    struct slab_free_object *free_list;
+    /* Objects in the newest block which were never handed out. */
+    size_t unused;
+
+    size_t in_use;
+    size_t capacity;
+    size_t num_blocks;
+    uint64_t allocations;
+};
+
+/*
+ * Creates a new, empty slab allocator for objects of the given size. The name
+ * is only used for reporting, see slab_get_stats().
+ *
+ */
+slab_t *slab_new(const char *name, size_t object_size) {
+    slab_t *slab = scalloc(1, sizeof(slab_t));
+    slab->name = sstrdup(name);
+    if (object_size < sizeof(struct slab_free_object)) {
+        object_size = sizeof(struct slab_free_object);
+    }
+    slab->object_size = (object_size + SLAB_ALIGN - 1) & ~(SLAB_ALIGN - 1);
+    return slab;
+}
+
+static void slab_grow(slab_t *slab) {
+    size_t objects = SLAB_MIN_OBJECTS;
+    if (slab->blocks != NULL) {
+        objects = slab->blocks->objects * 2;
+        if (objects > SLAB_MAX_OBJECTS) {
+            objects = SLAB_MAX_OBJECTS;
+        }
+    }
+    struct slab_block *block = smalloc(sizeof(struct slab_block) + objects * slab->object_size);
+    block->objects = objects;
+    block->next = slab->blocks;
+    slab->blocks = block;
+    slab->unused = objects;
+    slab->capacity += objects;
+    slab->num_blocks++;
+}
+
+/*
+ * Returns a zero-initialized object, which stays valid until it is passed to
+ * slab_free(). Never returns NULL.
+ *
+ */
+void *slab_alloc(slab_t *slab) {
+    void *result;
+    if (slab->free_list != NULL) {
+        result = slab->free_list;
+        slab->free_list = slab->free_list->next;
+    } else {
+        if (slab->unused == 0) {
+            slab_grow(slab);
+        }
+        struct slab_block *block = slab->blocks;
+        result = (char *)block->data + (block->objects - slab->unused) * slab->object_size;
+        slab->unused--;
+    }
+    slab->in_use++;
+    slab->allocations++;
+    memset(result, 0, slab->object_size);
+    return result;
+}
+
+/*
+ * Returns the given object (which must have been allocated from this slab
+ * allocator) for reuse. Does nothing if ptr is NULL.
+ *
+ */
+void slab_free(slab_t *slab, void *ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+    struct slab_free_object *object = ptr;
+    object->next = slab->free_list;
+    slab->free_list = object;
+    slab->in_use--;
+}
+
+/*
+ * Fills in the occupancy of the given slab allocator.
+ *
+ */
+void slab_get_stats(slab_t *slab, slab_stats_t *stats) {
+    stats->name = slab->name;
+    stats->object_size = slab->object_size;
+    stats->in_use = slab->in_use;
+    stats->capacity = slab->capacity;
+    stats->slabs = slab->num_blocks;
+    stats->bytes = slab->capacity * slab->object_size;
+    stats->allocations = slab->allocations;
+}
@@ -11,6 +11,7 @@
  */
 #include "libi3.h"
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -22,8 +23,37 @@ struct _i3String {
     size_t num_glyphs;
     size_t num_bytes;
     bool pango_markup;
+    /* Whether the text only consists of 7-bit ASCII characters, in which case
+     * each byte is one glyph and no conversion is needed for UCS-2. */
+    bool is_ascii;
 };
 
+/*
+ * Returns true if the given buffer only contains (non-NUL) 7-bit ASCII
+ * characters. Most window titles and workspace names do, so this is checked
+ * a machine word at a time.
+ *
+ */
+static bool is_ascii(const char *text, size_t num_bytes) {
+    const uint64_t ones = UINT64_C(0x0101010101010101);
+    const uint64_t highs = UINT64_C(0x8080808080808080);
+    size_t i = 0;
+
+    for (; i + sizeof(uint64_t) <= num_bytes; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, text + i, sizeof(uint64_t));
+        /* The first term finds bytes with the high bit set, the second one
+         * finds NUL bytes (which g_utf8_make_valid would replace). */
+        if ((word & highs) || ((word - ones) & ~word & highs))
+            return false;
+    }
+    for (; i < num_bytes; i++) {
+        if ((unsigned char)text[i] - 1 >= 0x7f)
+            return false;
+    }
+    return true;
+}
+
 /*
  * Build an i3String from an UTF-8 encoded string.
  * Returns the newly-allocated i3String.
@@ -55,10 +85,22 @@ i3String *i3string_from_markup(const char *from_markup) {
 i3String *i3string_from_utf8_with_length(const char *from_utf8, ssize_t num_bytes) {
     i3String *str = scalloc(1, sizeof(i3String));
 
+    /* num_bytes < 0 means NULL-terminated string, need to calculate length */
+    size_t length = num_bytes < 0 ? strlen(from_utf8) : (size_t)num_bytes;
+
+    /* ASCII text is always valid UTF-8 and does not need to be checked. */
+    if (is_ascii(from_utf8, length)) {
+        str->utf8 = smalloc(length + 1);
+        memcpy(str->utf8, from_utf8, length);
+        str->utf8[length] = '\0';
+        str->num_bytes = length;
+        str->num_glyphs = length;
+        str->is_ascii = true;
+        return str;
+    }
+
     /* g_utf8_make_valid NULL-terminates the string. */
     str->utf8 = g_utf8_make_valid(from_utf8, num_bytes);
-
-    /* num_bytes < 0 means NULL-terminated string, need to calculate length */
     str->num_bytes = num_bytes < 0 ? strlen(str->utf8) : (size_t)num_bytes;
 
     return str;
@@ -128,9 +170,22 @@ static void i3string_ensure_utf8(i3String *str) {
         str->num_bytes = strlen(str->utf8);
 }
 
+/*
+ * Converts the string to UCS-2 on first use. Only the X core font backend
+ * needs it, so Pango users never pay for the conversion.
+ *
+ */
 static void i3string_ensure_ucs2(i3String *str) {
     if (str->ucs2 != NULL)
         return;
+    if (str->is_ascii) {
+        str->ucs2 = smalloc(str->num_bytes * sizeof(xcb_char2b_t));
+        for (size_t i = 0; i < str->num_bytes; i++) {
+            str->ucs2[i].byte1 = 0;
+            str->ucs2[i].byte2 = str->utf8[i];
+        }
+        return;
+    }
     str->ucs2 = convert_utf8_to_ucs2(str->utf8, &str->num_glyphs);
 }
 
@@ -191,6 +246,8 @@ i3String *i3string_escape_markup(i3String *str) {
  *
  */
 size_t i3string_get_num_glyphs(i3String *str) {
+    if (str->is_ascii)
+        return str->num_glyphs;
     i3string_ensure_ucs2(str);
     return str->num_glyphs;
 }
@@ -79,9 +79,16 @@ state SHMLOG:
     -> call cmd_shmlog($argument)
 
 # debuglog toggle|on|off
+# debuglog <category> toggle|on|off
 state DEBUGLOG:
   argument = 'toggle', 'on', 'off'
     -> call cmd_debuglog($argument)
+  category = 'general', 'x', 'render', 'ipc', 'bindings', 'match', 'randr', 'floating'
+    -> DEBUGLOG_CATEGORY
+
+state DEBUGLOG_CATEGORY:
+  argument = 'toggle', 'on', 'off'
+    -> call cmd_debuglog_category($category, $argument)
 
 # border normal|pixel [<n>]
 # border none|1pixel|toggle
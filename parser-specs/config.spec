@@ -27,6 +27,8 @@ state INITIAL:
   'floating_minimum_size'                  -> FLOATING_MINIMUM_SIZE_WIDTH
   'floating_maximum_size'                  -> FLOATING_MAXIMUM_SIZE_WIDTH
   'floating_modifier'                      -> FLOATING_MODIFIER
+  'floating_resize_preview'                -> FLOATING_RESIZE_PREVIEW
+  'render_pacing'                          -> RENDER_PACING
   'default_orientation'                    -> DEFAULT_ORIENTATION
   'workspace_layout'                       -> WORKSPACE_LAYOUT
   windowtype = 'default_border', 'new_window', 'default_floating_border', 'new_float'
@@ -35,6 +37,7 @@ state INITIAL:
   'for_window'                             -> FOR_WINDOW
   'assign'                                 -> ASSIGN
   'no_focus'                               -> NO_FOCUS
+  'focus_follows_mouse_delay'              -> FOCUS_FOLLOWS_MOUSE_DELAY
   'focus_follows_mouse'                    -> FOCUS_FOLLOWS_MOUSE
   'mouse_warping'                          -> MOUSE_WARPING
   'focus_wrapping'                         -> FOCUS_WRAPPING
@@ -42,8 +45,11 @@ state INITIAL:
   'force_xinerama', 'force-xinerama'       -> FORCE_XINERAMA
   'disable_randr15', 'disable-randr15'     -> DISABLE_RANDR15
   'workspace_auto_back_and_forth'          -> WORKSPACE_BACK_AND_FORTH
+  'workspace_switch_grab_server'           -> WORKSPACE_SWITCH_GRAB_SERVER
   'fake_outputs', 'fake-outputs'           -> FAKE_OUTPUTS
   'force_display_urgency_hint'             -> FORCE_DISPLAY_URGENCY_HINT
+  'title_update_interval'                  -> TITLE_UPDATE_INTERVAL
+  'slow_frame_threshold'                   -> SLOW_FRAME_THRESHOLD
   'focus_on_window_activation'             -> FOCUS_ON_WINDOW_ACTIVATION
   'title_align'                            -> TITLE_ALIGN
   'show_marks'                             -> SHOW_MARKS
@@ -98,6 +104,16 @@ state FLOATING_MODIFIER:
   end
       -> call cfg_floating_modifier($modifiers)
 
+# floating_resize_preview live|outline
+state FLOATING_RESIZE_PREVIEW:
+  preview = 'live', 'outline'
+      -> call cfg_floating_resize_preview($preview)
+
+# render_pacing none|refresh
+state RENDER_PACING:
+  pacing = 'none', 'refresh'
+      -> call cfg_render_pacing($pacing)
+
 # default_orientation <horizontal|vertical|auto>
 state DEFAULT_ORIENTATION:
   orientation = 'horizontal', 'vertical', 'auto'
@@ -208,6 +224,17 @@ state FOCUS_FOLLOWS_MOUSE:
   value = word
       -> call cfg_focus_follows_mouse($value)
 
+# focus_follows_mouse_delay <delay> ms
+state FOCUS_FOLLOWS_MOUSE_DELAY:
+  delay_ms = number
+      -> FOCUS_FOLLOWS_MOUSE_DELAY_MS
+
+state FOCUS_FOLLOWS_MOUSE_DELAY_MS:
+  'ms'
+      ->
+  end
+      -> call cfg_focus_follows_mouse_delay(&delay_ms)
+
 # mouse_warping warping_t
 state MOUSE_WARPING:
   value = 'none', 'output'
@@ -238,6 +265,11 @@ state WORKSPACE_BACK_AND_FORTH:
   value = word
       -> call cfg_workspace_back_and_forth($value)
 
+# workspace_switch_grab_server
+state WORKSPACE_SWITCH_GRAB_SERVER:
+  value = word
+      -> call cfg_workspace_switch_grab_server($value)
+
 
 # fake_outputs (for testcases)
 state FAKE_OUTPUTS:
@@ -265,6 +297,28 @@ state FORCE_DISPLAY_URGENCY_HINT_MS:
   end
       -> call cfg_force_display_urgency_hint(&duration_ms)
 
+# title_update_interval <interval> ms
+state TITLE_UPDATE_INTERVAL:
+  interval_ms = number
+      -> TITLE_UPDATE_INTERVAL_MS
+
+state TITLE_UPDATE_INTERVAL_MS:
+  'ms'
+      ->
+  end
+      -> call cfg_title_update_interval(&interval_ms)
+
+# slow_frame_threshold <threshold> ms
+state SLOW_FRAME_THRESHOLD:
+  threshold_ms = number
+      -> SLOW_FRAME_THRESHOLD_MS
+
+state SLOW_FRAME_THRESHOLD_MS:
+  'ms'
+      ->
+  end
+      -> call cfg_slow_frame_threshold(&threshold_ms)
+
 # focus_on_window_activation <smart|urgent|focus|none>
 state FOCUS_ON_WINDOW_ACTIVATION:
   mode = word
@@ -452,6 +506,7 @@ state BAR:
   'set' -> BAR_IGNORE_LINE
   'i3bar_command'          -> BAR_BAR_COMMAND
   'status_command'         -> BAR_STATUS_COMMAND
+  'share_status_command'   -> BAR_SHARE_STATUS_COMMAND
   'socket_path'            -> BAR_SOCKET_PATH
   'mode'                   -> BAR_MODE
   'hidden_state'           -> BAR_HIDDEN_STATE
@@ -464,6 +519,7 @@ state BAR:
   'output'                 -> BAR_OUTPUT
   'tray_output'            -> BAR_TRAY_OUTPUT
   'tray_padding'           -> BAR_TRAY_PADDING
+  'status_redraw_interval' -> BAR_STATUS_REDRAW_INTERVAL
   'font'                   -> BAR_FONT
   'separator_symbol'       -> BAR_SEPARATOR_SYMBOL
   'binding_mode_indicator' -> BAR_BINDING_MODE_INDICATOR
@@ -488,6 +544,10 @@ state BAR_STATUS_COMMAND:
   command = string
       -> call cfg_bar_status_command($command); BAR
 
+state BAR_SHARE_STATUS_COMMAND:
+  value = word
+      -> call cfg_bar_share_status_command($value); BAR
+
 state BAR_SOCKET_PATH:
   path = string
       -> call cfg_bar_socket_path($path); BAR
@@ -556,6 +616,16 @@ state BAR_TRAY_PADDING_PX:
   end
       -> call cfg_bar_tray_padding(&padding_px); BAR
 
+state BAR_STATUS_REDRAW_INTERVAL:
+  interval_ms = number
+      -> BAR_STATUS_REDRAW_INTERVAL_MS
+
+state BAR_STATUS_REDRAW_INTERVAL_MS:
+  'ms'
+      ->
+  end
+      -> call cfg_bar_status_redraw_interval(&interval_ms); BAR
+
 state BAR_FONT:
   font = string
       -> call cfg_bar_font($font); BAR
@@ -9,6 +9,252 @@
  */
 #include "all.h"
 
+/* Window fields which rules can be indexed (or pre-filtered) by. */
+typedef enum {
+    AI_CLASS = 0,
+    AI_INSTANCE,
+    AI_ROLE,
+    AI_NUM_KEY_FIELDS,
+    /* Only used for pre-filtering, titles change too often to be a key. */
+    AI_TITLE = AI_NUM_KEY_FIELDS,
+    AI_NONE
+} index_field_t;
+
+struct indexed_assignment {
+    /* Position in the assignments list, used to restore the order when
+     * merging several candidate lists. */
+    uint32_t position;
+    Assignment *assignment;
+
+    /* A substring which the given window field must contain for the rule to
+     * possibly match. Set for rules which use a plain unanchored literal. */
+    index_field_t prefilter_field;
+    const char *prefilter;
+};
+
+struct assignment_list {
+    struct indexed_assignment *entries;
+    size_t num;
+    size_t size;
+};
+
+/* Rules whose class, instance or window_role criterion is an exact literal
+ * (^literal$) are stored in the bucket for that literal. All other rules are
+ * in the unindexed list. Every list is ordered by position. */
+static hashmap_t *buckets[AI_NUM_KEY_FIELDS];
+static struct assignment_list unindexed;
+
+/* Incremented whenever the index is freed, so that a for_window command which
+ * reloads the configuration does not leave a dangling iteration behind. */
+static uint32_t index_generation;
+
+/* At most two buckets per key field (see candidates_add_bucket()) and the
+ * unindexed list. */
+#define MAX_CANDIDATE_LISTS (2 * AI_NUM_KEY_FIELDS + 1)
+
+struct assignment_candidates {
+    struct assignment_list *lists[MAX_CANDIDATE_LISTS];
+    size_t heads[MAX_CANDIDATE_LISTS];
+    int num_lists;
+    uint32_t generation;
+};
+
+static void list_append(struct assignment_list *list, struct indexed_assignment *entry) {
+    if (list->num == list->size) {
+        list->size = (list->size == 0 ? 4 : list->size * 2);
+        list->entries = srealloc(list->entries, list->size * sizeof(struct indexed_assignment));
+    }
+    list->entries[list->num++] = *entry;
+}
+
+static void list_free(const void *key, size_t keylen, void *value, void *userdata) {
+    struct assignment_list *list = value;
+    free(list->entries);
+    free(list);
+}
+
+static struct regex *match_field(Match *match, index_field_t field) {
+    switch (field) {
+        case AI_CLASS:
+            return match->class;
+        case AI_INSTANCE:
+            return match->instance;
+        case AI_ROLE:
+            return match->window_role;
+        case AI_TITLE:
+            return match->title;
+        default:
+            return NULL;
+    }
+}
+
+static const char *window_field(i3Window *window, index_field_t field) {
+    switch (field) {
+        case AI_CLASS:
+            return window->class_class;
+        case AI_INSTANCE:
+            return window->class_instance;
+        case AI_ROLE:
+            return window->role;
+        case AI_TITLE:
+            return (window->name == NULL ? NULL : i3string_as_utf8(window->name));
+        default:
+            return NULL;
+    }
+}
+
+/*
+ * Frees the assignment index. Must be called before the assignments are
+ * freed.
+ *
+ */
+void assignment_index_free(void) {
+    for (int i = 0; i < AI_NUM_KEY_FIELDS; i++) {
+        if (buckets[i] == NULL)
+            continue;
+        hashmap_foreach(buckets[i], list_free, NULL);
+        hashmap_free(buckets[i]);
+        buckets[i] = NULL;
+    }
+    FREE(unindexed.entries);
+    unindexed.num = unindexed.size = 0;
+    index_generation++;
+}
+
+/*
+ * (Re-)builds the index used by run_assignments() and assignment_for(). Must
+ * be called whenever the list of assignments changed.
+ *
+ */
+void assignment_index_rebuild(void) {
+    assignment_index_free();
+    for (int i = 0; i < AI_NUM_KEY_FIELDS; i++)
+        buckets[i] = hashmap_new();
+
+    uint32_t position = 0;
+    size_t num_indexed = 0;
+    Assignment *current;
+    TAILQ_FOREACH(current, &assignments, assignments) {
+        struct indexed_assignment entry = {
+            .position = position++,
+            .assignment = current,
+            .prefilter_field = AI_NONE,
+            .prefilter = NULL,
+        };
+
+        bool indexed = false;
+        for (index_field_t field = AI_CLASS; field < AI_NUM_KEY_FIELDS && !indexed; field++) {
+            struct regex *re = match_field(&(current->match), field);
+            if (re == NULL)
+                continue;
+            const char *literal;
+            size_t len;
+            if (!regex_exact_literal(re, &literal, &len))
+                continue;
+
+            struct assignment_list *list = hashmap_get(buckets[field], literal, len);
+            if (list == NULL) {
+                list = scalloc(1, sizeof(struct assignment_list));
+                hashmap_set(buckets[field], literal, len, list);
+            }
+            list_append(list, &entry);
+            indexed = true;
+        }
+        if (indexed) {
+            num_indexed++;
+            continue;
+        }
+
+        /* The rule has to be checked for every window, but plain substring
+         * criteria (class="Firefox") can still reject most windows with a
+         * strstr() instead of a regular expression. */
+        for (index_field_t field = AI_CLASS; field <= AI_TITLE; field++) {
+            struct regex *re = match_field(&(current->match), field);
+            if (re != NULL && strcmp(re->pattern, "__focused__") != 0 &&
+                regex_is_literal(re->pattern, strlen(re->pattern))) {
+                entry.prefilter_field = field;
+                entry.prefilter = re->pattern;
+                break;
+            }
+        }
+        list_append(&unindexed, &entry);
+    }
+
+    DLOG("Indexed %zu of %u assignments\n", num_indexed, position);
+}
+
+/*
+ * Adds the bucket for the given window field (if any) to the candidates.
+ *
+ */
+static void candidates_add_bucket(struct assignment_candidates *candidates, i3Window *window, index_field_t field) {
+    const char *value = window_field(window, field);
+    if (value == NULL)
+        return;
+
+    const size_t len = strlen(value);
+    struct assignment_list *list = hashmap_get(buckets[field], value, len);
+    if (list != NULL)
+        candidates->lists[candidates->num_lists++] = list;
+
+    /* $ also matches right before a newline at the end of the subject. */
+    if (len > 0 && value[len - 1] == '\n') {
+        list = hashmap_get(buckets[field], value, len - 1);
+        if (list != NULL)
+            candidates->lists[candidates->num_lists++] = list;
+    }
+}
+
+/*
+ * Collects the lists of assignments which can possibly match the given
+ * window.
+ *
+ */
+static void candidates_init(struct assignment_candidates *candidates, i3Window *window) {
+    if (buckets[AI_CLASS] == NULL)
+        assignment_index_rebuild();
+
+    candidates->num_lists = 0;
+    for (index_field_t field = AI_CLASS; field < AI_NUM_KEY_FIELDS; field++)
+        candidates_add_bucket(candidates, window, field);
+    candidates->lists[candidates->num_lists++] = &unindexed;
+    memset(candidates->heads, 0, sizeof(candidates->heads));
+    candidates->generation = index_generation;
+}
+
+/*
+ * Returns the next assignment (in config order) which might match the given
+ * window, or NULL when there are no more. match_matches_window() still needs
+ * to be called on the result.
+ *
+ */
+static Assignment *candidates_next(struct assignment_candidates *candidates, i3Window *window) {
+    if (candidates->generation != index_generation)
+        return NULL;
+
+    while (true) {
+        int best = -1;
+        for (int i = 0; i < candidates->num_lists; i++) {
+            if (candidates->heads[i] == candidates->lists[i]->num)
+                continue;
+            if (best == -1 ||
+                candidates->lists[i]->entries[candidates->heads[i]].position <
+                    candidates->lists[best]->entries[candidates->heads[best]].position)
+                best = i;
+        }
+        if (best == -1)
+            return NULL;
+
+        struct indexed_assignment *entry = &(candidates->lists[best]->entries[candidates->heads[best]++]);
+        if (entry->prefilter != NULL) {
+            const char *value = window_field(window, entry->prefilter_field);
+            if (value == NULL || strstr(value, entry->prefilter) == NULL)
+                continue;
+        }
+        return entry->assignment;
+    }
+}
+
 /*
  * Checks the list of assignments for the given window and runs all matching
  * ones (unless they have already been run for this specific window).
@@ -20,8 +266,10 @@ void run_assignments(i3Window *window) {
     bool needs_tree_render = false;
 
     /* Check if any assignments match */
+    struct assignment_candidates candidates;
+    candidates_init(&candidates, window);
     Assignment *current;
-    TAILQ_FOREACH(current, &assignments, assignments) {
+    while ((current = candidates_next(&candidates, window)) != NULL) {
         if (current->type != A_COMMAND || !match_matches_window(&(current->match), window))
             continue;
 
@@ -46,10 +294,16 @@ void run_assignments(i3Window *window) {
         window->ran_assignments[window->nr_assignments - 1] = current;
 
         DLOG("matching assignment, execute command %s\n", current->dest.command);
-        char *full_command;
-        sasprintf(&full_command, "[id=\"%d\"] %s", window->id, current->dest.command);
-        CommandResult *result = parse_command(full_command, NULL, NULL);
-        free(full_command);
+        CommandResult *result;
+        if (current->command_ir != NULL) {
+            result = command_ir_run(current->command_ir, NULL, window->id);
+        } else {
+            /* Commands with parse errors are parsed again to report them. */
+            char *full_command;
+            sasprintf(&full_command, "[id=\"%d\"] %s", window->id, current->dest.command);
+            result = parse_command(full_command, NULL, NULL);
+            free(full_command);
+        }
 
         if (result->needs_tree_render)
             needs_tree_render = true;
@@ -59,7 +313,7 @@ void run_assignments(i3Window *window) {
 
     /* If any of the commands required re-rendering, we will do that now. */
     if (needs_tree_render)
-        tree_render();
+        tree_schedule_render();
 }
 
 /*
@@ -67,9 +321,10 @@ void run_assignments(i3Window *window) {
  *
  */
 Assignment *assignment_for(i3Window *window, int type) {
+    struct assignment_candidates candidates;
+    candidates_init(&candidates, window);
     Assignment *assignment;
-
-    TAILQ_FOREACH(assignment, &assignments, assignments) {
+    while ((assignment = candidates_next(&candidates, window)) != NULL) {
         if ((type != A_ANY && (assignment->type & type) == 0) ||
             !match_matches_window(&(assignment->match), window))
             continue;
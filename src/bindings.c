@@ -6,6 +6,7 @@
  *
  * bindings.c: Functions for configuring, finding and, running bindings.
  */
+#define LOG_CATEGORY LOG_CATEGORY_BINDINGS
 #include "all.h"
 
 #include <xkbcommon/xkbcommon.h>
@@ -14,6 +15,16 @@
 static struct xkb_context *xkb_context;
 static struct xkb_keymap *xkb_keymap;
 
+/* The text serialization of xkb_keymap, so that load_keymap() can tell whether
+ * the keymap actually changed. Keyboards being plugged in (or docking
+ * stations) cause a series of notifies, usually with the same keymap. */
+static char *xkb_keymap_string;
+
+/* Keymaps compiled from the _XKB_RULES_NAMES of the root window (servers
+ * without XKB), keyed by the NUL-separated RMLVO components. */
+static hashmap_t *rmlvo_keymaps;
+#define MAX_RMLVO_KEYMAPS 8
+
 pid_t command_error_nagbar_pid = -1;
 
 /*
@@ -82,6 +93,7 @@ Binding *configure_binding(const char *bindtype, const char *modifiers, const ch
         new_binding->input_type = B_KEYBOARD;
     }
     new_binding->command = sstrdup(command);
+    new_binding->command_ir = command_ir_compile(command);
     new_binding->event_state_mask = event_state_from_str(modifiers);
     int group_bits_set = 0;
     if ((new_binding->event_state_mask >> 16) & I3_XKB_GROUP_MASK_1)
@@ -103,11 +115,11 @@ Binding *configure_binding(const char *bindtype, const char *modifiers, const ch
     return new_binding;
 }
 
-static bool binding_in_current_group(const Binding *bind) {
+static bool binding_in_group(const Binding *bind, uint32_t group) {
     /* If no bits are set, the binding should be installed in every group. */
     if ((bind->event_state_mask >> 16) == I3_XKB_GROUP_MASK_ANY)
         return true;
-    switch (xkb_current_group) {
+    switch (group) {
         case XCB_XKB_GROUP_1:
             return ((bind->event_state_mask >> 16) & I3_XKB_GROUP_MASK_1);
         case XCB_XKB_GROUP_2:
@@ -117,45 +129,78 @@ static bool binding_in_current_group(const Binding *bind) {
         case XCB_XKB_GROUP_4:
             return ((bind->event_state_mask >> 16) & I3_XKB_GROUP_MASK_4);
         default:
-            ELOG("BUG: xkb_current_group (= %d) outside of [XCB_XKB_GROUP_1..XCB_XKB_GROUP_4]\n", xkb_current_group);
+            ELOG("BUG: group (= %d) outside of [XCB_XKB_GROUP_1..XCB_XKB_GROUP_4]\n", group);
             return false;
     }
 }
 
-static void grab_keycode_for_binding(xcb_connection_t *conn, Binding *bind, uint32_t keycode) {
-    /* Grab the key in all combinations */
-#define GRAB_KEY(modifier)                                                                       \
-    do {                                                                                         \
-        xcb_grab_key(conn, 0, root, modifier, keycode, XCB_GRAB_MODE_SYNC, XCB_GRAB_MODE_ASYNC); \
-    } while (0)
-    const int mods = (bind->event_state_mask & 0xFFFF);
-    DLOG("Binding %p Grabbing keycode %d with event state mask 0x%x (mods 0x%x)\n",
-         bind, keycode, bind->event_state_mask, mods);
-    GRAB_KEY(mods);
-    /* Also bind the key with active NumLock */
-    GRAB_KEY(mods | xcb_numlock_mask);
-    /* Also bind the key with active CapsLock */
-    GRAB_KEY(mods | XCB_MOD_MASK_LOCK);
-    /* Also bind the key with active NumLock+CapsLock */
-    GRAB_KEY(mods | xcb_numlock_mask | XCB_MOD_MASK_LOCK);
+/* A passive key grab on the root window. */
+struct key_grab {
+    uint32_t keycode;
+    uint32_t modifiers;
+};
+
+/* A sorted set of key grabs without duplicates. */
+struct grab_set {
+    struct key_grab *grabs;
+    size_t num;
+    size_t size;
+    bool valid;
+};
+
+/* The grabs needed for the bindings of the current mode in each XKB group,
+ * computed on demand and invalidated by binding_index_rebuild(). */
+static struct grab_set group_grabs[XCB_XKB_GROUP_4 + 1];
+
+/* The grabs which are currently active on the X server. */
+static struct grab_set active_grabs;
+
+static void grab_set_add(struct grab_set *set, uint32_t keycode, uint32_t modifiers) {
+    if (set->num == set->size) {
+        set->size = (set->size == 0 ? 64 : set->size * 2);
+        set->grabs = srealloc(set->grabs, set->size * sizeof(struct key_grab));
+    }
+    set->grabs[set->num].keycode = keycode;
+    set->grabs[set->num].modifiers = modifiers;
+    set->num++;
+}
+
+static int key_grab_cmp(const void *a, const void *b) {
+    const struct key_grab *first = a;
+    const struct key_grab *second = b;
+    if (first->keycode != second->keycode)
+        return (first->keycode < second->keycode ? -1 : 1);
+    if (first->modifiers != second->modifiers)
+        return (first->modifiers < second->modifiers ? -1 : 1);
+    return 0;
 }
 
 /*
- * Grab the bound keys (tell X to send us keypress events for those keycodes)
+ * Computes which keys need to be grabbed for the bindings of the current mode
+ * while the given XKB group is active.
  *
  */
-void grab_all_keys(xcb_connection_t *conn) {
+static void grab_set_compute(struct grab_set *set, uint32_t group) {
+    set->num = 0;
+
     Binding *bind;
     TAILQ_FOREACH(bind, bindings, bindings) {
         if (bind->input_type != B_KEYBOARD)
             continue;
 
-        if (!binding_in_current_group(bind))
+        if (!binding_in_group(bind, group))
             continue;
 
-        /* The easy case: the user specified a keycode directly. */
+        /* The easy case: the user specified a keycode directly. Grab the key
+         * in all combinations of NumLock and CapsLock. */
         if (bind->keycode > 0) {
-            grab_keycode_for_binding(conn, bind, bind->keycode);
+            const int mods = (bind->event_state_mask & 0xFFFF);
+            DLOG("Binding %p Grabbing keycode %d with event state mask 0x%x (mods 0x%x)\n",
+                 bind, bind->keycode, bind->event_state_mask, mods);
+            grab_set_add(set, bind->keycode, mods);
+            grab_set_add(set, bind->keycode, mods | xcb_numlock_mask);
+            grab_set_add(set, bind->keycode, mods | XCB_MOD_MASK_LOCK);
+            grab_set_add(set, bind->keycode, mods | xcb_numlock_mask | XCB_MOD_MASK_LOCK);
             continue;
         }
 
@@ -164,18 +209,159 @@ void grab_all_keys(xcb_connection_t *conn) {
             const int keycode = binding_keycode->keycode;
             const int mods = (binding_keycode->modifiers & 0xFFFF);
             DLOG("Binding %p Grabbing keycode %d with mods %d\n", bind, keycode, mods);
-            xcb_grab_key(conn, 0, root, mods, keycode, XCB_GRAB_MODE_SYNC, XCB_GRAB_MODE_ASYNC);
+            grab_set_add(set, keycode, mods);
         }
     }
+
+    if (set->num > 0) {
+        qsort(set->grabs, set->num, sizeof(struct key_grab), key_grab_cmp);
+        size_t unique = 1;
+        for (size_t i = 1; i < set->num; i++) {
+            if (key_grab_cmp(&(set->grabs[i]), &(set->grabs[unique - 1])) != 0)
+                set->grabs[unique++] = set->grabs[i];
+        }
+        set->num = unique;
+    }
+    set->valid = true;
+}
+
+static void grab_sets_invalidate(void) {
+    for (size_t i = 0; i < sizeof(group_grabs) / sizeof(group_grabs[0]); i++)
+        group_grabs[i].valid = false;
+}
+
+/*
+ * Forgets which keys are grabbed. Called after all keys were ungrabbed.
+ *
+ */
+void key_grabs_reset(void) {
+    active_grabs.num = 0;
 }
 
 /*
- * Release the button grabs on all managed windows and regrab them,
- * reevaluating which buttons need to be grabbed.
+ * Grab the bound keys (tell X to send us keypress events for those keycodes)
+ *
+ * Only the difference to the currently active grabs is sent to the X server,
+ * so this is cheap when switching between modes or XKB groups which share most
+ * of their bindings.
+ *
+ */
+void grab_all_keys(xcb_connection_t *conn) {
+    if (xkb_current_group > XCB_XKB_GROUP_4) {
+        ELOG("BUG: xkb_current_group (= %d) outside of [XCB_XKB_GROUP_1..XCB_XKB_GROUP_4]\n", xkb_current_group);
+        return;
+    }
+    struct grab_set *target = &(group_grabs[xkb_current_group]);
+    if (!target->valid)
+        grab_set_compute(target, xkb_current_group);
+
+    const stats_x_subsystem_t x_subsystem = stats_x_enter(STATS_X_SUBSYSTEM_BINDINGS);
+    size_t i = 0, j = 0;
+    int ungrabbed = 0, grabbed = 0;
+    while (i < active_grabs.num || j < target->num) {
+        int cmp;
+        if (i == active_grabs.num)
+            cmp = 1;
+        else if (j == target->num)
+            cmp = -1;
+        else
+            cmp = key_grab_cmp(&(active_grabs.grabs[i]), &(target->grabs[j]));
+
+        if (cmp < 0) {
+            const struct key_grab *grab = &(active_grabs.grabs[i++]);
+            xcb_ungrab_key(conn, grab->keycode, root, grab->modifiers);
+            ungrabbed++;
+        } else if (cmp > 0) {
+            const struct key_grab *grab = &(target->grabs[j++]);
+            xcb_grab_key(conn, 0, root, grab->modifiers, grab->keycode, XCB_GRAB_MODE_SYNC, XCB_GRAB_MODE_ASYNC);
+            grabbed++;
+        } else {
+            i++;
+            j++;
+        }
+    }
+    DLOG("Updated key grabs: %d ungrabbed, %d grabbed, %zu active\n", ungrabbed, grabbed, target->num);
+    stats_x_leave(x_subsystem);
+
+    active_grabs.num = 0;
+    for (size_t k = 0; k < target->num; k++)
+        grab_set_add(&active_grabs, target->grabs[k].keycode, target->grabs[k].modifiers);
+}
+
+/* The buttons which are currently grabbed on all managed windows (terminated
+ * by a 0), or NULL before the first window was managed. */
+static int *grabbed_buttons = NULL;
+
+static bool buttons_contain(const int *buttons, int button) {
+    for (; *buttons != 0; buttons++) {
+        if (*buttons == button)
+            return true;
+    }
+    return false;
+}
+
+static bool buttons_equal(const int *a, const int *b) {
+    for (; *a != 0 && *a == *b; a++, b++) {
+        /* nothing */
+    }
+    return *a == *b;
+}
+
+/*
+ * Returns the buttons of first which are not in second, terminated by a 0.
+ *
+ */
+static int *buttons_difference(const int *first, const int *second) {
+    size_t num = 0;
+    while (first[num] != 0)
+        num++;
+
+    int *result = scalloc(num + 1, sizeof(int));
+    size_t j = 0;
+    for (size_t i = 0; i < num; i++) {
+        if (!buttons_contain(second, first[i]))
+            result[j++] = first[i];
+    }
+    return result;
+}
+
+/*
+ * Grabs the buttons which are currently grabbed on all managed windows on the
+ * given (newly managed) window.
+ *
+ */
+void grab_buttons_on_window(xcb_connection_t *conn, xcb_window_t window) {
+    if (grabbed_buttons == NULL)
+        grabbed_buttons = bindings_get_buttons_to_grab();
+    xcb_grab_buttons(conn, window, grabbed_buttons);
+}
+
+/*
+ * Reevaluates which buttons need to be grabbed and updates the button grabs on
+ * all managed windows.
+ *
+ * Only the difference to the currently grabbed buttons is sent to the X
+ * server, and the windows are not touched at all if the buttons did not
+ * change, so this is cheap on reloads and mode changes.
  *
  */
 void regrab_all_buttons(xcb_connection_t *conn) {
     int *buttons = bindings_get_buttons_to_grab();
+    if (grabbed_buttons == NULL) {
+        grabbed_buttons = buttons;
+        return;
+    }
+
+    if (buttons_equal(buttons, grabbed_buttons)) {
+        DLOG("Mouse bindings did not change, not regrabbing buttons\n");
+        free(buttons);
+        return;
+    }
+
+    int *removed = buttons_difference(grabbed_buttons, buttons);
+    int *added = buttons_difference(buttons, grabbed_buttons);
+
+    const stats_x_subsystem_t x_subsystem = stats_x_enter(STATS_X_SUBSYSTEM_BINDINGS);
     xcb_grab_server(conn);
 
     Con *con;
@@ -183,27 +369,158 @@ void regrab_all_buttons(xcb_connection_t *conn) {
         if (con->window == NULL)
             continue;
 
-        xcb_ungrab_button(conn, XCB_BUTTON_INDEX_ANY, con->window->id, XCB_BUTTON_MASK_ANY);
-        xcb_grab_buttons(conn, con->window->id, buttons);
+        for (int *button = removed; *button != 0; button++)
+            xcb_ungrab_button(conn, *button, con->window->id, XCB_BUTTON_MASK_ANY);
+        xcb_grab_buttons(conn, con->window->id, added);
     }
 
-    FREE(buttons);
     xcb_ungrab_server(conn);
+    stats_x_leave(x_subsystem);
+
+    free(removed);
+    free(added);
+    free(grabbed_buttons);
+    grabbed_buttons = buttons;
+}
+
+/* Key of the binding index: a binding is stored under every (keycode,
+ * modifiers) combination of its keycodes_head. */
+struct binding_index_key {
+    uint32_t input_type;
+    uint32_t keycode;
+    uint32_t modifiers;
+};
+
+struct indexed_binding {
+    /* Position in the bindings list, which decides which binding wins. */
+    uint32_t position;
+    Binding *bind;
+};
+
+struct binding_list {
+    struct indexed_binding *entries;
+    size_t num;
+    size_t size;
+};
+
+/* Index of the bindings of the current mode, see binding_index_rebuild(). */
+static hashmap_t *binding_index;
+
+/* All bindings of the current mode which trigger upon release. Only these can
+ * be in the B_UPON_KEYRELEASE_IGNORE_MODS state, which matches regardless of
+ * the modifiers. */
+static struct binding_list release_bindings;
+
+static void binding_list_append(struct binding_list *list, uint32_t position, Binding *bind) {
+    /* A binding can have the same keycode and modifiers more than once. */
+    if (list->num > 0 && list->entries[list->num - 1].bind == bind)
+        return;
+    if (list->num == list->size) {
+        list->size = (list->size == 0 ? 4 : list->size * 2);
+        list->entries = srealloc(list->entries, list->size * sizeof(struct indexed_binding));
+    }
+    list->entries[list->num].position = position;
+    list->entries[list->num].bind = bind;
+    list->num++;
+}
+
+static void binding_list_free(const void *key, size_t keylen, void *value, void *userdata) {
+    struct binding_list *list = value;
+    free(list->entries);
+    free(list);
+}
+
+/*
+ * Frees the binding index. Must be called before the bindings it refers to
+ * are freed.
+ *
+ */
+void binding_index_free(void) {
+    if (binding_index != NULL) {
+        hashmap_foreach(binding_index, binding_list_free, NULL);
+        hashmap_free(binding_index);
+        binding_index = NULL;
+    }
+    FREE(release_bindings.entries);
+    release_bindings.num = release_bindings.size = 0;
+}
+
+/*
+ * Builds the index used by get_binding() for the bindings of the current mode.
+ * Needs to be called whenever the bindings, their order or their translated
+ * keycodes change.
+ *
+ */
+static void binding_index_rebuild(void) {
+    binding_index_free();
+    binding_index = hashmap_new();
+    grab_sets_invalidate();
+
+    uint32_t position = 0;
+    Binding *bind;
+    TAILQ_FOREACH(bind, bindings, bindings) {
+        if (bind->release != B_UPON_KEYPRESS)
+            binding_list_append(&release_bindings, position, bind);
+
+        /* For bindings with a keycode (and mouse bindings), translate_keysyms()
+         * puts the keycode into keycodes_head as well, together with the
+         * modifier fallbacks. */
+        struct Binding_Keycode *binding_keycode;
+        TAILQ_FOREACH(binding_keycode, &(bind->keycodes_head), keycodes) {
+            const struct binding_index_key key = {
+                .input_type = bind->input_type,
+                .keycode = binding_keycode->keycode,
+                .modifiers = (binding_keycode->modifiers & 0x0000FFFF),
+            };
+            struct binding_list *list = hashmap_get(binding_index, &key, sizeof(key));
+            if (list == NULL) {
+                list = scalloc(1, sizeof(struct binding_list));
+                hashmap_set(binding_index, &key, sizeof(key), list);
+            }
+            binding_list_append(list, position, bind);
+        }
+        position++;
+    }
+    DLOG("Indexed %u bindings under %zu keys\n", position, hashmap_count(binding_index));
+}
+
+/*
+ * Returns true if the given release binding can match the given keycode while
+ * ignoring the modifiers (see B_UPON_KEYRELEASE_IGNORE_MODS).
+ *
+ */
+static bool release_binding_matches(Binding *bind, input_type_t input_type, uint16_t input_code) {
+    if (bind->input_type != input_type || bind->release != B_UPON_KEYRELEASE_IGNORE_MODS)
+        return false;
+    struct Binding_Keycode *binding_keycode;
+    TAILQ_FOREACH(binding_keycode, &(bind->keycodes_head), keycodes) {
+        if (binding_keycode->keycode == input_code)
+            return true;
+    }
+    return false;
 }
 
 /*
  * Returns a pointer to the Binding with the specified modifiers and
  * keycode or NULL if no such binding exists.
  *
+ * Instead of checking every binding of the current mode, the candidates are
+ * looked up in the binding index (and, for release events, the release
+ * bindings) and visited in their original order.
+ *
  */
 static Binding *get_binding(i3_event_state_mask_t state_filtered, bool is_release, uint16_t input_code, input_type_t input_type) {
     Binding *bind;
     Binding *result = NULL;
 
+    if (binding_index == NULL)
+        binding_index_rebuild();
+
     if (!is_release) {
         /* On a press event, we first reset all B_UPON_KEYRELEASE_IGNORE_MODS
          * bindings back to B_UPON_KEYRELEASE */
-        TAILQ_FOREACH(bind, bindings, bindings) {
+        for (size_t i = 0; i < release_bindings.num; i++) {
+            bind = release_bindings.entries[i].bind;
             if (bind->input_type != input_type)
                 continue;
             if (bind->release == B_UPON_KEYRELEASE_IGNORE_MODS)
@@ -213,9 +530,29 @@ static Binding *get_binding(i3_event_state_mask_t state_filtered, bool is_releas
 
     const uint32_t xkb_group_state = (state_filtered & 0xFFFF0000);
     const uint32_t modifiers_state = (state_filtered & 0x0000FFFF);
-    TAILQ_FOREACH(bind, bindings, bindings) {
-        if (bind->input_type != input_type) {
-            continue;
+    const struct binding_index_key key = {
+        .input_type = input_type,
+        .keycode = input_code,
+        .modifiers = modifiers_state,
+    };
+    const struct binding_list *exact = hashmap_get(binding_index, &key, sizeof(key));
+    const size_t num_exact = (exact == NULL ? 0 : exact->num);
+    /* Bindings in the B_UPON_KEYRELEASE_IGNORE_MODS state match a release
+     * event no matter which modifiers are active. */
+    const size_t num_release = (is_release ? release_bindings.num : 0);
+
+    size_t i = 0, j = 0;
+    while (i < num_exact || j < num_release) {
+        /* Merge both lists by position, visiting each binding only once. */
+        if (j < num_release &&
+            (i == num_exact || release_bindings.entries[j].position < exact->entries[i].position)) {
+            bind = release_bindings.entries[j++].bind;
+            if (!release_binding_matches(bind, input_type, input_code))
+                continue;
+        } else {
+            if (j < num_release && release_bindings.entries[j].position == exact->entries[i].position)
+                j++;
+            bind = exact->entries[i++].bind;
         }
 
         const uint32_t xkb_group_mask = (bind->event_state_mask & 0xFFFF0000);
@@ -225,46 +562,6 @@ static Binding *get_binding(i3_event_state_mask_t state_filtered, bool is_releas
             continue;
         }
 
-        /* For keyboard bindings where a symbol was specified by the user, we
-         * need to look in the array of translated keycodes for the event’s
-         * keycode */
-        bool found_keycode = false;
-        if (input_type == B_KEYBOARD && bind->symbol != NULL) {
-            xcb_keycode_t input_keycode = (xcb_keycode_t)input_code;
-            struct Binding_Keycode *binding_keycode;
-            TAILQ_FOREACH(binding_keycode, &(bind->keycodes_head), keycodes) {
-                const uint32_t modifiers_mask = (binding_keycode->modifiers & 0x0000FFFF);
-                const bool mods_match = (modifiers_mask == modifiers_state);
-                DLOG("binding_keycode->modifiers = %d, modifiers_mask = %d, modifiers_state = %d, mods_match = %s\n",
-                     binding_keycode->modifiers, modifiers_mask, modifiers_state, (mods_match ? "yes" : "no"));
-                if (binding_keycode->keycode == input_keycode &&
-                    (mods_match || (bind->release == B_UPON_KEYRELEASE_IGNORE_MODS && is_release))) {
-                    found_keycode = true;
-                    break;
-                }
-            }
-        } else {
-            /* This case is easier: The user specified a keycode */
-            if (bind->keycode != input_code) {
-                continue;
-            }
-
-            struct Binding_Keycode *binding_keycode;
-            TAILQ_FOREACH(binding_keycode, &(bind->keycodes_head), keycodes) {
-                const uint32_t modifiers_mask = (binding_keycode->modifiers & 0x0000FFFF);
-                const bool mods_match = (modifiers_mask == modifiers_state);
-                DLOG("binding_keycode->modifiers = %d, modifiers_mask = %d, modifiers_state = %d, mods_match = %s\n",
-                     binding_keycode->modifiers, modifiers_mask, modifiers_state, (mods_match ? "yes" : "no"));
-                if (mods_match || (bind->release == B_UPON_KEYRELEASE_IGNORE_MODS && is_release)) {
-                    found_keycode = true;
-                    break;
-                }
-            }
-        }
-        if (!found_keycode) {
-            continue;
-        }
-
         /* If this binding is a release binding, it matches the key which the
          * user pressed. We therefore mark it as B_UPON_KEYRELEASE_IGNORE_MODS
          * for later, so that the user can release the modifiers before the
@@ -343,12 +640,6 @@ Binding *get_binding_from_xcb_event(xcb_generic_event_t *event) {
 }
 
 struct resolve {
-    /* The binding which we are resolving. */
-    Binding *bind;
-
-    /* |bind|’s keysym (translated to xkb_keysym_t), e.g. XKB_KEY_R. */
-    xkb_keysym_t keysym;
-
     /* The xkb state built from the user-provided modifiers and group. */
     struct xkb_state *xkb_state;
 
@@ -360,6 +651,31 @@ struct resolve {
 
     /* Like |xkb_state|, but with NumLock, just without the shift modifier, if shift was specified. */
     struct xkb_state *xkb_state_numlock_no_shift;
+
+    /* The keysym → keycodes multimap which is being built. */
+    hashmap_t *keycodes;
+};
+
+/* A keycode which results in a keysym, see add_keycode_to_map(). */
+struct keysym_keycode {
+    xkb_keycode_t keycode;
+
+    /* The keysym of this keycode when NumLock is active (in addition to the
+     * same modifiers which resulted in the keysym). */
+    xkb_keysym_t sym_numlock;
+};
+
+struct keysym_keycodes {
+    struct keysym_keycode *entries;
+    size_t num;
+    size_t size;
+};
+
+/* Bindings with the same modifiers and group share one keysym → keycodes
+ * multimap, see translate_keysyms(). */
+struct keysym_map_key {
+    uint32_t mods;
+    uint32_t group;
 };
 
 #define ADD_TRANSLATED_KEY(code, mods)                                                     \
@@ -370,61 +686,72 @@ struct resolve {
         TAILQ_INSERT_TAIL(&(bind->keycodes_head), binding_keycode, keycodes);              \
     } while (0)
 
+static void keysym_map_add(hashmap_t *map, xkb_keysym_t sym, xkb_keycode_t key, xkb_keysym_t sym_numlock) {
+    struct keysym_keycodes *list = hashmap_get(map, &sym, sizeof(xkb_keysym_t));
+    if (list == NULL) {
+        list = scalloc(1, sizeof(struct keysym_keycodes));
+        hashmap_set(map, &sym, sizeof(xkb_keysym_t), list);
+    }
+    if (list->num == list->size) {
+        list->size = (list->size == 0 ? 2 : list->size * 2);
+        list->entries = srealloc(list->entries, list->size * sizeof(struct keysym_keycode));
+    }
+    list->entries[list->num].keycode = key;
+    list->entries[list->num].sym_numlock = sym_numlock;
+    list->num++;
+}
+
+static void keysym_keycodes_free(const void *key, size_t keylen, void *value, void *userdata) {
+    struct keysym_keycodes *list = value;
+    free(list->entries);
+    free(list);
+}
+
+static void keysym_map_free(const void *key, size_t keylen, void *value, void *userdata) {
+    hashmap_t *map = value;
+    hashmap_foreach(map, keysym_keycodes_free, NULL);
+    hashmap_free(map);
+}
+
 /*
- * add_keycode_if_matches is called for each keycode in the keymap and will add
- * the keycode to |data->bind| if the keycode can result in the keysym
- * |data->resolving|.
+ * add_keycode_to_map is called for each keycode in the keymap and will add
+ * the keycode to |data->keycodes| for every keysym it can result in: the
+ * keysym in |data->xkb_state| and, if applicable, the keysym without shift.
  *
  */
-static void add_keycode_if_matches(struct xkb_keymap *keymap, xkb_keycode_t key, void *data) {
+static void add_keycode_to_map(struct xkb_keymap *keymap, xkb_keycode_t key, void *data) {
     const struct resolve *resolving = data;
-    struct xkb_state *numlock_state = resolving->xkb_state_numlock;
-    xkb_keysym_t sym = xkb_state_key_get_one_sym(resolving->xkb_state, key);
-    if (sym != resolving->keysym) {
-        /* Check if Shift was specified, and try resolving the symbol without
-         * shift, so that “bindsym $mod+Shift+a nop” actually works. */
-        const xkb_layout_index_t layout = xkb_state_key_get_layout(resolving->xkb_state, key);
-        if (layout == XKB_LAYOUT_INVALID)
-            return;
-        if (xkb_state_key_get_level(resolving->xkb_state, key, layout) > 1)
-            return;
-        /* Skip the Shift fallback for keypad keys, otherwise one cannot bind
-         * KP_1 independent of KP_End. */
-        if (sym >= XKB_KEY_KP_Space && sym <= XKB_KEY_KP_Equal)
-            return;
-        numlock_state = resolving->xkb_state_numlock_no_shift;
-        sym = xkb_state_key_get_one_sym(resolving->xkb_state_no_shift, key);
-        if (sym != resolving->keysym)
-            return;
-    }
-    Binding *bind = resolving->bind;
-
-    ADD_TRANSLATED_KEY(key, bind->event_state_mask);
-
-    /* Also bind the key with active CapsLock */
-    ADD_TRANSLATED_KEY(key, bind->event_state_mask | XCB_MOD_MASK_LOCK);
-
-    /* If this binding is not explicitly for NumLock, check whether we need to
-     * add a fallback. */
-    if ((bind->event_state_mask & xcb_numlock_mask) != xcb_numlock_mask) {
-        /* Check whether the keycode results in the same keysym when NumLock is
-         * active. If so, grab the key with NumLock as well, so that users don’t
-         * need to duplicate every key binding with an additional Mod2 specified.
-         */
-        xkb_keysym_t sym_numlock = xkb_state_key_get_one_sym(numlock_state, key);
-        if (sym_numlock == resolving->keysym) {
-            /* Also bind the key with active NumLock */
-            ADD_TRANSLATED_KEY(key, bind->event_state_mask | xcb_numlock_mask);
-
-            /* Also bind the key with active NumLock+CapsLock */
-            ADD_TRANSLATED_KEY(key, bind->event_state_mask | xcb_numlock_mask | XCB_MOD_MASK_LOCK);
-        } else {
-            DLOG("Skipping automatic numlock fallback, key %d resolves to 0x%x with numlock\n",
-                 key, sym_numlock);
-        }
-    }
+    const xkb_keysym_t sym = xkb_state_key_get_one_sym(resolving->xkb_state, key);
+    if (sym != XKB_KEY_NoSymbol)
+        keysym_map_add(resolving->keycodes, sym, key,
+                       xkb_state_key_get_one_sym(resolving->xkb_state_numlock, key));
+
+    /* Check if Shift was specified, and try resolving the symbol without
+     * shift, so that “bindsym $mod+Shift+a nop” actually works. */
+    const xkb_layout_index_t layout = xkb_state_key_get_layout(resolving->xkb_state, key);
+    if (layout == XKB_LAYOUT_INVALID)
+        return;
+    if (xkb_state_key_get_level(resolving->xkb_state, key, layout) > 1)
+        return;
+    /* Skip the Shift fallback for keypad keys, otherwise one cannot bind
+     * KP_1 independent of KP_End. */
+    if (sym >= XKB_KEY_KP_Space && sym <= XKB_KEY_KP_Equal)
+        return;
+    const xkb_keysym_t sym_no_shift = xkb_state_key_get_one_sym(resolving->xkb_state_no_shift, key);
+    /* The fallback is only used for keysyms which the key does not result in
+     * directly. */
+    if (sym_no_shift == sym || sym_no_shift == XKB_KEY_NoSymbol)
+        return;
+    keysym_map_add(resolving->keycodes, sym_no_shift, key,
+                   xkb_state_key_get_one_sym(resolving->xkb_state_numlock_no_shift, key));
 }
 
+struct keycode_binding_key {
+    uint32_t keycode;
+    uint32_t event_state_mask;
+    uint32_t release;
+};
+
 /*
  * Translates keysymbols to keycodes for all bindings which use keysyms.
  *
@@ -444,7 +771,26 @@ void translate_keysyms(void) {
         goto out;
     }
 
+    /* The keysym → keycodes multimaps, keyed by struct keysym_map_key. */
+    hashmap_t *keysym_maps = hashmap_new();
+
+    /* The number of bindings with a keycode per (keycode, event state mask,
+     * release), to find duplicates of translated keysym bindings. */
+    hashmap_t *keycode_bindings = hashmap_new();
+
     Binding *bind;
+    TAILQ_FOREACH(bind, bindings, bindings) {
+        if (bind->symbol != NULL)
+            continue;
+        const struct keycode_binding_key key = {
+            .keycode = bind->keycode,
+            .event_state_mask = bind->event_state_mask,
+            .release = bind->release,
+        };
+        const uintptr_t count = (uintptr_t)hashmap_get(keycode_bindings, &key, sizeof(key));
+        hashmap_set(keycode_bindings, &key, sizeof(key), (void *)(count + 1));
+    }
+
     TAILQ_FOREACH(bind, bindings, bindings) {
         if (bind->input_type == B_MOUSE) {
             long button;
@@ -554,20 +900,59 @@ void translate_keysyms(void) {
             continue;
         }
 
-        struct resolve resolving = {
-            .bind = bind,
-            .keysym = keysym,
-            .xkb_state = dummy_state,
-            .xkb_state_no_shift = dummy_state_no_shift,
-            .xkb_state_numlock = dummy_state_numlock,
-            .xkb_state_numlock_no_shift = dummy_state_numlock_no_shift,
+        /* Walk the keymap only once for all bindings which share the same
+         * modifiers and group (i.e. the same dummy states). */
+        const struct keysym_map_key map_key = {
+            .mods = (bind->event_state_mask & 0x1FFF),
+            .group = group,
         };
+        hashmap_t *keymap_index = hashmap_get(keysym_maps, &map_key, sizeof(map_key));
+        if (keymap_index == NULL) {
+            struct resolve resolving = {
+                .xkb_state = dummy_state,
+                .xkb_state_no_shift = dummy_state_no_shift,
+                .xkb_state_numlock = dummy_state_numlock,
+                .xkb_state_numlock_no_shift = dummy_state_numlock_no_shift,
+                .keycodes = hashmap_new(),
+            };
+            xkb_keymap_key_for_each(xkb_keymap, add_keycode_to_map, &resolving);
+            keymap_index = resolving.keycodes;
+            hashmap_set(keysym_maps, &map_key, sizeof(map_key), keymap_index);
+        }
+
         while (!TAILQ_EMPTY(&(bind->keycodes_head))) {
             struct Binding_Keycode *first = TAILQ_FIRST(&(bind->keycodes_head));
             TAILQ_REMOVE(&(bind->keycodes_head), first, keycodes);
             FREE(first);
         }
-        xkb_keymap_key_for_each(xkb_keymap, add_keycode_if_matches, &resolving);
+        const struct keysym_keycodes *matches = hashmap_get(keymap_index, &keysym, sizeof(xkb_keysym_t));
+        for (size_t i = 0; matches != NULL && i < matches->num; i++) {
+            const xkb_keycode_t key = matches->entries[i].keycode;
+            ADD_TRANSLATED_KEY(key, bind->event_state_mask);
+
+            /* Also bind the key with active CapsLock */
+            ADD_TRANSLATED_KEY(key, bind->event_state_mask | XCB_MOD_MASK_LOCK);
+
+            /* If this binding is not explicitly for NumLock, check whether we need to
+             * add a fallback. */
+            if ((bind->event_state_mask & xcb_numlock_mask) != xcb_numlock_mask) {
+                /* Check whether the keycode results in the same keysym when NumLock is
+                 * active. If so, grab the key with NumLock as well, so that users don’t
+                 * need to duplicate every key binding with an additional Mod2 specified.
+                 */
+                const xkb_keysym_t sym_numlock = matches->entries[i].sym_numlock;
+                if (sym_numlock == keysym) {
+                    /* Also bind the key with active NumLock */
+                    ADD_TRANSLATED_KEY(key, bind->event_state_mask | xcb_numlock_mask);
+
+                    /* Also bind the key with active NumLock+CapsLock */
+                    ADD_TRANSLATED_KEY(key, bind->event_state_mask | xcb_numlock_mask | XCB_MOD_MASK_LOCK);
+                } else {
+                    DLOG("Skipping automatic numlock fallback, key %d resolves to 0x%x with numlock\n",
+                         key, sym_numlock);
+                }
+            }
+        }
         char *keycodes = sstrdup("");
         int num_keycodes = 0;
         struct Binding_Keycode *binding_keycode;
@@ -579,18 +964,15 @@ void translate_keysyms(void) {
             num_keycodes++;
 
             /* check for duplicate bindings */
-            Binding *check;
-            TAILQ_FOREACH(check, bindings, bindings) {
-                if (check == bind)
-                    continue;
-                if (check->symbol != NULL)
-                    continue;
-                if (check->keycode != binding_keycode->keycode ||
-                    check->event_state_mask != binding_keycode->modifiers ||
-                    check->release != bind->release)
-                    continue;
+            const struct keycode_binding_key check_key = {
+                .keycode = binding_keycode->keycode,
+                .event_state_mask = binding_keycode->modifiers,
+                .release = bind->release,
+            };
+            const uintptr_t duplicates = (uintptr_t)hashmap_get(keycode_bindings, &check_key, sizeof(check_key));
+            for (uintptr_t i = 0; i < duplicates; i++) {
                 has_errors = true;
-                ELOG("Duplicate keybinding in config file:\n  keysym = %s, keycode = %d, state_mask = 0x%x\n", bind->symbol, check->keycode, bind->event_state_mask);
+                ELOG("Duplicate keybinding in config file:\n  keysym = %s, keycode = %d, state_mask = 0x%x\n", bind->symbol, binding_keycode->keycode, bind->event_state_mask);
             }
         }
         DLOG("state=0x%x, cfg=\"%s\", sym=0x%x → keycodes%s (%d)\n",
@@ -598,7 +980,13 @@ void translate_keysyms(void) {
         free(keycodes);
     }
 
+    hashmap_foreach(keysym_maps, keysym_map_free, NULL);
+    hashmap_free(keysym_maps);
+    hashmap_free(keycode_bindings);
+
 out:
+    binding_index_rebuild();
+
     xkb_state_unref(dummy_state);
     xkb_state_unref(dummy_state_no_shift);
     xkb_state_unref(dummy_state_numlock);
@@ -624,10 +1012,10 @@ void switch_mode(const char *new_mode) {
         if (strcmp(mode->name, new_mode) != 0)
             continue;
 
-        ungrab_all_keys(conn);
         bindings = mode->bindings;
         translate_keysyms();
         grab_all_keys(conn);
+        regrab_all_buttons(conn);
 
         /* Reset all B_UPON_KEYRELEASE_IGNORE_MODS bindings to avoid possibly
          * activating one of them. */
@@ -637,12 +1025,16 @@ void switch_mode(const char *new_mode) {
                 bind->release = B_UPON_KEYRELEASE;
         }
 
-        char *event_msg;
-        sasprintf(&event_msg, "{\"change\":\"%s\", \"pango_markup\":%s}",
-                  mode->name, (mode->pango_markup ? "true" : "false"));
+        struct ipc_event_info info;
+        ipc_event_info_init(&info, mode->name, NULL);
+        if (ipc_event_has_recipients(I3_IPC_EVENT_MODE, &info)) {
+            char *event_msg;
+            sasprintf(&event_msg, "{\"change\":\"%s\", \"pango_markup\":%s}",
+                      mode->name, (mode->pango_markup ? "true" : "false"));
 
-        ipc_send_event("mode", I3_IPC_EVENT_MODE, event_msg);
-        FREE(event_msg);
+            ipc_send_event(I3_IPC_EVENT_MODE, event_msg, &info);
+            FREE(event_msg);
+        }
 
         return;
     }
@@ -712,6 +1104,7 @@ void reorder_bindings(void) {
         if (current_mode)
             bindings = mode->bindings;
     }
+    binding_index_rebuild();
 }
 
 /*
@@ -775,6 +1168,7 @@ static Binding *binding_copy(Binding *bind) {
         ret->symbol = sstrdup(bind->symbol);
     if (bind->command != NULL)
         ret->command = sstrdup(bind->command);
+    ret->command_ir = command_ir_ref(bind->command_ir);
     TAILQ_INIT(&(ret->keycodes_head));
     struct Binding_Keycode *binding_keycode;
     TAILQ_FOREACH(binding_keycode, &(bind->keycodes_head), keycodes) {
@@ -802,33 +1196,40 @@ void binding_free(Binding *bind) {
 
     FREE(bind->symbol);
     FREE(bind->command);
+    command_ir_unref(bind->command_ir);
     FREE(bind);
 }
 
 /*
- * Runs the given binding and handles parse errors. If con is passed, it will
- * execute the command binding with that container selected by criteria.
- * Returns a CommandResult for running the binding's command. Free with
- * command_result_free().
+ * Runs the binding's command and sends the binding event, unless trace is
+ * given (see run_binding_traced()).
  *
  */
-CommandResult *run_binding(Binding *bind, Con *con) {
-    char *command;
+static CommandResult *run_binding_internal(Binding *bind, Con *con, int repeat, struct binding_trace *trace) {
+    I3_PROBE2(run_binding__entry, bind->command, repeat);
+    if (trace != NULL)
+        trace->command_start_ns = stats_now_ns();
 
     /* We need to copy the binding and command since “reload” may be part of
      * the command, and then the memory that bind points to may not contain the
      * same data anymore. */
-    if (con == NULL)
-        command = sstrdup(bind->command);
-    else
-        sasprintf(&command, "[con_id=\"%p\"] %s", con, bind->command);
-
     Binding *bind_cp = binding_copy(bind);
-    CommandResult *result = parse_command(command, NULL, NULL);
-    free(command);
+    CommandResult *result;
+    if (bind_cp->command_ir != NULL) {
+        result = command_ir_run_repeated(bind_cp->command_ir, con, XCB_NONE, repeat);
+    } else {
+        /* Commands with parse errors are parsed again to report them. */
+        char *command;
+        if (con == NULL)
+            command = sstrdup(bind->command);
+        else
+            sasprintf(&command, "[con_id=\"%p\"] %s", con, bind->command);
+        result = parse_command(command, NULL, NULL);
+        free(command);
+    }
 
     if (result->needs_tree_render)
-        tree_render();
+        tree_schedule_render();
 
     if (result->parse_error) {
         char *pageraction;
@@ -849,12 +1250,59 @@ CommandResult *run_binding(Binding *bind, Con *con) {
         free(pageraction);
     }
 
-    ipc_send_binding_event("run", bind_cp);
-    binding_free(bind_cp);
+    if (trace != NULL) {
+        trace->command_done_ns = stats_now_ns();
+        trace->binding = bind_cp;
+    } else {
+        ipc_send_binding_event("run", bind_cp);
+        binding_free(bind_cp);
+    }
 
+    I3_PROBE1(run_binding__return, result->parse_error);
     return result;
 }
 
+/*
+ * Runs the given binding and handles parse errors. If con is passed, it will
+ * execute the command binding with that container selected by criteria.
+ * Returns a CommandResult for running the binding's command. Free with
+ * command_result_free().
+ *
+ */
+CommandResult *run_binding(Binding *bind, Con *con) {
+    return run_binding_repeated(bind, con, 1);
+}
+
+/*
+ * Like run_binding(), but runs the binding's command as if the binding was
+ * triggered repeat times in a row (see command_ir_run_repeated()). The binding
+ * must be repeatable (see binding_is_repeatable()) unless repeat is 1.
+ *
+ */
+CommandResult *run_binding_repeated(Binding *bind, Con *con, int repeat) {
+    return run_binding_internal(bind, con, repeat, NULL);
+}
+
+/*
+ * Like run_binding_repeated() (without a container), but instead of sending
+ * the binding event right away, the command's timestamps and a copy of the
+ * binding are stored in trace. The caller sends the event once the result was
+ * flushed to X11 and frees trace->binding.
+ *
+ */
+CommandResult *run_binding_traced(Binding *bind, int repeat, struct binding_trace *trace) {
+    return run_binding_internal(bind, NULL, repeat, trace);
+}
+
+/*
+ * Returns true if triggering the given binding several times in a row can be
+ * coalesced into one run_binding_repeated() call.
+ *
+ */
+bool binding_is_repeatable(Binding *bind) {
+    return command_ir_is_repeatable(bind->command_ir);
+}
+
 static int fill_rmlvo_from_root(struct xkb_rule_names *xkb_names) {
     xcb_intern_atom_reply_t *atom_reply;
     size_t content_max_words = 256;
@@ -924,11 +1372,58 @@ static int fill_rmlvo_from_root(struct xkb_rule_names *xkb_names) {
     return 0;
 }
 
+static void rmlvo_keymap_free(const void *key, size_t keylen, void *value, void *userdata) {
+    xkb_keymap_unref(value);
+}
+
+/*
+ * Returns the keymap for the given RMLVO, compiling it only if it is not in
+ * rmlvo_keymaps yet. The caller owns a reference to the keymap.
+ *
+ */
+static struct xkb_keymap *keymap_from_rmlvo(struct xkb_rule_names *names) {
+    char *key;
+    const int keylen = sasprintf(&key, "%s%c%s%c%s%c%s%c%s",
+                                 names->rules ? names->rules : "", '\0',
+                                 names->model ? names->model : "", '\0',
+                                 names->layout ? names->layout : "", '\0',
+                                 names->variant ? names->variant : "", '\0',
+                                 names->options ? names->options : "");
+    if (rmlvo_keymaps == NULL) {
+        rmlvo_keymaps = hashmap_new();
+    }
+
+    struct xkb_keymap *keymap = hashmap_get(rmlvo_keymaps, key, keylen);
+    if (keymap != NULL) {
+        DLOG("Using the cached keymap for this RMLVO\n");
+        free(key);
+        return xkb_keymap_ref(keymap);
+    }
+
+    if ((keymap = xkb_keymap_new_from_names(xkb_context, names, 0)) != NULL) {
+        if (hashmap_count(rmlvo_keymaps) >= MAX_RMLVO_KEYMAPS) {
+            hashmap_foreach(rmlvo_keymaps, rmlvo_keymap_free, NULL);
+            hashmap_clear(rmlvo_keymaps);
+        }
+        hashmap_set(rmlvo_keymaps, key, keylen, xkb_keymap_ref(keymap));
+    }
+    free(key);
+    return keymap;
+}
+
 /*
  * Loads the XKB keymap from the X11 server and feeds it to xkbcommon.
  *
+ * If changed is not NULL, it is set to whether the keymap differs from the
+ * previously loaded one. If it does not, the previous keymap is kept, so that
+ * callers can skip translate_keysyms() and re-grabbing the keys.
+ *
  */
-bool load_keymap(void) {
+bool load_keymap(bool *changed) {
+    if (changed != NULL) {
+        *changed = false;
+    }
+
     if (xkb_context == NULL) {
         if ((xkb_context = xkb_context_new(0)) == NULL) {
             ELOG("Could not create xkbcommon context\n");
@@ -957,7 +1452,7 @@ bool load_keymap(void) {
             ELOG("Could not get _XKB_RULES_NAMES atom from root window, falling back to defaults.\n");
             /* Using NULL for the fields of xkb_rule_names. */
         }
-        new_keymap = xkb_keymap_new_from_names(xkb_context, &names, 0);
+        new_keymap = keymap_from_rmlvo(&names);
         free((char *)names.rules);
         free((char *)names.model);
         free((char *)names.layout);
@@ -968,8 +1463,29 @@ bool load_keymap(void) {
             return false;
         }
     }
+
+    if (new_keymap == xkb_keymap) {
+        DLOG("Keymap unchanged (cached RMLVO keymap)\n");
+        xkb_keymap_unref(new_keymap);
+        return true;
+    }
+
+    char *new_string = xkb_keymap_get_as_string(new_keymap, XKB_KEYMAP_FORMAT_TEXT_V1);
+    if (new_string != NULL && xkb_keymap_string != NULL &&
+        strcmp(new_string, xkb_keymap_string) == 0) {
+        DLOG("Keymap unchanged\n");
+        free(new_string);
+        xkb_keymap_unref(new_keymap);
+        return true;
+    }
+
     xkb_keymap_unref(xkb_keymap);
     xkb_keymap = new_keymap;
+    free(xkb_keymap_string);
+    xkb_keymap_string = new_string;
+    if (changed != NULL) {
+        *changed = true;
+    }
 
     return true;
 }
@@ -1010,10 +1526,13 @@ int *bindings_get_buttons_to_grab(void) {
         }
 
         /* Avoid duplicates. */
+        bool duplicate = false;
         for (int i = 0; i < num; i++) {
             if (buffer[i] == button)
-                continue;
+                duplicate = true;
         }
+        if (duplicate)
+            continue;
 
         buffer[num++] = button;
     }
@@ -64,10 +64,8 @@ static bool tiling_resize_for_border(Con *con, border_t border, xcb_button_press
 
     const orientation_t orientation = ((border == BORDER_LEFT || border == BORDER_RIGHT) ? HORIZ : VERT);
 
+    /* Renders the tree once the resize is done. */
     resize_graphical_handler(first, second, orientation, event);
-
-    DLOG("After resize handler, rendering\n");
-    tree_render();
     return true;
 }
 
@@ -338,6 +336,7 @@ int handle_button_press(xcb_button_press_event_t *event) {
          event->root_y);
 
     last_timestamp = event->time;
+    x_set_pointer_position(event->root_x, event->root_y, event->time);
 
     const uint32_t mod = (config.floating_modifier & 0xFFFF);
     const bool mod_pressed = (mod != 0 && (event->state & mod) == mod);
@@ -383,13 +382,9 @@ int handle_button_press(xcb_button_press_event_t *event) {
     }
 
     /* Check if the click was on the decoration of a child */
-    Con *child;
-    TAILQ_FOREACH(child, &(con->nodes_head), nodes) {
-        if (!rect_contains(child->deco_rect, event->event_x, event->event_y))
-            continue;
-
+    Con *child = con_child_at_deco_position(con, event->event_x, event->event_y);
+    if (child != NULL)
         return route_click(child, event, mod_pressed, CLICK_DECORATION);
-    }
 
     if (event->child != XCB_NONE) {
         DLOG("event->child not XCB_NONE, so this is an event which originated from a click into the application, but the application did not handle it.\n");
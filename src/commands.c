@@ -18,8 +18,8 @@
 #include "shmlog.h"
 
 // Macros to make the YAJL API a bit easier to use.
-#define y(x, ...) (cmd_output->json_gen != NULL ? yajl_gen_##x(cmd_output->json_gen, ##__VA_ARGS__) : 0)
-#define ystr(str) (cmd_output->json_gen != NULL ? yajl_gen_string(cmd_output->json_gen, (unsigned char *)str, strlen(str)) : 0)
+#define y(x, ...) (cmd_output->json_gen != NULL ? ygen_##x(cmd_output->json_gen, ##__VA_ARGS__) : 0)
+#define ystr(str) (cmd_output->json_gen != NULL ? ygen_string(cmd_output->json_gen, (unsigned char *)str, strlen(str)) : 0)
 #define ysuccess(success)                   \
     do {                                    \
         if (cmd_output->json_gen != NULL) { \
@@ -167,6 +167,55 @@ void cmd_criteria_init(I3_CMD) {
     }
 }
 
+/* At most two containers can match an anchored literal mark (see
+ * criteria_candidates()). */
+#define MAX_CRITERIA_CANDIDATES 2
+
+/*
+ * Uses the container, window and mark indexes to find the only containers
+ * which can possibly match the given criteria. Returns the number of
+ * candidates stored in candidates, or -1 if the criteria cannot be answered
+ * from an index and all containers need to be checked.
+ *
+ */
+static int criteria_candidates(Match *match, Con *candidates[MAX_CRITERIA_CANDIDATES]) {
+    if (match->con_id != NULL) {
+        candidates[0] = match->con_id;
+        return 1;
+    }
+
+    int num = 0;
+    const char *literal;
+    size_t len;
+    if (match->mark != NULL && regex_exact_literal(match->mark, &literal, &len)) {
+        char *mark = smalloc(len + 2);
+        memcpy(mark, literal, len);
+        mark[len] = '\0';
+        Con *con = con_by_mark(mark);
+        if (con != NULL)
+            candidates[num++] = con;
+        /* $ also matches right before a trailing newline. */
+        mark[len] = '\n';
+        mark[len + 1] = '\0';
+        con = con_by_mark(mark);
+        if (con != NULL)
+            candidates[num++] = con;
+        free(mark);
+        return num;
+    }
+
+    /* Containers without a window can still be matched by their mark, so the
+     * window index only suffices if there is no mark criterion. */
+    if (match->id != XCB_NONE && match->mark == NULL) {
+        Con *con = con_by_window_id(match->id);
+        if (con != NULL)
+            candidates[num++] = con;
+        return num;
+    }
+
+    return -1;
+}
+
 /*
  * A match specification just finished (the closing square bracket was found),
  * so we filter the list of owindows.
@@ -176,6 +225,11 @@ void cmd_criteria_match_windows(I3_CMD) {
     owindow *next, *current;
 
     DLOG("match specification finished, matching...\n");
+    Con *candidates[MAX_CRITERIA_CANDIDATES];
+    const int num_candidates = criteria_candidates(current_match, candidates);
+    if (num_candidates != -1)
+        DLOG("criteria can only match %d container(s)\n", num_candidates);
+
     /* copy the old list head to iterate through it and start with a fresh
      * list which will contain only matching windows */
     struct owindows_head old = owindows;
@@ -187,6 +241,16 @@ void cmd_criteria_match_windows(I3_CMD) {
         current = next;
         next = TAILQ_NEXT(next, owindows);
 
+        if (num_candidates != -1) {
+            bool candidate = false;
+            for (int i = 0; i < num_candidates && !candidate; i++)
+                candidate = (candidates[i] == current->con);
+            if (!candidate) {
+                FREE(current);
+                continue;
+            }
+        }
+
         DLOG("checking if con %p / %s matches\n", current->con, current->con->name);
 
         /* We use this flag to prevent matching on window-less containers if
@@ -260,11 +324,13 @@ void cmd_criteria_add(I3_CMD, const char *ctype, const char *cvalue) {
 }
 
 static void move_matches_to_workspace(Con *ws) {
+    con_move_begin();
     owindow *current;
     TAILQ_FOREACH(current, &owindows, owindows) {
         DLOG("matching: %p / %s\n", current->con, current->con->name);
         con_move_to_workspace(current->con, ws, true, false, false);
     }
+    con_move_end();
 }
 
 #define CHECK_MOVE_CON_TO_WORKSPACE                                                          \
@@ -584,6 +650,10 @@ void cmd_resize(I3_CMD, const char *way, const char *direction, long resize_px,
         resize_ppt *= -1;
     }
 
+    /* Coalesced key repeats resize by the sum of their amounts at once. */
+    resize_px *= cmd_output->repeat;
+    resize_ppt *= cmd_output->repeat;
+
     HANDLE_EMPTY_MATCH;
 
     owindow *current;
@@ -789,44 +859,31 @@ void cmd_append_layout(I3_CMD, const char *cpath) {
         goto out;
     }
 
-    if (!json_validate(buf, len)) {
-        ELOG("Could not parse \"%s\" as JSON, not loading.\n", path);
-        yerror("Could not parse \"%s\" as JSON.", path);
-        goto out;
-    }
-
-    json_content_t content = json_determine_content(buf, len);
-    LOG("JSON content = %d\n", content);
-    if (content == JSON_CONTENT_UNKNOWN) {
-        ELOG("Could not determine the contents of \"%s\", not loading.\n", path);
-        yerror("Could not determine the contents of \"%s\".", path);
-        goto out;
-    }
-
+    /* We need to append the layout to a split container, since a leaf
+     * container must not have any children (by definition).
+     * Note that we explicitly check for workspaces, since they are okay for
+     * this purpose, but con_accepts_window() returns false for workspaces.
+     * Workspaces in the layout are appended to the output instead. */
     Con *parent = focused;
-    if (content == JSON_CONTENT_WORKSPACE) {
-        parent = output_get_content(con_get_output(parent));
-    } else {
-        /* We need to append the layout to a split container, since a leaf
-         * container must not have any children (by definition).
-         * Note that we explicitly check for workspaces, since they are okay for
-         * this purpose, but con_accepts_window() returns false for workspaces. */
-        while (parent->type != CT_WORKSPACE && !con_accepts_window(parent))
-            parent = parent->parent;
-    }
+    while (parent->type != CT_WORKSPACE && !con_accepts_window(parent))
+        parent = parent->parent;
     DLOG("Appending to parent=%p instead of focused=%p\n", parent, focused);
+
+    /* The layout is validated while it is appended: if it is invalid, nothing
+     * is appended. */
     char *errormsg = NULL;
-    tree_append_json(parent, buf, len, &errormsg);
+    json_content_t content = tree_append_json(parent, buf, len, &errormsg);
+    LOG("JSON content = %d\n", content);
     if (errormsg != NULL) {
+        ELOG("Could not load \"%s\": %s\n", path, errormsg);
         yerror(errormsg);
         free(errormsg);
-        /* Note that we continue executing since tree_append_json() has
-         * side-effects — user-provided layouts can be partly valid, partly
-         * invalid, leading to half of the placeholder containers being
-         * created. */
-    } else {
-        ysuccess(true);
+        goto out;
     }
+    ysuccess(true);
+
+    if (content == JSON_CONTENT_WORKSPACE)
+        parent = output_get_content(con_get_output(parent));
 
     // XXX: This is a bit of a kludge. Theoretically, render_con(parent,
     // false); should be enough, but when sending 'workspace 4; append_layout
@@ -1038,11 +1095,13 @@ void cmd_move_con_to_output(I3_CMD, const char *name) {
 
     owindow *current;
     bool had_error = false;
+    con_move_begin();
     TAILQ_FOREACH(current, &owindows, owindows) {
         DLOG("matching: %p / %s\n", current->con, current->con->name);
 
         had_error |= !con_move_to_output_name(current->con, name, true);
     }
+    con_move_end();
 
     cmd_output->needs_tree_render = true;
     ysuccess(!had_error);
@@ -1059,10 +1118,12 @@ void cmd_move_con_to_mark(I3_CMD, const char *mark) {
 
     bool result = true;
     owindow *current;
+    con_move_begin();
     TAILQ_FOREACH(current, &owindows, owindows) {
         DLOG("moving matched window %p / %s to mark \"%s\"\n", current->con, current->con->name, mark);
         result &= con_move_to_mark(current->con, mark);
     }
+    con_move_end();
 
     cmd_output->needs_tree_render = true;
     ysuccess(result);
@@ -1190,10 +1251,14 @@ void cmd_kill(I3_CMD, const char *kill_mode_str) {
 
     HANDLE_EMPTY_MATCH;
 
+    /* Close all matched windows at once, so that the kill requests are sent in
+     * one burst and the tree is rendered only once. */
+    tree_close_begin();
     owindow *current;
     TAILQ_FOREACH(current, &owindows, owindows) {
         con_close(current->con, kill_mode);
     }
+    tree_close_end();
 
     cmd_output->needs_tree_render = true;
     // XXX: default reply for now, make this a better reply
@@ -1437,7 +1502,7 @@ void cmd_sticky(I3_CMD, const char *action) {
         else if (strcmp(action, "toggle") == 0)
             sticky = !current->con->sticky;
 
-        current->con->sticky = sticky;
+        con_set_sticky(current->con, sticky);
         ewmh_update_sticky(current->con->window->id, sticky);
     }
 
@@ -1462,6 +1527,10 @@ void cmd_move_direction(I3_CMD, const char *direction_str, long move_px) {
     Con *initially_focused = focused;
     direction_t direction = parse_direction(direction_str);
 
+    /* Coalesced key repeats move floating windows by the sum of their
+     * amounts and tiling windows once per repeat. */
+    move_px *= cmd_output->repeat;
+
     TAILQ_FOREACH(current, &owindows, owindows) {
         DLOG("moving in direction %s, px %ld\n", direction_str, move_px);
         if (con_is_floating(current->con)) {
@@ -1485,7 +1554,8 @@ void cmd_move_direction(I3_CMD, const char *direction_str, long move_px) {
 
             floating_reposition(current->con->parent, newrect);
         } else {
-            tree_move(current->con, direction);
+            for (int i = 0; i < cmd_output->repeat; i++)
+                tree_move(current->con, direction);
             cmd_output->needs_tree_render = true;
         }
     }
@@ -1561,6 +1631,11 @@ void cmd_layout_toggle(I3_CMD, const char *toggle_mode) {
  *
  */
 void cmd_exit(I3_CMD) {
+    if (event_trace_replaying()) {
+        yerror("Not exiting while replaying a trace.");
+        return;
+    }
+
     LOG("Exiting due to user command.\n");
     exit(0);
 
@@ -1591,6 +1666,11 @@ void cmd_reload(I3_CMD) {
  *
  */
 void cmd_restart(I3_CMD) {
+    if (event_trace_replaying()) {
+        yerror("Not restarting while replaying a trace.");
+        return;
+    }
+
     LOG("restarting i3\n");
     int exempt_fd = -1;
     if (cmd_output->client != NULL) {
@@ -1623,6 +1703,7 @@ void cmd_open(I3_CMD) {
     LOG("opening new container\n");
     Con *con = tree_open_con(NULL, NULL);
     con->layout = L_SPLITH;
+    con_invalidate_tree_representation(con);
     con_activate(con);
 
     y(map_open);
@@ -1887,19 +1968,17 @@ void cmd_title_format(I3_CMD, const char *format) {
     owindow *current;
     TAILQ_FOREACH(current, &owindows, owindows) {
         DLOG("setting title_format for %p / %s\n", current->con, current->con->name);
-        FREE(current->con->title_format);
-
         /* If we only display the title without anything else, we can skip the parsing step,
          * so we remove the title format altogether. */
         if (strcasecmp(format, "%title") != 0) {
-            current->con->title_format = sstrdup(format);
+            con_set_title_format(current->con, format);
 
             if (current->con->window != NULL) {
                 i3String *formatted_title = con_parse_title_format(current->con);
                 ewmh_update_visible_name(current->con->window->id, i3string_as_utf8(formatted_title));
-                I3STRING_FREE(formatted_title);
             }
         } else {
+            con_set_title_format(current->con, NULL);
             if (current->con->window != NULL) {
                 /* We can remove _NET_WM_VISIBLE_NAME since we don't display a custom title. */
                 ewmh_update_visible_name(current->con->window->id, NULL);
@@ -1913,6 +1992,7 @@ void cmd_title_format(I3_CMD, const char *format) {
             /* For windowless containers we also need to force the redrawing. */
             FREE(current->con->deco_render_params);
         }
+        con_set_dirty(current->con);
     }
 
     cmd_output->needs_tree_render = true;
@@ -2183,3 +2263,28 @@ void cmd_debuglog(I3_CMD, const char *argument) {
     // XXX: default reply for now, make this a better reply
     ysuccess(true);
 }
+
+/*
+ * Implementation of 'debuglog <category> toggle|on|off'
+ *
+ */
+void cmd_debuglog_category(I3_CMD, const char *category, const char *argument) {
+    const log_category_t bit = log_category_from_name(category);
+    if (bit == 0) {
+        yerror("Unknown log category \"%s\".", category);
+        return;
+    }
+
+    bool enabled = (log_categories & bit) != 0;
+    if (!strcmp(argument, "toggle"))
+        enabled = !enabled;
+    else
+        enabled = !strcmp(argument, "on");
+
+    if (enabled)
+        log_categories |= bit;
+    else
+        log_categories &= ~bit;
+    LOG("%s log category %s\n", enabled ? "Enabled" : "Disabled", category);
+    ysuccess(true);
+}
@@ -33,8 +33,8 @@
 #include <stdint.h>
 
 // Macros to make the YAJL API a bit easier to use.
-#define y(x, ...) (command_output.json_gen != NULL ? yajl_gen_##x(command_output.json_gen, ##__VA_ARGS__) : 0)
-#define ystr(str) (command_output.json_gen != NULL ? yajl_gen_string(command_output.json_gen, (unsigned char *)str, strlen(str)) : 0)
+#define y(x, ...) (command_output.json_gen != NULL ? ygen_##x(command_output.json_gen, ##__VA_ARGS__) : 0)
+#define ystr(str) (command_output.json_gen != NULL ? ygen_string(command_output.json_gen, (unsigned char *)str, strlen(str)) : 0)
 
 /*******************************************************************************
  * The data structures used for parsing. Essentially the current state and a
@@ -63,6 +63,65 @@ typedef struct tokenptr {
 
 #include "GENERATED_command_tokens.h"
 
+/* A literal token of a state, see generate-command-parser.pl. */
+typedef struct literal {
+    const char *name;
+    size_t len;
+    /* Index of the token in tokens[state]. */
+    int token;
+    /* Index of the longest literal which is a prefix of this one, or -1. */
+    int parent;
+    /* The lowest token index of this literal and its parents. */
+    int first;
+} cmdp_literal;
+
+typedef struct dispatch {
+    /* Sorted case-insensitively. */
+    const cmdp_literal *literals;
+    int num_literals;
+    /* Indexes of the tokens which are not literals, in ascending order. */
+    const int *others;
+    int num_others;
+} cmdp_dispatch;
+
+#include "GENERATED_command_dispatch.h"
+
+static int fold_case(unsigned char c) {
+    return (c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+}
+
+/*
+ * Returns the index of the literal token of the current state which the input
+ * starts with (like strncasecmp() against every literal would), or -1. If
+ * several literals match, the one which comes first in the specification wins.
+ *
+ */
+static int find_literal(const cmdp_dispatch *table, const char *walk) {
+    /* Binary search for the last literal which sorts before the input or is a
+     * prefix of it. */
+    int lo = 0, hi = table->num_literals;
+    while (lo < hi) {
+        const int mid = lo + (hi - lo) / 2;
+        const char *name = table->literals[mid].name;
+        int cmp = 0;
+        for (size_t i = 0; name[i] != '\0' && cmp == 0; i++)
+            cmp = fold_case(name[i]) - fold_case(walk[i]);
+        if (cmp <= 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    /* Any literal which is a prefix of the input is a prefix of that one, so
+     * it is found by following the parents. */
+    for (int idx = lo - 1; idx != -1; idx = table->literals[idx].parent) {
+        const cmdp_literal *literal = &(table->literals[idx]);
+        if (strncasecmp(walk, literal->name, literal->len) == 0)
+            return literal->first;
+    }
+    return -1;
+}
+
 /*******************************************************************************
  * The (small) stack where identified literals are stored during the parsing
  * of a single command (like $workspace).
@@ -84,9 +143,15 @@ struct stack_entry {
 /* 10 entries should be enough for everybody. */
 static struct stack_entry stack[10];
 
+/* Everything which only lives as long as a single parse_command() call (the
+ * strings on the stack, error message buffers) is allocated from this arena
+ * and released in one step when parse_command() returns. */
+static arena_t *parser_arena;
+
 /*
  * Pushes a string (identified by 'identifier') on the stack. We simply use a
  * single array, since the number of entries we have to store is very small.
+ * The string must be allocated from parser_arena (or outlive the stack).
  *
  */
 static void push_string(const char *identifier, char *str) {
@@ -157,8 +222,6 @@ static long get_long(const char *identifier) {
 // TODO move to a common util
 static void clear_stack(void) {
     for (int c = 0; c < 10; c++) {
-        if (stack[c].type == STACK_STR)
-            free(stack[c].val.str);
         stack[c].identifier = NULL;
         stack[c].val.str = NULL;
         stack[c].val.num = 0;
@@ -178,11 +241,76 @@ static struct CommandResultIR command_output;
 
 #include "GENERATED_command_call.h"
 
+/*******************************************************************************
+ * Precompiled commands. Since the parser does not depend on anything but the
+ * input, the sequence of calls (and their arguments) which parsing a command
+ * results in can be recorded once and replayed whenever the command is run.
+ ******************************************************************************/
+
+typedef struct command_ir_step {
+    enum {
+        /* Call GENERATED_call() with the recorded stack. */
+        IR_CALL = 0,
+        /* Re-initialize the criteria (a command ended with ';'). */
+        IR_CRITERIA_INIT = 1,
+    } type;
+    uint16_t call_identifier;
+    int num_args;
+    struct stack_entry args[10];
+} command_ir_step;
+
+struct CommandIR {
+    /* The command text, for logging. */
+    char *input;
+    command_ir_step *steps;
+    int num_steps;
+    int refcount;
+    /* Whether running the command n times in a row is equivalent to running
+     * it once with repeat = n (see command_ir_is_repeatable()). */
+    bool repeatable;
+};
+
+/* The precompiled command which is currently being recorded, or NULL. */
+static CommandIR *recording;
+
+static command_ir_step *command_ir_add_step(CommandIR *ir, int type) {
+    ir->steps = srealloc(ir->steps, (ir->num_steps + 1) * sizeof(command_ir_step));
+    command_ir_step *step = &(ir->steps[ir->num_steps++]);
+    memset(step, 0, sizeof(command_ir_step));
+    step->type = type;
+    return step;
+}
+
+/*
+ * Copies the stack into a new IR_CALL step of the recording.
+ *
+ */
+static void record_call(uint16_t call_identifier) {
+    command_ir_step *step = command_ir_add_step(recording, IR_CALL);
+    step->call_identifier = call_identifier;
+    for (int c = 0; c < 10; c++) {
+        if (stack[c].identifier == NULL)
+            break;
+        step->args[step->num_args] = stack[c];
+        if (stack[c].type == STACK_STR && stack[c].val.str != NULL)
+            step->args[step->num_args].val.str = sstrdup(stack[c].val.str);
+        step->num_args++;
+    }
+}
+
 static void next_state(const cmdp_token *token) {
+    if (token->next_state == __CALL && recording != NULL) {
+        state = GENERATED_call_next_state(token->extra.call_identifier);
+        record_call(token->extra.call_identifier);
+        clear_stack();
+        return;
+    }
+
     if (token->next_state == __CALL) {
         subcommand_output.json_gen = command_output.json_gen;
         subcommand_output.client = command_output.client;
         subcommand_output.needs_tree_render = false;
+        subcommand_output.repeat = 1;
         GENERATED_call(token->extra.call_identifier, &subcommand_output);
         state = subcommand_output.next_state;
         /* If any subcommand requires a tree_render(), we need to make the
@@ -200,12 +328,11 @@ static void next_state(const cmdp_token *token) {
 }
 
 /*
- * Parses a string (or word, if as_word is true). Extracted out of
- * parse_command so that it can be used in src/workspace.c for interpreting
- * workspace commands.
+ * Advances walk to the end of the string (or word, if as_word is true) and
+ * returns its beginning, or NULL if it is empty.
  *
  */
-char *parse_string(const char **walk, bool as_word) {
+static const char *skip_string(const char **walk, bool as_word) {
     const char *beginning = *walk;
     /* Handle quoted strings (or words). */
     if (**walk == '"') {
@@ -237,13 +364,18 @@ char *parse_string(const char **walk, bool as_word) {
     }
     if (*walk == beginning)
         return NULL;
+    return beginning;
+}
 
-    char *str = scalloc(*walk - beginning + 1, 1);
+/*
+ * Copies the len bytes at beginning into str, which must have room for len + 1
+ * bytes, and NUL-terminates it.
+ *
+ */
+static void unescape_string(char *str, const char *beginning, size_t len) {
     /* We copy manually to handle escaping of characters. */
-    int inpos, outpos;
-    for (inpos = 0, outpos = 0;
-         inpos < (*walk - beginning);
-         inpos++, outpos++) {
+    size_t inpos, outpos;
+    for (inpos = 0, outpos = 0; inpos < len; inpos++, outpos++) {
         /* We only handle escaped double quotes and backslashes to not break
          * backwards compatibility with people using \w in regular expressions
          * etc. */
@@ -251,7 +383,23 @@ char *parse_string(const char **walk, bool as_word) {
             inpos++;
         str[outpos] = beginning[inpos];
     }
+    str[outpos] = '\0';
+}
 
+/*
+ * Parses a string (or word, if as_word is true). Extracted out of
+ * parse_command so that it can be used in src/workspace.c for interpreting
+ * workspace commands.
+ *
+ */
+char *parse_string(const char **walk, bool as_word) {
+    const char *beginning = skip_string(walk, as_word);
+    if (beginning == NULL)
+        return NULL;
+
+    const size_t len = *walk - beginning;
+    char *str = smalloc(len + 1);
+    unescape_string(str, beginning, len);
     return str;
 }
 
@@ -264,9 +412,18 @@ char *parse_string(const char **walk, bool as_word) {
  */
 CommandResult *parse_command(const char *input, yajl_gen gen, ipc_client *client) {
     DLOG("COMMAND: *%s*\n", input);
+#ifndef TEST_PARSER
+    stats_frame_command(input);
+#endif
     state = INITIAL;
     CommandResult *result = scalloc(1, sizeof(CommandResult));
 
+    if (parser_arena == NULL)
+        parser_arena = arena_new();
+    /* parse_command() is re-entered when a command reloads the config (which
+     * precompiles commands), so only release what this call allocated. */
+    const arena_mark_t arena_start = arena_mark(parser_arena);
+
     command_output.client = client;
 
     /* A YAJL JSON generator used for formatting replies. */
@@ -283,7 +440,10 @@ CommandResult *parse_command(const char *input, yajl_gen gen, ipc_client *client
 
 // TODO: make this testable
 #ifndef TEST_PARSER
-    cmd_criteria_init(&current_match, &subcommand_output);
+    if (recording == NULL)
+        cmd_criteria_init(&current_match, &subcommand_output);
+    /* Commands may change anything which is part of the tree dump. */
+    ipc_invalidate_tree_reply();
 #endif
 
     /* The "<=" operator is intentional: We also handle the terminating 0-byte
@@ -296,21 +456,30 @@ CommandResult *parse_command(const char *input, yajl_gen gen, ipc_client *client
             walk++;
 
         cmdp_token_ptr *ptr = &(tokens[state]);
+        const cmdp_dispatch *table = &(dispatch[state]);
+        /* Try the tokens in the order of the specification, but only the
+         * literal which actually matches. */
+        int literal = find_literal(table, walk);
+        int other = 0;
         token_handled = false;
-        for (c = 0; c < ptr->n; c++) {
+        while (other < table->num_others || literal != -1) {
+            if (other < table->num_others &&
+                (literal == -1 || table->others[other] < literal)) {
+                c = table->others[other++];
+            } else {
+                c = literal;
+                literal = -1;
+            }
             token = &(ptr->array[c]);
 
             /* A literal. */
             if (token->name[0] == '\'') {
-                if (strncasecmp(walk, token->name + 1, strlen(token->name) - 1) == 0) {
-                    if (token->identifier != NULL)
-                        push_string(token->identifier, sstrdup(token->name + 1));
-                    walk += strlen(token->name) - 1;
-                    next_state(token);
-                    token_handled = true;
-                    break;
-                }
-                continue;
+                if (token->identifier != NULL)
+                    push_string(token->identifier, arena_strdup(parser_arena, token->name + 1));
+                walk += strlen(token->name) - 1;
+                next_state(token);
+                token_handled = true;
+                break;
             }
 
             if (strcmp(token->name, "number") == 0) {
@@ -338,10 +507,14 @@ CommandResult *parse_command(const char *input, yajl_gen gen, ipc_client *client
 
             if (strcmp(token->name, "string") == 0 ||
                 strcmp(token->name, "word") == 0) {
-                char *str = parse_string(&walk, (token->name[0] != 's'));
-                if (str != NULL) {
-                    if (token->identifier)
+                const char *beginning = skip_string(&walk, (token->name[0] != 's'));
+                if (beginning != NULL) {
+                    if (token->identifier) {
+                        const size_t str_len = walk - beginning;
+                        char *str = arena_alloc(parser_arena, str_len + 1);
+                        unescape_string(str, beginning, str_len);
                         push_string(token->identifier, str);
+                    }
                     /* If we are at the end of a quoted string, skip the ending
                      * double quote. */
                     if (*walk == '"')
@@ -360,9 +533,11 @@ CommandResult *parse_command(const char *input, yajl_gen gen, ipc_client *client
                      * datastructure for commands which do *not* specify any
                      * criteria, we re-initialize the criteria system after
                      * every command. */
+                    if ((*walk == '\0' || *walk == ';') && recording != NULL)
+                        command_ir_add_step(recording, IR_CRITERIA_INIT);
 // TODO: make this testable
 #ifndef TEST_PARSER
-                    if (*walk == '\0' || *walk == ';')
+                    else if (*walk == '\0' || *walk == ';')
                         cmd_criteria_init(&current_match, &subcommand_output);
 #endif
                     walk++;
@@ -371,6 +546,14 @@ CommandResult *parse_command(const char *input, yajl_gen gen, ipc_client *client
             }
         }
 
+        if (!token_handled && recording != NULL) {
+            /* Parse errors are reported when the command is run (and parsed
+             * from text, since it cannot be precompiled). */
+            result->parse_error = true;
+            clear_stack();
+            break;
+        }
+
         if (!token_handled) {
             /* Figure out how much memory we will need to fill in the names of
              * all tokens afterwards. */
@@ -382,7 +565,7 @@ CommandResult *parse_command(const char *input, yajl_gen gen, ipc_client *client
              * full input, and underline the position where the parser
              * currently is. */
             char *errormessage;
-            char *possible_tokens = smalloc(tokenlen + 1);
+            char *possible_tokens = arena_alloc(parser_arena, tokenlen + 1);
             char *tokenwalk = possible_tokens;
             for (c = 0; c < ptr->n; c++) {
                 token = &(ptr->array[c]);
@@ -409,11 +592,10 @@ CommandResult *parse_command(const char *input, yajl_gen gen, ipc_client *client
             *tokenwalk = '\0';
             sasprintf(&errormessage, "Expected one of these tokens: %s",
                       possible_tokens);
-            free(possible_tokens);
 
             /* Contains the same amount of characters as 'input' has, but with
              * the unparseable part highlighted using ^ characters. */
-            char *position = smalloc(len + 1);
+            char *position = arena_alloc(parser_arena, len + 1);
             for (const char *copywalk = input; *copywalk != '\0'; copywalk++)
                 position[(copywalk - input)] = (copywalk >= walk ? '^' : ' ');
             position[len] = '\0';
@@ -442,7 +624,6 @@ CommandResult *parse_command(const char *input, yajl_gen gen, ipc_client *client
             ystr(position);
             y(map_close);
 
-            free(position);
             clear_stack();
             break;
         }
@@ -450,10 +631,187 @@ CommandResult *parse_command(const char *input, yajl_gen gen, ipc_client *client
 
     y(array_close);
 
+    arena_release(parser_arena, arena_start);
     result->needs_tree_render = command_output.needs_tree_render;
     return result;
 }
 
+/*
+ * Parses the given command once and returns its precompiled form, which can be
+ * run any number of times with command_ir_run(). Returns NULL if the command
+ * contains a parse error; such commands need to be run with parse_command(),
+ * which reports the error.
+ *
+ * Release the returned CommandIR with command_ir_unref().
+ *
+ */
+CommandIR *command_ir_compile(const char *input) {
+    CommandIR *ir = scalloc(1, sizeof(CommandIR));
+    ir->input = sstrdup(input);
+    ir->refcount = 1;
+
+    /* Commands are compiled while loading the config, which can happen in the
+     * middle of running a command ('reload'). Recording does not call any
+     * command functions, so saving the parser state around it suffices. */
+    const cmdp_state saved_state = state;
+    const struct CommandResultIR saved_command_output = command_output;
+    const struct CommandResultIR saved_subcommand_output = subcommand_output;
+    struct stack_entry saved_stack[10];
+    memcpy(saved_stack, stack, sizeof(stack));
+    memset(stack, 0, sizeof(stack));
+
+    recording = ir;
+    CommandResult *result = parse_command(input, NULL, NULL);
+    recording = NULL;
+
+    state = saved_state;
+    command_output = saved_command_output;
+    subcommand_output = saved_subcommand_output;
+    memcpy(stack, saved_stack, sizeof(stack));
+
+    const bool parse_error = result->parse_error;
+    command_result_free(result);
+    if (parse_error) {
+        DLOG("Could not precompile command \"%s\"\n", input);
+        command_ir_unref(ir);
+        return NULL;
+    }
+
+    /* Only a single resize or move command (with any criteria) can be
+     * repeated by scaling its amount. */
+    int num_commands = 0;
+    for (int i = 0; i < ir->num_steps; i++) {
+        if (ir->steps[i].type != IR_CALL)
+            continue;
+        const char *function = GENERATED_call_function(ir->steps[i].call_identifier);
+        if (strncmp(function, "cmd_criteria_", strlen("cmd_criteria_")) == 0)
+            continue;
+        num_commands++;
+        ir->repeatable = (strcmp(function, "cmd_resize") == 0 ||
+                          strcmp(function, "cmd_move_direction") == 0);
+    }
+    if (num_commands != 1)
+        ir->repeatable = false;
+
+    return ir;
+}
+
+/*
+ * Returns true if running the given precompiled command n times in a row can
+ * be replaced by running it once with command_ir_run_repeated(), which is the
+ * case for a single 'resize grow|shrink' or 'move <direction>' command.
+ *
+ */
+bool command_ir_is_repeatable(const CommandIR *ir) {
+    return ir != NULL && ir->repeatable;
+}
+
+/*
+ * Takes another reference to the given precompiled command.
+ *
+ */
+CommandIR *command_ir_ref(CommandIR *ir) {
+    if (ir != NULL)
+        ir->refcount++;
+    return ir;
+}
+
+/*
+ * Releases a reference to the given precompiled command, freeing it when this
+ * was the last one.
+ *
+ */
+void command_ir_unref(CommandIR *ir) {
+    if (ir == NULL || --(ir->refcount) > 0)
+        return;
+
+    for (int i = 0; i < ir->num_steps; i++) {
+        command_ir_step *step = &(ir->steps[i]);
+        for (int c = 0; c < step->num_args; c++) {
+            if (step->args[c].type == STACK_STR)
+                free(step->args[c].val.str);
+        }
+    }
+    free(ir->steps);
+    free(ir->input);
+    free(ir);
+}
+
+/*
+ * Runs the given precompiled command like parse_command() would run its text.
+ * If con or window are given, the first command operates on that container or
+ * window, like it would with a [con_id=…] or [id=…] criterion prepended.
+ *
+ * Free the returned CommandResult with command_result_free().
+ *
+ */
+CommandResult *command_ir_run(CommandIR *ir, Con *con, xcb_window_t window) {
+    return command_ir_run_repeated(ir, con, window, 1);
+}
+
+/*
+ * Like command_ir_run(), but the command behaves as if it was run repeat times
+ * in a row. Only valid for commands for which command_ir_is_repeatable()
+ * returns true (or with repeat = 1).
+ *
+ */
+CommandResult *command_ir_run_repeated(CommandIR *ir, Con *con, xcb_window_t window, int repeat) {
+    if (repeat == 1)
+        DLOG("COMMAND (precompiled): *%s*\n", ir->input);
+    else
+        DLOG("COMMAND (precompiled, %d times): *%s*\n", repeat, ir->input);
+#ifndef TEST_PARSER
+    stats_frame_command(ir->input);
+#endif
+    CommandResult *result = scalloc(1, sizeof(CommandResult));
+
+    /* A for_window or binding command may reload the config, which releases
+     * the reference its owner holds. */
+    command_ir_ref(ir);
+
+    command_output.client = NULL;
+    command_output.json_gen = NULL;
+    command_output.needs_tree_render = false;
+
+#ifndef TEST_PARSER
+    cmd_criteria_init(&current_match, &subcommand_output);
+    if (con != NULL || window != XCB_NONE) {
+        cmd_criteria_init(&current_match, &subcommand_output);
+        current_match.con_id = con;
+        current_match.id = window;
+        cmd_criteria_match_windows(&current_match, &subcommand_output);
+    }
+#endif
+
+    for (int i = 0; i < ir->num_steps; i++) {
+        const command_ir_step *step = &(ir->steps[i]);
+        if (step->type == IR_CRITERIA_INIT) {
+#ifndef TEST_PARSER
+            cmd_criteria_init(&current_match, &subcommand_output);
+#endif
+            continue;
+        }
+
+        /* The arguments stay valid while the command runs, since we hold a
+         * reference to ir. */
+        for (int c = 0; c < step->num_args; c++)
+            stack[c] = step->args[c];
+
+        subcommand_output.json_gen = command_output.json_gen;
+        subcommand_output.client = command_output.client;
+        subcommand_output.needs_tree_render = false;
+        subcommand_output.repeat = repeat;
+        GENERATED_call(step->call_identifier, &subcommand_output);
+        if (subcommand_output.needs_tree_render)
+            command_output.needs_tree_render = true;
+        clear_stack();
+    }
+
+    result->needs_tree_render = command_output.needs_tree_render;
+    command_ir_unref(ir);
+    return result;
+}
+
 /*
  * Frees a CommandResult
  */
@@ -472,6 +830,9 @@ void command_result_free(CommandResult *result) {
 
 #ifdef TEST_PARSER
 
+/* All log categories are enabled, see log.h. */
+uint32_t log_categories = UINT32_MAX;
+
 /*
  * Logs the given message to stdout while prefixing the current time to it,
  * but only if debug logging was activated.
@@ -495,6 +856,61 @@ void errorlog(char *fmt, ...) {
     va_end(args);
 }
 
+#ifdef BENCH_PARSER
+#include "bench_parser.h"
+
+/*
+ * Parses every line of the given file (empty lines and comments excepted) as
+ * a command, the given number of times, and reports the throughput.
+ *
+ */
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Syntax: %s <file with one command per line> [iterations]\n", argv[0]);
+        return 1;
+    }
+    const int iterations = bench_iterations(argc, argv, 2);
+    size_t len;
+    char *corpus = bench_read_file(argv[1], &len);
+
+    char **commands = NULL;
+    int num_commands = 0;
+    uint64_t bytes = 0;
+    for (char *line = strtok(corpus, "\n"); line != NULL; line = strtok(NULL, "\n")) {
+        if (*line == '\0' || *line == '#')
+            continue;
+        commands = srealloc(commands, (num_commands + 1) * sizeof(char *));
+        commands[num_commands++] = line;
+        bytes += strlen(line);
+    }
+    if (num_commands == 0) {
+        fprintf(stderr, "No commands in %s\n", argv[1]);
+        return 1;
+    }
+
+    bench_silence(true);
+    /* Warm up, so that the first parse does not count the arena setup. */
+    command_result_free(parse_command(commands[0], NULL, NULL));
+
+    const uint64_t allocations = bench_allocations;
+    const double start = bench_now();
+    for (int i = 0; i < iterations; i++) {
+        for (int c = 0; c < num_commands; c++) {
+            command_result_free(parse_command(commands[c], NULL, NULL));
+        }
+    }
+    const double seconds = bench_now() - start;
+    const uint64_t parses = (uint64_t)iterations * num_commands;
+    const uint64_t allocated = bench_allocations - allocations;
+    bench_silence(false);
+
+    bench_report("commands", parses, bytes * iterations, seconds, allocated);
+
+    free(commands);
+    free(corpus);
+    return 0;
+}
+#else
 int main(int argc, char *argv[]) {
     if (argc < 2) {
         fprintf(stderr, "Syntax: %s <command>\n", argv[0]);
@@ -509,3 +925,4 @@ int main(int argc, char *argv[]) {
     yajl_gen_free(gen);
 }
 #endif
+#endif
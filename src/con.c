@@ -15,6 +15,176 @@
 
 static void con_on_remove_child(Con *con);
 
+/* Lookup indexes for con_by_window_id() and con_by_frame_id(), which are called
+ * for nearly every X11 event and would otherwise walk all_cons. */
+static hashmap_t *window_index;
+static hashmap_t *frame_index;
+
+/* Set of all live containers, used by con_by_con_id() and con_exists(). */
+static hashmap_t *con_registry;
+
+/* Maps mark names to the (single) container holding the mark. */
+static hashmap_t *mark_index;
+
+/* The members of a sticky group, see con_set_sticky_group(). */
+struct sticky_group {
+    Con **members;
+    int num_members;
+    int members_size;
+};
+
+/* Maps sticky group names to their struct sticky_group, so that switching
+ * workspaces does not need to search the tree for the members. */
+static hashmap_t *sticky_groups;
+
+/* The swallow criteria of all containers, so that con_for_window() only checks
+ * the criteria which can match the window instead of walking the tree. */
+struct swallow_entry {
+    Con *con;
+    Match *match;
+};
+
+struct swallow_bucket {
+    struct swallow_entry *entries;
+    int num_entries;
+    int entries_size;
+};
+
+/* Criteria with a window id are indexed by the id, criteria with an anchored
+ * literal class or instance (see regex_exact_literal()) by the interned
+ * literal. All other criteria end up in swallow_unindexed. */
+static hashmap_t *swallow_by_id;
+static hashmap_t *swallow_by_class;
+static hashmap_t *swallow_by_instance;
+static struct swallow_bucket swallow_unindexed;
+
+/* Containers and marks are allocated from slabs, so that opening and closing
+ * windows does not fragment the heap and the tree stays close in memory. */
+static slab_t *con_slab;
+static slab_t *mark_slab;
+
+/* The results of con_get_workspace() and friends are cached while a section
+ * started with con_cache_begin() is active in this thread, see
+ * con_cache_has(). Worker threads (see render_outputs()) never cache, so that
+ * they do not write to containers shared with other workers. */
+static uint64_t cache_generation;
+static __thread int cache_depth;
+
+#define CON_CACHED_WORKSPACE (1 << 0)
+#define CON_CACHED_OUTPUT (1 << 1)
+#define CON_CACHED_INSIDE_FOCUSED (1 << 2)
+#define CON_CACHED_DESCEND_FOCUSED (1 << 3)
+#define CON_CACHED_NUM_VISIBLE_CHILDREN (1 << 4)
+
+static void con_init_slabs(void) {
+    if (con_slab != NULL) {
+        return;
+    }
+    con_slab = slab_new("con", sizeof(Con));
+    mark_slab = slab_new("mark", sizeof(mark_t));
+    stats_register_slab(con_slab);
+    stats_register_slab(mark_slab);
+}
+
+/*
+ * Starts a section (like a render, see tree_render()) in which the tree
+ * is mostly read, so that con_get_workspace(), con_get_output(),
+ * con_inside_focused() and con_descend_focused() can cache their results in
+ * the containers. Sections nest. Only the calling thread uses the caches.
+ *
+ */
+void con_cache_begin(void) {
+    /* Whatever changed since the last section did not necessarily go through
+     * con_cache_invalidate() (focused is assigned directly in a few places,
+     * for example), so start with empty caches. */
+    if (cache_depth++ == 0) {
+        cache_generation++;
+    }
+}
+
+/*
+ * Ends a section started with con_cache_begin().
+ *
+ */
+void con_cache_end(void) {
+    assert(cache_depth > 0);
+    cache_depth--;
+}
+
+/*
+ * Invalidates all cached results of con_get_workspace() and friends. Called
+ * whenever the focus or the tree structure changes.
+ *
+ */
+void con_cache_invalidate(void) {
+    cache_generation++;
+}
+
+/*
+ * Returns true if the given cached result of con is valid. Must only be called
+ * while caching is enabled (cache_depth > 0).
+ *
+ */
+static bool con_cache_has(Con *con, uint8_t field) {
+    if (con->cache_generation != cache_generation) {
+        con->cache_generation = cache_generation;
+        con->cache_fields = 0;
+    }
+    return (con->cache_fields & field) != 0;
+}
+
+/*
+ * Adds the container to the lookup indexes for its client window ID and frame
+ * ID. Needs to be called whenever con->window or con->frame changes.
+ *
+ */
+void con_index_add(Con *con) {
+    if (window_index == NULL) {
+        window_index = hashmap_new();
+        frame_index = hashmap_new();
+    }
+
+    if (con->window != NULL) {
+        hashmap_set(window_index, &(con->window->id), sizeof(xcb_window_t), con);
+    }
+    if (con->frame.id != XCB_NONE) {
+        hashmap_set(frame_index, &(con->frame.id), sizeof(xcb_window_t), con);
+    }
+}
+
+/*
+ * Removes the given client window ID from the lookup index.
+ *
+ */
+void con_index_remove_window(xcb_window_t window) {
+    if (window_index != NULL) {
+        hashmap_remove(window_index, &window, sizeof(xcb_window_t));
+    }
+}
+
+/*
+ * Removes the given frame ID from the lookup index.
+ *
+ */
+void con_index_remove_frame(xcb_window_t frame) {
+    if (frame_index != NULL) {
+        hashmap_remove(frame_index, &frame, sizeof(xcb_window_t));
+    }
+}
+
+/*
+ * Removes all lookup index entries which point to the given container.
+ *
+ */
+static void con_index_remove(Con *con) {
+    if (con->window != NULL && con_by_window_id(con->window->id) == con) {
+        con_index_remove_window(con->window->id);
+    }
+    if (con->frame.id != XCB_NONE && con_by_frame_id(con->frame.id) == con) {
+        con_index_remove_frame(con->frame.id);
+    }
+}
+
 /*
  * force parent split containers to be redrawn
  *
@@ -22,6 +192,8 @@ static void con_on_remove_child(Con *con);
 void con_force_split_parents_redraw(Con *con) {
     Con *parent = con;
 
+    con_set_dirty(con);
+
     while (parent != NULL && parent->type != CT_WORKSPACE && parent->type != CT_DOCKAREA) {
         if (!con_is_leaf(parent)) {
             FREE(parent->deco_render_params);
@@ -31,17 +203,61 @@ void con_force_split_parents_redraw(Con *con) {
     }
 }
 
+/*
+ * Marks the decorations of the given container (and everything below it) as
+ * needing a redraw and flags all of its parents so that x_push_changes() can
+ * skip unchanged subtrees.
+ *
+ */
+void con_set_dirty(Con *con) {
+    con->dirty = true;
+    for (Con *parent = con->parent; parent != NULL && !parent->child_dirty; parent = parent->parent) {
+        parent->child_dirty = true;
+    }
+}
+
+/*
+ * Makes x_push_changes() visit the workspace of the given container again,
+ * after it was skipped because it was hidden and all of its windows were
+ * already unmapped.
+ *
+ */
+void con_wake_workspace(Con *con) {
+    Con *ws = con_get_workspace(con);
+    if (ws != NULL && ws->dormant) {
+        DLOG("Waking up workspace %p / %s\n", ws, ws->name);
+        ws->dormant = false;
+    }
+}
+
+/*
+ * Attaching or detaching a workspace (or anything above, like an output)
+ * changes which workspaces get_existing_workspace_by_name() and friends find.
+ *
+ */
+static void con_invalidate_workspace_index(Con *con) {
+    Con *ws = con_get_workspace(con);
+    if (ws == NULL || ws == con)
+        workspace_index_invalidate();
+}
+
 /*
  * Create a new container (and attach it to the given parent, if not NULL).
  * This function only initializes the data structures.
  *
  */
 Con *con_new_skeleton(Con *parent, i3Window *window) {
-    Con *new = scalloc(1, sizeof(Con));
+    con_init_slabs();
+    Con *new = slab_alloc(con_slab);
     new->on_remove_child = con_on_remove_child;
     TAILQ_INSERT_TAIL(&all_cons, new, all_cons);
+    if (con_registry == NULL) {
+        con_registry = hashmap_new();
+    }
+    hashmap_set(con_registry, &new, sizeof(Con *), new);
     new->type = CT_CON;
     new->window = window;
+    new->dirty = true;
     new->border_style = config.default_border;
     new->current_border_width = -1;
     if (window) {
@@ -77,27 +293,46 @@ Con *con_new(Con *parent, i3Window *window) {
  *
  */
 void con_free(Con *con) {
+    if (con->type == CT_WORKSPACE)
+        workspace_index_invalidate();
     free(con->name);
     FREE(con->deco_render_params);
+    FREE(con->deco_slots);
+    FREE(con->tree_representation);
+    con_set_title_format(con, NULL);
+    con_set_sticky_group(con, NULL);
+    con_index_remove(con);
+    hashmap_remove(con_registry, &con, sizeof(Con *));
     TAILQ_REMOVE(&all_cons, con, all_cons);
-    while (!TAILQ_EMPTY(&(con->swallow_head))) {
-        Match *match = TAILQ_FIRST(&(con->swallow_head));
-        TAILQ_REMOVE(&(con->swallow_head), match, matches);
-        match_free(match);
-        free(match);
-    }
+    if (con->sticky)
+        TAILQ_REMOVE(&sticky_cons, con, sticky_cons);
+    con_set_scratchpad_state(con, SCRATCHPAD_NONE);
+    con_clear_swallows(con);
     while (!TAILQ_EMPTY(&(con->marks_head))) {
         mark_t *mark = TAILQ_FIRST(&(con->marks_head));
         TAILQ_REMOVE(&(con->marks_head), mark, marks);
+        if (con_by_mark(mark->name) == con) {
+            hashmap_remove(mark_index, mark->name, strlen(mark->name));
+        }
         FREE(mark->name);
-        FREE(mark);
+        slab_free(mark_slab, mark);
     }
-    free(con);
+    slab_free(con_slab, con);
     DLOG("con %p freed\n", con);
 }
 
 static void _con_attach(Con *con, Con *parent, Con *previous, bool ignore_focus) {
+    /* The container might still be linked to its old parent (e.g. when it was
+     * replaced by a new split container via TAILQ_REPLACE). */
+    con_uncount_urgency(con);
     con->parent = parent;
+    con_cache_invalidate();
+    con_invalidate_workspace_index(con);
+    /* The attached container might still be mapped (e.g. when moving it from
+     * a visible workspace), so it needs to be pushed even if the workspace is
+     * hidden. */
+    con_wake_workspace(con);
+    con_invalidate_tree_representation(parent);
     Con *loop;
     Con *current = previous;
     struct nodes_head *nodes_head = &(parent->nodes_head);
@@ -129,6 +364,7 @@ static void _con_attach(Con *con, Con *parent, Con *previous, bool ignore_focus)
                     TAILQ_INSERT_TAIL(nodes_head, con, nodes);
             }
         }
+        parent->num_children++;
         goto add_to_focus_head;
     }
 
@@ -175,6 +411,8 @@ static void _con_attach(Con *con, Con *parent, Con *previous, bool ignore_focus)
             TAILQ_INSERT_AFTER(nodes_head, current, con, nodes);
         } else
             TAILQ_INSERT_TAIL(nodes_head, con, nodes);
+        /* con->parent, as workspace_attach_to() might have changed it. */
+        con->parent->num_children++;
     }
 
 add_to_focus_head:
@@ -182,6 +420,7 @@ add_to_focus_head:
      * This way, we have the option to insert Cons without having
      * to focus them. */
     TAILQ_INSERT_TAIL(focus_head, con, focused);
+    con_count_urgency(con);
     con_force_split_parents_redraw(con);
 }
 
@@ -204,13 +443,18 @@ void con_attach(Con *con, Con *parent, bool ignore_focus) {
  *
  */
 void con_detach(Con *con) {
+    con_uncount_urgency(con);
+    con_cache_invalidate();
+    con_invalidate_workspace_index(con);
     con_force_split_parents_redraw(con);
+    con_invalidate_tree_representation(con->parent);
     if (con->type == CT_FLOATING_CON) {
         TAILQ_REMOVE(&(con->parent->floating_head), con, floating_windows);
         TAILQ_REMOVE(&(con->parent->focus_head), con, focused);
     } else {
         TAILQ_REMOVE(&(con->parent->nodes_head), con, nodes);
         TAILQ_REMOVE(&(con->parent->focus_head), con, focused);
+        con->parent->num_children--;
     }
 }
 
@@ -222,9 +466,17 @@ void con_detach(Con *con) {
 void con_focus(Con *con) {
     assert(con != NULL);
     DLOG("con_focus = %p\n", con);
+    con_cache_invalidate();
 
     /* 1: set focused-pointer to the new con */
     /* 2: exchange the position of the container in focus stack of the parent all the way up */
+    Con *old_first = TAILQ_FIRST(&(con->parent->focus_head));
+    if (old_first != con) {
+        /* The focused_inactive colors of both containers change. */
+        if (old_first != NULL)
+            con_set_dirty(old_first);
+        con_set_dirty(con);
+    }
     TAILQ_REMOVE(&(con->parent->focus_head), con, focused);
     TAILQ_INSERT_HEAD(&(con->parent->focus_head), con, focused);
     if (con->parent->parent != NULL)
@@ -377,6 +629,38 @@ bool con_is_sticky(Con *con) {
     return false;
 }
 
+/*
+ * Sets the sticky flag of the container and keeps the list of sticky
+ * containers (sticky_cons) up to date.
+ *
+ */
+void con_set_sticky(Con *con, bool sticky) {
+    if (con->sticky == sticky)
+        return;
+
+    con->sticky = sticky;
+    if (sticky)
+        TAILQ_INSERT_TAIL(&sticky_cons, con, sticky_cons);
+    else
+        TAILQ_REMOVE(&sticky_cons, con, sticky_cons);
+}
+
+/*
+ * Sets the scratchpad state of the container and keeps the list of scratchpad
+ * containers (scratchpad_cons) up to date.
+ *
+ */
+void con_set_scratchpad_state(Con *con, enum scratchpad_state state) {
+    const bool was_scratchpad = (con->scratchpad_state != SCRATCHPAD_NONE);
+    const bool is_scratchpad = (state != SCRATCHPAD_NONE);
+
+    con->scratchpad_state = state;
+    if (is_scratchpad && !was_scratchpad)
+        TAILQ_INSERT_TAIL(&scratchpad_cons, con, scratchpad_cons);
+    else if (!is_scratchpad && was_scratchpad)
+        TAILQ_REMOVE(&scratchpad_cons, con, scratchpad_cons);
+}
+
 /*
  * Returns true if this node accepts a window (if the node swallows windows,
  * it might already have swallowed enough and cannot hold any more).
@@ -402,6 +686,19 @@ bool con_accepts_window(Con *con) {
  *
  */
 Con *con_get_output(Con *con) {
+    if (cache_depth > 0) {
+        if (!con_cache_has(con, CON_CACHED_OUTPUT)) {
+            if (con->type == CT_OUTPUT || con->parent == NULL) {
+                con->cached_output = (con->type == CT_OUTPUT ? con : NULL);
+            } else {
+                con->cached_output = con_get_output(con->parent);
+            }
+            con->cache_fields |= CON_CACHED_OUTPUT;
+        }
+        assert(con->cached_output != NULL);
+        return con->cached_output;
+    }
+
     Con *result = con;
     while (result != NULL && result->type != CT_OUTPUT)
         result = result->parent;
@@ -416,6 +713,18 @@ Con *con_get_output(Con *con) {
  *
  */
 Con *con_get_workspace(Con *con) {
+    if (cache_depth > 0) {
+        if (!con_cache_has(con, CON_CACHED_WORKSPACE)) {
+            if (con->type == CT_WORKSPACE || con->parent == NULL) {
+                con->cached_workspace = (con->type == CT_WORKSPACE ? con : NULL);
+            } else {
+                con->cached_workspace = con_get_workspace(con->parent);
+            }
+            con->cache_fields |= CON_CACHED_WORKSPACE;
+        }
+        return con->cached_workspace;
+    }
+
     Con *result = con;
     while (result != NULL && result->type != CT_WORKSPACE)
         result = result->parent;
@@ -584,6 +893,13 @@ bool con_inside_focused(Con *con) {
         return true;
     if (!con->parent)
         return false;
+    if (cache_depth > 0) {
+        if (!con_cache_has(con, CON_CACHED_INSIDE_FOCUSED)) {
+            con->cached_inside_focused = con_inside_focused(con->parent);
+            con->cache_fields |= CON_CACHED_INSIDE_FOCUSED;
+        }
+        return con->cached_inside_focused;
+    }
     return con_inside_focused(con->parent);
 }
 
@@ -610,11 +926,10 @@ bool con_has_parent(Con *con, Con *parent) {
  *
  */
 Con *con_by_window_id(xcb_window_t window) {
-    Con *con;
-    TAILQ_FOREACH(con, &all_cons, all_cons)
-    if (con->window != NULL && con->window->id == window)
-        return con;
-    return NULL;
+    if (window_index == NULL) {
+        return NULL;
+    }
+    return hashmap_get(window_index, &window, sizeof(xcb_window_t));
 }
 
 /*
@@ -623,14 +938,11 @@ Con *con_by_window_id(xcb_window_t window) {
  *
  */
 Con *con_by_con_id(long target) {
-    Con *con;
-    TAILQ_FOREACH(con, &all_cons, all_cons) {
-        if (con == (Con *)target) {
-            return con;
-        }
+    if (con_registry == NULL) {
+        return NULL;
     }
-
-    return NULL;
+    Con *con = (Con *)target;
+    return hashmap_get(con_registry, &con, sizeof(Con *));
 }
 
 /*
@@ -648,10 +960,74 @@ bool con_exists(Con *con) {
  *
  */
 Con *con_by_frame_id(xcb_window_t frame) {
-    Con *con;
-    TAILQ_FOREACH(con, &all_cons, all_cons)
-    if (con->frame.id == frame)
-        return con;
+    if (frame_index == NULL) {
+        return NULL;
+    }
+    return hashmap_get(frame_index, &frame, sizeof(xcb_window_t));
+}
+
+/*
+ * Records the positions of the children's decorations of the given tabbed or
+ * stacked container after rendering it, so that con_child_at_deco_position()
+ * can use a binary search.
+ *
+ */
+void con_record_deco_slots(Con *con) {
+    assert(con->layout == L_TABBED || con->layout == L_STACKED);
+
+    int num = 0;
+    Con *child;
+    TAILQ_FOREACH(child, &(con->nodes_head), nodes) {
+        if (num == con->deco_slots_size) {
+            con->deco_slots_size = (con->deco_slots_size == 0 ? 8 : con->deco_slots_size * 2);
+            con->deco_slots = srealloc(con->deco_slots, con->deco_slots_size * sizeof(struct deco_slot));
+        }
+
+        /* Tabs are laid out from left to right and stacked titles from top
+         * to bottom, in the order of nodes_head (see render_con()). */
+        struct deco_slot *slot = &(con->deco_slots[num++]);
+        if (con->layout == L_TABBED) {
+            slot->start = child->deco_rect.x;
+            slot->end = child->deco_rect.x + child->deco_rect.width;
+        } else {
+            slot->start = child->deco_rect.y;
+            slot->end = child->deco_rect.y + child->deco_rect.height;
+        }
+        slot->con = child;
+    }
+    con->num_deco_slots = num;
+}
+
+/*
+ * Returns the child of con whose decoration contains the given coordinates
+ * (relative to con's rect, like deco_rect), or NULL if there is none.
+ *
+ */
+Con *con_child_at_deco_position(Con *con, int32_t x, int32_t y) {
+    if (con->num_deco_slots > 0 && (con->layout == L_TABBED || con->layout == L_STACKED)) {
+        const int32_t position = (con->layout == L_TABBED ? x : y);
+        int low = 0;
+        int high = con->num_deco_slots - 1;
+        while (low <= high) {
+            const int mid = low + (high - low) / 2;
+            const struct deco_slot *slot = &(con->deco_slots[mid]);
+            if (position < slot->start) {
+                high = mid - 1;
+            } else if (position >= slot->end) {
+                low = mid + 1;
+            } else {
+                Con *child = slot->con;
+                return (rect_contains(child->deco_rect, x, y) ? child : NULL);
+            }
+        }
+        return NULL;
+    }
+
+    Con *child;
+    TAILQ_FOREACH(child, &(con->nodes_head), nodes) {
+        if (rect_contains(child->deco_rect, x, y))
+            return child;
+    }
     return NULL;
 }
 
@@ -661,13 +1037,10 @@ Con *con_by_frame_id(xcb_window_t frame) {
  *
  */
 Con *con_by_mark(const char *mark) {
-    Con *con;
-    TAILQ_FOREACH(con, &all_cons, all_cons) {
-        if (con_has_mark(con, mark))
-            return con;
+    if (mark_index == NULL) {
+        return NULL;
     }
-
-    return NULL;
+    return hashmap_get(mark_index, mark, strlen(mark));
 }
 
 /*
@@ -720,12 +1093,18 @@ void con_mark(Con *con, const char *mark, mark_mode_t mode) {
         }
     }
 
-    mark_t *new = scalloc(1, sizeof(mark_t));
+    con_init_slabs();
+    mark_t *new = slab_alloc(mark_slab);
     new->name = sstrdup(mark);
     TAILQ_INSERT_TAIL(&(con->marks_head), new, marks);
+    if (mark_index == NULL) {
+        mark_index = hashmap_new();
+    }
+    hashmap_set(mark_index, new->name, strlen(new->name), con);
     ipc_send_window_event("mark", con);
 
     con->mark_changed = true;
+    con_set_dirty(con);
 }
 
 /*
@@ -739,24 +1118,26 @@ void con_unmark(Con *con, const char *name) {
     Con *current;
     if (name == NULL) {
         DLOG("Unmarking all containers.\n");
-        TAILQ_FOREACH(current, &all_cons, all_cons) {
-            if (con != NULL && current != con)
-                continue;
-
+        /* When unmarking a single container, there is no need to look at
+         * all the others. */
+        current = (con == NULL) ? TAILQ_FIRST(&all_cons) : con;
+        for (; current != NULL; current = (con == NULL) ? TAILQ_NEXT(current, all_cons) : NULL) {
             if (TAILQ_EMPTY(&(current->marks_head)))
                 continue;
 
             mark_t *mark;
             while (!TAILQ_EMPTY(&(current->marks_head))) {
                 mark = TAILQ_FIRST(&(current->marks_head));
+                hashmap_remove(mark_index, mark->name, strlen(mark->name));
                 FREE(mark->name);
                 TAILQ_REMOVE(&(current->marks_head), mark, marks);
-                FREE(mark);
+                slab_free(mark_slab, mark);
 
                 ipc_send_window_event("mark", current);
             }
 
             current->mark_changed = true;
+            con_set_dirty(current);
         }
     } else {
         DLOG("Removing mark \"%s\".\n", name);
@@ -768,15 +1149,17 @@ void con_unmark(Con *con, const char *name) {
 
         DLOG("Found mark on con = %p. Removing it now.\n", current);
         current->mark_changed = true;
+        con_set_dirty(current);
 
         mark_t *mark;
         TAILQ_FOREACH(mark, &(current->marks_head), marks) {
             if (strcmp(mark->name, name) != 0)
                 continue;
 
+            hashmap_remove(mark_index, mark->name, strlen(mark->name));
             FREE(mark->name);
             TAILQ_REMOVE(&(current->marks_head), mark, marks);
-            FREE(mark);
+            slab_free(mark_slab, mark);
 
             ipc_send_window_event("mark", current);
             break;
@@ -785,43 +1168,246 @@ void con_unmark(Con *con, const char *name) {
 }
 
 /*
- * Returns the first container below 'con' which wants to swallow this window
- * TODO: priority
+ * Returns the bucket of the swallow index which holds the given criteria. If
+ * create is false and the bucket does not exist yet, NULL is returned.
  *
  */
-Con *con_for_window(Con *con, i3Window *window, Match **store_match) {
+static struct swallow_bucket *swallow_bucket_for(Match *match, bool create) {
+    hashmap_t **map;
+    const void *key;
+    size_t keylen;
+    if (match->id != XCB_NONE) {
+        map = &swallow_by_id;
+        key = &(match->id);
+        keylen = sizeof(xcb_window_t);
+    } else if (match->class != NULL && match->class->literal != NULL) {
+        map = &swallow_by_class;
+        key = &(match->class->literal);
+        keylen = sizeof(const char *);
+    } else if (match->instance != NULL && match->instance->literal != NULL) {
+        map = &swallow_by_instance;
+        key = &(match->instance->literal);
+        keylen = sizeof(const char *);
+    } else {
+        return &swallow_unindexed;
+    }
+
+    if (*map == NULL) {
+        if (!create) {
+            return NULL;
+        }
+        *map = hashmap_new();
+    }
+    struct swallow_bucket *bucket = hashmap_get(*map, key, keylen);
+    if (bucket == NULL && create) {
+        bucket = scalloc(1, sizeof(struct swallow_bucket));
+        hashmap_set(*map, key, keylen, bucket);
+    }
+    return bucket;
+}
+
+/*
+ * Adds the given swallow criteria of con (which must already be in
+ * con->swallow_head) to the index used by con_for_window(). The criteria must
+ * not be changed until they are removed with con_swallow_index_remove().
+ *
+ */
+void con_swallow_index_add(Con *con, Match *match) {
+    struct swallow_bucket *bucket = swallow_bucket_for(match, true);
+    if (bucket->num_entries == bucket->entries_size) {
+        bucket->entries_size = (bucket->entries_size == 0 ? 4 : bucket->entries_size * 2);
+        bucket->entries = srealloc(bucket->entries, bucket->entries_size * sizeof(struct swallow_entry));
+    }
+    bucket->entries[bucket->num_entries++] = (struct swallow_entry){.con = con, .match = match};
+}
+
+/*
+ * Removes the given swallow criteria from the index used by con_for_window().
+ * Criteria which were never added are ignored.
+ *
+ */
+void con_swallow_index_remove(Con *con, Match *match) {
+    struct swallow_bucket *bucket = swallow_bucket_for(match, false);
+    if (bucket == NULL) {
+        return;
+    }
+    for (int i = 0; i < bucket->num_entries; i++) {
+        if (bucket->entries[i].match != match) {
+            continue;
+        }
+        assert(bucket->entries[i].con == con);
+        /* The order within a bucket does not matter, see
+         * swallow_checked_before(). */
+        bucket->entries[i] = bucket->entries[--bucket->num_entries];
+        return;
+    }
+}
+
+/*
+ * Removes and frees all swallow criteria of the given container.
+ *
+ */
+void con_clear_swallows(Con *con) {
+    while (!TAILQ_EMPTY(&(con->swallow_head))) {
+        Match *match = TAILQ_FIRST(&(con->swallow_head));
+        con_swallow_index_remove(con, match);
+        TAILQ_REMOVE(&(con->swallow_head), match, matches);
+        match_free(match);
+        free(match);
+    }
+}
+
+/*
+ * Returns the position of the container among the children of its parent, in
+ * the order in which they are searched: tiling children first, then floating
+ * children.
+ *
+ */
+static int con_search_position(Con *con) {
+    int position = 0;
     Con *child;
-    Match *match;
-    //DLOG("searching con for window %p starting at con %p\n", window, con);
-    //DLOG("class == %s\n", window->class_class);
+    TAILQ_FOREACH(child, &(con->parent->nodes_head), nodes) {
+        if (child == con) {
+            return position;
+        }
+        position++;
+    }
+    TAILQ_FOREACH(child, &(con->parent->floating_head), floating_windows) {
+        if (child == con) {
+            return position;
+        }
+        position++;
+    }
+    return position;
+}
 
-    TAILQ_FOREACH(child, &(con->nodes_head), nodes) {
-        TAILQ_FOREACH(match, &(child->swallow_head), matches) {
-            if (!match_matches_window(match, window))
-                continue;
-            if (store_match != NULL)
-                *store_match = match;
-            return child;
+static int con_depth(Con *con) {
+    int depth = 0;
+    for (; con->parent != NULL; con = con->parent) {
+        depth++;
+    }
+    return depth;
+}
+
+/*
+ * Returns true if the criteria a_match of container a come before the
+ * criteria b_match of container b in a preorder walk of the tree: a container
+ * is checked before its children, the children in the order of
+ * con_search_position() and the criteria of one container in the order of its
+ * swallow_head.
+ *
+ */
+static bool swallow_checked_before(Con *a, Match *a_match, Con *b, Match *b_match) {
+    if (a == b) {
+        Match *match;
+        TAILQ_FOREACH(match, &(a->swallow_head), matches) {
+            if (match == a_match) {
+                return true;
+            }
+            if (match == b_match) {
+                return false;
+            }
         }
-        Con *result = con_for_window(child, window, store_match);
-        if (result != NULL)
-            return result;
+        return false;
     }
 
-    TAILQ_FOREACH(child, &(con->floating_head), floating_windows) {
-        TAILQ_FOREACH(match, &(child->swallow_head), matches) {
-            if (!match_matches_window(match, window))
-                continue;
-            if (store_match != NULL)
-                *store_match = match;
-            return child;
+    int a_depth = con_depth(a);
+    int b_depth = con_depth(b);
+    for (; a_depth > b_depth; a_depth--) {
+        a = a->parent;
+        if (a == b) {
+            /* b is an ancestor of a */
+            return false;
         }
-        Con *result = con_for_window(child, window, store_match);
-        if (result != NULL)
-            return result;
     }
+    for (; b_depth > a_depth; b_depth--) {
+        b = b->parent;
+        if (b == a) {
+            /* a is an ancestor of b */
+            return true;
+        }
+    }
+    while (a->parent != b->parent) {
+        a = a->parent;
+        b = b->parent;
+    }
+    return con_search_position(a) < con_search_position(b);
+}
 
-    return NULL;
+/*
+ * Checks the criteria of the given bucket and updates *best (and its criteria,
+ * *best_match) if any criteria below con which match the window are checked
+ * earlier than the current result.
+ *
+ */
+static void swallow_bucket_search(struct swallow_bucket *bucket, Con *con, i3Window *window,
+                                  Con **best, Match **best_match) {
+    if (bucket == NULL) {
+        return;
+    }
+    for (int i = 0; i < bucket->num_entries; i++) {
+        struct swallow_entry *entry = &(bucket->entries[i]);
+        if (!con_has_parent(entry->con, con)) {
+            continue;
+        }
+        if (*best != NULL &&
+            !swallow_checked_before(entry->con, entry->match, *best, *best_match)) {
+            continue;
+        }
+        if (!match_matches_window(entry->match, window)) {
+            continue;
+        }
+        *best = entry->con;
+        *best_match = entry->match;
+    }
+}
+
+/*
+ * Searches the buckets of the given map for an interned window property. Since
+ * $ also matches before a trailing newline, a property like "foo\n" is also
+ * matched by the literal criteria "^foo$", see regex_matches_interned().
+ *
+ */
+static void swallow_map_search(hashmap_t *map, const char *value, Con *con, i3Window *window,
+                               Con **best, Match **best_match) {
+    if (map == NULL || value == NULL) {
+        return;
+    }
+    swallow_bucket_search(hashmap_get(map, &value, sizeof(const char *)),
+                          con, window, best, best_match);
+
+    const size_t len = strlen(value);
+    if (len > 0 && value[len - 1] == '\n') {
+        const char *trimmed = intern_string(value, len - 1);
+        swallow_bucket_search(hashmap_get(map, &trimmed, sizeof(const char *)),
+                              con, window, best, best_match);
+        intern_release(trimmed);
+    }
+}
+
+/*
+ * Returns the first container below 'con' which wants to swallow this window,
+ * in the order of a preorder walk of the tree (see swallow_checked_before()).
+ * Only the criteria which could match the window are checked, see
+ * swallow_bucket_for().
+ *
+ */
+Con *con_for_window(Con *con, i3Window *window, Match **store_match) {
+    Con *best = NULL;
+    Match *best_match = NULL;
+
+    if (swallow_by_id != NULL) {
+        swallow_bucket_search(hashmap_get(swallow_by_id, &(window->id), sizeof(xcb_window_t)),
+                              con, window, &best, &best_match);
+    }
+    swallow_map_search(swallow_by_class, window->class_class, con, window, &best, &best_match);
+    swallow_map_search(swallow_by_instance, window->class_instance, con, window, &best, &best_match);
+    swallow_bucket_search(&swallow_unindexed, con, window, &best, &best_match);
+
+    if (best != NULL && store_match != NULL) {
+        *store_match = best_match;
+    }
+    return best;
 }
 
 static int num_focus_heads(Con *con) {
@@ -885,11 +1471,20 @@ void set_focus_order(Con *con, Con **focus_order) {
  *
  */
 int con_num_children(Con *con) {
-    Con *child;
-    int children = 0;
+    return con->num_children;
+}
 
-    TAILQ_FOREACH(child, &(con->nodes_head), nodes)
-    children++;
+static int con_count_visible_children(Con *con) {
+    int children = 0;
+    Con *current = NULL;
+    TAILQ_FOREACH(current, &(con->nodes_head), nodes) {
+        /* Visible leaf nodes are a child. */
+        if (!con_is_hidden(current) && con_is_leaf(current))
+            children++;
+        /* All other containers need to be recursed. */
+        else
+            children += con_num_visible_children(current);
+    }
 
     return children;
 }
@@ -903,18 +1498,16 @@ int con_num_visible_children(Con *con) {
     if (con == NULL)
         return 0;
 
-    int children = 0;
-    Con *current = NULL;
-    TAILQ_FOREACH(current, &(con->nodes_head), nodes) {
-        /* Visible leaf nodes are a child. */
-        if (!con_is_hidden(current) && con_is_leaf(current))
-            children++;
-        /* All other containers need to be recursed. */
-        else
-            children += con_num_visible_children(current);
+    /* With hide_edge_borders smart, this is asked for the workspace of every
+     * container that is rendered. */
+    if (cache_depth > 0) {
+        if (!con_cache_has(con, CON_CACHED_NUM_VISIBLE_CHILDREN)) {
+            con->cached_num_visible_children = con_count_visible_children(con);
+            con->cache_fields |= CON_CACHED_NUM_VISIBLE_CHILDREN;
+        }
+        return con->cached_num_visible_children;
     }
-
-    return children;
+    return con_count_visible_children(con);
 }
 
 /*
@@ -1111,6 +1704,68 @@ void con_disable_fullscreen(Con *con) {
     con_set_fullscreen_mode(con, CF_NONE);
 }
 
+/* Whether a batch of moves is in progress (see con_move_begin()), the moved
+ * containers whose window::move events are deferred until it ends, and
+ * whether _NET_WM_DESKTOP needs to be updated then. */
+static bool move_batch = false;
+static Con **moved_cons = NULL;
+static int num_moved_cons = 0;
+static int moved_cons_size = 0;
+
+/*
+ * Starts a batch of moves: until con_move_end() is called, moving containers
+ * (e.g. all windows matched by the criteria of a 'move' command) neither sends
+ * window::move events nor updates _NET_WM_DESKTOP of all windows.
+ *
+ */
+void con_move_begin(void) {
+    move_batch = true;
+}
+
+/*
+ * Ends a batch of moves: updates _NET_WM_DESKTOP once and sends the
+ * window::move events of the containers which still exist.
+ *
+ */
+void con_move_end(void) {
+    if (!move_batch)
+        return;
+    move_batch = false;
+
+    if (num_moved_cons == 0)
+        return;
+
+    ewmh_update_wm_desktop();
+    for (int i = 0; i < num_moved_cons; i++) {
+        if (con_exists(moved_cons[i]))
+            ipc_send_window_event("move", moved_cons[i]);
+    }
+    num_moved_cons = 0;
+}
+
+/*
+ * Sends the window::move event and updates _NET_WM_DESKTOP after the given
+ * container was moved, or defers both until the batch of moves ends.
+ *
+ */
+static void con_moved(Con *con) {
+    if (!move_batch) {
+        ipc_send_window_event("move", con);
+        ewmh_update_wm_desktop();
+        return;
+    }
+
+    for (int i = 0; i < num_moved_cons; i++) {
+        if (moved_cons[i] == con)
+            return;
+    }
+    if (num_moved_cons == moved_cons_size) {
+        moved_cons_size = (moved_cons_size == 0 ? 16 : moved_cons_size * 2);
+        moved_cons = srealloc(moved_cons, moved_cons_size * sizeof(Con *));
+    }
+    moved_cons[num_moved_cons++] = con;
+}
+
 static bool _con_move_to_con(Con *con, Con *target, bool behind_focused, bool fix_coordinates, bool dont_warp, bool ignore_focus, bool fix_percentage) {
     Con *orig_target = target;
 
@@ -1279,11 +1934,11 @@ static bool _con_move_to_con(Con *con, Con *target, bool behind_focused, bool fi
 
     /* Ensure the container will be redrawn. */
     FREE(con->deco_render_params);
+    con_set_dirty(con);
 
     CALL(parent, on_remove_child);
 
-    ipc_send_window_event("move", con);
-    ewmh_update_wm_desktop();
+    con_moved(con);
     return true;
 }
 
@@ -1472,6 +2127,18 @@ Con *con_next_focused(Con *con) {
  *
  */
 Con *con_descend_focused(Con *con) {
+    if (cache_depth > 0) {
+        if (!con_cache_has(con, CON_CACHED_DESCEND_FOCUSED)) {
+            if (con == focused || TAILQ_EMPTY(&(con->focus_head))) {
+                con->cached_descend_focused = con;
+            } else {
+                con->cached_descend_focused = con_descend_focused(TAILQ_FIRST(&(con->focus_head)));
+            }
+            con->cache_fields |= CON_CACHED_DESCEND_FOCUSED;
+        }
+        return con->cached_descend_focused;
+    }
+
     Con *next = con;
     while (next != focused && !TAILQ_EMPTY(&(next->focus_head)))
         next = TAILQ_FIRST(&(next->focus_head));
@@ -1779,8 +2446,9 @@ void con_set_layout(Con *con, layout_t layout) {
             DLOG("Attaching new split to ws\n");
             con_attach(new, con, false);
 
-            tree_flatten(croot);
+            tree_flatten_around(new);
         }
+        con_invalidate_tree_representation(con);
         con_force_split_parents_redraw(con);
         return;
     }
@@ -1798,6 +2466,7 @@ void con_set_layout(Con *con, layout_t layout) {
     } else {
         con->layout = layout;
     }
+    con_invalidate_tree_representation(con);
     con_force_split_parents_redraw(con);
 }
 
@@ -1918,21 +2587,25 @@ static void con_on_remove_child(Con *con) {
     if (con->type == CT_WORKSPACE) {
         if (TAILQ_EMPTY(&(con->focus_head)) && !workspace_is_visible(con)) {
             LOG("Closing old workspace (%p / %s), it is empty\n", con, con->name);
-            yajl_gen gen = ipc_marshal_workspace_event("empty", con, NULL);
+            /* The event has to be marshalled before the workspace is freed. */
+            yajl_gen gen = NULL;
+            struct ipc_event_info info;
+            ipc_event_info_init(&info, "empty", con);
+            if (ipc_event_has_recipients(I3_IPC_EVENT_WORKSPACE, &info))
+                gen = ipc_marshal_workspace_event("empty", con, NULL);
             tree_close_internal(con, DONT_KILL_WINDOW, false);
 
-            const unsigned char *payload;
-            ylength length;
-            y(get_buf, &payload, &length);
-            ipc_send_event("workspace", I3_IPC_EVENT_WORKSPACE, (const char *)payload);
-
-            y(free);
+            if (gen != NULL) {
+                ipc_send_event_gen(I3_IPC_EVENT_WORKSPACE, gen, &info);
+                ipc_gen_put(gen);
+            }
+            ipc_event_info_free(&info);
         }
         return;
     }
 
     con_force_split_parents_redraw(con);
-    con->urgent = con_has_urgent_child(con);
+    con_set_urgent_flag(con, con_has_urgent_child(con));
     con_update_parents_urgency(con);
 
     /* TODO: check if this container would swallow any other client and
@@ -2065,19 +2738,74 @@ bool con_fullscreen_permits_focusing(Con *con) {
  *
  */
 bool con_has_urgent_child(Con *con) {
-    Con *child;
-
     if (con_is_leaf(con))
         return con->urgent;
 
-    /* We are not interested in floating windows since they can only be
-     * attached to a workspace → nodes_head instead of focus_head */
-    TAILQ_FOREACH(child, &(con->nodes_head), nodes) {
-        if (con_has_urgent_child(child))
-            return true;
-    }
+    return (con->urgent_descendants > 0);
+}
 
-    return false;
+/*
+ * Adds delta to the urgent_descendants counter of every ancestor of con which
+ * accounts for it. The walk ends at the workspace (which is never counted in
+ * its parent) or at the first container which is not linked into the tree.
+ *
+ */
+static void con_propagate_urgent_descendants(Con *con, int delta) {
+    for (Con *current = con; delta != 0 && current->urgency_counted; current = current->parent)
+        current->parent->urgent_descendants += delta;
+}
+
+static int con_urgency_contribution(Con *con) {
+    return (con->urgent ? 1 : 0) + con->urgent_descendants;
+}
+
+/*
+ * Sets the urgent flag of the given container (without any of the side effects
+ * of con_set_urgency()) and updates the urgent_descendants counters of its
+ * ancestors.
+ *
+ */
+void con_set_urgent_flag(Con *con, bool urgent) {
+    if (con->urgent == urgent)
+        return;
+
+    con->urgent = urgent;
+    con_propagate_urgent_descendants(con, urgent ? 1 : -1);
+}
+
+/*
+ * Accounts for the urgency of con and its descendants in the urgent_descendants
+ * counters of its parent chain. con_attach() does this automatically, so this
+ * only needs to be called by code which links a container into the tree by
+ * hand (TAILQ_INSERT_* and setting ->parent).
+ *
+ */
+void con_count_urgency(Con *con) {
+    if (con->urgency_counted || con->parent == NULL)
+        return;
+
+    /* Urgency is only tracked below the workspace level, just like the
+     * urgent flags of parent containers (see con_update_parents_urgency). */
+    if ((con->type != CT_CON && con->type != CT_FLOATING_CON) ||
+        con->parent->type == CT_OUTPUT ||
+        con->parent->type == CT_DOCKAREA ||
+        con->parent->type == CT_ROOT)
+        return;
+
+    con->urgency_counted = true;
+    con_propagate_urgent_descendants(con, con_urgency_contribution(con));
+}
+
+/*
+ * Reverts con_count_urgency(). con_detach() does this automatically.
+ *
+ */
+void con_uncount_urgency(Con *con) {
+    if (!con->urgency_counted)
+        return;
+
+    con_propagate_urgent_descendants(con, -con_urgency_contribution(con));
+    con->urgency_counted = false;
 }
 
 /*
@@ -2097,14 +2825,17 @@ void con_update_parents_urgency(Con *con) {
 
     bool new_urgency_value = con->urgent;
     while (parent && parent->type != CT_WORKSPACE && parent->type != CT_DOCKAREA) {
+        const bool old_urgent = parent->urgent;
         if (new_urgency_value) {
-            parent->urgent = true;
+            con_set_urgent_flag(parent, true);
         } else {
             /* We can only reset the urgency when the parent
              * has no other urgent children */
             if (!con_has_urgent_child(parent))
-                parent->urgent = false;
+                con_set_urgent_flag(parent, false);
         }
+        if (parent->urgent != old_urgent)
+            con_set_dirty(parent);
         parent = parent->parent;
     }
 }
@@ -2122,7 +2853,7 @@ void con_set_urgency(Con *con, bool urgent) {
     const bool old_urgent = con->urgent;
 
     if (con->urgency_timer == NULL) {
-        con->urgent = urgent;
+        con_set_urgent_flag(con, urgent);
     } else
         DLOG("Discarding urgency WM_HINT because timer is running\n");
 
@@ -2146,15 +2877,19 @@ void con_set_urgency(Con *con, bool urgent) {
 
     if (con->urgent != old_urgent) {
         LOG("Urgency flag changed to %d\n", con->urgent);
+        con_set_dirty(con);
         ipc_send_window_event("urgent", con);
     }
 }
 
 /*
- * Create a string representing the subtree under con.
+ * Returns the tree representation of the given container (see
+ * con_get_tree_representation()). The representations of split containers
+ * are cached, so that only the parts of the tree which changed since the last
+ * call have to be assembled again.
  *
  */
-char *con_get_tree_representation(Con *con) {
+static const char *con_tree_representation(Con *con) {
     /* this code works as follows:
      *  1) create a string with the layout type (D/V/H/T/S) and an opening bracket
      *  2) append the tree representation of the children to the string
@@ -2167,94 +2902,319 @@ char *con_get_tree_representation(Con *con) {
     /* end of recursion */
     if (con_is_leaf(con)) {
         if (!con->window)
-            return sstrdup("nowin");
+            return "nowin";
 
         if (!con->window->class_instance)
-            return sstrdup("noinstance");
+            return "noinstance";
 
-        return sstrdup(con->window->class_instance);
+        return con->window->class_instance;
     }
 
-    char *buf;
-    /* 1) add the Layout type to buf */
+    if (con->tree_representation != NULL)
+        return con->tree_representation;
+
+    /* 1) get the Layout type */
+    char type;
     if (con->layout == L_DEFAULT)
-        buf = sstrdup("D[");
+        type = 'D';
     else if (con->layout == L_SPLITV)
-        buf = sstrdup("V[");
+        type = 'V';
     else if (con->layout == L_SPLITH)
-        buf = sstrdup("H[");
+        type = 'H';
     else if (con->layout == L_TABBED)
-        buf = sstrdup("T[");
+        type = 'T';
     else if (con->layout == L_STACKED)
-        buf = sstrdup("S[");
+        type = 'S';
     else {
         ELOG("BUG: Code not updated to account for new layout type\n");
         assert(false);
     }
 
-    /* 2) append representation of children */
+    /* 2) measure the representation of children, so that the whole string
+     * can be assembled in one allocation */
     Con *child;
+    size_t len = strlen("X[]");
     TAILQ_FOREACH(child, &(con->nodes_head), nodes) {
-        char *child_txt = con_get_tree_representation(child);
+        if (child != TAILQ_FIRST(&(con->nodes_head)))
+            len++;
+        len += strlen(con_tree_representation(child));
+    }
 
-        char *tmp_buf;
-        sasprintf(&tmp_buf, "%s%s%s", buf,
-                  (TAILQ_FIRST(&(con->nodes_head)) == child ? "" : " "), child_txt);
-        free(buf);
-        buf = tmp_buf;
-        free(child_txt);
+    char *buf = smalloc(len + 1);
+    char *walk = buf;
+    *walk++ = type;
+    *walk++ = '[';
+    TAILQ_FOREACH(child, &(con->nodes_head), nodes) {
+        if (child != TAILQ_FIRST(&(con->nodes_head)))
+            *walk++ = ' ';
+        const char *child_txt = con_tree_representation(child);
+        const size_t child_len = strlen(child_txt);
+        memcpy(walk, child_txt, child_len);
+        walk += child_len;
     }
 
     /* 3) close the brackets */
-    char *complete_buf;
-    sasprintf(&complete_buf, "%s]", buf);
-    free(buf);
+    *walk++ = ']';
+    *walk = '\0';
+
+    con->tree_representation = buf;
+    return buf;
+}
+
+/*
+ * Create a string representing the subtree under con.
+ *
+ */
+char *con_get_tree_representation(Con *con) {
+    return sstrdup(con_tree_representation(con));
+}
+
+/*
+ * Drops the cached tree representation of the given container and of all of
+ * its parents, which contain it. Needs to be called whenever the layout,
+ * window class or children of a container change.
+ *
+ */
+void con_invalidate_tree_representation(Con *con) {
+    /* The children (or the layout) changed, so the positions of their
+     * decorations are unknown until the next render. */
+    if (con != NULL)
+        con->num_deco_slots = 0;
+
+    for (; con != NULL; con = con->parent) {
+        FREE(con->tree_representation);
+    }
+}
+
+/* The placeholders which can be used in a title_format. */
+static const struct {
+    const char *name;
+    int type;
+} title_placeholders[] = {
+    {"%title", TT_TITLE},
+    {"%class", TT_CLASS},
+    {"%instance", TT_INSTANCE}};
+
+static void title_template_add(struct title_template *template, int type, const char *literal, size_t len) {
+    struct title_template_segment *segment = &(template->segments[template->num_segments++]);
+    segment->type = type;
+    if (type == TT_LITERAL) {
+        segment->literal = sstrndup(literal, len);
+        segment->literal_len = len;
+    }
+}
+
+/*
+ * Splits the given format into literal text and placeholders. Just like
+ * format_placeholders(), a '%' which does not start a placeholder is literal
+ * text.
+ *
+ */
+static struct title_template *title_template_compile(const char *format) {
+    struct title_template *template = scalloc(1, sizeof(struct title_template));
 
-    return complete_buf;
+    /* Every placeholder adds at most two segments. */
+    int max_segments = 1;
+    for (const char *walk = format; *walk != '\0'; walk++) {
+        if (*walk == '%')
+            max_segments += 2;
+    }
+    template->segments = scalloc(max_segments, sizeof(struct title_template_segment));
+
+    const char *literal = format;
+    for (const char *walk = format; *walk != '\0'; walk++) {
+        if (*walk != '%')
+            continue;
+
+        for (size_t i = 0; i < sizeof(title_placeholders) / sizeof(title_placeholders[0]); i++) {
+            const size_t len = strlen(title_placeholders[i].name);
+            if (strncmp(walk, title_placeholders[i].name, len) != 0)
+                continue;
+
+            if (walk > literal)
+                title_template_add(template, TT_LITERAL, literal, walk - literal);
+            title_template_add(template, title_placeholders[i].type, NULL, 0);
+            walk += len - 1;
+            literal = walk + 1;
+            break;
+        }
+    }
+    if (*literal != '\0')
+        title_template_add(template, TT_LITERAL, literal, strlen(literal));
+
+    return template;
+}
+
+static void title_template_free(struct title_template *template) {
+    if (template == NULL)
+        return;
+
+    for (int i = 0; i < template->num_segments; i++) {
+        FREE(template->segments[i].literal);
+    }
+    FREE(template->segments);
+    I3STRING_FREE(template->expanded);
+    free(template);
+}
+
+/*
+ * Sets the title format of the given container (NULL removes it) and compiles
+ * it, so that con_parse_title_format() does not need to parse it again.
+ *
+ */
+void con_set_title_format(Con *con, const char *format) {
+    FREE(con->title_format);
+    title_template_free(con->title_template);
+    con->title_template = NULL;
+
+    if (format == NULL)
+        return;
+
+    con->title_format = sstrdup(format);
+    con->title_template = title_template_compile(format);
+}
+
+/*
+ * Sets the sticky group of the given container (NULL removes it) and keeps the
+ * index of group members up to date.
+ *
+ */
+void con_set_sticky_group(Con *con, const char *sticky_group) {
+    if (con->sticky_group != NULL) {
+        struct sticky_group *group = hashmap_get(sticky_groups, con->sticky_group, strlen(con->sticky_group));
+        for (int i = 0; i < group->num_members; i++) {
+            if (group->members[i] != con)
+                continue;
+            memmove(&(group->members[i]), &(group->members[i + 1]),
+                    (group->num_members - i - 1) * sizeof(Con *));
+            group->num_members--;
+            break;
+        }
+        if (group->num_members == 0) {
+            hashmap_remove(sticky_groups, con->sticky_group, strlen(con->sticky_group));
+            free(group->members);
+            free(group);
+        }
+        FREE(con->sticky_group);
+    }
+
+    if (sticky_group == NULL)
+        return;
+
+    if (sticky_groups == NULL)
+        sticky_groups = hashmap_new();
+    struct sticky_group *group = hashmap_get(sticky_groups, sticky_group, strlen(sticky_group));
+    if (group == NULL) {
+        group = scalloc(1, sizeof(struct sticky_group));
+        hashmap_set(sticky_groups, sticky_group, strlen(sticky_group), group);
+    }
+    if (group->num_members == group->members_size) {
+        group->members_size = (group->members_size == 0 ? 4 : group->members_size * 2);
+        group->members = srealloc(group->members, group->members_size * sizeof(Con *));
+    }
+    group->members[group->num_members++] = con;
+    con->sticky_group = sstrdup(sticky_group);
+}
+
+struct sticky_foreach_data {
+    sticky_group_cb_t cb;
+    void *userdata;
+};
+
+static void sticky_group_foreach_cb(const void *key, size_t keylen, void *value, void *userdata) {
+    struct sticky_group *group = value;
+    struct sticky_foreach_data *data = userdata;
+    data->cb(group->members, group->num_members, data->userdata);
 }
 
 /*
- * Returns the container's title considering the current title format.
+ * Calls cb with the members of each sticky group. The callback must not change
+ * any sticky group.
+ *
+ */
+void con_foreach_sticky_group(sticky_group_cb_t cb, void *userdata) {
+    if (sticky_groups == NULL || hashmap_count(sticky_groups) == 0)
+        return;
+
+    struct sticky_foreach_data data = {
+        .cb = cb,
+        .userdata = userdata,
+    };
+    hashmap_foreach(sticky_groups, sticky_group_foreach_cb, &data);
+}
+
+/*
+ * Returns the window title considering the current title format. The result
+ * belongs to the container and is cached until the window's title, class or
+ * instance changes, so it must not be freed.
  *
  */
 i3String *con_parse_title_format(Con *con) {
     assert(con->title_format != NULL);
+    assert(con->title_template != NULL);
 
+    struct title_template *template = con->title_template;
     i3Window *win = con->window;
 
     /* We need to ensure that we only escape the window title if pango
      * is used by the current font. */
     const bool pango_markup = font_is_pango();
 
-    char *title;
-    char *class;
-    char *instance;
+    /* The generations are unique among all windows, so they tell whether
+     * the fields changed. Windowless containers use their tree
+     * representation, which is not tracked, so they are expanded every
+     * time. */
+    if (template->expanded != NULL &&
+        win != NULL &&
+        template->window_id == win->id &&
+        template->name_generation == win->name_generation &&
+        template->class_generation == win->class_generation &&
+        template->pango_markup == pango_markup) {
+        return template->expanded;
+    }
+
+    char *values[TT_INSTANCE + 1] = {NULL};
     if (win == NULL) {
-        title = pango_escape_markup(con_get_tree_representation(con));
-        class = sstrdup("i3-frame");
-        instance = sstrdup("i3-frame");
+        values[TT_TITLE] = pango_escape_markup(con_get_tree_representation(con));
+        values[TT_CLASS] = sstrdup("i3-frame");
+        values[TT_INSTANCE] = sstrdup("i3-frame");
     } else {
-        title = pango_escape_markup(sstrdup((win->name == NULL) ? "" : i3string_as_utf8(win->name)));
-        class = pango_escape_markup(sstrdup((win->class_class == NULL) ? "" : win->class_class));
-        instance = pango_escape_markup(sstrdup((win->class_instance == NULL) ? "" : win->class_instance));
+        values[TT_TITLE] = pango_escape_markup(sstrdup((win->name == NULL) ? "" : i3string_as_utf8(win->name)));
+        values[TT_CLASS] = pango_escape_markup(sstrdup((win->class_class == NULL) ? "" : win->class_class));
+        values[TT_INSTANCE] = pango_escape_markup(sstrdup((win->class_instance == NULL) ? "" : win->class_instance));
     }
 
-    placeholder_t placeholders[] = {
-        {.name = "%title", .value = title},
-        {.name = "%class", .value = class},
-        {.name = "%instance", .value = instance}};
-    const size_t num = sizeof(placeholders) / sizeof(placeholder_t);
+    size_t len = 0;
+    for (int i = 0; i < template->num_segments; i++) {
+        const struct title_template_segment *segment = &(template->segments[i]);
+        len += (segment->type == TT_LITERAL ? segment->literal_len : strlen(values[segment->type]));
+    }
 
-    char *formatted_str = format_placeholders(con->title_format, &placeholders[0], num);
-    i3String *formatted = i3string_from_utf8(formatted_str);
-    i3string_set_markup(formatted, pango_markup);
-    FREE(formatted_str);
+    char *formatted_str = smalloc(len + 1);
+    char *outwalk = formatted_str;
+    for (int i = 0; i < template->num_segments; i++) {
+        const struct title_template_segment *segment = &(template->segments[i]);
+        const char *value = (segment->type == TT_LITERAL ? segment->literal : values[segment->type]);
+        const size_t value_len = (segment->type == TT_LITERAL ? segment->literal_len : strlen(value));
+        memcpy(outwalk, value, value_len);
+        outwalk += value_len;
+    }
+    *outwalk = '\0';
 
-    for (size_t i = 0; i < num; i++) {
-        FREE(placeholders[i].value);
+    I3STRING_FREE(template->expanded);
+    template->expanded = i3string_from_utf8(formatted_str);
+    i3string_set_markup(template->expanded, pango_markup);
+    template->window_id = (win == NULL ? XCB_NONE : win->id);
+    template->name_generation = (win == NULL ? 0 : win->name_generation);
+    template->class_generation = (win == NULL ? 0 : win->class_generation);
+    template->pango_markup = pango_markup;
+    free(formatted_str);
+
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        FREE(values[i]);
     }
 
-    return formatted;
+    return template->expanded;
 }
 
 /*
@@ -2327,6 +3287,8 @@ bool con_swap(Con *first, Con *second) {
     SWAP_CONS_IN_TREE(nodes_head, nodes);
     SWAP_CONS_IN_TREE(focus_head, focused);
     SWAP(first->parent, second->parent, Con *);
+    con_invalidate_tree_representation(first->parent);
+    con_invalidate_tree_representation(second->parent);
 
     /* Floating nodes are children of CT_FLOATING_CONs, they are listed in
      * nodes_head and focus_head like all other containers. Thus, we don't need
@@ -2394,30 +3356,37 @@ uint32_t con_rect_size_in_orientation(Con *con) {
 void con_merge_into(Con *old, Con *new) {
     new->window = old->window;
     old->window = NULL;
+    con_invalidate_tree_representation(old);
+    con_invalidate_tree_representation(new);
+    con_index_add(new);
 
     if (old->title_format) {
-        FREE(new->title_format);
+        con_set_title_format(new, NULL);
         new->title_format = old->title_format;
+        new->title_template = old->title_template;
         old->title_format = NULL;
+        old->title_template = NULL;
     }
 
     if (old->sticky_group) {
-        FREE(new->sticky_group);
-        new->sticky_group = old->sticky_group;
-        old->sticky_group = NULL;
+        con_set_sticky_group(new, old->sticky_group);
+        con_set_sticky_group(old, NULL);
     }
 
-    new->sticky = old->sticky;
+    con_set_sticky(new, old->sticky);
 
     con_set_urgency(new, old->urgent);
 
-    mark_t *mark;
-    TAILQ_FOREACH(mark, &(old->marks_head), marks) {
+    new->mark_changed = (TAILQ_FIRST(&(old->marks_head)) != NULL);
+    if (new->mark_changed)
+        con_set_dirty(new);
+    while (!TAILQ_EMPTY(&(old->marks_head))) {
+        mark_t *mark = TAILQ_FIRST(&(old->marks_head));
+        TAILQ_REMOVE(&(old->marks_head), mark, marks);
         TAILQ_INSERT_TAIL(&(new->marks_head), mark, marks);
+        hashmap_set(mark_index, mark->name, strlen(mark->name), new);
         ipc_send_window_event("mark", new);
     }
-    new->mark_changed = (TAILQ_FIRST(&(old->marks_head)) != NULL);
-    TAILQ_INIT(&(old->marks_head));
 
     tree_close_internal(old, DONT_KILL_WINDOW, false);
 }
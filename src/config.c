@@ -18,6 +18,45 @@ Config config;
 struct modes_head modes;
 struct barconfig_head barconfigs = TAILQ_HEAD_INITIALIZER(barconfigs);
 
+/* The number of fonts which are kept loaded. */
+#define FONT_CACHE_SIZE 4
+
+/* The fonts loaded in this session. A font stays loaded after it is not used
+ * anymore, so that reloads (or a font directive which is overridden later in
+ * the configuration) do not need to load it again. config.font is a copy of
+ * one of these. */
+static struct font_cache_entry {
+    /* The pattern as given in the configuration. The pattern of font differs
+     * if a fallback had to be loaded. */
+    char *pattern;
+    i3Font font;
+    /* When the entry was last used (see font_cache_clock), 0 if the entry is
+     * free. */
+    uint64_t last_used;
+} font_cache[FONT_CACHE_SIZE];
+static uint64_t font_cache_clock = 0;
+
+/* The entry config.font was copied from. */
+static struct font_cache_entry *current_font = NULL;
+
+/* What the previous configuration looked like while it is being reloaded, so
+ * that the reload only applies what actually changed. */
+static struct {
+    /* The font of the previous configuration (NULL if it was evicted from the
+     * cache since). */
+    struct font_cache_entry *font;
+
+    /* Everything else which affects how decorations are drawn. */
+    struct config_client client;
+    struct config_bar bar;
+    bool show_marks;
+    int title_align;
+    hide_edge_borders_mode_t hide_edge_borders;
+
+    /* Maps bar IDs to their serialized configuration. */
+    hashmap_t *barconfigs;
+} previous;
+
 /*
  * Ungrabs all keys, to be called before re-grabbing the keys because of a
  * mapping_notify event or a configuration file reload
@@ -25,18 +64,142 @@ struct barconfig_head barconfigs = TAILQ_HEAD_INITIALIZER(barconfigs);
  */
 void ungrab_all_keys(xcb_connection_t *conn) {
     DLOG("Ungrabbing all keys\n");
+    const stats_x_subsystem_t x_subsystem = stats_x_enter(STATS_X_SUBSYSTEM_BINDINGS);
     xcb_ungrab_key(conn, XCB_GRAB_ANY, root, XCB_BUTTON_MASK_ANY);
+    stats_x_leave(x_subsystem);
+    key_grabs_reset();
+}
+
+static void free_barconfig_snapshot(const void *key, size_t keylen, void *value, void *userdata) {
+    free(value);
 }
 
 /*
  * Sends the current bar configuration as an event to all barconfig_update listeners.
  *
+ * After a reload, only bars whose configuration changed are notified.
+ *
  */
 void update_barconfig(void) {
     Barconfig *current;
     TAILQ_FOREACH(current, &barconfigs, configs) {
+        if (previous.barconfigs != NULL) {
+            char *before = hashmap_get(previous.barconfigs, current->id, strlen(current->id));
+            char *after = ipc_bar_config_json(current);
+            const bool unchanged = (before != NULL && strcmp(before, after) == 0);
+            free(after);
+            if (unchanged) {
+                DLOG("Configuration of bar \"%s\" did not change\n", current->id);
+                continue;
+            }
+        }
         ipc_send_barconfig_update_event(current);
     }
+
+    if (previous.barconfigs != NULL) {
+        hashmap_foreach(previous.barconfigs, free_barconfig_snapshot, NULL);
+        hashmap_free(previous.barconfigs);
+        previous.barconfigs = NULL;
+    }
+}
+
+/*
+ * Returns an entry of the font cache for loading a new font. Evicts the least
+ * recently used font if the cache is full, but never the current one.
+ *
+ */
+static struct font_cache_entry *font_cache_get_free_entry(void) {
+    struct font_cache_entry *victim = NULL;
+    for (int i = 0; i < FONT_CACHE_SIZE; i++) {
+        struct font_cache_entry *entry = &font_cache[i];
+        if (entry->last_used == 0)
+            return entry;
+        if (entry != current_font && (victim == NULL || entry->last_used < victim->last_used))
+            victim = entry;
+    }
+
+    DLOG("Freeing font \"%s\", it was not used recently\n", victim->pattern);
+    set_font(&(victim->font));
+    free_font();
+    FREE(victim->pattern);
+    victim->last_used = 0;
+    if (previous.font == victim)
+        previous.font = NULL;
+    return victim;
+}
+
+/*
+ * Loads the font with the given pattern into config.font. Fonts which were
+ * loaded before in this session (e.g. by the previous configuration) are
+ * reused instead of being loaded again.
+ *
+ */
+void config_load_font(const char *pattern) {
+    struct font_cache_entry *entry = NULL;
+    for (int i = 0; i < FONT_CACHE_SIZE; i++) {
+        if (font_cache[i].last_used != 0 && strcmp(font_cache[i].pattern, pattern) == 0) {
+            entry = &font_cache[i];
+            break;
+        }
+    }
+
+    if (entry != NULL) {
+        DLOG("Font \"%s\" is already loaded, reusing it\n", pattern);
+    } else {
+        /* Keep the fonts in the cache loaded, load_font() frees the font which
+         * was set last. */
+        set_font(NULL);
+        i3Font font = load_font(pattern, true);
+        if (font.type == FONT_TYPE_NONE) {
+            /* Only validating the configuration, there is no X11 connection. */
+            config.font = font;
+            current_font = NULL;
+            return;
+        }
+
+        entry = font_cache_get_free_entry();
+        entry->pattern = sstrdup(pattern);
+        entry->font = font;
+    }
+
+    entry->last_used = ++font_cache_clock;
+    current_font = entry;
+    config.font = entry->font;
+    set_font(&config.font);
+}
+
+static bool colors_equal(const color_t *a, const color_t *b) {
+    return a->red == b->red && a->green == b->green && a->blue == b->blue &&
+           a->alpha == b->alpha && a->colorpixel == b->colorpixel;
+}
+
+static bool colortriples_equal(const struct Colortriple *a, const struct Colortriple *b) {
+    return colors_equal(&(a->border), &(b->border)) &&
+           colors_equal(&(a->child_border), &(b->child_border)) &&
+           colors_equal(&(a->background), &(b->background)) &&
+           colors_equal(&(a->text), &(b->text)) &&
+           colors_equal(&(a->indicator), &(b->indicator));
+}
+
+/*
+ * Returns true if anything which decorations are drawn with changed in the
+ * reload.
+ *
+ */
+static bool decorations_changed(void) {
+    return previous.font != current_font ||
+           previous.show_marks != config.show_marks ||
+           previous.title_align != (int)config.title_align ||
+           previous.hide_edge_borders != config.hide_edge_borders ||
+           !colors_equal(&(previous.client.background), &(config.client.background)) ||
+           !colortriples_equal(&(previous.client.focused), &(config.client.focused)) ||
+           !colortriples_equal(&(previous.client.focused_inactive), &(config.client.focused_inactive)) ||
+           !colortriples_equal(&(previous.client.unfocused), &(config.client.unfocused)) ||
+           !colortriples_equal(&(previous.client.urgent), &(config.client.urgent)) ||
+           !colortriples_equal(&(previous.client.placeholder), &(config.client.placeholder)) ||
+           !colortriples_equal(&(previous.bar.focused), &(config.bar.focused)) ||
+           !colortriples_equal(&(previous.bar.unfocused), &(config.bar.unfocused)) ||
+           !colortriples_equal(&(previous.bar.urgent), &(config.bar.urgent));
 }
 
 static void free_configuration(void) {
@@ -47,10 +210,12 @@ static void free_configuration(void) {
      * after parsing the config again. See #2228. */
     switch_mode("default");
 
-    /* First ungrab the keys */
-    ungrab_all_keys(conn);
+    /* The keys and buttons stay grabbed: grab_all_keys() and
+     * regrab_all_buttons() only apply the difference once the new bindings
+     * are known. */
 
     struct Mode *mode;
+    binding_index_free();
     while (!SLIST_EMPTY(&modes)) {
         mode = SLIST_FIRST(&modes);
         FREE(mode->name);
@@ -67,12 +232,15 @@ static void free_configuration(void) {
         FREE(mode);
     }
 
+    assignment_index_free();
     while (!TAILQ_EMPTY(&assignments)) {
         struct Assignment *assign = TAILQ_FIRST(&assignments);
         if (assign->type == A_TO_WORKSPACE || assign->type == A_TO_WORKSPACE_NUMBER)
             FREE(assign->dest.workspace);
-        else if (assign->type == A_COMMAND)
+        else if (assign->type == A_COMMAND) {
             FREE(assign->dest.command);
+            command_ir_unref(assign->command_ir);
+        }
         else if (assign->type == A_TO_OUTPUT)
             FREE(assign->dest.output);
         match_free(&(assign->match));
@@ -87,11 +255,18 @@ static void free_configuration(void) {
         TAILQ_REMOVE(&ws_assignments, assign, ws_assignments);
         FREE(assign);
     }
+    ws_assignment_index_invalidate();
 
-    /* Clear bar configs */
+    /* Clear bar configs, remembering what they looked like so that only bars
+     * whose configuration changed need to be notified (see update_barconfig()). */
     Barconfig *barconfig;
+    if (previous.barconfigs == NULL)
+        previous.barconfigs = hashmap_new();
     while (!TAILQ_EMPTY(&barconfigs)) {
         barconfig = TAILQ_FIRST(&barconfigs);
+        char *json = ipc_bar_config_json(barconfig);
+        free(hashmap_remove(previous.barconfigs, barconfig->id, strlen(barconfig->id)));
+        hashmap_set(previous.barconfigs, barconfig->id, strlen(barconfig->id), json);
         FREE(barconfig->id);
         for (int c = 0; c < barconfig->num_outputs; c++)
             free(barconfig->outputs[c]);
@@ -147,12 +322,18 @@ static void free_configuration(void) {
             con->window->nr_assignments = 0;
             FREE(con->window->ran_assignments);
         }
-        /* Invalidate pixmap caches in case font or colors changed. */
-        FREE(con->deco_render_params);
     }
 
-    /* Get rid of the current font */
-    free_font();
+    /* Remember the font and the drawing parameters to find out whether the
+     * decorations need to be redrawn. */
+    previous.font = current_font;
+    if (current_font != NULL)
+        set_font(&(current_font->font));
+    previous.client = config.client;
+    previous.bar = config.bar;
+    previous.show_marks = config.show_marks;
+    previous.title_align = config.title_align;
+    previous.hide_edge_borders = config.hide_edge_borders;
 
     free(config.ipc_socket_path);
     free(config.restart_state_path);
@@ -228,6 +409,9 @@ bool load_configuration(const char *override_configpath, config_load_t load_type
 
     config.focus_wrapping = FOCUS_WRAPPING_ON;
 
+    /* One frame at 60 Hz. */
+    config.slow_frame_threshold = 0.016;
+
     FREE(current_configpath);
     current_configpath = get_config_path(override_configpath, true);
     if (current_configpath == NULL) {
@@ -237,21 +421,33 @@ bool load_configuration(const char *override_configpath, config_load_t load_type
     }
     LOG("Parsing configfile %s\n", current_configpath);
     const bool result = parse_file(current_configpath, load_type != C_VALIDATE);
+    assignment_index_rebuild();
 
     if (config.font.type == FONT_TYPE_NONE && load_type != C_VALIDATE) {
         ELOG("You did not specify required configuration option \"font\"\n");
-        config.font = load_font("fixed", true);
-        set_font(&config.font);
+        config_load_font("fixed");
     }
 
     if (load_type == C_RELOAD) {
         translate_keysyms();
         grab_all_keys(conn);
+
         regrab_all_buttons(conn);
 
-        /* Redraw the currently visible decorations on reload, so that the
-         * possibly new drawing parameters changed. */
-        x_deco_recurse(croot);
+        if (decorations_changed()) {
+            /* Invalidate pixmap caches and redraw the currently visible
+             * decorations, so that the new drawing parameters are used. */
+            Con *con;
+            TAILQ_FOREACH(con, &all_cons, all_cons) {
+                FREE(con->deco_render_params);
+                x_free_title_cache(con);
+                con->dirty = true;
+                con->child_dirty = true;
+            }
+            x_deco_recurse(croot);
+        } else {
+            DLOG("Font and colors did not change, not redrawing decorations\n");
+        }
         xcb_flush(conn);
     }
 
@@ -0,0 +1,217 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * config_cache.c: An on-disk cache of the configuration file after variables
+ *                 were replaced, enabled with --config-cache.
+ *
+ * The cache file starts with a header identifying the i3 version, a hash of
+ * the configuration file contents and the X resources which were used
+ * (set_from_resource), followed by the resulting configuration:
+ *
+ *   i3-config-cache 1 <i3 version>
+ *   hash <hex>
+ *   version <config file version>
+ *   resources <n>
+ *   <found> <name length> <value length>\n<name><value>\n   (n times)
+ *   length <n>\n<configuration>
+ *
+ */
+#include "all.h"
+
+#include <stdio.h>
+
+#define CACHE_FORMAT_VERSION 1
+
+char *config_cache_path = NULL;
+
+struct cached_resource {
+    char *name;
+    /* NULL if the resource was not set. */
+    char *value;
+};
+
+static struct cached_resource *resources;
+static int num_resources;
+
+/*
+ * 64-bit FNV-1a of the configuration file contents.
+ *
+ */
+static uint64_t hash_contents(const char *raw, size_t raw_len) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < raw_len; i++) {
+        hash ^= (unsigned char)raw[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/*
+ * Reads exactly len bytes followed by the given terminator. Returns a newly
+ * allocated, NUL-terminated string or NULL.
+ *
+ */
+static char *read_exactly(FILE *f, size_t len, int terminator) {
+    char *result = smalloc(len + 1);
+    if (fread(result, 1, len, f) != len ||
+        (terminator != EOF && fgetc(f) != terminator)) {
+        free(result);
+        return NULL;
+    }
+    result[len] = '\0';
+    return result;
+}
+
+/*
+ * Returns the cached result of replacing the variables in the given
+ * configuration file contents, or NULL if there is none. The cached result is
+ * only used if every X resource which the configuration used still has the
+ * same value, looking them up with get_resource.
+ *
+ * The caller has to free() the result.
+ *
+ */
+char *config_cache_load(const char *raw, size_t raw_len, int *version, config_cache_resource_cb get_resource) {
+    /* Without an X connection, we are only validating the configuration and
+     * cannot look up resources. */
+    if (config_cache_path == NULL || conn == NULL)
+        return NULL;
+
+    FILE *f = fopen(config_cache_path, "r");
+    if (f == NULL) {
+        DLOG("No configuration cache at %s\n", config_cache_path);
+        return NULL;
+    }
+
+    char *text = NULL;
+    char *line = NULL;
+    size_t line_size = 0;
+    char *expected;
+    sasprintf(&expected, "i3-config-cache %d %s\n", CACHE_FORMAT_VERSION, i3_version);
+    const bool same_i3 = (getline(&line, &line_size, f) != -1 && strcmp(line, expected) == 0);
+    free(expected);
+    free(line);
+    if (!same_i3) {
+        DLOG("Configuration cache was written by a different version of i3\n");
+        goto out;
+    }
+
+    unsigned long long hash;
+    int cached_version;
+    int count;
+    size_t len;
+    if (fscanf(f, "hash %llx version %d resources %d", &hash, &cached_version, &count) != 3 ||
+        fgetc(f) != '\n' ||
+        hash != hash_contents(raw, raw_len)) {
+        DLOG("Configuration file changed since it was cached\n");
+        goto out;
+    }
+
+    for (int i = 0; i < count; i++) {
+        int found;
+        size_t name_len, value_len;
+        if (fscanf(f, "%d %zu %zu", &found, &name_len, &value_len) != 3 ||
+            fgetc(f) != '\n')
+            goto out;
+        char *name = read_exactly(f, name_len, EOF);
+        char *value = (name == NULL ? NULL : read_exactly(f, value_len, '\n'));
+        if (value == NULL) {
+            free(name);
+            goto out;
+        }
+
+        char *current = get_resource(name);
+        const bool unchanged = (found ? (current != NULL && strcmp(current, value) == 0) : (current == NULL));
+        free(current);
+        if (!unchanged)
+            DLOG("X resource \"%s\" changed since the configuration was cached\n", name);
+        free(name);
+        free(value);
+        if (!unchanged)
+            goto out;
+    }
+
+    if (fscanf(f, "length %zu", &len) != 1 || fgetc(f) != '\n')
+        goto out;
+    text = read_exactly(f, len, EOF);
+    if (text != NULL) {
+        LOG("Using cached configuration from %s\n", config_cache_path);
+        *version = cached_version;
+    }
+
+out:
+    fclose(f);
+    return text;
+}
+
+/*
+ * Forgets the X resources recorded by config_cache_record_resource().
+ *
+ */
+void config_cache_reset_resources(void) {
+    for (int i = 0; i < num_resources; i++) {
+        free(resources[i].name);
+        free(resources[i].value);
+    }
+    FREE(resources);
+    num_resources = 0;
+}
+
+/*
+ * Records that the configuration used the given X resource, which had the
+ * given value (or was not set if value is NULL).
+ *
+ */
+void config_cache_record_resource(const char *name, const char *value) {
+    resources = srealloc(resources, (num_resources + 1) * sizeof(struct cached_resource));
+    resources[num_resources].name = sstrdup(name);
+    resources[num_resources].value = (value == NULL ? NULL : sstrdup(value));
+    num_resources++;
+}
+
+/*
+ * Stores the result of replacing the variables in the given configuration
+ * file contents, together with the X resources recorded since the last
+ * config_cache_reset_resources().
+ *
+ */
+void config_cache_store(const char *raw, size_t raw_len, const char *text, int version) {
+    if (config_cache_path == NULL || conn == NULL)
+        goto out;
+
+    /* Write to a temporary file first, so that an i3 starting concurrently
+     * never reads a partially written cache. */
+    char *tmp_path;
+    sasprintf(&tmp_path, "%s.%d", config_cache_path, getpid());
+    FILE *f = fopen(tmp_path, "w");
+    if (f == NULL) {
+        ELOG("Could not write configuration cache %s: %s\n", tmp_path, strerror(errno));
+        free(tmp_path);
+        goto out;
+    }
+
+    fprintf(f, "i3-config-cache %d %s\n", CACHE_FORMAT_VERSION, i3_version);
+    fprintf(f, "hash %llx\n", (unsigned long long)hash_contents(raw, raw_len));
+    fprintf(f, "version %d\n", version);
+    fprintf(f, "resources %d\n", num_resources);
+    for (int i = 0; i < num_resources; i++) {
+        const char *value = (resources[i].value == NULL ? "" : resources[i].value);
+        fprintf(f, "%d %zu %zu\n%s%s\n", resources[i].value != NULL,
+                strlen(resources[i].name), strlen(value), resources[i].name, value);
+    }
+    fprintf(f, "length %zu\n%s", strlen(text), text);
+
+    if (fclose(f) != 0 || rename(tmp_path, config_cache_path) != 0) {
+        ELOG("Could not write configuration cache %s: %s\n", config_cache_path, strerror(errno));
+        unlink(tmp_path);
+    } else {
+        DLOG("Wrote configuration cache to %s\n", config_cache_path);
+    }
+    free(tmp_path);
+
+out:
+    config_cache_reset_resources();
+}
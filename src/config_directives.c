@@ -98,8 +98,7 @@ i3_event_state_mask_t event_state_from_str(const char *str) {
 static char *font_pattern;
 
 CFGFUN(font, const char *font) {
-    config.font = load_font(font, true);
-    set_font(&config.font);
+    config_load_font(font);
 
     /* Save the font pattern for using it as bar font later on */
     FREE(font_pattern);
@@ -161,6 +160,7 @@ CFGFUN(for_window, const char *command) {
     assignment->type = A_COMMAND;
     match_copy(&(assignment->match), current_match);
     assignment->dest.command = sstrdup(command);
+    assignment->command_ir = command_ir_compile(command);
     TAILQ_INSERT_TAIL(&assignments, assignment, assignments);
 }
 
@@ -178,6 +178,20 @@ CFGFUN(floating_modifier, const char *modifiers) {
     config.floating_modifier = event_state_from_str(modifiers);
 }
 
+CFGFUN(floating_resize_preview, const char *preview) {
+    if (strcmp(preview, "outline") == 0)
+        config.floating_resize_preview = FRP_OUTLINE;
+    else
+        config.floating_resize_preview = FRP_LIVE;
+}
+
+CFGFUN(render_pacing, const char *pacing) {
+    if (strcmp(pacing, "refresh") == 0)
+        config.render_pacing = RENDER_PACING_REFRESH;
+    else
+        config.render_pacing = RENDER_PACING_NONE;
+}
+
 CFGFUN(default_orientation, const char *orientation) {
     if (strcmp(orientation, "horizontal") == 0)
         config.default_orientation = HORIZ;
@@ -250,6 +264,10 @@ CFGFUN(focus_follows_mouse, const char *value) {
     config.disable_focus_follows_mouse = !eval_boolstr(value);
 }
 
+CFGFUN(focus_follows_mouse_delay, const long delay_ms) {
+    config.focus_follows_mouse_delay = delay_ms / 1000.0;
+}
+
 CFGFUN(mouse_warping, const char *value) {
     if (strcmp(value, "none") == 0)
         config.mouse_warping = POINTER_WARPING_NONE;
@@ -292,6 +310,10 @@ CFGFUN(workspace_back_and_forth, const char *value) {
     config.workspace_auto_back_and_forth = eval_boolstr(value);
 }
 
+CFGFUN(workspace_switch_grab_server, const char *value) {
+    config.workspace_switch_grab_server = eval_boolstr(value);
+}
+
 CFGFUN(fake_outputs, const char *outputs) {
     free(config.fake_outputs);
     config.fake_outputs = sstrdup(outputs);
@@ -301,6 +323,14 @@ CFGFUN(force_display_urgency_hint, const long duration_ms) {
     config.workspace_urgency_timer = duration_ms / 1000.0;
 }
 
+CFGFUN(title_update_interval, const long interval_ms) {
+    config.title_update_interval = interval_ms / 1000.0;
+}
+
+CFGFUN(slow_frame_threshold, const long threshold_ms) {
+    config.slow_frame_threshold = threshold_ms / 1000.0;
+}
+
 CFGFUN(focus_on_window_activation, const char *mode) {
     if (strcmp(mode, "smart") == 0)
         config.focus_on_window_activation = FOWA_SMART;
@@ -369,6 +399,7 @@ CFGFUN(workspace, const char *workspace, const char *output) {
     assignment->name = sstrdup(workspace);
     assignment->output = sstrdup(output);
     TAILQ_INSERT_TAIL(&ws_assignments, assignment, ws_assignments);
+    ws_assignment_index_invalidate();
 }
 
 CFGFUN(ipc_socket, const char *path) {
@@ -618,6 +649,10 @@ CFGFUN(bar_tray_padding, const long padding_px) {
     current_bar->tray_padding = padding_px;
 }
 
+CFGFUN(bar_status_redraw_interval, const long interval_ms) {
+    current_bar->status_redraw_interval = interval_ms;
+}
+
 CFGFUN(bar_color_single, const char *colorclass, const char *color) {
     if (strcmp(colorclass, "background") == 0)
         current_bar->colors.background = sstrdup(color);
@@ -654,6 +689,10 @@ CFGFUN(bar_strip_workspace_name, const char *value) {
     current_bar->strip_workspace_name = eval_boolstr(value);
 }
 
+CFGFUN(bar_share_status_command, const char *value) {
+    current_bar->share_status_command = eval_boolstr(value);
+}
+
 CFGFUN(bar_start) {
     current_bar = scalloc(1, sizeof(struct Barconfig));
     TAILQ_INIT(&(current_bar->bar_bindings));
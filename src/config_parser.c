@@ -25,6 +25,7 @@
  */
 #include "all.h"
 
+#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -75,6 +76,65 @@ typedef struct tokenptr {
 
 #include "GENERATED_config_tokens.h"
 
+/* A literal token of a state, see generate-command-parser.pl. */
+typedef struct literal {
+    const char *name;
+    size_t len;
+    /* Index of the token in tokens[state]. */
+    int token;
+    /* Index of the longest literal which is a prefix of this one, or -1. */
+    int parent;
+    /* The lowest token index of this literal and its parents. */
+    int first;
+} cmdp_literal;
+
+typedef struct dispatch {
+    /* Sorted case-insensitively. */
+    const cmdp_literal *literals;
+    int num_literals;
+    /* Indexes of the tokens which are not literals, in ascending order. */
+    const int *others;
+    int num_others;
+} cmdp_dispatch;
+
+#include "GENERATED_config_dispatch.h"
+
+static int fold_case(unsigned char c) {
+    return (c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+}
+
+/*
+ * Returns the index of the literal token of the current state which the input
+ * starts with (like strncasecmp() against every literal would), or -1. If
+ * several literals match, the one which comes first in the specification wins.
+ *
+ */
+static int find_literal(const cmdp_dispatch *table, const char *walk) {
+    /* Binary search for the last literal which sorts before the input or is a
+     * prefix of it. */
+    int lo = 0, hi = table->num_literals;
+    while (lo < hi) {
+        const int mid = lo + (hi - lo) / 2;
+        const char *name = table->literals[mid].name;
+        int cmp = 0;
+        for (size_t i = 0; name[i] != '\0' && cmp == 0; i++)
+            cmp = fold_case(name[i]) - fold_case(walk[i]);
+        if (cmp <= 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    /* Any literal which is a prefix of the input is a prefix of that one, so
+     * it is found by following the parents. */
+    for (int idx = lo - 1; idx != -1; idx = table->literals[idx].parent) {
+        const cmdp_literal *literal = &(table->literals[idx]);
+        if (strncasecmp(walk, literal->name, literal->len) == 0)
+            return literal->first;
+    }
+    return -1;
+}
+
 /*******************************************************************************
  * The (small) stack where identified literals are stored during the parsing
  * of a single command (like $workspace).
@@ -88,7 +148,8 @@ struct stack_entry {
         STACK_LONG = 1,
     } type;
     union {
-        char *str;
+        /* Allocated from parser_arena (or a static token name). */
+        const char *str;
         long num;
     } val;
 };
@@ -96,9 +157,16 @@ struct stack_entry {
 /* 10 entries should be enough for everybody. */
 static struct stack_entry stack[10];
 
+/* The strings on the stack and the error message buffers are allocated from
+ * this arena. Since nothing in it is referenced once the stack is empty, it is
+ * released in one step by every clear_stack(). */
+static arena_t *parser_arena;
+
 /*
  * Pushes a string (identified by 'identifier') on the stack. We simply use a
  * single array, since the number of entries we have to store is very small.
+ * The string is not copied, so it must be allocated from parser_arena (or
+ * outlive the stack).
  *
  */
 static void push_string(const char *identifier, const char *str) {
@@ -109,13 +177,18 @@ static void push_string(const char *identifier, const char *str) {
         if (stack[c].identifier == NULL) {
             /* Found a free slot, let’s store it here. */
             stack[c].identifier = identifier;
-            stack[c].val.str = sstrdup(str);
+            stack[c].val.str = str;
             stack[c].type = STACK_STR;
         } else {
             /* Append the value. */
-            char *prev = stack[c].val.str;
-            sasprintf(&(stack[c].val.str), "%s,%s", prev, str);
-            free(prev);
+            const char *prev = stack[c].val.str;
+            const size_t prev_len = strlen(prev);
+            const size_t str_len = strlen(str);
+            char *joined = arena_alloc(parser_arena, prev_len + 1 + str_len + 1);
+            memcpy(joined, prev, prev_len);
+            joined[prev_len] = ',';
+            memcpy(joined + prev_len + 1, str, str_len + 1);
+            stack[c].val.str = joined;
         }
         return;
     }
@@ -171,12 +244,11 @@ static long get_long(const char *identifier) {
 
 static void clear_stack(void) {
     for (int c = 0; c < 10; c++) {
-        if (stack[c].type == STACK_STR)
-            free(stack[c].val.str);
         stack[c].identifier = NULL;
         stack[c].val.str = NULL;
         stack[c].val.num = 0;
     }
+    arena_release(parser_arena, (arena_mark_t){NULL, 0});
 }
 
 /*******************************************************************************
@@ -275,6 +347,9 @@ struct ConfigResultIR *parse_config(const char *input, struct context *context)
     state = INITIAL;
     statelist_idx = 1;
 
+    if (parser_arena == NULL)
+        parser_arena = arena_new();
+
     /* A YAJL JSON generator used for formatting replies. */
     command_output.json_gen = yajl_gen_alloc(NULL);
 
@@ -303,21 +378,30 @@ struct ConfigResultIR *parse_config(const char *input, struct context *context)
         //printf("remaining input: %s\n", walk);
 
         cmdp_token_ptr *ptr = &(tokens[state]);
+        const cmdp_dispatch *table = &(dispatch[state]);
+        /* Try the tokens in the order of the specification, but only the
+         * literal which actually matches. */
+        int literal = find_literal(table, walk);
+        int other = 0;
         token_handled = false;
-        for (c = 0; c < ptr->n; c++) {
+        while (other < table->num_others || literal != -1) {
+            if (other < table->num_others &&
+                (literal == -1 || table->others[other] < literal)) {
+                c = table->others[other++];
+            } else {
+                c = literal;
+                literal = -1;
+            }
             token = &(ptr->array[c]);
 
             /* A literal. */
             if (token->name[0] == '\'') {
-                if (strncasecmp(walk, token->name + 1, strlen(token->name) - 1) == 0) {
-                    if (token->identifier != NULL)
-                        push_string(token->identifier, token->name + 1);
-                    walk += strlen(token->name) - 1;
-                    next_state(token);
-                    token_handled = true;
-                    break;
-                }
-                continue;
+                if (token->identifier != NULL)
+                    push_string(token->identifier, token->name + 1);
+                walk += strlen(token->name) - 1;
+                next_state(token);
+                token_handled = true;
+                break;
             }
 
             if (strcmp(token->name, "number") == 0) {
@@ -368,7 +452,7 @@ struct ConfigResultIR *parse_config(const char *input, struct context *context)
                     }
                 }
                 if (walk != beginning) {
-                    char *str = scalloc(walk - beginning + 1, 1);
+                    char *str = arena_alloc(parser_arena, walk - beginning + 1);
                     /* We copy manually to handle escaping of characters. */
                     int inpos, outpos;
                     for (inpos = 0, outpos = 0;
@@ -381,9 +465,9 @@ struct ConfigResultIR *parse_config(const char *input, struct context *context)
                             inpos++;
                         str[outpos] = beginning[inpos];
                     }
+                    str[outpos] = '\0';
                     if (token->identifier)
                         push_string(token->identifier, str);
-                    free(str);
                     /* If we are at the end of a quoted string, skip the ending
                      * double quote. */
                     if (*walk == '"')
@@ -435,7 +519,7 @@ struct ConfigResultIR *parse_config(const char *input, struct context *context)
              * full input, and underline the position where the parser
              * currently is. */
             char *errormessage;
-            char *possible_tokens = smalloc(tokenlen + 1);
+            char *possible_tokens = arena_alloc(parser_arena, tokenlen + 1);
             char *tokenwalk = possible_tokens;
             for (c = 0; c < ptr->n; c++) {
                 token = &(ptr->array[c]);
@@ -466,14 +550,13 @@ struct ConfigResultIR *parse_config(const char *input, struct context *context)
             *tokenwalk = '\0';
             sasprintf(&errormessage, "Expected one of these tokens: %s",
                       possible_tokens);
-            free(possible_tokens);
 
             /* Go back to the beginning of the line */
             const char *error_line = start_of_line(walk, input);
 
             /* Contains the same amount of characters as 'input' has, but with
              * the unparseable part highlighted using ^ characters. */
-            char *position = scalloc(strlen(error_line) + 1, 1);
+            char *position = arena_alloc(parser_arena, strlen(error_line) + 1);
             const char *copywalk;
             for (copywalk = error_line;
                  *copywalk != '\n' && *copywalk != '\r' && *copywalk != '\0';
@@ -535,7 +618,6 @@ struct ConfigResultIR *parse_config(const char *input, struct context *context)
             while ((size_t)(walk - input) <= len && *walk != '\n')
                 walk++;
 
-            free(position);
             free(errormessage);
             clear_stack();
 
@@ -570,6 +652,9 @@ struct ConfigResultIR *parse_config(const char *input, struct context *context)
 
 #ifdef TEST_PARSER
 
+/* All log categories are enabled, see log.h. */
+uint32_t log_categories = UINT32_MAX;
+
 /*
  * Logs the given message to stdout while prefixing the current time to it,
  * but only if debug logging was activated.
@@ -606,6 +691,44 @@ void cfg_criteria_pop_state(I3_CFG) {
     result->next_state = criteria_next_state;
 }
 
+#ifdef BENCH_PARSER
+#include "bench_parser.h"
+
+/*
+ * Parses the given configuration file (without replacing variables) the given
+ * number of times and reports the throughput.
+ *
+ */
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Syntax: %s <config file> [iterations]\n", argv[0]);
+        return 1;
+    }
+    const int iterations = bench_iterations(argc, argv, 2);
+    size_t len;
+    char *input = bench_read_file(argv[1], &len);
+
+    struct context context = {.filename = argv[1]};
+
+    bench_silence(true);
+    /* Warm up, so that the first parse does not count the arena setup. */
+    yajl_gen_free(parse_config(input, &context)->json_gen);
+
+    const uint64_t allocations = bench_allocations;
+    const double start = bench_now();
+    for (int i = 0; i < iterations; i++) {
+        yajl_gen_free(parse_config(input, &context)->json_gen);
+    }
+    const double seconds = bench_now() - start;
+    const uint64_t allocated = bench_allocations - allocations;
+    bench_silence(false);
+
+    bench_report("config", iterations, (uint64_t)len * iterations, seconds, allocated);
+
+    free(input);
+    return 0;
+}
+#else
 int main(int argc, char *argv[]) {
     if (argc < 2) {
         fprintf(stderr, "Syntax: %s <command>\n", argv[0]);
@@ -615,6 +738,7 @@ int main(int argc, char *argv[]) {
     context.filename = "<stdin>";
     parse_config(argv[1], &context);
 }
+#endif
 
 #else
 
@@ -761,7 +885,7 @@ static char *migrate_config(char *input, off_t size) {
 
     /* get the returncode */
     int status;
-    wait(&status);
+    waitpid(pid, &status, 0);
     if (!WIFEXITED(status)) {
         fprintf(stderr, "Child did not terminate normally, using old config file (will lead to broken behaviour)\n");
         FREE(converted);
@@ -851,7 +975,7 @@ static void upsert_variable(struct variables_head *variables, char *key, char *v
     }
 }
 
-static char *get_resource(char *name) {
+static char *get_resource(const char *name) {
     if (conn == NULL) {
         return NULL;
     }
@@ -876,194 +1000,268 @@ static char *get_resource(char *name) {
     return resource;
 }
 
+static void append_bytes(char **dest, size_t *len, size_t *size, const char *src, size_t n) {
+    if (*len + n + 1 > *size) {
+        while (*len + n + 1 > *size)
+            *size *= 2;
+        *dest = srealloc(*dest, *size);
+    }
+    memcpy(*dest + *len, src, n);
+    *len += n;
+    (*dest)[*len] = '\0';
+}
+
 /*
- * Parses the given file by first replacing the variables, then calling
- * parse_config and possibly launching i3-nagbar.
+ * Returns a copy of buf in which all variables are replaced by their values,
+ * reading buf only once. Since every variable starts with '$', only those
+ * positions are looked up (case-insensitively) in a hash map. The longest
+ * matching variable wins, so that a variable which is a prefix of another one
+ * does not shadow it.
+ *
+ * The caller has to free() the result.
  *
  */
-bool parse_file(const char *f, bool use_nagbar) {
-    struct variables_head variables = SLIST_HEAD_INITIALIZER(&variables);
-    int fd;
-    struct stat stbuf;
-    char *buf;
-    FILE *fstr;
-    char buffer[4096], key[512], value[4096], *continuation = NULL;
+static char *replace_variables(const char *buf, struct variables_head *variables) {
+    /* The list is sorted by descending key length, and variables with the same
+     * length which were defined later come first. The first variable for each
+     * case-folded key is the one which is substituted. */
+    hashmap_t *by_key = hashmap_new();
+    size_t *lengths = NULL;
+    int num_lengths = 0;
+    size_t max_len = 0;
+    struct Variable *current;
+    SLIST_FOREACH(current, variables, variables) {
+        const size_t keylen = strlen(current->key);
+        char *folded = smalloc(keylen);
+        for (size_t i = 0; i < keylen; i++)
+            folded[i] = tolower((unsigned char)current->key[i]);
+        if (hashmap_get(by_key, folded, keylen) == NULL)
+            hashmap_set(by_key, folded, keylen, current);
+        free(folded);
+
+        if (num_lengths == 0 || lengths[num_lengths - 1] != keylen) {
+            lengths = srealloc(lengths, (num_lengths + 1) * sizeof(size_t));
+            lengths[num_lengths++] = keylen;
+        }
+        if (keylen > max_len)
+            max_len = keylen;
+    }
 
-    if ((fd = open(f, O_RDONLY)) == -1)
-        die("Could not open configuration file: %s\n", strerror(errno));
+    const size_t len = strlen(buf);
+    size_t result_len = 0;
+    size_t result_size = len + 1;
+    char *result = smalloc(result_size);
+    result[0] = '\0';
+    char *folded = smalloc(max_len + 1);
+
+    const char *copied = buf;
+    const char *walk = buf;
+    while (num_lengths > 0 && (walk = strchr(walk, '$')) != NULL) {
+        const size_t remaining = len - (walk - buf);
+        const size_t fold_len = (remaining < max_len ? remaining : max_len);
+        for (size_t i = 0; i < fold_len; i++)
+            folded[i] = tolower((unsigned char)walk[i]);
+
+        struct Variable *match = NULL;
+        for (int i = 0; i < num_lengths && match == NULL; i++) {
+            if (lengths[i] <= fold_len)
+                match = hashmap_get(by_key, folded, lengths[i]);
+        }
+        if (match == NULL) {
+            walk++;
+            continue;
+        }
 
-    if (fstat(fd, &stbuf) == -1)
-        die("Could not fstat file: %s\n", strerror(errno));
+        append_bytes(&result, &result_len, &result_size, copied, walk - copied);
+        append_bytes(&result, &result_len, &result_size, match->value, strlen(match->value));
+        walk += strlen(match->key);
+        copied = walk;
+    }
+    append_bytes(&result, &result_len, &result_size, copied, len - (copied - buf));
 
-    buf = scalloc(stbuf.st_size + 1, 1);
+    free(folded);
+    free(lengths);
+    hashmap_free(by_key);
+    return result;
+}
 
-    if ((fstr = fdopen(fd, "r")) == NULL)
-        die("Could not fdopen: %s\n", strerror(errno));
+/*
+ * Skips the whitespace at *walk, then returns the length of the word starting
+ * there (like the %s conversion of sscanf()). Does not advance past the word.
+ *
+ */
+static size_t config_word(const char **walk, const char *end) {
+    while (*walk < end && isspace((unsigned char)**walk))
+        (*walk)++;
+    const char *word_end = *walk;
+    while (word_end < end && !isspace((unsigned char)*word_end))
+        word_end++;
+    return word_end - *walk;
+}
 
-    FREE(current_config);
-    current_config = scalloc(stbuf.st_size + 1, 1);
-    if ((ssize_t)fread(current_config, 1, stbuf.st_size, fstr) != stbuf.st_size) {
-        die("Could not fread: %s\n", strerror(errno));
+/*
+ * Skips the whitespace at *walk, then returns the length of the rest of the
+ * line (like the %[^\n] conversion of sscanf()).
+ *
+ */
+static size_t config_rest(const char **walk, const char *end) {
+    while (*walk < end && isspace((unsigned char)**walk))
+        (*walk)++;
+    const char *eol = memchr(*walk, '\n', end - *walk);
+    return (eol != NULL ? eol : end) - *walk;
+}
+
+/*
+ * Handles a “set” line: value points to what follows the “set” keyword.
+ *
+ */
+static void preprocess_set(struct variables_head *variables, const char *value, const char *end, bool *invalid_sets) {
+    const size_t key_len = config_word(&value, end);
+    if (key_len == 0) {
+        ELOG("Failed to parse variable specification '%.*s', skipping it.\n", (int)(end - value), value);
+        *invalid_sets = true;
+        return;
+    }
+    if (value[0] != '$') {
+        ELOG("Malformed variable assignment, name has to start with $\n");
+        *invalid_sets = true;
+        return;
     }
-    rewind(fstr);
 
-    bool invalid_sets = false;
+    char *v_key = sstrndup(value, key_len);
+    value += key_len;
+    const size_t value_len = config_rest(&value, end);
+    char *v_value = sstrndup(value, value_len);
+    upsert_variable(variables, v_key, v_value);
+    free(v_key);
+    free(v_value);
+}
 
-    while (!feof(fstr)) {
-        if (!continuation)
-            continuation = buffer;
-        if (fgets(continuation, sizeof(buffer) - (continuation - buffer), fstr) == NULL) {
-            if (feof(fstr))
-                break;
-            die("Could not read configuration file\n");
-        }
-        if (buffer[strlen(buffer) - 1] != '\n' && !feof(fstr)) {
-            ELOG("Your line continuation is too long, it exceeds %zd bytes\n", sizeof(buffer));
+/*
+ * Handles a “set_from_resource” line: value points to what follows the
+ * keyword.
+ *
+ */
+static void preprocess_set_from_resource(struct variables_head *variables, const char *value, const char *end, bool *invalid_sets) {
+    const size_t key_len = config_word(&value, end);
+    if (key_len == 0) {
+        ELOG("Failed to parse resource specification '%.*s', skipping it.\n", (int)(end - value), value);
+        *invalid_sets = true;
+        return;
+    }
+    if (value[0] != '$') {
+        ELOG("Malformed variable assignment, name has to start with $\n");
+        *invalid_sets = true;
+        return;
+    }
+
+    char *v_key = sstrndup(value, key_len);
+    value += key_len;
+    const size_t res_name_len = config_word(&value, end);
+    char *res_name = sstrndup(value, res_name_len);
+    value += res_name_len;
+    /* A user might want a variable to be empty if the resource can't be
+     * found and uses
+     *   set_from_resource $foo i3wm.foo
+     * so a missing fallback is the empty string. */
+    const size_t fallback_len = config_rest(&value, end);
+    char *fallback = sstrndup(value, fallback_len);
+
+    char *res_value = get_resource(res_name);
+    config_cache_record_resource(res_name, res_value);
+    if (res_value == NULL) {
+        DLOG("Could not get resource '%s', using fallback '%s'.\n", res_name, fallback);
+        res_value = sstrdup(fallback);
+    }
+
+    upsert_variable(variables, v_key, res_value);
+    free(res_value);
+    free(v_key);
+    free(res_name);
+    free(fallback);
+}
+
+/*
+ * Copies the configuration file (read into contents) line by line, joining
+ * continued lines and picking up the variable assignments on the way, then
+ * replaces the variables and converts v3 configuration files. Stores the
+ * version of the configuration file in *version.
+ *
+ * The caller has to free() the result.
+ *
+ */
+static char *preprocess_file(const char *f, const char *contents, size_t size, int *version, bool *invalid_sets) {
+    struct variables_head variables = SLIST_HEAD_INITIALIZER(&variables);
+    /* Joining continued lines only ever removes characters. */
+    char *buf = smalloc(size + 1);
+    size_t buf_len = 0;
+    /* The current line, including the lines it continues. */
+    const char *line = NULL;
+    char *joined = NULL;
+    size_t line_len = 0, joined_size = 0;
+
+    const char *walk = contents;
+    const char *end = contents + size;
+    while (walk < end) {
+        const char *eol = memchr(walk, '\n', end - walk);
+        const char *next = (eol != NULL ? eol + 1 : end);
+        if (line == NULL) {
+            /* Most lines are not continued, so they are used in place. */
+            line = walk;
+            line_len = next - walk;
+        } else {
+            if (line != joined) {
+                joined_size = line_len + (next - walk) + 1;
+                joined = srealloc(joined, joined_size);
+                memcpy(joined, line, line_len);
+            }
+            append_bytes(&joined, &line_len, &joined_size, walk, next - walk);
+            line = joined;
         }
+        walk = next;
 
-        /* sscanf implicitly strips whitespace. */
-        value[0] = '\0';
-        const bool skip_line = (sscanf(buffer, "%511s %4095[^\n]", key, value) < 1 || strlen(key) < 3);
-        const bool comment = (key[0] == '#');
-        value[4095] = '\n';
+        const char *line_end = line + line_len;
+        const char *key = line;
+        const size_t key_len = config_word(&key, line_end);
+        const bool skip_line = (key_len < 3);
+        const bool comment = (key_len > 0 && key[0] == '#');
 
-        continuation = strstr(buffer, "\\\n");
-        if (continuation) {
+        if (line_len >= 2 && line[line_len - 2] == '\\' && line[line_len - 1] == '\n') {
             if (!comment) {
+                /* The next line replaces the backslash and the newline. */
+                line_len -= 2;
                 continue;
             }
-            DLOG("line continuation in comment is ignored: \"%.*s\"\n", (int)strlen(buffer) - 1, buffer);
-            continuation = NULL;
+            DLOG("line continuation in comment is ignored: \"%.*s\"\n", (int)line_len - 1, line);
         }
 
-        strncpy(buf + strlen(buf), buffer, strlen(buffer) + 1);
+        memcpy(buf + buf_len, line, line_len);
+        buf_len += line_len;
+        const char *value = key + key_len;
+        line = NULL;
 
         /* Skip comments and empty lines. */
         if (skip_line || comment) {
             continue;
         }
 
-        if (strcasecmp(key, "set") == 0 && *value != '\0') {
-            char v_key[512];
-            char v_value[4096] = {'\0'};
-
-            if (sscanf(value, "%511s %4095[^\n]", v_key, v_value) < 1) {
-                ELOG("Failed to parse variable specification '%s', skipping it.\n", value);
-                invalid_sets = true;
-                continue;
-            }
-
-            if (v_key[0] != '$') {
-                ELOG("Malformed variable assignment, name has to start with $\n");
-                invalid_sets = true;
-                continue;
-            }
-
-            upsert_variable(&variables, v_key, v_value);
-            continue;
-        } else if (strcasecmp(key, "set_from_resource") == 0) {
-            char res_name[512] = {'\0'};
-            char v_key[512];
-            char fallback[4096] = {'\0'};
-
-            /* Ensure that this string is terminated. For example, a user might
-             * want a variable to be empty if the resource can't be found and
-             * uses
-             *   set_from_resource $foo i3wm.foo
-             * Without explicitly terminating the string first, sscanf() will
-             * leave it uninitialized, causing garbage in the config.*/
-            fallback[0] = '\0';
-
-            if (sscanf(value, "%511s %511s %4095[^\n]", v_key, res_name, fallback) < 1) {
-                ELOG("Failed to parse resource specification '%s', skipping it.\n", value);
-                invalid_sets = true;
-                continue;
-            }
-
-            if (v_key[0] != '$') {
-                ELOG("Malformed variable assignment, name has to start with $\n");
-                invalid_sets = true;
-                continue;
-            }
-
-            char *res_value = get_resource(res_name);
-            if (res_value == NULL) {
-                DLOG("Could not get resource '%s', using fallback '%s'.\n", res_name, fallback);
-                res_value = sstrdup(fallback);
-            }
-
-            upsert_variable(&variables, v_key, res_value);
-            FREE(res_value);
-            continue;
+        if (key_len == 3 && strncasecmp(key, "set", 3) == 0 && config_rest(&value, line_end) > 0) {
+            preprocess_set(&variables, value, line_end, invalid_sets);
+        } else if (key_len == 17 && strncasecmp(key, "set_from_resource", 17) == 0) {
+            preprocess_set_from_resource(&variables, value, line_end, invalid_sets);
         }
     }
-    fclose(fstr);
+    buf[buf_len] = '\0';
+    free(joined);
 
-    if (database != NULL) {
-        xcb_xrm_database_free(database);
-        /* Explicitly set the database to NULL again in case the config gets reloaded. */
-        database = NULL;
-    }
-
-    /* For every custom variable, see how often it occurs in the file and
-     * how much extra bytes it requires when replaced. */
-    struct Variable *current, *nearest;
-    int extra_bytes = 0;
-    /* We need to copy the buffer because we need to invalidate the
-     * variables (otherwise we will count them twice, which is bad when
-     * 'extra' is negative) */
-    char *bufcopy = sstrdup(buf);
-    SLIST_FOREACH(current, &variables, variables) {
-        int extra = (strlen(current->value) - strlen(current->key));
-        char *next;
-        for (next = bufcopy;
-             next < (bufcopy + stbuf.st_size) &&
-             (next = strcasestr(next, current->key)) != NULL;
-             next += strlen(current->key)) {
-            *next = '_';
-            extra_bytes += extra;
-        }
-    }
-    FREE(bufcopy);
-
-    /* Then, allocate a new buffer and copy the file over to the new one,
-     * but replace occurrences of our variables */
-    char *walk = buf, *destwalk;
-    char *new = scalloc(stbuf.st_size + extra_bytes + 1, 1);
-    destwalk = new;
-    while (walk < (buf + stbuf.st_size)) {
-        /* Find the next variable */
-        SLIST_FOREACH(current, &variables, variables)
-        current->next_match = strcasestr(walk, current->key);
-        nearest = NULL;
-        int distance = stbuf.st_size;
-        SLIST_FOREACH(current, &variables, variables) {
-            if (current->next_match == NULL)
-                continue;
-            if ((current->next_match - walk) < distance) {
-                distance = (current->next_match - walk);
-                nearest = current;
-            }
-        }
-        if (nearest == NULL) {
-            /* If there are no more variables, we just copy the rest */
-            strncpy(destwalk, walk, (buf + stbuf.st_size) - walk);
-            destwalk += (buf + stbuf.st_size) - walk;
-            *destwalk = '\0';
-            break;
-        } else {
-            /* Copy until the next variable, then copy its value */
-            strncpy(destwalk, walk, distance);
-            strncpy(destwalk + distance, nearest->value, strlen(nearest->value));
-            walk += distance + strlen(nearest->key);
-            destwalk += distance + strlen(nearest->value);
-        }
-    }
+    /* Copy the file over to a new buffer, but replace occurrences of our
+     * variables. */
+    char *new = replace_variables(buf, &variables);
 
     /* analyze the string to find out whether this is an old config file (3.x)
      * or a new config file (4.x). If it’s old, we run the converter script. */
-    int version = detect_version(buf);
-    if (version == 3) {
+    *version = detect_version(buf);
+    if (*version == 3) {
         /* We need to convert this v3 configuration */
         char *converted = migrate_config(new, strlen(new));
         if (converted != NULL) {
@@ -1088,6 +1286,71 @@ bool parse_file(const char *f, bool use_nagbar) {
         }
     }
 
+    free(buf);
+
+    while (!SLIST_EMPTY(&variables)) {
+        struct Variable *current = SLIST_FIRST(&variables);
+        FREE(current->key);
+        FREE(current->value);
+        SLIST_REMOVE_HEAD(&variables, variables);
+        FREE(current);
+    }
+
+    return new;
+}
+
+/*
+ * Parses the given file by first replacing the variables, then calling
+ * parse_config and possibly launching i3-nagbar.
+ *
+ * If a configuration cache is used (see config_cache.c), the result of
+ * replacing the variables is taken from it as long as neither the file nor the
+ * X resources which it uses changed.
+ *
+ */
+bool parse_file(const char *f, bool use_nagbar) {
+    int fd;
+    struct stat stbuf;
+
+    if ((fd = open(f, O_RDONLY)) == -1)
+        die("Could not open configuration file: %s\n", strerror(errno));
+
+    if (fstat(fd, &stbuf) == -1)
+        die("Could not fstat file: %s\n", strerror(errno));
+
+    /* The whole file is read at once, preprocess_file() works on this copy. */
+    FREE(current_config);
+    current_config = scalloc(stbuf.st_size + 1, 1);
+    off_t read_bytes = 0;
+    while (read_bytes < stbuf.st_size) {
+        const ssize_t n = read(fd, current_config + read_bytes, stbuf.st_size - read_bytes);
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            die("Could not read configuration file: %s\n", (n == 0 ? "unexpected end of file" : strerror(errno)));
+        read_bytes += n;
+    }
+    close(fd);
+
+    bool invalid_sets = false;
+    int version = 4;
+    char *new = config_cache_load(current_config, stbuf.st_size, &version, get_resource);
+    if (new == NULL) {
+        config_cache_reset_resources();
+        new = preprocess_file(f, current_config, stbuf.st_size, &version, &invalid_sets);
+        /* Files with invalid variable assignments are not cached, so that the
+         * errors are reported on every start. Neither are v3 files, whose
+         * conversion might have failed. */
+        if (!invalid_sets && version != 3)
+            config_cache_store(current_config, stbuf.st_size, new, version);
+    }
+
+    if (database != NULL) {
+        xcb_xrm_database_free(database);
+        /* Explicitly set the database to NULL again in case the config gets reloaded. */
+        database = NULL;
+    }
+
     context = scalloc(1, sizeof(struct context));
     context->filename = f;
 
@@ -1111,15 +1374,6 @@ bool parse_file(const char *f, bool use_nagbar) {
     FREE(context->line_copy);
     free(context);
     free(new);
-    free(buf);
-
-    while (!SLIST_EMPTY(&variables)) {
-        current = SLIST_FIRST(&variables);
-        FREE(current->key);
-        FREE(current->value);
-        SLIST_REMOVE_HEAD(&variables, variables);
-        FREE(current);
-    }
 
     return !has_errors;
 }
@@ -0,0 +1,704 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * event_trace.c: Recording the X11 events and IPC commands of a session into
+ *                a trace file (--record-trace) and replaying such a trace as a
+ *                benchmark (--replay-trace).
+ *
+ * A trace file starts with the magic "i3trace" followed by the format version
+ * byte, followed by records. Each record consists of a struct trace_record
+ * and length bytes of payload. Records are written in the byte order of the
+ * machine, so a trace needs to be replayed on the same architecture.
+ *
+ * Window IDs and atoms differ between X servers. When replaying, the root
+ * window and the atoms are translated using the ROOT and ATOM records, and
+ * every client window is replaced by an unmapped stand-in window, which is
+ * created when the window is first requested to be mapped or configured.
+ * Stand-ins have none of the properties of the original windows. Windows
+ * which are not client windows (e.g. the frames which the recording i3
+ * created) are replaced by XCB_NONE.
+ *
+ */
+#include "all.h"
+
+#include "yajl_utils.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#define MAX(x, y) ((x) > (y) ? (x) : (y))
+
+/* The size of an X11 event on the wire (xcb_generic_event_t additionally
+ * contains the full sequence number). */
+#define TRACE_EVENT_SIZE 32
+
+/* The default geometry of stand-ins for windows whose CreateNotify is not
+ * part of the trace. */
+#define STAND_IN_WIDTH 300
+#define STAND_IN_HEIGHT 200
+
+static const char trace_magic[8] = {'i', '3', 't', 'r', 'a', 'c', 'e', 1};
+
+typedef enum {
+    /* uint32_t: the root window. */
+    TRACE_ROOT = 1,
+    /* uint32_t: an atom, followed by its name. */
+    TRACE_ATOM = 2,
+    /* int32_t[4]: the first event of RandR, XKB, Shape and Sync (or -1). */
+    TRACE_EXTENSIONS = 3,
+    /* The TRACE_EVENT_SIZE bytes of an event, as passed to handle_event(). */
+    TRACE_EVENT = 4,
+    /* No payload: the event loop rendered before handling further events. */
+    TRACE_BATCH_END = 5,
+    /* uint32_t: the length of the command, followed by the command and the
+     * reply (which is empty if it was not recorded). */
+    TRACE_COMMAND = 6,
+} trace_record_type_t;
+
+struct trace_record {
+    uint32_t type;
+    uint32_t length;
+    uint64_t time_ns;
+};
+
+/* The number of extensions whose events are recorded, in the order of the
+ * TRACE_EXTENSIONS record. */
+#define TRACE_NUM_EXTENSIONS 4
+
+/* The number of event types of each extension which i3 handles. */
+static const int extension_num_events[TRACE_NUM_EXTENSIONS] = {
+    XCB_RANDR_NOTIFY + 1,
+    1,
+    XCB_SHAPE_NOTIFY + 1,
+    XCB_SYNC_ALARM_NOTIFY + 1,
+};
+
+static FILE *trace = NULL;
+
+/*******************************************************************************
+ * Recording
+ ******************************************************************************/
+
+static void write_record(trace_record_type_t type, size_t length) {
+    const struct trace_record record = {
+        .type = type,
+        .length = length,
+        .time_ns = stats_now_ns(),
+    };
+    fwrite(&record, sizeof(struct trace_record), 1, trace);
+}
+
+static void write_atom(xcb_atom_t atom, const char *name) {
+    const uint32_t id = atom;
+    write_record(TRACE_ATOM, sizeof(id) + strlen(name));
+    fwrite(&id, sizeof(id), 1, trace);
+    fwrite(name, 1, strlen(name), trace);
+}
+
+/*
+ * Starts recording into the given trace file. New records are appended, so
+ * that the trace continues across in-place restarts. Needs to be called once
+ * the atoms and the extensions are set up.
+ *
+ */
+bool event_trace_open(const char *path) {
+    const int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (fd == -1) {
+        ELOG("Could not open trace file \"%s\": %s\n", path, strerror(errno));
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (trace = fdopen(fd, "a")) == NULL) {
+        ELOG("Could not open trace file \"%s\": %s\n", path, strerror(errno));
+        close(fd);
+        return false;
+    }
+
+    if (st.st_size == 0)
+        fwrite(trace_magic, sizeof(trace_magic), 1, trace);
+
+    /* The root window, the atoms and the extension events differ between X
+     * servers, so they are recorded for translating the events when
+     * replaying. This is repeated after every restart. */
+    const uint32_t root_id = root;
+    write_record(TRACE_ROOT, sizeof(root_id));
+    fwrite(&root_id, sizeof(root_id), 1, trace);
+
+#define xmacro(atom) write_atom(A_##atom, #atom);
+#include "atoms.xmacro"
+#undef xmacro
+
+    const int32_t bases[TRACE_NUM_EXTENSIONS] = {randr_base, xkb_base, shape_base, sync_base};
+    write_record(TRACE_EXTENSIONS, sizeof(bases));
+    fwrite(bases, sizeof(bases), 1, trace);
+
+    event_trace_flush();
+    if (trace != NULL)
+        LOG("Recording X11 events and IPC commands to \"%s\"\n", path);
+    return (trace != NULL);
+}
+
+/*
+ * Records an X11 event right before it is passed to handle_event().
+ *
+ */
+void event_trace_record_event(const xcb_generic_event_t *event) {
+    if (trace == NULL)
+        return;
+
+    write_record(TRACE_EVENT, TRACE_EVENT_SIZE);
+    fwrite(event, TRACE_EVENT_SIZE, 1, trace);
+}
+
+/*
+ * Records that the events of a batch were handled, i.e. that the event loop
+ * renders before handling further events.
+ *
+ */
+void event_trace_record_batch_end(void) {
+    if (trace == NULL)
+        return;
+
+    write_record(TRACE_BATCH_END, 0);
+}
+
+/*
+ * Records an IPC command and the reply which was sent for it. The reply is
+ * only compared when replaying if reply_len is not 0.
+ *
+ */
+void event_trace_record_command(const char *command, const unsigned char *reply, size_t reply_len) {
+    if (trace == NULL)
+        return;
+
+    const uint32_t command_len = strlen(command);
+    write_record(TRACE_COMMAND, sizeof(command_len) + command_len + reply_len);
+    fwrite(&command_len, sizeof(command_len), 1, trace);
+    fwrite(command, 1, command_len, trace);
+    fwrite(reply, 1, reply_len, trace);
+}
+
+/*
+ * Writes the records buffered since the last call to the trace file.
+ *
+ */
+void event_trace_flush(void) {
+    if (trace == NULL)
+        return;
+
+    if (ferror(trace) || fflush(trace) != 0) {
+        ELOG("Could not write to the trace file, recording stopped: %s\n", strerror(errno));
+        fclose(trace);
+        trace = NULL;
+    }
+}
+
+/*******************************************************************************
+ * Replaying
+ ******************************************************************************/
+
+struct replay_timing {
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+};
+
+struct replay_event_timing {
+    char *name;
+    struct replay_timing timing;
+};
+
+/* Geometry of a window from its CreateNotify, until its stand-in is
+ * created. */
+struct replay_geometry {
+    int16_t x;
+    int16_t y;
+    uint16_t width;
+    uint16_t height;
+    uint8_t override_redirect;
+};
+
+static bool replaying = false;
+
+static xcb_window_t recorded_root;
+static int32_t recorded_bases[TRACE_NUM_EXTENSIONS] = {-1, -1, -1, -1};
+/* Recorded atom → local atom. */
+static hashmap_t *atoms;
+/* Recorded window → stand-in window. */
+static hashmap_t *stand_ins;
+/* Recorded window → struct replay_geometry. */
+static hashmap_t *geometries;
+
+static struct replay_event_timing *event_timings;
+static int num_event_timings;
+static struct replay_timing command_timing;
+static struct replay_timing render_timing;
+static uint64_t mismatched_replies;
+static uint64_t skipped_events;
+static uint64_t discarded_events;
+static uint64_t num_stand_ins;
+
+/*
+ * Returns true while a trace is replayed.
+ *
+ */
+bool event_trace_replaying(void) {
+    return replaying;
+}
+
+static void timing_record(struct replay_timing *timing, uint64_t elapsed_ns) {
+    timing->count++;
+    timing->total_ns += elapsed_ns;
+    if (elapsed_ns > timing->max_ns)
+        timing->max_ns = elapsed_ns;
+}
+
+static struct replay_timing *timing_for_event(const char *name) {
+    for (int i = 0; i < num_event_timings; i++) {
+        if (strcmp(event_timings[i].name, name) == 0)
+            return &(event_timings[i].timing);
+    }
+
+    event_timings = srealloc(event_timings, (num_event_timings + 1) * sizeof(struct replay_event_timing));
+    struct replay_event_timing *new = &event_timings[num_event_timings++];
+    new->name = sstrdup(name);
+    memset(&(new->timing), '\0', sizeof(struct replay_timing));
+    return &(new->timing);
+}
+
+static xcb_atom_t local_atom(const char *name) {
+#define xmacro(atom)              \
+    if (strcmp(name, #atom) == 0) \
+        return A_##atom;
+#include "atoms.xmacro"
+#undef xmacro
+
+    /* The trace was recorded by a different version of i3. */
+    xcb_intern_atom_reply_t *reply = xcb_intern_atom_reply(
+        conn, xcb_intern_atom(conn, 0, strlen(name), name), NULL);
+    if (reply == NULL)
+        return XCB_NONE;
+    const xcb_atom_t atom = reply->atom;
+    free(reply);
+    return atom;
+}
+
+static uint32_t translate_atom(uint32_t atom) {
+    /* Predefined atoms are the same on every X server. */
+    if (atom <= XCB_ATOM_WM_TRANSIENT_FOR)
+        return atom;
+    return (uintptr_t)hashmap_get(atoms, &atom, sizeof(atom));
+}
+
+static uint32_t translate_window(uint32_t window) {
+    if (window == XCB_NONE)
+        return XCB_NONE;
+    if (window == recorded_root)
+        return root;
+    return (uintptr_t)hashmap_get(stand_ins, &window, sizeof(window));
+}
+
+static uint32_t get_field(const uint8_t *event, size_t offset) {
+    uint32_t value;
+    memcpy(&value, event + offset, sizeof(value));
+    return value;
+}
+
+static void set_field(uint8_t *event, size_t offset, uint32_t value) {
+    memcpy(event + offset, &value, sizeof(value));
+}
+
+/*
+ * Creates the stand-in for the given recorded window unless it already has
+ * one.
+ *
+ */
+static void ensure_stand_in(uint32_t recorded) {
+    if (recorded == XCB_NONE || hashmap_get(stand_ins, &recorded, sizeof(recorded)) != NULL)
+        return;
+
+    struct replay_geometry geometry = {
+        .width = STAND_IN_WIDTH,
+        .height = STAND_IN_HEIGHT,
+    };
+    struct replay_geometry *created = hashmap_remove(geometries, &recorded, sizeof(recorded));
+    if (created != NULL) {
+        geometry = *created;
+        free(created);
+    }
+
+    xcb_window_t window = xcb_generate_id(conn);
+    xcb_create_window(conn, XCB_COPY_FROM_PARENT, window, root,
+                      geometry.x, geometry.y, MAX(geometry.width, 1), MAX(geometry.height, 1), 0,
+                      XCB_WINDOW_CLASS_INPUT_OUTPUT, XCB_COPY_FROM_PARENT,
+                      XCB_CW_OVERRIDE_REDIRECT, (uint32_t[]){geometry.override_redirect});
+    hashmap_set(stand_ins, &recorded, sizeof(recorded), (void *)(uintptr_t)window);
+    num_stand_ins++;
+}
+
+/* The offsets of the window fields of the core events. */
+static const uint8_t window_offsets[XCB_MAPPING_NOTIFY + 1][3] = {
+    [XCB_KEY_PRESS] = {8, 12, 16},
+    [XCB_KEY_RELEASE] = {8, 12, 16},
+    [XCB_BUTTON_PRESS] = {8, 12, 16},
+    [XCB_BUTTON_RELEASE] = {8, 12, 16},
+    [XCB_MOTION_NOTIFY] = {8, 12, 16},
+    [XCB_ENTER_NOTIFY] = {8, 12, 16},
+    [XCB_LEAVE_NOTIFY] = {8, 12, 16},
+    [XCB_FOCUS_IN] = {4},
+    [XCB_FOCUS_OUT] = {4},
+    [XCB_EXPOSE] = {4},
+    [XCB_CREATE_NOTIFY] = {4, 8},
+    [XCB_DESTROY_NOTIFY] = {4, 8},
+    [XCB_UNMAP_NOTIFY] = {4, 8},
+    [XCB_MAP_NOTIFY] = {4, 8},
+    [XCB_MAP_REQUEST] = {4, 8},
+    [XCB_REPARENT_NOTIFY] = {4, 8, 12},
+    [XCB_CONFIGURE_NOTIFY] = {4, 8, 12},
+    [XCB_CONFIGURE_REQUEST] = {4, 8, 12},
+    [XCB_GRAVITY_NOTIFY] = {4, 8},
+    [XCB_RESIZE_REQUEST] = {4},
+    [XCB_CIRCULATE_NOTIFY] = {4, 8},
+    [XCB_CIRCULATE_REQUEST] = {4, 8},
+    [XCB_PROPERTY_NOTIFY] = {4},
+    [XCB_SELECTION_CLEAR] = {8},
+    [XCB_CLIENT_MESSAGE] = {4},
+};
+
+/*
+ * Translates a core event from the recording X server to this one.
+ *
+ */
+static void translate_core_event(int type, uint8_t *event) {
+    /* Client windows are created when they are first requested to be mapped
+     * or configured. Frames and other windows of the recording i3 are never
+     * requested to be mapped. */
+    if (type == XCB_CREATE_NOTIFY && get_field(event, 4) == recorded_root) {
+        const xcb_create_notify_event_t *create = (xcb_create_notify_event_t *)event;
+        struct replay_geometry *geometry = smalloc(sizeof(struct replay_geometry));
+        geometry->x = create->x;
+        geometry->y = create->y;
+        geometry->width = create->width;
+        geometry->height = create->height;
+        geometry->override_redirect = create->override_redirect;
+        free(hashmap_remove(geometries, &create->window, sizeof(create->window)));
+        hashmap_set(geometries, &create->window, sizeof(create->window), geometry);
+    } else if ((type == XCB_MAP_REQUEST || type == XCB_CONFIGURE_REQUEST) &&
+               get_field(event, 4) == recorded_root) {
+        ensure_stand_in(get_field(event, 8));
+    }
+
+    for (int i = 0; i < 3 && window_offsets[type][i] != 0; i++) {
+        set_field(event, window_offsets[type][i], translate_window(get_field(event, window_offsets[type][i])));
+    }
+
+    switch (type) {
+        case XCB_PROPERTY_NOTIFY:
+            set_field(event, 8, translate_atom(get_field(event, 8)));
+            break;
+        case XCB_SELECTION_CLEAR:
+            set_field(event, 12, translate_atom(get_field(event, 12)));
+            break;
+        case XCB_CLIENT_MESSAGE:
+            set_field(event, 8, translate_atom(get_field(event, 8)));
+            /* _NET_WM_STATE names the states to change. */
+            if (get_field(event, 8) == A__NET_WM_STATE) {
+                set_field(event, 16, translate_atom(get_field(event, 16)));
+                set_field(event, 20, translate_atom(get_field(event, 20)));
+            }
+            break;
+    }
+}
+
+/*
+ * Translates an event from the recording X server to this one. Returns the
+ * type of the event on this X server, or -1 if it cannot be replayed.
+ *
+ */
+static int translate_event(uint8_t *event) {
+    int type = (event[0] & 0x7F);
+    if (type <= XCB_MAPPING_NOTIFY) {
+        translate_core_event(type, event);
+        return type;
+    }
+
+    const int local_bases[TRACE_NUM_EXTENSIONS] = {randr_base, xkb_base, shape_base, sync_base};
+    for (int i = 0; i < TRACE_NUM_EXTENSIONS; i++) {
+        if (recorded_bases[i] == -1 ||
+            type < recorded_bases[i] ||
+            type >= recorded_bases[i] + extension_num_events[i])
+            continue;
+        if (local_bases[i] == -1)
+            return -1;
+
+        type = local_bases[i] + (type - recorded_bases[i]);
+        event[0] = (event[0] & 0x80) | type;
+        if (i == 0) {
+            /* root and request_window */
+            set_field(event, 12, translate_window(get_field(event, 12)));
+            set_field(event, 16, translate_window(get_field(event, 16)));
+        } else if (i == 2) {
+            /* affected_window */
+            set_field(event, 4, translate_window(get_field(event, 4)));
+        }
+        return type;
+    }
+
+    return -1;
+}
+
+/*
+ * Discards the events which i3’s own requests caused on this X server: their
+ * counterparts from the recording X server are part of the trace.
+ *
+ */
+static void discard_live_events(void) {
+    xcb_generic_event_t *event;
+    while ((event = xcb_poll_for_event(conn)) != NULL) {
+        discarded_events++;
+        retire_error_callbacks(event->full_sequence);
+        free(event);
+    }
+}
+
+/*
+ * Does what the event loop does between two batches of events, see
+ * xcb_prepare_cb().
+ *
+ */
+static void replay_batch_end(void) {
+    const uint64_t start = stats_now_ns();
+    manage_handle_deferred();
+    key_press_coalesce_end();
+    tree_close_end();
+    tree_render_flush();
+    xcb_flush(conn);
+    timing_record(&render_timing, stats_now_ns() - start);
+
+    discard_live_events();
+}
+
+static void replay_event(const uint8_t *payload) {
+    xcb_generic_event_t *event = scalloc(1, sizeof(xcb_generic_event_t));
+    memcpy(event, payload, TRACE_EVENT_SIZE);
+
+    const int type = translate_event((uint8_t *)event);
+    if (type == -1) {
+        skipped_events++;
+        free(event);
+        return;
+    }
+
+    char name[64];
+    event_stats_name(type, event, name, sizeof(name));
+
+    if (type == XCB_KEY_PRESS || type == XCB_KEY_RELEASE)
+        key_press_coalesce_begin();
+    else
+        key_press_coalesce_end();
+
+    if (type == XCB_UNMAP_NOTIFY || type == XCB_DESTROY_NOTIFY)
+        tree_close_begin();
+    else
+        tree_close_end();
+
+    const uint64_t start = stats_now_ns();
+    handle_event(type, event);
+    timing_record(timing_for_event(name), stats_now_ns() - start);
+
+    if (type == XCB_DESTROY_NOTIFY) {
+        const uint32_t recorded = get_field(payload, 8);
+        const xcb_window_t window = (uintptr_t)hashmap_remove(stand_ins, &recorded, sizeof(recorded));
+        if (window != XCB_NONE)
+            xcb_destroy_window(conn, window);
+        free(hashmap_remove(geometries, &recorded, sizeof(recorded)));
+    }
+
+    free(event);
+}
+
+static void replay_command(const uint8_t *payload, uint32_t length) {
+    uint32_t command_len;
+    memcpy(&command_len, payload, sizeof(command_len));
+    if (command_len > length - sizeof(command_len)) {
+        ELOG("Skipping a malformed command record\n");
+        return;
+    }
+
+    char *command = sstrndup((const char *)payload + sizeof(command_len), command_len);
+    const uint8_t *reply = payload + sizeof(command_len) + command_len;
+    const size_t reply_len = length - sizeof(command_len) - command_len;
+
+    yajl_gen gen = ygenalloc();
+    const uint64_t start = stats_now_ns();
+    CommandResult *result = parse_command(command, gen, NULL);
+    timing_record(&command_timing, stats_now_ns() - start);
+
+    if (result->needs_tree_render) {
+        const uint64_t render_start = stats_now_ns();
+        tree_render();
+        xcb_flush(conn);
+        timing_record(&render_timing, stats_now_ns() - render_start);
+    }
+    command_result_free(result);
+
+    const unsigned char *replayed;
+    ylength replayed_len;
+    y(get_buf, &replayed, &replayed_len);
+    if (reply_len > 0 && (replayed_len != reply_len || memcmp(replayed, reply, reply_len) != 0)) {
+        DLOG("Reply to \"%s\" differs: %.*s (recorded: %.*s)\n",
+             command, (int)replayed_len, replayed, (int)reply_len, reply);
+        mismatched_replies++;
+    }
+    y(free);
+    free(command);
+
+    discard_live_events();
+}
+
+static void dump_timing(yajl_gen gen, const char *name, const struct replay_timing *timing) {
+    ystr(name);
+    y(map_open);
+    ystr("count");
+    y(integer, timing->count);
+    ystr("total_ns");
+    y(integer, timing->total_ns);
+    ystr("max_ns");
+    y(integer, timing->max_ns);
+    y(map_close);
+}
+
+static void print_report(uint64_t total_ns) {
+    yajl_gen gen = ygenalloc();
+    y(config, yajl_gen_beautify, 1);
+
+    y(map_open);
+    ystr("events");
+    y(map_open);
+    for (int i = 0; i < num_event_timings; i++) {
+        dump_timing(gen, event_timings[i].name, &(event_timings[i].timing));
+    }
+    y(map_close);
+
+    dump_timing(gen, "commands", &command_timing);
+    dump_timing(gen, "render", &render_timing);
+
+    ystr("mismatched_replies");
+    y(integer, mismatched_replies);
+    ystr("skipped_events");
+    y(integer, skipped_events);
+    ystr("discarded_events");
+    y(integer, discarded_events);
+    ystr("stand_in_windows");
+    y(integer, num_stand_ins);
+    ystr("total_ns");
+    y(integer, total_ns);
+    y(map_close);
+
+    const unsigned char *report;
+    ylength length;
+    y(get_buf, &report, &length);
+    fwrite(report, 1, length, stdout);
+    fflush(stdout);
+    y(free);
+}
+
+/*
+ * Replays the given trace against the X server i3 is connected to and prints
+ * the time spent handling each kind of event, running commands and rendering
+ * as JSON to stdout. Returns false if the trace could not be read.
+ *
+ */
+bool event_trace_replay(const char *path) {
+    char *contents = NULL;
+    size_t size = 0;
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        ELOG("Could not open trace file \"%s\": %s\n", path, strerror(errno));
+        return false;
+    }
+    size_t capacity = 0;
+    size_t n;
+    do {
+        if (size == capacity) {
+            capacity = (capacity == 0 ? 65536 : capacity * 2);
+            contents = srealloc(contents, capacity);
+        }
+        n = fread(contents + size, 1, capacity - size, f);
+        size += n;
+    } while (n > 0);
+    const bool read_error = ferror(f);
+    fclose(f);
+
+    if (read_error || size < sizeof(trace_magic) || memcmp(contents, trace_magic, sizeof(trace_magic)) != 0) {
+        ELOG("\"%s\" is not a trace file of this version of i3\n", path);
+        free(contents);
+        return false;
+    }
+
+    LOG("Replaying the trace \"%s\" (%zu bytes)\n", path, size);
+    replaying = true;
+    atoms = hashmap_new();
+    stand_ins = hashmap_new();
+    geometries = hashmap_new();
+    discard_live_events();
+
+    const uint64_t start = stats_now_ns();
+    size_t offset = sizeof(trace_magic);
+    while (offset + sizeof(struct trace_record) <= size) {
+        struct trace_record record;
+        memcpy(&record, contents + offset, sizeof(struct trace_record));
+        offset += sizeof(struct trace_record);
+        if (record.length > size - offset) {
+            ELOG("The trace is truncated, stopping\n");
+            break;
+        }
+
+        const uint8_t *payload = (const uint8_t *)contents + offset;
+        offset += record.length;
+
+        switch (record.type) {
+            case TRACE_ROOT:
+                if (record.length == sizeof(uint32_t))
+                    recorded_root = get_field(payload, 0);
+                break;
+            case TRACE_ATOM:
+                if (record.length > sizeof(uint32_t)) {
+                    const uint32_t recorded = get_field(payload, 0);
+                    char *name = sstrndup((const char *)payload + sizeof(uint32_t), record.length - sizeof(uint32_t));
+                    hashmap_set(atoms, &recorded, sizeof(recorded), (void *)(uintptr_t)local_atom(name));
+                    free(name);
+                }
+                break;
+            case TRACE_EXTENSIONS:
+                if (record.length == sizeof(recorded_bases))
+                    memcpy(recorded_bases, payload, sizeof(recorded_bases));
+                break;
+            case TRACE_EVENT:
+                if (record.length == TRACE_EVENT_SIZE)
+                    replay_event(payload);
+                break;
+            case TRACE_BATCH_END:
+                replay_batch_end();
+                break;
+            case TRACE_COMMAND:
+                if (record.length >= sizeof(uint32_t))
+                    replay_command(payload, record.length);
+                break;
+            default:
+                DLOG("Skipping unknown trace record of type %u\n", record.type);
+                break;
+        }
+    }
+    replay_batch_end();
+    const uint64_t total_ns = stats_now_ns() - start;
+    free(contents);
+
+    print_report(total_ns);
+    replaying = false;
+    return true;
+}
@@ -16,6 +16,59 @@ xcb_window_t ewmh_window;
     TAILQ_FOREACH(ws, &(output_get_content(output)->nodes_head), nodes) \
     if (!con_is_internal(ws))
 
+/* The value of a root window property as i3 last set it. Every change of a
+ * root window property wakes up all pagers and panels watching the root
+ * window, so writes which would not change the value are skipped, and values
+ * which only grew at the end are appended. */
+typedef struct root_property {
+    bool set;
+    uint32_t len;
+    void *data;
+} root_property;
+
+static root_property number_of_desktops;
+static root_property desktop_names;
+static root_property desktop_viewport;
+static root_property active_window;
+static root_property client_list;
+static root_property client_list_stacking;
+
+/*
+ * Sets the given property on the root window (data_len elements of format
+ * bits each), unless it already has this value. If the old value is a prefix
+ * of the new one (e.g. a window was added to _NET_CLIENT_LIST), only the new
+ * elements are sent.
+ *
+ */
+static void change_root_property(root_property *cached, xcb_atom_t property, xcb_atom_t type,
+                                 uint8_t format, uint32_t data_len, const void *data) {
+    const uint32_t len = data_len * (format / 8);
+    if (cached->set && cached->len == len &&
+        (len == 0 || memcmp(cached->data, data, len) == 0)) {
+        return;
+    }
+
+    const bool append = (cached->set && len > cached->len &&
+                         memcmp(cached->data, data, cached->len) == 0);
+    const uint32_t old_len = cached->len;
+
+    cached->data = srealloc(cached->data, len > 0 ? len : 1);
+    if (len > 0) {
+        memcpy(cached->data, data, len);
+    }
+    cached->len = len;
+    cached->set = true;
+
+    const stats_x_subsystem_t x_subsystem = stats_x_enter(STATS_X_SUBSYSTEM_EWMH);
+    if (append) {
+        xcb_change_property(conn, XCB_PROP_MODE_APPEND, root, property, type, format,
+                            (len - old_len) / (format / 8), (const uint8_t *)data + old_len);
+    } else {
+        xcb_change_property(conn, XCB_PROP_MODE_REPLACE, root, property, type, format, data_len, data);
+    }
+    stats_x_leave(x_subsystem);
+}
+
 /*
  * Updates _NET_CURRENT_DESKTOP with the current desktop number.
  *
@@ -32,7 +85,9 @@ void ewmh_update_current_desktop(void) {
     }
     old_idx = idx;
 
+    const stats_x_subsystem_t x_subsystem = stats_x_enter(STATS_X_SUBSYSTEM_EWMH);
     xcb_change_property(conn, XCB_PROP_MODE_REPLACE, root, A__NET_CURRENT_DESKTOP, XCB_ATOM_CARDINAL, 32, 1, &idx);
+    stats_x_leave(x_subsystem);
 }
 
 /*
@@ -41,20 +96,13 @@ void ewmh_update_current_desktop(void) {
  */
 static void ewmh_update_number_of_desktops(void) {
     Con *output, *ws;
-    static uint32_t old_idx = 0;
     uint32_t idx = 0;
 
     FOREACH_NONINTERNAL {
         idx++;
     };
 
-    if (idx == old_idx) {
-        return;
-    }
-    old_idx = idx;
-
-    xcb_change_property(conn, XCB_PROP_MODE_REPLACE, root,
-                        A__NET_NUMBER_OF_DESKTOPS, XCB_ATOM_CARDINAL, 32, 1, &idx);
+    change_root_property(&number_of_desktops, A__NET_NUMBER_OF_DESKTOPS, XCB_ATOM_CARDINAL, 32, 1, &idx);
 }
 
 /*
@@ -70,18 +118,17 @@ static void ewmh_update_desktop_names(void) {
         msg_length += strlen(ws->name) + 1;
     };
 
-    char desktop_names[msg_length];
+    char names[msg_length];
     int current_position = 0;
 
     /* fill the buffer with the names of the i3 workspaces */
     FOREACH_NONINTERNAL {
         for (size_t i = 0; i < strlen(ws->name) + 1; i++) {
-            desktop_names[current_position++] = ws->name[i];
+            names[current_position++] = ws->name[i];
         }
     }
 
-    xcb_change_property(conn, XCB_PROP_MODE_REPLACE, root,
-                        A__NET_DESKTOP_NAMES, A_UTF8_STRING, 8, msg_length, desktop_names);
+    change_root_property(&desktop_names, A__NET_DESKTOP_NAMES, A_UTF8_STRING, 8, msg_length, names);
 }
 
 /*
@@ -105,8 +152,7 @@ static void ewmh_update_desktop_viewport(void) {
         viewports[current_position++] = output->rect.y;
     }
 
-    xcb_change_property(conn, XCB_PROP_MODE_REPLACE, root,
-                        A__NET_DESKTOP_VIEWPORT, XCB_ATOM_CARDINAL, 32, current_position, &viewports);
+    change_root_property(&desktop_viewport, A__NET_DESKTOP_VIEWPORT, XCB_ATOM_CARDINAL, 32, current_position, viewports);
 }
 
 /*
@@ -121,6 +167,12 @@ void ewmh_update_desktop_properties(void) {
     ewmh_update_wm_desktop();
 }
 
+/*
+ * Updates _NET_WM_DESKTOP for all windows below con, which is (inside) a
+ * workspace. desktop is the value for windows on that workspace, which is
+ * NET_WM_DESKTOP_ALL for the scratchpad.
+ *
+ */
 static void ewmh_update_wm_desktop_recursively(Con *con, const uint32_t desktop) {
     Con *child;
 
@@ -144,16 +196,9 @@ static void ewmh_update_wm_desktop_recursively(Con *con, const uint32_t desktop)
      * a floating container. This is technically still slightly wrong, since
      * sticky windows will only be on all workspaces on this output, but we
      * ignore multi-monitor situations for this since the spec isn't too
-     * precise on this anyway. */
-    if (con_is_sticky(con) && con_is_floating(con)) {
-        wm_desktop = NET_WM_DESKTOP_ALL;
-    }
-
-    /* If the window is on the scratchpad we assign the sticky value to it
-     * since showing it works on any workspace. We cannot remove the property
-     * as per specification. */
-    Con *ws = con_get_workspace(con);
-    if (ws != NULL && con_is_internal(ws)) {
+     * precise on this anyway. We check for floating first since that is
+     * cheaper. */
+    if (con_is_floating(con) && con_is_sticky(con)) {
         wm_desktop = NET_WM_DESKTOP_ALL;
     }
 
@@ -180,19 +225,26 @@ static void ewmh_update_wm_desktop_recursively(Con *con, const uint32_t desktop)
  *
  */
 void ewmh_update_wm_desktop(void) {
+    const stats_x_subsystem_t x_subsystem = stats_x_enter(STATS_X_SUBSYSTEM_EWMH);
     uint32_t desktop = 0;
 
     Con *output;
     TAILQ_FOREACH(output, &(croot->nodes_head), nodes) {
         Con *workspace;
         TAILQ_FOREACH(workspace, &(output_get_content(output)->nodes_head), nodes) {
-            ewmh_update_wm_desktop_recursively(workspace, desktop);
-
-            if (!con_is_internal(workspace)) {
-                ++desktop;
+            /* If the window is on the scratchpad we assign the sticky value
+             * to it since showing it works on any workspace. We cannot remove
+             * the property as per specification. */
+            if (con_is_internal(workspace)) {
+                ewmh_update_wm_desktop_recursively(workspace, NET_WM_DESKTOP_ALL);
+                continue;
             }
+
+            ewmh_update_wm_desktop_recursively(workspace, desktop);
+            ++desktop;
         }
     }
+    stats_x_leave(x_subsystem);
 }
 
 /*
@@ -203,8 +255,7 @@ void ewmh_update_wm_desktop(void) {
  *
  */
 void ewmh_update_active_window(xcb_window_t window) {
-    xcb_change_property(conn, XCB_PROP_MODE_REPLACE, root,
-                        A__NET_ACTIVE_WINDOW, XCB_ATOM_WINDOW, 32, 1, &window);
+    change_root_property(&active_window, A__NET_ACTIVE_WINDOW, XCB_ATOM_WINDOW, 32, 1, &window);
 }
 
 /*
@@ -212,11 +263,13 @@ void ewmh_update_active_window(xcb_window_t window) {
  *
  */
 void ewmh_update_visible_name(xcb_window_t window, const char *name) {
+    const stats_x_subsystem_t x_subsystem = stats_x_enter(STATS_X_SUBSYSTEM_EWMH);
     if (name != NULL) {
         xcb_change_property(conn, XCB_PROP_MODE_REPLACE, window, A__NET_WM_VISIBLE_NAME, A_UTF8_STRING, 8, strlen(name), name);
     } else {
         xcb_delete_property(conn, window, A__NET_WM_VISIBLE_NAME);
     }
+    stats_x_leave(x_subsystem);
 }
 
 /*
@@ -235,7 +288,15 @@ void ewmh_update_visible_name(xcb_window_t window, const char *name) {
  *
  */
 void ewmh_update_workarea(void) {
+    static bool deleted = false;
+    if (deleted) {
+        return;
+    }
+    deleted = true;
+
+    const stats_x_subsystem_t x_subsystem = stats_x_enter(STATS_X_SUBSYSTEM_EWMH);
     xcb_delete_property(conn, root, A__NET_WORKAREA);
+    stats_x_leave(x_subsystem);
 }
 
 /*
@@ -243,15 +304,7 @@ void ewmh_update_workarea(void) {
  *
  */
 void ewmh_update_client_list(xcb_window_t *list, int num_windows) {
-    xcb_change_property(
-        conn,
-        XCB_PROP_MODE_REPLACE,
-        root,
-        A__NET_CLIENT_LIST,
-        XCB_ATOM_WINDOW,
-        32,
-        num_windows,
-        list);
+    change_root_property(&client_list, A__NET_CLIENT_LIST, XCB_ATOM_WINDOW, 32, num_windows, list);
 }
 
 /*
@@ -259,15 +312,7 @@ void ewmh_update_client_list(xcb_window_t *list, int num_windows) {
  *
  */
 void ewmh_update_client_list_stacking(xcb_window_t *stack, int num_windows) {
-    xcb_change_property(
-        conn,
-        XCB_PROP_MODE_REPLACE,
-        root,
-        A__NET_CLIENT_LIST_STACKING,
-        XCB_ATOM_WINDOW,
-        32,
-        num_windows,
-        stack);
+    change_root_property(&client_list_stacking, A__NET_CLIENT_LIST_STACKING, XCB_ATOM_WINDOW, 32, num_windows, stack);
 }
 
 /*
@@ -275,6 +320,7 @@ void ewmh_update_client_list_stacking(xcb_window_t *stack, int num_windows) {
  *
  */
 void ewmh_update_sticky(xcb_window_t window, bool sticky) {
+    const stats_x_subsystem_t x_subsystem = stats_x_enter(STATS_X_SUBSYSTEM_EWMH);
     if (sticky) {
         DLOG("Setting _NET_WM_STATE_STICKY for window = %d.\n", window);
         xcb_add_property_atom(conn, window, A__NET_WM_STATE, A__NET_WM_STATE_STICKY);
@@ -282,6 +328,7 @@ void ewmh_update_sticky(xcb_window_t window, bool sticky) {
         DLOG("Removing _NET_WM_STATE_STICKY for window = %d.\n", window);
         xcb_remove_property_atom(conn, window, A__NET_WM_STATE, A__NET_WM_STATE_STICKY);
     }
+    stats_x_leave(x_subsystem);
 }
 
 /*
@@ -289,6 +336,7 @@ void ewmh_update_sticky(xcb_window_t window, bool sticky) {
  *
  */
 void ewmh_update_focused(xcb_window_t window, bool is_focused) {
+    const stats_x_subsystem_t x_subsystem = stats_x_enter(STATS_X_SUBSYSTEM_EWMH);
     if (is_focused) {
         DLOG("Setting _NET_WM_STATE_FOCUSED for window = %d.\n", window);
         xcb_add_property_atom(conn, window, A__NET_WM_STATE, A__NET_WM_STATE_FOCUSED);
@@ -296,6 +344,7 @@ void ewmh_update_focused(xcb_window_t window, bool is_focused) {
         DLOG("Removing _NET_WM_STATE_FOCUSED for window = %d.\n", window);
         xcb_remove_property_atom(conn, window, A__NET_WM_STATE, A__NET_WM_STATE_FOCUSED);
     }
+    stats_x_leave(x_subsystem);
 }
 
 /*
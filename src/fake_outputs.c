@@ -56,6 +56,7 @@ void fake_outputs_init(const char *output_spec) {
                can always see the complete workspace */
             new_output->rect.width = min(new_output->rect.width, width);
             new_output->rect.height = min(new_output->rect.height, height);
+            output_index_invalidate();
         } else {
             struct output_name *output_name = scalloc(1, sizeof(struct output_name));
             new_output = scalloc(1, sizeof(Output));
@@ -73,6 +74,7 @@ void fake_outputs_init(const char *output_spec) {
                 TAILQ_INSERT_HEAD(&outputs, new_output, outputs);
             else
                 TAILQ_INSERT_TAIL(&outputs, new_output, outputs);
+            output_index_invalidate();
             output_init_con(new_output);
             init_ws_for_output(new_output);
             num_screens++;
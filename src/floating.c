@@ -7,6 +7,7 @@
  * floating.c: Floating windows.
  *
  */
+#define LOG_CATEGORY LOG_CATEGORY_FLOATING
 #include "all.h"
 
 #ifndef MAX
@@ -285,6 +286,7 @@ void floating_enable(Con *con, bool automatic) {
      * is necessary because otherwise the workspace might be empty (and get
      * closed in tree_close_internal()) even though it’s not. */
     TAILQ_INSERT_HEAD(&(ws->floating_head), nc, floating_windows);
+    con_count_urgency(nc);
 
     struct focus_head *fh = &(ws->focus_head);
     if (focus_before_parent) {
@@ -338,10 +340,13 @@ void floating_enable(Con *con, bool automatic) {
 
     TAILQ_INSERT_TAIL(&(nc->nodes_head), con, nodes);
     TAILQ_INSERT_TAIL(&(nc->focus_head), con, focused);
+    nc->num_children++;
+    con_invalidate_tree_representation(nc);
 
     /* 3: attach the child to the new parent container. We need to do this
      * because con_border_style_rect() needs to access con->parent. */
     con->parent = nc;
+    con_count_urgency(con);
     con->percent = 1.0;
     con->floating = FLOATING_USER_ON;
 
@@ -560,12 +565,28 @@ void floating_move_to_pointer(Con *con) {
     floating_reposition(con, (Rect){x, y, con->rect.width, con->rect.height});
 }
 
+/*
+ * The state of floating_drag_window() while the drag is in progress.
+ *
+ */
+struct drag_window_params {
+    /* A copy of the button press which started the drag. */
+    xcb_button_press_event_t event;
+
+    Con *con;
+
+    /* The rect before the drag, in case of user revert/cancel. */
+    Rect initial_rect;
+};
+
 DRAGGING_CB(drag_window_callback) {
-    const struct xcb_button_press_event_t *event = extra;
+    const struct drag_window_params *params = extra;
+    const xcb_button_press_event_t *event = &(params->event);
 
     /* Reposition the client correctly while moving */
     con->rect.x = old_rect->x + (new_x - event->root_x);
     con->rect.y = old_rect->y + (new_y - event->root_y);
+    ipc_invalidate_tree_reply();
 
     render_con(con);
     x_push_node(con);
@@ -579,23 +600,11 @@ DRAGGING_CB(drag_window_callback) {
     tree_render();
 }
 
-/*
- * Called when the user clicked on the titlebar of a floating window.
- * Calls the drag_pointer function with the drag_window callback
- *
- */
-void floating_drag_window(Con *con, const xcb_button_press_event_t *event) {
-    DLOG("floating_drag_window\n");
-
-    /* Push changes before dragging, so that the window gets raised now and not
-     * after the user releases the mouse button */
-    tree_render();
-
-    /* Store the initial rect in case of user revert/cancel */
-    Rect initial_rect = con->rect;
-
-    /* Drag the window */
-    drag_result_t drag_result = drag_pointer(con, event, XCB_NONE, BORDER_TOP /* irrelevant */, XCURSOR_CURSOR_MOVE, drag_window_callback, event);
+static void drag_window_done(drag_result_t result, void *extra) {
+    struct drag_window_params *params = extra;
+    Con *con = params->con;
+    const Rect initial_rect = params->initial_rect;
+    free(params);
 
     if (!con_exists(con)) {
         DLOG("The container has been closed in the meantime.\n");
@@ -603,7 +612,7 @@ void floating_drag_window(Con *con, const xcb_button_press_event_t *event) {
     }
 
     /* If the user cancelled, undo the changes. */
-    if (drag_result == DRAG_REVERT) {
+    if (result == DRAG_REVERT) {
         floating_reposition(con, initial_rect);
         return;
     }
@@ -616,21 +625,72 @@ void floating_drag_window(Con *con, const xcb_button_press_event_t *event) {
 }
 
 /*
- * This is an ugly data structure which we need because there is no standard
- * way of having nested functions (only available as a gcc extension at the
- * moment, clang doesn’t support it) or blocks (only available as a clang
- * extension and only on Mac OS X systems at the moment).
+ * Called when the user clicked on the titlebar of a floating window.
+ * Calls the drag_pointer function with the drag_window callback
+ *
+ */
+void floating_drag_window(Con *con, const xcb_button_press_event_t *event) {
+    DLOG("floating_drag_window\n");
+
+    /* Push changes before dragging, so that the window gets raised now and not
+     * after the user releases the mouse button */
+    tree_render();
+
+    struct drag_window_params *params = smalloc(sizeof(struct drag_window_params));
+    params->event = *event;
+    params->con = con;
+    params->initial_rect = con->rect;
+
+    /* Drag the window */
+    drag_pointer(con, event, XCB_NONE, BORDER_TOP /* irrelevant */, XCURSOR_CURSOR_MOVE, drag_window_callback, drag_window_done, params);
+}
+
+/*
+ * The state of floating_resize_window() while the drag is in progress.
  *
  */
 struct resize_window_callback_params {
-    const border_t corner;
-    const bool proportional;
-    const xcb_button_press_event_t *event;
+    border_t corner;
+    bool proportional;
+
+    /* A copy of the button press which started the drag. */
+    xcb_button_press_event_t event;
+
+    Con *con;
+
+    /* The rect before the drag, in case of revert/cancel. */
+    Rect initial_rect;
+
+    /* Only used with floating_resize_preview outline: the four windows which
+     * make up the outline and the rect it currently shows. */
+    bool use_outline;
+    xcb_window_t outline[4];
+    Rect outline_rect;
 };
 
+/*
+ * Moves the four outline windows (top, bottom, left, right) so that they frame
+ * the given rect.
+ *
+ */
+static void configure_outline(xcb_window_t outline[4], Rect rect) {
+    const uint32_t width = logical_px(2);
+    const uint32_t edges[4][4] = {
+        {rect.x, rect.y, rect.width, width},
+        {rect.x, rect.y + max(rect.height, width) - width, rect.width, width},
+        {rect.x, rect.y, width, rect.height},
+        {rect.x + max(rect.width, width) - width, rect.y, width, rect.height},
+    };
+    for (int i = 0; i < 4; i++) {
+        xcb_configure_window(conn, outline[i],
+                             XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y | XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT,
+                             edges[i]);
+    }
+}
+
 DRAGGING_CB(resize_window_callback) {
-    const struct resize_window_callback_params *params = extra;
-    const xcb_button_press_event_t *event = params->event;
+    struct resize_window_callback_params *params = extra;
+    const xcb_button_press_event_t *event = &(params->event);
     border_t corner = params->corner;
 
     int32_t dest_x = con->rect.x;
@@ -674,10 +734,53 @@ DRAGGING_CB(resize_window_callback) {
     con->rect.x = dest_x;
     con->rect.y = dest_y;
 
+    if (params->use_outline) {
+        /* Only move the outline, the window keeps its size until the button
+         * is released (see resize_window_done()). */
+        params->outline_rect = con->rect;
+        con->rect = *old_rect;
+        configure_outline(params->outline, params->outline_rect);
+        xcb_flush(conn);
+        return;
+    }
+
     render_con(con);
     x_push_changes(croot);
 }
 
+static void resize_window_done(drag_result_t result, void *extra) {
+    struct resize_window_callback_params *params = extra;
+
+    if (params->use_outline) {
+        for (int i = 0; i < 4; i++)
+            xcb_destroy_window(conn, params->outline[i]);
+        xcb_flush(conn);
+    }
+
+    Con *con = params->con;
+    if (!con_exists(con)) {
+        DLOG("The container has been closed in the meantime.\n");
+        free(params);
+        return;
+    }
+
+    /* If the user cancels, undo the resize */
+    if (result == DRAG_REVERT) {
+        floating_reposition(con, params->initial_rect);
+    } else if (params->use_outline && memcmp(&(params->outline_rect), &(params->initial_rect), sizeof(Rect)) != 0) {
+        /* The window itself was not touched during the drag, so resize it
+         * to the outline now, in one go. */
+        con->rect = params->outline_rect;
+        render_con(con);
+        x_push_changes(croot);
+    }
+    free(params);
+
+    /* If this is a scratchpad window, don't auto center it from now on. */
+    if (con->scratchpad_state == SCRATCHPAD_FRESH)
+        con->scratchpad_state = SCRATCHPAD_CHANGED;
+}
+
 /*
  * Called when the user clicked on a floating window while holding the
  * floating_modifier and the right mouse button.
@@ -706,157 +809,209 @@ void floating_resize_window(Con *con, const bool proportional,
         cursor = (corner & BORDER_LEFT) ? XCURSOR_CURSOR_BOTTOM_LEFT_CORNER : XCURSOR_CURSOR_BOTTOM_RIGHT_CORNER;
     }
 
-    struct resize_window_callback_params params = {corner, proportional, event};
-
+    struct resize_window_callback_params *params = scalloc(1, sizeof(struct resize_window_callback_params));
+    params->corner = corner;
+    params->proportional = proportional;
+    params->event = *event;
+    params->con = con;
     /* get the initial rect in case of revert/cancel */
-    Rect initial_rect = con->rect;
-
-    drag_result_t drag_result = drag_pointer(con, event, XCB_NONE, BORDER_TOP /* irrelevant */, cursor, resize_window_callback, &params);
-
-    if (!con_exists(con)) {
-        DLOG("The container has been closed in the meantime.\n");
-        return;
+    params->initial_rect = con->rect;
+    params->outline_rect = con->rect;
+    params->use_outline = (config.floating_resize_preview == FRP_OUTLINE);
+    if (params->use_outline) {
+        uint32_t mask = XCB_CW_BACK_PIXEL | XCB_CW_OVERRIDE_REDIRECT;
+        uint32_t values[] = {config.client.focused.border.colorpixel, 1};
+        for (int i = 0; i < 4; i++) {
+            params->outline[i] = create_window(conn, (Rect){0, 0, 1, 1}, XCB_COPY_FROM_PARENT, XCB_COPY_FROM_PARENT,
+                                               XCB_WINDOW_CLASS_INPUT_OUTPUT, cursor, true, mask, values);
+        }
+        configure_outline(params->outline, params->outline_rect);
+        for (int i = 0; i < 4; i++)
+            xcb_circulate_window(conn, XCB_CIRCULATE_RAISE_LOWEST, params->outline[i]);
+        xcb_flush(conn);
     }
 
-    /* If the user cancels, undo the resize */
-    if (drag_result == DRAG_REVERT)
-        floating_reposition(con, initial_rect);
-
-    /* If this is a scratchpad window, don't auto center it from now on. */
-    if (con->scratchpad_state == SCRATCHPAD_FRESH)
-        con->scratchpad_state = SCRATCHPAD_CHANGED;
+    drag_pointer(con, event, XCB_NONE, BORDER_TOP /* irrelevant */, cursor, resize_window_callback, resize_window_done, params);
 }
 
-/* Custom data structure used to track dragging-related events. */
-struct drag_x11_cb {
-    ev_prepare prepare;
-
-    /* Whether this modal event loop should be exited and with which result. */
-    drag_result_t result;
-
+/* The drag which is in progress (see drag_pointer()), if any. */
+struct drag_session {
     /* The container that is being dragged or resized, or NULL if this is a
      * drag of the resize handle. */
     Con *con;
 
-    /* The dimensions of con when the loop was started. */
+    /* The dimensions of con when the drag was started. */
     Rect old_rect;
 
     /* The callback to invoke after every pointer movement. */
     callback_t callback;
 
-    /* User data pointer for callback. */
-    const void *extra;
+    /* The callback to invoke once the drag ended. */
+    drag_done_t done;
+
+    /* User data pointer for callback and done. */
+    void *extra;
+
+    /* The newest pointer movement which was not yet passed to callback
+     * because the previous one was less than a frame ago. */
+    xcb_motion_notify_event_t *pending_motion;
+
+    /* When callback was called the last time. */
+    ev_tstamp last_callback;
+
+    /* Fires when pending_motion is due. */
+    ev_timer pace;
 };
 
-static bool drain_drag_events(EV_P, struct drag_x11_cb *dragloop) {
-    xcb_motion_notify_event_t *last_motion_notify = NULL;
-    xcb_generic_event_t *event;
-
-    while ((event = xcb_poll_for_event(conn)) != NULL) {
-        if (event->response_type == 0) {
-            xcb_generic_error_t *error = (xcb_generic_error_t *)event;
-            DLOG("X11 Error received (probably harmless)! sequence 0x%x, error_code = %d\n",
-                 error->sequence, error->error_code);
-            free(event);
-            continue;
-        }
+static struct drag_session *drag = NULL;
 
-        /* Strip off the highest bit (set if the event is generated) */
-        int type = (event->response_type & 0x7F);
+/*
+ * Returns the time between two frames on the output the pointer is on.
+ * There is no point in moving or resizing a window more often than that,
+ * while high polling rate mice can generate a lot more motion events.
+ *
+ */
+static ev_tstamp drag_frame_interval(const xcb_motion_notify_event_t *event) {
+    Output *output = get_output_containing(event->root_x, event->root_y);
+    const double rate = (output != NULL && output->refresh_rate > 0 ? output->refresh_rate : 60.0);
+    return 1.0 / rate;
+}
 
-        switch (type) {
-            case XCB_BUTTON_RELEASE:
-                dragloop->result = DRAG_SUCCESS;
-                break;
+/*
+ * Passes the pending pointer movement to the callback.
+ *
+ */
+static void drag_apply_motion(void) {
+    const stats_x_subsystem_t x_subsystem = stats_x_enter(STATS_X_SUBSYSTEM_FLOATING);
 
-            case XCB_KEY_PRESS:
-                DLOG("A key was pressed during drag, reverting changes.\n");
-                dragloop->result = DRAG_REVERT;
-                handle_event(type, event);
-                break;
+    /* Ensure that we are either dragging the resize handle (con is NULL) or that the
+     * container still exists. The latter might not be true, e.g., if the window closed
+     * for any reason while the user was dragging it. */
+    if (!drag->con || con_exists(drag->con)) {
+        drag->callback(
+            drag->con,
+            &(drag->old_rect),
+            drag->pending_motion->root_x,
+            drag->pending_motion->root_y,
+            drag->extra);
+    }
+    FREE(drag->pending_motion);
+    drag->last_callback = ev_time();
 
-            case XCB_UNMAP_NOTIFY: {
-                xcb_unmap_notify_event_t *unmap_event = (xcb_unmap_notify_event_t *)event;
-                Con *con = con_by_window_id(unmap_event->window);
+    xcb_flush(conn);
+    stats_x_leave(x_subsystem);
+}
 
-                if (con != NULL) {
-                    DLOG("UnmapNotify for window 0x%08x (container %p)\n", unmap_event->window, con);
+static void drag_pace_cb(EV_P_ ev_timer *w, int revents) {
+    if (drag != NULL && drag->pending_motion != NULL)
+        drag_apply_motion();
+}
 
-                    if (con_get_workspace(con) == con_get_workspace(focused)) {
-                        DLOG("UnmapNotify for a managed window on the current workspace, aborting\n");
-                        dragloop->result = DRAG_ABORT;
-                    }
-                }
+/*
+ * Ends the drag which is in progress: releases the grabs and calls its done
+ * callback with the given result.
+ *
+ */
+static void drag_end(drag_result_t result) {
+    struct drag_session *session = drag;
+    drag = NULL;
 
-                handle_event(type, event);
-                break;
-            }
+    ev_timer_stop(main_loop, &(session->pace));
+    FREE(session->pending_motion);
 
-            case XCB_MOTION_NOTIFY:
-                /* motion_notify events are saved for later */
-                FREE(last_motion_notify);
-                last_motion_notify = (xcb_motion_notify_event_t *)event;
-                break;
+    const stats_x_subsystem_t x_subsystem = stats_x_enter(STATS_X_SUBSYSTEM_FLOATING);
+    xcb_ungrab_keyboard(conn, XCB_CURRENT_TIME);
+    xcb_ungrab_pointer(conn, XCB_CURRENT_TIME);
+    xcb_flush(conn);
+
+    session->done(result, session->extra);
+    free(session);
+    stats_x_leave(x_subsystem);
+}
 
-            default:
-                DLOG("Passing to original handler\n");
-                handle_event(type, event);
-                break;
+/*
+ * Handles the events which belong to the drag in progress, if any: pointer
+ * movements are passed to the drag's callback (at most once per frame), the
+ * button release ends the drag, a key press reverts it and unmapping a window
+ * on the current workspace aborts it.
+ *
+ * Returns true if the event was consumed; all other events are handled by
+ * handle_event() as usual, so the rest of i3 keeps running during a drag.
+ *
+ */
+bool drag_handle_event(int type, xcb_generic_event_t *event) {
+    if (drag == NULL)
+        return false;
+
+    switch (type) {
+        case XCB_BUTTON_RELEASE: {
+            /* The drag's MotionNotify events do not reach
+             * handle_motion_notify(), so record where it ended. */
+            xcb_button_release_event_t *release_event = (xcb_button_release_event_t *)event;
+            x_set_pointer_position(release_event->root_x, release_event->root_y, last_timestamp);
+
+            /* Always apply the final position. */
+            if (drag->pending_motion != NULL)
+                drag_apply_motion();
+            drag_end(DRAG_SUCCESS);
+            return true;
         }
 
-        if (last_motion_notify != (xcb_motion_notify_event_t *)event)
-            free(event);
+        case XCB_KEY_PRESS:
+            DLOG("A key was pressed during drag, reverting changes.\n");
+            drag_end(DRAG_REVERT);
+            return false;
 
-        if (dragloop->result != DRAGGING) {
-            ev_break(EV_A_ EVBREAK_ONE);
-            if (dragloop->result == DRAG_SUCCESS) {
-                /* Ensure motion notify events are handled. */
-                break;
-            } else {
-                free(last_motion_notify);
-                return true;
+        case XCB_UNMAP_NOTIFY: {
+            xcb_unmap_notify_event_t *unmap_event = (xcb_unmap_notify_event_t *)event;
+            Con *con = con_by_window_id(unmap_event->window);
+
+            if (con != NULL) {
+                DLOG("UnmapNotify for window 0x%08x (container %p)\n", unmap_event->window, con);
+
+                if (con_get_workspace(con) == con_get_workspace(focused)) {
+                    DLOG("UnmapNotify for a managed window on the current workspace, aborting\n");
+                    drag_end(DRAG_ABORT);
+                }
             }
+            return false;
         }
-    }
 
-    if (last_motion_notify == NULL) {
-        return true;
-    }
-
-    /* Ensure that we are either dragging the resize handle (con is NULL) or that the
-     * container still exists. The latter might not be true, e.g., if the window closed
-     * for any reason while the user was dragging it. */
-    if (!dragloop->con || con_exists(dragloop->con)) {
-        dragloop->callback(
-            dragloop->con,
-            &(dragloop->old_rect),
-            last_motion_notify->root_x,
-            last_motion_notify->root_y,
-            dragloop->extra);
-    }
-    FREE(last_motion_notify);
+        case XCB_MOTION_NOTIFY: {
+            /* Only the newest pointer position matters. */
+            FREE(drag->pending_motion);
+            drag->pending_motion = smalloc(sizeof(xcb_motion_notify_event_t));
+            memcpy(drag->pending_motion, event, sizeof(xcb_motion_notify_event_t));
+
+            /* Move or resize at most once per frame. */
+            const ev_tstamp wait = drag->last_callback +
+                                   drag_frame_interval(drag->pending_motion) -
+                                   ev_time();
+            if (wait > 0) {
+                if (!ev_is_active(&(drag->pace))) {
+                    ev_timer_set(&(drag->pace), wait, 0.);
+                    ev_timer_start(main_loop, &(drag->pace));
+                }
+                return true;
+            }
 
-    xcb_flush(conn);
-    return dragloop->result != DRAGGING;
-}
+            if (ev_is_active(&(drag->pace)))
+                ev_timer_stop(main_loop, &(drag->pace));
+            drag_apply_motion();
+            return true;
+        }
 
-static void xcb_drag_prepare_cb(EV_P_ ev_prepare *w, int revents) {
-    struct drag_x11_cb *dragloop = (struct drag_x11_cb *)w->data;
-    while (!drain_drag_events(EV_A, dragloop)) {
-        /* repeatedly drain events: draining might produce additional ones */
+        default:
+            return false;
     }
 }
 
 /*
- * This function grabs your pointer and keyboard and lets you drag stuff around
- * (borders). Every time you move your mouse, an XCB_MOTION_NOTIFY event will
- * be received and the given callback will be called with the parameters
- * specified (client, border on which the click originally was), the original
- * rect of the client, the event and the new coordinates (x, y).
+ * Grabs the pointer (confined to the given window, with the given cursor) and
+ * the keyboard for a drag. Returns false if either grab failed.
  *
  */
-drag_result_t drag_pointer(Con *con, const xcb_button_press_event_t *event, xcb_window_t confine_to,
-                           border_t border, int cursor, callback_t callback, const void *extra) {
+static bool drag_grab(xcb_window_t confine_to, int cursor) {
     xcb_cursor_t xcursor = (cursor && xcursor_supported) ? xcursor_get_cursor(cursor) : XCB_NONE;
 
     /* Grab the pointer */
@@ -877,7 +1032,7 @@ drag_result_t drag_pointer(Con *con, const xcb_button_press_event_t *event, xcb_
     if ((reply = xcb_grab_pointer_reply(conn, cookie, &error)) == NULL) {
         ELOG("Could not grab pointer (error_code = %d)\n", error->error_code);
         free(error);
-        return DRAG_ABORT;
+        return false;
     }
 
     free(reply);
@@ -898,36 +1053,50 @@ drag_result_t drag_pointer(Con *con, const xcb_button_press_event_t *event, xcb_
         ELOG("Could not grab keyboard (error_code = %d)\n", error->error_code);
         free(error);
         xcb_ungrab_pointer(conn, XCB_CURRENT_TIME);
-        return DRAG_ABORT;
+        return false;
     }
 
     free(keyb_reply);
+    return true;
+}
 
-    /* Go into our own event loop */
-    struct drag_x11_cb loop = {
-        .result = DRAGGING,
-        .con = con,
-        .callback = callback,
-        .extra = extra,
-    };
-    ev_prepare *prepare = &loop.prepare;
-    if (con)
-        loop.old_rect = con->rect;
-    ev_prepare_init(prepare, xcb_drag_prepare_cb);
-    prepare->data = &loop;
-    main_set_x11_cb(false);
-    ev_prepare_start(main_loop, prepare);
-
-    ev_loop(main_loop, 0);
-
-    ev_prepare_stop(main_loop, prepare);
-    main_set_x11_cb(true);
+/*
+ * This function grabs your pointer and keyboard and lets you drag stuff around
+ * (borders). Every time you move your mouse, an XCB_MOTION_NOTIFY event will
+ * be received and the given callback will be called with the parameters
+ * specified (client, border on which the click originally was), the original
+ * rect of the client, the event and the new coordinates (x, y).
+ *
+ * The drag is not modal: this function returns right away and the events of
+ * the drag are handled by drag_handle_event() in the main event loop. Once the
+ * drag ended (or if it could not be started), done is called with the result
+ * and extra.
+ *
+ */
+void drag_pointer(Con *con, const xcb_button_press_event_t *event, xcb_window_t confine_to,
+                  border_t border, int cursor, callback_t callback, drag_done_t done, void *extra) {
+    if (drag != NULL) {
+        ELOG("Another drag is in progress, not starting a new one.\n");
+        done(DRAG_ABORT, extra);
+        return;
+    }
 
-    xcb_ungrab_keyboard(conn, XCB_CURRENT_TIME);
-    xcb_ungrab_pointer(conn, XCB_CURRENT_TIME);
-    xcb_flush(conn);
+    const stats_x_subsystem_t x_subsystem = stats_x_enter(STATS_X_SUBSYSTEM_FLOATING);
+    const bool grabbed = drag_grab(confine_to, cursor);
+    stats_x_leave(x_subsystem);
+    if (!grabbed) {
+        done(DRAG_ABORT, extra);
+        return;
+    }
 
-    return loop.result;
+    drag = scalloc(1, sizeof(struct drag_session));
+    drag->con = con;
+    drag->callback = callback;
+    drag->done = done;
+    drag->extra = extra;
+    if (con)
+        drag->old_rect = con->rect;
+    ev_timer_init(&(drag->pace), drag_pace_cb, 0., 0.);
 }
 
 /*
@@ -21,11 +21,19 @@ int randr_base = -1;
 int xkb_base = -1;
 int xkb_current_group;
 int shape_base = -1;
+int sync_base = -1;
 
 /* After mapping/unmapping windows, a notify event is generated. However, we don’t want it,
    since it’d trigger an infinite loop of switching between the different windows when
    changing workspaces */
-static SLIST_HEAD(ignore_head, Ignore_Event) ignore_events;
+
+/* The number of sequence numbers for which ignored events are remembered
+ * (must be a power of two, at most 65536). The table is indexed by sequence
+ * number, so an entry expires at the latest when the sequence number which
+ * is IGNORE_EVENTS_SIZE newer gets ignored. */
+#define IGNORE_EVENTS_SIZE 8192
+
+static struct Ignore_Event ignore_events[IGNORE_EVENTS_SIZE];
 
 /*
  * Adds the given sequence to the list of events which are ignored.
@@ -36,13 +44,47 @@ static SLIST_HEAD(ignore_head, Ignore_Event) ignore_events;
  *
  */
 void add_ignore_event(const int sequence, const int response_type) {
-    struct Ignore_Event *event = smalloc(sizeof(struct Ignore_Event));
+    add_ignore_event_range(sequence, sequence, response_type);
+}
 
-    event->sequence = sequence;
-    event->response_type = response_type;
-    event->added = time(NULL);
+/*
+ * Like add_ignore_event(), but ignores all sequence numbers from first up to
+ * and including last. This is used to ignore all events caused by a batch of
+ * requests.
+ *
+ */
+void add_ignore_event_range(const int first, const int last, const int response_type) {
+    const time_t now = time(NULL);
+
+    /* Events only carry the lower 16 bits of the sequence number, so we work
+     * modulo 2^16. Only the last IGNORE_EVENTS_SIZE sequence numbers of very
+     * long ranges fit into the table. */
+    uint16_t count = (uint16_t)(last - first);
+    uint16_t sequence = (uint16_t)first;
+    if (count >= IGNORE_EVENTS_SIZE) {
+        sequence = (uint16_t)(last - (IGNORE_EVENTS_SIZE - 1));
+        count = IGNORE_EVENTS_SIZE - 1;
+    }
 
-    SLIST_INSERT_HEAD(&ignore_events, event, ignore_events);
+    for (int i = 0; i <= count; i++, sequence++) {
+        struct Ignore_Event *event = &ignore_events[sequence & (IGNORE_EVENTS_SIZE - 1)];
+
+        /* Reuse entries of older sequence numbers and expired entries. */
+        if (event->sequence != sequence || (now - event->added) > 5) {
+            event->sequence = sequence;
+            event->response_types[0] = 0;
+            event->response_types[1] = 0;
+        }
+        event->added = now;
+
+        if (response_type == -1) {
+            event->response_types[0] = UINT64_MAX;
+            event->response_types[1] = UINT64_MAX;
+        } else {
+            const int type = (response_type & 0x7F);
+            event->response_types[type / 64] |= (UINT64_C(1) << (type % 64));
+        }
+    }
 }
 
 /*
@@ -50,35 +92,86 @@ void add_ignore_event(const int sequence, const int response_type) {
  *
  */
 bool event_is_ignored(const int sequence, const int response_type) {
-    struct Ignore_Event *event;
-    time_t now = time(NULL);
-    for (event = SLIST_FIRST(&ignore_events); event != SLIST_END(&ignore_events);) {
-        if ((now - event->added) > 5) {
-            struct Ignore_Event *save = event;
-            event = SLIST_NEXT(event, ignore_events);
-            SLIST_REMOVE(&ignore_events, save, Ignore_Event, ignore_events);
-            free(save);
-        } else
-            event = SLIST_NEXT(event, ignore_events);
-    }
-
-    SLIST_FOREACH(event, &ignore_events, ignore_events) {
-        if (event->sequence != sequence)
-            continue;
+    const struct Ignore_Event *event = &ignore_events[(uint16_t)sequence & (IGNORE_EVENTS_SIZE - 1)];
+    if (event->sequence != (uint16_t)sequence)
+        return false;
 
-        if (event->response_type != -1 &&
-            event->response_type != response_type)
-            continue;
+    const int type = (response_type & 0x7F);
+    if (!(event->response_types[type / 64] & (UINT64_C(1) << (type % 64))))
+        return false;
 
-        /* instead of removing a sequence number we better wait until it gets
-         * garbage collected. it may generate multiple events (there are multiple
-         * enter_notifies for one configure_request, for example). */
-        //SLIST_REMOVE(&ignore_events, event, Ignore_Event, ignore_events);
-        //free(event);
-        return true;
+    /* instead of removing a sequence number we better wait until it gets
+     * garbage collected. it may generate multiple events (there are multiple
+     * enter_notifies for one configure_request, for example). */
+    return (time(NULL) - event->added) <= 5;
+}
+
+/* The error callbacks of requests which may still fail. Requests are sent in
+ * order of their sequence numbers, so appending keeps the queue sorted. */
+static TAILQ_HEAD(error_callbacks_head, Error_Callback) error_callbacks =
+    TAILQ_HEAD_INITIALIZER(error_callbacks);
+
+/*
+ * Returns true if the sequence number a is older than b. Full sequence
+ * numbers are 32 bits wide and wrap around.
+ *
+ */
+static bool sequence_before(const uint32_t a, const uint32_t b) {
+    return (int32_t)(a - b) < 0;
+}
+
+/*
+ * Registers a callback which is called when the X server reports an error for
+ * the request with the given sequence number. This allows sending unchecked
+ * requests instead of waiting for the result with xcb_request_check(): the
+ * error is handled once the event loop receives it.
+ *
+ * data is not owned by the queue, so it should not point to memory which
+ * needs to be freed. Callbacks of requests which succeeded are dropped once a
+ * later event arrives (see retire_error_callbacks()).
+ *
+ */
+void add_error_callback(const unsigned int sequence, error_callback_t callback, void *data) {
+    struct Error_Callback *entry = smalloc(sizeof(struct Error_Callback));
+    entry->sequence = sequence;
+    entry->callback = callback;
+    entry->data = data;
+    TAILQ_INSERT_TAIL(&error_callbacks, entry, callbacks);
+}
+
+/*
+ * Drops the error callbacks of all requests sent before the request with the
+ * given full sequence number. Called for everything the X server sends: since
+ * it handles requests in order, these requests succeeded if no error arrived
+ * for them so far.
+ *
+ */
+void retire_error_callbacks(const uint32_t sequence) {
+    struct Error_Callback *entry;
+    while ((entry = TAILQ_FIRST(&error_callbacks)) != NULL &&
+           sequence_before(entry->sequence, sequence)) {
+        TAILQ_REMOVE(&error_callbacks, entry, callbacks);
+        free(entry);
     }
+}
 
-    return false;
+/*
+ * Calls the callback registered for the request the given error belongs to.
+ * Returns false if no callback was registered.
+ *
+ */
+bool handle_error_callback(xcb_generic_error_t *error) {
+    retire_error_callbacks(error->full_sequence);
+
+    struct Error_Callback *entry = TAILQ_FIRST(&error_callbacks);
+    if (entry == NULL || entry->sequence != error->full_sequence)
+        return false;
+
+    /* A request causes at most one error, so the entry is done. */
+    TAILQ_REMOVE(&error_callbacks, entry, callbacks);
+    entry->callback(error, entry->data);
+    free(entry);
+    return true;
 }
 
 /*
@@ -114,7 +207,91 @@ static void check_crossing_screen_boundary(uint32_t x, uint32_t y) {
 
     /* If the focus changed, we re-render to get updated decorations */
     if (old_focused != focused)
-        tree_render();
+        tree_schedule_render();
+}
+
+/*
+ * Focuses the given container, which the pointer entered.
+ *
+ */
+static void focus_entered_con(Con *con) {
+    /* if this container is already focused, there is nothing to do. */
+    if (con == focused)
+        return;
+
+    /* In the common case of moving the pointer between windows which are all
+     * visible, no geometry changes, so we only redraw the decorations and
+     * update the input focus. */
+    Con *next = con_descend_focused(con);
+    const bool cosmetic = tree_focus_change_is_cosmetic(next);
+
+    /* Get the currently focused workspace to check if the focus change also
+     * involves changing workspaces. If so, we need to call workspace_show() to
+     * correctly update state and send the IPC event. */
+    Con *ws = con_get_workspace(con);
+    if (ws != con_get_workspace(focused))
+        workspace_show(ws);
+
+    focused_id = XCB_NONE;
+    con_focus(next);
+    /* A pending render has to happen first, otherwise we would push tree
+     * changes which were not rendered yet. It pushes the focus, too. */
+    if (cosmetic && !tree_render_is_scheduled())
+        x_push_changes(croot);
+    else
+        tree_schedule_render();
+}
+
+/* Pending focus change while waiting for focus_follows_mouse_delay to expire,
+ * see focus_follows_mouse(). */
+static struct ev_timer *focus_delay_timer = NULL;
+/* The container the pointer entered, and the container which was focused at
+ * that time. */
+static Con *focus_delay_target = NULL;
+static Con *focus_delay_origin = NULL;
+
+static void focus_delay_timer_cb(EV_P_ ev_timer *w, int revents) {
+    ev_timer_stop(main_loop, w);
+
+    Con *con = focus_delay_target;
+    focus_delay_target = NULL;
+
+    /* Don’t override focus changes which happened in the meantime, e.g. by
+     * keyboard. */
+    if (focused != focus_delay_origin || !con_exists(con))
+        return;
+
+    focus_entered_con(con);
+}
+
+/*
+ * Focuses the container the pointer entered. With focus_follows_mouse_delay
+ * set, the focus only changes once the pointer stayed on the container for
+ * the configured time, so sweeping the pointer across windows does not focus
+ * (and redraw, and send IPC events for) every window on the way.
+ *
+ */
+static void focus_follows_mouse(Con *con) {
+    if (config.focus_follows_mouse_delay <= 0) {
+        focus_entered_con(con);
+        return;
+    }
+
+    if (focus_delay_timer == NULL) {
+        focus_delay_timer = scalloc(1, sizeof(struct ev_timer));
+        ev_timer_init(focus_delay_timer, focus_delay_timer_cb, 0., 0.);
+    }
+    ev_timer_stop(main_loop, focus_delay_timer);
+    focus_delay_target = NULL;
+
+    /* Returning to the focused container cancels the pending focus change. */
+    if (con == focused)
+        return;
+
+    focus_delay_target = con;
+    focus_delay_origin = focused;
+    ev_timer_set(focus_delay_timer, config.focus_follows_mouse_delay, 0.);
+    ev_timer_start(main_loop, focus_delay_timer);
 }
 
 /*
@@ -125,6 +302,7 @@ static void handle_enter_notify(xcb_enter_notify_event_t *event) {
     Con *con;
 
     last_timestamp = event->time;
+    x_set_pointer_position(event->root_x, event->root_y, event->time);
 
     DLOG("enter_notify for %08x, mode = %d, detail %d, serial %d\n",
          event->event, event->mode, event->detail, event->sequence);
@@ -171,20 +349,7 @@ static void handle_enter_notify(xcb_enter_notify_event_t *event) {
     if (config.disable_focus_follows_mouse)
         return;
 
-    /* if this container is already focused, there is nothing to do. */
-    if (con == focused)
-        return;
-
-    /* Get the currently focused workspace to check if the focus change also
-     * involves changing workspaces. If so, we need to call workspace_show() to
-     * correctly update state and send the IPC event. */
-    Con *ws = con_get_workspace(con);
-    if (ws != con_get_workspace(focused))
-        workspace_show(ws);
-
-    focused_id = XCB_NONE;
-    con_focus(con_descend_focused(con));
-    tree_render();
+    focus_follows_mouse(con);
 }
 
 /*
@@ -195,6 +360,7 @@ static void handle_enter_notify(xcb_enter_notify_event_t *event) {
  */
 static void handle_motion_notify(xcb_motion_notify_event_t *event) {
     last_timestamp = event->time;
+    x_set_pointer_position(event->root_x, event->root_y, event->time);
 
     /* Skip events where the pointer was over a child window, we are only
      * interested in events on the root window. */
@@ -361,10 +527,12 @@ static void handle_configure_request(xcb_configure_request_event_t *event) {
     if (con->parent && con->parent->type == CT_DOCKAREA) {
         DLOG("Reconfiguring dock window (con = %p).\n", con);
         if (event->value_mask & XCB_CONFIG_WINDOW_HEIGHT) {
-            DLOG("Dock client wants to change height to %d, we can do that.\n", event->height);
+            if (con->geometry.height != event->height) {
+                DLOG("Dock client wants to change height to %d, we can do that.\n", event->height);
 
-            con->geometry.height = event->height;
-            tree_render();
+                con->geometry.height = event->height;
+                tree_schedule_render_output(con_get_output(con));
+            }
         }
 
         if (event->value_mask & XCB_CONFIG_WINDOW_X || event->value_mask & XCB_CONFIG_WINDOW_Y) {
@@ -381,7 +549,8 @@ static void handle_configure_request(xcb_configure_request_event_t *event) {
                 con_detach(con);
                 con_attach(con, nc, false);
 
-                tree_render();
+                tree_schedule_render_output(current_output);
+                tree_schedule_render_output(target->con);
             } else {
                 DLOG("Dock client will not be moved, we only support moving it to another output.\n");
             }
@@ -413,11 +582,11 @@ static void handle_configure_request(xcb_configure_request_event_t *event) {
             DLOG("Focusing con = %p\n", con);
             workspace_show(workspace);
             con_activate(con);
-            tree_render();
+            tree_schedule_render();
         } else if (config.focus_on_window_activation == FOWA_URGENT || (config.focus_on_window_activation == FOWA_SMART && !workspace_is_visible(workspace))) {
             DLOG("Marking con = %p urgent\n", con);
             con_set_urgency(con, true);
-            tree_render();
+            tree_schedule_render();
         } else {
             DLOG("Ignoring request for con = %p.\n", con);
         }
@@ -445,14 +614,20 @@ static void handle_screen_change(xcb_generic_event_t *e) {
     }
     DLOG("root geometry reply: (%d, %d) %d x %d\n", reply->x, reply->y, reply->width, reply->height);
 
+    const bool root_resized = (croot->rect.width != reply->width ||
+                               croot->rect.height != reply->height);
     croot->rect.width = reply->width;
     croot->rect.height = reply->height;
 
-    randr_query_outputs();
+    /* “fullscreen global” containers need to be resized even if no output
+     * changed. */
+    if (!randr_query_outputs() && root_resized)
+        tree_render();
 
     scratchpad_fix_resolution();
 
-    ipc_send_event("output", I3_IPC_EVENT_OUTPUT, "{\"change\":\"unspecified\"}");
+    ipc_invalidate_cached_replies();
+    ipc_send_event(I3_IPC_EVENT_OUTPUT, "{\"change\":\"unspecified\"}", NULL);
 }
 
 /*
@@ -496,7 +671,7 @@ static void handle_unmap_notify_event(xcb_unmap_notify_event_t *event) {
     xcb_delete_property(conn, event->window, A__NET_WM_STATE);
 
     tree_close_internal(con, DONT_KILL_WINDOW, false);
-    tree_render();
+    tree_schedule_render();
 
 ignore_end:
     /* If the client (as opposed to i3) destroyed or unmapped a window, an
@@ -553,6 +728,75 @@ static bool window_name_changed(i3Window *window, char *old_name) {
     return (strcmp(old_name, i3string_as_utf8(window->name)) != 0);
 }
 
+/* Running while title updates are being rate limited, see title_changed(). */
+static struct ev_timer *title_update_timer = NULL;
+/* Whether a title changed since the last time the timer fired. */
+static bool title_update_pending = false;
+
+/*
+ * Redraws the decorations and sends the window::title IPC events of all
+ * windows whose title changed while title updates were being rate limited.
+ *
+ */
+static void title_update_flush(void) {
+    x_push_changes(croot);
+
+    Con *con;
+    TAILQ_FOREACH(con, &all_cons, all_cons) {
+        if (con->window == NULL || !con->window->title_event_pending)
+            continue;
+
+        con->window->title_event_pending = false;
+        ipc_send_window_event("title", con);
+    }
+}
+
+static void title_update_timer_cb(EV_P_ ev_timer *w, int revents) {
+    if (!title_update_pending) {
+        /* Nothing changed within the last interval, so the next title change
+         * can be displayed right away. */
+        ev_timer_stop(main_loop, w);
+        return;
+    }
+
+    title_update_pending = false;
+    title_update_flush();
+}
+
+/*
+ * Displays the changed title of the given container's window. With
+ * title_update_interval set, the first change is displayed immediately, but
+ * further changes within the interval are only flushed once it expires. This
+ * caps the amount of redrawing clients can cause by updating their title many
+ * times per second.
+ *
+ */
+static void title_changed(Con *con, bool name_changed) {
+    if (config.title_update_interval <= 0) {
+        x_push_changes(croot);
+        if (name_changed)
+            ipc_send_window_event("title", con);
+        return;
+    }
+
+    if (name_changed)
+        con->window->title_event_pending = true;
+
+    if (title_update_timer != NULL && ev_is_active(title_update_timer)) {
+        title_update_pending = true;
+        return;
+    }
+
+    if (title_update_timer == NULL) {
+        title_update_timer = scalloc(1, sizeof(struct ev_timer));
+        ev_timer_init(title_update_timer, title_update_timer_cb, 0., 0.);
+    }
+    ev_timer_set(title_update_timer, config.title_update_interval, config.title_update_interval);
+    ev_timer_start(main_loop, title_update_timer);
+
+    title_update_flush();
+}
+
 /*
  * Called when a window changes its title
  *
@@ -566,13 +810,12 @@ static bool handle_windowname_change(void *data, xcb_connection_t *conn, uint8_t
     char *old_name = (con->window->name != NULL ? sstrdup(i3string_as_utf8(con->window->name)) : NULL);
 
     window_update_name(con->window, prop);
+    /* The title is dumped right away, even if redrawing it is rate limited. */
+    ipc_invalidate_tree_reply();
 
     con = remanage_window(con);
 
-    x_push_changes(croot);
-
-    if (window_name_changed(con->window, old_name))
-        ipc_send_window_event("title", con);
+    title_changed(con, window_name_changed(con->window, old_name));
 
     FREE(old_name);
 
@@ -593,13 +836,12 @@ static bool handle_windowname_change_legacy(void *data, xcb_connection_t *conn,
     char *old_name = (con->window->name != NULL ? sstrdup(i3string_as_utf8(con->window->name)) : NULL);
 
     window_update_name_legacy(con->window, prop);
+    /* The title is dumped right away, even if redrawing it is rate limited. */
+    ipc_invalidate_tree_reply();
 
     con = remanage_window(con);
 
-    x_push_changes(croot);
-
-    if (window_name_changed(con->window, old_name))
-        ipc_send_window_event("title", con);
+    title_changed(con, window_name_changed(con->window, old_name));
 
     FREE(old_name);
 
@@ -617,6 +859,7 @@ static bool handle_windowrole_change(void *data, xcb_connection_t *conn, uint8_t
         return false;
 
     window_update_role(con->window, prop);
+    ipc_invalidate_tree_reply();
 
     con = remanage_window(con);
 
@@ -638,9 +881,15 @@ static void handle_expose_event(xcb_expose_event_t *event) {
     }
 
     /* Since we render to our surface on every change anyways, expose events
-     * only tell us that the X server lost (parts of) the window contents. */
-    draw_util_copy_surface(&(parent->frame_buffer), &(parent->frame),
-                           0, 0, 0, 0, parent->rect.width, parent->rect.height);
+     * only tell us that the X server lost (parts of) the window contents. We
+     * collect the exposed areas like damage from drawing and copy them from
+     * the frame buffer once the last event of the series (count == 0)
+     * arrived. */
+    x_damage_frame(parent, event->x, event->y, event->width, event->height);
+    if (event->count > 0)
+        return;
+
+    x_flush_frame(parent);
     xcb_flush(conn);
 }
 
@@ -710,11 +959,11 @@ static void handle_client_message(xcb_client_message_event_t *event) {
         } else if (event->data.data32[1] == A__NET_WM_STATE_STICKY) {
             DLOG("Received a client message to modify _NET_WM_STATE_STICKY.\n");
             if (event->data.data32[0] == _NET_WM_STATE_ADD)
-                con->sticky = true;
+                con_set_sticky(con, true);
             else if (event->data.data32[0] == _NET_WM_STATE_REMOVE)
-                con->sticky = false;
+                con_set_sticky(con, false);
             else if (event->data.data32[0] == _NET_WM_STATE_TOGGLE)
-                con->sticky = !con->sticky;
+                con_set_sticky(con, !con->sticky);
 
             DLOG("New sticky status for con = %p is %i.\n", con, con->sticky);
             ewmh_update_sticky(con->window->id, con->sticky);
@@ -722,7 +971,7 @@ static void handle_client_message(xcb_client_message_event_t *event) {
             ewmh_update_wm_desktop();
         }
 
-        tree_render();
+        tree_schedule_render();
     } else if (event->type == A__NET_ACTIVE_WINDOW) {
         if (event->format != 32)
             return;
@@ -778,10 +1027,13 @@ static void handle_client_message(xcb_client_message_event_t *event) {
                 DLOG("Ignoring request for con = %p.\n", con);
         }
 
-        tree_render();
+        tree_schedule_render();
     } else if (event->type == A_I3_SYNC) {
         xcb_window_t window = event->data.data32[0];
         uint32_t rnd = event->data.data32[1];
+        /* The client expects all previous requests to be reflected in X11
+         * once it receives our reply. */
+        tree_render_flush();
         sync_respond(window, rnd);
     } else if (event->type == A__NET_REQUEST_FRAME_EXTENTS) {
         /*
@@ -840,7 +1092,7 @@ static void handle_client_message(xcb_client_message_event_t *event) {
 
         DLOG("Handling request to focus workspace %s\n", ws->name);
         workspace_show(ws);
-        tree_render();
+        tree_schedule_render();
     } else if (event->type == A__NET_WM_DESKTOP) {
         uint32_t index = event->data.data32[0];
         DLOG("Request to move window %d to EWMH desktop index %d\n", event->window, index);
@@ -858,7 +1110,7 @@ static void handle_client_message(xcb_client_message_event_t *event) {
 
             floating_enable(con, false);
 
-            con->sticky = true;
+            con_set_sticky(con, true);
             ewmh_update_sticky(con->window->id, true);
             output_push_sticky_windows(focused);
         } else {
@@ -871,7 +1123,7 @@ static void handle_client_message(xcb_client_message_event_t *event) {
             con_move_to_workspace(con, ws, true, false, false);
         }
 
-        tree_render();
+        tree_schedule_render();
         ewmh_update_wm_desktop();
     } else if (event->type == A__NET_CLOSE_WINDOW) {
         /*
@@ -887,7 +1139,7 @@ static void handle_client_message(xcb_client_message_event_t *event) {
                 last_timestamp = event->data.data32[0];
 
             tree_close_internal(con, KILL_WINDOW, false);
-            tree_render();
+            tree_schedule_render();
         } else {
             DLOG("Couldn't find con for _NET_CLOSE_WINDOW request. (window = %d)\n", event->window);
         }
@@ -987,7 +1239,7 @@ static bool handle_normal_hints(void *data, xcb_connection_t *conn, uint8_t stat
         Con *floating = con_inside_floating(con);
         if (floating) {
             floating_check_size(con, false);
-            tree_render();
+            tree_schedule_render();
         }
     }
 
@@ -1012,7 +1264,7 @@ static bool handle_hints(void *data, xcb_connection_t *conn, uint8_t state, xcb_
         reply = xcb_get_property_reply(conn, xcb_icccm_get_wm_hints(conn, window), NULL);
     window_update_hints(con->window, reply, &urgency_hint);
     con_set_urgency(con, urgency_hint);
-    tree_render();
+    tree_schedule_render();
 
     return true;
 }
@@ -1041,6 +1293,7 @@ static bool handle_transient_for(void *data, xcb_connection_t *conn, uint8_t sta
     }
 
     window_update_transient_for(con->window, prop);
+    ipc_invalidate_tree_reply();
 
     return true;
 }
@@ -1125,7 +1378,7 @@ static void handle_focus_in(xcb_focus_in_event_t *event) {
     con_activate(con);
     /* We update focused_id because we don’t need to set focus again */
     focused_id = event->event;
-    tree_render();
+    tree_schedule_render();
 }
 
 /*
@@ -1165,6 +1418,7 @@ static bool handle_class_change(void *data, xcb_connection_t *conn, uint8_t stat
     }
 
     window_update_class(con->window, prop);
+    ipc_invalidate_tree_reply();
 
     con = remanage_window(con);
 
@@ -1234,6 +1488,7 @@ static bool handle_strut_partial_change(void *data, xcb_connection_t *conn, uint
 
     DLOG("That is con %p / %s\n", con, con->name);
 
+    const struct reservedpx old_reserved = con->window->reserved;
     window_update_strut_partial(con->window, prop);
 
     /* we only handle this change for dock clients */
@@ -1241,6 +1496,13 @@ static bool handle_strut_partial_change(void *data, xcb_connection_t *conn, uint
         return true;
     }
 
+    /* Some dock clients set the same value on every change of their
+     * contents, there is nothing to do in that case. */
+    if (memcmp(&old_reserved, &(con->window->reserved), sizeof(struct reservedpx)) == 0) {
+        DLOG("Reserved pixels did not change, ignoring.\n");
+        return true;
+    }
+
     Con *search_at = croot;
     Con *output = con_get_output(con);
     if (output != NULL) {
@@ -1249,6 +1511,7 @@ static bool handle_strut_partial_change(void *data, xcb_connection_t *conn, uint
     }
 
     /* find out the desired position of this dock window */
+    const int old_dock = con->window->dock;
     if (con->window->reserved.top > 0 && con->window->reserved.bottom == 0) {
         DLOG("Top dock client\n");
         con->window->dock = W_DOCK_TOP;
@@ -1268,17 +1531,45 @@ static bool handle_strut_partial_change(void *data, xcb_connection_t *conn, uint
         }
     }
 
-    /* find the dockarea */
-    Con *dockarea = con_for_window(search_at, con->window, NULL);
-    assert(dockarea != NULL);
+    /* The dock client stays in its dockarea unless it moved to the other
+     * edge of the output. */
+    if (con->window->dock != old_dock) {
+        /* find the dockarea */
+        Con *dockarea = con_for_window(search_at, con->window, NULL);
+        assert(dockarea != NULL);
+
+        /* attach the dock to the dock area */
+        con_detach(con);
+        con->parent = dockarea;
+        TAILQ_INSERT_HEAD(&(dockarea->focus_head), con, focused);
+        TAILQ_INSERT_HEAD(&(dockarea->nodes_head), con, nodes);
+        dockarea->num_children++;
+        con_count_urgency(con);
+    }
+
+    /* Only the dockareas and the content of this output are affected. */
+    if (output != NULL) {
+        tree_schedule_render_output(output);
+    } else {
+        tree_schedule_render();
+    }
+
+    return true;
+}
 
-    /* attach the dock to the dock area */
-    con_detach(con);
-    con->parent = dockarea;
-    TAILQ_INSERT_HEAD(&(dockarea->focus_head), con, focused);
-    TAILQ_INSERT_HEAD(&(dockarea->nodes_head), con, nodes);
+/*
+ * Handles changes of WM_PROTOCOLS, so that the cached WM_TAKE_FOCUS and
+ * WM_DELETE_WINDOW support is up to date when focusing or killing the window.
+ *
+ */
+static bool handle_protocols_change(void *data, xcb_connection_t *conn, uint8_t state, xcb_window_t window,
+                                    xcb_atom_t name, xcb_get_property_reply_t *prop) {
+    Con *con;
+    if ((con = con_by_window_id(window)) == NULL || con->window == NULL)
+        return false;
 
-    tree_render();
+    /* The property was deleted if prop is NULL. */
+    window_update_protocols(con->window, prop);
 
     return true;
 }
@@ -1304,7 +1595,8 @@ static struct property_handler_t property_handlers[] = {
     {0, 128, handle_class_change},
     {0, UINT_MAX, handle_strut_partial_change},
     {0, UINT_MAX, handle_window_type},
-    {0, 5 * sizeof(uint64_t), handle_motif_hints_change}};
+    {0, 5 * sizeof(uint64_t), handle_motif_hints_change},
+    {0, UINT_MAX, handle_protocols_change}};
 #define NUM_HANDLERS (sizeof(property_handlers) / sizeof(struct property_handler_t))
 
 /*
@@ -1326,27 +1618,105 @@ void property_handlers_init(void) {
     property_handlers[8].atom = A__NET_WM_STRUT_PARTIAL;
     property_handlers[9].atom = A__NET_WM_WINDOW_TYPE;
     property_handlers[10].atom = A__MOTIF_WM_HINTS;
+    property_handlers[11].atom = A_WM_PROTOCOLS;
 }
 
-static void property_notify(uint8_t state, xcb_window_t window, xcb_atom_t atom) {
-    struct property_handler_t *handler = NULL;
-    xcb_get_property_reply_t *propr = NULL;
-
+static struct property_handler_t *property_handler_for(xcb_atom_t atom) {
     for (size_t c = 0; c < NUM_HANDLERS; c++) {
-        if (property_handlers[c].atom != atom)
-            continue;
+        if (property_handlers[c].atom == atom)
+            return &property_handlers[c];
+    }
+    return NULL;
+}
+
+/* GetProperty requests sent by property_notify_prefetch(), in the order in
+ * which the corresponding events will be handled. */
+struct prefetched_property {
+    xcb_window_t window;
+    xcb_atom_t atom;
+    xcb_get_property_cookie_t cookie;
+};
+static struct prefetched_property *prefetched = NULL;
+static size_t prefetched_size = 0;
+static size_t prefetched_head = 0;
+static size_t prefetched_count = 0;
 
-        handler = &property_handlers[c];
-        break;
+/*
+ * Sends the GetProperty request for the given PropertyNotify event right
+ * away, so that the replies for a whole batch of events can be received with
+ * a single round trip (see xcb_prepare_cb()). The reply is picked up by
+ * property_notify() when the event is handled.
+ *
+ */
+void property_notify_prefetch(xcb_property_notify_event_t *event) {
+    struct property_handler_t *handler = property_handler_for(event->atom);
+    if (handler == NULL || event->state == XCB_PROPERTY_DELETE)
+        return;
+
+    if (prefetched_head + prefetched_count == prefetched_size) {
+        prefetched_size = (prefetched_size == 0 ? 16 : prefetched_size * 2);
+        prefetched = srealloc(prefetched, prefetched_size * sizeof(struct prefetched_property));
+    }
+
+    struct prefetched_property *p = &prefetched[prefetched_head + prefetched_count++];
+    p->window = event->window;
+    p->atom = event->atom;
+    p->cookie = xcb_get_property(conn, 0, event->window, event->atom, XCB_GET_PROPERTY_TYPE_ANY, 0, handler->long_len);
+}
+
+/*
+ * Discards the replies of all prefetched properties which were not picked up
+ * by property_notify().
+ *
+ */
+void property_notify_discard_prefetched(void) {
+    for (size_t i = prefetched_head; i < prefetched_head + prefetched_count; i++) {
+        xcb_discard_reply(conn, prefetched[i].cookie.sequence);
+    }
+    prefetched_head = 0;
+    prefetched_count = 0;
+}
+
+/*
+ * Handles the given reply to a GetProperty request as if the property had just
+ * been changed (see manage_handle_deferred()). Takes ownership of reply.
+ *
+ */
+void property_notify_reply(xcb_window_t window, xcb_atom_t atom, xcb_get_property_reply_t *reply) {
+    struct property_handler_t *handler = property_handler_for(atom);
+    if (handler == NULL) {
+        FREE(reply);
+        return;
     }
 
+    /* the handler will free() the reply unless it returns false */
+    if (!handler->cb(NULL, conn, XCB_PROPERTY_NEW_VALUE, window, atom, reply))
+        FREE(reply);
+}
+
+static void property_notify(uint8_t state, xcb_window_t window, xcb_atom_t atom) {
+    struct property_handler_t *handler = NULL;
+    xcb_get_property_reply_t *propr = NULL;
+
+    handler = property_handler_for(atom);
     if (handler == NULL) {
         //DLOG("Unhandled property notify for atom %d (0x%08x)\n", atom, atom);
         return;
     }
 
     if (state != XCB_PROPERTY_DELETE) {
-        xcb_get_property_cookie_t cookie = xcb_get_property(conn, 0, window, atom, XCB_GET_PROPERTY_TYPE_ANY, 0, handler->long_len);
+        xcb_get_property_cookie_t cookie;
+        if (prefetched_count > 0 &&
+            prefetched[prefetched_head].window == window &&
+            prefetched[prefetched_head].atom == atom) {
+            /* The request was already sent by property_notify_prefetch(). */
+            cookie = prefetched[prefetched_head].cookie;
+            prefetched_head++;
+            if (--prefetched_count == 0)
+                prefetched_head = 0;
+        } else {
+            cookie = xcb_get_property(conn, 0, window, atom, XCB_GET_PROPERTY_TYPE_ANY, 0, handler->long_len);
+        }
         propr = xcb_get_property_reply(conn, cookie, 0);
     }
 
@@ -1355,15 +1725,158 @@ static void property_notify(uint8_t state, xcb_window_t window, xcb_atom_t atom)
         FREE(propr);
 }
 
+/* Names of the core X11 events, indexed by response type. */
+static const char *core_event_names[] = {
+    [XCB_KEY_PRESS] = "KeyPress",
+    [XCB_KEY_RELEASE] = "KeyRelease",
+    [XCB_BUTTON_PRESS] = "ButtonPress",
+    [XCB_BUTTON_RELEASE] = "ButtonRelease",
+    [XCB_MOTION_NOTIFY] = "MotionNotify",
+    [XCB_ENTER_NOTIFY] = "EnterNotify",
+    [XCB_LEAVE_NOTIFY] = "LeaveNotify",
+    [XCB_FOCUS_IN] = "FocusIn",
+    [XCB_FOCUS_OUT] = "FocusOut",
+    [XCB_KEYMAP_NOTIFY] = "KeymapNotify",
+    [XCB_EXPOSE] = "Expose",
+    [XCB_GRAPHICS_EXPOSURE] = "GraphicsExposure",
+    [XCB_NO_EXPOSURE] = "NoExposure",
+    [XCB_VISIBILITY_NOTIFY] = "VisibilityNotify",
+    [XCB_CREATE_NOTIFY] = "CreateNotify",
+    [XCB_DESTROY_NOTIFY] = "DestroyNotify",
+    [XCB_UNMAP_NOTIFY] = "UnmapNotify",
+    [XCB_MAP_NOTIFY] = "MapNotify",
+    [XCB_MAP_REQUEST] = "MapRequest",
+    [XCB_REPARENT_NOTIFY] = "ReparentNotify",
+    [XCB_CONFIGURE_NOTIFY] = "ConfigureNotify",
+    [XCB_CONFIGURE_REQUEST] = "ConfigureRequest",
+    [XCB_GRAVITY_NOTIFY] = "GravityNotify",
+    [XCB_RESIZE_REQUEST] = "ResizeRequest",
+    [XCB_CIRCULATE_NOTIFY] = "CirculateNotify",
+    [XCB_CIRCULATE_REQUEST] = "CirculateRequest",
+    [XCB_PROPERTY_NOTIFY] = "PropertyNotify",
+    [XCB_SELECTION_CLEAR] = "SelectionClear",
+    [XCB_SELECTION_REQUEST] = "SelectionRequest",
+    [XCB_SELECTION_NOTIFY] = "SelectionNotify",
+    [XCB_COLORMAP_NOTIFY] = "ColormapNotify",
+    [XCB_CLIENT_MESSAGE] = "ClientMessage",
+    [XCB_MAPPING_NOTIFY] = "MappingNotify",
+};
+
 /*
- * Takes an xcb_generic_event_t and calls the appropriate handler, based on the
- * event type.
+ * Returns the name of the given atom if it is one of the atoms i3 knows
+ * about, NULL otherwise. Only used for statistics, so we do not ask the X
+ * server.
  *
  */
-void handle_event(int type, xcb_generic_event_t *event) {
+static const char *known_atom_name(xcb_atom_t atom) {
+#define xmacro(name)         \
+    if (atom == A_##name)    \
+        return #name;
+#include "atoms.xmacro"
+#undef xmacro
+
+    switch (atom) {
+        case XCB_ATOM_WM_NAME:
+            return "WM_NAME";
+        case XCB_ATOM_WM_CLASS:
+            return "WM_CLASS";
+        case XCB_ATOM_WM_HINTS:
+            return "WM_HINTS";
+        case XCB_ATOM_WM_NORMAL_HINTS:
+            return "WM_NORMAL_HINTS";
+        case XCB_ATOM_WM_TRANSIENT_FOR:
+            return "WM_TRANSIENT_FOR";
+        default:
+            return NULL;
+    }
+}
+
+/*
+ * Writes the name of the latency histogram the given event is accounted to
+ * into buf (see stats_histogram_for()). PropertyNotify and ClientMessage
+ * events are told apart by their atom, extension events by their extension.
+ *
+ */
+void event_stats_name(int type, xcb_generic_event_t *event, char *buf, size_t len) {
+    if (randr_base > -1 && type == randr_base + XCB_RANDR_SCREEN_CHANGE_NOTIFY) {
+        snprintf(buf, len, "RandR");
+        return;
+    }
+
+    if (xkb_base > -1 && type == xkb_base) {
+        snprintf(buf, len, "XKB");
+        return;
+    }
+
+    if (shape_base > -1 && type == shape_base + XCB_SHAPE_NOTIFY) {
+        snprintf(buf, len, "ShapeNotify");
+        return;
+    }
+
+    if (sync_base > -1 && type == sync_base + XCB_SYNC_ALARM_NOTIFY) {
+        snprintf(buf, len, "AlarmNotify");
+        return;
+    }
+
+    if ((size_t)type >= sizeof(core_event_names) / sizeof(core_event_names[0]) ||
+        core_event_names[type] == NULL) {
+        snprintf(buf, len, "event %d", type);
+        return;
+    }
+
+    xcb_atom_t atom = XCB_NONE;
+    if (type == XCB_PROPERTY_NOTIFY)
+        atom = ((xcb_property_notify_event_t *)event)->atom;
+    else if (type == XCB_CLIENT_MESSAGE)
+        atom = ((xcb_client_message_event_t *)event)->type;
+
+    if (atom == XCB_NONE) {
+        snprintf(buf, len, "%s", core_event_names[type]);
+        return;
+    }
+
+    const char *atom_name = known_atom_name(atom);
+    if (atom_name != NULL)
+        snprintf(buf, len, "%s %s", core_event_names[type], atom_name);
+    else
+        snprintf(buf, len, "%s %u", core_event_names[type], atom);
+}
+
+/*
+ * Returns the subsystem which the X11 requests sent while handling an event of
+ * the given type are accounted to, see stats_x_enter(). Rendering, drawing
+ * decorations, EWMH updates and drags account their requests themselves.
+ *
+ */
+static stats_x_subsystem_t x_subsystem_for_event(int type) {
+    if (randr_base > -1 && type == randr_base + XCB_RANDR_SCREEN_CHANGE_NOTIFY)
+        return STATS_X_SUBSYSTEM_RANDR;
+    if (xkb_base > -1 && type == xkb_base)
+        return STATS_X_SUBSYSTEM_BINDINGS;
+
+    switch (type) {
+        case XCB_KEY_PRESS:
+        case XCB_KEY_RELEASE:
+        case XCB_BUTTON_PRESS:
+        case XCB_BUTTON_RELEASE:
+        case XCB_MAPPING_NOTIFY:
+            return STATS_X_SUBSYSTEM_BINDINGS;
+        case XCB_MAP_REQUEST:
+        case XCB_UNMAP_NOTIFY:
+        case XCB_DESTROY_NOTIFY:
+            return STATS_X_SUBSYSTEM_MANAGE;
+        default:
+            return STATS_X_SUBSYSTEM_OTHER;
+    }
+}
+
+static void dispatch_event(int type, xcb_generic_event_t *event) {
     if (type != XCB_MOTION_NOTIFY)
         DLOG("event type %d, xkb_base %d\n", type, xkb_base);
 
+    if (drag_handle_event(type, event))
+        return;
+
     if (randr_base > -1 &&
         type == randr_base + XCB_RANDR_SCREEN_CHANGE_NOTIFY) {
         handle_screen_change(event);
@@ -1378,11 +1891,16 @@ void handle_event(int type, xcb_generic_event_t *event) {
             DLOG("xkb new keyboard notify, sequence %d, time %d\n", state->sequence, state->time);
             xcb_key_symbols_free(keysyms);
             keysyms = xcb_key_symbols_alloc(conn);
+            /* The translated bindings only depend on the keymap, so they are
+             * kept if it did not change (see load_keymap()). */
+            bool changed = false;
             if (((xcb_xkb_new_keyboard_notify_event_t *)event)->changed & XCB_XKB_NKN_DETAIL_KEYCODES)
-                (void)load_keymap();
-            ungrab_all_keys(conn);
-            translate_keysyms();
-            grab_all_keys(conn);
+                (void)load_keymap(&changed);
+            if (changed) {
+                ungrab_all_keys(conn);
+                translate_keysyms();
+                grab_all_keys(conn);
+            }
         } else if (state->xkbType == XCB_XKB_MAP_NOTIFY) {
             if (event_is_ignored(event->sequence, type)) {
                 DLOG("Ignoring map notify event for sequence %d.\n", state->sequence);
@@ -1391,23 +1909,30 @@ void handle_event(int type, xcb_generic_event_t *event) {
                 add_ignore_event(event->sequence, type);
                 xcb_key_symbols_free(keysyms);
                 keysyms = xcb_key_symbols_alloc(conn);
-                ungrab_all_keys(conn);
-                translate_keysyms();
-                grab_all_keys(conn);
-                (void)load_keymap();
+                bool changed = false;
+                (void)load_keymap(&changed);
+                if (changed) {
+                    ungrab_all_keys(conn);
+                    translate_keysyms();
+                    grab_all_keys(conn);
+                }
             }
         } else if (state->xkbType == XCB_XKB_STATE_NOTIFY) {
             DLOG("xkb state group = %d\n", state->group);
             if (xkb_current_group == state->group)
                 return;
             xkb_current_group = state->group;
-            ungrab_all_keys(conn);
             grab_all_keys(conn);
         }
 
         return;
     }
 
+    if (sync_supported && type == sync_base + XCB_SYNC_ALARM_NOTIFY) {
+        sync_request_handle_alarm((xcb_sync_alarm_notify_event_t *)event);
+        return;
+    }
+
     if (shape_supported && type == shape_base + XCB_SHAPE_NOTIFY) {
         xcb_shape_notify_event_t *shape = (xcb_shape_notify_event_t *)event;
 
@@ -1505,3 +2030,14 @@ void handle_event(int type, xcb_generic_event_t *event) {
             break;
     }
 }
+
+/*
+ * Takes an xcb_generic_event_t and calls the appropriate handler, based on the
+ * event type.
+ *
+ */
+void handle_event(int type, xcb_generic_event_t *event) {
+    const stats_x_subsystem_t x_subsystem = stats_x_enter(x_subsystem_for_event(type));
+    dispatch_event(type, event);
+    stats_x_leave(x_subsystem);
+}
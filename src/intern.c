@@ -0,0 +1,65 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * intern.c: Interned (deduplicated and reference counted) strings. Equal
+ *           interned strings are the same pointer, so they can be compared
+ *           without looking at their contents.
+ *
+ */
+#include "all.h"
+
+#include <stddef.h>
+
+struct interned_string {
+    uint32_t refcount;
+    size_t len;
+    char str[];
+};
+
+/* Maps the contents of every interned string to its struct interned_string.
+ * Created on first use. */
+static hashmap_t *interned;
+
+/*
+ * Returns the interned copy of the first len bytes of str (which must not
+ * contain a NUL byte) and takes a reference on it. The result is
+ * NUL-terminated and must be released with intern_release().
+ *
+ */
+const char *intern_string(const char *str, size_t len) {
+    if (interned == NULL)
+        interned = hashmap_new();
+
+    struct interned_string *entry = hashmap_get(interned, str, len);
+    if (entry == NULL) {
+        entry = smalloc(sizeof(struct interned_string) + len + 1);
+        entry->refcount = 0;
+        entry->len = len;
+        memcpy(entry->str, str, len);
+        entry->str[len] = '\0';
+        hashmap_set(interned, entry->str, len, entry);
+    }
+    entry->refcount++;
+    return entry->str;
+}
+
+/*
+ * Releases a reference on the given interned string, freeing it when this was
+ * the last reference. Does nothing when str is NULL.
+ *
+ */
+void intern_release(const char *str) {
+    if (str == NULL)
+        return;
+
+    struct interned_string *entry = (struct interned_string *)(str - offsetof(struct interned_string, str));
+    assert(entry->refcount > 0);
+    if (--(entry->refcount) > 0)
+        return;
+
+    hashmap_remove(interned, entry->str, entry->len);
+    free(entry);
+}
@@ -7,19 +7,26 @@
  * ipc.c: UNIX domain socket IPC (initialization, client handling, protocol).
  *
  */
+#define LOG_CATEGORY LOG_CATEGORY_IPC
 #include "all.h"
 
 #include "yajl_utils.h"
 
 #include <stdint.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <libgen.h>
 #include <ev.h>
 #include <yajl/yajl_gen.h>
 #include <yajl/yajl_parse.h>
 
+#ifndef MIN
+#define MIN(x, y) ((x) < (y) ? (x) : (y))
+#endif
+
 char *current_socketpath = NULL;
 
 TAILQ_HEAD(ipc_client_head, ipc_client)
@@ -41,7 +48,8 @@ static void set_nonblock(int sockfd) {
         err(-1, "Could not set O_NONBLOCK");
 }
 
-static void ipc_client_timeout(EV_P_ ev_timer *w, int revents);
+static void ipc_client_timeout(wheel_timer *timer);
+static void ipc_send_client_message(ipc_client *client, size_t size, const uint32_t message_type, const uint8_t *payload);
 static void ipc_socket_writeable_cb(EV_P_ struct ev_io *w, int revents);
 
 static ev_tstamp kill_timeout = 10.0;
@@ -51,27 +59,225 @@ void ipc_set_kill_timeout(ev_tstamp new) {
 }
 
 /*
- * Try to write the contents of the pending buffer to the client's subscription
- * socket. Will set, reset or clear the timeout and io write callbacks depending
- * on the result of the write operation.
+ * Drops a reference to the given message and frees it once it is not queued
+ * for any client anymore.
+ *
+ */
+static void ipc_message_unref(struct ipc_message *message) {
+    if (--(message->refcount) == 0) {
+        if (message->cbor != NULL) {
+            ipc_message_unref(message->cbor);
+        }
+        if (message->next != NULL) {
+            ipc_message_unref(message->next);
+        }
+        free(message);
+    }
+}
+
+/*
+ * Returns the number of bytes of the given message, including all of its
+ * fragments.
+ *
+ */
+static size_t ipc_message_total_size(struct ipc_message *message) {
+    size_t size = 0;
+    for (; message != NULL; message = message->next) {
+        size += message->size;
+    }
+    return size;
+}
+
+/* The number of idle yajl generators kept for reuse. */
+#define IPC_GEN_POOL_SIZE 8
+/* Generators whose buffer grew beyond this many bytes (e.g. for a large
+ * GET_TREE reply) are freed instead of keeping the buffer around. */
+#define IPC_GEN_POOL_MAX_BUFFER (64 * 1024)
+
+static yajl_gen gen_pool[IPC_GEN_POOL_SIZE];
+static int gen_pool_len = 0;
+static cbor_gen_t *cbor_gen_pool[IPC_GEN_POOL_SIZE];
+static int cbor_gen_pool_len = 0;
+
+/* The number of clients which negotiated the CBOR encoding. While there are
+ * any, replies and events are generated as CBOR, too (see ipc_gen_get()). */
+static int cbor_clients = 0;
+
+/*
+ * Attaches a CBOR generator to the given generator if any client uses CBOR,
+ * so that the payload does not have to be converted for these clients (see
+ * ipc_message_as_cbor()).
+ *
+ */
+static void ipc_gen_attach_cbor(yajl_gen gen) {
+    if (cbor_clients == 0) {
+        return;
+    }
+    cbor_gen_t *cbor = (cbor_gen_pool_len > 0 ? cbor_gen_pool[--cbor_gen_pool_len] : cbor_gen_alloc());
+    if (!ygen_attach_cbor(gen, cbor)) {
+        cbor_gen_free(cbor);
+    }
+}
+
+/*
+ * Detaches the CBOR generator (if any) from the given generator and keeps it
+ * for reuse, unless its buffer grew too large.
+ *
+ */
+static void ipc_gen_detach_cbor(yajl_gen gen) {
+    cbor_gen_t *cbor = ygen_detach_cbor(gen);
+    if (cbor == NULL) {
+        return;
+    }
+    size_t length;
+    cbor_gen_get_buf(cbor, &length);
+    if (cbor_gen_pool_len < IPC_GEN_POOL_SIZE && length <= IPC_GEN_POOL_MAX_BUFFER) {
+        cbor_gen_clear(cbor);
+        cbor_gen_pool[cbor_gen_pool_len++] = cbor;
+    } else {
+        cbor_gen_free(cbor);
+    }
+}
+
+/*
+ * Returns a yajl generator for an IPC reply or event, reusing an idle one
+ * (and its buffer) if possible. Return it with ipc_gen_put().
+ *
+ */
+yajl_gen ipc_gen_get(void) {
+    yajl_gen gen = (gen_pool_len > 0 ? gen_pool[--gen_pool_len] : ygenalloc());
+    ipc_gen_attach_cbor(gen);
+    return gen;
+}
+
+/*
+ * Returns a generator obtained by ipc_gen_get() to the pool. Its buffer is
+ * cleared and must not be used anymore.
+ *
+ */
+void ipc_gen_put(yajl_gen gen) {
+    ipc_gen_detach_cbor(gen);
+#if YAJL_VERSION >= 20100
+    const unsigned char *payload;
+    ylength length;
+    if (gen_pool_len < IPC_GEN_POOL_SIZE &&
+        y(get_buf, &payload, &length) == yajl_gen_status_ok &&
+        length <= IPC_GEN_POOL_MAX_BUFFER) {
+        /* Clearing keeps the buffer's allocation, resetting allows the
+         * generator to start a new document. */
+        y(clear);
+        y(reset, NULL);
+        gen_pool[gen_pool_len++] = gen;
+        return;
+    }
+#endif
+    y(free);
+}
+
+/* The maximum number of chunks passed to a single writev() call. */
+#define IPC_WRITEV_CHUNKS 64
+
+/* The number of bytes after which ipc_write_chunks() stops writing to a
+ * client. The rest is written once the event loop comes back to the client's
+ * write watcher, so that flushing large replies (e.g. GET_TREE) to many clients
+ * does not delay the handling of X events. */
+#define IPC_WRITE_BUDGET (256 * 1024)
+
+/*
+ * Writes as many of the client's queued chunks as the socket accepts without
+ * blocking (but at most about IPC_WRITE_BUDGET bytes), and frees the ones
+ * which were written completely. Returns the number of bytes written or -1 on
+ * error.
+ *
+ */
+static ssize_t ipc_write_chunks(ipc_client *client) {
+    ssize_t written = 0;
+
+    while (!TAILQ_EMPTY(&(client->chunks_head)) && written < IPC_WRITE_BUDGET) {
+        struct iovec iov[IPC_WRITEV_CHUNKS];
+        int iovcnt = 0;
+        size_t offset = client->first_chunk_offset;
+        struct ipc_chunk *chunk;
+        TAILQ_FOREACH(chunk, &(client->chunks_head), chunks) {
+            if (iovcnt == IPC_WRITEV_CHUNKS) {
+                break;
+            }
+            iov[iovcnt].iov_base = chunk->message->data + offset;
+            iov[iovcnt].iov_len = chunk->message->size - offset;
+            iovcnt++;
+            offset = 0;
+        }
+
+        ssize_t n = writev(client->fd, iov, iovcnt);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                break;
+            }
+            return -1;
+        }
+        written += n;
+        client->bytes_sent += n;
+        client->queued_bytes -= n;
+
+        /* Free all chunks which were written completely. */
+        size_t left = (size_t)n;
+        while (left > 0) {
+            chunk = TAILQ_FIRST(&(client->chunks_head));
+            const size_t remaining = chunk->message->size - client->first_chunk_offset;
+            if (left < remaining) {
+                client->first_chunk_offset += left;
+                break;
+            }
+            left -= remaining;
+            client->first_chunk_offset = 0;
+            if (chunk->message->next == NULL) {
+                client->messages_sent++;
+            }
+            if (chunk->is_event) {
+                client->queued_event_bytes -= chunk->message->size;
+            }
+            TAILQ_REMOVE(&(client->chunks_head), chunk, chunks);
+            ipc_message_unref(chunk->message);
+            free(chunk);
+        }
+        if (!TAILQ_EMPTY(&(client->chunks_head)) && client->first_chunk_offset > 0) {
+            /* Partial write: the socket is full. */
+            break;
+        }
+    }
+
+    return written;
+}
+
+/*
+ * Try to write the pending messages to the client's subscription socket. Will
+ * set, reset or clear the timeout and io write callbacks depending on the
+ * result of the write operation.
  *
  */
 static void ipc_push_pending(ipc_client *client) {
-    const ssize_t result = writeall_nonblock(client->fd, client->buffer, client->buffer_size);
+    const ssize_t result = ipc_write_chunks(client);
     if (result < 0) {
         return;
     }
 
-    if ((size_t)result == client->buffer_size) {
+    if (client->overflowed) {
+        /* The client is disconnected on the next tick. */
+        return;
+    }
+
+    if (TAILQ_EMPTY(&(client->chunks_head))) {
         /* Everything was written successfully: clear the timer and stop the io
          * callback. */
-        FREE(client->buffer);
-        client->buffer_size = 0;
         if (client->timeout) {
-            ev_timer_stop(main_loop, client->timeout);
+            wheel_timer_stop(client->timeout);
             FREE(client->timeout);
         }
         ev_io_stop(main_loop, client->write_callback);
+        ipc_send_events_lost(client);
         return;
     }
 
@@ -80,54 +286,521 @@ static void ipc_push_pending(ipc_client *client) {
     ev_io_start(main_loop, client->write_callback);
 
     if (!client->timeout) {
-        struct ev_timer *timeout = scalloc(1, sizeof(struct ev_timer));
-        ev_timer_init(timeout, ipc_client_timeout, kill_timeout, 0.);
-        timeout->data = client;
-        client->timeout = timeout;
-        ev_set_priority(timeout, EV_MINPRI);
-        ev_timer_start(main_loop, client->timeout);
+        client->timeout = scalloc(1, sizeof(struct wheel_timer));
+        wheel_timer_init(client->timeout, ipc_client_timeout, client);
+        wheel_timer_start(client->timeout, kill_timeout);
     } else if (result > 0) {
         /* Keep the old timeout when nothing is written. Otherwise, we would
          * keep a dead connection by continuously renewing its timeouts. */
-        ev_timer_stop(main_loop, client->timeout);
-        ev_timer_set(client->timeout, kill_timeout, 0.0);
-        ev_timer_start(main_loop, client->timeout);
-    }
-    if (result == 0) {
-        return;
+        wheel_timer_start(client->timeout, kill_timeout);
     }
-
-    /* Shift the buffer to the left and reduce the allocated space. */
-    client->buffer_size -= (size_t)result;
-    memmove(client->buffer, client->buffer + result, client->buffer_size);
-    client->buffer = srealloc(client->buffer, client->buffer_size);
 }
 
 /*
- * Given a message and a message type, create the corresponding header, merge it
- * with the message and append it to the given client's output buffer. Also,
- * send the message if the client's buffer was empty.
+ * Given a message and a message type, create the corresponding header and
+ * merge it with the message. The returned message has a reference count of 1.
  *
  */
-static void ipc_send_client_message(ipc_client *client, size_t size, const uint32_t message_type, const uint8_t *payload) {
+static struct ipc_message *ipc_message_new(size_t size, const uint32_t message_type, const uint8_t *payload) {
     const i3_ipc_header_t header = {
         .magic = {'i', '3', '-', 'i', 'p', 'c'},
         .size = size,
         .type = message_type};
     const size_t header_size = sizeof(i3_ipc_header_t);
-    const size_t message_size = header_size + size;
 
-    const bool push_now = (client->buffer_size == 0);
-    client->buffer = srealloc(client->buffer, client->buffer_size + message_size);
-    memcpy(client->buffer + client->buffer_size, ((void *)&header), header_size);
-    memcpy(client->buffer + client->buffer_size + header_size, payload, size);
-    client->buffer_size += message_size;
+    struct ipc_message *message = smalloc(sizeof(struct ipc_message) + header_size + size);
+    message->refcount = 1;
+    message->size = header_size + size;
+    message->cbor = NULL;
+    message->next = NULL;
+    memcpy(message->data, ((void *)&header), header_size);
+    memcpy(message->data + header_size, payload, size);
+    return message;
+}
+
+/*
+ * Sets the CBOR encoding of the given message to the payload generated by the
+ * CBOR generator attached to gen, if any.
+ *
+ */
+static void ipc_message_set_cbor(struct ipc_message *message, yajl_gen gen) {
+    cbor_gen_t *cbor = ygen_get_cbor(gen);
+    if (cbor == NULL) {
+        return;
+    }
+    i3_ipc_header_t header;
+    memcpy(&header, message->data, sizeof(i3_ipc_header_t));
+    size_t length;
+    const uint8_t *payload = cbor_gen_get_buf(cbor, &length);
+    message->cbor = ipc_message_new(length, header.type, payload);
+}
+
+/*
+ * Returns a message with the payload generated by the given generator (and
+ * its CBOR encoding, see ipc_gen_get()). The returned message has a reference
+ * count of 1.
+ *
+ */
+static struct ipc_message *ipc_message_from_gen(yajl_gen gen, const uint32_t message_type) {
+    const unsigned char *payload;
+    ylength length;
+    y(get_buf, &payload, &length);
+    struct ipc_message *message = ipc_message_new(length, message_type, payload);
+    ipc_message_set_cbor(message, gen);
+    return message;
+}
+
+/* The size of the first fragment of a streamed reply. Following fragments are
+ * twice as large as the previous one, up to IPC_STREAM_FRAGMENT_SIZE, so that
+ * small replies do not waste memory and large ones are not split into too
+ * many chunks. */
+#define IPC_STREAM_FIRST_FRAGMENT_SIZE (4 * 1024)
+#define IPC_STREAM_FRAGMENT_SIZE (256 * 1024)
+
+/* A reply which is generated directly into message fragments, instead of
+ * generating it into a buffer and copying that into a message. */
+struct ipc_stream {
+    struct ipc_message *head;
+    struct ipc_message *tail;
+    size_t tail_capacity;
+    size_t payload_size;
+};
+
+/*
+ * yajl print callback which appends the generated JSON to the stream. The
+ * first fragment leaves room for the header, which is filled in by
+ * ipc_stream_finish().
+ *
+ */
+static void ipc_stream_print(void *ctx, const char *str, size_t len) {
+    struct ipc_stream *stream = ctx;
+
+    while (len > 0) {
+        if (stream->tail == NULL || stream->tail->size == stream->tail_capacity) {
+            const size_t capacity = (stream->tail == NULL ? IPC_STREAM_FIRST_FRAGMENT_SIZE
+                                                          : MIN(2 * stream->tail_capacity, IPC_STREAM_FRAGMENT_SIZE));
+            struct ipc_message *fragment = smalloc(sizeof(struct ipc_message) + capacity);
+            fragment->refcount = 1;
+            fragment->size = 0;
+            fragment->cbor = NULL;
+            fragment->next = NULL;
+            if (stream->tail == NULL) {
+                fragment->size = sizeof(i3_ipc_header_t);
+                stream->head = fragment;
+            } else {
+                /* The previous fragment owns the reference. */
+                stream->tail->next = fragment;
+            }
+            stream->tail = fragment;
+            stream->tail_capacity = capacity;
+        }
+
+        const size_t n = MIN(len, stream->tail_capacity - stream->tail->size);
+        memcpy(stream->tail->data + stream->tail->size, str, n);
+        stream->tail->size += n;
+        stream->payload_size += n;
+        str += n;
+        len -= n;
+    }
+}
 
-    if (push_now) {
+/*
+ * Returns a yajl generator which writes into the given stream. Pass it to
+ * ipc_stream_finish() (not ipc_gen_put()) once the document is complete.
+ *
+ */
+static yajl_gen ipc_stream_gen(struct ipc_stream *stream) {
+    memset(stream, '\0', sizeof(struct ipc_stream));
+    yajl_gen gen = ygenalloc();
+    y(config, yajl_gen_print_callback, ipc_stream_print, stream);
+    ipc_gen_attach_cbor(gen);
+    return gen;
+}
+
+/*
+ * Fills in the header of the streamed reply, frees its generator and returns
+ * the reply as a message with a reference count of 1.
+ *
+ */
+static struct ipc_message *ipc_stream_finish(struct ipc_stream *stream, yajl_gen gen, const uint32_t message_type) {
+    struct ipc_message *message;
+    if (stream->head == NULL) {
+        message = ipc_message_new(0, message_type, NULL);
+    } else {
+        const i3_ipc_header_t header = {
+            .magic = {'i', '3', '-', 'i', 'p', 'c'},
+            .size = stream->payload_size,
+            .type = message_type};
+        memcpy(stream->head->data, ((void *)&header), sizeof(i3_ipc_header_t));
+        message = stream->head;
+    }
+
+    /* The CBOR encoding is not streamed, it is much smaller anyway. */
+    ipc_message_set_cbor(message, gen);
+    ipc_gen_detach_cbor(gen);
+    y(free);
+    return message;
+}
+
+/*
+ * Returns the given message encoded as CBOR. Messages which were generated
+ * while a client used CBOR have their encoding already (see ipc_gen_get()),
+ * all others are converted. The conversion happens only once per message, no
+ * matter to how many clients it is sent. If the payload cannot be converted,
+ * the message is returned unchanged.
+ *
+ */
+static struct ipc_message *ipc_message_as_cbor(struct ipc_message *message) {
+    if (message->cbor != NULL) {
+        return message->cbor;
+    }
+
+    i3_ipc_header_t header;
+    memcpy(&header, message->data, sizeof(i3_ipc_header_t));
+    const uint8_t *json = message->data + sizeof(i3_ipc_header_t);
+    uint8_t *joined = NULL;
+    if (message->next != NULL) {
+        /* The converter needs the fragments of a streamed reply in one
+         * buffer. */
+        joined = smalloc(header.size);
+        size_t offset = message->size - sizeof(i3_ipc_header_t);
+        memcpy(joined, json, offset);
+        for (struct ipc_message *fragment = message->next; fragment != NULL; fragment = fragment->next) {
+            memcpy(joined + offset, fragment->data, fragment->size);
+            offset += fragment->size;
+        }
+        json = joined;
+    }
+    size_t cbor_len;
+    uint8_t *cbor = json_to_cbor(json, header.size, &cbor_len);
+    free(joined);
+    if (cbor == NULL) {
+        ELOG("Could not encode IPC message of type %d as CBOR, sending JSON\n", header.type);
+        return message;
+    }
+    message->cbor = ipc_message_new(cbor_len, header.type, cbor);
+    free(cbor);
+    return message->cbor;
+}
+
+/* How many times ipc_hold_messages() was called without a matching
+ * ipc_release_messages(). Messages are only queued, but not written, while
+ * this is not 0. */
+static int messages_held = 0;
+/* Incremented whenever the held messages are released, so that only events
+ * queued during the same hold supersede each other. */
+static uint64_t hold_generation = 0;
+
+/* Kinds of events which are superseded by a later event of the same kind for
+ * the same container, see ipc_queue_message(). */
+enum {
+    COALESCE_NONE = 0,
+    COALESCE_WINDOW_FOCUS,
+    COALESCE_WINDOW_TITLE,
+    COALESCE_WORKSPACE_FOCUS,
+};
+
+static int coalesce_kind(uint32_t message_type, const struct ipc_event_info *info) {
+    if (info == NULL || info->change == NULL || info->con == NULL) {
+        return COALESCE_NONE;
+    }
+    if (message_type == I3_IPC_EVENT_WINDOW) {
+        if (strcmp(info->change, "focus") == 0) {
+            return COALESCE_WINDOW_FOCUS;
+        }
+        if (strcmp(info->change, "title") == 0) {
+            return COALESCE_WINDOW_TITLE;
+        }
+    } else if (message_type == I3_IPC_EVENT_WORKSPACE) {
+        if (strcmp(info->change, "focus") == 0) {
+            return COALESCE_WORKSPACE_FOCUS;
+        }
+    }
+    return COALESCE_NONE;
+}
+
+/*
+ * Removes the queued chunk of an event which is superseded by a new event of
+ * the given kind for the given container, if any. With same_hold, only events
+ * queued during the current hold are considered. Chunks which were partially
+ * written already are kept. Returns true if a chunk was removed.
+ *
+ */
+static bool ipc_drop_superseded(ipc_client *client, int kind, Con *con, bool same_hold) {
+    struct ipc_chunk *chunk;
+    TAILQ_FOREACH(chunk, &(client->chunks_head), chunks) {
+        if (chunk->coalesce_kind == kind && chunk->coalesce_con == con &&
+            (!same_hold || chunk->hold_generation == hold_generation) &&
+            !(chunk == TAILQ_FIRST(&(client->chunks_head)) && client->first_chunk_offset > 0)) {
+            break;
+        }
+    }
+    if (chunk == NULL) {
+        return false;
+    }
+
+    TAILQ_REMOVE(&(client->chunks_head), chunk, chunks);
+    client->queued_bytes -= chunk->message->size;
+    client->queued_event_bytes -= chunk->message->size;
+    client->events_coalesced++;
+    ipc_message_unref(chunk->message);
+    free(chunk);
+    return true;
+}
+
+/*
+ * Disconnects the client on the next tick of the timer wheel. It cannot be
+ * freed right away, since this is called while iterating over the clients.
+ *
+ */
+static void ipc_client_kill_soon(ipc_client *client) {
+    client->overflowed = true;
+    if (client->timeout == NULL) {
+        client->timeout = scalloc(1, sizeof(struct wheel_timer));
+        wheel_timer_init(client->timeout, ipc_client_timeout, client);
+    }
+    wheel_timer_start(client->timeout, 0);
+}
+
+/*
+ * Applies the client's backpressure policy to an event which does not fit
+ * into its queue anymore. Returns true if the event should be queued anyway
+ * (because it replaced a superseded one).
+ *
+ */
+static bool ipc_apply_backpressure(ipc_client *client, uint32_t message_type, int kind, Con *con) {
+    const uint32_t index = (message_type & ~I3_IPC_EVENT_MASK);
+    switch (client->backpressure[index]) {
+        case IPC_BACKPRESSURE_COALESCE:
+            if (kind != COALESCE_NONE && ipc_drop_superseded(client, kind, con, false)) {
+                return true;
+            }
+            /* fall through */
+        case IPC_BACKPRESSURE_DROP:
+            client->events_lost[index]++;
+            client->events_dropped++;
+            return false;
+        case IPC_BACKPRESSURE_DISCONNECT:
+        default:
+            ELOG("client %p on fd %d has more than %d bytes of events queued, disconnecting\n",
+                 client, client->fd, IPC_QUEUE_LIMIT);
+            ipc_client_kill_soon(client);
+            return false;
+    }
+}
+
+/*
+ * Sends an event with the change "events_lost" and the number of dropped
+ * events for each event type of which events were dropped by the
+ * backpressure policy. Called once the client's queue is empty again.
+ *
+ */
+static void ipc_send_events_lost(ipc_client *client) {
+    for (uint32_t index = 0; index < 32; index++) {
+        if (client->events_lost[index] == 0) {
+            continue;
+        }
+
+        char *payload;
+        sasprintf(&payload, "{\"change\":\"events_lost\",\"count\":%u}", client->events_lost[index]);
+        client->events_lost[index] = 0;
+        ipc_send_client_message(client, strlen(payload), I3_IPC_EVENT_MASK | index, (const uint8_t *)payload);
+        free(payload);
+    }
+}
+
+/*
+ * Appends the given message to the client's output queue and sends it if the
+ * client's queue was empty (and messages are not held). The message is
+ * converted to the client's encoding first.
+ *
+ * While messages are held, an event of a coalescable kind (see
+ * coalesce_kind()) replaces the previous one for the same container, so that
+ * clients only receive the final state of each hold.
+ *
+ */
+static void ipc_queue_message(ipc_client *client, struct ipc_message *message, int kind, Con *con) {
+    if (client->overflowed) {
+        return;
+    }
+
+    if (client->encoding == IPC_ENCODING_CBOR) {
+        message = ipc_message_as_cbor(message);
+    }
+
+    i3_ipc_header_t header;
+    memcpy(&header, message->data, sizeof(i3_ipc_header_t));
+    const bool is_event = (header.type & I3_IPC_EVENT_MASK);
+
+    if (messages_held > 0 && kind != COALESCE_NONE) {
+        ipc_drop_superseded(client, kind, con, true);
+    }
+
+    if (is_event && client->queued_event_bytes + message->size > IPC_QUEUE_LIMIT &&
+        !ipc_apply_backpressure(client, header.type, kind, con)) {
+        return;
+    }
+
+    const size_t size = ipc_message_total_size(message);
+    I3_PROBE3(ipc_send, client->fd, header.type, size);
+
+    const bool push_now = TAILQ_EMPTY(&(client->chunks_head));
+    for (struct ipc_message *fragment = message; fragment != NULL; fragment = fragment->next) {
+        struct ipc_chunk *chunk = smalloc(sizeof(struct ipc_chunk));
+        chunk->message = fragment;
+        chunk->is_event = is_event;
+        chunk->coalesce_kind = kind;
+        chunk->coalesce_con = con;
+        chunk->hold_generation = hold_generation;
+        fragment->refcount++;
+        TAILQ_INSERT_TAIL(&(client->chunks_head), chunk, chunks);
+    }
+
+    if (is_event) {
+        client->queued_event_bytes += size;
+    }
+    client->queued_bytes += size;
+    if (client->queued_bytes > client->queued_bytes_max) {
+        client->queued_bytes_max = client->queued_bytes;
+    }
+
+    if (push_now && messages_held == 0) {
         ipc_push_pending(client);
     }
 }
 
+/*
+ * Stops writing messages (replies and events) to the clients. They are queued
+ * in order and written by ipc_release_messages(). Calls can be nested.
+ *
+ */
+void ipc_hold_messages(void) {
+    messages_held++;
+}
+
+/*
+ * Writes all messages queued since ipc_hold_messages(), once every call of
+ * ipc_hold_messages() was matched by a call of this function.
+ *
+ */
+void ipc_release_messages(void) {
+    if (messages_held == 0 || --messages_held > 0) {
+        return;
+    }
+    hold_generation++;
+
+    ipc_client *current;
+    TAILQ_FOREACH(current, &all_clients, clients) {
+        if (!TAILQ_EMPTY(&(current->chunks_head))) {
+            ipc_push_pending(current);
+        }
+    }
+}
+
+/*
+ * Given a message and a message type, create the corresponding header, merge it
+ * with the message and append it to the given client's output queue. Also,
+ * send the message if the client's queue was empty.
+ *
+ */
+static void ipc_send_client_message(ipc_client *client, size_t size, const uint32_t message_type, const uint8_t *payload) {
+    struct ipc_message *message = ipc_message_new(size, message_type, payload);
+    ipc_queue_message(client, message, COALESCE_NONE, NULL);
+    ipc_message_unref(message);
+}
+
+/*
+ * Like ipc_send_client_message(), but with the payload generated by gen (see
+ * ipc_message_from_gen()).
+ *
+ */
+static void ipc_send_client_gen(ipc_client *client, const uint32_t message_type, yajl_gen gen) {
+    struct ipc_message *message = ipc_message_from_gen(gen, message_type);
+    ipc_queue_message(client, message, COALESCE_NONE, NULL);
+    ipc_message_unref(message);
+}
+
+/* The GET_WORKSPACES and GET_OUTPUTS replies only change when a workspace or
+ * an output changes, but bars request them after every workspace event. The
+ * replies are therefore kept until ipc_invalidate_cached_replies() is called
+ * and queued for every client without being generated again. */
+static struct ipc_message *cached_workspaces_reply = NULL;
+static struct ipc_message *cached_outputs_reply = NULL;
+
+/*
+ * Drops the cached GET_WORKSPACES and GET_OUTPUTS replies. Must be called
+ * whenever a workspace, an output or the focus changes.
+ *
+ */
+void ipc_invalidate_cached_replies(void) {
+    if (cached_workspaces_reply != NULL) {
+        ipc_message_unref(cached_workspaces_reply);
+        cached_workspaces_reply = NULL;
+    }
+    if (cached_outputs_reply != NULL) {
+        ipc_message_unref(cached_outputs_reply);
+        cached_outputs_reply = NULL;
+    }
+}
+
+/* The GET_TREE reply for an empty payload (the whole tree). Dumping a large
+ * tree takes a while, and clients tend to request it after every event even
+ * if the tree did not change. Dropped by ipc_invalidate_tree_reply(). */
+static struct ipc_message *cached_tree_reply = NULL;
+
+/*
+ * Drops the cached GET_TREE reply. Must be called whenever anything which is
+ * part of the dump may have changed: renders (scheduled or not), changes
+ * pushed to X11, commands and window properties which are dumped.
+ *
+ */
+void ipc_invalidate_tree_reply(void) {
+    if (cached_tree_reply != NULL) {
+        ipc_message_unref(cached_tree_reply);
+        cached_tree_reply = NULL;
+    }
+}
+
+/* The events clients can subscribe to, indexed by
+ * (I3_IPC_EVENT_* & ~I3_IPC_EVENT_MASK). */
+static const char *event_names[] = {
+    "workspace",
+    "output",
+    "mode",
+    "window",
+    "barconfig_update",
+    "binding",
+    "shutdown",
+    "tick",
+    "tree",
+};
+
+#define EVENT_BIT(message_type) (1U << ((message_type) & ~I3_IPC_EVENT_MASK))
+
+/* The union of the events all clients are subscribed to. */
+static uint32_t subscribed_events = 0;
+
+static void update_subscribed_events(void) {
+    subscribed_events = 0;
+    ipc_client *current;
+    TAILQ_FOREACH(current, &all_clients, clients) {
+        subscribed_events |= current->events;
+    }
+}
+
+static void ipc_event_filter_free(struct ipc_event_filter *filter) {
+    for (int i = 0; i < filter->num_changes; i++) {
+        free(filter->changes[i]);
+    }
+    FREE(filter->changes);
+    if (filter->has_match) {
+        match_free(&(filter->match));
+    }
+    FREE(filter->workspace);
+    FREE(filter->output);
+    free(filter);
+}
+
 static void free_ipc_client(ipc_client *client, int exempt_fd) {
     if (client->fd != exempt_fd) {
         DLOG("Disconnecting client on fd %d\n", client->fd);
@@ -139,42 +812,271 @@ static void free_ipc_client(ipc_client *client, int exempt_fd) {
     ev_io_stop(main_loop, client->write_callback);
     FREE(client->write_callback);
     if (client->timeout) {
-        ev_timer_stop(main_loop, client->timeout);
+        wheel_timer_stop(client->timeout);
         FREE(client->timeout);
     }
 
-    free(client->buffer);
+    while (!TAILQ_EMPTY(&(client->chunks_head))) {
+        struct ipc_chunk *chunk = TAILQ_FIRST(&(client->chunks_head));
+        TAILQ_REMOVE(&(client->chunks_head), chunk, chunks);
+        ipc_message_unref(chunk->message);
+        free(chunk);
+    }
+
+    while (!TAILQ_EMPTY(&(client->filters_head))) {
+        struct ipc_event_filter *filter = TAILQ_FIRST(&(client->filters_head));
+        TAILQ_REMOVE(&(client->filters_head), filter, filters);
+        ipc_event_filter_free(filter);
+    }
+
+    FREE(client->read_buffer);
 
-    for (int i = 0; i < client->num_events; i++) {
-        free(client->events[i]);
+    if (client->encoding == IPC_ENCODING_CBOR) {
+        cbor_clients--;
     }
-    free(client->events);
     TAILQ_REMOVE(&all_clients, client, clients);
     free(client);
+    update_subscribed_events();
 }
 
 /*
- * Sends the specified event to all IPC clients which are currently connected
- * and subscribed to this kind of event.
+ * Returns true if any IPC client is subscribed to the given event type
+ * (I3_IPC_EVENT_*). Used to avoid marshalling events nobody receives.
+ *
+ */
+bool ipc_has_event_listeners(uint32_t message_type) {
+    return (subscribed_events & EVENT_BIT(message_type)) != 0;
+}
+
+/*
+ * Fills in the description of an event concerning the given container (which
+ * may be NULL) for evaluating subscription filters. Free with
+ * ipc_event_info_free().
+ *
+ */
+void ipc_event_info_init(struct ipc_event_info *info, const char *change, Con *con) {
+    info->change = change;
+    info->con = con;
+    info->window = NULL;
+    info->workspace = NULL;
+    info->output = NULL;
+    if (con == NULL || con->type == CT_ROOT) {
+        return;
+    }
+
+    info->window = con->window;
+    Con *ws = con_get_workspace(con);
+    if (ws != NULL) {
+        info->workspace = sstrdup(ws->name);
+    }
+    info->output = sstrdup(con_get_output(con)->name);
+}
+
+/*
+ * Frees the strings of an event description.
+ *
+ */
+void ipc_event_info_free(struct ipc_event_info *info) {
+    FREE(info->workspace);
+    FREE(info->output);
+}
+
+static bool ipc_event_filter_matches(struct ipc_event_filter *filter, const struct ipc_event_info *info) {
+    if (filter->num_changes > 0) {
+        if (info->change == NULL) {
+            return false;
+        }
+        bool found = false;
+        for (int i = 0; i < filter->num_changes && !found; i++) {
+            found = (strcmp(filter->changes[i], info->change) == 0);
+        }
+        if (!found) {
+            return false;
+        }
+    }
+    if (filter->has_match &&
+        (info->window == NULL || !match_matches_window(&(filter->match), info->window))) {
+        return false;
+    }
+    if (filter->workspace != NULL &&
+        (info->workspace == NULL || strcmp(filter->workspace, info->workspace) != 0)) {
+        return false;
+    }
+    if (filter->output != NULL &&
+        (info->output == NULL || strcasecmp(filter->output, info->output) != 0)) {
+        return false;
+    }
+    return true;
+}
+
+/* Which payload of an event a client receives, see the "payload" key of
+ * subscription filters. */
+typedef enum {
+    EVENT_PAYLOAD_NONE = 0,
+    EVENT_PAYLOAD_FULL = 1,
+    EVENT_PAYLOAD_SHALLOW = 2,
+} event_payload_t;
+
+/*
+ * Returns which payload of the described event the client wants: none if it
+ * is not subscribed to the event type or all of its filters reject the event,
+ * the shallow one if all matching filters ask for it, and the full one
+ * otherwise.
  *
  */
-void ipc_send_event(const char *event, uint32_t message_type, const char *payload) {
+static event_payload_t ipc_client_event_payload(ipc_client *client, uint32_t message_type, const struct ipc_event_info *info) {
+    const uint32_t bit = EVENT_BIT(message_type);
+    if (!(client->events & bit)) {
+        return EVENT_PAYLOAD_NONE;
+    }
+    if ((client->unfiltered_events & bit) || info == NULL) {
+        return EVENT_PAYLOAD_FULL;
+    }
+    event_payload_t result = EVENT_PAYLOAD_NONE;
+    struct ipc_event_filter *filter;
+    TAILQ_FOREACH(filter, &(client->filters_head), filters) {
+        if (filter->message_type == message_type && ipc_event_filter_matches(filter, info)) {
+            if (!filter->shallow) {
+                return EVENT_PAYLOAD_FULL;
+            }
+            result = EVENT_PAYLOAD_SHALLOW;
+        }
+    }
+    return result;
+}
+
+/*
+ * Returns true if the client is subscribed to the given event type and, if it
+ * subscribed with filters, one of them matches the described event.
+ *
+ */
+static bool ipc_client_wants_event(ipc_client *client, uint32_t message_type, const struct ipc_event_info *info) {
+    return (ipc_client_event_payload(client, message_type, info) != EVENT_PAYLOAD_NONE);
+}
+
+/*
+ * Sets full and shallow depending on which payloads of the described event
+ * the subscribed clients want (see ipc_client_event_payload()).
+ *
+ */
+static void ipc_event_wanted_payloads(uint32_t message_type, const struct ipc_event_info *info, bool *full, bool *shallow) {
+    *full = false;
+    *shallow = false;
+    if (!ipc_has_event_listeners(message_type)) {
+        return;
+    }
     ipc_client *current;
     TAILQ_FOREACH(current, &all_clients, clients) {
-        for (int i = 0; i < current->num_events; i++) {
-            if (strcasecmp(current->events[i], event) == 0) {
-                ipc_send_client_message(current, strlen(payload), message_type, (uint8_t *)payload);
+        switch (ipc_client_event_payload(current, message_type, info)) {
+            case EVENT_PAYLOAD_FULL:
+                *full = true;
                 break;
-            }
+            case EVENT_PAYLOAD_SHALLOW:
+                *shallow = true;
+                break;
+            case EVENT_PAYLOAD_NONE:
+                break;
+        }
+    }
+}
+
+/*
+ * Returns true if any IPC client wants to receive the described event, i.e.
+ * is subscribed to its type and does not filter it out.
+ *
+ */
+bool ipc_event_has_recipients(uint32_t message_type, const struct ipc_event_info *info) {
+    if (!ipc_has_event_listeners(message_type)) {
+        return false;
+    }
+    ipc_client *current;
+    TAILQ_FOREACH(current, &all_clients, clients) {
+        if (ipc_client_wants_event(current, message_type, info)) {
+            return true;
         }
     }
+    return false;
+}
+
+/*
+ * Queues the given event message for all clients which want it, except that
+ * clients which want the shallow payload of the event (see
+ * ipc_client_event_payload()) receive shallow_message instead. Either message
+ * can be NULL when no client wants it; the other one is sent instead. Each
+ * message is serialized once and shared by all clients.
+ *
+ */
+static void ipc_send_event_messages(uint32_t message_type, struct ipc_message *message,
+                                    struct ipc_message *shallow_message, const struct ipc_event_info *info) {
+    const int kind = coalesce_kind(message_type, info);
+    ipc_client *current;
+    TAILQ_FOREACH(current, &all_clients, clients) {
+        const event_payload_t wanted = ipc_client_event_payload(current, message_type, info);
+        if (wanted == EVENT_PAYLOAD_NONE) {
+            continue;
+        }
+
+        const bool shallow = (shallow_message != NULL && (wanted == EVENT_PAYLOAD_SHALLOW || message == NULL));
+        ipc_queue_message(current, (shallow ? shallow_message : message), kind,
+                          (kind != COALESCE_NONE ? info->con : NULL));
+    }
+}
+
+/*
+ * Like ipc_send_event_gen(), but clients which want the shallow payload of the
+ * event (see ipc_client_event_payload()) receive the one of shallow_gen
+ * instead. Either generator can be NULL when no client wants its payload; the
+ * other one is sent instead.
+ *
+ */
+static void ipc_send_event_gens(uint32_t message_type, yajl_gen gen, yajl_gen shallow_gen,
+                                const struct ipc_event_info *info) {
+    if (!ipc_has_event_listeners(message_type)) {
+        return;
+    }
+
+    struct ipc_message *message = (gen != NULL ? ipc_message_from_gen(gen, message_type) : NULL);
+    struct ipc_message *shallow_message = (shallow_gen != NULL ? ipc_message_from_gen(shallow_gen, message_type) : NULL);
+    ipc_send_event_messages(message_type, message, shallow_message, info);
+    if (message != NULL) {
+        ipc_message_unref(message);
+    }
+    if (shallow_message != NULL) {
+        ipc_message_unref(shallow_message);
+    }
+}
+
+/*
+ * Sends the specified event to all IPC clients which are currently connected
+ * and subscribed to this kind of event. Subscription filters are evaluated
+ * against info; if info is NULL, filters are ignored.
+ *
+ */
+void ipc_send_event(uint32_t message_type, const char *payload, const struct ipc_event_info *info) {
+    if (!ipc_has_event_listeners(message_type)) {
+        return;
+    }
+
+    struct ipc_message *message = ipc_message_new(strlen(payload), message_type, (const uint8_t *)payload);
+    ipc_send_event_messages(message_type, message, NULL, info);
+    ipc_message_unref(message);
+}
+
+/*
+ * Like ipc_send_event(), but with the payload generated by gen, which must
+ * have been obtained by ipc_gen_get(). Clients using CBOR get the payload
+ * which was generated along with the JSON one.
+ *
+ */
+void ipc_send_event_gen(uint32_t message_type, yajl_gen gen, const struct ipc_event_info *info) {
+    ipc_send_event_gens(message_type, gen, NULL, info);
 }
 
 /*
  * For shutdown events, we send the reason for the shutdown.
  */
 static void ipc_send_shutdown_event(shutdown_reason_t reason) {
-    yajl_gen gen = ygenalloc();
+    yajl_gen gen = ipc_gen_get();
     y(map_open);
 
     ystr("change");
@@ -187,13 +1089,11 @@ static void ipc_send_shutdown_event(shutdown_reason_t reason) {
 
     y(map_close);
 
-    const unsigned char *payload;
-    ylength length;
-
-    y(get_buf, &payload, &length);
-    ipc_send_event("shutdown", I3_IPC_EVENT_SHUTDOWN, (const char *)payload);
+    struct ipc_event_info info;
+    ipc_event_info_init(&info, (reason == SHUTDOWN_REASON_RESTART ? "restart" : "exit"), NULL);
+    ipc_send_event_gen(I3_IPC_EVENT_SHUTDOWN, gen, &info);
 
-    y(free);
+    ipc_gen_put(gen);
 }
 
 /*
@@ -204,6 +1104,9 @@ static void ipc_send_shutdown_event(shutdown_reason_t reason) {
  *
  */
 void ipc_shutdown(shutdown_reason_t reason, int exempt_fd) {
+    while (messages_held > 0) {
+        ipc_release_messages();
+    }
     ipc_send_shutdown_event(reason);
 
     ipc_client *current;
@@ -226,10 +1129,9 @@ IPC_HANDLER(run_command) {
      * message_size bytes out of the buffer */
     char *command = sstrndup((const char *)message, message_size);
     LOG("IPC: received: *%s*\n", command);
-    yajl_gen gen = yajl_gen_alloc(NULL);
+    yajl_gen gen = ipc_gen_get();
 
     CommandResult *result = parse_command(command, gen, client);
-    free(command);
 
     if (result->needs_tree_render)
         tree_render();
@@ -240,10 +1142,84 @@ IPC_HANDLER(run_command) {
     ylength length;
     yajl_gen_get_buf(gen, &reply, &length);
 
-    ipc_send_client_message(client, length, I3_IPC_REPLY_TYPE_COMMAND,
-                            (const uint8_t *)reply);
+    event_trace_record_command(command, reply, length);
+    free(command);
+
+    ipc_send_client_gen(client, I3_IPC_REPLY_TYPE_COMMAND, gen);
+
+    ipc_gen_put(gen);
+}
+
+struct run_commands_state {
+    char **commands;
+    int num_commands;
+};
+
+static int _run_commands_json_string(void *extra, const unsigned char *val, size_t len) {
+    struct run_commands_state *state = extra;
+    state->commands = srealloc(state->commands, (state->num_commands + 1) * sizeof(char *));
+    state->commands[state->num_commands++] = sstrndup((const char *)val, len);
+    return 1;
+}
+
+/*
+ * Executes the commands given as a JSON array of strings in the payload. The
+ * tree is rendered only once after the last command, so that clients setting
+ * up a layout do not cause intermediate frames. The reply is an array
+ * containing the COMMAND reply of each command.
+ *
+ */
+IPC_HANDLER(run_commands) {
+    static yajl_callbacks callbacks = {
+        .yajl_string = _run_commands_json_string,
+    };
+
+    struct run_commands_state state;
+    memset(&state, '\0', sizeof(struct run_commands_state));
+    yajl_handle p = yalloc(&callbacks, (void *)&state);
+    yajl_status stat = yajl_parse(p, (const unsigned char *)message, message_size);
+    if (stat == yajl_status_ok) {
+        stat = yajl_complete_parse(p);
+    }
+    if (stat != yajl_status_ok) {
+        unsigned char *err = yajl_get_error(p, true, (const unsigned char *)message, message_size);
+        ELOG("YAJL parse error: %s\n", err);
+        yajl_free_error(p, err);
+        yajl_free(p);
+        for (int i = 0; i < state.num_commands; i++) {
+            free(state.commands[i]);
+        }
+        FREE(state.commands);
+
+        const char *reply = "{\"success\":false,\"error\":\"Could not parse the RUN_COMMANDS payload\"}";
+        ipc_send_client_message(client, strlen(reply), I3_IPC_REPLY_TYPE_COMMANDS, (const uint8_t *)reply);
+        return;
+    }
+    yajl_free(p);
+
+    yajl_gen gen = ipc_gen_get();
+    y(array_open);
+    bool needs_tree_render = false;
+    for (int i = 0; i < state.num_commands; i++) {
+        LOG("IPC: received (%d/%d): *%s*\n", i + 1, state.num_commands, state.commands[i]);
+        CommandResult *result = parse_command(state.commands[i], gen, client);
+        if (result->needs_tree_render)
+            needs_tree_render = true;
+        command_result_free(result);
+        /* The replies of the individual commands are not separated, so
+         * they are not recorded. */
+        event_trace_record_command(state.commands[i], NULL, 0);
+        free(state.commands[i]);
+    }
+    FREE(state.commands);
+    y(array_close);
+
+    if (needs_tree_render)
+        tree_render();
 
-    yajl_gen_free(gen);
+    ipc_send_client_gen(client, I3_IPC_REPLY_TYPE_COMMANDS, gen);
+
+    ipc_gen_put(gen);
 }
 
 static void dump_rect(yajl_gen gen, const char *name, Rect r) {
@@ -350,307 +1326,486 @@ static void dump_binding(yajl_gen gen, Binding *bind) {
     y(map_close);
 }
 
-void dump_node(yajl_gen gen, struct Con *con, bool inplace_restart) {
+/*
+ * Restricts what dump_node_filtered() emits: only the keys in fields (all keys
+ * if fields is NULL) and only max_depth levels of children below the root (no
+ * limit if max_depth is negative). The "id", "nodes" and "floating_nodes" keys
+ * are always included, unless omit_children is set. With child_ids set, the
+ * "nodes" and "floating_nodes" arrays contain the IDs of the children instead
+ * of the children themselves.
+ *
+ * With save_tree set, the nodes are dumped in the format of i3-save-tree(1):
+ * "id" and all keys which only carry runtime state are left out, and leaf
+ * containers get "swallows" criteria matching their current window.
+ *
+ */
+struct dump_filter {
+    hashmap_t *fields;
+    int max_depth;
+    bool omit_children;
+    bool child_ids;
+    bool save_tree;
+};
+
+/* The shallow payload of workspace and window events: all keys of the
+ * container itself, but only the IDs of its children. */
+static const struct dump_filter shallow_filter = {
+    .fields = NULL,
+    .max_depth = -1,
+    .child_ids = true,
+};
+
+/* The keys which are kept in the i3-save-tree(1) format. */
+static const char *save_tree_fields[] = {
+    "type", "fullscreen_mode", "layout", "border", "current_border_width",
+    "floating", "percent", "name", "geometry", "marks", "rect"};
+
+/*
+ * Returns a regular expression which only matches the given string. Like
+ * Perl’s quotemeta, all ASCII characters other than letters, digits and the
+ * underscore are escaped. The caller has to free the result.
+ *
+ */
+static char *regex_for_exact_string(const char *str) {
+    char *result = smalloc(2 * strlen(str) + 3);
+    char *walk = result;
+    *walk++ = '^';
+    for (const char *c = str; *c != '\0'; c++) {
+        const unsigned char uc = *c;
+        if (uc < 0x80 &&
+            !(uc >= 'a' && uc <= 'z') && !(uc >= 'A' && uc <= 'Z') &&
+            !(uc >= '0' && uc <= '9') && uc != '_') {
+            *walk++ = '\\';
+        }
+        *walk++ = *c;
+    }
+    *walk++ = '$';
+    *walk = '\0';
+    return result;
+}
+
+/*
+ * Dumps the "swallows" criteria which i3-save-tree(1) suggests for a leaf
+ * container: its current window’s properties, matched exactly.
+ *
+ */
+static void dump_save_tree_swallows(yajl_gen gen, Con *con) {
+    ystr("swallows");
+    y(array_open);
     y(map_open);
-    ystr("id");
-    y(integer, (uintptr_t)con);
+    if (con->window != NULL) {
+#define DUMP_EXACT(key, value)                            \
+    do {                                                  \
+        if ((value) != NULL) {                            \
+            char *regex = regex_for_exact_string(value);  \
+            ystr(key);                                    \
+            ystr(regex);                                  \
+            free(regex);                                  \
+        }                                                 \
+    } while (0)
 
-    ystr("type");
-    switch (con->type) {
-        case CT_ROOT:
-            ystr("root");
-            break;
-        case CT_OUTPUT:
-            ystr("output");
-            break;
-        case CT_CON:
-            ystr("con");
-            break;
-        case CT_FLOATING_CON:
-            ystr("floating_con");
-            break;
-        case CT_WORKSPACE:
-            ystr("workspace");
-            break;
-        case CT_DOCKAREA:
-            ystr("dockarea");
-            break;
+        DUMP_EXACT("class", con->window->class_class);
+        DUMP_EXACT("instance", con->window->class_instance);
+        DUMP_EXACT("window_role", con->window->role);
+        if (con->window->name != NULL)
+            DUMP_EXACT("title", i3string_as_utf8(con->window->name));
+
+#undef DUMP_EXACT
     }
+    y(map_close);
+    y(array_close);
+}
 
-    /* provided for backwards compatibility only. */
-    ystr("orientation");
-    if (!con_is_split(con))
-        ystr("none");
-    else {
-        if (con_orientation(con) == HORIZ)
-            ystr("horizontal");
-        else
-            ystr("vertical");
+#define WANT(key) (filter == NULL || filter->fields == NULL || \
+                   hashmap_get(filter->fields, (key), strlen(key)) != NULL)
+
+static void dump_node_filtered(yajl_gen gen, Con *con, bool inplace_restart,
+                               const struct dump_filter *filter, int depth) {
+    /* In the i3-save-tree(1) format, keys which carry no state (or only
+     * auto-generated state) are left out. */
+    const bool save = (filter != NULL && filter->save_tree);
+    const bool leaf = (con->type == CT_CON && con_is_leaf(con) &&
+                       TAILQ_EMPTY(&(con->floating_head)));
+
+    y(map_open);
+    if (!save) {
+        ystr("id");
+        y(integer, (uintptr_t)con);
     }
 
-    ystr("scratchpad_state");
-    switch (con->scratchpad_state) {
-        case SCRATCHPAD_NONE:
+    if (WANT("type")) {
+        ystr("type");
+        switch (con->type) {
+            case CT_ROOT:
+                ystr("root");
+                break;
+            case CT_OUTPUT:
+                ystr("output");
+                break;
+            case CT_CON:
+                ystr("con");
+                break;
+            case CT_FLOATING_CON:
+                ystr("floating_con");
+                break;
+            case CT_WORKSPACE:
+                ystr("workspace");
+                break;
+            case CT_DOCKAREA:
+                ystr("dockarea");
+                break;
+        }
+    }
+
+    if (WANT("orientation")) {
+        /* provided for backwards compatibility only. */
+        ystr("orientation");
+        if (!con_is_split(con))
             ystr("none");
-            break;
-        case SCRATCHPAD_FRESH:
-            ystr("fresh");
-            break;
-        case SCRATCHPAD_CHANGED:
-            ystr("changed");
-            break;
+        else {
+            if (con_orientation(con) == HORIZ)
+                ystr("horizontal");
+            else
+                ystr("vertical");
+        }
     }
 
-    ystr("percent");
-    if (con->percent == 0.0)
-        y(null);
-    else
-        y(double, con->percent);
+    if (WANT("scratchpad_state")) {
+        ystr("scratchpad_state");
+        switch (con->scratchpad_state) {
+            case SCRATCHPAD_NONE:
+                ystr("none");
+                break;
+            case SCRATCHPAD_FRESH:
+                ystr("fresh");
+                break;
+            case SCRATCHPAD_CHANGED:
+                ystr("changed");
+                break;
+        }
+    }
 
-    ystr("urgent");
-    y(bool, con->urgent);
+    if (WANT("percent")) {
+        ystr("percent");
+        if (con->percent == 0.0)
+            y(null);
+        else
+            y(double, con->percent);
+    }
 
-    if (!TAILQ_EMPTY(&(con->marks_head))) {
-        ystr("marks");
-        y(array_open);
+    if (WANT("urgent")) {
+        ystr("urgent");
+        y(bool, con->urgent);
+    }
 
-        mark_t *mark;
-        TAILQ_FOREACH(mark, &(con->marks_head), marks) {
-            ystr(mark->name);
-        }
+    if (WANT("marks")) {
+        if (!TAILQ_EMPTY(&(con->marks_head))) {
+            ystr("marks");
+            y(array_open);
 
-        y(array_close);
-    }
+            mark_t *mark;
+            TAILQ_FOREACH(mark, &(con->marks_head), marks) {
+                ystr(mark->name);
+            }
 
-    ystr("focused");
-    y(bool, (con == focused));
+            y(array_close);
+        }
+    }
 
-    if (con->type != CT_ROOT && con->type != CT_OUTPUT) {
-        ystr("output");
-        ystr(con_get_output(con)->name);
+    if (WANT("focused")) {
+        ystr("focused");
+        y(bool, (con == focused));
     }
 
-    ystr("layout");
-    switch (con->layout) {
-        case L_DEFAULT:
-            DLOG("About to dump layout=default, this is a bug in the code.\n");
-            assert(false);
-            break;
-        case L_SPLITV:
-            ystr("splitv");
-            break;
-        case L_SPLITH:
-            ystr("splith");
-            break;
-        case L_STACKED:
-            ystr("stacked");
-            break;
-        case L_TABBED:
-            ystr("tabbed");
-            break;
-        case L_DOCKAREA:
-            ystr("dockarea");
-            break;
-        case L_OUTPUT:
+    if (WANT("output")) {
+        if (con->type != CT_ROOT && con->type != CT_OUTPUT) {
             ystr("output");
-            break;
+            ystr(con_get_output(con)->name);
+        }
     }
 
-    ystr("workspace_layout");
-    switch (con->workspace_layout) {
-        case L_DEFAULT:
-            ystr("default");
-            break;
-        case L_STACKED:
-            ystr("stacked");
-            break;
-        case L_TABBED:
-            ystr("tabbed");
-            break;
-        default:
-            DLOG("About to dump workspace_layout=%d (none of default/stacked/tabbed), this is a bug.\n", con->workspace_layout);
-            assert(false);
-            break;
+    if (WANT("layout") && !(save && leaf)) {
+        ystr("layout");
+        switch (con->layout) {
+            case L_DEFAULT:
+                DLOG("About to dump layout=default, this is a bug in the code.\n");
+                assert(false);
+                break;
+            case L_SPLITV:
+                ystr("splitv");
+                break;
+            case L_SPLITH:
+                ystr("splith");
+                break;
+            case L_STACKED:
+                ystr("stacked");
+                break;
+            case L_TABBED:
+                ystr("tabbed");
+                break;
+            case L_DOCKAREA:
+                ystr("dockarea");
+                break;
+            case L_OUTPUT:
+                ystr("output");
+                break;
+        }
     }
 
-    ystr("last_split_layout");
-    switch (con->layout) {
-        case L_SPLITV:
-            ystr("splitv");
-            break;
-        default:
-            ystr("splith");
-            break;
+    if (WANT("workspace_layout")) {
+        ystr("workspace_layout");
+        switch (con->workspace_layout) {
+            case L_DEFAULT:
+                ystr("default");
+                break;
+            case L_STACKED:
+                ystr("stacked");
+                break;
+            case L_TABBED:
+                ystr("tabbed");
+                break;
+            default:
+                DLOG("About to dump workspace_layout=%d (none of default/stacked/tabbed), this is a bug.\n", con->workspace_layout);
+                assert(false);
+                break;
+        }
     }
 
-    ystr("border");
-    switch (con->border_style) {
-        case BS_NORMAL:
-            ystr("normal");
-            break;
-        case BS_NONE:
-            ystr("none");
-            break;
-        case BS_PIXEL:
-            ystr("pixel");
-            break;
+    if (WANT("last_split_layout")) {
+        ystr("last_split_layout");
+        switch (con->layout) {
+            case L_SPLITV:
+                ystr("splitv");
+                break;
+            default:
+                ystr("splith");
+                break;
+        }
     }
 
-    ystr("current_border_width");
-    y(integer, con->current_border_width);
+    if (WANT("border")) {
+        ystr("border");
+        switch (con->border_style) {
+            case BS_NORMAL:
+                ystr("normal");
+                break;
+            case BS_NONE:
+                ystr("none");
+                break;
+            case BS_PIXEL:
+                ystr("pixel");
+                break;
+        }
+    }
 
-    dump_rect(gen, "rect", con->rect);
-    dump_rect(gen, "deco_rect", con->deco_rect);
-    dump_rect(gen, "window_rect", con->window_rect);
-    dump_rect(gen, "geometry", con->geometry);
+    if (WANT("current_border_width") && !(save && con->current_border_width == -1)) {
+        ystr("current_border_width");
+        y(integer, con->current_border_width);
+    }
 
-    ystr("name");
-    if (con->window && con->window->name)
-        ystr(i3string_as_utf8(con->window->name));
-    else if (con->name != NULL)
-        ystr(con->name);
-    else
-        y(null);
+    if (WANT("rect") && !(save && con->type != CT_FLOATING_CON))
+        dump_rect(gen, "rect", con->rect);
+    if (WANT("deco_rect"))
+        dump_rect(gen, "deco_rect", con->deco_rect);
+    if (WANT("window_rect"))
+        dump_rect(gen, "window_rect", con->window_rect);
+    if (WANT("geometry") &&
+        !(save && con->geometry.x == 0 && con->geometry.y == 0 &&
+          con->geometry.width == 0 && con->geometry.height == 0))
+        dump_rect(gen, "geometry", con->geometry);
+
+    if (WANT("name") && !(save && !leaf)) {
+        ystr("name");
+        if (con->window && con->window->name)
+            ystr(i3string_as_utf8(con->window->name));
+        else if (con->name != NULL)
+            ystr(con->name);
+        else
+            y(null);
+    }
 
-    if (con->title_format != NULL) {
-        ystr("title_format");
-        ystr(con->title_format);
+    if (WANT("title_format")) {
+        if (con->title_format != NULL) {
+            ystr("title_format");
+            ystr(con->title_format);
+        }
     }
 
-    if (con->type == CT_WORKSPACE) {
-        ystr("num");
-        y(integer, con->num);
+    if (WANT("num")) {
+        if (con->type == CT_WORKSPACE) {
+            ystr("num");
+            y(integer, con->num);
+        }
     }
 
-    ystr("window");
-    if (con->window)
-        y(integer, con->window->id);
-    else
-        y(null);
+    if (WANT("window")) {
+        ystr("window");
+        if (con->window)
+            y(integer, con->window->id);
+        else
+            y(null);
+    }
 
-    if (con->window && !inplace_restart) {
-        /* Window properties are useless to preserve when restarting because
-         * they will be queried again anyway. However, for i3-save-tree(1),
-         * they are very useful and save i3-save-tree dealing with X11. */
-        ystr("window_properties");
-        y(map_open);
+    if (WANT("window_properties")) {
+        if (con->window && !inplace_restart) {
+            /* Window properties are useless to preserve when restarting because
+             * they will be queried again anyway. However, for i3-save-tree(1),
+             * they are very useful and save i3-save-tree dealing with X11. */
+            ystr("window_properties");
+            y(map_open);
 
-#define DUMP_PROPERTY(key, prop_name)         \
-    do {                                      \
-        if (con->window->prop_name != NULL) { \
-            ystr(key);                        \
-            ystr(con->window->prop_name);     \
-        }                                     \
+#define DUMP_PROPERTY(key, prop_name)             \
+    do {                                          \
+        if (con->window->prop_name != NULL) {     \
+            ystr(key);                            \
+            ystr(con->window->prop_name);         \
+        }                                         \
     } while (0)
 
-        DUMP_PROPERTY("class", class_class);
-        DUMP_PROPERTY("instance", class_instance);
-        DUMP_PROPERTY("window_role", role);
+            DUMP_PROPERTY("class", class_class);
+            DUMP_PROPERTY("instance", class_instance);
+            DUMP_PROPERTY("window_role", role);
 
-        if (con->window->name != NULL) {
-            ystr("title");
-            ystr(i3string_as_utf8(con->window->name));
-        }
+            if (con->window->name != NULL) {
+                ystr("title");
+                ystr(i3string_as_utf8(con->window->name));
+            }
 
-        ystr("transient_for");
-        if (con->window->transient_for == XCB_NONE)
-            y(null);
-        else
-            y(integer, con->window->transient_for);
+            ystr("transient_for");
+            if (con->window->transient_for == XCB_NONE)
+                y(null);
+            else
+                y(integer, con->window->transient_for);
 
-        y(map_close);
+            y(map_close);
+        }
     }
 
-    ystr("nodes");
-    y(array_open);
+    /* Children are dumped up to the requested depth. The arrays are always
+     * included, making it possible to walk a projected tree. */
+    const bool descend = (filter == NULL || filter->max_depth < 0 || depth < filter->max_depth);
+
     Con *node;
-    if (con->type != CT_DOCKAREA || !inplace_restart) {
+    if (filter != NULL && filter->child_ids) {
+        ystr("nodes");
+        y(array_open);
         TAILQ_FOREACH(node, &(con->nodes_head), nodes) {
-            dump_node(gen, node, inplace_restart);
+            y(integer, (uintptr_t)node);
         }
-    }
-    y(array_close);
+        y(array_close);
 
-    ystr("floating_nodes");
-    y(array_open);
-    TAILQ_FOREACH(node, &(con->floating_head), floating_windows) {
-        dump_node(gen, node, inplace_restart);
-    }
-    y(array_close);
+        ystr("floating_nodes");
+        y(array_open);
+        TAILQ_FOREACH(node, &(con->floating_head), floating_windows) {
+            y(integer, (uintptr_t)node);
+        }
+        y(array_close);
+    } else if (filter == NULL || !filter->omit_children) {
+        ystr("nodes");
+        y(array_open);
+        if (descend && (con->type != CT_DOCKAREA || !inplace_restart)) {
+            TAILQ_FOREACH(node, &(con->nodes_head), nodes) {
+                dump_node_filtered(gen, node, inplace_restart, filter, depth + 1);
+            }
+        }
+        y(array_close);
 
-    ystr("focus");
-    y(array_open);
-    TAILQ_FOREACH(node, &(con->focus_head), focused) {
-        y(integer, (uintptr_t)node);
+        ystr("floating_nodes");
+        y(array_open);
+        if (descend) {
+            TAILQ_FOREACH(node, &(con->floating_head), floating_windows) {
+                dump_node_filtered(gen, node, inplace_restart, filter, depth + 1);
+            }
+        }
+        y(array_close);
     }
-    y(array_close);
 
-    ystr("fullscreen_mode");
-    y(integer, con->fullscreen_mode);
+    if (WANT("focus")) {
+        ystr("focus");
+        y(array_open);
+        TAILQ_FOREACH(node, &(con->focus_head), focused) {
+            y(integer, (uintptr_t)node);
+        }
+        y(array_close);
+    }
 
-    ystr("sticky");
-    y(bool, con->sticky);
+    if (WANT("fullscreen_mode") && !(save && con->fullscreen_mode == CF_NONE)) {
+        ystr("fullscreen_mode");
+        y(integer, con->fullscreen_mode);
+    }
 
-    ystr("floating");
-    switch (con->floating) {
-        case FLOATING_AUTO_OFF:
-            ystr("auto_off");
-            break;
-        case FLOATING_AUTO_ON:
-            ystr("auto_on");
-            break;
-        case FLOATING_USER_OFF:
-            ystr("user_off");
-            break;
-        case FLOATING_USER_ON:
-            ystr("user_on");
-            break;
+    if (WANT("sticky")) {
+        ystr("sticky");
+        y(bool, con->sticky);
     }
 
-    ystr("swallows");
-    y(array_open);
-    Match *match;
-    TAILQ_FOREACH(match, &(con->swallow_head), matches) {
-        /* We will generate a new restart_mode match specification after this
-         * loop, so skip this one. */
-        if (match->restart_mode)
-            continue;
-        y(map_open);
-        if (match->dock != M_DONTCHECK) {
-            ystr("dock");
-            y(integer, match->dock);
-            ystr("insert_where");
-            y(integer, match->insert_where);
+    if (WANT("floating")) {
+        ystr("floating");
+        switch (con->floating) {
+            case FLOATING_AUTO_OFF:
+                ystr("auto_off");
+                break;
+            case FLOATING_AUTO_ON:
+                ystr("auto_on");
+                break;
+            case FLOATING_USER_OFF:
+                ystr("user_off");
+                break;
+            case FLOATING_USER_ON:
+                ystr("user_on");
+                break;
         }
+    }
 
-#define DUMP_REGEX(re_name)                \
-    do {                                   \
-        if (match->re_name != NULL) {      \
-            ystr(#re_name);                \
-            ystr(match->re_name->pattern); \
-        }                                  \
+    if (save && leaf)
+        dump_save_tree_swallows(gen, con);
+
+    if (WANT("swallows")) {
+        ystr("swallows");
+        y(array_open);
+        Match *match;
+        TAILQ_FOREACH(match, &(con->swallow_head), matches) {
+            /* We will generate a new restart_mode match specification after this
+             * loop, so skip this one. */
+            if (match->restart_mode)
+                continue;
+            y(map_open);
+            if (match->dock != M_DONTCHECK) {
+                ystr("dock");
+                y(integer, match->dock);
+                ystr("insert_where");
+                y(integer, match->insert_where);
+            }
+
+#define DUMP_REGEX(re_name)                    \
+    do {                                       \
+        if (match->re_name != NULL) {          \
+            ystr(#re_name);                    \
+            ystr(match->re_name->pattern);     \
+        }                                      \
     } while (0)
 
-        DUMP_REGEX(class);
-        DUMP_REGEX(instance);
-        DUMP_REGEX(window_role);
-        DUMP_REGEX(title);
+            DUMP_REGEX(class);
+            DUMP_REGEX(instance);
+            DUMP_REGEX(window_role);
+            DUMP_REGEX(title);
 
 #undef DUMP_REGEX
-        y(map_close);
-    }
-
-    if (inplace_restart) {
-        if (con->window != NULL) {
-            y(map_open);
-            ystr("id");
-            y(integer, con->window->id);
-            ystr("restart_mode");
-            y(bool, true);
             y(map_close);
         }
+
+        if (inplace_restart) {
+            if (con->window != NULL) {
+                y(map_open);
+                ystr("id");
+                y(integer, con->window->id);
+                ystr("restart_mode");
+                y(bool, true);
+                y(map_close);
+            }
+        }
+        y(array_close);
     }
-    y(array_close);
 
     if (inplace_restart && con->window != NULL) {
         ystr("depth");
@@ -665,6 +1820,12 @@ void dump_node(yajl_gen gen, struct Con *con, bool inplace_restart) {
     y(map_close);
 }
 
+#undef WANT
+
+void dump_node(yajl_gen gen, struct Con *con, bool inplace_restart) {
+    dump_node_filtered(gen, con, inplace_restart, NULL, 0);
+}
+
 static void dump_bar_bindings(yajl_gen gen, Barconfig *config) {
     if (TAILQ_EMPTY(&(config->bar_bindings)))
         return;
@@ -740,6 +1901,9 @@ static void dump_bar_config(yajl_gen gen, Barconfig *config) {
     ystr("tray_padding");
     y(integer, config->tray_padding);
 
+    ystr("status_redraw_interval");
+    y(integer, config->status_redraw_interval);
+
     YSTR_IF_SET(socket_path);
 
     ystr("mode");
@@ -795,6 +1959,9 @@ static void dump_bar_config(yajl_gen gen, Barconfig *config) {
     ystr("strip_workspace_name");
     y(bool, config->strip_workspace_name);
 
+    ystr("share_status_command");
+    y(bool, config->share_status_command);
+
     ystr("binding_mode_indicator");
     y(bool, !config->hide_binding_mode_indicator);
 
@@ -839,18 +2006,183 @@ static void dump_bar_config(yajl_gen gen, Barconfig *config) {
 #undef YSTR_IF_SET
 }
 
+struct tree_state {
+    char *last_key;
+    bool in_fields;
+    long long con_id;
+    char *workspace;
+    char *output;
+    char *format;
+    struct dump_filter filter;
+};
+
+static int _tree_json_key(void *extra, const unsigned char *val, size_t len) {
+    struct tree_state *state = extra;
+    FREE(state->last_key);
+    state->last_key = scalloc(len + 1, 1);
+    memcpy(state->last_key, val, len);
+    return 1;
+}
+
+static int _tree_json_int(void *extra, long long val) {
+    struct tree_state *state = extra;
+    if (state->last_key == NULL || state->in_fields) {
+        return 1;
+    }
+    if (strcasecmp(state->last_key, "con_id") == 0) {
+        state->con_id = val;
+    } else if (strcasecmp(state->last_key, "depth") == 0) {
+        state->filter.max_depth = (val < 0 || val > INT_MAX ? -1 : (int)val);
+    }
+    return 1;
+}
+
+static int _tree_json_string(void *extra, const unsigned char *val, size_t len) {
+    struct tree_state *state = extra;
+    if (state->last_key == NULL) {
+        return 1;
+    }
+    if (state->in_fields) {
+        hashmap_set(state->filter.fields, val, len, (void *)1);
+    } else if (strcasecmp(state->last_key, "workspace") == 0) {
+        FREE(state->workspace);
+        state->workspace = sstrndup((const char *)val, len);
+    } else if (strcasecmp(state->last_key, "output") == 0) {
+        FREE(state->output);
+        state->output = sstrndup((const char *)val, len);
+    } else if (strcasecmp(state->last_key, "format") == 0) {
+        FREE(state->format);
+        state->format = sstrndup((const char *)val, len);
+    }
+    return 1;
+}
+
+static int _tree_json_start_array(void *extra) {
+    struct tree_state *state = extra;
+    if (state->last_key != NULL && strcasecmp(state->last_key, "fields") == 0) {
+        state->in_fields = true;
+        if (state->filter.fields == NULL) {
+            state->filter.fields = hashmap_new();
+        }
+    }
+    return 1;
+}
+
+static int _tree_json_end_array(void *extra) {
+    struct tree_state *state = extra;
+    state->in_fields = false;
+    return 1;
+}
+
+/*
+ * Formats the reply message for a GET_TREE request and sends it to the client.
+ * The payload may be a JSON map selecting the root of the dump ("con_id",
+ * "workspace" or the content container of an "output"), limiting its "depth",
+ * projecting it onto a list of "fields" and choosing the "format" ("save_tree"
+ * produces what i3-save-tree(1) prints). An empty payload dumps the whole tree.
+ *
+ */
 IPC_HANDLER(tree) {
-    setlocale(LC_NUMERIC, "C");
-    yajl_gen gen = ygenalloc();
-    dump_node(gen, croot, false);
-    setlocale(LC_NUMERIC, "");
+    static yajl_callbacks callbacks = {
+        .yajl_map_key = _tree_json_key,
+        .yajl_integer = _tree_json_int,
+        .yajl_string = _tree_json_string,
+        .yajl_start_array = _tree_json_start_array,
+        .yajl_end_array = _tree_json_end_array,
+    };
 
-    const unsigned char *payload;
-    ylength length;
-    y(get_buf, &payload, &length);
+    if (message_size == 0 && cached_tree_reply != NULL) {
+        ipc_queue_message(client, cached_tree_reply, COALESCE_NONE, NULL);
+        return;
+    }
 
-    ipc_send_client_message(client, length, I3_IPC_REPLY_TYPE_TREE, payload);
-    y(free);
+    struct tree_state state;
+    memset(&state, '\0', sizeof(struct tree_state));
+    state.filter.max_depth = -1;
+
+    const char *error = NULL;
+    Con *root = croot;
+    if (message_size > 0) {
+        yajl_handle p = yalloc(&callbacks, (void *)&state);
+        yajl_status stat = yajl_parse(p, (const unsigned char *)message, message_size);
+        if (stat == yajl_status_ok) {
+            stat = yajl_complete_parse(p);
+        }
+        if (stat != yajl_status_ok) {
+            unsigned char *err = yajl_get_error(p, true, (const unsigned char *)message, message_size);
+            ELOG("YAJL parse error: %s\n", err);
+            yajl_free_error(p, err);
+            error = "Could not parse the GET_TREE payload";
+        }
+        yajl_free(p);
+
+        if (error == NULL && state.con_id != 0) {
+            root = con_by_con_id(state.con_id);
+            if (root == NULL) {
+                error = "No container with the given con_id";
+            }
+        } else if (error == NULL && state.workspace != NULL) {
+            root = get_existing_workspace_by_name(state.workspace);
+            if (root == NULL) {
+                error = "No workspace with the given name";
+            }
+        } else if (error == NULL && state.output != NULL) {
+            Output *output = get_output_by_name(state.output, true);
+            if (output == NULL) {
+                error = "No output with the given name";
+            } else {
+                root = output_get_content(output->con);
+            }
+        }
+
+        if (error == NULL && state.format != NULL) {
+            if (strcmp(state.format, "save_tree") == 0) {
+                /* The format determines the fields, "fields" is ignored. */
+                hashmap_free(state.filter.fields);
+                state.filter.fields = hashmap_new();
+                for (size_t i = 0; i < sizeof(save_tree_fields) / sizeof(save_tree_fields[0]); i++) {
+                    hashmap_set(state.filter.fields, save_tree_fields[i],
+                                strlen(save_tree_fields[i]), (void *)1);
+                }
+                state.filter.save_tree = true;
+            } else if (strcmp(state.format, "default") != 0) {
+                error = "Unknown format";
+            }
+        }
+    }
+
+    /* The tree is generated directly into the fragments of the reply, so that
+     * a large tree does not need to be held twice (in the generator's buffer
+     * and in the message). */
+    struct ipc_stream stream;
+    yajl_gen gen = ipc_stream_gen(&stream);
+    if (error != NULL) {
+        y(map_open);
+        ystr("success");
+        y(bool, false);
+        ystr("error");
+        ystr(error);
+        y(map_close);
+    } else {
+        DLOG("Dumping tree from %p (depth = %d)\n", root, state.filter.max_depth);
+        setlocale(LC_NUMERIC, "C");
+        dump_node_filtered(gen, root, false, &(state.filter), 0);
+        setlocale(LC_NUMERIC, "");
+    }
+
+    FREE(state.last_key);
+    FREE(state.workspace);
+    FREE(state.output);
+    FREE(state.format);
+    hashmap_free(state.filter.fields);
+
+    struct ipc_message *reply = ipc_stream_finish(&stream, gen, I3_IPC_REPLY_TYPE_TREE);
+    ipc_queue_message(client, reply, COALESCE_NONE, NULL);
+    if (message_size == 0) {
+        cached_tree_reply = reply;
+    } else {
+        ipc_message_unref(reply);
+    }
 }
 
 /*
@@ -859,7 +2191,12 @@ IPC_HANDLER(tree) {
  *
  */
 IPC_HANDLER(get_workspaces) {
-    yajl_gen gen = ygenalloc();
+    if (cached_workspaces_reply != NULL) {
+        ipc_queue_message(client, cached_workspaces_reply, COALESCE_NONE, NULL);
+        return;
+    }
+
+    yajl_gen gen = ipc_gen_get();
     y(array_open);
 
     Con *focused_ws = con_get_workspace(focused);
@@ -873,6 +2210,9 @@ IPC_HANDLER(get_workspaces) {
             assert(ws->type == CT_WORKSPACE);
             y(map_open);
 
+            ystr("id");
+            y(integer, (uintptr_t)ws);
+
             ystr("num");
             y(integer, ws->num);
 
@@ -909,12 +2249,9 @@ IPC_HANDLER(get_workspaces) {
 
     y(array_close);
 
-    const unsigned char *payload;
-    ylength length;
-    y(get_buf, &payload, &length);
-
-    ipc_send_client_message(client, length, I3_IPC_REPLY_TYPE_WORKSPACES, payload);
-    y(free);
+    cached_workspaces_reply = ipc_message_from_gen(gen, I3_IPC_REPLY_TYPE_WORKSPACES);
+    ipc_queue_message(client, cached_workspaces_reply, COALESCE_NONE, NULL);
+    ipc_gen_put(gen);
 }
 
 /*
@@ -923,7 +2260,12 @@ IPC_HANDLER(get_workspaces) {
  *
  */
 IPC_HANDLER(get_outputs) {
-    yajl_gen gen = ygenalloc();
+    if (cached_outputs_reply != NULL) {
+        ipc_queue_message(client, cached_outputs_reply, COALESCE_NONE, NULL);
+        return;
+    }
+
+    yajl_gen gen = ipc_gen_get();
     y(array_open);
 
     Output *output;
@@ -963,12 +2305,9 @@ IPC_HANDLER(get_outputs) {
 
     y(array_close);
 
-    const unsigned char *payload;
-    ylength length;
-    y(get_buf, &payload, &length);
-
-    ipc_send_client_message(client, length, I3_IPC_REPLY_TYPE_OUTPUTS, payload);
-    y(free);
+    cached_outputs_reply = ipc_message_from_gen(gen, I3_IPC_REPLY_TYPE_OUTPUTS);
+    ipc_queue_message(client, cached_outputs_reply, COALESCE_NONE, NULL);
+    ipc_gen_put(gen);
 }
 
 /*
@@ -977,7 +2316,7 @@ IPC_HANDLER(get_outputs) {
  *
  */
 IPC_HANDLER(get_marks) {
-    yajl_gen gen = ygenalloc();
+    yajl_gen gen = ipc_gen_get();
     y(array_open);
 
     Con *con;
@@ -990,12 +2329,8 @@ IPC_HANDLER(get_marks) {
 
     y(array_close);
 
-    const unsigned char *payload;
-    ylength length;
-    y(get_buf, &payload, &length);
-
-    ipc_send_client_message(client, length, I3_IPC_REPLY_TYPE_MARKS, payload);
-    y(free);
+    ipc_send_client_gen(client, I3_IPC_REPLY_TYPE_MARKS, gen);
+    ipc_gen_put(gen);
 }
 
 /*
@@ -1003,7 +2338,7 @@ IPC_HANDLER(get_marks) {
  *
  */
 IPC_HANDLER(get_version) {
-    yajl_gen gen = ygenalloc();
+    yajl_gen gen = ipc_gen_get();
     y(map_open);
 
     ystr("major");
@@ -1023,12 +2358,8 @@ IPC_HANDLER(get_version) {
 
     y(map_close);
 
-    const unsigned char *payload;
-    ylength length;
-    y(get_buf, &payload, &length);
-
-    ipc_send_client_message(client, length, I3_IPC_REPLY_TYPE_VERSION, payload);
-    y(free);
+    ipc_send_client_gen(client, I3_IPC_REPLY_TYPE_VERSION, gen);
+    ipc_gen_put(gen);
 }
 
 /*
@@ -1037,7 +2368,7 @@ IPC_HANDLER(get_version) {
  *
  */
 IPC_HANDLER(get_bar_config) {
-    yajl_gen gen = ygenalloc();
+    yajl_gen gen = ipc_gen_get();
 
     /* If no ID was passed, we return a JSON array with all IDs */
     if (message_size == 0) {
@@ -1048,12 +2379,8 @@ IPC_HANDLER(get_bar_config) {
         }
         y(array_close);
 
-        const unsigned char *payload;
-        ylength length;
-        y(get_buf, &payload, &length);
-
-        ipc_send_client_message(client, length, I3_IPC_REPLY_TYPE_BAR_CONFIG, payload);
-        y(free);
+        ipc_send_client_gen(client, I3_IPC_REPLY_TYPE_BAR_CONFIG, gen);
+        ipc_gen_put(gen);
         return;
     }
 
@@ -1085,66 +2412,219 @@ IPC_HANDLER(get_bar_config) {
         dump_bar_config(gen, config);
     }
 
-    const unsigned char *payload;
-    ylength length;
-    y(get_buf, &payload, &length);
+    ipc_send_client_gen(client, I3_IPC_REPLY_TYPE_BAR_CONFIG, gen);
+    ipc_gen_put(gen);
+}
 
-    ipc_send_client_message(client, length, I3_IPC_REPLY_TYPE_BAR_CONFIG, payload);
-    y(free);
+/*
+ * Returns a list of configured binding modes
+ *
+ */
+IPC_HANDLER(get_binding_modes) {
+    yajl_gen gen = ipc_gen_get();
+
+    y(array_open);
+    struct Mode *mode;
+    SLIST_FOREACH(mode, &modes, modes) {
+        ystr(mode->name);
+    }
+    y(array_close);
+
+    ipc_send_client_gen(client, I3_IPC_REPLY_TYPE_BINDING_MODES, gen);
+    ipc_gen_put(gen);
+}
+
+static void tree_snapshot_reset(void);
+
+/*
+ * Returns the I3_IPC_EVENT_* type with the given name, or 0 if there is none.
+ *
+ */
+static uint32_t event_type_by_name(const unsigned char *s, ylength len) {
+    for (size_t i = 0; i < sizeof(event_names) / sizeof(event_names[0]); i++) {
+        if (strlen(event_names[i]) == len &&
+            strncasecmp(event_names[i], (const char *)s, len) == 0) {
+            return (I3_IPC_EVENT_MASK | i);
+        }
+    }
+    return 0;
+}
+
+/*
+ * Subscribes the client to the given event type, either to all events of that
+ * type (filter == NULL) or to the ones matching the filter.
+ *
+ */
+static void add_subscription(ipc_client *client, uint32_t message_type, struct ipc_event_filter *filter) {
+    const bool had_tree_listeners = ipc_has_event_listeners(I3_IPC_EVENT_TREE);
+    client->events |= EVENT_BIT(message_type);
+    if (filter != NULL && filter->has_backpressure) {
+        client->backpressure[message_type & ~I3_IPC_EVENT_MASK] = filter->backpressure;
+    }
+    if (filter == NULL) {
+        client->unfiltered_events |= EVENT_BIT(message_type);
+    } else {
+        TAILQ_INSERT_TAIL(&(client->filters_head), filter, filters);
+    }
+    update_subscribed_events();
+    if (!had_tree_listeners && ipc_has_event_listeners(I3_IPC_EVENT_TREE)) {
+        tree_snapshot_reset();
+    }
+    DLOG("client is now subscribed to events 0x%08x\n", client->events);
 }
 
 /*
- * Returns a list of configured binding modes
+ * The payload of a SUBSCRIBE message is an array whose elements are either
+ * event names or maps describing a filtered subscription, for example:
+ * { "event": "window", "change": ["title"], "match": { "class": "^URxvt$" } }
  *
  */
-IPC_HANDLER(get_binding_modes) {
-    yajl_gen gen = ygenalloc();
+struct subscribe_state {
+    ipc_client *client;
+    /* The nesting level of maps and arrays; 1 is the top-level array. */
+    int depth;
+    char *last_key;
+    /* The filter of the map (at depth 2) which is currently parsed. */
+    struct ipc_event_filter *filter;
+    uint32_t filter_type;
+    bool in_match;
+    char *error;
+};
 
-    y(array_open);
-    struct Mode *mode;
-    SLIST_FOREACH(mode, &modes, modes) {
-        ystr(mode->name);
+static int _subscribe_json_key(void *extra, const unsigned char *val, size_t len) {
+    struct subscribe_state *state = extra;
+    FREE(state->last_key);
+    state->last_key = sstrndup((const char *)val, len);
+    return 1;
+}
+
+static int _subscribe_json_string(void *extra, const unsigned char *val, size_t len) {
+    struct subscribe_state *state = extra;
+
+    if (state->depth == 1) {
+        DLOG("should add subscription to client %p, sub %.*s\n", state->client, (int)len, val);
+        const uint32_t message_type = event_type_by_name(val, len);
+        if (message_type == 0) {
+            DLOG("Client subscribed to unknown event \"%.*s\", ignoring\n", (int)len, val);
+        } else {
+            add_subscription(state->client, message_type, NULL);
+        }
+        return 1;
     }
-    y(array_close);
 
-    const unsigned char *payload;
-    ylength length;
-    y(get_buf, &payload, &length);
+    struct ipc_event_filter *filter = state->filter;
+    if (filter == NULL || state->last_key == NULL ||
+        (state->depth != 2 && !state->in_match)) {
+        return 1;
+    }
 
-    ipc_send_client_message(client, length, I3_IPC_REPLY_TYPE_BINDING_MODES, payload);
-    y(free);
+    char *value = sstrndup((const char *)val, len);
+    if (state->in_match) {
+        match_parse_property(&(filter->match), state->last_key, value);
+        filter->has_match = true;
+        free(value);
+    } else if (strcasecmp(state->last_key, "event") == 0) {
+        state->filter_type = event_type_by_name(val, len);
+        if (state->filter_type == 0 && state->error == NULL) {
+            sasprintf(&(state->error), "Unknown event \"%s\"", value);
+        }
+        free(value);
+    } else if (strcasecmp(state->last_key, "change") == 0) {
+        filter->changes = srealloc(filter->changes, (filter->num_changes + 1) * sizeof(char *));
+        filter->changes[filter->num_changes++] = value;
+    } else if (strcasecmp(state->last_key, "workspace") == 0) {
+        FREE(filter->workspace);
+        filter->workspace = value;
+    } else if (strcasecmp(state->last_key, "output") == 0) {
+        FREE(filter->output);
+        filter->output = value;
+    } else if (strcasecmp(state->last_key, "backpressure") == 0) {
+        filter->has_backpressure = true;
+        if (strcasecmp(value, "disconnect") == 0) {
+            filter->backpressure = IPC_BACKPRESSURE_DISCONNECT;
+        } else if (strcasecmp(value, "coalesce") == 0) {
+            filter->backpressure = IPC_BACKPRESSURE_COALESCE;
+        } else if (strcasecmp(value, "drop") == 0) {
+            filter->backpressure = IPC_BACKPRESSURE_DROP;
+        } else if (state->error == NULL) {
+            sasprintf(&(state->error), "Unknown backpressure policy \"%s\"", value);
+        }
+        free(value);
+    } else if (strcasecmp(state->last_key, "payload") == 0) {
+        if (strcasecmp(value, "shallow") == 0) {
+            filter->shallow = true;
+        } else if (strcasecmp(value, "full") == 0) {
+            filter->shallow = false;
+        } else if (state->error == NULL) {
+            sasprintf(&(state->error), "Unknown payload \"%s\"", value);
+        }
+        free(value);
+    } else {
+        free(value);
+    }
+    return 1;
 }
 
-/*
- * Callback for the YAJL parser (will be called when a string is parsed).
- *
- */
-static int add_subscription(void *extra, const unsigned char *s,
-                            ylength len) {
-    ipc_client *client = extra;
-
-    DLOG("should add subscription to extra %p, sub %.*s\n", client, (int)len, s);
-    int event = client->num_events;
+static int _subscribe_json_start_map(void *extra) {
+    struct subscribe_state *state = extra;
+    state->depth++;
+    if (state->depth == 2) {
+        state->filter = scalloc(1, sizeof(struct ipc_event_filter));
+        match_init(&(state->filter->match));
+        state->filter_type = 0;
+    } else if (state->depth == 3 && state->filter != NULL &&
+               state->last_key != NULL && strcasecmp(state->last_key, "match") == 0) {
+        state->in_match = true;
+    }
+    return 1;
+}
 
-    client->num_events++;
-    client->events = srealloc(client->events, client->num_events * sizeof(char *));
-    /* We copy the string because it is not null-terminated and strndup()
-     * is missing on some BSD systems */
-    client->events[event] = scalloc(len + 1, 1);
-    memcpy(client->events[event], s, len);
+static int _subscribe_json_end_map(void *extra) {
+    struct subscribe_state *state = extra;
+    if (state->depth == 3) {
+        state->in_match = false;
+    } else if (state->depth == 2 && state->filter != NULL) {
+        struct ipc_event_filter *filter = state->filter;
+        state->filter = NULL;
+        if (filter->has_match && filter->match.error != NULL && state->error == NULL) {
+            sasprintf(&(state->error), "Invalid match criteria: %s", filter->match.error);
+        }
+        if (state->filter_type == 0 && state->error == NULL) {
+            state->error = sstrdup("Filter without \"event\"");
+        }
+        if (state->error != NULL) {
+            ipc_event_filter_free(filter);
+        } else {
+            filter->message_type = state->filter_type;
+            add_subscription(state->client, state->filter_type, filter);
+        }
+    }
+    state->depth--;
+    return 1;
+}
 
-    DLOG("client is now subscribed to:\n");
-    for (int i = 0; i < client->num_events; i++) {
-        DLOG("event %s\n", client->events[i]);
+static int _subscribe_json_start_array(void *extra) {
+    struct subscribe_state *state = extra;
+    /* The "change" array of a filter is parsed like repeated string values
+     * and does not count as a nesting level. */
+    if (!(state->filter != NULL && state->depth == 2)) {
+        state->depth++;
     }
-    DLOG("(done)\n");
+    return 1;
+}
 
+static int _subscribe_json_end_array(void *extra) {
+    struct subscribe_state *state = extra;
+    if (!(state->filter != NULL && state->depth == 2)) {
+        state->depth--;
+    }
     return 1;
 }
 
 /*
  * Subscribes this connection to the event types which were given as a JSON
- * serialized array in the payload field of the message.
+ * serialized array in the payload field of the message. Elements of the array
+ * are either event names or filter maps (see struct subscribe_state).
  *
  */
 IPC_HANDLER(subscribe) {
@@ -1153,11 +2633,24 @@ IPC_HANDLER(subscribe) {
 
     /* Setup the JSON parser */
     static yajl_callbacks callbacks = {
-        .yajl_string = add_subscription,
+        .yajl_string = _subscribe_json_string,
+        .yajl_map_key = _subscribe_json_key,
+        .yajl_start_map = _subscribe_json_start_map,
+        .yajl_end_map = _subscribe_json_end_map,
+        .yajl_start_array = _subscribe_json_start_array,
+        .yajl_end_array = _subscribe_json_end_array,
     };
 
-    p = yalloc(&callbacks, (void *)client);
+    struct subscribe_state state;
+    memset(&state, '\0', sizeof(struct subscribe_state));
+    state.client = client;
+
+    p = yalloc(&callbacks, (void *)&state);
     stat = yajl_parse(p, (const unsigned char *)message, message_size);
+    FREE(state.last_key);
+    if (state.filter != NULL) {
+        ipc_event_filter_free(state.filter);
+    }
     if (stat != yajl_status_ok) {
         unsigned char *err;
         err = yajl_get_error(p, true, (const unsigned char *)message,
@@ -1168,6 +2661,24 @@ IPC_HANDLER(subscribe) {
         const char *reply = "{\"success\":false}";
         ipc_send_client_message(client, strlen(reply), I3_IPC_REPLY_TYPE_SUBSCRIBE, (const uint8_t *)reply);
         yajl_free(p);
+        FREE(state.error);
+        return;
+    }
+    if (state.error != NULL) {
+        ELOG("Invalid subscription filter: %s\n", state.error);
+        yajl_free(p);
+
+        yajl_gen gen = ipc_gen_get();
+        y(map_open);
+        ystr("success");
+        y(bool, false);
+        ystr("error");
+        ystr(state.error);
+        y(map_close);
+        FREE(state.error);
+
+        ipc_send_client_gen(client, I3_IPC_REPLY_TYPE_SUBSCRIBE, gen);
+        ipc_gen_put(gen);
         return;
     }
     yajl_free(p);
@@ -1178,14 +2689,7 @@ IPC_HANDLER(subscribe) {
         return;
     }
 
-    bool is_tick = false;
-    for (int i = 0; i < client->num_events; i++) {
-        if (strcmp(client->events[i], "tick") == 0) {
-            is_tick = true;
-            break;
-        }
-    }
-    if (!is_tick) {
+    if (!(client->events & EVENT_BIT(I3_IPC_EVENT_TICK))) {
         return;
     }
 
@@ -1198,7 +2702,7 @@ IPC_HANDLER(subscribe) {
  * Returns the raw last loaded i3 configuration file contents.
  */
 IPC_HANDLER(get_config) {
-    yajl_gen gen = ygenalloc();
+    yajl_gen gen = ipc_gen_get();
 
     y(map_open);
 
@@ -1207,12 +2711,8 @@ IPC_HANDLER(get_config) {
 
     y(map_close);
 
-    const unsigned char *payload;
-    ylength length;
-    y(get_buf, &payload, &length);
-
-    ipc_send_client_message(client, length, I3_IPC_REPLY_TYPE_CONFIG, payload);
-    y(free);
+    ipc_send_client_gen(client, I3_IPC_REPLY_TYPE_CONFIG, gen);
+    ipc_gen_put(gen);
 }
 
 /*
@@ -1220,7 +2720,7 @@ IPC_HANDLER(get_config) {
  * synchronization point in event-related tests.
  */
 IPC_HANDLER(send_tick) {
-    yajl_gen gen = ygenalloc();
+    yajl_gen gen = ipc_gen_get();
 
     y(map_open);
 
@@ -1228,16 +2728,12 @@ IPC_HANDLER(send_tick) {
     y(bool, false);
 
     ystr("payload");
-    yajl_gen_string(gen, (unsigned char *)message, message_size);
+    y(string, (unsigned char *)message, message_size);
 
     y(map_close);
 
-    const unsigned char *payload;
-    ylength length;
-    y(get_buf, &payload, &length);
-
-    ipc_send_event("tick", I3_IPC_EVENT_TICK, (const char *)payload);
-    y(free);
+    ipc_send_event_gen(I3_IPC_EVENT_TICK, gen, NULL);
+    ipc_gen_put(gen);
 
     const char *reply = "{\"success\":true}";
     ipc_send_client_message(client, strlen(reply), I3_IPC_REPLY_TYPE_TICK, (const uint8_t *)reply);
@@ -1295,17 +2791,425 @@ IPC_HANDLER(sync) {
         yajl_free(p);
         return;
     }
-    yajl_free(p);
+    yajl_free(p);
+
+    DLOG("received IPC sync request (rnd = %d, window = 0x%08x)\n", state.rnd, state.window);
+    sync_respond(state.window, state.rnd);
+    const char *reply = "{\"success\":true}";
+    ipc_send_client_message(client, strlen(reply), I3_IPC_REPLY_TYPE_SYNC, (const uint8_t *)reply);
+}
+
+/*
+ * Formats the reply message for a GET_STATS request and sends it to the
+ * client. Times are reported in nanoseconds.
+ *
+ */
+/*
+ * Dumps the given latency histogram as a key (its name) and value.
+ *
+ */
+static void dump_histogram(yajl_gen gen, const struct stats_histogram *histogram) {
+    ystr(histogram->name);
+    y(map_open);
+
+    ystr("count");
+    y(integer, histogram->count);
+
+    ystr("total_ns");
+    y(integer, histogram->total_ns);
+
+    ystr("max_ns");
+    y(integer, histogram->max_ns);
+
+    ystr("buckets");
+    y(array_open);
+    for (int bucket = 0; bucket < STATS_HISTOGRAM_BUCKETS; bucket++) {
+        y(integer, histogram->buckets[bucket]);
+    }
+    y(array_close);
+
+    y(map_close);
+}
+
+static void dump_slow_frame(yajl_gen gen, const struct stats_slow_frame *frame) {
+    y(map_open);
+
+    ystr("started_at");
+    y(integer, frame->started_at);
+
+    ystr("duration_ns");
+    y(integer, frame->duration_ns);
+
+    ystr("events");
+    y(map_open);
+    for (int i = 0; i < frame->num_event_kinds; i++) {
+        ystr(frame->events[i].kind->name);
+        y(integer, frame->events[i].count);
+    }
+    y(map_close);
+
+    ystr("num_events");
+    y(integer, frame->num_events);
+
+    ystr("commands");
+    y(array_open);
+    for (uint64_t i = 0; i < frame->num_commands && i < STATS_SLOW_FRAME_COMMANDS; i++) {
+        ystr(frame->commands[i]);
+    }
+    y(array_close);
+
+    ystr("num_commands");
+    y(integer, frame->num_commands);
+
+    ystr("ipc_messages");
+    y(integer, frame->ipc_messages);
+
+    ystr("renders");
+    y(integer, frame->renders);
+
+    ystr("render_ns");
+    y(integer, frame->render_ns);
+
+    ystr("x_requests");
+    y(integer, frame->x_requests);
+
+    y(map_close);
+}
+
+IPC_HANDLER(get_stats) {
+    yajl_gen gen = ipc_gen_get();
+    y(map_open);
+
+    for (int i = 0; i < STATS_NUM_COUNTERS; i++) {
+        const struct stats_counter *counter = stats_get(i);
+
+        ystr(stats_counter_name(i));
+        y(map_open);
+
+        ystr("calls");
+        y(integer, counter->calls);
+
+        ystr("total_ns");
+        y(integer, counter->total_ns);
+
+        ystr("max_ns");
+        y(integer, counter->max_ns);
+
+        ystr("x_requests");
+        y(integer, counter->x_requests);
+
+        y(map_close);
+    }
+
+    ystr("coalesced_events");
+    y(map_open);
+    for (int i = 0; i < STATS_NUM_COALESCED; i++) {
+        ystr(stats_coalesced_name(i));
+        y(integer, stats_get_coalesced(i));
+    }
+    y(map_close);
+
+    ystr("x_traffic");
+    y(map_open);
+    for (int last_render = 0; last_render <= 1; last_render++) {
+        ystr(last_render ? "last_render" : "subsystems");
+        y(map_open);
+        for (int i = 0; i < STATS_NUM_X_SUBSYSTEMS; i++) {
+            const struct stats_x_traffic *traffic = stats_get_x_traffic(i, last_render);
+
+            ystr(stats_x_subsystem_name(i));
+            y(map_open);
+            ystr("requests");
+            y(integer, traffic->requests);
+            ystr("round_trips");
+            y(integer, traffic->round_trips);
+            y(map_close);
+        }
+        y(map_close);
+    }
+    ystr("requests");
+    y(map_open);
+    for (int i = 0; i < STATS_NUM_X_REQUEST_TYPES; i++) {
+        ystr(stats_x_request_name(i));
+        y(integer, stats_get_x_requests_of_type(i));
+    }
+    y(map_close);
+    y(map_close);
+
+    ystr("event_latency");
+    y(map_open);
+    for (size_t i = 0; i < stats_num_histograms(); i++) {
+        dump_histogram(gen, stats_get_histogram(i));
+    }
+    y(map_close);
+
+    ystr("window_map_latency");
+    y(map_open);
+    for (int i = 0; i < STATS_NUM_MAP_PHASES; i++) {
+        dump_histogram(gen, stats_get_map_latency(i));
+    }
+    y(map_close);
+
+    ystr("binding_latency");
+    y(map_open);
+    for (int i = 0; i < STATS_NUM_BINDING_PHASES; i++) {
+        dump_histogram(gen, stats_get_binding_latency(i));
+    }
+    y(map_close);
+
+    ystr("slabs");
+    y(map_open);
+    for (size_t i = 0; i < stats_num_slabs(); i++) {
+        slab_stats_t slab;
+        slab_get_stats(stats_get_slab(i), &slab);
+
+        ystr(slab.name);
+        y(map_open);
+
+        ystr("object_size");
+        y(integer, slab.object_size);
+
+        ystr("in_use");
+        y(integer, slab.in_use);
+
+        ystr("capacity");
+        y(integer, slab.capacity);
+
+        ystr("slabs");
+        y(integer, slab.slabs);
+
+        ystr("bytes");
+        y(integer, slab.bytes);
+
+        ystr("allocations");
+        y(integer, slab.allocations);
+
+        y(map_close);
+    }
+    y(map_close);
+
+    ystr("startup");
+    y(map_open);
+    ystr("total_ns");
+    y(integer, stats_startup_total_ns());
+    ystr("phases");
+    y(map_open);
+    for (int i = 0; i < STATS_NUM_STARTUP_PHASES; i++) {
+        const struct stats_startup_phase *phase = stats_get_startup_phase(i);
+        if (phase->start_ns == 0 && phase->duration_ns == 0) {
+            continue;
+        }
+
+        ystr(stats_startup_phase_name(i));
+        y(map_open);
+
+        ystr("start_ns");
+        y(integer, phase->start_ns);
+
+        ystr("duration_ns");
+        y(integer, phase->duration_ns);
+
+        y(map_close);
+    }
+    y(map_close);
+    y(map_close);
+
+    ystr("memory");
+    y(map_open);
+
+    ystr("allocations");
+    y(map_open);
+    for (int i = 0; i < ALLOC_NUM_FUNCTIONS; i++) {
+        alloc_counter_t counter;
+        alloc_get_counter(i, &counter);
+
+        ystr(alloc_function_name(i));
+        y(map_open);
+        ystr("calls");
+        y(integer, counter.calls);
+        ystr("bytes");
+        y(integer, counter.bytes);
+        y(map_close);
+    }
+    y(map_close);
+
+    const i3_shmlog_memory *memory = stats_get_memory();
+    ystr("heap");
+    y(map_open);
+    ystr("in_use");
+    y(integer, memory->heap_in_use);
+    ystr("peak_in_use");
+    y(integer, memory->heap_peak_in_use);
+    ystr("free");
+    y(integer, memory->heap_free);
+    ystr("mmapped");
+    y(integer, memory->heap_mmapped);
+    y(map_close);
+
+    size_t ipc_backlog = 0;
+    ipc_client *current;
+    TAILQ_FOREACH(current, &all_clients, clients) {
+        ipc_backlog += current->queued_bytes + current->read_buffer_size;
+    }
+    ystr("ipc_buffers");
+    y(integer, ipc_backlog);
+
+    ystr("shmlog");
+    y(integer, log_shmlog_bytes());
+
+    y(map_close);
+
+    ystr("slow_frames");
+    y(map_open);
+    ystr("threshold_ns");
+    y(integer, (long long)(config.slow_frame_threshold * 1e9));
+    ystr("count");
+    y(integer, stats_num_slow_frames());
+    ystr("frames");
+    y(array_open);
+    const struct stats_slow_frame *frame;
+    for (size_t i = 0; (frame = stats_get_slow_frame(i)) != NULL; i++) {
+        dump_slow_frame(gen, frame);
+    }
+    y(array_close);
+    y(map_close);
+
+    y(map_close);
+
+    ipc_send_client_gen(client, I3_IPC_REPLY_TYPE_STATS, gen);
+    ipc_gen_put(gen);
+}
+
+static bool ipc_client_peer(ipc_client *client, pid_t *pid, char *cmdline, size_t size);
+
+/*
+ * Formats the reply message for a GET_CLIENTS request: the traffic counters,
+ * subscriptions and peer process of every IPC connection.
+ *
+ */
+IPC_HANDLER(get_clients) {
+    yajl_gen gen = ipc_gen_get();
+    y(array_open);
+
+    ipc_client *current;
+    TAILQ_FOREACH(current, &all_clients, clients) {
+        y(map_open);
+
+        ystr("id");
+        y(integer, (uintptr_t)current);
+        ystr("fd");
+        y(integer, current->fd);
+        ystr("self");
+        y(bool, current == client);
+
+        pid_t pid;
+        char cmdline[512];
+        const bool has_peer = ipc_client_peer(current, &pid, cmdline, sizeof(cmdline));
+        ystr("pid");
+        if (has_peer)
+            y(integer, pid);
+        else
+            y(null);
+        ystr("cmdline");
+        if (has_peer)
+            ystr(cmdline);
+        else
+            y(null);
+
+        ystr("encoding");
+        ystr((current->encoding == IPC_ENCODING_CBOR ? "cbor" : "json"));
+
+        ystr("events");
+        y(array_open);
+        for (size_t i = 0; i < sizeof(event_names) / sizeof(event_names[0]); i++) {
+            if (current->events & (1U << i)) {
+                ystr(event_names[i]);
+            }
+        }
+        y(array_close);
+
+        int num_filters = 0;
+        struct ipc_event_filter *filter;
+        TAILQ_FOREACH(filter, &(current->filters_head), filters) {
+            num_filters++;
+        }
+        ystr("filters");
+        y(integer, num_filters);
+
+        ystr("bytes_received");
+        y(integer, current->bytes_received);
+        ystr("messages_received");
+        y(integer, current->messages_received);
+        ystr("bytes_sent");
+        y(integer, current->bytes_sent);
+        ystr("messages_sent");
+        y(integer, current->messages_sent);
+        ystr("events_coalesced");
+        y(integer, current->events_coalesced);
+        ystr("events_dropped");
+        y(integer, current->events_dropped);
+
+        int queued_messages = 0;
+        struct ipc_chunk *chunk;
+        TAILQ_FOREACH(chunk, &(current->chunks_head), chunks) {
+            if (chunk->message->next == NULL) {
+                queued_messages++;
+            }
+        }
+        ystr("queued_messages");
+        y(integer, queued_messages);
+        ystr("queued_bytes");
+        y(integer, current->queued_bytes);
+        ystr("queued_bytes_max");
+        y(integer, current->queued_bytes_max);
+
+        ystr("handler_ns");
+        y(integer, current->handler_ns);
+
+        /* Set while the client does not read its messages; it is killed when
+         * the timeout expires. */
+        ystr("write_timeout_pending");
+        y(bool, current->timeout != NULL);
+
+        y(map_close);
+    }
+
+    y(array_close);
+
+    ipc_send_client_gen(client, I3_IPC_REPLY_TYPE_CLIENTS, gen);
+    ipc_gen_put(gen);
+}
+
+/*
+ * Switches the encoding of all following replies and events on this
+ * connection to the one named in the payload ("json" or "cbor"). The reply
+ * itself is sent in the previous encoding.
+ *
+ */
+IPC_HANDLER(set_encoding) {
+    ipc_encoding_t encoding;
+    if (message_size == strlen("json") && strncasecmp((const char *)message, "json", message_size) == 0) {
+        encoding = IPC_ENCODING_JSON;
+    } else if (message_size == strlen("cbor") && strncasecmp((const char *)message, "cbor", message_size) == 0) {
+        encoding = IPC_ENCODING_CBOR;
+    } else {
+        const char *reply = "{\"success\":false,\"error\":\"Unknown encoding\"}";
+        ipc_send_client_message(client, strlen(reply), I3_IPC_REPLY_TYPE_SET_ENCODING, (const uint8_t *)reply);
+        return;
+    }
 
-    DLOG("received IPC sync request (rnd = %d, window = 0x%08x)\n", state.rnd, state.window);
-    sync_respond(state.window, state.rnd);
     const char *reply = "{\"success\":true}";
-    ipc_send_client_message(client, strlen(reply), I3_IPC_REPLY_TYPE_SYNC, (const uint8_t *)reply);
+    ipc_send_client_message(client, strlen(reply), I3_IPC_REPLY_TYPE_SET_ENCODING, (const uint8_t *)reply);
+    DLOG("Client on fd %d switches to encoding %d\n", client->fd, encoding);
+    if (client->encoding != encoding) {
+        cbor_clients += (encoding == IPC_ENCODING_CBOR ? 1 : -1);
+    }
+    client->encoding = encoding;
 }
 
 /* The index of each callback function corresponds to the numeric
  * value of the message type (see include/i3/ipc.h) */
-handler_t handlers[12] = {
+handler_t handlers[16] = {
     handle_run_command,
     handle_get_workspaces,
     handle_subscribe,
@@ -1318,62 +3222,138 @@ handler_t handlers[12] = {
     handle_get_config,
     handle_send_tick,
     handle_sync,
+    handle_get_stats,
+    handle_set_encoding,
+    handle_run_commands,
+    handle_get_clients,
 };
 
+/* The minimum free space in a client's read buffer before each read(). */
+#define IPC_READ_CHUNK 4096
+
 /*
- * Handler for activity on a client connection, receives a message from a
- * client.
+ * Returns whether the given client is still connected. Handlers may
+ * disconnect clients, for example when a restart fails after all connections
+ * were shut down.
  *
- * For now, the maximum message size is 2048. I’m not sure for what the
- * IPC interface will be used in the future, thus I’m not implementing a
- * mechanism for arbitrarily long messages, as it seems like overkill
- * at the moment.
+ */
+static bool ipc_client_is_connected(ipc_client *client) {
+    ipc_client *current;
+    TAILQ_FOREACH(current, &all_clients, clients) {
+        if (current == client) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Handler for activity on a client connection. Reads as much as is available
+ * into the client's read buffer and handles all complete messages in it. The
+ * handlers get a pointer into the buffer, so messages are not copied.
  *
  */
 static void ipc_receive_message(EV_P_ struct ev_io *w, int revents) {
-    uint32_t message_type;
-    uint32_t message_length;
-    uint8_t *message = NULL;
     ipc_client *client = (ipc_client *)w->data;
     assert(client->fd == w->fd);
 
-    int ret = ipc_recv_message(w->fd, &message_type, &message_length, &message);
-    /* EOF or other error */
-    if (ret < 0) {
-        /* Was this a spurious read? See ev(3) */
-        if (ret == -1 && errno == EAGAIN) {
-            FREE(message);
-            return;
+    const size_t header_size = sizeof(i3_ipc_header_t);
+
+    /* Make room for at least IPC_READ_CHUNK bytes or, if the header of the
+     * next message was received already, for the rest of that message. */
+    size_t needed = client->read_buffer_len + IPC_READ_CHUNK;
+    if (client->read_buffer_len >= header_size) {
+        uint32_t message_length;
+        memcpy(&message_length, client->read_buffer + strlen(I3_IPC_MAGIC), sizeof(uint32_t));
+        if (header_size + (size_t)message_length > needed) {
+            needed = header_size + message_length;
         }
+    }
+    if (needed > client->read_buffer_size) {
+        client->read_buffer_size = needed;
+        client->read_buffer = srealloc(client->read_buffer, client->read_buffer_size);
+    }
 
-        /* If not, there was some kind of error. We don’t bother and close the
-         * connection. Delete the client from the list of clients. */
+    const ssize_t n = read(w->fd, client->read_buffer + client->read_buffer_len,
+                           client->read_buffer_size - client->read_buffer_len);
+    if (n == -1 && (errno == EAGAIN || errno == EINTR)) {
+        /* Spurious read, see ev(3). */
+        return;
+    }
+    if (n <= 0) {
+        /* EOF or some kind of error. We don’t bother and close the connection.
+         * Delete the client from the list of clients. */
         free_ipc_client(client, -1);
-        FREE(message);
         return;
     }
+    client->read_buffer_len += n;
+    client->bytes_received += n;
+
+    size_t offset = 0;
+    while (client->read_buffer_len - offset >= header_size) {
+        const uint8_t *header = client->read_buffer + offset;
+        if (memcmp(header, I3_IPC_MAGIC, strlen(I3_IPC_MAGIC)) != 0) {
+            ELOG("IPC: invalid magic in header, got \"%.*s\", want \"%s\"\n",
+                 (int)strlen(I3_IPC_MAGIC), header, I3_IPC_MAGIC);
+            free_ipc_client(client, -1);
+            return;
+        }
+
+        uint32_t message_length, message_type;
+        memcpy(&message_length, header + strlen(I3_IPC_MAGIC), sizeof(uint32_t));
+        memcpy(&message_type, header + strlen(I3_IPC_MAGIC) + sizeof(uint32_t), sizeof(uint32_t));
+        if (client->read_buffer_len - offset - header_size < message_length) {
+            break;
+        }
 
-    if (message_type >= (sizeof(handlers) / sizeof(handler_t)))
-        DLOG("Unhandled message type: %d\n", message_type);
-    else {
-        handler_t h = handlers[message_type];
-        h(client, message, 0, message_length, message_type);
+        uint8_t *message = client->read_buffer + offset + header_size;
+        offset += header_size + message_length;
+
+        if (message_type >= (sizeof(handlers) / sizeof(handler_t)))
+            DLOG("Unhandled message type: %d\n", message_type);
+        else {
+            handler_t h = handlers[message_type];
+            const uint64_t start = stats_now_ns();
+            client->messages_received++;
+            /* Events caused by the message (e.g. a command) are written
+             * along with the reply, after the render. */
+            I3_PROBE3(ipc_receive, client->fd, message_type, message_length);
+            stats_frame_ipc_message();
+            ipc_hold_messages();
+            h(client, message, 0, message_length, message_type);
+            ipc_release_messages();
+            if (!ipc_client_is_connected(client)) {
+                return;
+            }
+            client->handler_ns += stats_now_ns() - start;
+        }
     }
 
-    FREE(message);
+    /* Move the start of the next message to the front of the buffer. */
+    client->read_buffer_len -= offset;
+    if (client->read_buffer_len > 0 && offset > 0) {
+        memmove(client->read_buffer, client->read_buffer + offset, client->read_buffer_len);
+    }
+    if (client->read_buffer_len == 0 && client->read_buffer_size > 16 * IPC_READ_CHUNK) {
+        /* Do not keep the memory of a large message around. */
+        FREE(client->read_buffer);
+        client->read_buffer_size = 0;
+    }
 }
 
-static void ipc_client_timeout(EV_P_ ev_timer *w, int revents) {
-    /* No need to be polite and check for writeability, the other callback would
-     * have been called by now. */
-    ipc_client *client = (ipc_client *)w->data;
-
-    char *cmdline = NULL;
+/*
+ * Looks up the pid and command line of the process on the other end of the
+ * client's connection. The command line is cut off after size - 1 bytes.
+ * Returns false if they cannot be determined, which is always the case on
+ * platforms other than Linux.
+ *
+ */
+static bool ipc_client_peer(ipc_client *client, pid_t *pid, char *cmdline, size_t size) {
 #if defined(__linux__) && defined(SO_PEERCRED)
     struct ucred peercred;
     socklen_t so_len = sizeof(peercred);
     if (getsockopt(client->fd, SOL_SOCKET, SO_PEERCRED, &peercred, &so_len) != 0) {
-        goto end;
+        return false;
     }
     char *exepath;
     sasprintf(&exepath, "/proc/%d/cmdline", peercred.pid);
@@ -1381,28 +3361,36 @@ static void ipc_client_timeout(EV_P_ ev_timer *w, int revents) {
     int fd = open(exepath, O_RDONLY);
     free(exepath);
     if (fd == -1) {
-        goto end;
+        return false;
     }
-    char buf[512] = {'\0'}; /* cut off cmdline for the error message. */
-    const ssize_t n = read(fd, buf, sizeof(buf));
+    const ssize_t n = read(fd, cmdline, size - 1);
     close(fd);
     if (n < 0) {
-        goto end;
+        return false;
     }
-    for (char *walk = buf; walk < buf + n - 1; walk++) {
+    cmdline[n] = '\0';
+    for (char *walk = cmdline; walk < cmdline + n - 1; walk++) {
         if (*walk == '\0') {
             *walk = ' ';
         }
     }
-    cmdline = buf;
+    *pid = peercred.pid;
+    return true;
+#else
+    return false;
+#endif
+}
 
-    if (cmdline) {
-        ELOG("client %p with pid %d and cmdline '%s' on fd %d timed out, killing\n", client, peercred.pid, cmdline, client->fd);
-    }
+static void ipc_client_timeout(wheel_timer *timer) {
+    /* No need to be polite and check for writeability, the other callback would
+     * have been called by now. */
+    ipc_client *client = (ipc_client *)timer->data;
 
-end:
-#endif
-    if (!cmdline) {
+    pid_t pid;
+    char cmdline[512]; /* cut off cmdline for the error message. */
+    if (ipc_client_peer(client, &pid, cmdline, sizeof(cmdline))) {
+        ELOG("client %p with pid %d and cmdline '%s' on fd %d timed out, killing\n", client, pid, cmdline, client->fd);
+    } else {
         ELOG("client %p on fd %d timed out, killing\n", client, client->fd);
     }
 
@@ -1456,6 +3444,8 @@ ipc_client *ipc_new_client_on_fd(EV_P_ int fd) {
 
     ipc_client *client = scalloc(1, sizeof(ipc_client));
     client->fd = fd;
+    TAILQ_INIT(&(client->chunks_head));
+    TAILQ_INIT(&(client->filters_head));
 
     client->read_callback = scalloc(1, sizeof(struct ev_io));
     client->read_callback->data = client;
@@ -1465,6 +3455,8 @@ ipc_client *ipc_new_client_on_fd(EV_P_ int fd) {
     client->write_callback = scalloc(1, sizeof(struct ev_io));
     client->write_callback->data = client;
     ev_io_init(client->write_callback, ipc_socket_writeable_cb, fd, EV_WRITE);
+    /* Pending X events are handled before the remaining IPC writes. */
+    ev_set_priority(client->write_callback, EV_MINPRI);
 
     DLOG("IPC: new client connected on fd %d\n", fd);
     TAILQ_INSERT_TAIL(&all_clients, client, clients);
@@ -1523,12 +3515,14 @@ int ipc_create_socket(const char *filename) {
 }
 
 /*
- * Generates a json workspace event. Returns a dynamically allocated yajl
- * generator. Free with yajl_gen_free().
+ * Generates a json workspace event, with only the IDs of the children of the
+ * workspaces if shallow is set.
+ *
  */
-yajl_gen ipc_marshal_workspace_event(const char *change, Con *current, Con *old) {
+static yajl_gen marshal_workspace_event(const char *change, Con *current, Con *old, bool shallow) {
     setlocale(LC_NUMERIC, "C");
-    yajl_gen gen = ygenalloc();
+    yajl_gen gen = ipc_gen_get();
+    const struct dump_filter *filter = (shallow ? &shallow_filter : NULL);
 
     y(map_open);
 
@@ -1539,13 +3533,13 @@ yajl_gen ipc_marshal_workspace_event(const char *change, Con *current, Con *old)
     if (current == NULL)
         y(null);
     else
-        dump_node(gen, current, false);
+        dump_node_filtered(gen, current, false, filter, 0);
 
     ystr("old");
     if (old == NULL)
         y(null);
     else
-        dump_node(gen, old, false);
+        dump_node_filtered(gen, old, false, filter, 0);
 
     y(map_close);
 
@@ -1554,33 +3548,55 @@ yajl_gen ipc_marshal_workspace_event(const char *change, Con *current, Con *old)
     return gen;
 }
 
+/*
+ * Generates a json workspace event. Returns a dynamically allocated yajl
+ * generator. Return it with ipc_gen_put().
+ */
+yajl_gen ipc_marshal_workspace_event(const char *change, Con *current, Con *old) {
+    return marshal_workspace_event(change, current, old, false);
+}
+
+
 /*
  * For the workspace events we send, along with the usual "change" field, also
  * the workspace container in "current". For focus events, we send the
  * previously focused workspace in "old".
  */
 void ipc_send_workspace_event(const char *change, Con *current, Con *old) {
-    yajl_gen gen = ipc_marshal_workspace_event(change, current, old);
+    ipc_invalidate_cached_replies();
 
-    const unsigned char *payload;
-    ylength length;
-    y(get_buf, &payload, &length);
+    if (!ipc_has_event_listeners(I3_IPC_EVENT_WORKSPACE))
+        return;
+
+    struct ipc_event_info info;
+    ipc_event_info_init(&info, change, current);
+    bool full, shallow;
+    ipc_event_wanted_payloads(I3_IPC_EVENT_WORKSPACE, &info, &full, &shallow);
+    if (!full && !shallow) {
+        ipc_event_info_free(&info);
+        return;
+    }
 
-    ipc_send_event("workspace", I3_IPC_EVENT_WORKSPACE, (const char *)payload);
+    yajl_gen gen = (full ? marshal_workspace_event(change, current, old, false) : NULL);
+    yajl_gen shallow_gen = (shallow ? marshal_workspace_event(change, current, old, true) : NULL);
 
-    y(free);
+    ipc_send_event_gens(I3_IPC_EVENT_WORKSPACE, gen, shallow_gen, &info);
+
+    if (gen != NULL)
+        ipc_gen_put(gen);
+    if (shallow_gen != NULL)
+        ipc_gen_put(shallow_gen);
+    ipc_event_info_free(&info);
 }
 
 /*
- * For the window events we send, along the usual "change" field,
- * also the window container, in "container".
+ * Generates a json window event, with only the IDs of the children of the
+ * container if shallow is set.
+ *
  */
-void ipc_send_window_event(const char *property, Con *con) {
-    DLOG("Issue IPC window %s event (con = %p, window = 0x%08x)\n",
-         property, con, (con->window ? con->window->id : XCB_WINDOW_NONE));
-
+static yajl_gen marshal_window_event(const char *property, Con *con, const uint64_t *map_latency_ns, bool shallow) {
     setlocale(LC_NUMERIC, "C");
-    yajl_gen gen = ygenalloc();
+    yajl_gen gen = ipc_gen_get();
 
     y(map_open);
 
@@ -1588,17 +3604,73 @@ void ipc_send_window_event(const char *property, Con *con) {
     ystr(property);
 
     ystr("container");
-    dump_node(gen, con, false);
+    dump_node_filtered(gen, con, false, (shallow ? &shallow_filter : NULL), 0);
 
-    y(map_close);
+    if (map_latency_ns != NULL) {
+        ystr("latency_ns");
+        y(map_open);
+        for (int i = 0; i < STATS_NUM_MAP_PHASES; i++) {
+            ystr(stats_get_map_latency(i)->name);
+            y(integer, map_latency_ns[i]);
+        }
+        y(map_close);
+    }
 
-    const unsigned char *payload;
-    ylength length;
-    y(get_buf, &payload, &length);
+    y(map_close);
 
-    ipc_send_event("window", I3_IPC_EVENT_WINDOW, (const char *)payload);
-    y(free);
     setlocale(LC_NUMERIC, "");
+
+    return gen;
+}
+
+/*
+ * Sends a window event. For the "mapped" change, map_latency_ns contains the
+ * duration of each phase of managing the window (see stats_map_phase_t).
+ *
+ */
+static void send_window_event(const char *property, Con *con, const uint64_t *map_latency_ns) {
+    DLOG("Issue IPC window %s event (con = %p, window = 0x%08x)\n",
+         property, con, (con->window ? con->window->id : XCB_WINDOW_NONE));
+
+    if (!ipc_has_event_listeners(I3_IPC_EVENT_WINDOW))
+        return;
+
+    struct ipc_event_info info;
+    ipc_event_info_init(&info, property, con);
+    bool full, shallow;
+    ipc_event_wanted_payloads(I3_IPC_EVENT_WINDOW, &info, &full, &shallow);
+    if (!full && !shallow) {
+        ipc_event_info_free(&info);
+        return;
+    }
+
+    yajl_gen gen = (full ? marshal_window_event(property, con, map_latency_ns, false) : NULL);
+    yajl_gen shallow_gen = (shallow ? marshal_window_event(property, con, map_latency_ns, true) : NULL);
+
+    ipc_send_event_gens(I3_IPC_EVENT_WINDOW, gen, shallow_gen, &info);
+
+    if (gen != NULL)
+        ipc_gen_put(gen);
+    if (shallow_gen != NULL)
+        ipc_gen_put(shallow_gen);
+    ipc_event_info_free(&info);
+}
+
+/*
+ * For the window events we send, along the usual "change" field,
+ * also the window container, in "container".
+ */
+void ipc_send_window_event(const char *property, Con *con) {
+    send_window_event(property, con, NULL);
+}
+
+/*
+ * Sends the window "mapped" event for a new window once its frame was mapped
+ * and focused, along with how long each phase of managing it took (see
+ * stats_map_phase_t), in "latency_ns".
+ */
+void ipc_send_window_mapped_event(Con *con, const uint64_t *latency_ns) {
+    send_window_event("mapped", con, latency_ns);
 }
 
 /*
@@ -1606,8 +3678,27 @@ void ipc_send_window_event(const char *property, Con *con) {
  */
 void ipc_send_barconfig_update_event(Barconfig *barconfig) {
     DLOG("Issue barconfig_update event for id = %s\n", barconfig->id);
+    if (!ipc_has_event_listeners(I3_IPC_EVENT_BARCONFIG_UPDATE))
+        return;
+
     setlocale(LC_NUMERIC, "C");
-    yajl_gen gen = ygenalloc();
+    yajl_gen gen = ipc_gen_get();
+
+    dump_bar_config(gen, barconfig);
+
+    ipc_send_event_gen(I3_IPC_EVENT_BARCONFIG_UPDATE, gen, NULL);
+    ipc_gen_put(gen);
+    setlocale(LC_NUMERIC, "");
+}
+
+/*
+ * Returns the bar configuration serialized like in barconfig_update events.
+ * The caller has to free() the result.
+ *
+ */
+char *ipc_bar_config_json(Barconfig *barconfig) {
+    setlocale(LC_NUMERIC, "C");
+    yajl_gen gen = ipc_gen_get();
 
     dump_bar_config(gen, barconfig);
 
@@ -1615,20 +3706,32 @@ void ipc_send_barconfig_update_event(Barconfig *barconfig) {
     ylength length;
     y(get_buf, &payload, &length);
 
-    ipc_send_event("barconfig_update", I3_IPC_EVENT_BARCONFIG_UPDATE, (const char *)payload);
-    y(free);
+    char *json = smalloc(length + 1);
+    memcpy(json, payload, length);
+    json[length] = '\0';
+    ipc_gen_put(gen);
     setlocale(LC_NUMERIC, "");
+    return json;
 }
 
 /*
- * For the binding events, we send the serialized binding struct.
+ * Sends a binding event. For key bindings, latency_ns contains the duration of
+ * each phase of running the binding (see stats_binding_phase_t) and event_time
+ * the X11 timestamp of the key event.
+ *
  */
-void ipc_send_binding_event(const char *event_type, Binding *bind) {
+static void send_binding_event(const char *event_type, Binding *bind,
+                               xcb_timestamp_t event_time, const uint64_t *latency_ns) {
     DLOG("Issue IPC binding %s event (sym = %s, code = %d)\n", event_type, bind->symbol, bind->keycode);
 
+    struct ipc_event_info info;
+    ipc_event_info_init(&info, event_type, NULL);
+    if (!ipc_event_has_recipients(I3_IPC_EVENT_BINDING, &info))
+        return;
+
     setlocale(LC_NUMERIC, "C");
 
-    yajl_gen gen = ygenalloc();
+    yajl_gen gen = ipc_gen_get();
 
     y(map_open);
 
@@ -1638,15 +3741,367 @@ void ipc_send_binding_event(const char *event_type, Binding *bind) {
     ystr("binding");
     dump_binding(gen, bind);
 
+    if (latency_ns != NULL) {
+        ystr("event_time");
+        y(integer, event_time);
+
+        ystr("latency_ns");
+        y(map_open);
+        for (int i = 0; i < STATS_NUM_BINDING_PHASES; i++) {
+            ystr(stats_get_binding_latency(i)->name);
+            y(integer, latency_ns[i]);
+        }
+        y(map_close);
+    }
+
     y(map_close);
 
-    const unsigned char *payload;
-    ylength length;
-    y(get_buf, &payload, &length);
+    ipc_send_event_gen(I3_IPC_EVENT_BINDING, gen, &info);
+
+    ipc_gen_put(gen);
+    setlocale(LC_NUMERIC, "");
+}
 
-    ipc_send_event("binding", I3_IPC_EVENT_BINDING, (const char *)payload);
+/*
+ * For the binding events, we send the serialized binding struct.
+ */
+void ipc_send_binding_event(const char *event_type, Binding *bind) {
+    send_binding_event(event_type, bind, XCB_CURRENT_TIME, NULL);
+}
 
-    y(free);
+/*
+ * Sends the binding "run" event for a key binding once its result was flushed
+ * to X11, along with the X11 timestamp of the key event in "event_time" and
+ * how long each phase of running the binding took (see stats_binding_phase_t)
+ * in "latency_ns".
+ */
+void ipc_send_binding_run_event(Binding *bind, xcb_timestamp_t event_time, const uint64_t *latency_ns) {
+    send_binding_event("run", bind, event_time, latency_ns);
+}
+
+/* The fields of a container which are compared between tree events. */
+static const char *tree_fields[] = {
+    "type",
+    "name",
+    "num",
+    "layout",
+    "border",
+    "rect",
+    "focused",
+    "urgent",
+    "fullscreen_mode",
+    "floating",
+    "window",
+};
+
+#define TREE_NUM_FIELDS (sizeof(tree_fields) / sizeof(tree_fields[0]))
+
+/*
+ * The state of a container as of the last tree event. Only the fields listed
+ * in tree_fields are kept; everything else is not part of the diff.
+ *
+ */
+struct tree_snapshot_node {
+    Con *con;
+    Con *parent;
+    bool in_floating;
+    int index;
+
+    /* The generation of the walk which last saw this container. Containers
+     * which were not seen by the current walk have been removed. */
+    uint32_t generation;
+    /* Bitmask of changed tree_fields, or UINT32_MAX for new containers. */
+    uint32_t changed;
+    bool moved;
+
+    int type;
+    char *name;
+    int num;
+    layout_t layout;
+    border_style_t border_style;
+    Rect rect;
+    bool focused;
+    bool urgent;
+    fullscreen_mode_t fullscreen_mode;
+    int floating;
+    xcb_window_t window;
+};
+
+/* Maps Con pointers to their struct tree_snapshot_node. Only maintained while
+ * any client is subscribed to the tree event. */
+static hashmap_t *tree_snapshot = NULL;
+static uint32_t tree_snapshot_generation = 0;
+
+/* The containers touched by the current walk, in tree order. */
+static struct tree_snapshot_node **tree_touched = NULL;
+static size_t tree_num_touched = 0;
+static size_t tree_touched_size = 0;
+
+/* The filters used to dump all tracked or only the changed fields of a
+ * container. */
+static hashmap_t *tree_all_fields = NULL;
+static hashmap_t *tree_changed_fields = NULL;
+
+static void tree_touched_append(struct tree_snapshot_node *node) {
+    if (tree_num_touched == tree_touched_size) {
+        tree_touched_size = (tree_touched_size == 0 ? 64 : tree_touched_size * 2);
+        tree_touched = srealloc(tree_touched, tree_touched_size * sizeof(struct tree_snapshot_node *));
+    }
+    tree_touched[tree_num_touched++] = node;
+}
+
+#define TREE_FIELD_DIFFERS(bit, differs) \
+    do {                                 \
+        if (differs)                     \
+            changed |= (1U << (bit));    \
+    } while (0)
+
+/*
+ * Copies the tracked fields of con into node and returns a bitmask of the
+ * fields which differ from the previous snapshot.
+ *
+ */
+static uint32_t tree_snapshot_update(struct tree_snapshot_node *node, Con *con) {
+    const char *name = NULL;
+    if (con->window && con->window->name)
+        name = i3string_as_utf8(con->window->name);
+    else
+        name = con->name;
+
+    uint32_t changed = 0;
+    TREE_FIELD_DIFFERS(0, node->type != (int)con->type);
+    TREE_FIELD_DIFFERS(1, (name == NULL) != (node->name == NULL) ||
+                              (name != NULL && strcmp(name, node->name) != 0));
+    TREE_FIELD_DIFFERS(2, con->type == CT_WORKSPACE && node->num != con->num);
+    TREE_FIELD_DIFFERS(3, node->layout != con->layout);
+    TREE_FIELD_DIFFERS(4, node->border_style != con->border_style);
+    TREE_FIELD_DIFFERS(5, memcmp(&(node->rect), &(con->rect), sizeof(Rect)) != 0);
+    TREE_FIELD_DIFFERS(6, node->focused != (con == focused));
+    TREE_FIELD_DIFFERS(7, node->urgent != con->urgent);
+    TREE_FIELD_DIFFERS(8, node->fullscreen_mode != con->fullscreen_mode);
+    TREE_FIELD_DIFFERS(9, node->floating != (int)con->floating);
+    TREE_FIELD_DIFFERS(10, node->window != (con->window ? con->window->id : XCB_NONE));
+
+    if (changed & (1U << 1)) {
+        FREE(node->name);
+        if (name != NULL)
+            node->name = sstrdup(name);
+    }
+    node->type = con->type;
+    node->num = con->num;
+    node->layout = con->layout;
+    node->border_style = con->border_style;
+    node->rect = con->rect;
+    node->focused = (con == focused);
+    node->urgent = con->urgent;
+    node->fullscreen_mode = con->fullscreen_mode;
+    node->floating = con->floating;
+    node->window = (con->window ? con->window->id : XCB_NONE);
+    return changed;
+}
+
+#undef TREE_FIELD_DIFFERS
+
+/*
+ * Updates the snapshot of con and its children. When record is true, every
+ * container which was added, moved or changed is appended to tree_touched.
+ *
+ */
+static void tree_snapshot_walk(Con *con, Con *parent, bool in_floating, int index, bool record) {
+    struct tree_snapshot_node *node = hashmap_get(tree_snapshot, &con, sizeof(Con *));
+    if (node == NULL) {
+        node = scalloc(1, sizeof(struct tree_snapshot_node));
+        node->con = con;
+        tree_snapshot_update(node, con);
+        node->changed = UINT32_MAX;
+        hashmap_set(tree_snapshot, &con, sizeof(Con *), node);
+    } else {
+        node->changed = tree_snapshot_update(node, con);
+        node->moved = (node->parent != parent ||
+                       node->in_floating != in_floating ||
+                       node->index != index);
+    }
+    node->parent = parent;
+    node->in_floating = in_floating;
+    node->index = index;
+    node->generation = tree_snapshot_generation;
+
+    if (record && (node->changed != 0 || node->moved))
+        tree_touched_append(node);
+
+    Con *child;
+    int i = 0;
+    TAILQ_FOREACH(child, &(con->nodes_head), nodes) {
+        tree_snapshot_walk(child, con, false, i++, record);
+    }
+    i = 0;
+    TAILQ_FOREACH(child, &(con->floating_head), floating_windows) {
+        tree_snapshot_walk(child, con, true, i++, record);
+    }
+}
+
+static void tree_snapshot_node_free(struct tree_snapshot_node *node) {
+    FREE(node->name);
+    free(node);
+}
+
+static void tree_snapshot_free_cb(const void *key, size_t keylen, void *value, void *userdata) {
+    tree_snapshot_node_free(value);
+}
+
+static void tree_snapshot_free(void) {
+    if (tree_snapshot == NULL)
+        return;
+    hashmap_foreach(tree_snapshot, tree_snapshot_free_cb, NULL);
+    hashmap_free(tree_snapshot);
+    tree_snapshot = NULL;
+}
+
+/*
+ * Takes a new snapshot of the whole tree without sending an event. Called when
+ * the first client subscribes to the tree event, so that the diffs it receives
+ * apply to the tree it requests with GET_TREE after subscribing.
+ *
+ */
+static void tree_snapshot_reset(void) {
+    tree_snapshot_free();
+    tree_snapshot = hashmap_new();
+    tree_snapshot_generation++;
+    tree_snapshot_walk(croot, NULL, false, 0, false);
+}
+
+static void tree_snapshot_collect_removed_cb(const void *key, size_t keylen, void *value, void *userdata) {
+    struct tree_snapshot_node *node = value;
+    if (node->generation != tree_snapshot_generation)
+        tree_touched_append(node);
+}
+
+static void dump_tree_position(yajl_gen gen, struct tree_snapshot_node *node) {
+    ystr("parent");
+    if (node->parent == NULL)
+        y(null);
+    else
+        y(integer, (uintptr_t)node->parent);
+    ystr("list");
+    ystr((node->in_floating ? "floating_nodes" : "nodes"));
+    ystr("index");
+    y(integer, node->index);
+}
+
+/*
+ * Compares the tree to the snapshot taken at the last call and sends a tree
+ * event to the subscribed clients with the containers which were added,
+ * removed, moved to a different position or whose fields changed. Called after
+ * every push of changes to X11.
+ *
+ */
+void ipc_send_tree_event(void) {
+    if (!ipc_has_event_listeners(I3_IPC_EVENT_TREE)) {
+        /* Nobody is interested anymore. The snapshot will be taken again
+         * once a client subscribes. */
+        tree_snapshot_free();
+        return;
+    }
+    if (tree_snapshot == NULL) {
+        tree_snapshot_reset();
+        return;
+    }
+
+    tree_snapshot_generation++;
+    tree_num_touched = 0;
+    tree_snapshot_walk(croot, NULL, false, 0, true);
+    const size_t num_updated = tree_num_touched;
+    hashmap_foreach(tree_snapshot, tree_snapshot_collect_removed_cb, NULL);
+    if (tree_num_touched == 0)
+        return;
+
+    if (tree_all_fields == NULL) {
+        tree_all_fields = hashmap_new();
+        for (size_t field = 0; field < TREE_NUM_FIELDS; field++) {
+            hashmap_set(tree_all_fields, tree_fields[field], strlen(tree_fields[field]), (void *)1);
+        }
+        tree_changed_fields = hashmap_new();
+    }
+
+    setlocale(LC_NUMERIC, "C");
+    yajl_gen gen = ipc_gen_get();
+
+    y(map_open);
+    ystr("change");
+    ystr("diff");
+
+    struct dump_filter filter = {
+        .fields = NULL,
+        .max_depth = 0,
+        .omit_children = true,
+    };
+
+    /* Containers are listed in tree order, so parents are added before
+     * their children. */
+    ystr("added");
+    y(array_open);
+    for (size_t i = 0; i < num_updated; i++) {
+        struct tree_snapshot_node *node = tree_touched[i];
+        if (node->changed != UINT32_MAX)
+            continue;
+        y(map_open);
+        dump_tree_position(gen, node);
+        ystr("node");
+        filter.fields = tree_all_fields;
+        dump_node_filtered(gen, node->con, false, &filter, 0);
+        y(map_close);
+    }
+    y(array_close);
+
+    ystr("removed");
+    y(array_open);
+    for (size_t i = num_updated; i < tree_num_touched; i++) {
+        y(integer, (uintptr_t)tree_touched[i]->con);
+    }
+    y(array_close);
+
+    ystr("moved");
+    y(array_open);
+    for (size_t i = 0; i < num_updated; i++) {
+        struct tree_snapshot_node *node = tree_touched[i];
+        if (node->changed == UINT32_MAX || !node->moved)
+            continue;
+        y(map_open);
+        ystr("id");
+        y(integer, (uintptr_t)node->con);
+        dump_tree_position(gen, node);
+        y(map_close);
+    }
+    y(array_close);
+
+    ystr("changed");
+    y(array_open);
+    for (size_t i = 0; i < num_updated; i++) {
+        struct tree_snapshot_node *node = tree_touched[i];
+        if (node->changed == UINT32_MAX || node->changed == 0)
+            continue;
+        hashmap_clear(tree_changed_fields);
+        for (size_t field = 0; field < TREE_NUM_FIELDS; field++) {
+            if (node->changed & (1U << field))
+                hashmap_set(tree_changed_fields, tree_fields[field], strlen(tree_fields[field]), (void *)1);
+        }
+        filter.fields = tree_changed_fields;
+        dump_node_filtered(gen, node->con, false, &filter, 0);
+    }
+    y(array_close);
+
+    y(map_close);
+
+    for (size_t i = num_updated; i < tree_num_touched; i++) {
+        struct tree_snapshot_node *node = tree_touched[i];
+        hashmap_remove(tree_snapshot, &(node->con), sizeof(Con *));
+        tree_snapshot_node_free(node);
+    }
+    tree_num_touched = 0;
+
+    ipc_send_event_gen(I3_IPC_EVENT_TREE, gen, NULL);
+
+    ipc_gen_put(gen);
     setlocale(LC_NUMERIC, "");
 }
 
@@ -7,8 +7,80 @@
  * key_press.c: key press handler
  *
  */
+#define LOG_CATEGORY LOG_CATEGORY_BINDINGS
 #include "all.h"
 
+/* Whether key presses are currently being coalesced (see
+ * key_press_coalesce_begin()). */
+static bool coalescing = false;
+
+/* The repeatable binding whose presses are being coalesced, how often it was
+ * pressed and the trace of its first press. */
+static Binding *pending_binding = NULL;
+static int pending_repeat = 0;
+static struct binding_trace pending_trace;
+
+/* The bindings which ran since the last xcb_flush(). Their binding events are
+ * sent by key_press_trace_flushed(). */
+static struct binding_trace *traces = NULL;
+static size_t num_traces = 0;
+static size_t traces_size = 0;
+
+/*
+ * Runs the given binding and keeps its trace until the result was flushed.
+ *
+ */
+static void run_traced(Binding *bind, int repeat, struct binding_trace *trace) {
+    CommandResult *result = run_binding_traced(bind, repeat, trace);
+    command_result_free(result);
+
+    if (num_traces == traces_size) {
+        traces_size = (traces_size == 0 ? 8 : traces_size * 2);
+        traces = srealloc(traces, traces_size * sizeof(struct binding_trace));
+    }
+    traces[num_traces++] = *trace;
+}
+
+/*
+ * Runs the pending coalesced binding, if any.
+ *
+ */
+static void run_pending_binding(void) {
+    if (pending_binding == NULL)
+        return;
+
+    Binding *bind = pending_binding;
+    const int repeat = pending_repeat;
+    pending_binding = NULL;
+    pending_repeat = 0;
+
+    run_traced(bind, repeat, &pending_trace);
+}
+
+/*
+ * Starts coalescing key presses: until key_press_coalesce_end() is called,
+ * consecutive presses of the same resize or move binding (e.g. by key
+ * autorepeat) are accumulated and run as one command.
+ *
+ * Called before handling a KeyPress or KeyRelease event of a batch, see
+ * xcb_prepare_cb().
+ *
+ */
+void key_press_coalesce_begin(void) {
+    coalescing = true;
+}
+
+/*
+ * Runs the coalesced binding (if any) and stops coalescing. Called before
+ * handling any other event and before rendering, so that the order of
+ * commands and other events is preserved.
+ *
+ */
+void key_press_coalesce_end(void) {
+    coalescing = false;
+    run_pending_binding();
+}
+
 /*
  * There was a KeyPress or KeyRelease (both events have the same fields). We
  * compare this key code with our bindings table and pass the bound action to
@@ -16,9 +88,14 @@
  *
  */
 void handle_key_press(xcb_key_press_event_t *event) {
+    struct binding_trace trace = {
+        .event_time = event->time,
+        .start_ns = stats_now_ns(),
+    };
     const bool key_release = (event->response_type == XCB_KEY_RELEASE);
 
     last_timestamp = event->time;
+    x_set_pointer_position(event->root_x, event->root_y, event->time);
 
     DLOG("%s %d, state raw = 0x%x\n", (key_release ? "KeyRelease" : "KeyPress"), event->detail, event->state);
 
@@ -27,7 +104,67 @@ void handle_key_press(xcb_key_press_event_t *event) {
     /* if we couldn't find a binding, we are done */
     if (bind == NULL)
         return;
+    trace.lookup_done_ns = stats_now_ns();
 
-    CommandResult *result = run_binding(bind, NULL);
-    command_result_free(result);
+    if (!key_release && bind == pending_binding) {
+        pending_repeat++;
+        return;
+    }
+
+    /* Any other binding runs after the pending one. */
+    run_pending_binding();
+
+    if (coalescing && !key_release && binding_is_repeatable(bind)) {
+        pending_binding = bind;
+        pending_repeat = 1;
+        pending_trace = trace;
+        return;
+    }
+
+    run_traced(bind, 1, &trace);
+}
+
+/*
+ * Marks the bindings which ran so far as rendered. Called after each
+ * tree_render_flush() in xcb_prepare_cb().
+ *
+ */
+void key_press_trace_rendered(void) {
+    const uint64_t now_ns = stats_now_ns();
+    for (size_t i = 0; i < num_traces; i++) {
+        if (traces[i].render_done_ns == 0)
+            traces[i].render_done_ns = now_ns;
+    }
+}
+
+/*
+ * Records the latency of the bindings which ran since the last call and sends
+ * their binding events. Called right after xcb_flush() in xcb_prepare_cb().
+ *
+ */
+void key_press_trace_flushed(void) {
+    if (num_traces == 0)
+        return;
+
+    const uint64_t now_ns = stats_now_ns();
+    for (size_t i = 0; i < num_traces; i++) {
+        struct binding_trace *trace = &traces[i];
+        if (trace->render_done_ns == 0)
+            trace->render_done_ns = now_ns;
+
+        uint64_t latency_ns[STATS_NUM_BINDING_PHASES];
+        latency_ns[STATS_BINDING_LOOKUP] = trace->lookup_done_ns - trace->start_ns;
+        latency_ns[STATS_BINDING_COMMAND] = trace->command_done_ns - trace->command_start_ns;
+        latency_ns[STATS_BINDING_RENDER] = trace->render_done_ns - trace->command_done_ns;
+        latency_ns[STATS_BINDING_FLUSH] = now_ns - trace->render_done_ns;
+        latency_ns[STATS_BINDING_TOTAL] = now_ns - trace->start_ns;
+        DLOG("Binding \"%s\" took %.3f ms (lookup %.3f ms, command %.3f ms, render %.3f ms, flush %.3f ms)\n",
+             trace->binding->command, latency_ns[STATS_BINDING_TOTAL] / 1e6,
+             latency_ns[STATS_BINDING_LOOKUP] / 1e6, latency_ns[STATS_BINDING_COMMAND] / 1e6,
+             latency_ns[STATS_BINDING_RENDER] / 1e6, latency_ns[STATS_BINDING_FLUSH] / 1e6);
+        stats_record_binding_latency(latency_ns);
+        ipc_send_binding_run_event(trace->binding, trace->event_time, latency_ns);
+        binding_free(trace->binding);
+    }
+    num_traces = 0;
 }
@@ -19,6 +19,13 @@
 
 static char *last_key;
 static int incomplete;
+/* The container to which tree_append_json() appends. */
+static Con *append_parent;
+/* The top-level containers which were completely parsed and attached, so that
+ * they can be removed again if a later part of the JSON is invalid. */
+static Con **appended;
+static int num_appended;
+static int appended_size;
 static Con *json_node;
 static Con *to_focus;
 static bool parsing_swallows;
@@ -88,6 +95,8 @@ static int json_start_map(void *ctx) {
 static int json_end_map(void *ctx) {
     LOG("end of map\n");
     if (!parsing_swallows && !parsing_rect && !parsing_deco_rect && !parsing_window_rect && !parsing_geometry) {
+        const bool toplevel = (json_node->parent == append_parent);
+
         /* Set a few default values to simplify manually crafted layout files. */
         if (json_node->layout == L_DEFAULT) {
             DLOG("Setting layout = L_SPLITH\n");
@@ -98,12 +107,7 @@ static int json_end_map(void *ctx) {
          * container. */
         if (con_is_split(json_node) > 0 && !TAILQ_EMPTY(&(json_node->swallow_head))) {
             DLOG("sanity check: removing swallows specification from split container\n");
-            while (!TAILQ_EMPTY(&(json_node->swallow_head))) {
-                Match *match = TAILQ_FIRST(&(json_node->swallow_head));
-                TAILQ_REMOVE(&(json_node->swallow_head), match, matches);
-                match_free(match);
-                free(match);
-            }
+            con_clear_swallows(json_node);
         }
 
         if (json_node->type == CT_WORKSPACE) {
@@ -126,6 +130,17 @@ static int json_end_map(void *ctx) {
 
             /* Set num accordingly so that i3bar will properly sort it. */
             json_node->num = ws_name_to_number(json_node->name);
+
+            /* Only now that the whole container was parsed do we know that a
+             * top-level container is a workspace, which needs to be appended
+             * next to the other workspaces of the output instead. */
+            if (toplevel && (append_parent->type == CT_CON || append_parent->type == CT_WORKSPACE)) {
+                Con *content = output_get_content(con_get_output(append_parent));
+                if (content != append_parent) {
+                    DLOG("Appending workspace to content = %p instead of %p\n", content, append_parent);
+                    json_node->parent = content;
+                }
+            }
         }
 
         // When appending JSON layout files that only contain the workspace
@@ -171,7 +186,16 @@ static int json_end_map(void *ctx) {
         con_attach(json_node, json_node->parent, true);
         LOG("Creating window\n");
         x_con_init(json_node);
-        json_node = json_node->parent;
+        if (toplevel) {
+            if (num_appended == appended_size) {
+                appended_size = (appended_size == 0 ? 4 : appended_size * 2);
+                appended = srealloc(appended, appended_size * sizeof(Con *));
+            }
+            appended[num_appended++] = json_node;
+            json_node = append_parent;
+        } else {
+            json_node = json_node->parent;
+        }
         incomplete--;
         DLOG("incomplete = %d\n", incomplete);
     }
@@ -183,6 +207,11 @@ static int json_end_map(void *ctx) {
         return 0;
     }
 
+    if (parsing_swallows) {
+        /* The criteria are complete now, see json_start_map(). */
+        con_swallow_index_add(json_node, current_swallow);
+    }
+
     parsing_rect = false;
     parsing_deco_rect = false;
     parsing_window_rect = false;
@@ -292,11 +321,13 @@ static int json_string(void *ctx, const unsigned char *val, size_t len) {
             json_node->name = scalloc(len + 1, 1);
             memcpy(json_node->name, val, len);
         } else if (strcasecmp(last_key, "title_format") == 0) {
-            json_node->title_format = scalloc(len + 1, 1);
-            memcpy(json_node->title_format, val, len);
+            char *format = sstrndup((const char *)val, len);
+            con_set_title_format(json_node, format);
+            free(format);
         } else if (strcasecmp(last_key, "sticky_group") == 0) {
-            json_node->sticky_group = scalloc(len + 1, 1);
-            memcpy(json_node->sticky_group, val, len);
+            char *sticky_group = sstrndup((const char *)val, len);
+            con_set_sticky_group(json_node, sticky_group);
+            free(sticky_group);
             LOG("sticky_group of this container is %s\n", json_node->sticky_group);
         } else if (strcasecmp(last_key, "orientation") == 0) {
             /* Upgrade path from older versions of i3 (doing an inplace restart
@@ -414,11 +445,11 @@ static int json_string(void *ctx, const unsigned char *val, size_t len) {
             char *buf = NULL;
             sasprintf(&buf, "%.*s", (int)len, val);
             if (strcasecmp(buf, "none") == 0)
-                json_node->scratchpad_state = SCRATCHPAD_NONE;
+                con_set_scratchpad_state(json_node, SCRATCHPAD_NONE);
             else if (strcasecmp(buf, "fresh") == 0)
-                json_node->scratchpad_state = SCRATCHPAD_FRESH;
+                con_set_scratchpad_state(json_node, SCRATCHPAD_FRESH);
             else if (strcasecmp(buf, "changed") == 0)
-                json_node->scratchpad_state = SCRATCHPAD_CHANGED;
+                con_set_scratchpad_state(json_node, SCRATCHPAD_CHANGED);
             free(buf);
         } else if (strcasecmp(last_key, "previous_workspace_name") == 0) {
             FREE(previous_workspace_name);
@@ -501,7 +532,7 @@ static int json_bool(void *ctx, int val) {
     }
 
     if (strcasecmp(last_key, "sticky") == 0)
-        json_node->sticky = val;
+        con_set_sticky(json_node, val);
 
     if (parsing_swallows) {
         if (strcasecmp(last_key, "restart_mode") == 0) {
@@ -521,94 +552,46 @@ static int json_double(void *ctx, double val) {
     return 1;
 }
 
-static json_content_t content_result;
-static int content_level;
-
-static int json_determine_content_deeper(void *ctx) {
-    content_level++;
-    return 1;
-}
-
-static int json_determine_content_shallower(void *ctx) {
-    content_level--;
-    return 1;
-}
-
-static int json_determine_content_string(void *ctx, const unsigned char *val, size_t len) {
-    if (strcasecmp(last_key, "type") != 0 || content_level > 1)
-        return 1;
-
-    DLOG("string = %.*s, last_key = %s\n", (int)len, val, last_key);
-    if (strncasecmp((const char *)val, "workspace", len) == 0)
-        content_result = JSON_CONTENT_WORKSPACE;
-    return 0;
-}
-
 /*
- * Returns true if the provided JSON could be parsed by yajl.
+ * Closes the floating containers of all workspaces below con, which
+ * tree_close_internal() does not descend into.
  *
  */
-bool json_validate(const char *buf, const size_t len) {
-    bool valid = true;
-    yajl_handle hand = yajl_alloc(NULL, NULL, NULL);
-    /* Allowing comments allows for more user-friendly layout files. */
-    yajl_config(hand, yajl_allow_comments, true);
-    /* Allow multiple values, i.e. multiple nodes to attach */
-    yajl_config(hand, yajl_allow_multiple_values, true);
-
-    setlocale(LC_NUMERIC, "C");
-    if (yajl_parse(hand, (const unsigned char *)buf, len) != yajl_status_ok) {
-        unsigned char *str = yajl_get_error(hand, 1, (const unsigned char *)buf, len);
-        ELOG("JSON parsing error: %s\n", str);
-        yajl_free_error(hand, str);
-        valid = false;
+static void close_floating_children(Con *con) {
+    Con *child;
+    TAILQ_FOREACH(child, &(con->nodes_head), nodes) {
+        close_floating_children(child);
     }
-    setlocale(LC_NUMERIC, "");
-
-    yajl_complete_parse(hand);
-    yajl_free(hand);
-
-    return valid;
+    while (!TAILQ_EMPTY(&(con->floating_head)))
+        tree_close_internal(TAILQ_FIRST(&(con->floating_head)), DONT_KILL_WINDOW, true);
 }
 
-/* Parses the given JSON file until it encounters the first “type” property to
- * determine whether the file contains workspaces or regular containers, which
- * is important to know when deciding where (and how) to append the contents.
- * */
-json_content_t json_determine_content(const char *buf, const size_t len) {
-    // We default to JSON_CONTENT_CON because it is legal to not include
-    // “"type": "con"” in the JSON files for better readability.
-    content_result = JSON_CONTENT_CON;
-    content_level = 0;
-    static yajl_callbacks callbacks = {
-        .yajl_string = json_determine_content_string,
-        .yajl_map_key = json_key,
-        .yajl_start_array = json_determine_content_deeper,
-        .yajl_start_map = json_determine_content_deeper,
-        .yajl_end_map = json_determine_content_shallower,
-        .yajl_end_array = json_determine_content_shallower,
-    };
-    yajl_handle hand = yajl_alloc(&callbacks, NULL, NULL);
-    /* Allowing comments allows for more user-friendly layout files. */
-    yajl_config(hand, yajl_allow_comments, true);
-    /* Allow multiple values, i.e. multiple nodes to attach */
-    yajl_config(hand, yajl_allow_multiple_values, true);
-    setlocale(LC_NUMERIC, "C");
-    const yajl_status stat = yajl_parse(hand, (const unsigned char *)buf, len);
-    if (stat != yajl_status_ok && stat != yajl_status_client_canceled) {
-        unsigned char *str = yajl_get_error(hand, 1, (const unsigned char *)buf, len);
-        ELOG("JSON parsing error: %s\n", str);
-        yajl_free_error(hand, str);
-    }
-
-    setlocale(LC_NUMERIC, "");
-    yajl_complete_parse(hand);
-    yajl_free(hand);
-
-    return content_result;
+/*
+ * Removes a top-level container which was appended before parsing failed.
+ *
+ */
+static void remove_appended(Con *con) {
+    close_floating_children(con);
+    tree_close_internal(con, DONT_KILL_WINDOW, true);
 }
 
-void tree_append_json(Con *con, const char *buf, const size_t len, char **errormsg) {
+/*
+ * Parses the given JSON and appends the containers to con.
+ *
+ * Top-level workspaces are appended to the output which con is on (next to the
+ * other workspaces) instead, so that a layout file can be appended without
+ * knowing its contents upfront.
+ *
+ * The JSON is parsed only once: if it turns out to be invalid, all containers
+ * which were appended so far are removed again and an error message is stored
+ * in errormsg (if not NULL).
+ *
+ * Returns JSON_CONTENT_WORKSPACE if a workspace was appended,
+ * JSON_CONTENT_CON if only other containers were appended or
+ * JSON_CONTENT_UNKNOWN if parsing failed.
+ *
+ */
+json_content_t tree_append_json(Con *con, const char *buf, const size_t len, char **errormsg) {
     static yajl_callbacks callbacks = {
         .yajl_boolean = json_bool,
         .yajl_integer = json_int,
@@ -624,17 +607,19 @@ void tree_append_json(Con *con, const char *buf, const size_t len, char **errorm
     yajl_config(hand, yajl_allow_comments, true);
     /* Allow multiple values, i.e. multiple nodes to attach */
     yajl_config(hand, yajl_allow_multiple_values, true);
-    /* We don't need to validate that the input is valid UTF8 here.
-     * tree_append_json is called in two cases:
-     * 1. With the append_layout command. json_validate is called first and will
-     *    fail on invalid UTF8 characters so we don't need to recheck.
+    /* tree_append_json is called in two cases:
+     * 1. With the append_layout command (errormsg != NULL). User-provided
+     *    layout files are rejected if they contain invalid UTF8.
      * 2. With an in-place restart. The rest of the codebase should be
      *    responsible for producing valid UTF8 JSON output. If not,
      *    tree_append_json will just preserve invalid UTF8 strings in the tree
      *    instead of failing to parse the layout file which could lead to
-     *    problems like in #3156.
-     * Either way, disabling UTF8 validation slightly speeds up yajl. */
-    yajl_config(hand, yajl_dont_validate_strings, true);
+     *    problems like in #3156. Disabling UTF8 validation also slightly
+     *    speeds up yajl. */
+    if (errormsg == NULL)
+        yajl_config(hand, yajl_dont_validate_strings, true);
+    append_parent = con;
+    num_appended = 0;
     json_node = con;
     to_focus = NULL;
     incomplete = 0;
@@ -646,7 +631,10 @@ void tree_append_json(Con *con, const char *buf, const size_t len, char **errorm
     parsing_focus = false;
     parsing_marks = false;
     setlocale(LC_NUMERIC, "C");
-    const yajl_status stat = yajl_parse(hand, (const unsigned char *)buf, len);
+    yajl_status stat = yajl_parse(hand, (const unsigned char *)buf, len);
+    if (stat == yajl_status_ok)
+        stat = yajl_complete_parse(hand);
+    json_content_t content = JSON_CONTENT_CON;
     if (stat != yajl_status_ok) {
         unsigned char *str = yajl_get_error(hand, 1, (const unsigned char *)buf, len);
         ELOG("JSON parsing error: %s\n", str);
@@ -656,12 +644,21 @@ void tree_append_json(Con *con, const char *buf, const size_t len, char **errorm
         while (incomplete-- > 0) {
             Con *parent = json_node->parent;
             DLOG("freeing incomplete container %p\n", json_node);
-            if (json_node == to_focus) {
-                to_focus = NULL;
-            }
             con_free(json_node);
             json_node = parent;
         }
+        for (int i = num_appended - 1; i >= 0; i--) {
+            DLOG("removing appended container %p\n", appended[i]);
+            remove_appended(appended[i]);
+        }
+        num_appended = 0;
+        to_focus = NULL;
+        content = JSON_CONTENT_UNKNOWN;
+    }
+
+    for (int i = 0; i < num_appended; i++) {
+        if (appended[i]->type == CT_WORKSPACE)
+            content = JSON_CONTENT_WORKSPACE;
     }
 
     /* In case not all containers were restored, we need to fix the
@@ -670,10 +667,11 @@ void tree_append_json(Con *con, const char *buf, const size_t len, char **errorm
     con_fix_percent(con);
 
     setlocale(LC_NUMERIC, "");
-    yajl_complete_parse(hand);
     yajl_free(hand);
 
     if (to_focus) {
         con_activate(to_focus);
     }
+
+    return content;
 }
@@ -15,6 +15,8 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <sys/time.h>
+#include <stdint.h>
+#include <time.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/mman.h>
@@ -35,6 +37,8 @@
 #endif
 
 static bool debug_logging = false;
+/* Bitmask of the enabled log categories, see LOG_CATEGORY. */
+uint32_t log_categories = UINT32_MAX;
 static bool verbose = false;
 static FILE *errorfile;
 char *errorfilename;
@@ -56,8 +60,48 @@ static i3_shmlog_header *header;
 /* A pointer to the byte where we last wrapped. Necessary to not print the
  * left-overs at the end of the ringbuffer. */
 static char *loglastwrap;
+/* The oldest record of the previous pass through the ringbuffer which was not
+ * overwritten yet (loglastwrap if there is none). */
+static char *logoldest;
+/* The ringbuffer starts after the header and the format table. */
+static char *logstart;
+static char *logend;
 /* Size (in bytes) of the i3 SHM log. */
 static int logbuffer_size;
+
+/* Time (in milliseconds since the epoch) of the last record. Each record
+ * stores the time delta to its predecessor. */
+static uint64_t last_record_time;
+/* Time of the record before the first record of the current pass, and before
+ * logoldest. */
+static uint64_t pass_base_time;
+static uint64_t oldest_base_time;
+
+/* The table of format strings within the SHM log. format_offsets maps the
+ * address of a format string (they are all string literals) to its offset in
+ * the table, plus one. */
+static char *formats;
+static uint32_t formats_size;
+static uint32_t formats_used;
+static hashmap_t *format_offsets;
+
+#if !defined(__OpenBSD__)
+/* Followers (i3-dump-log -f) are woken up once per event loop iteration (see
+ * log_wake_followers()) or after this many bytes were logged, whichever comes
+ * first. */
+#define FOLLOWER_WAKEUP_BYTES (16 * 1024)
+/* Bytes logged since followers were last woken up. */
+static size_t unannounced_bytes;
+#endif
+
+/* If set, messages of the current thread are collected here instead of being
+ * logged (see log_defer()). Each message is stored as one byte for its kind,
+ * followed by the NUL-terminated text. */
+static __thread log_buffer_t *deferred_log;
+
+#define LOG_KIND_VERBOSE 'v'
+#define LOG_KIND_ERROR 'e'
+#define LOG_KIND_DEBUG 'd'
 /* File descriptor for shm_open. */
 static int logbuffer_shm;
 /* Size (in bytes) of physical memory */
@@ -72,6 +116,8 @@ static long long physical_mem_bytes;
 static void store_log_markers(void) {
     header->offset_next_write = (logwalk - logbuffer);
     header->offset_last_wrap = (loglastwrap - logbuffer);
+    header->offset_first_record = (logoldest - logbuffer);
+    header->first_record_base = oldest_base_time;
     header->size = logbuffer_size;
 }
 
@@ -172,8 +218,29 @@ void open_logbuffer(void) {
     pthread_cond_init(&(header->condvar), &cond_attr);
 #endif
 
-    logwalk = logbuffer + sizeof(i3_shmlog_header);
-    loglastwrap = logbuffer + logbuffer_size;
+    /* Format strings are much fewer than messages, so a small part of the
+     * buffer suffices to hold all of them. */
+    formats = logbuffer + sizeof(i3_shmlog_header);
+    formats_size = logbuffer_size / 16;
+    formats_used = 0;
+    header->offset_formats = formats - logbuffer;
+    header->formats_size = formats_size;
+    if (format_offsets == NULL)
+        format_offsets = hashmap_new();
+    else
+        hashmap_clear(format_offsets);
+
+    logstart = formats + formats_size;
+    logend = logbuffer + logbuffer_size;
+    logwalk = logstart;
+    loglastwrap = logend;
+#if !defined(__OpenBSD__)
+    unannounced_bytes = 0;
+#endif
+    logoldest = logend;
+    last_record_time = 0;
+    pass_base_time = 0;
+    oldest_base_time = 0;
     store_log_markers();
 }
 
@@ -207,6 +274,32 @@ bool get_debug_logging(void) {
     return debug_logging;
 }
 
+/*
+ * Returns the log category with the given name (like "render"), or 0 if there
+ * is no such category.
+ *
+ */
+log_category_t log_category_from_name(const char *name) {
+    static const struct {
+        const char *name;
+        log_category_t category;
+    } categories[] = {
+        {"general", LOG_CATEGORY_GENERAL},
+        {"x", LOG_CATEGORY_X},
+        {"render", LOG_CATEGORY_RENDER},
+        {"ipc", LOG_CATEGORY_IPC},
+        {"bindings", LOG_CATEGORY_BINDINGS},
+        {"match", LOG_CATEGORY_MATCH},
+        {"randr", LOG_CATEGORY_RANDR},
+        {"floating", LOG_CATEGORY_FLOATING},
+    };
+    for (size_t i = 0; i < sizeof(categories) / sizeof(categories[0]); i++) {
+        if (strcmp(categories[i].name, name) == 0)
+            return categories[i].category;
+    }
+    return 0;
+}
+
 /*
  * Set debug logging.
  *
@@ -215,6 +308,281 @@ void set_debug_logging(const bool _debug_logging) {
     debug_logging = _debug_logging;
 }
 
+/*
+ * Returns the time prefix of log messages ("%x %X - "), formatting it only
+ * when the second changed since the last call. localtime_r() and strftime()
+ * are surprisingly expensive compared to the rest of a log call.
+ *
+ */
+static const char *log_time_prefix(size_t *len) {
+    static char prefix[128];
+    static size_t prefix_len;
+    static time_t last_time = -1;
+
+    const time_t t = time(NULL);
+    if (t != last_time) {
+        struct tm result;
+        /* Convert time to local time (determined by the locale) */
+        struct tm *tmp = localtime_r(&t, &result);
+        prefix_len = strftime(prefix, sizeof(prefix), "%x %X - ", tmp);
+        last_time = t;
+    }
+
+    *len = prefix_len;
+    return prefix;
+}
+
+/*
+ * Returns the offset of the given format string in the format table of the SHM
+ * log, copying it there when it is used for the first time. Returns false if
+ * the table is full.
+ *
+ */
+static bool intern_format(const char *fmt, uint32_t *offset) {
+    void *value = hashmap_get(format_offsets, &fmt, sizeof(fmt));
+    if (value != NULL) {
+        *offset = (uintptr_t)value - 1;
+        return true;
+    }
+
+    const size_t len = strlen(fmt) + 1;
+    if (len > formats_size - formats_used)
+        return false;
+    memcpy(formats + formats_used, fmt, len);
+    *offset = formats_used;
+    formats_used += len;
+    hashmap_set(format_offsets, &fmt, sizeof(fmt), (void *)(uintptr_t)(*offset + 1));
+    return true;
+}
+
+/*
+ * Packs the arguments for fmt into out (see i3_shmlog_record). Returns false
+ * if the format contains conversions which cannot be packed or if the
+ * arguments do not fit into size bytes.
+ *
+ */
+static bool pack_args(uint8_t *out, size_t *pos, const size_t size, const char *fmt, va_list args) {
+    /* The largest fixed-size argument is a varint of 10 bytes. */
+#define ENSURE_SPACE(n)              \
+    do {                             \
+        if (*pos + (n) > size)       \
+            return false;            \
+    } while (0)
+
+    for (const char *walk = fmt; (walk = strchr(walk, '%')) != NULL;) {
+        printf_conversion_t conv;
+        if (!parse_printf_conversion(walk, &conv))
+            return false;
+        walk += conv.length;
+        if (conv.specifier == '%')
+            continue;
+
+        if (conv.width_arg) {
+            ENSURE_SPACE(10);
+            *pos += shmlog_put_varint(out + *pos, shmlog_zigzag(va_arg(args, int)));
+        }
+        int precision = conv.precision;
+        if (conv.precision_arg) {
+            precision = va_arg(args, int);
+            ENSURE_SPACE(10);
+            *pos += shmlog_put_varint(out + *pos, shmlog_zigzag(precision));
+        }
+
+        switch (conv.specifier) {
+            case 'd':
+            case 'i': {
+                intmax_t value;
+                switch (conv.modifier) {
+                    case PRINTF_LENGTH_L:
+                        value = va_arg(args, long);
+                        break;
+                    case PRINTF_LENGTH_LL:
+                        value = va_arg(args, long long);
+                        break;
+                    case PRINTF_LENGTH_J:
+                        value = va_arg(args, intmax_t);
+                        break;
+                    case PRINTF_LENGTH_Z:
+                        value = va_arg(args, ssize_t);
+                        break;
+                    case PRINTF_LENGTH_T:
+                        value = va_arg(args, ptrdiff_t);
+                        break;
+                    default:
+                        value = va_arg(args, int);
+                        break;
+                }
+                ENSURE_SPACE(10);
+                *pos += shmlog_put_varint(out + *pos, shmlog_zigzag(value));
+                break;
+            }
+            case 'o':
+            case 'u':
+            case 'x':
+            case 'X': {
+                uintmax_t value;
+                switch (conv.modifier) {
+                    case PRINTF_LENGTH_L:
+                        value = va_arg(args, unsigned long);
+                        break;
+                    case PRINTF_LENGTH_LL:
+                        value = va_arg(args, unsigned long long);
+                        break;
+                    case PRINTF_LENGTH_J:
+                        value = va_arg(args, uintmax_t);
+                        break;
+                    case PRINTF_LENGTH_Z:
+                        value = va_arg(args, size_t);
+                        break;
+                    case PRINTF_LENGTH_T:
+                        value = (uintmax_t)va_arg(args, ptrdiff_t);
+                        break;
+                    default:
+                        value = va_arg(args, unsigned int);
+                        break;
+                }
+                ENSURE_SPACE(10);
+                *pos += shmlog_put_varint(out + *pos, value);
+                break;
+            }
+            case 'c':
+                ENSURE_SPACE(10);
+                *pos += shmlog_put_varint(out + *pos, shmlog_zigzag(va_arg(args, int)));
+                break;
+            case 'p':
+                ENSURE_SPACE(10);
+                *pos += shmlog_put_varint(out + *pos, (uintptr_t)va_arg(args, void *));
+                break;
+            case 's': {
+                const char *str = va_arg(args, const char *);
+                if (str == NULL)
+                    str = "(null)";
+                const size_t len = (precision >= 0 ? strnlen(str, precision) : strlen(str));
+                ENSURE_SPACE(10 + len);
+                *pos += shmlog_put_varint(out + *pos, len);
+                memcpy(out + *pos, str, len);
+                *pos += len;
+                break;
+            }
+            default: {
+                /* Floating point conversions */
+                double value;
+                if (conv.modifier == PRINTF_LENGTH_LONG_DOUBLE)
+                    value = va_arg(args, long double);
+                else
+                    value = va_arg(args, double);
+                ENSURE_SPACE(sizeof(double));
+                memcpy(out + *pos, &value, sizeof(double));
+                *pos += sizeof(double);
+                break;
+            }
+        }
+    }
+#undef ENSURE_SPACE
+
+    return true;
+}
+
+/*
+ * Appends a record to the SHM log, wrapping to the beginning of the
+ * ringbuffer if it does not fit anymore.
+ *
+ */
+static void append_record(const uint8_t *record, const size_t size, const uint64_t previous_time) {
+    if (size > (size_t)(logend - logwalk)) {
+        loglastwrap = logwalk;
+        logwalk = logstart;
+        logoldest = logstart;
+        oldest_base_time = pass_base_time;
+        pass_base_time = previous_time;
+        header->wrap_count++;
+    }
+
+    /* Skip the records of the previous pass which we are about to
+     * overwrite, keeping track of the time they are relative to. */
+    while (logoldest < loglastwrap && logoldest < logwalk + size) {
+        i3_shmlog_record old;
+        memcpy(&old, logoldest, sizeof(old));
+        uint64_t delta;
+        if (old.size == 0 ||
+            shmlog_get_varint((uint8_t *)logoldest + sizeof(old), old.size - sizeof(old), &delta) == 0) {
+            logoldest = loglastwrap;
+            break;
+        }
+        oldest_base_time += shmlog_unzigzag(delta);
+        logoldest += old.size;
+    }
+    if (logoldest >= loglastwrap)
+        logoldest = loglastwrap;
+
+    memcpy(logwalk, record, size);
+    logwalk += size;
+    store_log_markers();
+
+#if !defined(__OpenBSD__)
+    unannounced_bytes += size;
+    if (unannounced_bytes >= FOLLOWER_WAKEUP_BYTES)
+        log_wake_followers();
+#endif
+}
+
+/*
+ * Stores the message in the SHM log. Instead of the formatted text, only the
+ * position of the format string in the format table and the packed arguments
+ * are stored when possible, which is considerably more compact.
+ *
+ */
+static void shmlog_message(const char kind, const char *fmt, va_list args) {
+    /* Precisely one page to not consume too much memory but to hold enough
+     * data to be useful. */
+    static uint8_t record[4096];
+    const size_t max_record = sizeof(record);
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    const uint64_t now = (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+    const uint64_t previous_time = last_record_time;
+    last_record_time = now;
+
+    size_t pos = sizeof(i3_shmlog_record);
+    pos += shmlog_put_varint(record + pos, shmlog_zigzag((int64_t)(now - previous_time)));
+    const size_t payload_start = pos;
+
+    i3_shmlog_record rec = {.type = SHMLOG_RECORD_FORMAT, .level = kind};
+    uint32_t offset;
+    va_list copy;
+    va_copy(copy, args);
+    bool packed = intern_format(fmt, &offset);
+    if (packed) {
+        pos += shmlog_put_varint(record + pos, offset);
+        packed = pack_args(record, &pos, max_record, fmt, copy);
+    }
+    va_end(copy);
+
+    if (!packed) {
+        rec.type = SHMLOG_RECORD_TEXT;
+        pos = payload_start;
+        size_t len = vsnprintf((char *)record + pos, max_record - pos, fmt, args);
+        if (len >= max_record - pos) {
+            fprintf(stderr, "BUG: single log message > 4k\n");
+
+            /* vsnprintf returns the number of bytes that *would have been written*,
+             * not the actual amount written. Thus, limit len to the space we
+             * have to avoid memory corruption and outputting garbage later. */
+            len = max_record - pos - 1;
+
+            /* Punch in a newline so the next log message is not dangling at
+             * the end of the truncated message. */
+            record[pos + len - 1] = '\n';
+        }
+        pos += len;
+    }
+
+    rec.size = pos;
+    memcpy(record, &rec, sizeof(rec));
+    append_record(record, pos, previous_time);
+}
+
 /*
  * Logs the given message to stdout (if print is true) while prefixing the
  * current time to it. Additionally, the message will be saved in the i3 SHM
@@ -222,27 +590,15 @@ void set_debug_logging(const bool _debug_logging) {
  * This is to be called by *LOG() which includes filename/linenumber/function.
  *
  */
-static void vlog(const bool print, const char *fmt, va_list args) {
-    /* Precisely one page to not consume too much memory but to hold enough
-     * data to be useful. */
-    static char message[4096];
-    static struct tm result;
-    static time_t t;
-    static struct tm *tmp;
-    static size_t len;
-
-    /* Get current time */
-    t = time(NULL);
-    /* Convert time to local time (determined by the locale) */
-    tmp = localtime_r(&t, &result);
-    /* Generate time prefix */
-    len = strftime(message, sizeof(message), "%x %X - ", tmp);
+static void vlog(const bool print, const char kind, const char *fmt, va_list args) {
+    size_t len;
+    const char *prefix = log_time_prefix(&len);
 
     /*
      * logbuffer  print
      * ----------------
-     *  true      true   format message, save, print
-     *  true      false  format message, save
+     *  true      true   save, print message
+     *  true      false  save
      *  false     true   print message only
      *  false     false  INVALID, never called
      */
@@ -250,50 +606,123 @@ static void vlog(const bool print, const char *fmt, va_list args) {
 #ifdef DEBUG_TIMING
         struct timeval tv;
         gettimeofday(&tv, NULL);
-        printf("%s%d.%d - ", message, tv.tv_sec, tv.tv_usec);
+        printf("%s%d.%d - ", prefix, tv.tv_sec, tv.tv_usec);
 #else
-        printf("%s", message);
+        fwrite(prefix, len, 1, stdout);
 #endif
         vprintf(fmt, args);
     } else {
-        len += vsnprintf(message + len, sizeof(message) - len, fmt, args);
-        if (len >= sizeof(message)) {
-            fprintf(stderr, "BUG: single log message > 4k\n");
-
-            /* vsnprintf returns the number of bytes that *would have been written*,
-             * not the actual amount written. Thus, limit len to sizeof(message) to avoid
-             * memory corruption and outputting garbage later.  */
-            len = sizeof(message);
-
-            /* Punch in a newline so the next log message is not dangling at
-             * the end of the truncated message. */
-            message[len - 2] = '\n';
+        if (print) {
+            va_list copy;
+            va_copy(copy, args);
+            fwrite(prefix, len, 1, stdout);
+            vprintf(fmt, copy);
+            va_end(copy);
         }
 
-        /* If there is no space for the current message in the ringbuffer, we
-         * need to wrap and write to the beginning again. */
-        if (len >= (size_t)(logbuffer_size - (logwalk - logbuffer))) {
-            loglastwrap = logwalk;
-            logwalk = logbuffer + sizeof(i3_shmlog_header);
-            store_log_markers();
-            header->wrap_count++;
-        }
+        shmlog_message(kind, fmt, args);
+    }
+}
 
-        /* Copy the buffer, move the write pointer to the byte after our
-         * current message. */
-        strncpy(logwalk, message, len);
-        logwalk += len;
+/*
+ * Copies the given memory usage snapshot into the SHM log header (if SHM
+ * logging is enabled), see i3-dump-log -m.
+ *
+ */
+void log_publish_memory(const struct i3_shmlog_memory *memory) {
+    if (logbuffer == NULL)
+        return;
+    header->memory = *memory;
+}
 
-        store_log_markers();
+/*
+ * Returns the size of the SHM log in bytes, 0 if SHM logging is disabled.
+ *
+ */
+size_t log_shmlog_bytes(void) {
+    return (logbuffer == NULL ? 0 : (size_t)logbuffer_size);
+}
 
+/*
+ * Wakes up the processes (i3-dump-log -f) following the SHM log, if any new
+ * messages were logged since the last call. Called once per event loop
+ * iteration, so that a burst of messages results in a single wakeup.
+ *
+ */
+void log_wake_followers(void) {
 #if !defined(__OpenBSD__)
-        /* Wake up all (i3-dump-log) processes waiting for condvar. */
-        pthread_cond_broadcast(&(header->condvar));
+    if (!logbuffer || unannounced_bytes == 0)
+        return;
+    unannounced_bytes = 0;
+    if (__atomic_load_n(&(header->followers), __ATOMIC_ACQUIRE) == 0)
+        return;
+    /* Wake up all (i3-dump-log) processes waiting for condvar. */
+    pthread_cond_broadcast(&(header->condvar));
 #endif
+}
+
+static void defer_message(char kind, const char *fmt, va_list args) {
+    va_list copy;
+    va_copy(copy, args);
+    const int len = vsnprintf(NULL, 0, fmt, copy);
+    va_end(copy);
+    if (len < 0)
+        return;
+
+    log_buffer_t *buffer = deferred_log;
+    const size_t needed = buffer->len + 1 + len + 1;
+    if (needed > buffer->size) {
+        buffer->size = (buffer->size == 0 ? 4096 : buffer->size);
+        while (needed > buffer->size)
+            buffer->size *= 2;
+        buffer->data = srealloc(buffer->data, buffer->size);
+    }
+    buffer->data[buffer->len++] = kind;
+    vsnprintf(buffer->data + buffer->len, len + 1, fmt, args);
+    buffer->len += len + 1;
+}
+
+static void log_string(const bool print, const char kind, const char *fmt, ...) {
+    va_list args;
+
+    va_start(args, fmt);
+    vlog(print, kind, fmt, args);
+    va_end(args);
+}
+
+/*
+ * Makes the current thread collect its messages in buffer instead of logging
+ * them, until log_defer(NULL) is called. This allows other threads to log
+ * without racing with the main thread, which logs the messages later using
+ * log_replay().
+ *
+ */
+void log_defer(log_buffer_t *buffer) {
+    deferred_log = buffer;
+}
 
-        if (print)
-            fwrite(message, len, 1, stdout);
+/*
+ * Logs the messages collected in buffer (see log_defer()) and empties it.
+ *
+ */
+void log_replay(log_buffer_t *buffer) {
+    size_t pos = 0;
+    while (pos < buffer->len) {
+        const char kind = buffer->data[pos++];
+        const char *message = buffer->data + pos;
+        pos += strlen(message) + 1;
+
+        if (kind == LOG_KIND_ERROR) {
+            log_string(true, kind, "%s", message);
+            fputs(message, errorfile);
+            fflush(errorfile);
+        } else if (kind == LOG_KIND_VERBOSE && (logbuffer || verbose)) {
+            log_string(verbose, kind, "%s", message);
+        } else if (kind == LOG_KIND_DEBUG && (logbuffer || debug_logging)) {
+            log_string(debug_logging, kind, "%s", message);
+        }
     }
+    buffer->len = 0;
 }
 
 /*
@@ -308,7 +737,12 @@ void verboselog(char *fmt, ...) {
         return;
 
     va_start(args, fmt);
-    vlog(verbose, fmt, args);
+    if (deferred_log != NULL) {
+        defer_message(LOG_KIND_VERBOSE, fmt, args);
+        va_end(args);
+        return;
+    }
+    vlog(verbose, LOG_KIND_VERBOSE, fmt, args);
     va_end(args);
 }
 
@@ -320,7 +754,12 @@ void errorlog(char *fmt, ...) {
     va_list args;
 
     va_start(args, fmt);
-    vlog(true, fmt, args);
+    if (deferred_log != NULL) {
+        defer_message(LOG_KIND_ERROR, fmt, args);
+        va_end(args);
+        return;
+    }
+    vlog(true, LOG_KIND_ERROR, fmt, args);
     va_end(args);
 
     /* also log to the error logfile, if opened */
@@ -343,7 +782,12 @@ void debuglog(char *fmt, ...) {
         return;
 
     va_start(args, fmt);
-    vlog(debug_logging, fmt, args);
+    if (deferred_log != NULL) {
+        defer_message(LOG_KIND_DEBUG, fmt, args);
+        va_end(args);
+        return;
+    }
+    vlog(debug_logging, LOG_KIND_DEBUG, fmt, args);
     va_end(args);
 }
 
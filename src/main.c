@@ -35,9 +35,8 @@ struct rlimit original_rlimit_core;
 /* The number of file descriptors passed via socket activation. */
 int listen_fds;
 
-/* We keep the xcb_prepare watcher around to be able to enable and disable it
- * temporarily for drag_pointer(). */
 static struct ev_prepare *xcb_prepare;
+static struct ev_check *frame_check;
 
 char **start_argv;
 
@@ -90,6 +89,7 @@ struct ws_assignments_head ws_assignments = TAILQ_HEAD_INITIALIZER(ws_assignment
 bool xcursor_supported = true;
 bool xkb_supported = true;
 bool shape_supported = true;
+bool sync_supported = true;
 
 bool force_xinerama = false;
 
@@ -102,6 +102,117 @@ static void xcb_got_event(EV_P_ struct ev_io *w, int revents) {
     /* empty, because xcb_prepare_cb are used */
 }
 
+/*
+ * Called right after the event loop woke up, before any other watcher. Starts
+ * measuring the event loop iteration, which ends in xcb_prepare_cb().
+ *
+ */
+static void frame_check_cb(EV_P_ ev_check *w, int revents) {
+    stats_frame_begin();
+}
+
+/* The maximum number of events which are read from the queue (and coalesced,
+ * see coalesce_events()) before being dispatched. */
+#define EVENT_BATCH_SIZE 256
+
+/* Identifies events which supersede each other. */
+struct coalesce_key {
+    uint8_t type;
+    xcb_window_t window;
+    xcb_atom_t atom;
+};
+
+/*
+ * Fills in the key for the given event and returns the corresponding
+ * stats_coalesced_t, or -1 if events of this type must not be coalesced.
+ *
+ */
+static int coalesce_key_for(xcb_generic_event_t *event, struct coalesce_key *key) {
+    memset(key, '\0', sizeof(struct coalesce_key));
+    key->type = (event->response_type & 0x7F);
+
+    switch (key->type) {
+        case XCB_CONFIGURE_REQUEST:
+            key->window = ((xcb_configure_request_event_t *)event)->window;
+            return STATS_COALESCED_CONFIGURE_REQUEST;
+        case XCB_PROPERTY_NOTIFY:
+            key->window = ((xcb_property_notify_event_t *)event)->window;
+            key->atom = ((xcb_property_notify_event_t *)event)->atom;
+            return STATS_COALESCED_PROPERTY_NOTIFY;
+        case XCB_MOTION_NOTIFY:
+            key->window = ((xcb_motion_notify_event_t *)event)->event;
+            return STATS_COALESCED_MOTION_NOTIFY;
+        default:
+            return -1;
+    }
+}
+
+/*
+ * Copies the values the earlier ConfigureRequest sets into the later one,
+ * unless the later one sets them itself.
+ *
+ */
+static void merge_configure_requests(xcb_configure_request_event_t *earlier,
+                                     xcb_configure_request_event_t *later) {
+#define MERGE_FIELD(mask, field)              \
+    do {                                      \
+        if ((earlier->value_mask & (mask)) && \
+            !(later->value_mask & (mask))) {  \
+            later->field = earlier->field;    \
+            later->value_mask |= (mask);      \
+        }                                     \
+    } while (0)
+
+    MERGE_FIELD(XCB_CONFIG_WINDOW_X, x);
+    MERGE_FIELD(XCB_CONFIG_WINDOW_Y, y);
+    MERGE_FIELD(XCB_CONFIG_WINDOW_WIDTH, width);
+    MERGE_FIELD(XCB_CONFIG_WINDOW_HEIGHT, height);
+    MERGE_FIELD(XCB_CONFIG_WINDOW_BORDER_WIDTH, border_width);
+    MERGE_FIELD(XCB_CONFIG_WINDOW_SIBLING, sibling);
+    MERGE_FIELD(XCB_CONFIG_WINDOW_STACK_MODE, stack_mode);
+
+#undef MERGE_FIELD
+}
+
+/*
+ * Collapses redundant events of a batch: ConfigureRequests for the same
+ * window, PropertyNotify events for the same window and atom, and
+ * MotionNotify events for the same window. Of consecutive such events, only
+ * the last one is kept (ConfigureRequests are merged into it), the others are
+ * freed and set to NULL. Any other event in between, including one which would
+ * be coalesced with a different window or atom, ends the run, so that the
+ * kept events are handled in their original order.
+ *
+ */
+static void coalesce_events(xcb_generic_event_t **events, int num_events) {
+    /* We walk backwards, so next is the index of the closest following event
+     * which is kept, and next_type and next_key describe it. */
+    int next = num_events;
+    int next_type = -1;
+    struct coalesce_key next_key;
+    memset(&next_key, '\0', sizeof(struct coalesce_key));
+
+    for (int i = num_events - 1; i >= 0; i--) {
+        struct coalesce_key key;
+        const int type = (events[i]->response_type == 0 ? -1 : coalesce_key_for(events[i], &key));
+        if (type == -1 || type != next_type ||
+            key.window != next_key.window || key.atom != next_key.atom) {
+            next = i;
+            next_type = type;
+            if (type != -1)
+                next_key = key;
+            continue;
+        }
+
+        if (type == STATS_COALESCED_CONFIGURE_REQUEST) {
+            merge_configure_requests((xcb_configure_request_event_t *)events[i],
+                                     (xcb_configure_request_event_t *)events[next]);
+        }
+        stats_count_coalesced(type);
+        FREE(events[i]);
+    }
+}
+
 /*
  * Called just before the event loop sleeps. Ensures xcb’s incoming and outgoing
  * queues are empty so that any activity will trigger another event loop
@@ -110,50 +221,142 @@ static void xcb_got_event(EV_P_ struct ev_io *w, int revents) {
  */
 static void xcb_prepare_cb(EV_P_ ev_prepare *w, int revents) {
     /* Process all queued (and possibly new) events before the event loop
-       sleeps. */
-    xcb_generic_event_t *event;
-
-    while ((event = xcb_poll_for_event(conn)) != NULL) {
-        if (event->response_type == 0) {
-            if (event_is_ignored(event->sequence, 0))
-                DLOG("Expected X11 Error received for sequence %x\n", event->sequence);
-            else {
-                xcb_generic_error_t *error = (xcb_generic_error_t *)event;
-                DLOG("X11 Error received (probably harmless)! sequence 0x%x, error_code = %d\n",
-                     error->sequence, error->error_code);
-            }
-            free(event);
-            continue;
+       sleeps. Events are read in batches so that redundant ones can be
+       coalesced (see coalesce_events()). */
+    xcb_generic_event_t *events[EVENT_BATCH_SIZE];
+    int num_events;
+    /* Events whose changes are only displayed by the next render. Their
+     * latency (see event_stats_name()) is recorded once that is done. */
+    struct {
+        struct stats_histogram *histogram;
+        uint64_t elapsed_ns;
+    } pending[EVENT_BATCH_SIZE];
+    int num_pending = 0;
+
+    /* IPC events caused by this batch are written after the render, with
+     * superseded ones dropped (see ipc_queue_message()). */
+    ipc_hold_messages();
+
+    do {
+        /* Windows which were managed by the previous batch are mapped by now.
+         * Handle the remaining properties which were requested for them, so
+         * that their changes are part of the following render. */
+        manage_handle_deferred();
+
+        /* Render once for everything the previous batch (or any other
+         * callback since the last iteration) changed. This happens before
+         * polling, so that events caused by rendering are handled right
+         * away. */
+        key_press_coalesce_end();
+        const uint64_t render_start = stats_now_ns();
+        tree_close_end();
+        /* With render_pacing refresh, the render might be postponed until the
+         * next refresh interval (a timer wakes us up in time). */
+        if (tree_render_flush_paced())
+            key_press_trace_rendered();
+        const uint64_t render_ns = stats_now_ns() - render_start;
+        for (int i = 0; i < num_pending; i++) {
+            stats_histogram_record(pending[i].histogram, pending[i].elapsed_ns + render_ns);
         }
+        num_pending = 0;
 
-        /* Strip off the highest bit (set if the event is generated) */
-        int type = (event->response_type & 0x7F);
+        num_events = 0;
+        while (num_events < EVENT_BATCH_SIZE &&
+               (events[num_events] = xcb_poll_for_event(conn)) != NULL) {
+            num_events++;
+        }
 
-        handle_event(type, event);
+        coalesce_events(events, num_events);
 
-        free(event);
-    }
+        /* Send the GetProperty requests for all PropertyNotify events of this
+         * batch before handling any of them, so that we wait for only one
+         * round trip instead of one per event. */
+        for (int i = 0; i < num_events; i++) {
+            if (events[i] != NULL && (events[i]->response_type & 0x7F) == XCB_PROPERTY_NOTIFY)
+                property_notify_prefetch((xcb_property_notify_event_t *)events[i]);
+        }
+
+        for (int i = 0; i < num_events; i++) {
+            xcb_generic_event_t *event = events[i];
+            if (event == NULL)
+                continue;
+
+            /* Requests older than this event which did not cause an error so
+             * far succeeded. */
+            retire_error_callbacks(event->full_sequence);
+
+            if (event->response_type == 0) {
+                if (event_is_ignored(event->sequence, 0))
+                    DLOG("Expected X11 Error received for sequence %x\n", event->sequence);
+                else if (handle_error_callback((xcb_generic_error_t *)event))
+                    DLOG("Handled X11 Error for sequence %x\n", event->sequence);
+                else {
+                    xcb_generic_error_t *error = (xcb_generic_error_t *)event;
+                    DLOG("X11 Error received (probably harmless)! sequence 0x%x, error_code = %d\n",
+                         error->sequence, error->error_code);
+                }
+                free(event);
+                continue;
+            }
+
+            /* Strip off the highest bit (set if the event is generated) */
+            int type = (event->response_type & 0x7F);
+
+            char name[64];
+            event_stats_name(type, event, name, sizeof(name));
+            struct stats_histogram *histogram = stats_histogram_for(name);
+            stats_frame_event(histogram);
+
+            /* Repeated presses of a resize or move binding within this
+             * batch are run as one command (see handle_key_press()). */
+            if (type == XCB_KEY_PRESS || type == XCB_KEY_RELEASE)
+                key_press_coalesce_begin();
+            else
+                key_press_coalesce_end();
+
+            /* Consecutive UnmapNotify and DestroyNotify events (e.g. after
+             * killing many windows) close their containers in one bulk close,
+             * which renders once. Other events see the cleaned up tree. */
+            if (type == XCB_UNMAP_NOTIFY || type == XCB_DESTROY_NOTIFY)
+                tree_close_begin();
+            else
+                tree_close_end();
+
+            const uint64_t stats_start = stats_begin(STATS_HANDLE_EVENT);
+            const uint64_t event_start = stats_now_ns();
+            I3_PROBE2(handle_event__entry, type, event->sequence);
+            event_trace_record_event(event);
+            handle_event(type, event);
+            const uint64_t elapsed_ns = stats_now_ns() - event_start;
+            I3_PROBE2(handle_event__return, type, elapsed_ns);
+            stats_end(STATS_HANDLE_EVENT, stats_start);
+
+            if (tree_render_is_scheduled()) {
+                pending[num_pending].histogram = histogram;
+                pending[num_pending].elapsed_ns = elapsed_ns;
+                num_pending++;
+            } else {
+                stats_histogram_record(histogram, elapsed_ns);
+            }
+
+            free(event);
+        }
+
+        property_notify_discard_prefetched();
+        if (num_events > 0)
+            event_trace_record_batch_end();
+    } while (num_events > 0 || manage_has_deferred());
 
     /* Flush all queued events to X11. */
     xcb_flush(conn);
-}
+    key_press_trace_flushed();
 
-/*
- * Enable or disable the main X11 event handling function.
- * This is used by drag_pointer() which has its own, modal event handler, which
- * takes precedence over the normal event handler.
- *
- */
-void main_set_x11_cb(bool enable) {
-    DLOG("Setting main X11 callback to enabled=%d\n", enable);
-    if (enable) {
-        ev_prepare_start(main_loop, xcb_prepare);
-        /* Trigger the watcher explicitly to handle all remaining X11 events.
-         * drag_pointer()’s event handler exits in the middle of the loop. */
-        ev_feed_event(main_loop, xcb_prepare, 0);
-    } else {
-        ev_prepare_stop(main_loop, xcb_prepare);
-    }
+    ipc_release_messages();
+    event_trace_flush();
+
+    log_wake_followers();
+    stats_sample_memory();
+    stats_frame_end();
 }
 
 /*
@@ -166,6 +369,7 @@ static void i3_exit(void) {
         fflush(stderr);
         shm_unlink(shmlogname);
     }
+    shmstate_close();
     ipc_shutdown(SHUTDOWN_REASON_EXIT, -1);
     unlink(config.ipc_socket_path);
     xcb_disconnect(conn);
@@ -192,6 +396,9 @@ static void handle_core_signal(int sig, siginfo_t *info, void *data) {
     if (*shmlogname != '\0') {
         shm_unlink(shmlogname);
     }
+    if (*shmstatename != '\0') {
+        shm_unlink(shmstatename);
+    }
     raise(sig);
 }
 
@@ -236,15 +443,15 @@ static void setup_term_handlers(void) {
     }
 }
 
-static int parse_restart_fd(void) {
-    const char *restart_fd = getenv("_I3_RESTART_FD");
+static int parse_restart_fd(const char *variable) {
+    const char *restart_fd = getenv(variable);
     if (restart_fd == NULL) {
         return -1;
     }
 
     long int fd = -1;
     if (!parse_long(restart_fd, &fd, 10)) {
-        ELOG("Malformed _I3_RESTART_FD \"%s\"\n", restart_fd);
+        ELOG("Malformed %s \"%s\"\n", variable, restart_fd);
         return -1;
     }
     return fd;
@@ -254,6 +461,7 @@ int main(int argc, char *argv[]) {
     /* Keep a symbol pointing to the I3_VERSION string constant so that we have
      * it in gdb backtraces. */
     static const char *_i3_version __attribute__((used)) = I3_VERSION;
+    stats_startup_init();
     char *override_configpath = NULL;
     bool autostart = true;
     char *layout_path = NULL;
@@ -262,6 +470,8 @@ int main(int argc, char *argv[]) {
     char *fake_outputs = NULL;
     bool disable_signalhandler = false;
     bool only_check_config = false;
+    char *record_trace_path = NULL;
+    char *replay_trace_path = NULL;
     static struct option long_options[] = {
         {"no-autostart", no_argument, 0, 'a'},
         {"config", required_argument, 0, 'c'},
@@ -279,6 +489,9 @@ int main(int argc, char *argv[]) {
         {"disable-signalhandler", no_argument, 0, 0},
         {"shmlog-size", required_argument, 0, 0},
         {"shmlog_size", required_argument, 0, 0},
+        {"config-cache", required_argument, 0, 0},
+        {"record-trace", required_argument, 0, 0},
+        {"replay-trace", required_argument, 0, 0},
         {"get-socketpath", no_argument, 0, 0},
         {"get_socketpath", no_argument, 0, 0},
         {"fake_outputs", required_argument, 0, 0},
@@ -380,6 +593,18 @@ int main(int argc, char *argv[]) {
                     init_logging();
                     LOG("Limiting SHM log size to %d bytes\n", shmlog_size);
                     break;
+                } else if (strcmp(long_options[option_index].name, "config-cache") == 0) {
+                    FREE(config_cache_path);
+                    config_cache_path = sstrdup(optarg);
+                    break;
+                } else if (strcmp(long_options[option_index].name, "record-trace") == 0) {
+                    FREE(record_trace_path);
+                    record_trace_path = sstrdup(optarg);
+                    break;
+                } else if (strcmp(long_options[option_index].name, "replay-trace") == 0) {
+                    FREE(replay_trace_path);
+                    replay_trace_path = sstrdup(optarg);
+                    break;
                 } else if (strcmp(long_options[option_index].name, "restart") == 0) {
                     FREE(layout_path);
                     layout_path = sstrdup(optarg);
@@ -421,6 +646,20 @@ int main(int argc, char *argv[]) {
                                 "\tThe default is %d bytes.\n",
                         shmlog_size);
                 fprintf(stderr, "\n");
+                fprintf(stderr, "\t--config-cache <file>\n"
+                                "\tCache the configuration file after variables were replaced\n"
+                                "\tin <file>, and reuse it while neither the file nor the X\n"
+                                "\tresources it uses change.\n");
+                fprintf(stderr, "\n");
+                fprintf(stderr, "\t--record-trace <file>\n"
+                                "\tRecord the X11 events and IPC commands which i3 handles in\n"
+                                "\t<file>, for replaying them with --replay-trace.\n");
+                fprintf(stderr, "\n");
+                fprintf(stderr, "\t--replay-trace <file>\n"
+                                "\tReplay the X11 events and IPC commands recorded in <file>,\n"
+                                "\tprint how long handling them took as JSON, then exit.\n"
+                                "\tUse a test X server (e.g. Xephyr) for this.\n");
+                fprintf(stderr, "\n");
                 fprintf(stderr, "If you pass plain text arguments, i3 will interpret them as a command\n"
                                 "to send to a currently running i3 (like i3-msg). This allows you to\n"
                                 "use nice and logical commands, such as:\n"
@@ -532,6 +771,7 @@ int main(int argc, char *argv[]) {
 
     LOG("i3 %s starting\n", i3_version);
 
+    stats_startup_begin(STATS_STARTUP_X_CONNECTION);
     conn = xcb_connect(NULL, &conn_screen);
     if (xcb_connection_has_error(conn))
         errx(EXIT_FAILURE, "Cannot open display");
@@ -547,8 +787,10 @@ int main(int argc, char *argv[]) {
 
     root_screen = xcb_aux_get_screen(conn, conn_screen);
     root = root_screen->root;
+    stats_startup_end(STATS_STARTUP_X_CONNECTION);
 
     /* Place requests for the atoms we need as soon as possible */
+    stats_startup_begin(STATS_STARTUP_ATOMS);
 #define xmacro(atom) \
     xcb_intern_atom_cookie_t atom##_cookie = xcb_intern_atom(conn, 0, strlen(#atom), #atom);
 #include "atoms.xmacro"
@@ -599,8 +841,11 @@ int main(int argc, char *argv[]) {
     } while (0);
 #include "atoms.xmacro"
 #undef xmacro
+    stats_startup_end(STATS_STARTUP_ATOMS);
 
+    stats_startup_begin(STATS_STARTUP_LOAD_CONFIGURATION);
     load_configuration(override_configpath, C_LOAD);
+    stats_startup_end(STATS_STARTUP_LOAD_CONFIGURATION);
 
     if (config.ipc_socket_path == NULL) {
         /* Fall back to a file name in /tmp/ based on the PID */
@@ -632,7 +877,9 @@ int main(int argc, char *argv[]) {
     }
     DLOG("root geometry reply: (%d, %d) %d x %d\n", greply->x, greply->y, greply->width, greply->height);
 
+    stats_startup_begin(STATS_STARTUP_XCURSOR);
     xcursor_load_cursors();
+    stats_startup_end(STATS_STARTUP_XCURSOR);
 
     /* Set a cursor for the root window (otherwise the root window will show no
        cursor until the first client is launched). */
@@ -723,26 +970,62 @@ int main(int argc, char *argv[]) {
         DLOG("shape 1.1 is not present on this server\n");
     }
 
+    /* Check for the Sync extension, which _NET_WM_SYNC_REQUEST needs. */
+    extreply = xcb_get_extension_data(conn, &xcb_sync_id);
+    if (extreply->present) {
+        sync_base = extreply->first_event;
+        xcb_sync_initialize_cookie_t cookie =
+            xcb_sync_initialize(conn, XCB_SYNC_MAJOR_VERSION, XCB_SYNC_MINOR_VERSION);
+        xcb_sync_initialize_reply_t *version =
+            xcb_sync_initialize_reply(conn, cookie, NULL);
+        sync_supported = (version != NULL);
+        free(version);
+    } else {
+        sync_supported = false;
+    }
+    if (!sync_supported) {
+        DLOG("sync is not present on this server\n");
+    }
+
     restore_connect();
 
     property_handlers_init();
 
     ewmh_setup_hints();
 
+    stats_startup_begin(STATS_STARTUP_KEYBOARD);
     keysyms = xcb_key_symbols_alloc(conn);
 
     xcb_numlock_mask = aio_get_mod_mask_for(XCB_NUM_LOCK, keysyms);
 
-    if (!load_keymap())
+    if (!load_keymap(NULL))
         die("Could not load keymap\n");
 
     translate_keysyms();
     grab_all_keys(conn);
+    stats_startup_end(STATS_STARTUP_KEYBOARD);
+
+    /* The layout passed in memory by the previous process (see
+     * store_restart_layout()) takes precedence over a layout file. */
+    const int layout_fd = parse_restart_fd("_I3_RESTART_LAYOUT_FD");
+    unsetenv("_I3_RESTART_LAYOUT_FD");
+    const bool restoring = (layout_fd != -1 || layout_path != NULL);
 
     bool needs_tree_init = true;
+    if (layout_fd != -1) {
+        LOG("Restoring the layout passed in fd %d.\n", layout_fd);
+        stats_startup_begin(STATS_STARTUP_TREE_RESTORE);
+        needs_tree_init = !tree_restore_fd(layout_fd, greply);
+        stats_startup_end(STATS_STARTUP_TREE_RESTORE);
+        close(layout_fd);
+    }
     if (layout_path != NULL) {
-        LOG("Trying to restore the layout from \"%s\".\n", layout_path);
-        needs_tree_init = !tree_restore(layout_path, greply);
+        if (needs_tree_init) {
+            LOG("Trying to restore the layout from \"%s\".\n", layout_path);
+            stats_startup_begin(STATS_STARTUP_TREE_RESTORE);
+            needs_tree_init = !tree_restore(layout_path, greply);
+            stats_startup_end(STATS_STARTUP_TREE_RESTORE);
+        }
         if (delete_layout_path) {
             unlink(layout_path);
             const char *dir = dirname(layout_path);
@@ -751,8 +1034,11 @@ int main(int argc, char *argv[]) {
             rmdir(dir);
         }
     }
-    if (needs_tree_init)
+    if (needs_tree_init) {
+        stats_startup_begin(STATS_STARTUP_TREE_INIT);
         tree_init(greply);
+        stats_startup_end(STATS_STARTUP_TREE_INIT);
+    }
 
     free(greply);
 
@@ -760,6 +1046,7 @@ int main(int argc, char *argv[]) {
     if (fake_outputs == NULL && config.fake_outputs != NULL)
         fake_outputs = config.fake_outputs;
 
+    stats_startup_begin(STATS_STARTUP_OUTPUTS);
     if (fake_outputs != NULL) {
         fake_outputs_init(fake_outputs);
         FREE(fake_outputs);
@@ -771,14 +1058,17 @@ int main(int argc, char *argv[]) {
         xinerama_init();
     } else {
         DLOG("Checking for XRandR...\n");
+        const stats_x_subsystem_t x_subsystem = stats_x_enter(STATS_X_SUBSYSTEM_RANDR);
         randr_init(&randr_base, disable_randr15 || config.disable_randr15);
+        stats_x_leave(x_subsystem);
     }
+    stats_startup_end(STATS_STARTUP_OUTPUTS);
 
     /* We need to force disabling outputs which have been loaded from the
      * layout file but are no longer active. This can happen if the output has
      * been disabled in the short time between writing the restart layout file
      * and restarting i3. See #2326. */
-    if (layout_path != NULL && randr_base > -1) {
+    if (restoring && randr_base > -1) {
         Con *con;
         TAILQ_FOREACH(con, &(croot->nodes_head), nodes) {
             Output *output;
@@ -821,9 +1111,12 @@ int main(int argc, char *argv[]) {
     con_activate(con_descend_focused(output_get_content(output->con)));
     free(pointerreply);
 
+    stats_startup_begin(STATS_STARTUP_FIRST_RENDER);
     tree_render();
+    stats_startup_end(STATS_STARTUP_FIRST_RENDER);
 
     /* Create the UNIX domain socket for IPC */
+    stats_startup_begin(STATS_STARTUP_SOCKETS);
     int ipc_socket = ipc_create_socket(config.ipc_socket_path);
     if (ipc_socket == -1) {
         ELOG("Could not create the IPC socket, IPC disabled\n");
@@ -863,13 +1156,20 @@ int main(int argc, char *argv[]) {
     }
 
     {
-        const int restart_fd = parse_restart_fd();
+        const int restart_fd = parse_restart_fd("_I3_RESTART_FD");
         if (restart_fd != -1) {
             DLOG("serving restart fd %d", restart_fd);
             ipc_client *client = ipc_new_client_on_fd(main_loop, restart_fd);
             ipc_confirm_restart(client);
         }
     }
+    stats_startup_end(STATS_STARTUP_SOCKETS);
+
+    shmstate_open();
+
+    if (record_trace_path != NULL && replay_trace_path == NULL)
+        event_trace_open(record_trace_path);
+    FREE(record_trace_path);
 
     /* Set up i3 specific atoms like I3_SOCKET_PATH and I3_CONFIG_PATH */
     x_set_i3_atoms();
@@ -887,6 +1187,11 @@ int main(int argc, char *argv[]) {
     ev_prepare_init(xcb_prepare, xcb_prepare_cb);
     ev_prepare_start(main_loop, xcb_prepare);
 
+    frame_check = scalloc(1, sizeof(struct ev_check));
+    ev_check_init(frame_check, frame_check_cb);
+    ev_set_priority(frame_check, EV_MAXPRI);
+    ev_check_start(main_loop, frame_check);
+
     xcb_flush(conn);
 
     /* What follows is a fugly consequence of X11 protocol race conditions like
@@ -902,11 +1207,13 @@ int main(int argc, char *argv[]) {
      * connections), then discard all pending events (since we didn’t do
      * anything, there cannot be any meaningful responses), then ungrab the
      * server. */
+    stats_startup_begin(STATS_STARTUP_MANAGE_EXISTING_WINDOWS);
     xcb_grab_server(conn);
     {
         xcb_aux_sync(conn);
         xcb_generic_event_t *event;
         while ((event = xcb_poll_for_event(conn)) != NULL) {
+            retire_error_callbacks(event->full_sequence);
             if (event->response_type == 0) {
                 free(event);
                 continue;
@@ -923,9 +1230,12 @@ int main(int argc, char *argv[]) {
 
             free(event);
         }
+        const stats_x_subsystem_t x_subsystem = stats_x_enter(STATS_X_SUBSYSTEM_MANAGE);
         manage_existing_windows(root);
+        stats_x_leave(x_subsystem);
     }
     xcb_ungrab_server(conn);
+    stats_startup_end(STATS_STARTUP_MANAGE_EXISTING_WINDOWS);
 
     if (autostart) {
         LOG("This is not an in-place restart, copying root window contents to a pixmap\n");
@@ -976,7 +1286,15 @@ int main(int argc, char *argv[]) {
      * while we are sending them a message */
     signal(SIGPIPE, SIG_IGN);
 
+    /* Replaying a trace replaces the event loop. Autostarts and bars are
+     * skipped, since the trace contains the events of their windows. */
+    if (replay_trace_path != NULL) {
+        atexit(i3_exit);
+        exit(event_trace_replay(replay_trace_path) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
     /* Autostarting exec-lines */
+    stats_startup_begin(STATS_STARTUP_AUTOSTART);
     if (autostart) {
         while (!TAILQ_EMPTY(&autostarts)) {
             struct Autostart *exec = TAILQ_FIRST(&autostarts);
@@ -1014,6 +1332,9 @@ int main(int argc, char *argv[]) {
         start_application(command, true);
         free(command);
     }
+    stats_startup_end(STATS_STARTUP_AUTOSTART);
+
+    stats_startup_done();
 
     /* Make sure to destroy the event loop to invoke the cleanup callbacks
      * when calling exit() */
@@ -21,9 +21,8 @@
 static xcb_window_t _match_depth(i3Window *win, Con *con) {
     xcb_window_t old_frame = XCB_NONE;
     if (con->depth != win->depth) {
-        old_frame = con->frame.id;
         con->depth = win->depth;
-        x_con_reframe(con);
+        old_frame = x_con_reframe(con);
     }
     return old_frame;
 }
@@ -33,41 +32,225 @@ static xcb_window_t _match_depth(i3Window *win, Con *con) {
  *
  */
 static void _remove_matches(Con *con) {
-    while (!TAILQ_EMPTY(&(con->swallow_head))) {
-        Match *first = TAILQ_FIRST(&(con->swallow_head));
-        TAILQ_REMOVE(&(con->swallow_head), first, matches);
-        match_free(first);
-        free(first);
+    con_clear_swallows(con);
+}
+
+/*
+ * The cookies of all requests manage_window() needs answered before it can
+ * place, map and focus a window. They are sent as one batch so that adopting a
+ * window costs a single round trip, no matter how many properties we are
+ * interested in.
+ *
+ */
+struct window_cookies {
+    xcb_get_geometry_cookie_t geometry;
+    xcb_get_property_cookie_t wm_type, strut, state, utf8_title, title, class,
+        leader, transient, role, startup_id, wm_hints, wm_normal_hints,
+        wm_user_time, wm_desktop, protocols, sync_counter;
+
+    /* When the MapRequest was handled (see stats_now_ns()), or 0 for windows
+     * which are adopted when starting up. */
+    uint64_t map_request_ns;
+};
+
+/*
+ * The requests for a managed window whose answers do not influence where the
+ * window is placed. They are sent along with the reparenting, but only handled
+ * once the window is mapped (see manage_handle_deferred()), just like
+ * PropertyNotify or ShapeNotify events arriving later on.
+ *
+ */
+struct deferred_window {
+    xcb_window_t window;
+    xcb_get_property_cookie_t motif_wm_hints;
+    bool shape_requested;
+    xcb_shape_query_extents_cookie_t shape;
+
+    TAILQ_ENTRY(deferred_window) deferred;
+};
+static TAILQ_HEAD(deferred_head, deferred_window) deferred_windows =
+    TAILQ_HEAD_INITIALIZER(deferred_windows);
+
+/*
+ * Returns true if the window should be managed given its attributes, that is
+ * if it is mapped (or does not need to be), does not have the
+ * override_redirect flag set and is not managed already.
+ *
+ */
+static bool window_is_manageable(xcb_window_t window, xcb_get_window_attributes_reply_t *attr,
+                                 bool needs_to_be_mapped) {
+    if (needs_to_be_mapped && attr->map_state != XCB_MAP_STATE_VIEWABLE) {
+        return false;
+    }
+
+    /* Don’t manage clients with the override_redirect flag */
+    if (attr->override_redirect) {
+        return false;
+    }
+
+    /* Check if the window is already managed */
+    if (con_by_window_id(window) != NULL) {
+        DLOG("already managed (by con %p)\n", con_by_window_id(window));
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * Called when setting the temporary event mask of a new window failed, see
+ * request_window_properties().
+ *
+ */
+static void event_mask_failed(xcb_generic_error_t *error, void *data) {
+    LOG("Could not change event mask of window 0x%08x, it probably already disappeared.\n",
+        (xcb_window_t)(uintptr_t)data);
+}
+
+/*
+ * Called when reparenting a newly managed window into its frame failed. The
+ * window was destroyed in the meantime, so it is unmanaged again.
+ *
+ */
+static void reparent_failed(xcb_generic_error_t *error, void *data) {
+    const xcb_window_t window = (xcb_window_t)(uintptr_t)data;
+    LOG("Could not reparent window 0x%08x, it probably already disappeared.\n", window);
+
+    Con *con = con_by_window_id(window);
+    if (con != NULL) {
+        tree_close_internal(con, DONT_KILL_WINDOW, false);
+        tree_schedule_render();
     }
 }
 
+/*
+ * Sends the event mask change and all property requests for the given window
+ * without waiting for any of them. The geometry request is expected to have
+ * been sent already.
+ *
+ */
+static void request_window_properties(xcb_window_t window, struct window_cookies *cookies) {
+    uint32_t values[1];
+
+    /* Set a temporary event mask for the new window, consisting only of
+     * PropertyChange and StructureNotify. We need to be notified of
+     * PropertyChanges because the client can change its properties *after* we
+     * requested them but *before* we actually reparented it and have set our
+     * final event mask.
+     * We need StructureNotify because the client may unmap the window before
+     * we get to re-parent it.
+     * If this request fails, the client has already destroyed the window
+     * between the MapRequest and our event mask change. We do not wait for
+     * the result: reparenting the window will fail as well, and
+     * reparent_failed() then unmanages it again. */
+    values[0] = XCB_EVENT_MASK_PROPERTY_CHANGE |
+                XCB_EVENT_MASK_STRUCTURE_NOTIFY;
+    xcb_void_cookie_t event_mask_cookie =
+        xcb_change_window_attributes(conn, window, XCB_CW_EVENT_MASK, values);
+    add_error_callback(event_mask_cookie.sequence, event_mask_failed, (void *)(uintptr_t)window);
+
+#define GET_PROPERTY(atom, len) xcb_get_property(conn, false, window, atom, XCB_GET_PROPERTY_TYPE_ANY, 0, len)
+
+    cookies->wm_type = GET_PROPERTY(A__NET_WM_WINDOW_TYPE, UINT32_MAX);
+    cookies->strut = GET_PROPERTY(A__NET_WM_STRUT_PARTIAL, UINT32_MAX);
+    cookies->state = GET_PROPERTY(A__NET_WM_STATE, UINT32_MAX);
+    cookies->utf8_title = GET_PROPERTY(A__NET_WM_NAME, 128);
+    cookies->leader = GET_PROPERTY(A_WM_CLIENT_LEADER, UINT32_MAX);
+    cookies->transient = GET_PROPERTY(XCB_ATOM_WM_TRANSIENT_FOR, UINT32_MAX);
+    cookies->title = GET_PROPERTY(XCB_ATOM_WM_NAME, 128);
+    cookies->class = GET_PROPERTY(XCB_ATOM_WM_CLASS, 128);
+    cookies->role = GET_PROPERTY(A_WM_WINDOW_ROLE, 128);
+    cookies->startup_id = GET_PROPERTY(A__NET_STARTUP_ID, 512);
+    cookies->wm_hints = xcb_icccm_get_wm_hints(conn, window);
+    cookies->wm_normal_hints = xcb_icccm_get_wm_normal_hints(conn, window);
+    cookies->wm_user_time = GET_PROPERTY(A__NET_WM_USER_TIME, UINT32_MAX);
+    cookies->wm_desktop = GET_PROPERTY(A__NET_WM_DESKTOP, UINT32_MAX);
+    cookies->protocols = xcb_icccm_get_wm_protocols(conn, window, A_WM_PROTOCOLS);
+    cookies->sync_counter = GET_PROPERTY(A__NET_WM_SYNC_REQUEST_COUNTER, 2);
+
+#undef GET_PROPERTY
+}
+
+/*
+ * Discards the replies to all property requests sent by
+ * request_window_properties(), for when we give up on managing the window.
+ *
+ */
+static void discard_window_properties(struct window_cookies *cookies) {
+    xcb_get_property_cookie_t *all[] = {
+        &(cookies->wm_type), &(cookies->strut), &(cookies->state),
+        &(cookies->utf8_title), &(cookies->title), &(cookies->class),
+        &(cookies->leader), &(cookies->transient), &(cookies->role),
+        &(cookies->startup_id), &(cookies->wm_hints), &(cookies->wm_normal_hints),
+        &(cookies->wm_user_time), &(cookies->wm_desktop), &(cookies->protocols),
+        &(cookies->sync_counter)};
+    for (size_t i = 0; i < sizeof(all) / sizeof(all[0]); i++) {
+        xcb_discard_reply(conn, all[i]->sequence);
+    }
+}
+
+static void manage_window_with_cookies(xcb_window_t window, xcb_get_window_attributes_reply_t *attr,
+                                       struct window_cookies *cookies);
+
 /*
  * Go through all existing windows (if the window manager is restarted) and manage them
  *
+ * All requests for all windows are sent before any reply is waited for, so
+ * adopting n windows costs two round trips instead of 2n.
+ *
  */
 void manage_existing_windows(xcb_window_t root) {
     xcb_query_tree_reply_t *reply;
     int i, len;
     xcb_window_t *children;
-    xcb_get_window_attributes_cookie_t *cookies;
+    xcb_get_window_attributes_cookie_t *attr_cookies;
+    xcb_get_window_attributes_reply_t **attrs;
+    struct window_cookies *cookies;
 
     /* Get the tree of windows whose parent is the root window (= all) */
     if ((reply = xcb_query_tree_reply(conn, xcb_query_tree(conn, root), 0)) == NULL)
         return;
 
     len = xcb_query_tree_children_length(reply);
+    attr_cookies = smalloc(len * sizeof(*attr_cookies));
+    attrs = scalloc(len, sizeof(*attrs));
     cookies = smalloc(len * sizeof(*cookies));
 
     /* Request the window attributes for every window */
     children = xcb_query_tree_children(reply);
     for (i = 0; i < len; ++i)
-        cookies[i] = xcb_get_window_attributes(conn, children[i]);
+        attr_cookies[i] = xcb_get_window_attributes(conn, children[i]);
+
+    /* For every window we are going to manage, request its geometry and
+     * properties before processing the first one. */
+    for (i = 0; i < len; ++i) {
+        if ((attrs[i] = xcb_get_window_attributes_reply(conn, attr_cookies[i], 0)) == NULL) {
+            DLOG("Could not get attributes of window 0x%08x\n", children[i]);
+            continue;
+        }
 
-    /* Call manage_window with the attributes for every window */
-    for (i = 0; i < len; ++i)
-        manage_window(children[i], cookies[i], true);
+        if (!window_is_manageable(children[i], attrs[i], true)) {
+            FREE(attrs[i]);
+            continue;
+        }
+
+        cookies[i].map_request_ns = 0;
+        cookies[i].geometry = xcb_get_geometry(conn, children[i]);
+        request_window_properties(children[i], &(cookies[i]));
+    }
+
+    /* Manage every window, the replies should all be there by now */
+    for (i = 0; i < len; ++i) {
+        if (attrs[i] == NULL)
+            continue;
+
+        DLOG("window 0x%08x\n", children[i]);
+        manage_window_with_cookies(children[i], attrs[i], &(cookies[i]));
+    }
 
     free(reply);
+    free(attr_cookies);
+    free(attrs);
     free(cookies);
 }
 
@@ -109,122 +292,77 @@ void restore_geometry(void) {
 void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cookie,
                    bool needs_to_be_mapped) {
     DLOG("window 0x%08x\n", window);
+    I3_PROBE1(manage_window, window);
 
-    xcb_drawable_t d = {window};
-    xcb_get_geometry_cookie_t geomc;
-    xcb_get_geometry_reply_t *geom;
     xcb_get_window_attributes_reply_t *attr = NULL;
+    struct window_cookies cookies;
 
-    xcb_get_property_cookie_t wm_type_cookie, strut_cookie, state_cookie,
-        utf8_title_cookie, title_cookie,
-        class_cookie, leader_cookie, transient_cookie,
-        role_cookie, startup_id_cookie, wm_hints_cookie,
-        wm_normal_hints_cookie, motif_wm_hints_cookie, wm_user_time_cookie, wm_desktop_cookie;
-
-    geomc = xcb_get_geometry(conn, d);
+    cookies.map_request_ns = stats_now_ns();
+    cookies.geometry = xcb_get_geometry(conn, window);
 
     /* Check if the window is mapped (it could be not mapped when intializing and
        calling manage_window() for every window) */
     if ((attr = xcb_get_window_attributes_reply(conn, cookie, 0)) == NULL) {
         DLOG("Could not get attributes\n");
-        xcb_discard_reply(conn, geomc.sequence);
+        xcb_discard_reply(conn, cookies.geometry.sequence);
         return;
     }
 
-    if (needs_to_be_mapped && attr->map_state != XCB_MAP_STATE_VIEWABLE) {
-        xcb_discard_reply(conn, geomc.sequence);
-        goto out;
+    if (!window_is_manageable(window, attr, needs_to_be_mapped)) {
+        xcb_discard_reply(conn, cookies.geometry.sequence);
+        free(attr);
+        return;
     }
 
-    /* Don’t manage clients with the override_redirect flag */
-    if (attr->override_redirect) {
-        xcb_discard_reply(conn, geomc.sequence);
-        goto out;
-    }
+    request_window_properties(window, &cookies);
+    manage_window_with_cookies(window, attr, &cookies);
+}
 
-    /* Check if the window is already managed */
-    if (con_by_window_id(window) != NULL) {
-        DLOG("already managed (by con %p)\n", con_by_window_id(window));
-        xcb_discard_reply(conn, geomc.sequence);
-        goto out;
-    }
+/*
+ * Manages the window once its requests have been sent. Takes ownership of
+ * attr.
+ *
+ */
+static void manage_window_with_cookies(xcb_window_t window, xcb_get_window_attributes_reply_t *attr,
+                                       struct window_cookies *cookies) {
+    xcb_get_geometry_reply_t *geom;
+    uint32_t values[1];
 
     /* Get the initial geometry (position, size, …) */
-    if ((geom = xcb_get_geometry_reply(conn, geomc, 0)) == NULL) {
+    if ((geom = xcb_get_geometry_reply(conn, cookies->geometry, 0)) == NULL) {
         DLOG("could not get geometry\n");
+        discard_window_properties(cookies);
         goto out;
     }
 
-    uint32_t values[1];
-
-    /* Set a temporary event mask for the new window, consisting only of
-     * PropertyChange and StructureNotify. We need to be notified of
-     * PropertyChanges because the client can change its properties *after* we
-     * requested them but *before* we actually reparented it and have set our
-     * final event mask.
-     * We need StructureNotify because the client may unmap the window before
-     * we get to re-parent it.
-     * If this request fails, we assume the client has already unmapped the
-     * window between the MapRequest and our event mask change. */
-    values[0] = XCB_EVENT_MASK_PROPERTY_CHANGE |
-                XCB_EVENT_MASK_STRUCTURE_NOTIFY;
-    xcb_void_cookie_t event_mask_cookie =
-        xcb_change_window_attributes_checked(conn, window, XCB_CW_EVENT_MASK, values);
-    if (xcb_request_check(conn, event_mask_cookie) != NULL) {
-        LOG("Could not change event mask, the window probably already disappeared.\n");
-        goto out;
-    }
-
-#define GET_PROPERTY(atom, len) xcb_get_property(conn, false, window, atom, XCB_GET_PROPERTY_TYPE_ANY, 0, len)
-
-    wm_type_cookie = GET_PROPERTY(A__NET_WM_WINDOW_TYPE, UINT32_MAX);
-    strut_cookie = GET_PROPERTY(A__NET_WM_STRUT_PARTIAL, UINT32_MAX);
-    state_cookie = GET_PROPERTY(A__NET_WM_STATE, UINT32_MAX);
-    utf8_title_cookie = GET_PROPERTY(A__NET_WM_NAME, 128);
-    leader_cookie = GET_PROPERTY(A_WM_CLIENT_LEADER, UINT32_MAX);
-    transient_cookie = GET_PROPERTY(XCB_ATOM_WM_TRANSIENT_FOR, UINT32_MAX);
-    title_cookie = GET_PROPERTY(XCB_ATOM_WM_NAME, 128);
-    class_cookie = GET_PROPERTY(XCB_ATOM_WM_CLASS, 128);
-    role_cookie = GET_PROPERTY(A_WM_WINDOW_ROLE, 128);
-    startup_id_cookie = GET_PROPERTY(A__NET_STARTUP_ID, 512);
-    wm_hints_cookie = xcb_icccm_get_wm_hints(conn, window);
-    wm_normal_hints_cookie = xcb_icccm_get_wm_normal_hints(conn, window);
-    motif_wm_hints_cookie = GET_PROPERTY(A__MOTIF_WM_HINTS, 5 * sizeof(uint64_t));
-    wm_user_time_cookie = GET_PROPERTY(A__NET_WM_USER_TIME, UINT32_MAX);
-    wm_desktop_cookie = GET_PROPERTY(A__NET_WM_DESKTOP, UINT32_MAX);
-
-    i3Window *cwindow = scalloc(1, sizeof(i3Window));
+    i3Window *cwindow = window_new();
     cwindow->id = window;
     cwindow->depth = get_visual_depth(attr->visual);
 
-    int *buttons = bindings_get_buttons_to_grab();
-    xcb_grab_buttons(conn, window, buttons);
-    FREE(buttons);
+    grab_buttons_on_window(conn, window);
 
     /* update as much information as possible so far (some replies may be NULL) */
-    window_update_class(cwindow, xcb_get_property_reply(conn, class_cookie, NULL));
-    window_update_name_legacy(cwindow, xcb_get_property_reply(conn, title_cookie, NULL));
-    window_update_name(cwindow, xcb_get_property_reply(conn, utf8_title_cookie, NULL));
-    window_update_leader(cwindow, xcb_get_property_reply(conn, leader_cookie, NULL));
-    window_update_transient_for(cwindow, xcb_get_property_reply(conn, transient_cookie, NULL));
-    window_update_strut_partial(cwindow, xcb_get_property_reply(conn, strut_cookie, NULL));
-    window_update_role(cwindow, xcb_get_property_reply(conn, role_cookie, NULL));
+    window_update_class(cwindow, xcb_get_property_reply(conn, cookies->class, NULL));
+    window_update_name_legacy(cwindow, xcb_get_property_reply(conn, cookies->title, NULL));
+    window_update_name(cwindow, xcb_get_property_reply(conn, cookies->utf8_title, NULL));
+    window_update_leader(cwindow, xcb_get_property_reply(conn, cookies->leader, NULL));
+    window_update_transient_for(cwindow, xcb_get_property_reply(conn, cookies->transient, NULL));
+    window_update_strut_partial(cwindow, xcb_get_property_reply(conn, cookies->strut, NULL));
+    window_update_role(cwindow, xcb_get_property_reply(conn, cookies->role, NULL));
     bool urgency_hint;
-    window_update_hints(cwindow, xcb_get_property_reply(conn, wm_hints_cookie, NULL), &urgency_hint);
-    border_style_t motif_border_style = BS_NORMAL;
-    window_update_motif_hints(cwindow, xcb_get_property_reply(conn, motif_wm_hints_cookie, NULL), &motif_border_style);
-    window_update_normal_hints(cwindow, xcb_get_property_reply(conn, wm_normal_hints_cookie, NULL), geom);
-    xcb_get_property_reply_t *type_reply = xcb_get_property_reply(conn, wm_type_cookie, NULL);
-    xcb_get_property_reply_t *state_reply = xcb_get_property_reply(conn, state_cookie, NULL);
+    window_update_hints(cwindow, xcb_get_property_reply(conn, cookies->wm_hints, NULL), &urgency_hint);
+    window_update_normal_hints(cwindow, xcb_get_property_reply(conn, cookies->wm_normal_hints, NULL), geom);
+    xcb_get_property_reply_t *type_reply = xcb_get_property_reply(conn, cookies->wm_type, NULL);
+    xcb_get_property_reply_t *state_reply = xcb_get_property_reply(conn, cookies->state, NULL);
 
     xcb_get_property_reply_t *startup_id_reply;
-    startup_id_reply = xcb_get_property_reply(conn, startup_id_cookie, NULL);
+    startup_id_reply = xcb_get_property_reply(conn, cookies->startup_id, NULL);
     char *startup_ws = startup_workspace_for_window(cwindow, startup_id_reply);
     DLOG("startup workspace = %s\n", startup_ws);
 
     /* Get _NET_WM_DESKTOP if it was set. */
     xcb_get_property_reply_t *wm_desktop_reply;
-    wm_desktop_reply = xcb_get_property_reply(conn, wm_desktop_cookie, NULL);
+    wm_desktop_reply = xcb_get_property_reply(conn, cookies->wm_desktop, NULL);
     cwindow->wm_desktop = NET_WM_DESKTOP_NONE;
     if (wm_desktop_reply != NULL && xcb_get_property_value_length(wm_desktop_reply) != 0) {
         uint32_t *wm_desktops = xcb_get_property_value(wm_desktop_reply);
@@ -232,8 +370,15 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
     }
     FREE(wm_desktop_reply);
 
-    /* check if the window needs WM_TAKE_FOCUS */
-    cwindow->needs_take_focus = window_supports_protocol(cwindow->id, A_WM_TAKE_FOCUS);
+    /* check if the window needs WM_TAKE_FOCUS or supports WM_DELETE_WINDOW */
+    window_update_protocols(cwindow, xcb_get_property_reply(conn, cookies->protocols, NULL));
+    window_update_sync_counter(cwindow, xcb_get_property_reply(conn, cookies->sync_counter, NULL));
+
+    /* The WM_PROTOCOLS request is the last one of the batch, so all replies
+     * have been received by now. */
+    uint64_t latency_ns[STATS_NUM_MAP_PHASES];
+    const uint64_t properties_done_ns = stats_now_ns();
+    latency_ns[STATS_MAP_PROPERTIES] = properties_done_ns - cookies->map_request_ns;
 
     /* read the preferred _NET_WM_WINDOW_TYPE atom */
     cwindow->window_type = xcb_get_preferred_window_type(type_reply);
@@ -357,6 +502,7 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
          * once. */
         if (match != NULL && match->insert_where != M_BELOW) {
             DLOG("Removing match %p from container %p\n", match, nc);
+            con_swallow_index_remove(nc, match);
             TAILQ_REMOVE(&(nc->swallow_head), match, matches);
             match_free(match);
             FREE(match);
@@ -378,6 +524,7 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
         old_frame = _match_depth(cwindow, nc);
     }
     nc->window = cwindow;
+    con_invalidate_tree_representation(nc);
     x_reinit(nc);
 
     nc->border_width = geom->border_width;
@@ -460,14 +607,14 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
     }
 
     if (xcb_reply_contains_atom(state_reply, A__NET_WM_STATE_STICKY))
-        nc->sticky = true;
+        con_set_sticky(nc, true);
 
     /* We ignore the hint for an internal workspace because windows in the
      * scratchpad also have this value, but upon restarting i3 we don't want
      * them to become sticky windows. */
     if (cwindow->wm_desktop == NET_WM_DESKTOP_ALL && (ws == NULL || !con_is_internal(ws))) {
         DLOG("This window has _NET_WM_DESKTOP = 0xFFFFFFFF. Will float it and make it sticky.\n");
-        nc->sticky = true;
+        con_set_sticky(nc, true);
         want_floating = true;
     }
 
@@ -521,22 +668,9 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
     if (nc->geometry.width == 0)
         nc->geometry = (Rect){geom->x, geom->y, geom->width, geom->height};
 
-    if (motif_border_style != BS_NORMAL) {
-        DLOG("MOTIF_WM_HINTS specifies decorations (border_style = %d)\n", motif_border_style);
-        if (want_floating) {
-            con_set_border_style(nc, motif_border_style, config.default_floating_border_width);
-        } else {
-            con_set_border_style(nc, motif_border_style, config.default_border_width);
-        }
-    }
-
     if (want_floating) {
         DLOG("geometry = %d x %d\n", nc->geometry.width, nc->geometry.height);
-        /* automatically set the border to the default value if a motif border
-         * was not specified */
-        bool automatic_border = (motif_border_style == BS_NORMAL);
-
-        floating_enable(nc, automatic_border);
+        floating_enable(nc, true);
     }
 
     /* explicitly set the border width to the default */
@@ -544,20 +678,24 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
         nc->current_border_width = (want_floating ? config.default_floating_border_width : config.default_border_width);
     }
 
+    /* Frames are created lazily, see x_con_init(). */
+    x_con_create_frame(nc);
+
     /* to avoid getting an UnmapNotify event due to reparenting, we temporarily
      * declare no interest in any state change event of this window */
     values[0] = XCB_NONE;
     xcb_change_window_attributes(conn, window, XCB_CW_EVENT_MASK, values);
 
-    xcb_void_cookie_t rcookie = xcb_reparent_window_checked(conn, window, nc->frame.id, 0, 0);
-    if (xcb_request_check(conn, rcookie) != NULL) {
-        LOG("Could not reparent the window, aborting\n");
-        goto geom_out;
-    }
+    /* Reparenting is not checked synchronously: if the window disappeared in
+     * the meantime, reparent_failed() unmanages it again. */
+    xcb_void_cookie_t reparent_cookie = xcb_reparent_window(conn, window, nc->frame.id, 0, 0);
+    add_error_callback(reparent_cookie.sequence, reparent_failed, (void *)(uintptr_t)window);
+
+    struct deferred_window *deferred = scalloc(1, sizeof(struct deferred_window));
+    deferred->window = window;
 
     values[0] = CHILD_EVENT_MASK & ~XCB_EVENT_MASK_ENTER_WINDOW;
     xcb_change_window_attributes(conn, window, XCB_CW_EVENT_MASK, values);
-    xcb_flush(conn);
 
     /* Put the client inside the save set. Upon termination (whether killed or
      * normal exit does not matter) of the window manager, these clients will
@@ -572,16 +710,18 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
 
         /* Check if the window is shaped. Sadly, we can check only for the
          * bounding shape, not for the input shape. */
-        xcb_shape_query_extents_cookie_t cookie =
-            xcb_shape_query_extents(conn, window);
-        xcb_shape_query_extents_reply_t *reply =
-            xcb_shape_query_extents_reply(conn, cookie, NULL);
-        if (reply != NULL && reply->bounding_shaped) {
-            cwindow->shaped = true;
-        }
-        FREE(reply);
+        deferred->shape_requested = true;
+        deferred->shape = xcb_shape_query_extents(conn, window);
     }
 
+    /* The decorations requested via _MOTIF_WM_HINTS are applied just like a
+     * later change of the property would be. This request is sent last, so
+     * that all other deferred replies have arrived once it is answered. */
+    deferred->motif_wm_hints = xcb_get_property(conn, false, window, A__MOTIF_WM_HINTS,
+                                                XCB_GET_PROPERTY_TYPE_ANY, 0, 5 * sizeof(uint64_t));
+    TAILQ_INSERT_TAIL(&deferred_windows, deferred, deferred);
+    xcb_flush(conn);
+
     /* Check if any assignments match */
     run_assignments(cwindow);
 
@@ -632,7 +772,7 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
         DLOG("Checking con = %p for _NET_WM_USER_TIME.\n", nc);
 
         uint32_t *wm_user_time;
-        xcb_get_property_reply_t *wm_user_time_reply = xcb_get_property_reply(conn, wm_user_time_cookie, NULL);
+        xcb_get_property_reply_t *wm_user_time_reply = xcb_get_property_reply(conn, cookies->wm_user_time, NULL);
         if (wm_user_time_reply != NULL && xcb_get_property_value_length(wm_user_time_reply) != 0 &&
             (wm_user_time = xcb_get_property_value(wm_user_time_reply)) &&
             wm_user_time[0] == 0) {
@@ -642,7 +782,7 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
 
         FREE(wm_user_time_reply);
     } else {
-        xcb_discard_reply(conn, wm_user_time_cookie.sequence);
+        xcb_discard_reply(conn, cookies->wm_user_time.sequence);
     }
 
     if (set_focus) {
@@ -663,8 +803,24 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
         con_activate(nc);
     }
 
+    const uint64_t placement_done_ns = stats_now_ns();
+    latency_ns[STATS_MAP_PLACEMENT] = placement_done_ns - properties_done_ns;
+
     tree_render();
 
+    /* Windows on invisible workspaces are not mapped yet, so there is no
+     * latency to report for them. */
+    if (cookies->map_request_ns != 0 && nc->mapped) {
+        const uint64_t now_ns = stats_now_ns();
+        latency_ns[STATS_MAP_RENDER] = now_ns - placement_done_ns;
+        latency_ns[STATS_MAP_TOTAL] = now_ns - cookies->map_request_ns;
+        DLOG("Window 0x%08x mapped %.3f ms after its MapRequest (properties %.3f ms, placement %.3f ms, render %.3f ms)\n",
+             window, latency_ns[STATS_MAP_TOTAL] / 1e6, latency_ns[STATS_MAP_PROPERTIES] / 1e6,
+             latency_ns[STATS_MAP_PLACEMENT] / 1e6, latency_ns[STATS_MAP_RENDER] / 1e6);
+        stats_record_map_latency(latency_ns);
+        ipc_send_window_mapped_event(nc, latency_ns);
+    }
+
     /* Destroy the old frame if we had to reframe the container. This needs to be done
      * after rendering in order to prevent the background from flickering in its place. */
     if (old_frame != XCB_NONE) {
@@ -684,12 +840,70 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
     /* If a sticky window was mapped onto another workspace, make sure to pop it to the front. */
     output_push_sticky_windows(focused);
 
-geom_out:
     free(geom);
 out:
     free(attr);
 }
 
+/*
+ * Handles the deferred replies of a single window, see struct deferred_window.
+ *
+ */
+static void handle_deferred_window(struct deferred_window *deferred) {
+    /* Replies arrive in the order of the requests: once the last one is
+     * there, getting the shape does not block. */
+    xcb_get_property_reply_t *motif_reply =
+        xcb_get_property_reply(conn, deferred->motif_wm_hints, NULL);
+    xcb_shape_query_extents_reply_t *shape_reply = NULL;
+    if (deferred->shape_requested)
+        shape_reply = xcb_shape_query_extents_reply(conn, deferred->shape, NULL);
+
+    Con *con = con_by_window_id(deferred->window);
+    if (con == NULL || con->window == NULL) {
+        DLOG("Window 0x%08x is not managed anymore\n", deferred->window);
+        goto out;
+    }
+
+    if (shape_reply != NULL && shape_reply->bounding_shaped) {
+        x_set_shape(con, XCB_SHAPE_SK_BOUNDING, true);
+    }
+
+    if (motif_reply != NULL) {
+        property_notify_reply(deferred->window, A__MOTIF_WM_HINTS, motif_reply);
+        motif_reply = NULL;
+    }
+    tree_schedule_render();
+
+out:
+    FREE(motif_reply);
+    FREE(shape_reply);
+}
+
+/*
+ * Handles the replies to the requests which manage_window() sent for newly
+ * managed windows, but does not need answered to place and map them (e.g.
+ * _MOTIF_WM_HINTS). This is called in the event loop iteration after the
+ * windows were managed, i.e. after they were mapped.
+ *
+ */
+void manage_handle_deferred(void) {
+    struct deferred_window *deferred;
+    while (!TAILQ_EMPTY(&deferred_windows)) {
+        deferred = TAILQ_FIRST(&deferred_windows);
+        TAILQ_REMOVE(&deferred_windows, deferred, deferred);
+        handle_deferred_window(deferred);
+        free(deferred);
+    }
+}
+
+/*
+ * Returns true if manage_handle_deferred() has replies to handle.
+ *
+ */
+bool manage_has_deferred(void) {
+    return !TAILQ_EMPTY(&deferred_windows);
+}
+
 /*
  * Remanages a window: performs a swallow check and runs assignments.
  * Returns con for the window regardless if it updated.
@@ -716,6 +930,8 @@ Con *remanage_window(Con *con) {
         _remove_matches(nc);
     }
     window_free(nc->window);
+    nc->window = NULL;
+    con_invalidate_tree_representation(nc);
 
     xcb_window_t old_frame = _match_depth(con->window, nc);
 
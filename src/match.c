@@ -11,6 +11,7 @@
  * match_matches_window() to find the windows affected by this command.
  *
  */
+#define LOG_CATEGORY LOG_CATEGORY_MATCH
 #include "all.h"
 
 /* From sys/time.h, not sure if it’s available on all systems. */
@@ -89,7 +90,10 @@ bool match_matches_window(Match *match, i3Window *window) {
 
 #define GET_FIELD_str(field) (field)
 #define GET_FIELD_i3string(field) (i3string_as_utf8(field))
-#define CHECK_WINDOW_FIELD(match_field, window_field, type)                                       \
+/* The str fields are interned, see regex_matches_interned(). */
+#define MATCHES_str regex_matches_interned
+#define MATCHES_i3string regex_matches_cached
+#define CHECK_WINDOW_FIELD(match_field, window_field, type, generation)                           \
     do {                                                                                          \
         if (match->match_field != NULL) {                                                         \
             if (window->window_field == NULL) {                                                   \
@@ -101,7 +105,8 @@ bool match_matches_window(Match *match, i3Window *window) {
                 focused && focused->window && focused->window->window_field &&                    \
                 strcmp(window_field_str, GET_FIELD_##type(focused->window->window_field)) == 0) { \
                 LOG("window " #match_field " matches focused window\n");                          \
-            } else if (regex_matches(match->match_field, window_field_str)) {                     \
+            } else if (MATCHES_##type(match->match_field, window_field_str,                       \
+                                      &(window->regex_cache), window->generation)) {              \
                 LOG("window " #match_field " matches (%s)\n", window_field_str);                  \
             } else {                                                                              \
                 return false;                                                                     \
@@ -109,8 +114,8 @@ bool match_matches_window(Match *match, i3Window *window) {
         }                                                                                         \
     } while (0)
 
-    CHECK_WINDOW_FIELD(class, class_class, str);
-    CHECK_WINDOW_FIELD(instance, class_instance, str);
+    CHECK_WINDOW_FIELD(class, class_class, str, class_generation);
+    CHECK_WINDOW_FIELD(instance, class_instance, str, class_generation);
 
     if (match->id != XCB_NONE) {
         if (window->id == match->id) {
@@ -121,8 +126,8 @@ bool match_matches_window(Match *match, i3Window *window) {
         }
     }
 
-    CHECK_WINDOW_FIELD(title, name, i3string);
-    CHECK_WINDOW_FIELD(window_role, role, str);
+    CHECK_WINDOW_FIELD(title, name, i3string, name_generation);
+    CHECK_WINDOW_FIELD(window_role, role, str, role_generation);
 
     if (match->window_type != UINT32_MAX) {
         if (window->window_type == match->window_type) {
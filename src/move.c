@@ -9,6 +9,21 @@
  */
 #include "all.h"
 
+/*
+ * Returns the closest ancestor of con which stays in the tree when con is
+ * moved away: split containers which only hold con are closed once it is gone
+ * (see con_on_remove_child()). The redundant split containers left behind by
+ * the move can only be found from there on upwards (see tree_flatten_around()).
+ *
+ */
+static Con *flatten_anchor(Con *con) {
+    Con *anchor = con->parent;
+    while (anchor->type == CT_CON && con_num_children(anchor) == 1 &&
+           anchor->parent != NULL && anchor->parent->type != CT_OUTPUT)
+        anchor = anchor->parent;
+    return anchor;
+}
+
 /*
  * Returns the lowest container in the tree that has both a and b as descendants.
  *
@@ -160,6 +175,9 @@ void insert_con_into(Con *con, Con *target, position_t position) {
     } else if (position == AFTER) {
         TAILQ_INSERT_AFTER(&(parent->nodes_head), target, con, nodes);
     }
+    parent->num_children++;
+    con_invalidate_tree_representation(parent);
+    con_count_urgency(con);
 
     /* Pretend the con was just opened with regards to size percent values.
      * Since the con is moved to a completely different con, the old value
@@ -187,6 +205,9 @@ static void attach_to_workspace(Con *con, Con *ws, direction_t direction) {
         TAILQ_INSERT_TAIL(&(ws->nodes_head), con, nodes);
     }
     TAILQ_INSERT_TAIL(&(ws->focus_head), con, focused);
+    ws->num_children++;
+    con_invalidate_tree_representation(ws);
+    con_count_urgency(con);
 
     /* Pretend the con was just opened with regards to size percent values.
      * Since the con is moved to a completely different con, the old value
@@ -221,6 +242,7 @@ static void move_to_output_directed(Con *con, direction_t direction) {
     }
 
     Con *old_ws = con_get_workspace(con);
+    Con *old_anchor = flatten_anchor(con);
     const bool moves_focus = (focused == con);
     attach_to_workspace(con, ws, direction);
     if (moves_focus) {
@@ -236,8 +258,10 @@ static void move_to_output_directed(Con *con, direction_t direction) {
 
     /* force re-painting the indicators */
     FREE(con->deco_render_params);
+    con_set_dirty(con);
 
-    tree_flatten(croot);
+    tree_flatten_around(old_anchor);
+    tree_flatten_around(con);
     ipc_send_window_event("move", con);
     ewmh_update_wm_desktop();
 }
@@ -273,6 +297,7 @@ void tree_move(Con *con, int direction) {
     }
 
     orientation_t o = orientation_from_direction(direction);
+    Con *old_anchor = flatten_anchor(con);
 
     Con *same_orientation = con_parent_with_orientation(con, o);
     /* The do {} while is used to 'restart' at this point with a different
@@ -321,6 +346,7 @@ void tree_move(Con *con, int direction) {
                 } else {
                     TAILQ_SWAP(con, swap, &(swap->parent->nodes_head), nodes);
                 }
+                con_invalidate_tree_representation(swap->parent);
 
                 ipc_send_window_event("move", con);
                 return;
@@ -384,8 +410,12 @@ void tree_move(Con *con, int direction) {
 end:
     /* force re-painting the indicators */
     FREE(con->deco_render_params);
+    con_set_dirty(con);
 
-    tree_flatten(croot);
+    /* Only the split containers around the old and the new position of con
+     * can have become redundant. */
+    tree_flatten_around(old_anchor);
+    tree_flatten_around(con);
     ipc_send_window_event("move", con);
     ewmh_update_wm_desktop();
 }
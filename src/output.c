@@ -60,6 +60,40 @@ Output *get_output_for_con(Con *con) {
     return output;
 }
 
+/* A floating container with a sticky window, and where it was found in the
+ * focus stacks of the outputs, its workspace and itself. */
+struct sticky_floating_con {
+    Con *con;
+    int output_position;
+    int workspace_position;
+    int position;
+};
+
+/*
+ * Returns the position of the given container in the focus stack of its
+ * parent.
+ *
+ */
+static int focus_position(Con *con) {
+    int position = 0;
+    Con *current;
+    TAILQ_FOREACH(current, &(con->parent->focus_head), focused) {
+        if (current == con)
+            break;
+        position++;
+    }
+    return position;
+}
+
+static int sticky_floating_con_cmp(const void *a, const void *b) {
+    const struct sticky_floating_con *first = a, *second = b;
+    if (first->output_position != second->output_position)
+        return (first->output_position < second->output_position ? -1 : 1);
+    if (first->workspace_position != second->workspace_position)
+        return (first->workspace_position < second->workspace_position ? -1 : 1);
+    return (first->position < second->position ? -1 : (first->position > second->position));
+}
+
 /*
  * Iterates over all outputs and pushes sticky windows to the currently visible
  * workspace on that output.
@@ -73,40 +107,60 @@ Output *get_output_for_con(Con *con) {
  *
  */
 void output_push_sticky_windows(Con *old_focus) {
-    Con *output;
-    TAILQ_FOREACH(output, &(croot->focus_head), focused) {
-        Con *workspace, *visible_ws = NULL;
-        GREP_FIRST(visible_ws, output_get_content(output), workspace_is_visible(child));
-
-        /* We use this loop instead of TAILQ_FOREACH to avoid problems if the
-         * sticky window was the last window on that workspace as moving it in
-         * this case will close the workspace. */
-        for (workspace = TAILQ_FIRST(&(output_get_content(output)->focus_head));
-             workspace != TAILQ_END(&(output_get_content(output)->focus_head));) {
-            Con *current_ws = workspace;
-            workspace = TAILQ_NEXT(workspace, focused);
-
-            /* Since moving the windows actually removes them from the list of
-             * floating windows on this workspace, here too we need to use
-             * another loop than TAILQ_FOREACH. */
-            Con *child;
-            for (child = TAILQ_FIRST(&(current_ws->focus_head));
-                 child != TAILQ_END(&(current_ws->focus_head));) {
-                Con *current = child;
-                child = TAILQ_NEXT(child, focused);
-                if (current->type != CT_FLOATING_CON || !con_is_sticky(current)) {
-                    continue;
-                }
-
-                bool ignore_focus = (old_focus == NULL) || (current != old_focus->parent);
-                con_move_to_workspace(current, visible_ws, true, false, ignore_focus);
-                if (!ignore_focus) {
-                    Con *current_ws = con_get_workspace(focused);
-                    con_activate(con_descend_focused(current));
-                    /* Pushing sticky windows shouldn't change the focused workspace. */
-                    con_activate(con_descend_focused(current_ws));
-                }
-            }
+    if (TAILQ_EMPTY(&sticky_cons))
+        return;
+
+    /* Collect the floating containers holding a sticky container before moving
+     * anything. They are pushed in the order in which walking the focus stacks
+     * of all outputs and workspaces would find them. */
+    int num = 0, size = 0;
+    struct sticky_floating_con *floating_cons = NULL;
+    Con *sticky;
+    TAILQ_FOREACH(sticky, &sticky_cons, sticky_cons) {
+        Con *floating_con = sticky;
+        while (floating_con != NULL && floating_con->type != CT_FLOATING_CON)
+            floating_con = floating_con->parent;
+        if (floating_con == NULL || floating_con->parent == NULL ||
+            floating_con->parent->type != CT_WORKSPACE)
+            continue;
+
+        bool duplicate = false;
+        for (int i = 0; i < num && !duplicate; i++)
+            duplicate = (floating_cons[i].con == floating_con);
+        if (duplicate)
+            continue;
+
+        Con *workspace = floating_con->parent;
+        Con *output = con_get_output(workspace);
+        if (output == NULL || output->parent != croot)
+            continue;
+
+        if (num == size) {
+            size = (size == 0 ? 4 : size * 2);
+            floating_cons = srealloc(floating_cons, size * sizeof(struct sticky_floating_con));
+        }
+        floating_cons[num].con = floating_con;
+        floating_cons[num].output_position = focus_position(output);
+        floating_cons[num].workspace_position = focus_position(workspace);
+        floating_cons[num].position = focus_position(floating_con);
+        num++;
+    }
+    if (num > 1)
+        qsort(floating_cons, num, sizeof(struct sticky_floating_con), sticky_floating_con_cmp);
+
+    for (int i = 0; i < num; i++) {
+        Con *current = floating_cons[i].con;
+        Con *visible_ws = NULL;
+        GREP_FIRST(visible_ws, output_get_content(con_get_output(current)), workspace_is_visible(child));
+
+        bool ignore_focus = (old_focus == NULL) || (current != old_focus->parent);
+        con_move_to_workspace(current, visible_ws, true, false, ignore_focus);
+        if (!ignore_focus) {
+            Con *current_ws = con_get_workspace(focused);
+            con_activate(con_descend_focused(current));
+            /* Pushing sticky windows shouldn't change the focused workspace. */
+            con_activate(con_descend_focused(current_ws));
         }
     }
+    free(floating_cons);
 }
@@ -9,6 +9,7 @@
  * (take your time to read it completely, it answers all questions).
  *
  */
+#define LOG_CATEGORY LOG_CATEGORY_RANDR
 #include "all.h"
 
 #include <time.h>
@@ -105,24 +106,188 @@ static bool any_randr_output_active(void) {
     return false;
 }
 
+/* Spatial index of the active outputs, used by get_output_containing(),
+ * output_containing_rect() and get_output_next(). It is rebuilt on the next
+ * lookup after output_index_invalidate().
+ *
+ * The distinct left/right edges (xs) and top/bottom edges (ys) of all active
+ * outputs split the screen into a grid. Every cell stores the first active
+ * output (in list order, like a linear search would find it) covering the
+ * cell, or NULL. by_x and by_y contain the active outputs sorted by their x
+ * and y coordinate respectively (ties in list order). */
+static struct {
+    uint32_t *xs;
+    uint32_t *ys;
+    int num_xs;
+    int num_ys;
+    Output **cells;
+
+    Output **by_x;
+    Output **by_y;
+    int num_outputs;
+
+    bool valid;
+} output_index;
+
 /*
- * Returns the active (!) output which contains the coordinates x, y or NULL
- * if there is no output which contains these coordinates.
+ * Marks the output index as outdated.
  *
  */
-Output *get_output_containing(unsigned int x, unsigned int y) {
+void output_index_invalidate(void) {
+    output_index.valid = false;
+}
+
+/*
+ * Returns the index of the last value <= value in the sorted array, or -1.
+ *
+ */
+static int find_edge(const uint32_t *values, int num, uint32_t value) {
+    int low = 0, high = num;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (values[mid] <= value)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low - 1;
+}
+
+/*
+ * Inserts value into the sorted array of num values, unless it already
+ * contains it.
+ *
+ */
+static void insert_edge(uint32_t *values, int *num, uint32_t value) {
+    const int i = find_edge(values, *num, value);
+    if (i >= 0 && values[i] == value)
+        return;
+    memmove(&values[i + 2], &values[i + 1], (*num - i - 1) * sizeof(uint32_t));
+    values[i + 1] = value;
+    (*num)++;
+}
+
+/*
+ * Inserts output into the array of num outputs, sorted by the coordinate
+ * returned by key. Outputs with the same coordinate stay in list order.
+ *
+ */
+static void insert_sorted(Output **sorted, int num, Output *output, uint32_t (*key)(Output *)) {
+    int i = num;
+    while (i > 0 && key(sorted[i - 1]) > key(output)) {
+        sorted[i] = sorted[i - 1];
+        i--;
+    }
+    sorted[i] = output;
+}
+
+static uint32_t output_x(Output *output) {
+    return output->rect.x;
+}
+
+static uint32_t output_y(Output *output) {
+    return output->rect.y;
+}
+
+/*
+ * Returns the number of outputs in the sorted array whose coordinate (as
+ * returned by key) is less than value (or equal to it, if inclusive).
+ *
+ */
+static int count_outputs_before(Output **sorted, int num, uint32_t value, bool inclusive, uint32_t (*key)(Output *)) {
+    int low = 0, high = num;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (key(sorted[mid]) < value || (inclusive && key(sorted[mid]) == value))
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+static void output_index_rebuild(void) {
     Output *output;
+    int num_outputs = 0;
+    TAILQ_FOREACH(output, &outputs, outputs) {
+        if (output->active)
+            num_outputs++;
+    }
+
+    FREE(output_index.xs);
+    FREE(output_index.ys);
+    FREE(output_index.cells);
+    FREE(output_index.by_x);
+    FREE(output_index.by_y);
+    output_index.num_xs = 0;
+    output_index.num_ys = 0;
+    output_index.num_outputs = 0;
+    output_index.valid = true;
+
+    if (num_outputs == 0)
+        return;
+
+    output_index.xs = smalloc(2 * num_outputs * sizeof(uint32_t));
+    output_index.ys = smalloc(2 * num_outputs * sizeof(uint32_t));
+    output_index.by_x = smalloc(num_outputs * sizeof(Output *));
+    output_index.by_y = smalloc(num_outputs * sizeof(Output *));
+
     TAILQ_FOREACH(output, &outputs, outputs) {
         if (!output->active)
             continue;
-        DLOG("comparing x=%d y=%d with x=%d and y=%d width %d height %d\n",
-             x, y, output->rect.x, output->rect.y, output->rect.width, output->rect.height);
-        if (x >= output->rect.x && x < (output->rect.x + output->rect.width) &&
-            y >= output->rect.y && y < (output->rect.y + output->rect.height))
-            return output;
+        insert_edge(output_index.xs, &output_index.num_xs, output->rect.x);
+        insert_edge(output_index.xs, &output_index.num_xs, output->rect.x + output->rect.width);
+        insert_edge(output_index.ys, &output_index.num_ys, output->rect.y);
+        insert_edge(output_index.ys, &output_index.num_ys, output->rect.y + output->rect.height);
+        insert_sorted(output_index.by_x, output_index.num_outputs, output, output_x);
+        insert_sorted(output_index.by_y, output_index.num_outputs, output, output_y);
+        output_index.num_outputs++;
     }
 
-    return NULL;
+    const int columns = output_index.num_xs - 1;
+    const int rows = output_index.num_ys - 1;
+    output_index.cells = scalloc(max(columns * rows, 1), sizeof(Output *));
+
+    /* Fill in the outputs in reverse list order, so that the first output
+     * covering a cell ends up in it. */
+    TAILQ_FOREACH_REVERSE(output, &outputs, outputs_head, outputs) {
+        if (!output->active || output->rect.width == 0 || output->rect.height == 0)
+            continue;
+        const int left = find_edge(output_index.xs, output_index.num_xs, output->rect.x);
+        const int right = find_edge(output_index.xs, output_index.num_xs, output->rect.x + output->rect.width);
+        const int top = find_edge(output_index.ys, output_index.num_ys, output->rect.y);
+        const int bottom = find_edge(output_index.ys, output_index.num_ys, output->rect.y + output->rect.height);
+        for (int row = top; row < bottom; row++) {
+            for (int column = left; column < right; column++) {
+                output_index.cells[row * columns + column] = output;
+            }
+        }
+    }
+
+    DLOG("Rebuilt the output index: %d active outputs, %d x %d cells\n",
+         output_index.num_outputs, columns, rows);
+}
+
+static void output_index_ensure(void) {
+    if (!output_index.valid)
+        output_index_rebuild();
+}
+
+/*
+ * Returns the active (!) output which contains the coordinates x, y or NULL
+ * if there is no output which contains these coordinates.
+ *
+ */
+Output *get_output_containing(unsigned int x, unsigned int y) {
+    output_index_ensure();
+
+    const int column = find_edge(output_index.xs, output_index.num_xs, x);
+    const int row = find_edge(output_index.ys, output_index.num_ys, y);
+    if (column < 0 || column >= output_index.num_xs - 1 ||
+        row < 0 || row >= output_index.num_ys - 1)
+        return NULL;
+
+    return output_index.cells[row * (output_index.num_xs - 1) + column];
 }
 
 /*
@@ -168,26 +333,40 @@ Output *get_output_with_dimensions(Rect rect) {
  *
  */
 Output *output_containing_rect(Rect rect) {
-    Output *output;
+    output_index_ensure();
+
     int lx = rect.x, uy = rect.y;
     int rx = rect.x + rect.width, by = rect.y + rect.height;
+    if (output_index.num_outputs == 0 || lx >= rx || uy >= by)
+        return NULL;
+
+    /* Only the outputs in the grid cells which the rect overlaps can
+     * intersect it. */
+    const int columns = output_index.num_xs - 1;
+    const int left = max(find_edge(output_index.xs, output_index.num_xs, (uint32_t)max(lx, 0)), 0);
+    const int right = min(find_edge(output_index.xs, output_index.num_xs, (uint32_t)max(rx - 1, 0)), columns - 1);
+    const int top = max(find_edge(output_index.ys, output_index.num_ys, (uint32_t)max(uy, 0)), 0);
+    const int bottom = min(find_edge(output_index.ys, output_index.num_ys, (uint32_t)max(by - 1, 0)), output_index.num_ys - 2);
+
     long max_area = 0;
     Output *result = NULL;
-    TAILQ_FOREACH(output, &outputs, outputs) {
-        if (!output->active)
-            continue;
-        int lx_o = (int)output->rect.x, uy_o = (int)output->rect.y;
-        int rx_o = (int)(output->rect.x + output->rect.width), by_o = (int)(output->rect.y + output->rect.height);
-        DLOG("comparing x=%d y=%d with x=%d and y=%d width %d height %d\n",
-             rect.x, rect.y, output->rect.x, output->rect.y, output->rect.width, output->rect.height);
-        int left = max(lx, lx_o);
-        int right = min(rx, rx_o);
-        int bottom = min(by, by_o);
-        int top = max(uy, uy_o);
-        if (left < right && bottom > top) {
-            long area = (right - left) * (bottom - top);
-            if (area > max_area) {
-                result = output;
+    for (int row = top; row <= bottom; row++) {
+        for (int column = left; column <= right; column++) {
+            Output *output = output_index.cells[row * columns + column];
+            if (output == NULL || output == result)
+                continue;
+            int lx_o = (int)output->rect.x, uy_o = (int)output->rect.y;
+            int rx_o = (int)(output->rect.x + output->rect.width), by_o = (int)(output->rect.y + output->rect.height);
+            int left_edge = max(lx, lx_o);
+            int right_edge = min(rx, rx_o);
+            int bottom_edge = min(by, by_o);
+            int top_edge = max(uy, uy_o);
+            if (left_edge < right_edge && bottom_edge > top_edge) {
+                long area = (long)(right_edge - left_edge) * (bottom_edge - top_edge);
+                if (area > max_area) {
+                    max_area = area;
+                    result = output;
+                }
             }
         }
     }
@@ -237,60 +416,53 @@ Output *get_output_next_wrap(direction_t direction, Output *current) {
  *
  */
 Output *get_output_next(direction_t direction, Output *current, output_close_far_t close_far) {
-    Rect *cur = &(current->rect),
-         *other;
-    Output *output,
-        *best = NULL;
-    TAILQ_FOREACH(output, &outputs, outputs) {
-        if (!output->active)
-            continue;
-
-        other = &(output->rect);
+    output_index_ensure();
+
+    Rect *cur = &(current->rect);
+    const bool horizontal = (direction == D_LEFT || direction == D_RIGHT);
+    Output **sorted = (horizontal ? output_index.by_x : output_index.by_y);
+    uint32_t (*key)(Output *) = (horizontal ? output_x : output_y);
+    const uint32_t position = key(current);
+
+    /* The candidates are the outputs to the right of (below) the current one
+     * or to the left of (above) it. */
+    int first, last;
+    if (direction == D_RIGHT || direction == D_DOWN) {
+        first = count_outputs_before(sorted, output_index.num_outputs, position, true, key);
+        last = output_index.num_outputs - 1;
+    } else {
+        first = 0;
+        last = count_outputs_before(sorted, output_index.num_outputs, position, false, key) - 1;
+    }
 
-        if ((direction == D_RIGHT && other->x > cur->x) ||
-            (direction == D_LEFT && other->x < cur->x)) {
+    /* Walk away from (or towards) the current output, so that the first
+     * output which overlaps it is the closest (farthest) one. */
+    const bool forward = ((direction == D_RIGHT || direction == D_DOWN) == (close_far == CLOSEST_OUTPUT));
+    Output *best = NULL;
+    for (int i = (forward ? first : last); i >= first && i <= last; i += (forward ? 1 : -1)) {
+        Output *output = sorted[i];
+        /* Among outputs at the same position, the first one in list order
+         * wins. Walking backwards, those come last. */
+        if (best && key(output) != key(best))
+            break;
+
+        Rect *other = &(output->rect);
+        if (horizontal) {
             /* Skip the output when it doesn’t overlap the other one’s y
              * coordinate at all. */
             if ((other->y + other->height) <= cur->y ||
                 (cur->y + cur->height) <= other->y)
                 continue;
-        } else if ((direction == D_DOWN && other->y > cur->y) ||
-                   (direction == D_UP && other->y < cur->y)) {
+        } else {
             /* Skip the output when it doesn’t overlap the other one’s x
              * coordinate at all. */
             if ((other->x + other->width) <= cur->x ||
                 (cur->x + cur->width) <= other->x)
                 continue;
-        } else
-            continue;
-
-        /* No candidate yet? Start with this one. */
-        if (!best) {
-            best = output;
-            continue;
         }
 
-        if (close_far == CLOSEST_OUTPUT) {
-            /* Is this output better (closer to the current output) than our
-             * current best bet? */
-            if ((direction == D_RIGHT && other->x < best->rect.x) ||
-                (direction == D_LEFT && other->x > best->rect.x) ||
-                (direction == D_DOWN && other->y < best->rect.y) ||
-                (direction == D_UP && other->y > best->rect.y)) {
-                best = output;
-                continue;
-            }
-        } else {
-            /* Is this output better (farther to the current output) than our
-             * current best bet? */
-            if ((direction == D_RIGHT && other->x > best->rect.x) ||
-                (direction == D_LEFT && other->x < best->rect.x) ||
-                (direction == D_DOWN && other->y > best->rect.y) ||
-                (direction == D_UP && other->y < best->rect.y)) {
-                best = output;
-                continue;
-            }
-        }
+        if (!best || !forward)
+            best = output;
     }
 
     DLOG("current = %s, best = %s\n", output_primary_name(current), (best ? output_primary_name(best) : "NULL"));
@@ -372,6 +544,7 @@ void output_init_con(Output *output) {
     match->dock = M_DOCK_TOP;
     match->insert_where = M_BELOW;
     TAILQ_INSERT_TAIL(&(topdock->swallow_head), match, matches);
+    con_swallow_index_add(topdock, match);
 
     FREE(topdock->name);
     topdock->name = sstrdup("topdock");
@@ -406,6 +579,7 @@ void output_init_con(Output *output) {
     match->dock = M_DOCK_BOTTOM;
     match->insert_where = M_BELOW;
     TAILQ_INSERT_TAIL(&(bottomdock->swallow_head), match, matches);
+    con_swallow_index_add(bottomdock, match);
 
     FREE(bottomdock->name);
     bottomdock->name = sstrdup("bottomdock");
@@ -436,11 +610,9 @@ void init_ws_for_output(Output *output) {
     Con *previous_focus = con_get_workspace(focused);
 
     /* go through all assignments and move the existing workspaces to this output */
-    struct Workspace_Assignment *assignment;
-    TAILQ_FOREACH(assignment, &ws_assignments, ws_assignments) {
-        if (!output_triggers_assignment(output, assignment)) {
-            continue;
-        }
+    struct Workspace_Assignment **assignments = ws_assignments_for_output(output);
+    for (struct Workspace_Assignment **walk = assignments; *walk != NULL; walk++) {
+        struct Workspace_Assignment *assignment = *walk;
         Con *workspace = get_existing_workspace_by_name(assignment->name);
         if (workspace == NULL)
             continue;
@@ -482,14 +654,10 @@ void init_ws_for_output(Output *output) {
     }
 
     /* otherwise, we create the first assigned ws for this output */
-    TAILQ_FOREACH(assignment, &ws_assignments, ws_assignments) {
-        if (!output_triggers_assignment(output, assignment)) {
-            continue;
-        }
-
+    if (assignments[0] != NULL) {
         LOG("Initializing first assigned workspace \"%s\" for output \"%s\"\n",
-            assignment->name, assignment->output);
-        workspace_show_by_name(assignment->name);
+            assignments[0]->name, assignments[0]->output);
+        workspace_show_by_name(assignments[0]->name);
         goto restore_focus;
     }
 
@@ -498,6 +666,7 @@ void init_ws_for_output(Output *output) {
     workspace_show(create_workspace_on_output(output, content));
 
 restore_focus:
+    free(assignments);
     if (previous_focus) {
         workspace_show(previous_focus);
     }
@@ -547,6 +716,7 @@ static void output_change_mode(xcb_connection_t *conn, Output *output) {
             if ((child = TAILQ_FIRST(&(workspace->nodes_head)))) {
                 if (child->layout == L_SPLITV || child->layout == L_SPLITH)
                     child->layout = workspace->layout;
+                con_invalidate_tree_representation(child);
                 DLOG("Setting child [%d,%s]'s layout to %d.\n", child->num, child->name, child->layout);
             }
         }
@@ -592,41 +762,85 @@ static bool randr_query_outputs_15(void) {
          xcb_randr_get_monitors_monitors_length(monitors),
          monitors->timestamp);
 
+    /* Send the requests for all monitor names at once instead of waiting for
+     * each reply in turn. */
+    const int num_monitors = xcb_randr_get_monitors_monitors_length(monitors);
+    xcb_get_atom_name_cookie_t name_cookies[num_monitors];
     xcb_randr_monitor_info_iterator_t iter;
+    int idx = 0;
     for (iter = xcb_randr_get_monitors_monitors_iterator(monitors);
          iter.rem;
          xcb_randr_monitor_info_next(&iter)) {
-        const xcb_randr_monitor_info_t *monitor_info = iter.data;
+        name_cookies[idx++] = xcb_get_atom_name(conn, iter.data->name);
+    }
+
+    char *names[num_monitors];
+    Output *existing[num_monitors];
+    idx = 0;
+    for (iter = xcb_randr_get_monitors_monitors_iterator(monitors);
+         iter.rem;
+         xcb_randr_monitor_info_next(&iter), idx++) {
+        names[idx] = NULL;
+        existing[idx] = NULL;
         xcb_get_atom_name_reply_t *atom_reply =
-            xcb_get_atom_name_reply(
-                conn, xcb_get_atom_name(conn, monitor_info->name), &err);
+            xcb_get_atom_name_reply(conn, name_cookies[idx], &err);
         if (err != NULL) {
             ELOG("Could not get RandR monitor name: X11 error code %d\n", err->error_code);
             free(err);
             continue;
         }
-        char *name;
-        sasprintf(&name, "%.*s",
+        sasprintf(&names[idx], "%.*s",
                   xcb_get_atom_name_name_length(atom_reply),
                   xcb_get_atom_name_name(atom_reply));
         free(atom_reply);
+        existing[idx] = get_output_by_name(names[idx], false);
+    }
 
-        Output *new = get_output_by_name(name, false);
+    /* The associated outputs are only needed for new monitors. Their
+     * information is requested for all new monitors at once, too. */
+    int num_output_cookies = 0;
+    idx = 0;
+    for (iter = xcb_randr_get_monitors_monitors_iterator(monitors);
+         iter.rem;
+         xcb_randr_monitor_info_next(&iter), idx++) {
+        if (names[idx] != NULL && existing[idx] == NULL)
+            num_output_cookies += xcb_randr_monitor_info_outputs_length(iter.data);
+    }
+    xcb_randr_get_output_info_cookie_t output_cookies[num_output_cookies];
+    int cookie_idx = 0;
+    idx = 0;
+    for (iter = xcb_randr_get_monitors_monitors_iterator(monitors);
+         iter.rem;
+         xcb_randr_monitor_info_next(&iter), idx++) {
+        if (names[idx] == NULL || existing[idx] != NULL)
+            continue;
+        xcb_randr_output_t *randr_outputs = xcb_randr_monitor_info_outputs(iter.data);
+        int randr_output_len = xcb_randr_monitor_info_outputs_length(iter.data);
+        for (int i = 0; i < randr_output_len; i++)
+            output_cookies[cookie_idx++] = xcb_randr_get_output_info(conn, randr_outputs[i], monitors->timestamp);
+    }
+
+    cookie_idx = 0;
+    idx = 0;
+    for (iter = xcb_randr_get_monitors_monitors_iterator(monitors);
+         iter.rem;
+         xcb_randr_monitor_info_next(&iter), idx++) {
+        const xcb_randr_monitor_info_t *monitor_info = iter.data;
+        char *name = names[idx];
+        if (name == NULL)
+            continue;
+
+        Output *new = existing[idx];
         if (new == NULL) {
             new = scalloc(1, sizeof(Output));
 
             SLIST_INIT(&new->names_head);
 
             /* Register associated output names in addition to the monitor name */
-            xcb_randr_output_t *randr_outputs = xcb_randr_monitor_info_outputs(monitor_info);
             int randr_output_len = xcb_randr_monitor_info_outputs_length(monitor_info);
             for (int i = 0; i < randr_output_len; i++) {
-                xcb_randr_output_t randr_output = randr_outputs[i];
-
                 xcb_randr_get_output_info_reply_t *info =
-                    xcb_randr_get_output_info_reply(conn,
-                                                    xcb_randr_get_output_info(conn, randr_output, monitors->timestamp),
-                                                    NULL);
+                    xcb_randr_get_output_info_reply(conn, output_cookies[cookie_idx++], NULL);
 
                 if (info != NULL && info->crtc != XCB_NONE) {
                     char *oname;
@@ -681,6 +895,31 @@ static bool randr_query_outputs_15(void) {
 #endif
 }
 
+/*
+ * Returns the refresh rate (in Hz) of the mode with the given id, or 0 if the
+ * mode cannot be found.
+ *
+ */
+static double mode_refresh_rate(xcb_randr_get_screen_resources_current_reply_t *res, xcb_randr_mode_t mode) {
+    xcb_randr_mode_info_t *modes = xcb_randr_get_screen_resources_current_modes(res);
+    const int len = xcb_randr_get_screen_resources_current_modes_length(res);
+    for (int i = 0; i < len; i++) {
+        if (modes[i].id != mode)
+            continue;
+
+        double vtotal = modes[i].vtotal;
+        if (modes[i].mode_flags & XCB_RANDR_MODE_FLAG_DOUBLE_SCAN)
+            vtotal *= 2;
+        if (modes[i].mode_flags & XCB_RANDR_MODE_FLAG_INTERLACE)
+            vtotal /= 2;
+        if (modes[i].htotal == 0 || vtotal == 0)
+            return 0;
+
+        return modes[i].dot_clock / (modes[i].htotal * vtotal);
+    }
+    return 0;
+}
+
 /*
  * Gets called by randr_query_outputs_14() for each output. The function adds
  * new outputs to the list of outputs, checks if the mode of existing outputs
@@ -688,10 +927,13 @@ static bool randr_query_outputs_15(void) {
  * change either the "changed" or the "to_be_deleted" flag of the output, if
  * appropriate.
  *
+ * icookie is the (already sent) request for the CRTC of the output, unless
+ * the output has no CRTC.
+ *
  */
 static void handle_output(xcb_connection_t *conn, xcb_randr_output_t id,
                           xcb_randr_get_output_info_reply_t *output,
-                          xcb_timestamp_t cts,
+                          xcb_randr_get_crtc_info_cookie_t icookie,
                           xcb_randr_get_screen_resources_current_reply_t *res) {
     /* each CRT controller has a position in which we are interested in */
     xcb_randr_get_crtc_info_reply_t *crtc;
@@ -732,8 +974,6 @@ static void handle_output(xcb_connection_t *conn, xcb_randr_output_t id,
         return;
     }
 
-    xcb_randr_get_crtc_info_cookie_t icookie;
-    icookie = xcb_randr_get_crtc_info(conn, output->crtc, cts);
     if ((crtc = xcb_randr_get_crtc_info_reply(conn, icookie, NULL)) == NULL) {
         DLOG("Skipping output %s: could not get CRTC (%p)\n",
              output_primary_name(new), crtc);
@@ -745,6 +985,7 @@ static void handle_output(xcb_connection_t *conn, xcb_randr_output_t id,
                    update_if_necessary(&(new->rect.y), crtc->y) |
                    update_if_necessary(&(new->rect.width), crtc->width) |
                    update_if_necessary(&(new->rect.height), crtc->height);
+    new->refresh_rate = mode_refresh_rate(res, crtc->mode);
     free(crtc);
     new->active = (new->rect.width != 0 && new->rect.height != 0);
     if (!new->active) {
@@ -810,15 +1051,23 @@ static void randr_query_outputs_14(void) {
     for (int i = 0; i < len; i++)
         ocookie[i] = xcb_randr_get_output_info(conn, randr_outputs[i], cts);
 
-    /* Loop through all outputs available for this X11 screen */
+    /* Request the CRTC of each output as soon as its information arrives, so
+     * that all CRTC replies are in flight at once, too. */
+    xcb_randr_get_output_info_reply_t *output_replies[len];
+    xcb_randr_get_crtc_info_cookie_t icookie[len];
     for (int i = 0; i < len; i++) {
-        xcb_randr_get_output_info_reply_t *output;
+        output_replies[i] = xcb_randr_get_output_info_reply(conn, ocookie[i], NULL);
+        if (output_replies[i] != NULL && output_replies[i]->crtc != XCB_NONE)
+            icookie[i] = xcb_randr_get_crtc_info(conn, output_replies[i]->crtc, cts);
+    }
 
-        if ((output = xcb_randr_get_output_info_reply(conn, ocookie[i], NULL)) == NULL)
+    /* Loop through all outputs available for this X11 screen */
+    for (int i = 0; i < len; i++) {
+        if (output_replies[i] == NULL)
             continue;
 
-        handle_output(conn, randr_outputs[i], output, cts, res);
-        free(output);
+        handle_output(conn, randr_outputs[i], output_replies[i], icookie[i], res);
+        free(output_replies[i]);
     }
 
     FREE(res);
@@ -829,13 +1078,29 @@ static void randr_query_outputs_14(void) {
  *
  * If no outputs are found use the root window.
  *
+ * Only outputs which changed are reconfigured. Returns true if anything
+ * changed (and the tree was rendered), false otherwise.
+ *
  */
-void randr_query_outputs(void) {
+bool randr_query_outputs(void) {
     Output *output, *other;
 
+    /* Whether anything (an output’s geometry, which outputs are enabled, or
+     * the primary output) changed since the last query. If not, there is
+     * nothing to re-render. */
+    bool reconfigured = false;
+    Output *old_primary = NULL;
+    TAILQ_FOREACH(output, &outputs, outputs) {
+        if (output->active && output->primary) {
+            old_primary = output;
+            break;
+        }
+    }
+
     if (!randr_query_outputs_15()) {
         randr_query_outputs_14();
     }
+    output_index_invalidate();
 
     /* If there's no randr output, enable the output covering the root window. */
     if (any_randr_output_active()) {
@@ -846,6 +1111,7 @@ void randr_query_outputs(void) {
     } else {
         DLOG("No active RandR output found. Enabling root output.\n");
         root_output->active = true;
+        output_index_invalidate();
     }
 
     /* Check for clones, disable the clones and reduce the mode to the
@@ -884,6 +1150,7 @@ void randr_query_outputs(void) {
             DLOG("new output mode %d x %d, other mode %d x %d\n",
                  output->rect.width, output->rect.height,
                  other->rect.width, other->rect.height);
+            output_index_invalidate();
         }
     }
 
@@ -896,6 +1163,7 @@ void randr_query_outputs(void) {
             DLOG("Need to initialize a Con for output %s\n", output_primary_name(output));
             output_init_con(output);
             output->changed = false;
+            reconfigured = true;
         }
     }
 
@@ -904,11 +1172,13 @@ void randr_query_outputs(void) {
     TAILQ_FOREACH(output, &outputs, outputs) {
         if (output->to_be_disabled) {
             randr_disable_output(output);
+            reconfigured = true;
         }
 
         if (output->changed) {
             output_change_mode(conn, output);
             output->changed = false;
+            reconfigured = true;
         }
     }
 
@@ -921,6 +1191,20 @@ void randr_query_outputs(void) {
             continue;
         DLOG("Should add ws for output %s\n", output_primary_name(output));
         init_ws_for_output(output);
+        reconfigured = true;
+    }
+
+    Output *new_primary = NULL;
+    TAILQ_FOREACH(output, &outputs, outputs) {
+        if (output->active && output->primary) {
+            new_primary = output;
+            break;
+        }
+    }
+    if (!reconfigured && new_primary == old_primary) {
+        DLOG("RandR configuration unchanged, not re-rendering\n");
+        FREE(primary);
+        return false;
     }
 
     /* Focus the primary screen, if possible */
@@ -938,6 +1222,7 @@ void randr_query_outputs(void) {
     tree_render();
 
     FREE(primary);
+    return true;
 }
 
 /*
@@ -948,6 +1233,7 @@ void randr_disable_output(Output *output) {
     assert(output->to_be_disabled);
 
     output->active = false;
+    output_index_invalidate();
     DLOG("Output %s disabled, re-assigning workspaces/docks\n", output_primary_name(output));
 
     Output *first = get_first_output();
@@ -1026,6 +1312,7 @@ void randr_disable_output(Output *output) {
 
 static void fallback_to_root_output(void) {
     root_output->active = true;
+    output_index_invalidate();
     output_init_con(root_output);
     init_ws_for_output(root_output);
 }
@@ -11,9 +11,10 @@
 
 /*
  * Creates a new 'regex' struct containing the given pattern and a PCRE
- * compiled regular expression. Also, calls pcre_study because this regex will
- * most likely be used often (like for every new window and on every relevant
- * property change of existing windows).
+ * compiled regular expression. Also, calls pcre_study (JIT-compiling the
+ * regex if libpcre supports it) because this regex will most likely be used
+ * often (like for every new window and on every relevant property change of
+ * existing windows).
  *
  * Returns NULL if the pattern could not be compiled into a regular expression
  * (and ELOGs an appropriate error message).
@@ -41,13 +42,27 @@ struct regex *regex_new(const char *pattern) {
         regex_free(re);
         return NULL;
     }
-    re->extra = pcre_study(re->regex, 0, &error);
+    int study_options = 0;
+#ifdef PCRE_STUDY_JIT_COMPILE
+    /* Use the JIT compiler if libpcre was built with it. Otherwise, this
+     * option is silently ignored. */
+    study_options |= PCRE_STUDY_JIT_COMPILE;
+#endif
+    re->extra = pcre_study(re->regex, study_options, &error);
     /* If an error happened, we print the error message, but continue.
      * Studying the regular expression leads to faster matching, but it’s not
      * absolutely necessary. */
     if (error) {
         ELOG("PCRE regular expression studying failed: %s\n", error);
     }
+
+    static uint32_t last_id = 0;
+    re->id = ++last_id;
+
+    const char *literal;
+    size_t len;
+    if (regex_exact_literal(re, &literal, &len))
+        re->literal = intern_string(literal, len);
     return re;
 }
 
@@ -58,9 +73,19 @@ struct regex *regex_new(const char *pattern) {
 void regex_free(struct regex *regex) {
     if (!regex)
         return;
+    intern_release(regex->literal);
     FREE(regex->pattern);
     FREE(regex->regex);
+#ifdef PCRE_STUDY_JIT_COMPILE
+    /* JIT-compiled code has to be freed with pcre_free_study(), which was
+     * added in the same libpcre version (8.20). */
+    if (regex->extra != NULL) {
+        pcre_free_study(regex->extra);
+        regex->extra = NULL;
+    }
+#else
     FREE(regex->extra);
+#endif
     FREE(regex);
 }
 
@@ -91,3 +116,87 @@ bool regex_matches(struct regex *regex, const char *input) {
          rc, regex->pattern, input);
     return false;
 }
+
+/*
+ * Returns true if the given part of a pattern only matches itself, i.e. does
+ * not contain any characters with a special meaning for PCRE.
+ *
+ */
+bool regex_is_literal(const char *pattern, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (strchr("\\^$.|?*+()[]{}", pattern[i]) != NULL)
+            return false;
+    }
+    return true;
+}
+
+/*
+ * Returns true if the given regular expression is an anchored literal
+ * (^literal$), which only matches the literal itself (and the literal followed
+ * by a newline, since $ also matches before a trailing newline). The literal
+ * is stored in *literal and its length in *len; it is not NUL-terminated.
+ *
+ */
+bool regex_exact_literal(struct regex *regex, const char **literal, size_t *len) {
+    const char *pattern = regex->pattern;
+    const size_t pattern_len = strlen(pattern);
+    if (pattern_len < 2 || pattern[0] != '^' || pattern[pattern_len - 1] != '$' ||
+        !regex_is_literal(pattern + 1, pattern_len - 2))
+        return false;
+    *literal = pattern + 1;
+    *len = pattern_len - 2;
+    return true;
+}
+
+/*
+ * Like regex_matches(), but remembers the result in the given cache. The
+ * generation identifies the value of input: as long as the caller passes the
+ * same generation, input is assumed to be unchanged and the cached result is
+ * returned without running the regular expression again.
+ *
+ */
+bool regex_matches_cached(struct regex *regex, const char *input, struct regex_cache *cache, uint32_t generation) {
+    for (int i = 0; i < REGEX_CACHE_SIZE; i++) {
+        struct regex_cache_entry *entry = &(cache->entries[i]);
+        if (entry->regex_id == regex->id && entry->generation == generation) {
+            LOG("Regular expression \"%s\" %s \"%s\" (cached)\n",
+                regex->pattern, (entry->matches ? "matches" : "does not match"), input);
+            return entry->matches;
+        }
+    }
+
+    const bool matches = regex_matches(regex, input);
+    struct regex_cache_entry *entry = &(cache->entries[cache->next]);
+    cache->next = (cache->next + 1) % REGEX_CACHE_SIZE;
+    entry->regex_id = regex->id;
+    entry->generation = generation;
+    entry->matches = matches;
+    return matches;
+}
+
+/*
+ * Like regex_matches_cached(), but for an interned input (see
+ * intern_string()). If the regular expression is an anchored literal, the
+ * input matches exactly if it is the interned literal, so no regular
+ * expression has to be run.
+ *
+ */
+bool regex_matches_interned(struct regex *regex, const char *input, struct regex_cache *cache, uint32_t generation) {
+    if (regex->literal == NULL)
+        return regex_matches_cached(regex, input, cache, generation);
+
+    if (input == regex->literal) {
+        LOG("Regular expression \"%s\" matches \"%s\" (interned)\n",
+            regex->pattern, input);
+        return true;
+    }
+
+    /* $ also matches right before a newline at the end of the subject. */
+    const size_t len = strlen(input);
+    if (len > 0 && input[len - 1] == '\n')
+        return regex_matches_cached(regex, input, cache, generation);
+
+    LOG("Regular expression \"%s\" does not match \"%s\" (interned)\n",
+        regex->pattern, input);
+    return false;
+}
@@ -8,17 +8,253 @@
  *           various rects. Needs to be pushed to X11 (see x.c) to be visible.
  *
  */
+#define LOG_CATEGORY LOG_CATEGORY_RENDER
 #include "all.h"
 
+#include <pthread.h>
+#include <signal.h>
+
 /* Forward declarations */
 static int *precalculate_sizes(Con *con, render_params *p);
 static void render_root(Con *con, Con *fullscreen);
+static void render_floating_layer(Con *con, Con *global_fullscreen);
 static void render_output(Con *con);
 static void render_con_split(Con *con, Con *child, render_params *p, int i);
 static void render_con_stacked(Con *con, Con *child, render_params *p, int i);
 static void render_con_tabbed(Con *con, Con *child, render_params *p, int i);
 static void render_con_dockarea(Con *con, Con *child, render_params *p);
 
+/* Scratch memory for the current frame, see render_alloc(). Like the other
+ * render state, this is per thread (see render_outputs()). */
+static __thread arena_t *frame_arena;
+/* Whether tree_render() is running, see render_frame_begin(). */
+static __thread bool in_frame;
+/* The recursion depth of render_con(). */
+static __thread int render_depth;
+
+/* The outputs are rendered in parallel if there are at least this many. */
+#define RENDER_PARALLEL_MIN_OUTPUTS 3
+
+/*
+ * Rendering one output, possibly in a worker thread. Everything which is not
+ * confined to the output’s subtree is recorded and done by the main thread
+ * once all outputs are rendered, in output order, so that the result is the
+ * same as when rendering them one after another.
+ *
+ */
+struct render_job {
+    Con *output;
+
+    /* The containers to raise, see render_raise(). */
+    Con **raises;
+    int num_raises;
+    int raises_size;
+
+    log_buffer_t log;
+};
+
+/* The job the current thread is working on, if any. */
+static __thread struct render_job *current_job;
+
+static struct {
+    pthread_mutex_t mutex;
+    /* Signalled when jobs are available. */
+    pthread_cond_t work;
+    /* Signalled when the last job is finished. */
+    pthread_cond_t done;
+    int num_threads;
+
+    struct render_job *jobs;
+    int num_jobs;
+    int next_job;
+    int finished_jobs;
+} pool = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .work = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER,
+};
+
+/*
+ * Raises the container (see x_raise_con()), or records that it needs to be
+ * raised when rendering an output in parallel.
+ *
+ */
+static void render_raise(Con *con) {
+    struct render_job *job = current_job;
+    if (job == NULL) {
+        x_raise_con(con);
+        return;
+    }
+
+    if (job->num_raises == job->raises_size) {
+        job->raises_size = (job->raises_size == 0 ? 64 : job->raises_size * 2);
+        job->raises = srealloc(job->raises, job->raises_size * sizeof(Con *));
+    }
+    job->raises[job->num_raises++] = con;
+}
+
+static void run_job(struct render_job *job) {
+    current_job = job;
+    log_defer(&(job->log));
+    render_con(job->output);
+    log_defer(NULL);
+    current_job = NULL;
+}
+
+/*
+ * Takes jobs until there are none left. Called with pool.mutex held.
+ *
+ */
+static void run_jobs(void) {
+    while (pool.next_job < pool.num_jobs) {
+        struct render_job *job = &(pool.jobs[pool.next_job++]);
+        pthread_mutex_unlock(&pool.mutex);
+        run_job(job);
+        pthread_mutex_lock(&pool.mutex);
+        if (++(pool.finished_jobs) == pool.num_jobs) {
+            pthread_cond_signal(&pool.done);
+        }
+    }
+}
+
+static void *render_worker(void *arg) {
+    pthread_mutex_lock(&pool.mutex);
+    while (true) {
+        while (pool.next_job >= pool.num_jobs) {
+            pthread_cond_wait(&pool.work, &pool.mutex);
+        }
+        run_jobs();
+    }
+    return NULL;
+}
+
+/*
+ * Starts worker threads until there are num_threads of them. Worker threads
+ * block all signals, which are handled by the main thread.
+ *
+ */
+static void start_workers(int num_threads) {
+    if (pool.num_threads >= num_threads) {
+        return;
+    }
+
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    while (pool.num_threads < num_threads) {
+        pthread_t thread;
+        const int error = pthread_create(&thread, NULL, render_worker, NULL);
+        if (error != 0) {
+            ELOG("Could not start render thread: %s\n", strerror(error));
+            break;
+        }
+        pthread_detach(thread);
+        pool.num_threads++;
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    DLOG("Using %d render threads\n", pool.num_threads);
+}
+
+/*
+ * Renders all outputs. Since the layout of each output only depends on its
+ * own subtree, they are rendered in parallel when there are many of them.
+ *
+ */
+static void render_outputs(Con *con) {
+    static struct render_job *jobs = NULL;
+    static int jobs_size = 0;
+    static long num_cpus = 0;
+    if (num_cpus == 0) {
+        num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+
+    int num_jobs = 0;
+    Con *output;
+    TAILQ_FOREACH(output, &(con->nodes_head), nodes) {
+        if (!con_is_internal(output)) {
+            num_jobs++;
+        }
+    }
+
+    if (num_jobs < RENDER_PARALLEL_MIN_OUTPUTS || num_cpus < 2) {
+        TAILQ_FOREACH(output, &(con->nodes_head), nodes) {
+            render_con(output);
+        }
+        return;
+    }
+
+    if (num_jobs > jobs_size) {
+        jobs = srealloc(jobs, num_jobs * sizeof(struct render_job));
+        memset(jobs + jobs_size, 0, (num_jobs - jobs_size) * sizeof(struct render_job));
+        jobs_size = num_jobs;
+    }
+    int i = 0;
+    TAILQ_FOREACH(output, &(con->nodes_head), nodes) {
+        if (con_is_internal(output)) {
+            /* Not much to do, see render_con(). */
+            render_con(output);
+        } else {
+            jobs[i++].output = output;
+        }
+    }
+
+    /* The main thread renders outputs, too. */
+    start_workers((num_cpus < num_jobs ? num_cpus : num_jobs) - 1);
+
+    pthread_mutex_lock(&pool.mutex);
+    pool.jobs = jobs;
+    pool.num_jobs = num_jobs;
+    pool.next_job = 0;
+    pool.finished_jobs = 0;
+    pthread_cond_broadcast(&pool.work);
+    run_jobs();
+    while (pool.finished_jobs < pool.num_jobs) {
+        pthread_cond_wait(&pool.done, &pool.mutex);
+    }
+    pool.num_jobs = 0;
+    pool.next_job = 0;
+    pthread_mutex_unlock(&pool.mutex);
+
+    for (i = 0; i < num_jobs; i++) {
+        log_replay(&(jobs[i].log));
+        for (int r = 0; r < jobs[i].num_raises; r++) {
+            x_raise_con(jobs[i].raises[r]);
+        }
+        jobs[i].num_raises = 0;
+    }
+}
+
+/*
+ * Returns size bytes of scratch memory, which stay valid until the end of the
+ * current frame (see render_frame_end()). Outside of tree_render(), they stay
+ * valid until the outermost render_con() call returns.
+ *
+ */
+void *render_alloc(size_t size) {
+    if (frame_arena == NULL)
+        frame_arena = arena_new();
+    return arena_alloc(frame_arena, size);
+}
+
+/*
+ * Marks the beginning of a frame, called by tree_render() before rendering.
+ *
+ */
+void render_frame_begin(void) {
+    in_frame = true;
+}
+
+/*
+ * Marks the end of a frame, called by tree_render() once the changes were
+ * pushed to X11. Releases everything allocated with render_alloc().
+ *
+ */
+void render_frame_end(void) {
+    in_frame = false;
+    if (frame_arena != NULL)
+        arena_release(frame_arena, (arena_mark_t){NULL, 0});
+}
+
 /*
  * Returns the height for the decorations
  */
@@ -38,6 +274,13 @@ int render_deco_height(void) {
  *
  */
 void render_con(Con *con) {
+    /* The counters are not thread-safe, the parallel part is accounted to the
+     * render_con() call which started it. */
+    const bool count = (current_job == NULL);
+    const uint64_t stats_start = (count ? stats_begin(STATS_RENDER_CON) : 0);
+    /* Called outside of tree_render(), for example when dragging a floating
+     * window: the scratch memory is released once we are done. */
+    const bool ends_frame = (render_depth++ == 0 && !in_frame);
     render_params params = {
         .rect = con->rect,
         .x = con->rect.x,
@@ -80,7 +323,7 @@ void render_con(Con *con) {
     }
     if (fullscreen) {
         fullscreen->rect = params.rect;
-        x_raise_con(fullscreen);
+        render_raise(fullscreen);
         render_con(fullscreen);
         /* Fullscreen containers are either global (underneath the CT_ROOT
          * container) or per-output (underneath the CT_CONTENT container). For
@@ -89,7 +332,7 @@ void render_con(Con *con) {
          * have not yet been rendered (see the CT_ROOT code path below). See
          * also https://bugs.i3wm.org/1393 */
         if (con->type != CT_ROOT) {
-            return;
+            goto free_params;
         }
     }
 
@@ -123,15 +366,17 @@ void render_con(Con *con) {
 
             DLOG("child at (%d, %d) with (%d x %d)\n",
                  child->rect.x, child->rect.y, child->rect.width, child->rect.height);
-            x_raise_con(child);
+            render_raise(child);
             render_con(child);
             i++;
         }
 
         /* in a stacking or tabbed container, we ensure the focused client is raised */
         if (con->layout == L_STACKED || con->layout == L_TABBED) {
+            con_record_deco_slots(con);
+
             TAILQ_FOREACH_REVERSE(child, &(con->focus_head), focus_head, focused)
-            x_raise_con(child);
+            render_raise(child);
             if ((child = TAILQ_FIRST(&(con->focus_head)))) {
                 /* By rendering the stacked container again, we handle the case
                  * that we have a non-leaf-container inside the stack. In that
@@ -145,12 +390,15 @@ void render_con(Con *con) {
                  * decoration on top of every stack window. That way, when a
                  * new window is opened in the stack, the old window will not
                  * obscure part of the decoration (it’s unmapped afterwards). */
-                x_raise_con(con);
+                render_raise(con);
         }
     }
 
 free_params:
-    FREE(params.sizes);
+    if (--render_depth == 0 && ends_frame)
+        render_frame_end();
+    if (count)
+        stats_end(STATS_RENDER_CON, stats_start);
 }
 
 static int *precalculate_sizes(Con *con, render_params *p) {
@@ -158,7 +406,7 @@ static int *precalculate_sizes(Con *con, render_params *p) {
         return NULL;
     }
 
-    int *sizes = smalloc(p->children * sizeof(int));
+    int *sizes = render_alloc(p->children * sizeof(int));
     assert(!TAILQ_EMPTY(&con->nodes_head));
 
     Con *child;
@@ -183,17 +431,57 @@ static int *precalculate_sizes(Con *con, render_params *p) {
 }
 
 static void render_root(Con *con, Con *fullscreen) {
-    Con *output;
     if (!fullscreen) {
-        TAILQ_FOREACH(output, &(con->nodes_head), nodes) {
-            render_con(output);
-        }
+        render_outputs(con);
     }
 
     /* We need to render floating windows after rendering all outputs’
      * tiling windows because they need to be on top of *every* output at
      * all times. This is important when the user places floating
      * windows/containers so that they overlap on another output. */
+    render_floating_layer(con, fullscreen);
+}
+
+/*
+ * Returns true if the floating child is (transitively) transient for the
+ * fullscreen window, so that it is rendered with popup_during_fullscreen smart.
+ *
+ */
+static bool render_is_transient_for(Con *child, Con *fullscreen) {
+    Con *floating_child = con_descend_focused(child);
+    Con *transient_con = floating_child;
+    while (transient_con != NULL &&
+           transient_con->window != NULL &&
+           transient_con->window->transient_for != XCB_NONE) {
+        DLOG("transient_con = 0x%08x, transient_con->window->transient_for = 0x%08x, fullscreen_id = 0x%08x\n",
+             transient_con->window->id, transient_con->window->transient_for, fullscreen->window->id);
+        if (transient_con->window->transient_for == fullscreen->window->id) {
+            DLOG("Rendering floating child even though in fullscreen mode: "
+                 "floating->transient_for (0x%08x) --> fullscreen->id (0x%08x)\n",
+                 floating_child->window->transient_for, fullscreen->window->id);
+            return true;
+        }
+        Con *next_transient = con_by_window_id(transient_con->window->transient_for);
+        if (next_transient == NULL)
+            break;
+        /* Some clients (e.g. x11-ssh-askpass) actually set
+         * WM_TRANSIENT_FOR to their own window id, so break instead of
+         * looping endlessly. */
+        if (transient_con == next_transient)
+            break;
+        transient_con = next_transient;
+    }
+    return false;
+}
+
+/*
+ * Renders the floating windows of the visible workspace of each output. The
+ * global fullscreen container (if any) is passed in, so that the tree is only
+ * searched for it once instead of once per output.
+ *
+ */
+static void render_floating_layer(Con *con, Con *global_fullscreen) {
+    Con *output;
     DLOG("Rendering floating windows:\n");
     TAILQ_FOREACH(output, &(con->nodes_head), nodes) {
         if (con_is_internal(output))
@@ -204,59 +492,45 @@ static void render_root(Con *con, Con *fullscreen) {
             DLOG("Skipping this output because it is currently being destroyed.\n");
             continue;
         }
+        /* Only the floating windows of the visible workspace can be visible,
+         * the workspace keeps them in its floating_head already. */
         Con *workspace = TAILQ_FIRST(&(content->focus_head));
-        Con *fullscreen = con_get_fullscreen_covering_ws(workspace);
+        if (TAILQ_EMPTY(&(workspace->floating_head)))
+            continue;
+
+        Con *fullscreen = global_fullscreen;
+        if (fullscreen == NULL)
+            fullscreen = con_get_fullscreen_con(workspace, CF_OUTPUT);
+        /* Don’t render floating windows when there is a fullscreen window on
+         * that workspace. Necessary to make floating fullscreen work
+         * correctly (ticket #564). Exception to the above rule: smart
+         * popup_during_fullscreen handling (popups belonging to the
+         * fullscreen app will be rendered). */
+        if (fullscreen != NULL &&
+            (config.popup_during_fullscreen != PDF_SMART || fullscreen->window == NULL))
+            continue;
+
         Con *child;
         TAILQ_FOREACH(child, &(workspace->floating_head), floating_windows) {
-            if (fullscreen != NULL) {
-                /* Don’t render floating windows when there is a fullscreen
-                 * window on that workspace. Necessary to make floating
-                 * fullscreen work correctly (ticket #564). Exception to the
-                 * above rule: smart popup_during_fullscreen handling (popups
-                 * belonging to the fullscreen app will be rendered). */
-                if (config.popup_during_fullscreen != PDF_SMART || fullscreen->window == NULL) {
-                    continue;
-                }
-
-                Con *floating_child = con_descend_focused(child);
-                Con *transient_con = floating_child;
-                bool is_transient_for = false;
-                while (transient_con != NULL &&
-                       transient_con->window != NULL &&
-                       transient_con->window->transient_for != XCB_NONE) {
-                    DLOG("transient_con = 0x%08x, transient_con->window->transient_for = 0x%08x, fullscreen_id = 0x%08x\n",
-                         transient_con->window->id, transient_con->window->transient_for, fullscreen->window->id);
-                    if (transient_con->window->transient_for == fullscreen->window->id) {
-                        is_transient_for = true;
-                        break;
-                    }
-                    Con *next_transient = con_by_window_id(transient_con->window->transient_for);
-                    if (next_transient == NULL)
-                        break;
-                    /* Some clients (e.g. x11-ssh-askpass) actually set
-                     * WM_TRANSIENT_FOR to their own window id, so break instead of
-                     * looping endlessly. */
-                    if (transient_con == next_transient)
-                        break;
-                    transient_con = next_transient;
-                }
-
-                if (!is_transient_for)
-                    continue;
-                else {
-                    DLOG("Rendering floating child even though in fullscreen mode: "
-                         "floating->transient_for (0x%08x) --> fullscreen->id (0x%08x)\n",
-                         floating_child->window->transient_for, fullscreen->window->id);
-                }
-            }
+            if (fullscreen != NULL && !render_is_transient_for(child, fullscreen))
+                continue;
             DLOG("floating child at (%d,%d) with %d x %d\n",
                  child->rect.x, child->rect.y, child->rect.width, child->rect.height);
-            x_raise_con(child);
+            render_raise(child);
             render_con(child);
         }
     }
 }
 
+/*
+ * Renders the floating windows of all outputs. Called after the outputs were
+ * rendered, so that the floating windows are raised above them.
+ *
+ */
+void render_floating_windows(Con *con) {
+    render_floating_layer(con, con_get_fullscreen_con(con, CF_GLOBAL));
+}
+
 /*
  * Renders a container with layout L_OUTPUT. In this layout, all CT_DOCKAREAs
  * get the height of their content and the remaining CT_CON gets the rest.
@@ -301,7 +575,7 @@ static void render_output(Con *con) {
     Con *fullscreen = con_get_fullscreen_con(ws, CF_OUTPUT);
     if (fullscreen) {
         fullscreen->rect = con->rect;
-        x_raise_con(fullscreen);
+        render_raise(fullscreen);
         render_con(fullscreen);
         return;
     }
@@ -341,7 +615,7 @@ static void render_output(Con *con) {
 
         DLOG("child at (%d, %d) with (%d x %d)\n",
              child->rect.x, child->rect.y, child->rect.width, child->rect.height);
-        x_raise_con(child);
+        render_raise(child);
         render_con(child);
     }
 }
@@ -20,11 +20,20 @@ struct callback_params {
     orientation_t orientation;
     Con *output;
     xcb_window_t helpwin;
-    uint32_t *new_position;
+    xcb_window_t grabwin;
+
+    /* The containers between which the border is moved. */
+    Con *first;
+    Con *second;
+
+    /* The coordinate orthogonal to the motion when the drag started and
+     * now, to determine the length of the resize afterward. */
+    uint32_t initial_position;
+    uint32_t new_position;
 };
 
 DRAGGING_CB(resize_callback) {
-    const struct callback_params *params = extra;
+    struct callback_params *params = extra;
     Con *output = params->output;
     DLOG("new x = %d, y = %d\n", new_x, new_y);
     if (params->orientation == HORIZ) {
@@ -33,20 +42,49 @@ DRAGGING_CB(resize_callback) {
             new_x < (output->rect.x + 25))
             return;
 
-        *(params->new_position) = new_x;
-        xcb_configure_window(conn, params->helpwin, XCB_CONFIG_WINDOW_X, params->new_position);
+        params->new_position = new_x;
+        xcb_configure_window(conn, params->helpwin, XCB_CONFIG_WINDOW_X, &(params->new_position));
     } else {
         if (new_y > (output->rect.y + output->rect.height - 25) ||
             new_y < (output->rect.y + 25))
             return;
 
-        *(params->new_position) = new_y;
-        xcb_configure_window(conn, params->helpwin, XCB_CONFIG_WINDOW_Y, params->new_position);
+        params->new_position = new_y;
+        xcb_configure_window(conn, params->helpwin, XCB_CONFIG_WINDOW_Y, &(params->new_position));
     }
 
     xcb_flush(conn);
 }
 
+static void resize_done(drag_result_t result, void *extra) {
+    struct callback_params *params = extra;
+    Con *first = params->first;
+    Con *second = params->second;
+    const int pixels = (params->new_position - params->initial_position);
+
+    xcb_destroy_window(conn, params->helpwin);
+    xcb_destroy_window(conn, params->grabwin);
+    xcb_flush(conn);
+    free(params);
+
+    /* User cancelled the drag (or the containers changed) so no action
+     * should be taken. */
+    if (result == DRAG_SUCCESS && pixels != 0 &&
+        con_exists(first) && con_exists(second) && first->parent == second->parent) {
+        DLOG("Done, pixels = %d\n", pixels);
+
+        /* if we got thus far, the containers must have valid percentages. */
+        assert(first->percent > 0.0);
+        assert(second->percent > 0.0);
+        const bool resized = resize_neighboring_cons(first, second, pixels, 0);
+        DLOG("Graphical resize %s: first->percent = %f, second->percent = %f.\n",
+             resized ? "successful" : "failed", first->percent, second->percent);
+    }
+
+    DLOG("After resize handler, rendering\n");
+    tree_render();
+}
+
 bool resize_find_tiling_participants(Con **current, Con **other, direction_t direction, bool both_sides) {
     DLOG("Find two participants for resizing container=%p in direction=%i\n", other, direction);
     Con *first = *current;
@@ -166,9 +204,12 @@ void resize_graphical_handler(Con *first, Con *second, orientation_t orientation
     xcb_window_t grabwin = create_window(conn, output->rect, XCB_COPY_FROM_PARENT, XCB_COPY_FROM_PARENT,
                                          XCB_WINDOW_CLASS_INPUT_ONLY, XCURSOR_CURSOR_POINTER, true, mask, values);
 
-    /* Keep track of the coordinate orthogonal to motion so we can determine the
-     * length of the resize afterward. */
-    uint32_t initial_position, new_position;
+    struct callback_params *params = scalloc(1, sizeof(struct callback_params));
+    params->orientation = orientation;
+    params->output = output;
+    params->grabwin = grabwin;
+    params->first = first;
+    params->second = second;
 
     /* Configure the resizebar and snap the pointer. The resizebar runs along
      * the rect of the second con and follows the motion of the pointer. */
@@ -178,13 +219,13 @@ void resize_graphical_handler(Con *first, Con *second, orientation_t orientation
     if (orientation == HORIZ) {
         helprect.width = logical_px(2);
         helprect.height = second->rect.height;
-        initial_position = second->rect.x;
+        params->initial_position = second->rect.x;
         xcb_warp_pointer(conn, XCB_NONE, event->root, 0, 0, 0, 0,
                          second->rect.x, event->root_y);
     } else {
         helprect.width = second->rect.width;
         helprect.height = logical_px(2);
-        initial_position = second->rect.y;
+        params->initial_position = second->rect.y;
         xcb_warp_pointer(conn, XCB_NONE, event->root, 0, 0, 0, 0,
                          event->root_x, second->rect.y);
     }
@@ -195,42 +236,17 @@ void resize_graphical_handler(Con *first, Con *second, orientation_t orientation
     mask |= XCB_CW_OVERRIDE_REDIRECT;
     values[1] = 1;
 
-    xcb_window_t helpwin = create_window(conn, helprect, XCB_COPY_FROM_PARENT, XCB_COPY_FROM_PARENT,
-                                         XCB_WINDOW_CLASS_INPUT_OUTPUT, (orientation == HORIZ ? XCURSOR_CURSOR_RESIZE_HORIZONTAL : XCURSOR_CURSOR_RESIZE_VERTICAL), true, mask, values);
+    params->helpwin = create_window(conn, helprect, XCB_COPY_FROM_PARENT, XCB_COPY_FROM_PARENT,
+                                    XCB_WINDOW_CLASS_INPUT_OUTPUT, (orientation == HORIZ ? XCURSOR_CURSOR_RESIZE_HORIZONTAL : XCURSOR_CURSOR_RESIZE_VERTICAL), true, mask, values);
 
-    xcb_circulate_window(conn, XCB_CIRCULATE_RAISE_LOWEST, helpwin);
+    xcb_circulate_window(conn, XCB_CIRCULATE_RAISE_LOWEST, params->helpwin);
 
     xcb_flush(conn);
 
     /* `new_position' will be updated by the `resize_callback'. */
-    new_position = initial_position;
-
-    const struct callback_params params = {orientation, output, helpwin, &new_position};
-
-    /* `drag_pointer' blocks until the drag is completed. */
-    drag_result_t drag_result = drag_pointer(NULL, event, grabwin, BORDER_TOP, 0, resize_callback, &params);
-
-    xcb_destroy_window(conn, helpwin);
-    xcb_destroy_window(conn, grabwin);
-    xcb_flush(conn);
-
-    /* User cancelled the drag so no action should be taken. */
-    if (drag_result == DRAG_REVERT) {
-        return;
-    }
-
-    int pixels = (new_position - initial_position);
-    DLOG("Done, pixels = %d\n", pixels);
-
-    /* No change; no action needed. */
-    if (pixels == 0) {
-        return;
-    }
+    params->new_position = params->initial_position;
 
-    /* if we got thus far, the containers must have valid percentages. */
-    assert(first->percent > 0.0);
-    assert(second->percent > 0.0);
-    const bool result = resize_neighboring_cons(first, second, pixels, 0);
-    DLOG("Graphical resize %s: first->percent = %f, second->percent = %f.\n",
-         result ? "successful" : "failed", first->percent, second->percent);
+    /* The resize is applied (and the tree rendered) by `resize_done' once the
+     * drag ended. */
+    drag_pointer(NULL, event, grabwin, BORDER_TOP, 0, resize_callback, resize_done, params);
 }
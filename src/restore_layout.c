@@ -26,8 +26,11 @@ typedef struct placeholder_state {
     /** Current size of the placeholder window (to detect size changes). */
     Rect rect;
 
-    /** The drawable surface */
+    /** The drawable surface, only initialized on the first expose (see
+     * expose_event()), so that opening many placeholders does not block on
+     * one round trip per window. */
     surface_t surface;
+    bool surface_initialized;
 
     TAILQ_ENTRY(placeholder_state)
     state;
@@ -184,24 +187,41 @@ static void update_placeholder_contents(placeholder_state *state) {
     xcb_aux_sync(restore_conn);
 }
 
+/*
+ * Creates and maps a placeholder window. Unlike create_window(), this does not
+ * wait for the X server to confirm the request (errors are logged by
+ * restore_xcb_prepare_cb()), so that all placeholders of a layout are created
+ * in one go.
+ *
+ */
+static xcb_window_t create_placeholder_window(Rect rect) {
+    const uint32_t background = config.client.placeholder.background.colorpixel;
+    const uint32_t event_mask = XCB_EVENT_MASK_EXPOSURE | XCB_EVENT_MASK_STRUCTURE_NOTIFY;
+    if (!xcursor_supported) {
+        /* The fallback cursor needs a cursor font, which create_window()
+         * takes care of. */
+        return create_window(restore_conn, rect, XCB_COPY_FROM_PARENT, XCB_COPY_FROM_PARENT,
+                             XCB_WINDOW_CLASS_INPUT_OUTPUT, XCURSOR_CURSOR_POINTER, true,
+                             XCB_CW_BACK_PIXEL | XCB_CW_EVENT_MASK,
+                             (uint32_t[]){background, event_mask});
+    }
+
+    xcb_window_t window = xcb_generate_id(restore_conn);
+    xcb_create_window(restore_conn, XCB_COPY_FROM_PARENT, window, root,
+                      rect.x, rect.y, rect.width, rect.height, 0,
+                      XCB_WINDOW_CLASS_INPUT_OUTPUT, XCB_COPY_FROM_PARENT,
+                      XCB_CW_BACK_PIXEL | XCB_CW_EVENT_MASK | XCB_CW_CURSOR,
+                      (uint32_t[]){background, event_mask, xcursor_get_cursor(XCURSOR_CURSOR_POINTER)});
+    xcb_map_window(restore_conn, window);
+    return window;
+}
+
 static void open_placeholder_window(Con *con) {
     if (con_is_leaf(con) &&
         (con->window == NULL || con->window->id == XCB_NONE) &&
         !TAILQ_EMPTY(&(con->swallow_head)) &&
         con->type == CT_CON) {
-        xcb_window_t placeholder = create_window(
-            restore_conn,
-            con->rect,
-            XCB_COPY_FROM_PARENT,
-            XCB_COPY_FROM_PARENT,
-            XCB_WINDOW_CLASS_INPUT_OUTPUT,
-            XCURSOR_CURSOR_POINTER,
-            true,
-            XCB_CW_BACK_PIXEL | XCB_CW_EVENT_MASK,
-            (uint32_t[]){
-                config.client.placeholder.background.colorpixel,
-                XCB_EVENT_MASK_EXPOSURE | XCB_EVENT_MASK_STRUCTURE_NOTIFY,
-            });
+        xcb_window_t placeholder = create_placeholder_window(con->rect);
         /* Make i3 not focus this window. */
         xcb_icccm_wm_hints_t hints;
         xcb_icccm_wm_hints_set_none(&hints);
@@ -220,9 +240,6 @@ static void open_placeholder_window(Con *con) {
         state->window = placeholder;
         state->con = con;
         state->rect = con->rect;
-
-        draw_util_surface_init(restore_conn, &(state->surface), placeholder, get_visualtype(root_screen), state->rect.width, state->rect.height);
-        update_placeholder_contents(state);
         TAILQ_INSERT_TAIL(&state_head, state, state);
 
         /* create temporary id swallow to match the placeholder */
@@ -231,6 +248,7 @@ static void open_placeholder_window(Con *con) {
         temp_id->dock = M_DONTCHECK;
         temp_id->id = placeholder;
         TAILQ_INSERT_HEAD(&(con->swallow_head), temp_id, matches);
+        con_swallow_index_add(con, temp_id);
     }
 
     Con *child;
@@ -248,6 +266,9 @@ static void open_placeholder_window(Con *con) {
  * then, it exposes the criteria that must be fulfilled for a window to be
  * swallowed by this container.
  *
+ * All placeholder windows are created without waiting for the X server in
+ * between; their contents are drawn once they are exposed.
+ *
  */
 void restore_open_placeholder_windows(Con *parent) {
     Con *child;
@@ -275,7 +296,8 @@ bool restore_kill_placeholder(xcb_window_t placeholder) {
             continue;
 
         xcb_destroy_window(restore_conn, state->window);
-        draw_util_surface_free(restore_conn, &(state->surface));
+        if (state->surface_initialized)
+            draw_util_surface_free(restore_conn, &(state->surface));
         TAILQ_REMOVE(&state_head, state, state);
         free(state);
         DLOG("placeholder window 0x%08x destroyed.\n", placeholder);
@@ -294,6 +316,10 @@ static void expose_event(xcb_expose_event_t *event) {
 
         DLOG("refreshing window 0x%08x contents (con %p)\n", state->window, state->con);
 
+        if (!state->surface_initialized) {
+            draw_util_surface_init(restore_conn, &(state->surface), state->window, get_visualtype(root_screen), state->rect.width, state->rect.height);
+            state->surface_initialized = true;
+        }
         update_placeholder_contents(state);
 
         return;
@@ -320,6 +346,10 @@ static void configure_notify(xcb_configure_notify_event_t *event) {
         state->rect.width = event->width;
         state->rect.height = event->height;
 
+        /* Not drawn yet, the first expose will take care of it. */
+        if (!state->surface_initialized)
+            return;
+
         draw_util_surface_set_size(&(state->surface), state->rect.width, state->rect.height);
 
         update_placeholder_contents(state);
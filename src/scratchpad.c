@@ -67,10 +67,10 @@ void scratchpad_move(Con *con) {
         DLOG("This window was never used as a scratchpad before.\n");
         if (con == maybe_floating_con) {
             DLOG("It was in floating mode before, set scratchpad state to changed.\n");
-            con->scratchpad_state = SCRATCHPAD_CHANGED;
+            con_set_scratchpad_state(con, SCRATCHPAD_CHANGED);
         } else {
             DLOG("It was in tiling mode before, set scratchpad state to fresh.\n");
-            con->scratchpad_state = SCRATCHPAD_FRESH;
+            con_set_scratchpad_state(con, SCRATCHPAD_FRESH);
         }
     }
 }
@@ -132,17 +132,16 @@ bool scratchpad_show(Con *con) {
      * visible scratchpad window on another workspace. In this case we move it
      * to the current workspace. */
     focused_ws = con_get_workspace(focused);
-    TAILQ_FOREACH(walk_con, &all_cons, all_cons) {
-        Con *walk_ws = con_get_workspace(walk_con);
-        if (!con && walk_ws &&
-            !con_is_internal(walk_ws) && focused_ws != walk_ws &&
-            (floating = con_inside_floating(walk_con)) &&
-            floating->scratchpad_state != SCRATCHPAD_NONE) {
-            DLOG("Found a visible scratchpad window on another workspace,\n");
-            DLOG("moving it to this workspace: con = %p\n", walk_con);
-            con_move_to_workspace(walk_con, focused_ws, true, false, false);
-            con_activate(con_descend_focused(walk_con));
-            return true;
+    if (!con) {
+        TAILQ_FOREACH(walk_con, &scratchpad_cons, scratchpad_cons) {
+            Con *walk_ws = con_get_workspace(walk_con);
+            if (walk_ws && !con_is_internal(walk_ws) && focused_ws != walk_ws) {
+                DLOG("Found a visible scratchpad window on another workspace,\n");
+                DLOG("moving it to this workspace: con = %p\n", walk_con);
+                con_move_to_workspace(walk_con, focused_ws, true, false, false);
+                con_activate(con_descend_focused(walk_con));
+                return true;
+            }
         }
     }
 
@@ -0,0 +1,183 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * shmstate.c: A shared memory snapshot of the workspaces and outputs, which
+ *             status bars and similar tools can poll without IPC round trips.
+ *
+ */
+#include "all.h"
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+char *shmstatename = "";
+
+static int shmstate_fd = -1;
+static i3_shmstate_header *shmstate;
+
+/* The snapshot is assembled here first, so that the segment is only written
+ * (and sequence only bumped) when something changed. */
+static i3_shmstate_header scratch;
+static bool force_update;
+
+/* Everything after the seqlock-protected header fields. */
+#define SHMSTATE_DATA_OFFSET offsetof(i3_shmstate_header, flags)
+
+static void copy_rect(i3_shmstate_rect *dest, Rect rect) {
+    dest->x = rect.x;
+    dest->y = rect.y;
+    dest->width = rect.width;
+    dest->height = rect.height;
+}
+
+static void build_snapshot(i3_shmstate_header *snap) {
+    memset(snap, '\0', sizeof(i3_shmstate_header));
+
+    Con *focused_ws = con_get_workspace(focused);
+    Con *output;
+    TAILQ_FOREACH(output, &(croot->nodes_head), nodes) {
+        if (con_is_internal(output))
+            continue;
+        if (snap->num_outputs == I3_SHMSTATE_MAX_OUTPUTS) {
+            snap->flags |= I3_SHMSTATE_TRUNCATED;
+            break;
+        }
+
+        const uint32_t output_idx = snap->num_outputs++;
+        i3_shmstate_output *entry = &(snap->outputs[output_idx]);
+        snprintf(entry->name, sizeof(entry->name), "%s", output->name);
+        copy_rect(&(entry->rect), output->rect);
+        entry->current_workspace = -1;
+        Output *randr_output = get_output_by_name(output->name, true);
+        if (randr_output != NULL && randr_output->primary)
+            entry->flags |= I3_SHMSTATE_OUTPUT_PRIMARY;
+
+        Con *content = output_get_content(output);
+        if (content == NULL)
+            continue;
+        Con *visible = con_get_fullscreen_con(content, CF_OUTPUT);
+        Con *ws;
+        TAILQ_FOREACH(ws, &(content->nodes_head), nodes) {
+            if (snap->num_workspaces == I3_SHMSTATE_MAX_WORKSPACES) {
+                snap->flags |= I3_SHMSTATE_TRUNCATED;
+                break;
+            }
+
+            const uint32_t ws_idx = snap->num_workspaces++;
+            i3_shmstate_workspace *ws_entry = &(snap->workspaces[ws_idx]);
+            snprintf(ws_entry->name, sizeof(ws_entry->name), "%s", ws->name);
+            ws_entry->num = ws->num;
+            ws_entry->output = output_idx;
+            copy_rect(&(ws_entry->rect), ws->rect);
+            if (ws == focused_ws)
+                ws_entry->flags |= I3_SHMSTATE_WS_FOCUSED;
+            if (ws == visible) {
+                ws_entry->flags |= I3_SHMSTATE_WS_VISIBLE;
+                entry->current_workspace = ws_idx;
+            }
+            if (ws->urgent)
+                ws_entry->flags |= I3_SHMSTATE_WS_URGENT;
+        }
+    }
+}
+
+/*
+ * Creates the state snapshot segment and writes the initial snapshot.
+ *
+ */
+void shmstate_open(void) {
+#if defined(__FreeBSD__)
+    sasprintf(&shmstatename, "/tmp/i3-state-%d", getpid());
+#else
+    sasprintf(&shmstatename, "/i3-state-%d", getpid());
+#endif
+    shmstate_fd = shm_open(shmstatename, O_RDWR | O_CREAT, S_IREAD | S_IWRITE);
+    if (shmstate_fd == -1) {
+        ELOG("Could not shm_open SHM segment for the state snapshot: %s\n", strerror(errno));
+        goto err;
+    }
+
+    if (ftruncate(shmstate_fd, sizeof(i3_shmstate_header)) == -1) {
+        ELOG("Could not ftruncate SHM segment for the state snapshot: %s\n", strerror(errno));
+        goto err;
+    }
+
+    shmstate = mmap(NULL, sizeof(i3_shmstate_header), PROT_READ | PROT_WRITE, MAP_SHARED, shmstate_fd, 0);
+    if (shmstate == MAP_FAILED) {
+        ELOG("Could not mmap SHM segment for the state snapshot: %s\n", strerror(errno));
+        shmstate = NULL;
+        goto err;
+    }
+
+    /* After an in-place restart, the segment of the previous process (which
+     * had the same PID) is reused. Keep counting from its sequence so that
+     * polling readers notice the change. */
+    uint32_t sequence = 0;
+    if (shmstate->version == I3_SHMSTATE_VERSION)
+        sequence = (shmstate->sequence + 1) & ~1u;
+    shmstate->version = I3_SHMSTATE_VERSION;
+    shmstate->size = sizeof(i3_shmstate_header);
+    shmstate->sequence = sequence;
+
+    /* The segment might still contain the previous process’ snapshot. */
+    force_update = true;
+    shmstate_update();
+    return;
+
+err:
+    shmstate_close();
+}
+
+/*
+ * Unlinks the state snapshot segment.
+ *
+ */
+void shmstate_close(void) {
+    if (*shmstatename == '\0')
+        return;
+    if (shmstate != NULL) {
+        munmap(shmstate, sizeof(i3_shmstate_header));
+        shmstate = NULL;
+    }
+    if (shmstate_fd != -1) {
+        close(shmstate_fd);
+        shmstate_fd = -1;
+    }
+    shm_unlink(shmstatename);
+    free(shmstatename);
+    shmstatename = "";
+}
+
+/*
+ * Updates the snapshot if the workspaces or outputs changed since the last
+ * update. Called at the end of every x_push_changes().
+ *
+ */
+void shmstate_update(void) {
+    if (shmstate == NULL)
+        return;
+
+    build_snapshot(&scratch);
+    const char *src = (const char *)&scratch + SHMSTATE_DATA_OFFSET;
+    char *dest = (char *)shmstate + SHMSTATE_DATA_OFFSET;
+    const size_t len = sizeof(i3_shmstate_header) - SHMSTATE_DATA_OFFSET;
+    if (!force_update && memcmp(dest, src, len) == 0)
+        return;
+    force_update = false;
+
+    /* Writer side of the seqlock: the odd sequence must be visible before any
+     * of the data, and all of the data before the even sequence. */
+    const uint32_t sequence = shmstate->sequence;
+    __atomic_store_n(&(shmstate->sequence), sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(dest, src, len);
+    __atomic_store_n(&(shmstate->sequence), sequence + 2, __ATOMIC_RELEASE);
+
+    DLOG("Updated state snapshot (sequence %u, %u outputs, %u workspaces)\n",
+         sequence + 2, scratch.num_outputs, scratch.num_workspaces);
+}
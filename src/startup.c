@@ -17,6 +17,8 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <paths.h>
+#include <signal.h>
+#include <spawn.h>
 
 #define SN_API_NOT_YET_FROZEN 1
 #include <libsn/sn-launcher.h>
@@ -24,6 +26,29 @@
 static TAILQ_HEAD(startup_sequence_head, Startup_Sequence) startup_sequences =
     TAILQ_HEAD_INITIALIZER(startup_sequences);
 
+/* The startup sequences by their ID, since every new window looks up the
+ * sequence of its _NET_STARTUP_ID. */
+static hashmap_t *startup_sequences_by_id = NULL;
+
+/* The completed startup sequences, ordered by their delete_at time. As every
+ * sequence is deleted a fixed time after its completion, appending keeps the
+ * queue ordered and pruning only needs to look at its head. */
+static TAILQ_HEAD(expiring_sequence_head, Startup_Sequence) expiring_sequences =
+    TAILQ_HEAD_INITIALIZER(expiring_sequences);
+
+/* The number of startup sequences which are not completed yet. */
+static int active_sequences = 0;
+
+/*
+ * Returns the startup sequence with the given ID or NULL if there is none.
+ *
+ */
+static struct Startup_Sequence *startup_sequence_by_id(const char *id) {
+    if (startup_sequences_by_id == NULL)
+        return NULL;
+    return hashmap_get(startup_sequences_by_id, id, strlen(id));
+}
+
 /*
  * After 60 seconds, a timeout will be triggered for each startup sequence.
  *
@@ -31,31 +56,24 @@ static TAILQ_HEAD(startup_sequence_head, Startup_Sequence) startup_sequences =
  * completion process takes place (startup_monitor_event will free it).
  *
  */
-static void startup_timeout(EV_P_ ev_timer *w, int revents) {
-    const char *id = sn_launcher_context_get_startup_id(w->data);
+static void startup_timeout(wheel_timer *timer) {
+    const char *id = sn_launcher_context_get_startup_id(timer->data);
     DLOG("Timeout for startup sequence %s\n", id);
 
-    struct Startup_Sequence *current, *sequence = NULL;
-    TAILQ_FOREACH(current, &startup_sequences, sequences) {
-        if (strcmp(current->id, id) != 0)
-            continue;
-
-        sequence = current;
-        break;
-    }
+    struct Startup_Sequence *sequence = startup_sequence_by_id(id);
 
     /* Unref the context (for the timeout itself, see start_application) */
-    sn_launcher_context_unref(w->data);
+    sn_launcher_context_unref(timer->data);
 
     if (!sequence) {
         DLOG("Sequence already deleted, nevermind.\n");
-        free(w);
+        free(timer);
         return;
     }
 
     /* Complete the startup sequence, will trigger its deletion. */
-    sn_launcher_context_complete(w->data);
-    free(w);
+    sn_launcher_context_complete(timer->data);
+    free(timer);
 }
 
 /*
@@ -71,25 +89,15 @@ static void startup_timeout(EV_P_ ev_timer *w, int revents) {
  */
 static int _prune_startup_sequences(void) {
     time_t current_time = time(NULL);
-    int active_sequences = 0;
-
-    /* Traverse the list and delete everything which was marked for deletion 30
-     * seconds ago or earlier. */
-    struct Startup_Sequence *current, *next;
-    for (next = TAILQ_FIRST(&startup_sequences);
-         next != TAILQ_END(&startup_sequences);) {
-        current = next;
-        next = TAILQ_NEXT(next, sequences);
-
-        if (current->delete_at == 0) {
-            active_sequences++;
-            continue;
-        }
 
-        if (current_time <= current->delete_at)
-            continue;
+    /* Delete everything which was marked for deletion 30 seconds ago or
+     * earlier, which is a prefix of the (ordered) expiring_sequences. */
+    while (!TAILQ_EMPTY(&expiring_sequences)) {
+        struct Startup_Sequence *oldest = TAILQ_FIRST(&expiring_sequences);
+        if (current_time <= oldest->delete_at)
+            break;
 
-        startup_sequence_delete(current);
+        startup_sequence_delete(oldest);
     }
 
     return active_sequences;
@@ -111,21 +119,185 @@ void startup_sequence_delete(struct Startup_Sequence *sequence) {
 
     /* Delete our internal sequence */
     TAILQ_REMOVE(&startup_sequences, sequence, sequences);
+    hashmap_remove(startup_sequences_by_id, sequence->id, strlen(sequence->id));
+    if (sequence->delete_at == 0)
+        active_sequences--;
+    else
+        TAILQ_REMOVE(&expiring_sequences, sequence, expiring);
 
     free(sequence->id);
     free(sequence->workspace);
     FREE(sequence);
 }
 
+/* Commands containing any of these characters are passed to the shell, as
+ * they might need quoting, expansion, redirection or similar. */
+static const char *shell_metacharacters = "|&;<>()$`\\\"'*?[]#~=!{}\n";
+
+/*
+ * Splits a command which does not need a shell into its arguments (separated
+ * by spaces or tabs). Returns NULL if the command needs to be passed to the
+ * shell. The result is NULL-terminated and needs to be freed with
+ * free_arguments().
+ *
+ */
+static char **split_simple_command(const char *command) {
+    if (strpbrk(command, shell_metacharacters) != NULL)
+        return NULL;
+
+    char **argv = NULL;
+    int argc = 0;
+    const char *walk = command;
+    while (true) {
+        walk += strspn(walk, " \t");
+        if (*walk == '\0')
+            break;
+        const size_t len = strcspn(walk, " \t");
+        argv = srealloc(argv, (argc + 2) * sizeof(char *));
+        argv[argc++] = sstrndup(walk, len);
+        walk += len;
+    }
+    if (argc == 0)
+        return NULL;
+    argv[argc] = NULL;
+    return argv;
+}
+
+static void free_arguments(char **argv) {
+    if (argv == NULL)
+        return;
+    for (char **arg = argv; *arg != NULL; arg++)
+        free(*arg);
+    free(argv);
+}
+
+#ifdef POSIX_SPAWN_SETSID
 /*
- * Starts the given application by passing it through a shell. We use double
- * fork to avoid zombie processes. As the started application’s parent exits
+ * Returns the environment for started applications: ours, without the socket
+ * activation variables, plus I3SOCK and (if given) DESKTOP_STARTUP_ID. Only
+ * the array and the added variables are allocated, see free_environment().
+ *
+ */
+static char **child_environment(const char *startup_id) {
+    extern char **environ;
+    size_t n = 0;
+    while (environ[n] != NULL)
+        n++;
+
+    char **envp = scalloc(n + 3, sizeof(char *));
+    size_t i = 0;
+    for (char **var = environ; *var != NULL; var++) {
+        if (strncmp(*var, "LISTEN_PID=", strlen("LISTEN_PID=")) == 0 ||
+            strncmp(*var, "LISTEN_FDS=", strlen("LISTEN_FDS=")) == 0 ||
+            strncmp(*var, "I3SOCK=", strlen("I3SOCK=")) == 0 ||
+            strncmp(*var, "DESKTOP_STARTUP_ID=", strlen("DESKTOP_STARTUP_ID=")) == 0)
+            continue;
+        envp[i++] = *var;
+    }
+    /* The added variables are always the last ones. */
+    if (current_socketpath != NULL)
+        sasprintf(&(envp[i++]), "I3SOCK=%s", current_socketpath);
+    if (startup_id != NULL)
+        sasprintf(&(envp[i++]), "DESKTOP_STARTUP_ID=%s", startup_id);
+    envp[i] = NULL;
+    return envp;
+}
+
+static void free_environment(char **envp, const char *startup_id) {
+    size_t n = 0;
+    while (envp[n] != NULL)
+        n++;
+    if (startup_id != NULL)
+        free(envp[--n]);
+    if (current_socketpath != NULL)
+        free(envp[--n]);
+    free(envp);
+}
+
+/*
+ * Starts the command with posix_spawn(), which avoids copying the page tables
+ * of i3 (as fork() would) and does not block until the application started.
+ * Simple commands are executed directly, everything else (and commands which
+ * cannot be found, like shell builtins) via the system's bourne shell.
+ *
+ * The application becomes a child of i3 (in its own session), it is reaped by
+ * libev’s SIGCHLD handling of the default loop.
+ *
+ * Returns the process ID or -1 on error (errno is set).
+ *
+ */
+static pid_t spawn_command(const char *command, const char *startup_id) {
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t mask;
+    sigemptyset(&mask);
+    posix_spawnattr_setsigmask(&attr, &mask);
+    sigaddset(&mask, SIGPIPE);
+    posix_spawnattr_setsigdefault(&attr, &mask);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID | POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+    /* Close all socket activation file descriptors explicitly, we disabled
+     * FD_CLOEXEC to keep them open when restarting i3. */
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    for (int fd = SD_LISTEN_FDS_START;
+         fd < (SD_LISTEN_FDS_START + listen_fds);
+         fd++) {
+        posix_spawn_file_actions_addclose(&actions, fd);
+    }
+
+    /* Resource limits cannot be set by posix_spawn(), so temporarily restore
+     * the original RLIMIT_CORE (debug builds enable core dumps for i3). */
+    struct rlimit current_rlimit_core;
+    getrlimit(RLIMIT_CORE, &current_rlimit_core);
+    const bool restore_rlimit = (current_rlimit_core.rlim_cur != original_rlimit_core.rlim_cur);
+    if (restore_rlimit) {
+        struct rlimit child_rlimit_core = current_rlimit_core;
+        child_rlimit_core.rlim_cur = original_rlimit_core.rlim_cur;
+        setrlimit(RLIMIT_CORE, &child_rlimit_core);
+    }
+
+    char **envp = child_environment(startup_id);
+    pid_t pid = -1;
+    int error = ENOENT;
+
+    char **argv = split_simple_command(command);
+    if (argv != NULL) {
+        error = posix_spawnp(&pid, argv[0], &actions, &attr, argv, envp);
+        if (error != 0)
+            DLOG("Could not execute \"%s\" directly (%s), using the shell\n", argv[0], strerror(error));
+        free_arguments(argv);
+    }
+    if (argv == NULL || error != 0) {
+        char *const shell_argv[] = {_PATH_BSHELL, "-c", (char *)command, NULL};
+        error = posix_spawn(&pid, _PATH_BSHELL, &actions, &attr, shell_argv, envp);
+    }
+
+    free_environment(envp, startup_id);
+    if (restore_rlimit)
+        setrlimit(RLIMIT_CORE, &current_rlimit_core);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+    return pid;
+}
+#endif
+
+/*
+ * Starts the given application. Where posix_spawn() can create a new session
+ * (POSIX_SPAWN_SETSID), commands without shell metacharacters are executed
+ * directly and all others are passed to the system's bourne shell (i.e.,
+ * /bin/sh), see spawn_command().
+ *
+ * Otherwise, we pass the command through the shell and use double fork to
+ * avoid zombie processes. As the started application’s parent exits
  * (immediately), the application is reparented to init (process-id 1), which
  * correctly handles children, so we don’t have to do it :-).
  *
- * The shell used to start applications is the system's bourne shell (i.e.,
- * /bin/sh).
- *
  * The no_startup_id flag determines whether a startup notification context
  * (and ID) should be created, which is the default and encouraged behavior.
  *
@@ -133,6 +305,13 @@ void startup_sequence_delete(struct Startup_Sequence *sequence) {
 void start_application(const char *command, bool no_startup_id) {
     SnLauncherContext *context = NULL;
 
+    /* The windows of applications started in the traced session are part of
+     * the trace already. */
+    if (event_trace_replaying()) {
+        DLOG("Not starting \"%s\" while replaying a trace\n", command);
+        return;
+    }
+
     if (!no_startup_id) {
         /* Create a startup notification context to monitor the progress of this
          * startup. */
@@ -149,10 +328,9 @@ void start_application(const char *command, bool no_startup_id) {
         free(first_word);
 
         /* Trigger a timeout after 60 seconds */
-        struct ev_timer *timeout = scalloc(1, sizeof(struct ev_timer));
-        ev_timer_init(timeout, startup_timeout, 60.0, 0.);
-        timeout->data = context;
-        ev_timer_start(main_loop, timeout);
+        struct wheel_timer *timeout = scalloc(1, sizeof(struct wheel_timer));
+        wheel_timer_init(timeout, startup_timeout, context);
+        wheel_timer_start(timeout, 60.0);
 
         LOG("startup id = %s\n", sn_launcher_context_get_startup_id(context));
 
@@ -164,6 +342,10 @@ void start_application(const char *command, bool no_startup_id) {
         sequence->workspace = sstrdup(ws->name);
         sequence->context = context;
         TAILQ_INSERT_TAIL(&startup_sequences, sequence, sequences);
+        if (startup_sequences_by_id == NULL)
+            startup_sequences_by_id = hashmap_new();
+        hashmap_set(startup_sequences_by_id, sequence->id, strlen(sequence->id), sequence);
+        active_sequences++;
 
         /* Increase the refcount once (it starts with 1, so it will be 2 now) for
          * the timeout. Even if the sequence gets completed, the timeout still
@@ -172,6 +354,10 @@ void start_application(const char *command, bool no_startup_id) {
     }
 
     LOG("executing: %s\n", command);
+#ifdef POSIX_SPAWN_SETSID
+    if (spawn_command(command, no_startup_id ? NULL : sn_launcher_context_get_startup_id(context)) == -1)
+        ELOG("Could not start \"%s\": %s\n", command, strerror(errno));
+#else
     if (fork() == 0) {
         /* Child process */
         setsid();
@@ -198,6 +384,7 @@ void start_application(const char *command, bool no_startup_id) {
         _exit(0);
     }
     wait(0);
+#endif
 
     if (!no_startup_id) {
         /* Change the pointer of the root window to indicate progress */
@@ -219,14 +406,7 @@ void startup_monitor_event(SnMonitorEvent *event, void *userdata) {
 
     /* Get the corresponding internal startup sequence */
     const char *id = sn_startup_sequence_get_id(snsequence);
-    struct Startup_Sequence *current, *sequence = NULL;
-    TAILQ_FOREACH(current, &startup_sequences, sequences) {
-        if (strcmp(current->id, id) != 0)
-            continue;
-
-        sequence = current;
-        break;
-    }
+    struct Startup_Sequence *sequence = startup_sequence_by_id(id);
 
     if (!sequence) {
         DLOG("Got event for startup sequence that we did not initiate (ID = %s). Ignoring.\n", id);
@@ -237,9 +417,15 @@ void startup_monitor_event(SnMonitorEvent *event, void *userdata) {
         case SN_MONITOR_EVENT_COMPLETED:
             DLOG("startup sequence %s completed\n", sn_startup_sequence_get_id(snsequence));
 
-            /* Mark the given sequence for deletion in 30 seconds. */
+            /* Mark the given sequence for deletion in 30 seconds. A sequence
+             * which is completed again moves to the end of the queue. */
+            if (sequence->delete_at == 0)
+                active_sequences--;
+            else
+                TAILQ_REMOVE(&expiring_sequences, sequence, expiring);
             time_t current_time = time(NULL);
             sequence->delete_at = current_time + 30;
+            TAILQ_INSERT_TAIL(&expiring_sequences, sequence, expiring);
             DLOG("Will delete startup sequence %s at timestamp %lld\n",
                  sequence->id, (long long)sequence->delete_at);
 
@@ -319,15 +505,7 @@ struct Startup_Sequence *startup_sequence_get(i3Window *cwindow,
     char *startup_id;
     sasprintf(&startup_id, "%.*s", xcb_get_property_value_length(startup_id_reply),
               (char *)xcb_get_property_value(startup_id_reply));
-    struct Startup_Sequence *current, *sequence = NULL;
-    TAILQ_FOREACH(current, &startup_sequences, sequences) {
-        if (strcmp(current->id, startup_id) != 0)
-            continue;
-
-        sequence = current;
-        break;
-    }
-
+    struct Startup_Sequence *sequence = startup_sequence_by_id(startup_id);
     if (!sequence) {
         DLOG("WARNING: This sequence (ID %s) was not found\n", startup_id);
         free(startup_id);
@@ -0,0 +1,678 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * stats.c: Timing counters for the render pipeline and event handling,
+ *          exposed via the GET_STATS IPC message.
+ *
+ */
+#include "all.h"
+
+#include <time.h>
+#include <sys/time.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+static struct stats_counter counters[STATS_NUM_COUNTERS];
+
+static const char *counter_names[STATS_NUM_COUNTERS] = {
+    [STATS_HANDLE_EVENT] = "handle_event",
+    [STATS_RENDER_CON] = "render_con",
+    [STATS_X_PUSH_CHANGES] = "x_push_changes",
+    [STATS_X_PUSH_NODE] = "x_push_node",
+    [STATS_X_DECO_RECURSE] = "x_deco_recurse",
+    [STATS_X_DRAW_DECORATION] = "x_draw_decoration",
+};
+
+static uint64_t coalesced[STATS_NUM_COALESCED];
+
+static const char *coalesced_names[STATS_NUM_COALESCED] = {
+    [STATS_COALESCED_CONFIGURE_REQUEST] = "configure_request",
+    [STATS_COALESCED_PROPERTY_NOTIFY] = "property_notify",
+    [STATS_COALESCED_MOTION_NOTIFY] = "motion_notify",
+};
+
+/* The subsystem X11 requests are currently accounted to, and the traffic
+ * since i3 was started, since the last render and of the last render. */
+static stats_x_subsystem_t x_subsystem = STATS_X_SUBSYSTEM_OTHER;
+static struct stats_x_traffic x_traffic[STATS_NUM_X_SUBSYSTEMS];
+static struct stats_x_traffic x_traffic_since_render[STATS_NUM_X_SUBSYSTEMS];
+static struct stats_x_traffic x_traffic_last_render[STATS_NUM_X_SUBSYSTEMS];
+static uint64_t x_requests_by_type[STATS_NUM_X_REQUEST_TYPES];
+
+static const char *x_subsystem_names[STATS_NUM_X_SUBSYSTEMS] = {
+    [STATS_X_SUBSYSTEM_OTHER] = "other",
+    [STATS_X_SUBSYSTEM_RENDER] = "render",
+    [STATS_X_SUBSYSTEM_DECORATION] = "decoration",
+    [STATS_X_SUBSYSTEM_EWMH] = "ewmh",
+    [STATS_X_SUBSYSTEM_BINDINGS] = "bindings",
+    [STATS_X_SUBSYSTEM_MANAGE] = "manage",
+    [STATS_X_SUBSYSTEM_FLOATING] = "floating",
+    [STATS_X_SUBSYSTEM_RANDR] = "randr",
+};
+
+static const char *x_request_names[STATS_NUM_X_REQUEST_TYPES] = {
+#define xmacro(name) [STATS_X_REQUEST_##name] = #name,
+#include "x_requests.xmacro"
+#undef xmacro
+};
+
+/* All histograms in order of creation, and indexed by name. */
+static struct stats_histogram **histograms = NULL;
+static size_t num_histograms = 0;
+static hashmap_t *histograms_by_name = NULL;
+
+/*
+ * Returns the current time of the monotonic clock used for all timings, in
+ * nanoseconds.
+ *
+ */
+uint64_t stats_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * Starts timing a call of the function identified by counter. The returned
+ * timestamp has to be passed to stats_end().
+ *
+ */
+uint64_t stats_begin(stats_counter_t counter) {
+    if (counters[counter].depth++ > 0) {
+        return 0;
+    }
+    return stats_now_ns();
+}
+
+/*
+ * Stops timing a call started with stats_begin().
+ *
+ */
+void stats_end(stats_counter_t counter, uint64_t start) {
+    struct stats_counter *c = &counters[counter];
+    if (--(c->depth) > 0) {
+        return;
+    }
+
+    const uint64_t elapsed = stats_now_ns() - start;
+    c->calls++;
+    c->total_ns += elapsed;
+    if (elapsed > c->max_ns) {
+        c->max_ns = elapsed;
+    }
+}
+
+/*
+ * Adds the given number of X11 requests to the counter.
+ *
+ */
+void stats_add_x_requests(stats_counter_t counter, uint64_t requests) {
+    counters[counter].x_requests += requests;
+}
+
+/*
+ * Returns the accumulated values of the given counter.
+ *
+ */
+const struct stats_counter *stats_get(stats_counter_t counter) {
+    return &counters[counter];
+}
+
+/*
+ * Returns the name of the given counter as used in the GET_STATS reply.
+ *
+ */
+const char *stats_counter_name(stats_counter_t counter) {
+    return counter_names[counter];
+}
+
+/*
+ * Accounts all following X11 requests to the given subsystem, until
+ * stats_x_leave() is called with the returned (previous) subsystem.
+ *
+ */
+stats_x_subsystem_t stats_x_enter(stats_x_subsystem_t subsystem) {
+    const stats_x_subsystem_t previous = x_subsystem;
+    x_subsystem = subsystem;
+    return previous;
+}
+
+/*
+ * Restores the subsystem which was current before stats_x_enter().
+ *
+ */
+void stats_x_leave(stats_x_subsystem_t previous) {
+    x_subsystem = previous;
+}
+
+/*
+ * Counts an X11 request of the given type, see x_requests.h.
+ *
+ */
+void stats_x_request(stats_x_request_t type) {
+    x_requests_by_type[type]++;
+    x_traffic[x_subsystem].requests++;
+    x_traffic_since_render[x_subsystem].requests++;
+}
+
+/*
+ * Counts a round trip, i.e. a call which blocks until X11 replied.
+ *
+ */
+void stats_x_round_trip(void) {
+    x_traffic[x_subsystem].round_trips++;
+    x_traffic_since_render[x_subsystem].round_trips++;
+}
+
+/*
+ * Marks the end of a render (x_push_changes()). The requests since the end of
+ * the previous render are kept as the last render's, see
+ * stats_get_x_traffic().
+ *
+ */
+void stats_x_render_done(void) {
+    memcpy(x_traffic_last_render, x_traffic_since_render, sizeof(x_traffic_last_render));
+    memset(x_traffic_since_render, 0, sizeof(x_traffic_since_render));
+}
+
+/*
+ * Returns the X11 traffic of the given subsystem since i3 was started or, if
+ * last_render is true, between the previous and the last render (including
+ * the events and commands which caused the last render).
+ *
+ */
+const struct stats_x_traffic *stats_get_x_traffic(stats_x_subsystem_t subsystem, bool last_render) {
+    return (last_render ? &x_traffic_last_render[subsystem] : &x_traffic[subsystem]);
+}
+
+/*
+ * Returns the number of X11 requests of the given type since i3 was started.
+ *
+ */
+uint64_t stats_get_x_requests_of_type(stats_x_request_t type) {
+    return x_requests_by_type[type];
+}
+
+/*
+ * Returns the name of the given subsystem as used in the GET_STATS reply.
+ *
+ */
+const char *stats_x_subsystem_name(stats_x_subsystem_t subsystem) {
+    return x_subsystem_names[subsystem];
+}
+
+/*
+ * Returns the name of the given request type as used in the GET_STATS reply.
+ *
+ */
+const char *stats_x_request_name(stats_x_request_t type) {
+    return x_request_names[type];
+}
+
+/*
+ * Counts an event of the given kind which was merged into a later one and
+ * therefore not dispatched.
+ *
+ */
+void stats_count_coalesced(stats_coalesced_t type) {
+    coalesced[type]++;
+}
+
+/*
+ * Returns the number of coalesced events of the given kind.
+ *
+ */
+uint64_t stats_get_coalesced(stats_coalesced_t type) {
+    return coalesced[type];
+}
+
+/*
+ * Returns the name of the given kind of coalesced events as used in the
+ * GET_STATS reply.
+ *
+ */
+const char *stats_coalesced_name(stats_coalesced_t type) {
+    return coalesced_names[type];
+}
+
+/*
+ * Returns the latency histogram with the given name, creating it if it does
+ * not exist yet. The returned pointer stays valid until i3 exits.
+ *
+ */
+struct stats_histogram *stats_histogram_for(const char *name) {
+    if (histograms_by_name == NULL) {
+        histograms_by_name = hashmap_new();
+    }
+
+    const size_t len = strlen(name);
+    struct stats_histogram *histogram = hashmap_get(histograms_by_name, name, len);
+    if (histogram != NULL) {
+        return histogram;
+    }
+
+    histogram = scalloc(1, sizeof(struct stats_histogram));
+    histogram->name = sstrdup(name);
+    histograms = srealloc(histograms, (num_histograms + 1) * sizeof(struct stats_histogram *));
+    histograms[num_histograms++] = histogram;
+    hashmap_set(histograms_by_name, name, len, histogram);
+    return histogram;
+}
+
+/*
+ * Records one event which took the given number of nanoseconds.
+ *
+ */
+void stats_histogram_record(struct stats_histogram *histogram, uint64_t elapsed_ns) {
+    histogram->count++;
+    histogram->total_ns += elapsed_ns;
+    if (elapsed_ns > histogram->max_ns) {
+        histogram->max_ns = elapsed_ns;
+    }
+
+    /* Find the smallest power of two (in µs) the latency is below. */
+    uint64_t us = elapsed_ns / 1000;
+    int bucket = 0;
+    while (us > 0 && bucket < STATS_HISTOGRAM_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+    histogram->buckets[bucket]++;
+}
+
+/*
+ * Returns the number of latency histograms.
+ *
+ */
+size_t stats_num_histograms(void) {
+    return num_histograms;
+}
+
+/*
+ * Returns the latency histogram with the given index (in order of creation).
+ *
+ */
+const struct stats_histogram *stats_get_histogram(size_t index) {
+    return histograms[index];
+}
+
+static uint64_t startup_begin_ns;
+static uint64_t startup_total_ns;
+static struct stats_startup_phase startup_phases[STATS_NUM_STARTUP_PHASES];
+
+static const char *startup_phase_names[STATS_NUM_STARTUP_PHASES] = {
+    [STATS_STARTUP_X_CONNECTION] = "x_connection",
+    [STATS_STARTUP_ATOMS] = "atoms",
+    [STATS_STARTUP_LOAD_CONFIGURATION] = "load_configuration",
+    [STATS_STARTUP_XCURSOR] = "xcursor_load_cursors",
+    [STATS_STARTUP_KEYBOARD] = "keyboard",
+    [STATS_STARTUP_TREE_RESTORE] = "tree_restore",
+    [STATS_STARTUP_TREE_INIT] = "tree_init",
+    [STATS_STARTUP_OUTPUTS] = "outputs",
+    [STATS_STARTUP_FIRST_RENDER] = "first_render",
+    [STATS_STARTUP_SOCKETS] = "sockets",
+    [STATS_STARTUP_MANAGE_EXISTING_WINDOWS] = "manage_existing_windows",
+    [STATS_STARTUP_AUTOSTART] = "autostart",
+};
+
+/*
+ * Marks the start of main(), which all startup phases are relative to.
+ *
+ */
+void stats_startup_init(void) {
+    startup_begin_ns = stats_now_ns();
+}
+
+/*
+ * Marks the beginning of the given startup phase.
+ *
+ */
+void stats_startup_begin(stats_startup_phase_t phase) {
+    startup_phases[phase].start_ns = stats_now_ns() - startup_begin_ns;
+}
+
+/*
+ * Marks the end of the given startup phase.
+ *
+ */
+void stats_startup_end(stats_startup_phase_t phase) {
+    struct stats_startup_phase *p = &startup_phases[phase];
+    p->duration_ns = stats_now_ns() - startup_begin_ns - p->start_ns;
+}
+
+/*
+ * Marks the end of the startup (right before entering the event loop) and
+ * logs how long each phase took.
+ *
+ */
+void stats_startup_done(void) {
+    startup_total_ns = stats_now_ns() - startup_begin_ns;
+
+    LOG("Startup took %.3f ms:\n", startup_total_ns / 1e6);
+    uint64_t accounted = 0;
+    for (int i = 0; i < STATS_NUM_STARTUP_PHASES; i++) {
+        const struct stats_startup_phase *p = &startup_phases[i];
+        if (p->start_ns == 0 && p->duration_ns == 0)
+            continue;
+        LOG("    %-24s %9.3f ms (at %.3f ms)\n",
+            startup_phase_names[i], p->duration_ns / 1e6, p->start_ns / 1e6);
+        accounted += p->duration_ns;
+    }
+    LOG("    %-24s %9.3f ms\n", "(other)", (startup_total_ns - accounted) / 1e6);
+}
+
+/*
+ * Returns the timings of the given startup phase.
+ *
+ */
+const struct stats_startup_phase *stats_get_startup_phase(stats_startup_phase_t phase) {
+    return &startup_phases[phase];
+}
+
+/*
+ * Returns the name of the given startup phase as used in the GET_STATS reply.
+ *
+ */
+const char *stats_startup_phase_name(stats_startup_phase_t phase) {
+    return startup_phase_names[phase];
+}
+
+/*
+ * Returns the time from the start of main() until the event loop was entered,
+ * in nanoseconds, or 0 if the startup is not done yet.
+ *
+ */
+uint64_t stats_startup_total_ns(void) {
+    return startup_total_ns;
+}
+
+static struct stats_histogram map_latency[STATS_NUM_MAP_PHASES] = {
+    [STATS_MAP_PROPERTIES] = {.name = "properties"},
+    [STATS_MAP_PLACEMENT] = {.name = "placement"},
+    [STATS_MAP_RENDER] = {.name = "render"},
+    [STATS_MAP_TOTAL] = {.name = "total"},
+};
+
+/*
+ * Records how long the phases of managing a new window took, in nanoseconds.
+ *
+ */
+void stats_record_map_latency(const uint64_t durations_ns[STATS_NUM_MAP_PHASES]) {
+    for (int i = 0; i < STATS_NUM_MAP_PHASES; i++) {
+        stats_histogram_record(&map_latency[i], durations_ns[i]);
+    }
+}
+
+/*
+ * Returns the histogram of the durations of the given window map phase.
+ *
+ */
+const struct stats_histogram *stats_get_map_latency(stats_map_phase_t phase) {
+    return &map_latency[phase];
+}
+
+static struct stats_histogram binding_latency[STATS_NUM_BINDING_PHASES] = {
+    [STATS_BINDING_LOOKUP] = {.name = "lookup"},
+    [STATS_BINDING_COMMAND] = {.name = "command"},
+    [STATS_BINDING_RENDER] = {.name = "render"},
+    [STATS_BINDING_FLUSH] = {.name = "flush"},
+    [STATS_BINDING_TOTAL] = {.name = "total"},
+};
+
+/*
+ * Records how long the phases of running a key binding took, in nanoseconds.
+ *
+ */
+void stats_record_binding_latency(const uint64_t durations_ns[STATS_NUM_BINDING_PHASES]) {
+    for (int i = 0; i < STATS_NUM_BINDING_PHASES; i++) {
+        stats_histogram_record(&binding_latency[i], durations_ns[i]);
+    }
+}
+
+/*
+ * Returns the histogram of the durations of the given key binding phase.
+ *
+ */
+const struct stats_histogram *stats_get_binding_latency(stats_binding_phase_t phase) {
+    return &binding_latency[phase];
+}
+
+static i3_shmlog_memory memory;
+/* stats_now_ns() of the last memory sample. */
+static uint64_t memory_sampled_ns = 0;
+
+#define MEMORY_SAMPLE_INTERVAL_NS 1000000000ULL
+
+/*
+ * Fills in the heap statistics of the C library. Only glibc provides them;
+ * mallinfo() (before glibc 2.33) reports int values, which wrap at 2 GiB.
+ *
+ */
+static void sample_heap(void) {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    const struct mallinfo2 info = mallinfo2();
+#elif defined(__GLIBC__)
+    const struct mallinfo info = mallinfo();
+#endif
+#if defined(__GLIBC__)
+    memory.heap_in_use = (uint64_t)info.uordblks + (uint64_t)info.hblkhd;
+    memory.heap_free = (uint64_t)info.fordblks;
+    memory.heap_mmapped = (uint64_t)info.hblkhd;
+    if (memory.heap_in_use > memory.heap_peak_in_use) {
+        memory.heap_peak_in_use = memory.heap_in_use;
+    }
+#endif
+}
+
+static void take_memory_sample(void) {
+    memory_sampled_ns = stats_now_ns();
+
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    memory.sampled_at = (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+
+    memory.allocation_calls = 0;
+    memory.allocation_bytes = 0;
+    for (int i = 0; i < ALLOC_NUM_FUNCTIONS; i++) {
+        alloc_counter_t counter;
+        alloc_get_counter(i, &counter);
+        memory.allocation_calls += counter.calls;
+        memory.allocation_bytes += counter.bytes;
+    }
+
+    sample_heap();
+    log_publish_memory(&memory);
+}
+
+/*
+ * Samples the memory usage of i3 if the last sample is older than a second:
+ * the allocation counters of libi3, the heap statistics of the C library and
+ * the peak heap usage. Called once per event loop iteration, it does not wake
+ * up i3 by itself. The sample is also published in the shmlog header.
+ *
+ */
+void stats_sample_memory(void) {
+    if (memory_sampled_ns != 0 &&
+        stats_now_ns() - memory_sampled_ns < MEMORY_SAMPLE_INTERVAL_NS) {
+        return;
+    }
+    take_memory_sample();
+}
+
+/*
+ * Takes a new memory sample (see stats_sample_memory()) and returns it.
+ *
+ */
+const i3_shmlog_memory *stats_get_memory(void) {
+    take_memory_sample();
+    return &memory;
+}
+
+static slab_t **slabs = NULL;
+static size_t num_slabs = 0;
+
+/*
+ * Adds the given slab allocator to the GET_STATS reply.
+ *
+ */
+void stats_register_slab(slab_t *slab) {
+    slabs = srealloc(slabs, (num_slabs + 1) * sizeof(slab_t *));
+    slabs[num_slabs++] = slab;
+}
+
+/*
+ * Returns the number of registered slab allocators.
+ *
+ */
+size_t stats_num_slabs(void) {
+    return num_slabs;
+}
+
+/*
+ * Returns the slab allocator with the given index (in order of registration).
+ *
+ */
+slab_t *stats_get_slab(size_t index) {
+    return slabs[index];
+}
+
+/* Ring of the last STATS_SLOW_FRAMES slow frames: num_slow_frames counts all
+ * of them, the oldest one kept is at index num_slow_frames %
+ * STATS_SLOW_FRAMES once the ring is full. */
+static struct stats_slow_frame slow_frames[STATS_SLOW_FRAMES];
+static uint64_t num_slow_frames = 0;
+
+/* The current event loop iteration (frame.duration_ns is unused), and the
+ * counters at its start. frame_start_ns is 0 outside of an iteration. */
+static struct stats_slow_frame frame;
+static uint64_t frame_start_ns = 0;
+static struct stats_counter frame_render_con;
+static struct stats_counter frame_x_push_changes;
+
+static void slow_frame_clear(struct stats_slow_frame *f) {
+    for (uint64_t i = 0; i < f->num_commands && i < STATS_SLOW_FRAME_COMMANDS; i++) {
+        free(f->commands[i]);
+    }
+    memset(f, 0, sizeof(struct stats_slow_frame));
+}
+
+/*
+ * Marks the start of an event loop iteration (when the loop wakes up). Until
+ * stats_frame_end() is called, the flight recorder keeps track of the handled
+ * events, the commands and the renders, so that they can be recorded if the
+ * iteration turns out to be slow.
+ *
+ */
+void stats_frame_begin(void) {
+    slow_frame_clear(&frame);
+    frame_start_ns = stats_now_ns();
+    frame_render_con = counters[STATS_RENDER_CON];
+    frame_x_push_changes = counters[STATS_X_PUSH_CHANGES];
+}
+
+/*
+ * Records that an X11 event of the given kind was handled in the current
+ * event loop iteration.
+ *
+ */
+void stats_frame_event(const struct stats_histogram *kind) {
+    frame.num_events++;
+    for (int i = 0; i < frame.num_event_kinds; i++) {
+        if (frame.events[i].kind == kind) {
+            frame.events[i].count++;
+            return;
+        }
+    }
+    if (frame.num_event_kinds < STATS_SLOW_FRAME_EVENT_KINDS) {
+        frame.events[frame.num_event_kinds].kind = kind;
+        frame.events[frame.num_event_kinds].count = 1;
+        frame.num_event_kinds++;
+    }
+}
+
+/*
+ * Records that the given command was run in the current event loop
+ * iteration.
+ *
+ */
+void stats_frame_command(const char *command) {
+    if (frame.num_commands < STATS_SLOW_FRAME_COMMANDS) {
+        frame.commands[frame.num_commands] = sstrdup(command);
+    }
+    frame.num_commands++;
+}
+
+/*
+ * Records that an IPC message was handled in the current event loop
+ * iteration.
+ *
+ */
+void stats_frame_ipc_message(void) {
+    frame.ipc_messages++;
+}
+
+/*
+ * Marks the end of an event loop iteration (right before the loop sleeps).
+ * If it took longer than slow_frame_threshold, it is added to the slow
+ * frames and logged.
+ *
+ */
+void stats_frame_end(void) {
+    if (frame_start_ns == 0) {
+        return;
+    }
+    const uint64_t duration_ns = stats_now_ns() - frame_start_ns;
+    frame_start_ns = 0;
+    if (config.slow_frame_threshold <= 0 ||
+        duration_ns < (uint64_t)(config.slow_frame_threshold * 1e9)) {
+        return;
+    }
+
+    struct stats_slow_frame *slow = &slow_frames[num_slow_frames % STATS_SLOW_FRAMES];
+    slow_frame_clear(slow);
+    *slow = frame;
+    /* The commands now belong to the slow frame. */
+    memset(&frame, 0, sizeof(struct stats_slow_frame));
+    num_slow_frames++;
+
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    slow->started_at = (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000 - duration_ns / 1000000;
+    slow->duration_ns = duration_ns;
+    slow->renders = counters[STATS_X_PUSH_CHANGES].calls - frame_x_push_changes.calls;
+    slow->render_ns = (counters[STATS_RENDER_CON].total_ns - frame_render_con.total_ns) +
+                      (counters[STATS_X_PUSH_CHANGES].total_ns - frame_x_push_changes.total_ns);
+    slow->x_requests = counters[STATS_X_PUSH_CHANGES].x_requests - frame_x_push_changes.x_requests;
+
+    /* Logged with LOG() so that the marker ends up in the shmlog even when
+     * debug logging is disabled. */
+    LOG("Slow frame #%" PRIu64 ": %.3f ms, %" PRIu64 " X11 events, %" PRIu64 " commands, "
+        "%" PRIu64 " IPC messages, %" PRIu64 " renders (%.3f ms, %" PRIu64 " X11 requests)\n",
+        num_slow_frames, duration_ns / 1e6, slow->num_events, slow->num_commands,
+        slow->ipc_messages, slow->renders, slow->render_ns / 1e6, slow->x_requests);
+}
+
+/*
+ * Returns the total number of slow frames since i3 was started.
+ *
+ */
+uint64_t stats_num_slow_frames(void) {
+    return num_slow_frames;
+}
+
+/*
+ * Returns the slow frame with the given index, 0 being the oldest one which
+ * is still kept, or NULL if there is no such frame.
+ *
+ */
+const struct stats_slow_frame *stats_get_slow_frame(size_t index) {
+    const uint64_t kept = (num_slow_frames < STATS_SLOW_FRAMES ? num_slow_frames : STATS_SLOW_FRAMES);
+    if (index >= kept) {
+        return NULL;
+    }
+    return &slow_frames[(num_slow_frames - kept + index) % STATS_SLOW_FRAMES];
+}
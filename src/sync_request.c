@@ -0,0 +1,137 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * sync_request.c: _NET_WM_SYNC_REQUEST protocol, which paces the resizes of a
+ *                 window to the speed at which the client redraws.
+ *
+ */
+#include "all.h"
+
+/* How long (in seconds) we wait for a client to redraw before we send it the
+ * next size anyway. This keeps hung clients from blocking their resizes. */
+#define SYNC_REQUEST_TIMEOUT 0.5
+
+/*
+ * Ends the wait for the given window and makes the next render push the
+ * latest size, which might have been deferred in the meantime.
+ *
+ */
+static void sync_request_done(i3Window *win) {
+    win->sync_pending = false;
+    ev_timer_stop(main_loop, win->sync_timeout);
+
+    Con *con = con_by_window_id(win->id);
+    if (con != NULL) {
+        con_set_dirty(con);
+        tree_schedule_render();
+    }
+}
+
+static void sync_timeout_cb(EV_P_ ev_timer *w, int revents) {
+    i3Window *win = w->data;
+    DLOG("Window 0x%08x did not answer the sync request within %.1f s\n",
+         win->id, SYNC_REQUEST_TIMEOUT);
+    sync_request_done(win);
+}
+
+/*
+ * Sends a _NET_WM_SYNC_REQUEST to the given window, which is about to be
+ * resized, if the client supports the protocol. Further resizes are then
+ * deferred (see i3Window.sync_pending) until the client updated its counter,
+ * i.e. redrew at the new size.
+ *
+ */
+void sync_request_send(i3Window *win) {
+    if (!sync_supported || !win->supports_sync_request || win->sync_counter == XCB_NONE)
+        return;
+
+    win->sync_value++;
+    const xcb_sync_int64_t value = {
+        .hi = (int32_t)(win->sync_value >> 32),
+        .lo = (uint32_t)win->sync_value};
+
+    /* The alarm triggers once the counter reaches the new value. It becomes
+     * inactive afterwards, so we just change its value for the next
+     * request. */
+    if (win->sync_alarm == XCB_NONE) {
+        xcb_sync_create_alarm_value_list_t alarm = {
+            .counter = win->sync_counter,
+            .valueType = XCB_SYNC_VALUETYPE_ABSOLUTE,
+            .value = value,
+            .testType = XCB_SYNC_TESTTYPE_POSITIVE_COMPARISON,
+            .events = true};
+        win->sync_alarm = xcb_generate_id(conn);
+        xcb_sync_create_alarm_aux(conn, win->sync_alarm,
+                                  XCB_SYNC_CA_COUNTER | XCB_SYNC_CA_VALUE_TYPE | XCB_SYNC_CA_VALUE |
+                                      XCB_SYNC_CA_TEST_TYPE | XCB_SYNC_CA_EVENTS,
+                                  &alarm);
+    } else {
+        xcb_sync_change_alarm_value_list_t alarm = {.value = value};
+        xcb_sync_change_alarm_aux(conn, win->sync_alarm, XCB_SYNC_CA_VALUE, &alarm);
+    }
+
+    void *reply = scalloc(32, 1);
+    xcb_client_message_event_t *ev = reply;
+
+    ev->response_type = XCB_CLIENT_MESSAGE;
+    ev->window = win->id;
+    ev->type = A_WM_PROTOCOLS;
+    ev->format = 32;
+    ev->data.data32[0] = A__NET_WM_SYNC_REQUEST;
+    ev->data.data32[1] = last_timestamp;
+    ev->data.data32[2] = (uint32_t)win->sync_value;
+    ev->data.data32[3] = (uint32_t)(win->sync_value >> 32);
+
+    DLOG("Sending _NET_WM_SYNC_REQUEST %" PRIu64 " to window 0x%08x\n", win->sync_value, win->id);
+    xcb_send_event(conn, false, win->id, XCB_EVENT_MASK_NO_EVENT, (char *)ev);
+    free(reply);
+
+    if (win->sync_timeout == NULL) {
+        win->sync_timeout = scalloc(1, sizeof(struct ev_timer));
+        ev_timer_init(win->sync_timeout, sync_timeout_cb, 0., 0.);
+        win->sync_timeout->data = win;
+    }
+    ev_timer_set(win->sync_timeout, SYNC_REQUEST_TIMEOUT, 0.);
+    ev_timer_start(main_loop, win->sync_timeout);
+    win->sync_pending = true;
+}
+
+/*
+ * Handles an AlarmNotify event of the Sync extension, which is sent once a
+ * client updated its counter in response to a _NET_WM_SYNC_REQUEST.
+ *
+ */
+void sync_request_handle_alarm(xcb_sync_alarm_notify_event_t *event) {
+    Con *con;
+    TAILQ_FOREACH(con, &all_cons, all_cons) {
+        if (con->window == NULL || con->window->sync_alarm != event->alarm)
+            continue;
+
+        /* An alarm of an earlier request (which timed out) might trigger
+         * late, that does not mean the client redrew at the latest size. */
+        const uint64_t value = ((uint64_t)(uint32_t)event->counter_value.hi << 32) |
+                               event->counter_value.lo;
+        if (con->window->sync_pending && value >= con->window->sync_value) {
+            DLOG("Window 0x%08x redrew after sync request %" PRIu64 "\n",
+                 con->window->id, value);
+            sync_request_done(con->window);
+        }
+        return;
+    }
+}
+
+/*
+ * Frees the alarm and the timer of a window which is about to be freed.
+ *
+ */
+void sync_request_free(i3Window *win) {
+    if (win->sync_alarm != XCB_NONE)
+        xcb_sync_destroy_alarm(conn, win->sync_alarm);
+    if (win->sync_timeout != NULL) {
+        ev_timer_stop(main_loop, win->sync_timeout);
+        free(win->sync_timeout);
+    }
+}
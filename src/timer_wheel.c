@@ -0,0 +1,125 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * timer_wheel.c: Coarse-grained timers (urgency, startup and IPC timeouts)
+ *                with O(1) start and stop, driven by a single ev_timer.
+ *
+ * Every timer is kept in the slot of the tick in which it fires. Timers which
+ * fire more than one revolution of the wheel in the future additionally count
+ * the revolutions they still have to wait. The ev_timer only runs while there
+ * are active timers.
+ *
+ */
+#include "all.h"
+
+#define TIMER_WHEEL_SLOTS 256
+
+LIST_HEAD(wheel_slot, wheel_timer);
+
+static struct wheel_slot slots[TIMER_WHEEL_SLOTS];
+static uint32_t current_slot;
+static uint32_t num_active;
+
+/* Drives the wheel, runs only while num_active > 0. */
+static ev_timer *tick_timer;
+/* When tick_timer fires the next time. */
+static ev_tstamp next_tick;
+
+static void wheel_tick_cb(EV_P_ ev_timer *w, int revents) {
+    next_tick = ev_now(main_loop) + TIMER_WHEEL_TICK;
+    current_slot = (current_slot + 1) % TIMER_WHEEL_SLOTS;
+
+    /* Move the due timers to a separate list first: their callbacks might
+     * start or stop other timers of this slot. */
+    struct wheel_slot due = LIST_HEAD_INITIALIZER(due);
+    wheel_timer *timer = LIST_FIRST(&(slots[current_slot]));
+    while (timer != NULL) {
+        wheel_timer *next = LIST_NEXT(timer, timers);
+        if (timer->rounds > 0) {
+            timer->rounds--;
+        } else {
+            LIST_REMOVE(timer, timers);
+            LIST_INSERT_HEAD(&due, timer, timers);
+        }
+        timer = next;
+    }
+
+    while (!LIST_EMPTY(&due)) {
+        timer = LIST_FIRST(&due);
+        LIST_REMOVE(timer, timers);
+        timer->active = false;
+        num_active--;
+        timer->cb(timer);
+    }
+
+    if (num_active == 0) {
+        ev_timer_stop(main_loop, tick_timer);
+    }
+}
+
+/*
+ * Initializes the given timer, which calls cb (with timer->data set to data)
+ * once it fires. The timer is not started.
+ *
+ */
+void wheel_timer_init(wheel_timer *timer, wheel_timer_cb cb, void *data) {
+    timer->cb = cb;
+    timer->data = data;
+    timer->active = false;
+    timer->rounds = 0;
+}
+
+/*
+ * Starts the given timer so that it fires after the given number of seconds.
+ * A timer which is already running is restarted.
+ *
+ */
+void wheel_timer_start(wheel_timer *timer, ev_tstamp after) {
+    wheel_timer_stop(timer);
+
+    if (tick_timer == NULL) {
+        tick_timer = scalloc(1, sizeof(ev_timer));
+        ev_timer_init(tick_timer, wheel_tick_cb, TIMER_WHEEL_TICK, TIMER_WHEEL_TICK);
+        /* When an IPC client became writable at the same time its timeout
+         * expired, the write callback has to run first. */
+        ev_set_priority(tick_timer, EV_MINPRI);
+        for (int i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+            LIST_INIT(&(slots[i]));
+        }
+    }
+
+    const ev_tstamp now = ev_now(main_loop);
+    if (!ev_is_active(tick_timer)) {
+        ev_timer_set(tick_timer, TIMER_WHEEL_TICK, TIMER_WHEEL_TICK);
+        ev_timer_start(main_loop, tick_timer);
+        next_tick = now + TIMER_WHEEL_TICK;
+    }
+
+    /* The number of ticks until the timer fires, the first of which happens
+     * at next_tick. */
+    uint32_t ticks = 1;
+    if (after > next_tick - now) {
+        ticks += (uint32_t)ceil((after - (next_tick - now)) / TIMER_WHEEL_TICK);
+    }
+
+    timer->active = true;
+    timer->rounds = (ticks - 1) / TIMER_WHEEL_SLOTS;
+    LIST_INSERT_HEAD(&(slots[(current_slot + ticks) % TIMER_WHEEL_SLOTS]), timer, timers);
+    num_active++;
+}
+
+/*
+ * Stops the given timer if it is running. The timer may be freed afterwards.
+ *
+ */
+void wheel_timer_stop(wheel_timer *timer) {
+    if (!timer->active)
+        return;
+
+    LIST_REMOVE(timer, timers);
+    timer->active = false;
+    num_active--;
+}
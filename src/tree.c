@@ -13,6 +13,18 @@ struct Con *croot;
 struct Con *focused;
 
 struct all_cons_head all_cons = TAILQ_HEAD_INITIALIZER(all_cons);
+struct sticky_cons_head sticky_cons = TAILQ_HEAD_INITIALIZER(sticky_cons);
+struct scratchpad_cons_head scratchpad_cons = TAILQ_HEAD_INITIALIZER(scratchpad_cons);
+
+/* Whether a bulk close is in progress (see tree_close_begin()), the parents
+ * whose on_remove_child callback was deferred until it ends, and the sequence
+ * of the first request sent for a deferred close. */
+static bool bulk_close = false;
+static Con **bulk_close_parents = NULL;
+static int num_bulk_close_parents = 0;
+static int bulk_close_parents_size = 0;
+static int num_bulk_closed = 0;
+static unsigned int bulk_close_first_sequence;
 
 /*
  * Create the pseudo-output __i3. Output-independent workspaces such as
@@ -60,25 +72,10 @@ static Con *_create___i3(void) {
 }
 
 /*
- * Loads tree from 'path' (used for in-place restarts).
+ * Replaces the tree with the one in the given JSON layout.
  *
  */
-bool tree_restore(const char *path, xcb_get_geometry_reply_t *geometry) {
-    bool result = false;
-    char *globbed = resolve_tilde(path);
-    char *buf = NULL;
-
-    if (!path_exists(globbed)) {
-        LOG("%s does not exist, not restoring tree\n", globbed);
-        goto out;
-    }
-
-    ssize_t len;
-    if ((len = slurp(globbed, &buf)) < 0) {
-        /* slurp already logged an error. */
-        goto out;
-    }
-
+static bool tree_restore_json(const char *buf, size_t len, xcb_get_geometry_reply_t *geometry) {
     /* TODO: refactor the following */
     croot = con_new(NULL, NULL);
     croot->rect = (Rect){
@@ -94,7 +91,7 @@ bool tree_restore(const char *path, xcb_get_geometry_reply_t *geometry) {
     croot = TAILQ_FIRST(&(croot->nodes_head));
     if (!croot) {
         /* tree_append_json failed. Continuing here would segfault. */
-        goto out;
+        return false;
     }
     DLOG("new root = %p\n", croot);
     Con *out = TAILQ_FIRST(&(croot->nodes_head));
@@ -111,10 +108,34 @@ bool tree_restore(const char *path, xcb_get_geometry_reply_t *geometry) {
          * that assumption. */
         TAILQ_REMOVE(&(croot->nodes_head), __i3, nodes);
         TAILQ_INSERT_HEAD(&(croot->nodes_head), __i3, nodes);
+        workspace_index_invalidate();
     }
 
     restore_open_placeholder_windows(croot);
-    result = true;
+    return true;
+}
+
+/*
+ * Loads tree from 'path' (used for in-place restarts).
+ *
+ */
+bool tree_restore(const char *path, xcb_get_geometry_reply_t *geometry) {
+    bool result = false;
+    char *globbed = resolve_tilde(path);
+    char *buf = NULL;
+
+    if (!path_exists(globbed)) {
+        LOG("%s does not exist, not restoring tree\n", globbed);
+        goto out;
+    }
+
+    ssize_t len;
+    if ((len = slurp(globbed, &buf)) < 0) {
+        /* slurp already logged an error. */
+        goto out;
+    }
+
+    result = tree_restore_json(buf, len, geometry);
 
 out:
     free(globbed);
@@ -122,6 +143,23 @@ out:
     return result;
 }
 
+/*
+ * Loads the tree from the layout which the previous process passed in fd
+ * (used for in-place restarts, see store_restart_layout()).
+ *
+ */
+bool tree_restore_fd(int fd, xcb_get_geometry_reply_t *geometry) {
+    char *buf = NULL;
+    ssize_t len;
+    if ((len = slurp_fd(fd, &buf)) < 0) {
+        return false;
+    }
+
+    const bool result = tree_restore_json(buf, len, geometry);
+    free(buf);
+    return result;
+}
+
 /*
  * Initializes the tree by creating the root node. The CT_OUTPUT Cons below the
  * root node are created in randr.c for each Output.
@@ -179,6 +217,68 @@ Con *tree_open_con(Con *con, i3Window *window) {
     return new;
 }
 
+/*
+ * Remembers that the on_remove_child callback of the given container needs to
+ * be called when the bulk close ends.
+ *
+ */
+static void bulk_close_defer_parent(Con *parent) {
+    for (int i = 0; i < num_bulk_close_parents; i++) {
+        if (bulk_close_parents[i] == parent)
+            return;
+    }
+
+    if (num_bulk_close_parents == bulk_close_parents_size) {
+        bulk_close_parents_size = (bulk_close_parents_size == 0 ? 16 : bulk_close_parents_size * 2);
+        bulk_close_parents = srealloc(bulk_close_parents, bulk_close_parents_size * sizeof(Con *));
+    }
+    bulk_close_parents[num_bulk_close_parents++] = parent;
+}
+
+/*
+ * Starts a bulk close: until tree_close_end() is called, tree_close_internal()
+ * neither renders after each container nor cleans up the parents which might
+ * have become empty. Used when many containers are closed at once, e.g. by
+ * 'kill' with criteria matching many windows, or by the UnmapNotify events
+ * which follow.
+ *
+ */
+void tree_close_begin(void) {
+    bulk_close = true;
+}
+
+/*
+ * Ends a bulk close: cleans up the parents of the closed containers (which
+ * might close further containers) and renders once if anything was closed.
+ *
+ */
+void tree_close_end(void) {
+    if (!bulk_close)
+        return;
+
+    /* Parents which are closed because they became empty defer their own
+     * parent, so keep going until no deferred parent is left. */
+    while (num_bulk_close_parents > 0) {
+        Con *parent = bulk_close_parents[--num_bulk_close_parents];
+        if (con_exists(parent))
+            CALL(parent, on_remove_child);
+    }
+    bulk_close = false;
+
+    if (num_bulk_closed == 0)
+        return;
+
+    DLOG("Bulk close of %d containers done, rendering\n", num_bulk_closed);
+    num_bulk_closed = 0;
+    tree_render();
+
+    /* The frames of the closed containers were destroyed before the
+     * surrounding containers were resized by this render, so ignore the
+     * EnterNotify events caused by the gaps in between (see ticket #660). */
+    const unsigned int last_sequence = xcb_no_operation(conn).sequence;
+    add_ignore_event_range(bulk_close_first_sequence, last_sequence, XCB_ENTER_NOTIFY);
+}
+
 /*
  * Closes the given container including all children.
  * Returns true if the container was killed or false if just WM_DELETE was sent
@@ -190,6 +290,7 @@ Con *tree_open_con(Con *con, i3Window *window) {
  */
 bool tree_close_internal(Con *con, kill_window_t kill_window, bool dont_kill_parent) {
     Con *parent = con->parent;
+    I3_PROBE3(tree_close_internal, con, (con->window ? con->window->id : XCB_NONE), kill_window);
 
     /* remove the urgency hint of the workspace (if set) */
     if (con->urgent) {
@@ -219,7 +320,7 @@ bool tree_close_internal(Con *con, kill_window_t kill_window, bool dont_kill_par
 
     if (con->window != NULL) {
         if (kill_window != DONT_KILL_WINDOW) {
-            x_window_kill(con->window->id, kill_window);
+            x_window_kill(con->window, kill_window);
             return false;
         } else {
             xcb_void_cookie_t cookie;
@@ -275,7 +376,7 @@ bool tree_close_internal(Con *con, kill_window_t kill_window, bool dont_kill_par
     if (con->urgency_timer != NULL) {
         DLOG("Removing urgency timer of con %p\n", con);
         workspace_update_urgent_flag(ws);
-        ev_timer_stop(main_loop, con->urgency_timer);
+        wheel_timer_stop(con->urgency_timer);
         FREE(con->urgency_timer);
     }
 
@@ -292,9 +393,15 @@ bool tree_close_internal(Con *con, kill_window_t kill_window, bool dont_kill_par
      *
      * Rendering has to be avoided when dont_kill_parent is set (when
      * tree_close_internal calls itself recursively) because the tree is in a
-     * non-renderable state during that time. */
-    if (!dont_kill_parent)
+     * non-renderable state during that time.
+     *
+     * During a bulk close, tree_close_end() renders once instead. */
+    if (bulk_close && !dont_kill_parent) {
+        if (num_bulk_closed++ == 0)
+            bulk_close_first_sequence = xcb_no_operation(conn).sequence;
+    } else if (!dont_kill_parent) {
         tree_render();
+    }
 
     /* kill the X11 part of this container */
     x_con_kill(con);
@@ -313,7 +420,9 @@ bool tree_close_internal(Con *con, kill_window_t kill_window, bool dont_kill_par
     }
 
     /* check if the parent container is empty now and close it */
-    if (!dont_kill_parent)
+    if (bulk_close && !dont_kill_parent)
+        bulk_close_defer_parent(parent);
+    else if (!dont_kill_parent)
         CALL(parent, on_remove_child);
 
     return true;
@@ -338,6 +447,7 @@ void tree_split(Con *con, orientation_t orientation) {
             }
             DLOG("Changing orientation of workspace\n");
             con->layout = (orientation == HORIZ) ? L_SPLITH : L_SPLITV;
+            con_invalidate_tree_representation(con);
             return;
         } else {
             /* if there is more than one container on the workspace
@@ -358,6 +468,7 @@ void tree_split(Con *con, orientation_t orientation) {
         (parent->layout == L_SPLITH ||
          parent->layout == L_SPLITV)) {
         parent->layout = (orientation == HORIZ) ? L_SPLITH : L_SPLITV;
+        con_invalidate_tree_representation(parent);
         DLOG("Just changing orientation of existing container\n");
         return;
     }
@@ -369,6 +480,8 @@ void tree_split(Con *con, orientation_t orientation) {
     TAILQ_REPLACE(&(parent->nodes_head), con, new, nodes);
     TAILQ_REPLACE(&(parent->focus_head), con, new, focused);
     new->parent = parent;
+    con_count_urgency(new);
+    con_invalidate_tree_representation(parent);
     new->layout = (orientation == HORIZ) ? L_SPLITH : L_SPLITV;
 
     /* 3: swap 'percent' (resize factor) */
@@ -441,6 +554,19 @@ static void mark_unmapped(Con *con) {
     }
 }
 
+/* Whether tree_schedule_render() was called since the last render. */
+static bool render_scheduled = false;
+
+/* The outputs passed to tree_schedule_render_output() since the last render. */
+static Con **dirty_outputs = NULL;
+static int num_dirty_outputs = 0;
+static int dirty_outputs_size = 0;
+
+/* When the last render was done, and the timer which wakes up the event loop
+ * once the next one is due (with render_pacing refresh). */
+static ev_tstamp last_render = 0;
+static ev_timer *render_pace_timer = NULL;
+
 /*
  * Renders the tree, that is rendering all outputs using render_con() and
  * pushing the changes to X11 using x_push_changes().
@@ -450,18 +576,209 @@ void tree_render(void) {
     if (croot == NULL)
         return;
 
+    render_scheduled = false;
+    num_dirty_outputs = 0;
+    last_render = ev_time();
+    /* Rendering is what updates the workspace rects and their visibility. */
+    ipc_invalidate_cached_replies();
+    ipc_invalidate_tree_reply();
+
     DLOG("-- BEGIN RENDERING --\n");
+    I3_PROBE(tree_render__entry);
     /* Reset map state for all nodes in tree */
     /* TODO: a nicer method to walk all nodes would be good, maybe? */
     mark_unmapped(croot);
     croot->mapped = true;
 
+    /* Not part of render_frame_begin(): render_con() ends a frame of its own
+     * when called outside of tree_render(), e.g. in a render worker. */
+    con_cache_begin();
+    render_frame_begin();
     render_con(croot);
 
     x_push_changes(croot);
+    render_frame_end();
+    con_cache_end();
+    I3_PROBE(tree_render__return);
+    DLOG("-- END RENDERING --\n");
+}
+
+/*
+ * Marks the tree as needing to be rendered. The render happens once at the
+ * end of the current event loop iteration (see tree_render_flush()), no
+ * matter how many times this function was called.
+ *
+ */
+void tree_schedule_render(void) {
+    render_scheduled = true;
+    ipc_invalidate_tree_reply();
+}
+
+/*
+ * Marks the given output as needing to be rendered. Unlike
+ * tree_schedule_render(), only this output (and the floating windows, which
+ * need to stay on top of it) will be rendered, unless the whole tree is
+ * scheduled for rendering as well. Used for changes which cannot affect any
+ * other output, like a dock client changing its height.
+ *
+ */
+void tree_schedule_render_output(Con *output) {
+    assert(output->type == CT_OUTPUT);
+    ipc_invalidate_tree_reply();
+
+    for (int i = 0; i < num_dirty_outputs; i++) {
+        if (dirty_outputs[i] == output)
+            return;
+    }
+    if (num_dirty_outputs == dirty_outputs_size) {
+        dirty_outputs_size = (dirty_outputs_size == 0 ? 4 : dirty_outputs_size * 2);
+        dirty_outputs = srealloc(dirty_outputs, dirty_outputs_size * sizeof(Con *));
+    }
+    dirty_outputs[num_dirty_outputs++] = output;
+}
+
+/*
+ * Renders the outputs passed to tree_schedule_render_output() and pushes the
+ * changes to X11. Which containers are mapped does not change, so unlike
+ * tree_render(), the map state of the other outputs is kept as it is.
+ *
+ */
+static void tree_render_outputs(void) {
+    /* A global fullscreen container covers all outputs, only render_con()
+     * on the root container gets that right. */
+    if (croot == NULL || con_get_fullscreen_con(croot, CF_GLOBAL) != NULL) {
+        tree_render();
+        return;
+    }
+
+    last_render = ev_time();
+    ipc_invalidate_cached_replies();
+
+    DLOG("-- BEGIN RENDERING %d OUTPUT(S) --\n", num_dirty_outputs);
+    con_cache_begin();
+    render_frame_begin();
+    /* Outputs might have been closed since they were scheduled, so only the
+     * outputs which are still part of the tree are rendered. */
+    Con *output;
+    TAILQ_FOREACH(output, &(croot->nodes_head), nodes) {
+        for (int i = 0; i < num_dirty_outputs; i++) {
+            if (dirty_outputs[i] == output) {
+                render_con(output);
+                break;
+            }
+        }
+    }
+    num_dirty_outputs = 0;
+    render_floating_windows(croot);
+
+    x_push_changes(croot);
+    render_frame_end();
+    con_cache_end();
     DLOG("-- END RENDERING --\n");
 }
 
+/*
+ * Renders the tree if tree_schedule_render() was called since the last render.
+ * Called from the ev_prepare hook, and by code which needs X11 to reflect the
+ * current state of the tree right away (like the I3_SYNC protocol).
+ *
+ */
+void tree_render_flush(void) {
+    if (render_scheduled)
+        tree_render();
+    else if (num_dirty_outputs > 0)
+        tree_render_outputs();
+}
+
+/*
+ * Returns the refresh interval of the fastest active output, so that no
+ * output gets fewer renders than it can display.
+ *
+ */
+static ev_tstamp render_pace_interval(void) {
+    double rate = 0;
+    Output *output;
+    TAILQ_FOREACH(output, &outputs, outputs) {
+        if (output->active && output->refresh_rate > rate)
+            rate = output->refresh_rate;
+    }
+    return 1.0 / (rate > 0 ? rate : 60.0);
+}
+
+static void render_pace_cb(EV_P_ ev_timer *w, int revents) {
+    /* Nothing to do: the ev_prepare hook runs before the event loop blocks
+     * again and renders now that the interval has passed. */
+}
+
+/*
+ * Like tree_render_flush(), but with render_pacing refresh, the tree is
+ * rendered at most once per refresh interval of the outputs: states which
+ * would be replaced before the screen could show them are never pushed to
+ * X11. Returns false when the render was postponed; a timer wakes up the
+ * event loop once it is due.
+ *
+ */
+bool tree_render_flush_paced(void) {
+    if (!render_scheduled && num_dirty_outputs == 0)
+        return true;
+
+    if (config.render_pacing == RENDER_PACING_REFRESH) {
+        const ev_tstamp due = last_render + render_pace_interval();
+        const ev_tstamp now = ev_time();
+        if (now < due) {
+            if (render_pace_timer == NULL) {
+                render_pace_timer = scalloc(1, sizeof(ev_timer));
+                ev_timer_init(render_pace_timer, render_pace_cb, 0., 0.);
+            }
+            if (!ev_is_active(render_pace_timer)) {
+                ev_timer_set(render_pace_timer, due - now, 0.);
+                ev_timer_start(main_loop, render_pace_timer);
+            }
+            return false;
+        }
+    }
+
+    tree_render_flush();
+    return true;
+}
+
+/*
+ * Returns whether tree_schedule_render() or tree_schedule_render_output() was
+ * called since the last render.
+ *
+ */
+bool tree_render_is_scheduled(void) {
+    return render_scheduled || num_dirty_outputs > 0;
+}
+
+/*
+ * Returns true if focusing the given container (instead of the currently
+ * focused one) only changes decorations and the input focus, not the layout.
+ * In that case, the focus change can be displayed using x_push_changes()
+ * without the render_con() pass of tree_render().
+ *
+ */
+bool tree_focus_change_is_cosmetic(Con *con) {
+    Con *ws = con_get_workspace(con);
+    if (ws == NULL || ws != con_get_workspace(focused))
+        return false;
+
+    /* Which floating windows are rendered depends on the focused window when
+     * there is a fullscreen window (see popup_during_fullscreen). */
+    if (con_get_fullscreen_covering_ws(ws) != NULL)
+        return false;
+
+    /* Within stacked and tabbed containers, only the focused child is
+     * visible, so changing it requires re-rendering. */
+    for (Con *walk = con; walk != ws; walk = walk->parent) {
+        if ((walk->parent->layout == L_STACKED || walk->parent->layout == L_TABBED) &&
+            TAILQ_FIRST(&(walk->parent->focus_head)) != walk)
+            return false;
+    }
+
+    return true;
+}
+
 /*
  * Recursive function to walk the tree until a con can be found to focus.
  *
@@ -629,19 +946,11 @@ void tree_next(char way, orientation_t orientation) {
 }
 
 /*
- * tree_flatten() removes pairs of redundant split containers, e.g.:
- *       [workspace, horizontal]
- *   [v-split]           [child3]
- *   [h-split]
- * [child1] [child2]
- * In this example, the v-split and h-split container are redundant.
- * Such a situation can be created by moving containers in a direction which is
- * not the orientation of their parent container. i3 needs to create a new
- * split container then and if you move containers this way multiple times,
- * redundant chains of split-containers can be the result.
+ * Flattens con if it is a redundant split container (see tree_flatten()).
+ * Returns true if it was, in which case con was closed.
  *
  */
-void tree_flatten(Con *con) {
+static bool tree_flatten_con(Con *con) {
     Con *current, *child, *parent = con->parent;
     DLOG("Checking if I can flatten con = %p / %s\n", con, con->name);
 
@@ -649,12 +958,12 @@ void tree_flatten(Con *con) {
     if (con->type != CT_CON ||
         parent->layout == L_OUTPUT || /* con == "content" */
         con->window != NULL)
-        goto recurse;
+        return false;
 
     /* Ensure it got only one child */
     child = TAILQ_FIRST(&(con->nodes_head));
     if (child == NULL || TAILQ_NEXT(child, nodes) != NULL)
-        goto recurse;
+        return false;
 
     DLOG("child = %p, con = %p, parent = %p\n", child, con, parent);
 
@@ -666,7 +975,7 @@ void tree_flatten(Con *con) {
         (child->layout != L_SPLITH && child->layout != L_SPLITV) ||
         con_orientation(con) == con_orientation(child) ||
         con_orientation(child) != con_orientation(parent))
-        goto recurse;
+        return false;
 
     DLOG("Alright, I have to flatten this situation now. Stay calm.\n");
     /* 1: save focus */
@@ -685,8 +994,11 @@ void tree_flatten(Con *con) {
          * directly use the TAILQ macros. */
         current->parent = parent;
         TAILQ_INSERT_BEFORE(con, current, nodes);
+        parent->num_children++;
+        con_invalidate_tree_representation(parent);
         DLOG("attaching to focus list\n");
         TAILQ_INSERT_TAIL(&(parent->focus_head), current, focused);
+        con_count_urgency(current);
         current->percent = con->percent;
     }
     DLOG("re-attached all\n");
@@ -703,15 +1015,33 @@ void tree_flatten(Con *con) {
     /* 4: close the redundant cons */
     DLOG("closing redundant cons\n");
     tree_close_internal(con, DONT_KILL_WINDOW, true);
+    return true;
+}
+
+/*
+ * tree_flatten() removes pairs of redundant split containers, e.g.:
+ *       [workspace, horizontal]
+ *   [v-split]           [child3]
+ *   [h-split]
+ * [child1] [child2]
+ * In this example, the v-split and h-split container are redundant.
+ * Such a situation can be created by moving containers in a direction which is
+ * not the orientation of their parent container. i3 needs to create a new
+ * split container then and if you move containers this way multiple times,
+ * redundant chains of split-containers can be the result.
+ *
+ */
+void tree_flatten(Con *con) {
+    Con *current;
 
     /* Well, we got to abort the recursion here because we destroyed the
      * container. However, if tree_flatten() is called sufficiently often,
      * there can’t be the situation of having two pairs of redundant containers
      * at once. Therefore, we can safely abort the recursion on this level
      * after flattening. */
-    return;
+    if (tree_flatten_con(con))
+        return;
 
-recurse:
     /* We cannot use normal foreach here because tree_flatten might close the
      * current container. */
     current = TAILQ_FIRST(&(con->nodes_head));
@@ -728,3 +1058,29 @@ recurse:
         current = next;
     }
 }
+
+/*
+ * Like tree_flatten(), but only checks the containers whose redundancy can
+ * have changed when con was moved, lost a child or changed its layout: the
+ * children of con, con itself and its ancestors up to the workspace. Does
+ * nothing if con was closed in the meantime.
+ *
+ */
+void tree_flatten_around(Con *con) {
+    if (con == NULL || con_by_con_id((long)con) == NULL)
+        return;
+
+    Con *current = TAILQ_FIRST(&(con->nodes_head));
+    while (current != NULL) {
+        Con *next = TAILQ_NEXT(current, nodes);
+        tree_flatten_con(current);
+        current = next;
+    }
+
+    /* Flattening never closes the parent of the flattened container. */
+    while (con->type == CT_CON) {
+        Con *parent = con->parent;
+        tree_flatten_con(con);
+        con = parent;
+    }
+}
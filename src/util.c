@@ -17,6 +17,7 @@
 #endif
 #include <fcntl.h>
 #include <pwd.h>
+#include <sys/mman.h>
 #include <yajl/yajl_version.h>
 #include <libgen.h>
 #include <ctype.h>
@@ -217,6 +218,46 @@ static char **add_argument(char **original, char *opt_char, char *opt_arg, char
 #define y(x, ...) yajl_gen_##x(gen, ##__VA_ARGS__)
 #define ystr(str) yajl_gen_string(gen, (unsigned char *)str, strlen(str))
 
+/*
+ * Hands the layout to the new process in an anonymous memory file, which is
+ * inherited across execvp() and whose number is passed in the
+ * _I3_RESTART_LAYOUT_FD environment variable. This way, the layout never
+ * touches the file system. Returns false if memfd_create() is not available,
+ * in which case the layout has to be stored in a file.
+ *
+ */
+static bool pass_restart_layout(const unsigned char *payload, size_t length) {
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+    /* Not MFD_CLOEXEC: the new process needs to inherit the file. */
+    int fd = memfd_create("i3-restart-state", 0);
+    if (fd == -1) {
+        DLOG("Could not create a memfd for the restart layout, using a file: %s\n", strerror(errno));
+        return false;
+    }
+
+    if (writeall(fd, payload, length) == -1) {
+        ELOG("Could not write the restart layout to the memfd, using a file: %s\n", strerror(errno));
+        close(fd);
+        return false;
+    }
+
+    char *fdstr = NULL;
+    sasprintf(&fdstr, "%d", fd);
+    setenv("_I3_RESTART_LAYOUT_FD", fdstr, 1);
+    free(fdstr);
+    DLOG("Passing the restart layout (%zu bytes) in fd %d\n", length, fd);
+    return true;
+#else
+    return false;
+#endif
+}
+
+/*
+ * Stores the layout for the new process. Returns the name of the file it was
+ * written to, or NULL if it was passed in memory (see pass_restart_layout())
+ * or could not be stored at all.
+ *
+ */
 static char *store_restart_layout(void) {
     setlocale(LC_NUMERIC, "C");
     yajl_gen gen = yajl_gen_alloc(NULL);
@@ -229,13 +270,25 @@ static char *store_restart_layout(void) {
     size_t length;
     y(get_buf, &payload, &length);
 
+    if (length > 0) {
+        DLOG("layout: %.*s\n", (int)length, payload);
+    }
+
+    /* An explicitly configured restart_state_path is always honored. */
+    if (config.restart_state_path == NULL && pass_restart_layout(payload, length)) {
+        y(free);
+        return NULL;
+    }
+
     /* create a temporary file if one hasn't been specified, or just
      * resolve the tildes in the specified path */
     char *filename;
     if (config.restart_state_path == NULL) {
         filename = get_process_filename("restart-state");
-        if (!filename)
+        if (!filename) {
+            y(free);
             return NULL;
+        }
     } else {
         filename = resolve_tilde(config.restart_state_path);
     }
@@ -253,6 +306,7 @@ static char *store_restart_layout(void) {
     if (fd == -1) {
         perror("open()");
         free(filename);
+        y(free);
         return NULL;
     }
 
@@ -260,15 +314,12 @@ static char *store_restart_layout(void) {
         ELOG("Could not write restart layout to \"%s\", layout will be lost: %s\n", filename, strerror(errno));
         free(filename);
         close(fd);
+        y(free);
         return NULL;
     }
 
     close(fd);
 
-    if (length > 0) {
-        DLOG("layout: %.*s\n", (int)length, payload);
-    }
-
     y(free);
 
     return filename;
@@ -298,11 +349,15 @@ void i3_restart(bool forget_layout) {
         start_argv = add_argument(start_argv, "-d", "all", NULL);
     }
 
-    /* replace -r <file> so that the layout is restored */
+    /* replace -r <file> so that the layout is restored (unless it is passed
+     * in _I3_RESTART_LAYOUT_FD, which takes precedence) */
     if (restart_filename != NULL) {
         start_argv = add_argument(start_argv, "--restart", restart_filename, "-r");
     }
 
+    /* The new process continues the trace. */
+    event_trace_flush();
+
     execvp(start_argv[0], start_argv);
 
     /* not reached */
@@ -507,6 +562,34 @@ ssize_t slurp(const char *path, char **buf) {
     return (ssize_t)n;
 }
 
+/*
+ * Like slurp(), but reads the (regular or memory) file referred to by fd, from
+ * its beginning and regardless of the current offset.
+ *
+ */
+ssize_t slurp_fd(int fd, char **buf) {
+    struct stat stbuf;
+    if (fstat(fd, &stbuf) != 0) {
+        ELOG("Cannot fstat() fd %d: %s\n", fd, strerror(errno));
+        *buf = NULL;
+        return -1;
+    }
+    *buf = scalloc(stbuf.st_size + 1, 1);
+    off_t n = 0;
+    while (n < stbuf.st_size) {
+        const ssize_t ret = pread(fd, *buf + n, stbuf.st_size - n, n);
+        if (ret <= 0) {
+            if (ret == -1 && errno == EINTR)
+                continue;
+            ELOG("fd %d could not be read entirely: got %" PRIi64 ", want %" PRIi64 "\n", fd, (int64_t)n, (int64_t)stbuf.st_size);
+            FREE(*buf);
+            return -1;
+        }
+        n += ret;
+    }
+    return (ssize_t)n;
+}
+
 /*
  * Convert a direction to its corresponding orientation.
  *
@@ -9,16 +9,45 @@
  */
 #include "all.h"
 
+/*
+ * Returns a new generation for a window field which just changed. The counter
+ * is shared by all windows and fields, so that a cached match result can never
+ * be mistaken for one of an older value.
+ *
+ */
+static uint32_t window_next_generation(void) {
+    static uint32_t generation = 0;
+    return ++generation;
+}
+
+/* Windows are allocated from a slab, like containers (see con.c). */
+static slab_t *window_slab;
+
+/*
+ * Allocates a new, zero-initialized i3Window, to be freed with window_free().
+ *
+ */
+i3Window *window_new(void) {
+    if (window_slab == NULL) {
+        window_slab = slab_new("window", sizeof(i3Window));
+        stats_register_slab(window_slab);
+    }
+    return slab_alloc(window_slab);
+}
+
 /*
  * Frees an i3Window and all its members.
  *
  */
 void window_free(i3Window *win) {
-    FREE(win->class_class);
-    FREE(win->class_instance);
+    con_index_remove_window(win->id);
+    sync_request_free(win);
+    intern_release(win->class_class);
+    intern_release(win->class_instance);
+    intern_release(win->role);
     i3string_free(win->name);
     FREE(win->ran_assignments);
-    FREE(win);
+    slab_free(window_slab, win);
 }
 
 /*
@@ -35,19 +64,25 @@ void window_update_class(i3Window *win, xcb_get_property_reply_t *prop) {
 
     /* We cannot use asprintf here since this property contains two
      * null-terminated strings (for compatibility reasons). Instead, we
-     * use strdup() on both strings */
+     * intern both strings */
     const size_t prop_length = xcb_get_property_value_length(prop);
     char *new_class = xcb_get_property_value(prop);
-    const size_t class_class_index = strnlen(new_class, prop_length) + 1;
+    const size_t instance_length = strnlen(new_class, prop_length);
+    const size_t class_class_index = instance_length + 1;
 
-    FREE(win->class_instance);
-    FREE(win->class_class);
+    intern_release(win->class_instance);
+    intern_release(win->class_class);
 
-    win->class_instance = sstrndup(new_class, prop_length);
+    win->class_instance = intern_string(new_class, instance_length);
     if (class_class_index < prop_length)
-        win->class_class = sstrndup(new_class + class_class_index, prop_length - class_class_index);
+        win->class_class = intern_string(new_class + class_class_index,
+                                         strnlen(new_class + class_class_index, prop_length - class_class_index));
     else
         win->class_class = NULL;
+    win->class_generation = window_next_generation();
+    Con *con = con_by_window_id(win->id);
+    if (con != NULL)
+        con_invalidate_tree_representation(con);
     LOG("WM_CLASS changed to %s (instance), %s (class)\n",
         win->class_instance, win->class_class);
 
@@ -72,14 +107,16 @@ void window_update_name(i3Window *win, xcb_get_property_reply_t *prop) {
     const int len = xcb_get_property_value_length(prop);
     char *name = sstrndup(xcb_get_property_value(prop), len);
     win->name = i3string_from_utf8(name);
+    win->name_generation = window_next_generation();
     free(name);
 
     Con *con = con_by_window_id(win->id);
     if (con != NULL && con->title_format != NULL) {
         i3String *name = con_parse_title_format(con);
         ewmh_update_visible_name(win->id, i3string_as_utf8(name));
-        I3STRING_FREE(name);
     }
+    if (con != NULL)
+        con_set_dirty(con);
     win->name_x_changed = true;
     LOG("_NET_WM_NAME changed to \"%s\"\n", i3string_as_utf8(win->name));
 
@@ -112,14 +149,16 @@ void window_update_name_legacy(i3Window *win, xcb_get_property_reply_t *prop) {
     const int len = xcb_get_property_value_length(prop);
     char *name = sstrndup(xcb_get_property_value(prop), len);
     win->name = i3string_from_utf8(name);
+    win->name_generation = window_next_generation();
     free(name);
 
     Con *con = con_by_window_id(win->id);
     if (con != NULL && con->title_format != NULL) {
         i3String *name = con_parse_title_format(con);
         ewmh_update_visible_name(win->id, i3string_as_utf8(name));
-        I3STRING_FREE(name);
     }
+    if (con != NULL)
+        con_set_dirty(con);
 
     LOG("WM_NAME changed to \"%s\"\n", i3string_as_utf8(win->name));
     LOG("Using legacy window title. Note that in order to get Unicode window "
@@ -216,11 +255,10 @@ void window_update_role(i3Window *win, xcb_get_property_reply_t *prop) {
         return;
     }
 
-    char *new_role;
-    sasprintf(&new_role, "%.*s", xcb_get_property_value_length(prop),
-              (char *)xcb_get_property_value(prop));
-    FREE(win->role);
-    win->role = new_role;
+    const char *new_role = xcb_get_property_value(prop);
+    intern_release(win->role);
+    win->role = intern_string(new_role, strnlen(new_role, xcb_get_property_value_length(prop)));
+    win->role_generation = window_next_generation();
     LOG("WM_WINDOW_ROLE changed to \"%s\"\n", win->role);
 
     free(prop);
@@ -398,6 +436,60 @@ void window_update_hints(i3Window *win, xcb_get_property_reply_t *prop, bool *ur
     free(prop);
 }
 
+/*
+ * Updates the supported protocols (WM_TAKE_FOCUS, WM_DELETE_WINDOW and
+ * _NET_WM_SYNC_REQUEST) from WM_PROTOCOLS.
+ *
+ */
+void window_update_protocols(i3Window *win, xcb_get_property_reply_t *prop) {
+    win->needs_take_focus = false;
+    win->supports_delete_window = false;
+    win->supports_sync_request = false;
+
+    if (prop == NULL || xcb_get_property_value_length(prop) == 0) {
+        DLOG("WM_PROTOCOLS not set.\n");
+        FREE(prop);
+        return;
+    }
+
+    xcb_icccm_get_wm_protocols_reply_t protocols;
+    if (!xcb_icccm_get_wm_protocols_from_reply(prop, &protocols)) {
+        DLOG("Could not get WM_PROTOCOLS\n");
+        free(prop);
+        return;
+    }
+
+    for (uint32_t i = 0; i < protocols.atoms_len; i++) {
+        if (protocols.atoms[i] == A_WM_TAKE_FOCUS)
+            win->needs_take_focus = true;
+        else if (protocols.atoms[i] == A_WM_DELETE_WINDOW)
+            win->supports_delete_window = true;
+        else if (protocols.atoms[i] == A__NET_WM_SYNC_REQUEST)
+            win->supports_sync_request = true;
+    }
+
+    /* Also frees prop. */
+    xcb_icccm_get_wm_protocols_reply_wipe(&protocols);
+}
+
+/*
+ * Updates the XSync counter of _NET_WM_SYNC_REQUEST_COUNTER. If the property
+ * holds two counters (extended synchronization), we only use the first one,
+ * which implements basic synchronization.
+ *
+ */
+void window_update_sync_counter(i3Window *win, xcb_get_property_reply_t *prop) {
+    if (prop == NULL || xcb_get_property_value_length(prop) < (int)sizeof(uint32_t)) {
+        DLOG("_NET_WM_SYNC_REQUEST_COUNTER not set.\n");
+        FREE(prop);
+        return;
+    }
+
+    win->sync_counter = *((xcb_sync_counter_t *)xcb_get_property_value(prop));
+    DLOG("Window 0x%08x uses sync counter 0x%08x\n", win->id, win->sync_counter);
+    free(prop);
+}
+
 /*
  * Updates the MOTIF_WM_HINTS. The container's border style should be set to
  * `motif_border_style' if border style is not BS_NORMAL.
@@ -11,6 +11,8 @@
 #include "all.h"
 #include "yajl_utils.h"
 
+#include <ctype.h>
+
 /*
  * Stores a copy of the name of the last used workspace for the workspace
  * back-and-forth switching.
@@ -22,17 +24,254 @@ char *previous_workspace_name = NULL;
  * keybindings. */
 static char **binding_workspace_names = NULL;
 
+/* Lookup indexes for get_existing_workspace_by_name() (keyed by the lower-case
+ * name) and get_existing_workspace_by_num(). Both map to the first matching
+ * workspace in tree order, like a linear search would. They are rebuilt on
+ * the next lookup after workspace_index_invalidate(). */
+static hashmap_t *workspaces_by_name;
+static hashmap_t *workspaces_by_num;
+static bool workspace_index_valid = false;
+
+/* Lookup indexes for the workspace assignments (“workspace <ws> output
+ * <outputs>”), keyed by the exact workspace name, by the workspace number (for
+ * assignments whose name is all digits) and by the lower-case output name. All
+ * map to an assignment_list in configuration order. They are rebuilt on the
+ * next lookup after ws_assignment_index_invalidate(). */
+typedef struct assignment_list {
+    struct assignment_entry {
+        struct Workspace_Assignment *assignment;
+        /* The position in the ws_assignments queue. */
+        size_t position;
+    } * entries;
+    size_t num;
+} assignment_list;
+
+static hashmap_t *assignments_by_name;
+static hashmap_t *assignments_by_num;
+static hashmap_t *assignments_by_output;
+static bool assignment_index_valid = false;
+
+/* The order used by workspace_next() and workspace_prev(), rebuilt together
+ * with the lookup indexes: all workspaces on non-internal outputs in tree
+ * order, the numbered ones sorted by number (then tree order) for binary
+ * searching, the closest named workspace after and before every position,
+ * and what next/prev wrap around to. */
+static struct {
+    Con **workspaces;
+    Con **next_named;
+    Con **prev_named;
+    size_t num_workspaces;
+
+    struct numbered_workspace {
+        Con *workspace;
+        size_t position;
+    } * numbered;
+    size_t num_numbered;
+
+    size_t size;
+    /* Maps a workspace to its position + 1. */
+    hashmap_t *positions;
+
+    Con *next_wrap_named;
+    Con *next_wrap_numbered;
+    Con *prev_wrap_named;
+    Con *prev_wrap_numbered;
+} workspace_order;
+
+/*
+ * Returns a lower-case copy of the given workspace name, which is the key of
+ * workspaces_by_name (workspace names are compared case-insensitively).
+ *
+ */
+static char *workspace_index_key(const char *name) {
+    char *key = sstrdup(name);
+    for (char *walk = key; *walk != '\0'; walk++) {
+        *walk = tolower((unsigned char)*walk);
+    }
+    return key;
+}
+
+static int numbered_workspace_cmp(const void *a, const void *b) {
+    const struct numbered_workspace *first = a, *second = b;
+    if (first->workspace->num != second->workspace->num)
+        return (first->workspace->num < second->workspace->num ? -1 : 1);
+    return (first->position < second->position ? -1 : (first->position > second->position));
+}
+
+/*
+ * Rebuilds workspace_order. The wrap-around targets are determined exactly like
+ * the linear searches in workspace_next() and workspace_prev() used to do it.
+ *
+ */
+static void workspace_order_rebuild(void) {
+    if (workspace_order.positions == NULL)
+        workspace_order.positions = hashmap_new();
+    else
+        hashmap_clear(workspace_order.positions);
+
+    size_t count = 0;
+    Con *output;
+    TAILQ_FOREACH(output, &(croot->nodes_head), nodes) {
+        if (con_is_internal(output))
+            continue;
+        NODES_FOREACH(output_get_content(output)) {
+            if (child->type == CT_WORKSPACE)
+                count++;
+        }
+    }
+    if (count > workspace_order.size) {
+        workspace_order.size = count;
+        workspace_order.workspaces = srealloc(workspace_order.workspaces, count * sizeof(Con *));
+        workspace_order.next_named = srealloc(workspace_order.next_named, count * sizeof(Con *));
+        workspace_order.prev_named = srealloc(workspace_order.prev_named, count * sizeof(Con *));
+        workspace_order.numbered = srealloc(workspace_order.numbered, count * sizeof(struct numbered_workspace));
+    }
+
+    Con *first_numbered = NULL, *first_named_numbered = NULL;
+    size_t n = 0, num_numbered = 0;
+    TAILQ_FOREACH(output, &(croot->nodes_head), nodes) {
+        if (con_is_internal(output))
+            continue;
+        bool past_named = false;
+        NODES_FOREACH(output_get_content(output)) {
+            if (child->type != CT_WORKSPACE)
+                continue;
+            /* Wrapping from a numbered workspace only considers the
+             * workspaces up to the first named one of each output. */
+            if (!past_named) {
+                if (!first_numbered || (child->num != -1 && child->num < first_numbered->num))
+                    first_numbered = child;
+                if (!first_named_numbered && child->num == -1)
+                    first_named_numbered = child;
+                if (child->num == -1)
+                    past_named = true;
+            }
+            if (child->num != -1) {
+                workspace_order.numbered[num_numbered].workspace = child;
+                workspace_order.numbered[num_numbered].position = n;
+                num_numbered++;
+            }
+            hashmap_set(workspace_order.positions, &child, sizeof(Con *), (void *)(uintptr_t)(n + 1));
+            workspace_order.workspaces[n++] = child;
+        }
+    }
+    workspace_order.num_workspaces = n;
+    workspace_order.num_numbered = num_numbered;
+    qsort(workspace_order.numbered, num_numbered, sizeof(struct numbered_workspace), numbered_workspace_cmp);
+    workspace_order.next_wrap_numbered = (first_named_numbered ? first_named_numbered : first_numbered);
+
+    Con *first = NULL, *first_opposite = NULL, *named = NULL;
+    for (size_t i = 0; i < n; i++) {
+        Con *ws = workspace_order.workspaces[i];
+        if (!first)
+            first = ws;
+        if (!first_opposite || (ws->num != -1 && ws->num < first_opposite->num))
+            first_opposite = ws;
+        workspace_order.prev_named[i] = named;
+        if (ws->num == -1)
+            named = ws;
+    }
+    workspace_order.next_wrap_named = (first_opposite ? first_opposite : first);
+
+    Con *last = NULL, *last_numbered = NULL, *last_named = NULL;
+    first_opposite = NULL;
+    named = NULL;
+    for (size_t i = n; i-- > 0;) {
+        Con *ws = workspace_order.workspaces[i];
+        if (!last)
+            last = ws;
+        if (!first_opposite || (ws->num != -1 && ws->num > first_opposite->num))
+            first_opposite = ws;
+        if (!last_numbered || (ws->num != -1 && last_numbered->num < ws->num))
+            last_numbered = ws;
+        if (!last_named && ws->num == -1)
+            last_named = ws;
+        workspace_order.next_named[i] = named;
+        if (ws->num == -1)
+            named = ws;
+    }
+    workspace_order.prev_wrap_named = (first_opposite ? first_opposite : last);
+    workspace_order.prev_wrap_numbered = (last_named ? last_named : last_numbered);
+}
+
+/*
+ * Returns the position of the given workspace in workspace_order, or -1 if it
+ * is not on a non-internal output.
+ *
+ */
+static ssize_t workspace_order_position(Con *ws) {
+    uintptr_t position = (uintptr_t)hashmap_get(workspace_order.positions, &ws, sizeof(Con *));
+    return (ssize_t)position - 1;
+}
+
+/*
+ * Returns the index of the first numbered workspace in workspace_order whose
+ * number is greater than (or, with inclusive, equal to) num.
+ *
+ */
+static size_t workspace_order_bound(int num, bool inclusive) {
+    size_t low = 0, high = workspace_order.num_numbered;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        int mid_num = workspace_order.numbered[mid].workspace->num;
+        if (mid_num < num || (!inclusive && mid_num == num))
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+static void workspace_index_rebuild(void) {
+    if (workspaces_by_name == NULL) {
+        workspaces_by_name = hashmap_new();
+        workspaces_by_num = hashmap_new();
+    } else {
+        hashmap_clear(workspaces_by_name);
+        hashmap_clear(workspaces_by_num);
+    }
+
+    Con *output, *workspace;
+    TAILQ_FOREACH(output, &(croot->nodes_head), nodes) {
+        Con *content = output_get_content(output);
+        if (content == NULL)
+            continue;
+        TAILQ_FOREACH(workspace, &(content->nodes_head), nodes) {
+            if (workspace->name != NULL) {
+                char *key = workspace_index_key(workspace->name);
+                if (hashmap_get(workspaces_by_name, key, strlen(key)) == NULL)
+                    hashmap_set(workspaces_by_name, key, strlen(key), workspace);
+                free(key);
+            }
+            if (hashmap_get(workspaces_by_num, &(workspace->num), sizeof(int)) == NULL)
+                hashmap_set(workspaces_by_num, &(workspace->num), sizeof(int), workspace);
+        }
+    }
+    workspace_order_rebuild();
+    workspace_index_valid = true;
+}
+
+/*
+ * Marks the workspace lookup indexes as outdated. Needs to be called whenever
+ * workspaces are added, removed, renamed, renumbered or reordered.
+ *
+ */
+void workspace_index_invalidate(void) {
+    workspace_index_valid = false;
+}
+
 /*
  * Returns the workspace with the given name or NULL if such a workspace does
  * not exist.
  *
  */
 Con *get_existing_workspace_by_name(const char *name) {
-    Con *output, *workspace = NULL;
-    TAILQ_FOREACH(output, &(croot->nodes_head), nodes) {
-        GREP_FIRST(workspace, output_get_content(output), !strcasecmp(child->name, name));
-    }
+    if (!workspace_index_valid)
+        workspace_index_rebuild();
 
+    char *key = workspace_index_key(name);
+    Con *workspace = hashmap_get(workspaces_by_name, key, strlen(key));
+    free(key);
     return workspace;
 }
 
@@ -42,12 +281,10 @@ Con *get_existing_workspace_by_name(const char *name) {
  *
  */
 Con *get_existing_workspace_by_num(int num) {
-    Con *output, *workspace = NULL;
-    TAILQ_FOREACH(output, &(croot->nodes_head), nodes) {
-        GREP_FIRST(workspace, output_get_content(output), child->num == num);
-    }
+    if (!workspace_index_valid)
+        workspace_index_rebuild();
 
-    return workspace;
+    return hashmap_get(workspaces_by_num, &num, sizeof(int));
 }
 
 /*
@@ -70,6 +307,66 @@ static void _workspace_apply_default_orientation(Con *ws) {
     }
 }
 
+static void assignment_list_free(const void *key, size_t keylen, void *value, void *userdata) {
+    assignment_list *list = value;
+    free(list->entries);
+    free(list);
+}
+
+static void assignment_list_append(hashmap_t *map, const void *key, size_t keylen,
+                                   struct Workspace_Assignment *assignment, size_t position) {
+    assignment_list *list = hashmap_get(map, key, keylen);
+    if (list == NULL) {
+        list = scalloc(1, sizeof(assignment_list));
+        hashmap_set(map, key, keylen, list);
+    }
+    list->entries = srealloc(list->entries, (list->num + 1) * sizeof(struct assignment_entry));
+    list->entries[list->num].assignment = assignment;
+    list->entries[list->num].position = position;
+    list->num++;
+}
+
+static void assignment_index_rebuild(void) {
+    if (assignments_by_name == NULL) {
+        assignments_by_name = hashmap_new();
+        assignments_by_num = hashmap_new();
+        assignments_by_output = hashmap_new();
+    } else {
+        hashmap_t *maps[] = {assignments_by_name, assignments_by_num, assignments_by_output};
+        for (size_t i = 0; i < sizeof(maps) / sizeof(maps[0]); i++) {
+            hashmap_foreach(maps[i], assignment_list_free, NULL);
+            hashmap_clear(maps[i]);
+        }
+    }
+
+    size_t position = 0;
+    struct Workspace_Assignment *assignment;
+    TAILQ_FOREACH(assignment, &ws_assignments, ws_assignments) {
+        assignment_list_append(assignments_by_name, assignment->name, strlen(assignment->name),
+                               assignment, position);
+        if (name_is_digits(assignment->name)) {
+            long num = ws_name_to_number(assignment->name);
+            assignment_list_append(assignments_by_num, &num, sizeof(long), assignment, position);
+        }
+        if (assignment->output != NULL) {
+            char *key = workspace_index_key(assignment->output);
+            assignment_list_append(assignments_by_output, key, strlen(key), assignment, position);
+            free(key);
+        }
+        position++;
+    }
+    assignment_index_valid = true;
+}
+
+/*
+ * Marks the workspace assignment lookup indexes as outdated. Needs to be called
+ * whenever the ws_assignments queue changes.
+ *
+ */
+void ws_assignment_index_invalidate(void) {
+    assignment_index_valid = false;
+}
+
 /*
  * Returns the first output that is assigned to a workspace specified by the
  * given name or number or NULL if no such output exists. If there is a
@@ -82,29 +379,89 @@ static void _workspace_apply_default_orientation(Con *ws) {
  *
  */
 static Con *get_assigned_output(const char *name, long parsed_num) {
-    Con *output = NULL;
-    struct Workspace_Assignment *assignment;
-    TAILQ_FOREACH(assignment, &ws_assignments, ws_assignments) {
-        if (name && strcmp(assignment->name, name) == 0) {
-            DLOG("Found workspace name assignment to output \"%s\"\n", assignment->output);
-            Output *assigned_by_name = get_output_by_name(assignment->output, true);
+    if (!assignment_index_valid)
+        assignment_index_rebuild();
+
+    if (name) {
+        assignment_list *list = hashmap_get(assignments_by_name, name, strlen(name));
+        for (size_t i = 0; list != NULL && i < list->num; i++) {
+            DLOG("Found workspace name assignment to output \"%s\"\n", list->entries[i].assignment->output);
+            Output *assigned_by_name = get_output_by_name(list->entries[i].assignment->output, true);
             if (assigned_by_name) {
                 /* When the name matches exactly, skip numbered assignments. */
                 return assigned_by_name->con;
             }
-        } else if (!output && /* Only keep the first numbered assignment. */
-                   parsed_num != -1 &&
-                   name_is_digits(assignment->name) &&
-                   ws_name_to_number(assignment->name) == parsed_num) {
+        }
+    }
+
+    if (parsed_num != -1) {
+        assignment_list *list = hashmap_get(assignments_by_num, &parsed_num, sizeof(long));
+        for (size_t i = 0; list != NULL && i < list->num; i++) {
+            struct Workspace_Assignment *assignment = list->entries[i].assignment;
+            /* Assignments whose name matches exactly were handled above. */
+            if (name && strcmp(assignment->name, name) == 0)
+                continue;
             DLOG("Found workspace number assignment to output \"%s\"\n", assignment->output);
             Output *assigned_by_num = get_output_by_name(assignment->output, true);
             if (assigned_by_num) {
-                output = assigned_by_num->con;
+                /* Only keep the first numbered assignment. */
+                return assigned_by_num->con;
             }
         }
     }
 
-    return output;
+    return NULL;
+}
+
+static int assignment_entry_cmp(const void *a, const void *b) {
+    const struct assignment_entry *first = a, *second = b;
+    return (first->position < second->position ? -1 : (first->position > second->position));
+}
+
+static void append_assignment_entries(struct assignment_entry **entries, size_t *num, const char *output_name) {
+    char *key = workspace_index_key(output_name);
+    assignment_list *list = hashmap_get(assignments_by_output, key, strlen(key));
+    free(key);
+    if (list == NULL)
+        return;
+
+    *entries = srealloc(*entries, (*num + list->num) * sizeof(struct assignment_entry));
+    memcpy(*entries + *num, list->entries, list->num * sizeof(struct assignment_entry));
+    *num += list->num;
+}
+
+/*
+ * Returns the workspace assignments which trigger for the given output (see
+ * output_triggers_assignment()), in the order of the 'ws_assignments' queue.
+ * Only the assignments naming one of the output’s names (or “primary”) are
+ * looked at, so this does not depend on the total number of assignments.
+ * The returned array is NULL-terminated and must be freed by the caller.
+ *
+ */
+struct Workspace_Assignment **ws_assignments_for_output(Output *output) {
+    if (!assignment_index_valid)
+        assignment_index_rebuild();
+
+    struct assignment_entry *candidates = NULL;
+    size_t num_candidates = 0;
+    struct output_name *output_name;
+    SLIST_FOREACH(output_name, &(output->names_head), names) {
+        append_assignment_entries(&candidates, &num_candidates, output_name->name);
+    }
+    if (output->primary)
+        append_assignment_entries(&candidates, &num_candidates, "primary");
+    /* Each list is in queue order already, they only need to be merged. */
+    qsort(candidates, num_candidates, sizeof(struct assignment_entry), assignment_entry_cmp);
+
+    struct Workspace_Assignment **result = smalloc((num_candidates + 1) * sizeof(struct Workspace_Assignment *));
+    size_t n = 0;
+    for (size_t i = 0; i < num_candidates; i++) {
+        if (output_triggers_assignment(output, candidates[i].assignment))
+            result[n++] = candidates[i].assignment;
+    }
+    result[n] = NULL;
+    free(candidates);
+    return result;
 }
 
 /*
@@ -305,66 +662,56 @@ bool workspace_is_visible(Con *ws) {
     return (fs == ws);
 }
 
+struct reassign_sticky_data {
+    Con *workspace;
+    /* The sticky containers which got a window in this pass. Sticky
+     * containers inside of them are left alone. */
+    Con **reassigned;
+    int num_reassigned;
+};
+
 /*
- * XXX: we need to clean up all this recursive walking code.
+ * Returns true if con is inside one of the given containers.
  *
  */
-static Con *_get_sticky(Con *con, const char *sticky_group, Con *exclude) {
-    Con *current;
-
-    TAILQ_FOREACH(current, &(con->nodes_head), nodes) {
-        if (current != exclude &&
-            current->sticky_group != NULL &&
-            current->window != NULL &&
-            strcmp(current->sticky_group, sticky_group) == 0)
-            return current;
-
-        Con *recurse = _get_sticky(current, sticky_group, exclude);
-        if (recurse != NULL)
-            return recurse;
-    }
-
-    TAILQ_FOREACH(current, &(con->floating_head), floating_windows) {
-        if (current != exclude &&
-            current->sticky_group != NULL &&
-            current->window != NULL &&
-            strcmp(current->sticky_group, sticky_group) == 0)
-            return current;
-
-        Con *recurse = _get_sticky(current, sticky_group, exclude);
-        if (recurse != NULL)
-            return recurse;
+static bool con_is_inside_any(Con *con, Con **cons, int num_cons) {
+    for (Con *parent = con->parent; parent != NULL; parent = parent->parent) {
+        for (int i = 0; i < num_cons; i++) {
+            if (cons[i] == parent)
+                return true;
+        }
     }
-
-    return NULL;
+    return false;
 }
 
 /*
- * Reassigns all child windows in sticky containers. Called when the user
- * changes workspaces.
- *
- * XXX: what about sticky containers which contain containers?
+ * Moves a window of the sticky group into each member of the group on the
+ * workspace which is being shown, see workspace_reassign_sticky().
  *
  */
-static void workspace_reassign_sticky(Con *con) {
-    Con *current;
-    /* 1: go through all containers */
-
-    /* handle all children and floating windows of this node */
-    TAILQ_FOREACH(current, &(con->nodes_head), nodes) {
-        if (current->sticky_group == NULL) {
-            workspace_reassign_sticky(current);
+static void reassign_sticky_group_cb(Con **members, int num_members, void *userdata) {
+    struct reassign_sticky_data *data = userdata;
+
+    for (int i = 0; i < num_members; i++) {
+        Con *current = members[i];
+        if (current == data->workspace ||
+            con_get_workspace(current) != data->workspace ||
+            con_is_inside_any(current, data->reassigned, data->num_reassigned))
             continue;
-        }
 
         LOG("Ah, this one is sticky: %s / %p\n", current->name, current);
-        /* 2: find a window which we can re-assign */
+        /* find a window of the same group on this output which we can
+         * re-assign */
         Con *output = con_get_output(current);
-        Con *src = _get_sticky(output, current->sticky_group, current);
+        Con *src = NULL;
+        for (int j = 0; j < num_members && src == NULL; j++) {
+            if (members[j] != current && members[j]->window != NULL &&
+                con_get_output(members[j]) == output)
+                src = members[j];
+        }
 
         if (src == NULL) {
             LOG("No window found for this sticky group\n");
-            workspace_reassign_sticky(current);
             continue;
         }
 
@@ -373,14 +720,36 @@ static void workspace_reassign_sticky(Con *con) {
         current->mapped = true;
         src->window = NULL;
         src->mapped = false;
+        con_invalidate_tree_representation(current);
+        con_invalidate_tree_representation(src);
+        con_index_add(current);
 
         x_reparent_child(current, src);
 
         LOG("re-assigned window from src %p to dest %p\n", src, current);
+
+        data->reassigned = srealloc(data->reassigned, (data->num_reassigned + 1) * sizeof(Con *));
+        data->reassigned[data->num_reassigned++] = current;
     }
+}
 
-    TAILQ_FOREACH(current, &(con->floating_head), floating_windows)
-    workspace_reassign_sticky(current);
+/*
+ * Reassigns all child windows in sticky containers. Called when the user
+ * changes workspaces. Only the members of sticky groups are looked at (see
+ * con_foreach_sticky_group()), so this costs nothing when no sticky groups
+ * are used.
+ *
+ * XXX: what about sticky containers which contain containers?
+ *
+ */
+static void workspace_reassign_sticky(Con *workspace) {
+    struct reassign_sticky_data data = {
+        .workspace = workspace,
+        .reassigned = NULL,
+        .num_reassigned = 0,
+    };
+    con_foreach_sticky_group(reassign_sticky_group_cb, &data);
+    free(data.reassigned);
 }
 
 /*
@@ -389,10 +758,9 @@ static void workspace_reassign_sticky(Con *con) {
  * focusing the con.
  *
  */
-static void workspace_defer_update_urgent_hint_cb(EV_P_ ev_timer *w, int revents) {
-    Con *con = w->data;
+static void workspace_defer_update_urgent_hint_cb(wheel_timer *timer) {
+    Con *con = timer->data;
 
-    ev_timer_stop(main_loop, con->urgency_timer);
     FREE(con->urgency_timer);
 
     if (con->urgent) {
@@ -401,7 +769,7 @@ static void workspace_defer_update_urgent_hint_cb(EV_P_ ev_timer *w, int revents
         con_update_parents_urgency(con);
         workspace_update_urgent_flag(con_get_workspace(con));
         ipc_send_window_event("urgent", con);
-        tree_render();
+        tree_schedule_render();
     }
 }
 
@@ -427,12 +795,19 @@ void workspace_show(Con *workspace) {
     /* enable fullscreen for the target workspace. If it happens to be the
      * same one we are currently on anyways, we can stop here. */
     workspace->fullscreen_mode = CF_OUTPUT;
+    /* Bring everything that was skipped while the workspace was hidden up to
+     * date in the next x_push_changes(). */
+    con_wake_workspace(workspace);
     current = con_get_workspace(focused);
     if (workspace == current) {
         DLOG("Not switching, already there.\n");
         return;
     }
 
+    /* The next x_push_changes() sends the whole switch at once, the IPC
+     * events and _NET_CURRENT_DESKTOP follow afterwards. */
+    x_begin_workspace_switch();
+
     /* Used to correctly update focus when pushing sticky windows. Holds the
      * previously focused container in the same output as workspace. For
      * example, if a sticky window is focused and then we switch focus to a
@@ -464,29 +839,25 @@ void workspace_show(Con *workspace) {
      * focus and thereby immediately destroy it */
     if (next->urgent && (int)(config.workspace_urgency_timer * 1000) > 0) {
         /* focus for now… */
-        next->urgent = false;
+        con_set_urgent_flag(next, false);
         con_focus(next);
 
         /* … but immediately reset urgency flags; they will be set to false by
          * the timer callback in case the container is focused at the time of
          * its expiration */
-        focused->urgent = true;
+        con_set_urgent_flag(focused, true);
         workspace->urgent = true;
 
         if (focused->urgency_timer == NULL) {
             DLOG("Deferring reset of urgency flag of con %p on newly shown workspace %p\n",
                  focused, workspace);
-            focused->urgency_timer = scalloc(1, sizeof(struct ev_timer));
-            /* use a repeating timer to allow for easy resets */
-            ev_timer_init(focused->urgency_timer, workspace_defer_update_urgent_hint_cb,
-                          config.workspace_urgency_timer, config.workspace_urgency_timer);
-            focused->urgency_timer->data = focused;
-            ev_timer_start(main_loop, focused->urgency_timer);
+            focused->urgency_timer = scalloc(1, sizeof(struct wheel_timer));
+            wheel_timer_init(focused->urgency_timer, workspace_defer_update_urgent_hint_cb, focused);
         } else {
             DLOG("Resetting urgency timer of con %p on workspace %p\n",
                  focused, workspace);
-            ev_timer_again(main_loop, focused->urgency_timer);
         }
+        wheel_timer_start(focused->urgency_timer, config.workspace_urgency_timer);
     } else
         con_focus(next);
 
@@ -502,15 +873,19 @@ void workspace_show(Con *workspace) {
         /* check if this workspace is currently visible */
         if (!workspace_is_visible(old)) {
             LOG("Closing old workspace (%p / %s), it is empty\n", old, old->name);
-            yajl_gen gen = ipc_marshal_workspace_event("empty", old, NULL);
+            /* The event has to be marshalled before the workspace is freed. */
+            yajl_gen gen = NULL;
+            struct ipc_event_info info;
+            ipc_event_info_init(&info, "empty", old);
+            if (ipc_event_has_recipients(I3_IPC_EVENT_WORKSPACE, &info))
+                gen = ipc_marshal_workspace_event("empty", old, NULL);
             tree_close_internal(old, DONT_KILL_WINDOW, false);
 
-            const unsigned char *payload;
-            ylength length;
-            y(get_buf, &payload, &length);
-            ipc_send_event("workspace", I3_IPC_EVENT_WORKSPACE, (const char *)payload);
-
-            y(free);
+            if (gen != NULL) {
+                ipc_send_event_gen(I3_IPC_EVENT_WORKSPACE, gen, &info);
+                ipc_gen_put(gen);
+            }
+            ipc_event_info_free(&info);
 
             /* Avoid calling output_push_sticky_windows later with a freed container. */
             if (old == old_focus) {
@@ -530,9 +905,6 @@ void workspace_show(Con *workspace) {
         x_set_warp_to(&next->rect);
     }
 
-    /* Update the EWMH hints */
-    ewmh_update_current_desktop();
-
     /* Push any sticky windows to the now visible workspace. */
     output_push_sticky_windows(old_focus);
 }
@@ -553,61 +925,27 @@ void workspace_show_by_name(const char *num) {
  */
 Con *workspace_next(void) {
     Con *current = con_get_workspace(focused);
-    Con *next = NULL, *first = NULL, *first_opposite = NULL;
-    Con *output;
+    Con *next;
+
+    if (!workspace_index_valid)
+        workspace_index_rebuild();
 
     if (current->num == -1) {
         /* If currently a named workspace, find next named workspace. */
         if ((next = TAILQ_NEXT(current, nodes)) != NULL)
             return next;
-        bool found_current = false;
-        TAILQ_FOREACH(output, &(croot->nodes_head), nodes) {
-            /* Skip outputs starting with __, they are internal. */
-            if (con_is_internal(output))
-                continue;
-            NODES_FOREACH(output_get_content(output)) {
-                if (child->type != CT_WORKSPACE)
-                    continue;
-                if (!first)
-                    first = child;
-                if (!first_opposite || (child->num != -1 && child->num < first_opposite->num))
-                    first_opposite = child;
-                if (child == current) {
-                    found_current = true;
-                } else if (child->num == -1 && found_current) {
-                    next = child;
-                    return next;
-                }
-            }
-        }
-    } else {
-        /* If currently a numbered workspace, find next numbered workspace. */
-        TAILQ_FOREACH(output, &(croot->nodes_head), nodes) {
-            /* Skip outputs starting with __, they are internal. */
-            if (con_is_internal(output))
-                continue;
-            NODES_FOREACH(output_get_content(output)) {
-                if (child->type != CT_WORKSPACE)
-                    continue;
-                if (!first || (child->num != -1 && child->num < first->num))
-                    first = child;
-                if (!first_opposite && child->num == -1)
-                    first_opposite = child;
-                if (child->num == -1)
-                    break;
-                /* Need to check child against current and next because we are
-                 * traversing multiple lists and thus are not guaranteed the
-                 * relative order between the list of workspaces. */
-                if (current->num < child->num && (!next || child->num < next->num))
-                    next = child;
-            }
-        }
+        ssize_t position = workspace_order_position(current);
+        if (position != -1 && workspace_order.next_named[position] != NULL)
+            return workspace_order.next_named[position];
+        return workspace_order.next_wrap_named;
     }
 
-    if (!next)
-        next = first_opposite ? first_opposite : first;
-
-    return next;
+    /* If currently a numbered workspace, find next numbered workspace. Of
+     * workspaces with the same number, the first one in tree order is used. */
+    size_t idx = workspace_order_bound(current->num, false);
+    if (idx < workspace_order.num_numbered)
+        return workspace_order.numbered[idx].workspace;
+    return workspace_order.next_wrap_numbered;
 }
 
 /*
@@ -616,176 +954,87 @@ Con *workspace_next(void) {
  */
 Con *workspace_prev(void) {
     Con *current = con_get_workspace(focused);
-    Con *prev = NULL, *first_opposite = NULL, *last = NULL;
-    Con *output;
+    Con *prev;
+
+    if (!workspace_index_valid)
+        workspace_index_rebuild();
 
     if (current->num == -1) {
         /* If named workspace, find previous named workspace. */
         prev = TAILQ_PREV(current, nodes_head, nodes);
-        if (prev && prev->num != -1)
-            prev = NULL;
-        if (!prev) {
-            bool found_current = false;
-            TAILQ_FOREACH_REVERSE(output, &(croot->nodes_head), nodes_head, nodes) {
-                /* Skip outputs starting with __, they are internal. */
-                if (con_is_internal(output))
-                    continue;
-                NODES_FOREACH_REVERSE(output_get_content(output)) {
-                    if (child->type != CT_WORKSPACE)
-                        continue;
-                    if (!last)
-                        last = child;
-                    if (!first_opposite || (child->num != -1 && child->num > first_opposite->num))
-                        first_opposite = child;
-                    if (child == current) {
-                        found_current = true;
-                    } else if (child->num == -1 && found_current) {
-                        prev = child;
-                        return prev;
-                    }
-                }
-            }
-        }
-    } else {
-        /* If numbered workspace, find previous numbered workspace. */
-        TAILQ_FOREACH_REVERSE(output, &(croot->nodes_head), nodes_head, nodes) {
-            /* Skip outputs starting with __, they are internal. */
-            if (con_is_internal(output))
-                continue;
-            NODES_FOREACH_REVERSE(output_get_content(output)) {
-                if (child->type != CT_WORKSPACE)
-                    continue;
-                if (!last || (child->num != -1 && last->num < child->num))
-                    last = child;
-                if (!first_opposite && child->num == -1)
-                    first_opposite = child;
-                if (child->num == -1)
-                    continue;
-                /* Need to check child against current and previous because we
-                 * are traversing multiple lists and thus are not guaranteed
-                 * the relative order between the list of workspaces. */
-                if (current->num > child->num && (!prev || child->num > prev->num))
-                    prev = child;
-            }
-        }
+        if (prev && prev->num == -1)
+            return prev;
+        ssize_t position = workspace_order_position(current);
+        if (position != -1 && workspace_order.prev_named[position] != NULL)
+            return workspace_order.prev_named[position];
+        return workspace_order.prev_wrap_named;
     }
 
-    if (!prev)
-        prev = first_opposite ? first_opposite : last;
-
-    return prev;
+    /* If numbered workspace, find previous numbered workspace. Of workspaces
+     * with the same number, the last one in tree order is used. */
+    size_t idx = workspace_order_bound(current->num, true);
+    if (idx > 0)
+        return workspace_order.numbered[idx - 1].workspace;
+    return workspace_order.prev_wrap_numbered;
 }
 
 /*
  * Focuses the next workspace on the same output.
  *
+ * The workspaces of an output are sorted: the numbered ones by number, followed
+ * by the named ones (see _con_attach()), so the next workspace is the first
+ * sibling after the current one which has a greater number or is named, or
+ * else the first workspace of the output.
+ *
  */
 Con *workspace_next_on_output(void) {
     Con *current = con_get_workspace(focused);
-    Con *next = NULL;
     Con *output = con_get_output(focused);
+    Con *next = current;
 
-    if (current->num == -1) {
-        /* If currently a named workspace, find next named workspace. */
-        next = TAILQ_NEXT(current, nodes);
-    } else {
-        /* If currently a numbered workspace, find next numbered workspace. */
-        NODES_FOREACH(output_get_content(output)) {
-            if (child->type != CT_WORKSPACE)
-                continue;
-            if (child->num == -1)
-                break;
-            /* Need to check child against current and next because we are
-             * traversing multiple lists and thus are not guaranteed the
-             * relative order between the list of workspaces. */
-            if (current->num < child->num && (!next || child->num < next->num))
-                next = child;
-        }
-    }
-
-    /* Find next named workspace. */
-    if (!next) {
-        bool found_current = false;
-        NODES_FOREACH(output_get_content(output)) {
-            if (child->type != CT_WORKSPACE)
-                continue;
-            if (child == current) {
-                found_current = true;
-            } else if (child->num == -1 && (current->num != -1 || found_current)) {
-                next = child;
-                goto workspace_next_on_output_end;
-            }
-        }
+    while ((next = TAILQ_NEXT(next, nodes)) != NULL) {
+        if (next->type != CT_WORKSPACE)
+            continue;
+        if (current->num == -1 || next->num == -1 || next->num > current->num)
+            return next;
     }
 
     /* Find first workspace. */
-    if (!next) {
-        NODES_FOREACH(output_get_content(output)) {
-            if (child->type != CT_WORKSPACE)
-                continue;
-            if (!next || (child->num != -1 && child->num < next->num))
-                next = child;
-        }
+    NODES_FOREACH(output_get_content(output)) {
+        if (child->type == CT_WORKSPACE)
+            return child;
     }
-workspace_next_on_output_end:
-    return next;
+    return NULL;
 }
 
 /*
  * Focuses the previous workspace on same output.
  *
+ * Like workspace_next_on_output(), this relies on the order of the workspaces
+ * of an output: the previous workspace is the first sibling before the current
+ * one which is named or has a smaller number, or else the last workspace of the
+ * output.
+ *
  */
 Con *workspace_prev_on_output(void) {
     Con *current = con_get_workspace(focused);
-    Con *prev = NULL;
     Con *output = con_get_output(focused);
+    Con *prev = current;
     DLOG("output = %s\n", output->name);
 
-    if (current->num == -1) {
-        /* If named workspace, find previous named workspace. */
-        prev = TAILQ_PREV(current, nodes_head, nodes);
-        if (prev && prev->num != -1)
-            prev = NULL;
-    } else {
-        /* If numbered workspace, find previous numbered workspace. */
-        NODES_FOREACH_REVERSE(output_get_content(output)) {
-            if (child->type != CT_WORKSPACE || child->num == -1)
-                continue;
-            /* Need to check child against current and previous because we
-             * are traversing multiple lists and thus are not guaranteed
-             * the relative order between the list of workspaces. */
-            if (current->num > child->num && (!prev || child->num > prev->num))
-                prev = child;
-        }
-    }
-
-    /* Find previous named workspace. */
-    if (!prev) {
-        bool found_current = false;
-        NODES_FOREACH_REVERSE(output_get_content(output)) {
-            if (child->type != CT_WORKSPACE)
-                continue;
-            if (child == current) {
-                found_current = true;
-            } else if (child->num == -1 && (current->num != -1 || found_current)) {
-                prev = child;
-                goto workspace_prev_on_output_end;
-            }
-        }
+    while ((prev = TAILQ_PREV(prev, nodes_head, nodes)) != NULL) {
+        if (prev->type != CT_WORKSPACE)
+            continue;
+        if (current->num == -1 || prev->num < current->num)
+            return prev;
     }
 
     /* Find last workspace. */
-    if (!prev) {
-        NODES_FOREACH_REVERSE(output_get_content(output)) {
-            if (child->type != CT_WORKSPACE)
-                continue;
-            if (!prev || child->num > prev->num)
-                prev = child;
-        }
+    NODES_FOREACH_REVERSE(output_get_content(output)) {
+        if (child->type == CT_WORKSPACE)
+            return child;
     }
-
-workspace_prev_on_output_end:
-    return prev;
+    return NULL;
 }
 
 /*
@@ -817,27 +1066,14 @@ Con *workspace_back_and_forth_get(void) {
     return workspace;
 }
 
-static bool get_urgency_flag(Con *con) {
-    Con *child;
-    TAILQ_FOREACH(child, &(con->nodes_head), nodes)
-    if (child->urgent || get_urgency_flag(child))
-        return true;
-
-    TAILQ_FOREACH(child, &(con->floating_head), floating_windows)
-    if (child->urgent || get_urgency_flag(child))
-        return true;
-
-    return false;
-}
-
 /*
- * Goes through all clients on the given workspace and updates the workspace’s
- * urgent flag accordingly.
+ * Updates the workspace’s urgent flag from the number of urgent containers on
+ * it (see Con.urgent_descendants).
  *
  */
 void workspace_update_urgent_flag(Con *ws) {
     bool old_flag = ws->urgent;
-    ws->urgent = get_urgency_flag(ws);
+    ws->urgent = (ws->urgent_descendants > 0);
     DLOG("Workspace urgency flag changed from %d to %d\n", old_flag, ws->urgent);
 
     if (old_flag != ws->urgent)
@@ -872,6 +1108,7 @@ void ws_force_orientation(Con *ws, orientation_t orientation) {
 
     /* 4: switch workspace layout */
     ws->layout = (orientation == HORIZ) ? L_SPLITH : L_SPLITV;
+    con_invalidate_tree_representation(ws);
     DLOG("split->layout = %d, ws->layout = %d\n", split->layout, ws->layout);
 
     /* 5: attach the new split container to the workspace */
@@ -981,13 +1218,11 @@ void workspace_move_to_output(Con *ws, Output *output) {
 
         /* check if we can find a workspace assigned to this output */
         bool used_assignment = false;
-        struct Workspace_Assignment *assignment;
-        TAILQ_FOREACH(assignment, &ws_assignments, ws_assignments) {
+        struct Workspace_Assignment **assignments = ws_assignments_for_output(current_output);
+        for (struct Workspace_Assignment **walk = assignments; *walk != NULL; walk++) {
+            struct Workspace_Assignment *assignment = *walk;
             bool attached;
             int num;
-            if (!output_triggers_assignment(current_output, assignment)) {
-                continue;
-            }
             /* check if this workspace's name or num is already attached to the tree */
             num = ws_name_to_number(assignment->name);
             attached = ((num == -1) ? get_existing_workspace_by_name(assignment->name) : get_existing_workspace_by_num(num)) != NULL;
@@ -1001,6 +1236,7 @@ void workspace_move_to_output(Con *ws, Output *output) {
             used_assignment = true;
             break;
         }
+        free(assignments);
 
         /* if we couldn't create the workspace using an assignment, create it on
          * the output. Workspace init IPC events are sent either by
@@ -8,12 +8,17 @@
  *      render.c). Basically a big state machine.
  *
  */
+#define LOG_CATEGORY LOG_CATEGORY_X
 #include "all.h"
 
 #ifndef MAX
 #define MAX(x, y) ((x) > (y) ? (x) : (y))
 #endif
 
+/* Title bars narrower than this only get their background and border, see
+ * x_draw_title_bar(). */
+#define TITLE_MIN_WIDTH (config.font.height + 2 * logical_px(2))
+
 xcb_window_t ewmh_window;
 
 /* Stores the X11 window ID of the currently focused window */
@@ -27,6 +32,19 @@ static xcb_window_t last_focused = XCB_NONE;
 /* Stores coordinates to warp mouse pointer to if set */
 static Rect *warp_to;
 
+/* The pointer position as reported by the most recent event which contained
+ * it, see x_set_pointer_position(). */
+static struct {
+    bool known;
+    int16_t x;
+    int16_t y;
+    xcb_timestamp_t time;
+} pointer_position;
+
+/* Whether a workspace switch is waiting for the next x_push_changes(), see
+ * x_begin_workspace_switch(). */
+static bool workspace_switch_pending = false;
+
 /*
  * Describes the X11 state we may modify (map state, position, window stack).
  * There is one entry per container. The state represents the current situation
@@ -42,6 +60,9 @@ typedef struct con_state {
     bool child_mapped;
     bool is_hidden;
 
+    /* Whether the frame window was created already, see x_con_init(). */
+    bool frame_created;
+
     /* The con for which this state is. */
     Con *con;
 
@@ -58,9 +79,20 @@ typedef struct con_state {
 
     Rect rect;
     Rect window_rect;
+    Rect deco_rect;
+
+    /* The actual size and depth of the frame_buffer pixmap, which can be
+     * larger than the surface (see x_acquire_frame_buffer()). */
+    int pixmap_width;
+    int pixmap_height;
+    uint16_t pixmap_depth;
 
     bool initial;
 
+    /* The position in old_state_head (from the bottom), only valid during
+     * x_restack(). */
+    int old_position;
+
     char *name;
 
     CIRCLEQ_ENTRY(con_state)
@@ -73,6 +105,28 @@ typedef struct con_state {
     initial_mapping_order;
 } con_state;
 
+/* Released frame buffers are kept around for reuse, up to this many and
+ * this many pixels in total (about 64 MiB at 32 bits per pixel). */
+#define FRAME_BUFFER_POOL_SIZE 32
+#define FRAME_BUFFER_POOL_MAX_PIXELS (16 * 1024 * 1024)
+
+/*
+ * A frame buffer (pixmap and surface) which is not used by any container
+ * right now, see x_release_frame_buffer().
+ *
+ */
+struct pooled_frame_buffer {
+    surface_t surface;
+    int width;
+    int height;
+    uint16_t depth;
+};
+
+/* Ordered from the least to the most recently released buffer. */
+static struct pooled_frame_buffer frame_buffer_pool[FRAME_BUFFER_POOL_SIZE];
+static int frame_buffer_pool_len = 0;
+static int64_t frame_buffer_pool_pixels = 0;
+
 CIRCLEQ_HEAD(state_head, con_state)
 state_head =
     CIRCLEQ_HEAD_INITIALIZER(state_head);
@@ -85,6 +139,10 @@ TAILQ_HEAD(initial_mapping_head, con_state)
 initial_mapping_head =
     TAILQ_HEAD_INITIALIZER(initial_mapping_head);
 
+/* Maps frame IDs to their con_state, so that state_for_frame() does not need
+ * to walk state_head (it is called for every container on every render). */
+static hashmap_t *state_index;
+
 /*
  * Returns the container state for the given frame. This function always
  * returns a container state (otherwise, there is a bug in the code and the
@@ -93,9 +151,9 @@ initial_mapping_head =
  *
  */
 static con_state *state_for_frame(xcb_window_t window) {
-    con_state *state;
-    CIRCLEQ_FOREACH(state, &state_head, state)
-    if (state->id == window)
+    con_state *state = NULL;
+    if (state_index != NULL &&
+        (state = hashmap_get(state_index, &window, sizeof(xcb_window_t))) != NULL)
         return state;
 
     /* TODO: better error handling? */
@@ -104,6 +162,136 @@ static con_state *state_for_frame(xcb_window_t window) {
     return NULL;
 }
 
+/*
+ * Returns true if a frame buffer pixmap of the given size can be used for a
+ * surface of the given size without wasting too much memory.
+ *
+ */
+static bool frame_buffer_fits(int pixmap_width, int pixmap_height, int width, int height) {
+    return pixmap_width >= width && pixmap_width <= width + width / 4 &&
+           pixmap_height >= height && pixmap_height <= height + height / 4;
+}
+
+/*
+ * Gives the frame buffer of the given container back to the pool, so that it
+ * can be reused by x_acquire_frame_buffer(). When the pool is full, the
+ * least recently released frame buffer is freed.
+ *
+ */
+static void x_release_frame_buffer(Con *con, con_state *state) {
+    if (con->frame_buffer.id == XCB_NONE)
+        return;
+
+    const int64_t pixels = (int64_t)state->pixmap_width * state->pixmap_height;
+    if (pixels > FRAME_BUFFER_POOL_MAX_PIXELS) {
+        draw_util_surface_free(conn, &(con->frame_buffer));
+        xcb_free_pixmap(conn, con->frame_buffer.id);
+    } else {
+        while (frame_buffer_pool_len == FRAME_BUFFER_POOL_SIZE ||
+               frame_buffer_pool_pixels + pixels > FRAME_BUFFER_POOL_MAX_PIXELS) {
+            struct pooled_frame_buffer *oldest = &(frame_buffer_pool[0]);
+            draw_util_surface_free(conn, &(oldest->surface));
+            xcb_free_pixmap(conn, oldest->surface.id);
+            frame_buffer_pool_pixels -= (int64_t)oldest->width * oldest->height;
+            memmove(oldest, oldest + 1, sizeof(struct pooled_frame_buffer) * (frame_buffer_pool_len - 1));
+            frame_buffer_pool_len--;
+        }
+
+        frame_buffer_pool[frame_buffer_pool_len++] = (struct pooled_frame_buffer){
+            .surface = con->frame_buffer,
+            .width = state->pixmap_width,
+            .height = state->pixmap_height,
+            .depth = state->pixmap_depth,
+        };
+        frame_buffer_pool_pixels += pixels;
+    }
+
+    memset(&(con->frame_buffer), '\0', sizeof(surface_t));
+    con->frame_buffer.id = XCB_NONE;
+}
+
+/*
+ * Makes sure that the given container has a frame buffer of the given size
+ * and depth. The current pixmap is kept if it still fits, otherwise one is
+ * taken from the pool, and only if there is no compatible one, a new pixmap is
+ * created. Returns true if the frame buffer is a different pixmap than
+ * before (and its contents therefore need to be drawn again).
+ *
+ */
+static bool x_acquire_frame_buffer(Con *con, con_state *state, uint16_t depth, int width, int height) {
+    if (con->frame_buffer.id != XCB_NONE) {
+        if (state->pixmap_depth == depth &&
+            frame_buffer_fits(state->pixmap_width, state->pixmap_height, width, height)) {
+            if (con->frame_buffer.width == width && con->frame_buffer.height == height)
+                return false;
+            draw_util_surface_set_size(&(con->frame_buffer), width, height);
+            return true;
+        }
+        x_release_frame_buffer(con, state);
+    }
+
+    /* Pick the smallest compatible frame buffer, starting with the most
+     * recently released one. */
+    int best = -1;
+    for (int i = frame_buffer_pool_len - 1; i >= 0; i--) {
+        struct pooled_frame_buffer *entry = &(frame_buffer_pool[i]);
+        if (entry->depth != depth ||
+            !frame_buffer_fits(entry->width, entry->height, width, height))
+            continue;
+        if (best == -1 ||
+            entry->width * entry->height < frame_buffer_pool[best].width * frame_buffer_pool[best].height)
+            best = i;
+    }
+
+    if (best != -1) {
+        struct pooled_frame_buffer *entry = &(frame_buffer_pool[best]);
+        con->frame_buffer = entry->surface;
+        state->pixmap_width = entry->width;
+        state->pixmap_height = entry->height;
+        state->pixmap_depth = entry->depth;
+        frame_buffer_pool_pixels -= (int64_t)entry->width * entry->height;
+        memmove(entry, entry + 1, sizeof(struct pooled_frame_buffer) * (frame_buffer_pool_len - best - 1));
+        frame_buffer_pool_len--;
+        draw_util_surface_set_size(&(con->frame_buffer), width, height);
+        return true;
+    }
+
+    con->frame_buffer.id = xcb_generate_id(conn);
+    xcb_create_pixmap(conn, depth, con->frame_buffer.id, con->frame.id, width, height);
+    draw_util_surface_init(conn, &(con->frame_buffer), con->frame_buffer.id,
+                           get_visualtype_by_id(get_visualid_by_depth(depth)), width, height);
+
+    /* For the graphics context, we disable GraphicsExposure events.
+     * Those will be sent when a CopyArea request cannot be fulfilled
+     * properly due to parts of the source being unmapped or otherwise
+     * unavailable. Since we always copy from pixmaps to windows, this
+     * is not a concern for us. */
+    xcb_change_gc(conn, con->frame_buffer.gc, XCB_GC_GRAPHICS_EXPOSURES, (uint32_t[]){0});
+
+    state->pixmap_width = width;
+    state->pixmap_height = height;
+    state->pixmap_depth = depth;
+    return true;
+}
+
+/*
+ * Releases the frame buffers of everything below the given container (see
+ * x_release_frame_buffer()). They are acquired again by x_push_node() once
+ * the containers are visible.
+ *
+ */
+static void x_release_frame_buffers_below(Con *con) {
+    Con *current;
+    TAILQ_FOREACH(current, &(con->nodes_head), nodes) {
+        x_release_frame_buffer(current, state_for_frame(current->frame.id));
+        x_release_frame_buffers_below(current);
+    }
+    TAILQ_FOREACH(current, &(con->floating_head), floating_windows) {
+        x_release_frame_buffer(current, state_for_frame(current->frame.id));
+        x_release_frame_buffers_below(current);
+    }
+}
+
 /*
  * Changes the atoms on the root window and the windows themselves to properly
  * reflect the current focus for ewmh compliance.
@@ -129,10 +317,43 @@ static void change_ewmh_focus(xcb_window_t new_focus, xcb_window_t old_focus) {
  * Initializes the X11 part for the given container. Called exactly once for
  * every container from con_new().
  *
+ * Only the ID of the frame window is generated here, so that the container
+ * can be found by its frame and its state is tracked right away. The window
+ * itself is created by x_con_create_frame() once the container shows
+ * something, which many split containers and workspaces never do.
+ *
  */
 void x_con_init(Con *con) {
-    /* TODO: maybe create the window when rendering first? we could then even
-     * get the initial geometry right */
+    con->frame.id = xcb_generate_id(conn);
+
+    struct con_state *state = scalloc(1, sizeof(struct con_state));
+    state->id = con->frame.id;
+    state->mapped = false;
+    state->initial = true;
+    DLOG("Adding window 0x%08x to lists\n", state->id);
+    CIRCLEQ_INSERT_HEAD(&state_head, state, state);
+    CIRCLEQ_INSERT_HEAD(&old_state_head, state, old_state);
+    if (state_index == NULL) {
+        state_index = hashmap_new();
+    }
+    hashmap_set(state_index, &(state->id), sizeof(xcb_window_t), state);
+    TAILQ_INSERT_TAIL(&initial_mapping_head, state, initial_mapping_order);
+    DLOG("adding new state for window id 0x%08x\n", state->id);
+
+    con_index_add(con);
+}
+
+/*
+ * Creates the frame window of the given container, unless it exists already
+ * (see x_con_init()). This needs to happen before a client window is
+ * reparented into the frame.
+ *
+ */
+void x_con_create_frame(Con *con) {
+    con_state *state = state_for_frame(con->frame.id);
+    if (state->frame_created)
+        return;
+    state->frame_created = true;
 
     uint32_t mask = 0;
     uint32_t values[5];
@@ -171,9 +392,10 @@ void x_con_init(Con *con) {
     mask |= XCB_CW_COLORMAP;
     values[4] = win_colormap;
 
+    DLOG("Creating frame 0x%08x for con %p\n", con->frame.id, con);
     Rect dims = {-15, -15, 10, 10};
-    xcb_window_t frame_id = create_window(conn, dims, con->depth, visual, XCB_WINDOW_CLASS_INPUT_OUTPUT, XCURSOR_CURSOR_POINTER, false, mask, values);
-    draw_util_surface_init(conn, &(con->frame), frame_id, get_visualtype_by_id(visual), dims.width, dims.height);
+    create_window_with_id(conn, con->frame.id, dims, con->depth, visual, XCB_WINDOW_CLASS_INPUT_OUTPUT, XCURSOR_CURSOR_POINTER, false, mask, values);
+    draw_util_surface_init(conn, &(con->frame), con->frame.id, get_visualtype_by_id(visual), dims.width, dims.height);
     xcb_change_property(conn,
                         XCB_PROP_MODE_REPLACE,
                         con->frame.id,
@@ -182,16 +404,36 @@ void x_con_init(Con *con) {
                         8,
                         (strlen("i3-frame") + 1) * 2,
                         "i3-frame\0i3-frame\0");
+}
 
-    struct con_state *state = scalloc(1, sizeof(struct con_state));
-    state->id = con->frame.id;
-    state->mapped = false;
-    state->initial = true;
-    DLOG("Adding window 0x%08x to lists\n", state->id);
-    CIRCLEQ_INSERT_HEAD(&state_head, state, state);
-    CIRCLEQ_INSERT_HEAD(&old_state_head, state, old_state);
-    TAILQ_INSERT_TAIL(&initial_mapping_head, state, initial_mapping_order);
-    DLOG("adding new state for window id 0x%08x\n", state->id);
+/*
+ * Puts a frame which was created after x_restack() already ran into its place
+ * in the window stack, i.e. directly above the closest existing frame below it
+ * in state_head (which is ordered from top to bottom).
+ *
+ */
+static void x_stack_new_frame(con_state *state) {
+    const uint32_t mask = XCB_CONFIG_WINDOW_SIBLING | XCB_CONFIG_WINDOW_STACK_MODE;
+    con_state *sibling;
+    state->initial = false;
+
+    for (sibling = CIRCLEQ_NEXT(state, state); sibling != CIRCLEQ_END(&state_head); sibling = CIRCLEQ_NEXT(sibling, state)) {
+        if (sibling->frame_created) {
+            const uint32_t values[] = {sibling->id, XCB_STACK_MODE_ABOVE};
+            xcb_configure_window(conn, state->id, mask, values);
+            return;
+        }
+    }
+
+    /* New windows are created on top, so if there is no frame below, the
+     * frame only needs to go below the lowest one above it. */
+    for (sibling = CIRCLEQ_PREV(state, state); sibling != CIRCLEQ_END(&state_head); sibling = CIRCLEQ_PREV(sibling, state)) {
+        if (sibling->frame_created) {
+            const uint32_t values[] = {sibling->id, XCB_STACK_MODE_BELOW};
+            xcb_configure_window(conn, state->id, mask, values);
+            return;
+        }
+    }
 }
 
 /*
@@ -213,6 +455,8 @@ void x_reinit(Con *con) {
     state->child_mapped = false;
     state->con = con;
     memset(&(state->window_rect), 0, sizeof(Rect));
+
+    con_index_add(con);
 }
 
 /*
@@ -258,18 +502,26 @@ void x_move_win(Con *src, Con *dest) {
     }
 }
 
-static void _x_con_kill(Con *con) {
-    con_state *state;
+/*
+ * Frees the state of the given container. Returns whether its frame window
+ * was created.
+ *
+ */
+static bool _x_con_kill(Con *con) {
+    con_state *state = state_for_frame(con->frame.id);
+    const bool frame_created = state->frame_created;
 
     if (con->colormap != XCB_NONE) {
         xcb_free_colormap(conn, con->colormap);
+        con->colormap = XCB_NONE;
     }
 
-    draw_util_surface_free(conn, &(con->frame));
-    draw_util_surface_free(conn, &(con->frame_buffer));
-    xcb_free_pixmap(conn, con->frame_buffer.id);
-    con->frame_buffer.id = XCB_NONE;
-    state = state_for_frame(con->frame.id);
+    if (frame_created)
+        draw_util_surface_free(conn, &(con->frame));
+    x_release_frame_buffer(con, state);
+    x_free_title_cache(con);
+    con_index_remove_frame(con->frame.id);
+    hashmap_remove(state_index, &(state->id), sizeof(xcb_window_t));
     CIRCLEQ_REMOVE(&state_head, state, state);
     CIRCLEQ_REMOVE(&old_state_head, state, old_state);
     TAILQ_REMOVE(&initial_mapping_head, state, initial_mapping_order);
@@ -283,6 +535,8 @@ static void _x_con_kill(Con *con) {
     if (con->frame.id == last_focused) {
         last_focused = XCB_NONE;
     }
+
+    return frame_created;
 }
 
 /*
@@ -290,49 +544,51 @@ static void _x_con_kill(Con *con) {
  *
  */
 void x_con_kill(Con *con) {
-    _x_con_kill(con);
-    xcb_destroy_window(conn, con->frame.id);
+    if (_x_con_kill(con))
+        xcb_destroy_window(conn, con->frame.id);
 }
 
 /*
- * Completely reinitializes the container's frame, without destroying the old window.
+ * Completely reinitializes the container's frame, without destroying the old
+ * window. Returns the old frame, which the caller needs to destroy, or
+ * XCB_NONE if it was never created.
  *
  */
-void x_con_reframe(Con *con) {
-    _x_con_kill(con);
+xcb_window_t x_con_reframe(Con *con) {
+    const xcb_window_t old_frame = con->frame.id;
+    const bool frame_created = _x_con_kill(con);
     x_con_init(con);
+    return (frame_created ? old_frame : XCB_NONE);
 }
 
 /*
- * Returns true if the client supports the given protocol atom (like WM_DELETE_WINDOW)
+ * Frees the cached title rendering of the given container (e.g. because the
+ * font changed). It will be re-rendered on the next decoration redraw.
  *
  */
-bool window_supports_protocol(xcb_window_t window, xcb_atom_t atom) {
-    xcb_get_property_cookie_t cookie;
-    xcb_icccm_get_wm_protocols_reply_t protocols;
-    bool result = false;
-
-    cookie = xcb_icccm_get_wm_protocols(conn, window, A_WM_PROTOCOLS);
-    if (xcb_icccm_get_wm_protocols_reply(conn, cookie, &protocols, NULL) != 1)
-        return false;
-
-    /* Check if the client’s protocols have the requested atom set */
-    for (uint32_t i = 0; i < protocols.atoms_len; i++)
-        if (protocols.atoms[i] == atom)
-            result = true;
-
-    xcb_icccm_get_wm_protocols_reply_wipe(&protocols);
+void x_free_title_cache(Con *con) {
+    struct title_cache *cache = con->title_cache;
+    if (cache == NULL)
+        return;
 
-    return result;
+    if (cache->surface.id != XCB_NONE) {
+        draw_util_surface_free(conn, &(cache->surface));
+        xcb_free_pixmap(conn, cache->surface.id);
+    }
+    FREE(cache->title);
+    FREE(cache->marks);
+    FREE(con->title_cache);
 }
 
 /*
  * Kills the given X11 window using WM_DELETE_WINDOW (if supported).
  *
  */
-void x_window_kill(xcb_window_t window, kill_window_t kill_window) {
+void x_window_kill(i3Window *win, kill_window_t kill_window) {
+    const xcb_window_t window = win->id;
+
     /* if this window does not support WM_DELETE_WINDOW, we kill it the hard way */
-    if (!window_supports_protocol(window, A_WM_DELETE_WINDOW)) {
+    if (!win->supports_delete_window) {
         if (kill_window == KILL_WINDOW) {
             LOG("Killing specific window 0x%08x\n", window);
             xcb_destroy_window(conn, window);
@@ -357,11 +613,97 @@ void x_window_kill(xcb_window_t window, kill_window_t kill_window) {
     ev->data.data32[1] = XCB_CURRENT_TIME;
 
     LOG("Sending WM_DELETE to the client\n");
+    /* Not flushed here: the event loop flushes once all windows of a
+     * (possibly bulk) close were handled. */
     xcb_send_event(conn, false, window, XCB_EVENT_MASK_NO_EVENT, (char *)ev);
-    xcb_flush(conn);
     free(event);
 }
 
+/*
+ * Returns the smallest rectangle containing both given rectangles.
+ *
+ */
+static Rect bounding_box(Rect a, Rect b) {
+    const uint32_t x = MIN(a.x, b.x);
+    const uint32_t y = MIN(a.y, b.y);
+    return (Rect){x, y,
+                  MAX(a.x + a.width, b.x + b.width) - x,
+                  MAX(a.y + a.height, b.y + b.height) - y};
+}
+
+/*
+ * Records that the given area of the container’s frame_buffer was drawn to,
+ * so that x_flush_frame() copies it to the frame. Once FRAME_DAMAGE_RECTS
+ * areas are recorded, the new area is merged with the one whose bounding box
+ * grows the least, which keeps e.g. the four borders of a window apart.
+ *
+ */
+void x_damage_frame(Con *con, int x, int y, int width, int height) {
+    if (x < 0) {
+        width += x;
+        x = 0;
+    }
+    if (y < 0) {
+        height += y;
+        y = 0;
+    }
+    if (width <= 0 || height <= 0)
+        return;
+
+    Rect rect = (Rect){x, y, width, height};
+    if (con->num_frame_damage < FRAME_DAMAGE_RECTS) {
+        con->frame_damage[con->num_frame_damage++] = rect;
+        return;
+    }
+
+    int best = 0;
+    uint64_t best_growth = UINT64_MAX;
+    for (int i = 0; i < con->num_frame_damage; i++) {
+        Rect *damage = &(con->frame_damage[i]);
+        Rect merged = bounding_box(*damage, rect);
+        uint64_t growth = (uint64_t)merged.width * merged.height - (uint64_t)damage->width * damage->height;
+        if (growth < best_growth) {
+            best = i;
+            best_growth = growth;
+        }
+    }
+    con->frame_damage[best] = bounding_box(con->frame_damage[best], rect);
+}
+
+/*
+ * Draws a filled rectangle onto the container’s frame_buffer and records it as
+ * damaged.
+ *
+ */
+static void x_fill_frame(Con *con, color_t color, int x, int y, int width, int height) {
+    draw_util_rectangle(&(con->frame_buffer), color, x, y, width, height);
+    x_damage_frame(con, x, y, width, height);
+}
+
+/*
+ * Copies the damaged areas of the container’s frame_buffer to its frame.
+ *
+ */
+void x_flush_frame(Con *con) {
+    for (int i = 0; i < con->num_frame_damage; i++) {
+        Rect *damage = &(con->frame_damage[i]);
+        draw_util_copy_surface(&(con->frame_buffer), &(con->frame),
+                               damage->x, damage->y, damage->x, damage->y, damage->width, damage->height);
+    }
+    con->num_frame_damage = 0;
+}
+
+/*
+ * Copies the whole frame_buffer of the container to its frame, which is
+ * necessary whenever the X server discarded the frame’s contents (after
+ * resizing or mapping it).
+ *
+ */
+static void x_copy_frame(Con *con) {
+    draw_util_copy_surface(&(con->frame_buffer), &(con->frame), 0, 0, 0, 0, con->rect.width, con->rect.height);
+    con->num_frame_damage = 0;
+}
+
 static void x_draw_title_border(Con *con, struct deco_render_params *p) {
     assert(con->parent != NULL);
 
@@ -459,11 +801,128 @@ static size_t x_get_border_rectangles(Con *con, xcb_rectangle_t rectangles[4]) {
     return count;
 }
 
+static bool strings_equal(const char *a, const char *b) {
+    if (a == NULL || b == NULL)
+        return (a == b);
+    return (strcmp(a, b) == 0);
+}
+
 /*
- * Draws the decoration of the given container onto its parent.
+ * Returns a surface containing the title row (marks and title) of the
+ * decoration of the given container, which is deco_rect.width pixels wide and
+ * one font height high. The row is only rendered (and the text shaped) again
+ * if the marks, title, colors or decoration width changed since the last
+ * call.
  *
  */
-void x_draw_decoration(Con *con) {
+static surface_t *x_render_title(Con *con, struct deco_render_params *p, i3String *title, char *marks) {
+    const int title_padding = logical_px(2);
+    const int deco_width = (int)con->deco_rect.width;
+    const int height = config.font.height;
+    const char *title_utf8 = (title == NULL ? NULL : i3string_as_utf8(title));
+    const bool title_is_markup = (title != NULL && i3string_is_markup(title));
+
+    struct title_cache *cache = con->title_cache;
+    if (cache != NULL &&
+        cache->width == deco_width &&
+        cache->height == height &&
+        cache->title_is_markup == title_is_markup &&
+        strings_equal(cache->title, title_utf8) &&
+        strings_equal(cache->marks, marks) &&
+        memcmp(&(cache->text), &(p->color->text), sizeof(color_t)) == 0 &&
+        memcmp(&(cache->background), &(p->color->background), sizeof(color_t)) == 0) {
+        return &(cache->surface);
+    }
+
+    if (cache == NULL) {
+        cache = con->title_cache = scalloc(1, sizeof(struct title_cache));
+    }
+
+    if (cache->surface.id == XCB_NONE || cache->width != deco_width || cache->height != height) {
+        if (cache->surface.id != XCB_NONE) {
+            draw_util_surface_free(conn, &(cache->surface));
+            xcb_free_pixmap(conn, cache->surface.id);
+        }
+
+        /* The title is copied onto the parent’s pixmap, so it needs to have
+         * the same depth (see x_push_node()). */
+        uint16_t depth = root_depth;
+        if (con->parent->window)
+            depth = con->parent->window->depth;
+
+        const int width = MAX(deco_width, 1);
+        cache->surface.id = xcb_generate_id(conn);
+        xcb_create_pixmap(conn, depth, cache->surface.id, con->parent->frame.id, width, MAX(height, 1));
+        draw_util_surface_init(conn, &(cache->surface), cache->surface.id,
+                               get_visualtype_by_id(get_visualid_by_depth(depth)), width, MAX(height, 1));
+    }
+
+    FREE(cache->title);
+    FREE(cache->marks);
+    cache->title = (title_utf8 == NULL ? NULL : sstrdup(title_utf8));
+    cache->title_is_markup = title_is_markup;
+    cache->marks = (marks == NULL ? NULL : sstrdup(marks));
+    cache->text = p->color->text;
+    cache->background = p->color->background;
+    cache->width = deco_width;
+    cache->height = height;
+
+    surface_t *surface = &(cache->surface);
+    draw_util_clear_surface(surface, p->color->background);
+
+    int mark_width = 0;
+    if (marks != NULL) {
+        i3String *mark = i3string_from_utf8(marks);
+        mark_width = predict_text_width(mark);
+
+        int mark_offset_x = (config.title_align == ALIGN_RIGHT)
+                                ? title_padding
+                                : deco_width - mark_width - title_padding;
+
+        draw_util_text(mark, surface, p->color->text, p->color->background,
+                       mark_offset_x, 0, mark_width);
+        I3STRING_FREE(mark);
+
+        mark_width += title_padding;
+    }
+
+    if (title == NULL)
+        return surface;
+
+    int title_offset_x;
+    switch (config.title_align) {
+        case ALIGN_LEFT:
+            /* (pad)[text    ](pad)[mark + its pad) */
+            title_offset_x = title_padding;
+            break;
+        case ALIGN_CENTER:
+            /* (pad)[  text  ](pad)[mark + its pad)
+             * To center the text inside its allocated space, the surface
+             * between the brackets, we use the formula
+             * (surface_width - predict_text_width) / 2
+             * where surface_width = deco_width - 2 * pad - mark_width
+             * so, offset = pad + (surface_width - predict_text_width) / 2 =
+             * = … = (deco_width - mark_width - predict_text_width) / 2 */
+            title_offset_x = max(title_padding, (deco_width - mark_width - predict_text_width(title)) / 2);
+            break;
+        case ALIGN_RIGHT:
+            /* [mark + its pad](pad)[    text](pad) */
+            title_offset_x = max(title_padding + mark_width, deco_width - title_padding - predict_text_width(title));
+            break;
+    }
+
+    draw_util_text(title, surface, p->color->text, p->color->background,
+                   title_offset_x, 0, deco_width - mark_width - 2 * title_padding);
+
+    return surface;
+}
+
+/*
+ * Returns true if the given container has a decoration which can be drawn
+ * right now.
+ *
+ */
+static bool x_has_decoration(Con *con) {
     Con *parent = con->parent;
     bool leaf = con_is_leaf(con);
 
@@ -481,20 +940,32 @@ void x_draw_decoration(Con *con) {
         parent->type == CT_OUTPUT ||
         parent->type == CT_DOCKAREA ||
         con->type == CT_FLOATING_CON)
-        return;
+        return false;
 
     /* Skip containers whose height is 0 (for example empty dockareas) */
     if (con->rect.height == 0)
-        return;
+        return false;
 
     /* Skip containers whose pixmap has not yet been created (can happen when
      * decoration rendering happens recursively for a window for which
      * x_push_node() was not yet called) */
     if (leaf && con->frame_buffer.id == XCB_NONE)
-        return;
+        return false;
 
-    /* 1: build deco_params and compare with cache */
-    struct deco_render_params *p = scalloc(1, sizeof(struct deco_render_params));
+    return true;
+}
+
+/*
+ * Builds the decoration parameters of the given container into p and
+ * compares them with the cached ones. Returns true (after updating the cache)
+ * if the decoration has to be redrawn, which is always the case when force is
+ * set.
+ *
+ */
+static bool x_update_deco_params(Con *con, struct deco_render_params *p, bool force) {
+    Con *parent = con->parent;
+
+    memset(p, 0, sizeof(struct deco_render_params));
 
     /* find out which colors to use */
     if (con->urgent)
@@ -517,23 +988,28 @@ void x_draw_decoration(Con *con) {
     p->con_is_leaf = con_is_leaf(con);
     p->parent_layout = con->parent->layout;
 
-    if (con->deco_render_params != NULL &&
+    if (!force &&
+        con->deco_render_params != NULL &&
         (con->window == NULL || !con->window->name_x_changed) &&
         !parent->pixmap_recreated &&
         !con->pixmap_recreated &&
         !con->mark_changed &&
         memcmp(p, con->deco_render_params, sizeof(struct deco_render_params)) == 0) {
-        free(p);
-        goto copy_pixmaps;
+        return false;
     }
 
-    Con *next = con;
-    while ((next = TAILQ_NEXT(next, nodes))) {
-        FREE(next->deco_render_params);
+    /* The tabs of stacked and tabbed containers do not overlap, see
+     * x_draw_tab_bar(). */
+    if (parent->layout != L_STACKED && parent->layout != L_TABBED) {
+        Con *next = con;
+        while ((next = TAILQ_NEXT(next, nodes))) {
+            FREE(next->deco_render_params);
+        }
     }
 
-    FREE(con->deco_render_params);
-    con->deco_render_params = p;
+    if (con->deco_render_params == NULL)
+        con->deco_render_params = smalloc(sizeof(struct deco_render_params));
+    memcpy(con->deco_render_params, p, sizeof(struct deco_render_params));
 
     if (con->window != NULL && con->window->name_x_changed)
         con->window->name_x_changed = false;
@@ -541,24 +1017,35 @@ void x_draw_decoration(Con *con) {
     parent->pixmap_recreated = false;
     con->pixmap_recreated = false;
     con->mark_changed = false;
+    return true;
+}
+
+/*
+ * Draws the parts of the decoration which are on the container’s own pixmap:
+ * the background around the window and the border.
+ *
+ */
+static void x_draw_frame_decoration(Con *con, struct deco_render_params *p) {
+    Rect *r = &(con->rect);
+    Rect *w = &(con->window_rect);
 
-    /* 2: draw the client.background, but only for the parts around the window_rect */
+    /* 1: draw the client.background, but only for the parts around the window_rect */
     if (con->window != NULL) {
         /* top area */
-        draw_util_rectangle(&(con->frame_buffer), config.client.background,
-                            0, 0, r->width, w->y);
+        x_fill_frame(con, config.client.background,
+                     0, 0, r->width, w->y);
         /* bottom area */
-        draw_util_rectangle(&(con->frame_buffer), config.client.background,
-                            0, w->y + w->height, r->width, r->height - (w->y + w->height));
+        x_fill_frame(con, config.client.background,
+                     0, w->y + w->height, r->width, r->height - (w->y + w->height));
         /* left area */
-        draw_util_rectangle(&(con->frame_buffer), config.client.background,
-                            0, 0, w->x, r->height);
+        x_fill_frame(con, config.client.background,
+                     0, 0, w->x, r->height);
         /* right area */
-        draw_util_rectangle(&(con->frame_buffer), config.client.background,
-                            w->x + w->width, 0, r->width - (w->x + w->width), r->height);
+        x_fill_frame(con, config.client.background,
+                     w->x + w->width, 0, r->width - (w->x + w->width), r->height);
     }
 
-    /* 3: draw a rectangle in border color around the client */
+    /* 2: draw a rectangle in border color around the client */
     if (p->border_style != BS_NONE && p->con_is_leaf) {
         /* Fill the border. We don’t just fill the whole rectangle because some
          * children are not freely resizable and we want their background color
@@ -566,11 +1053,11 @@ void x_draw_decoration(Con *con) {
         xcb_rectangle_t rectangles[4];
         size_t rectangles_count = x_get_border_rectangles(con, rectangles);
         for (size_t i = 0; i < rectangles_count; i++) {
-            draw_util_rectangle(&(con->frame_buffer), p->color->child_border,
-                                rectangles[i].x,
-                                rectangles[i].y,
-                                rectangles[i].width,
-                                rectangles[i].height);
+            x_fill_frame(con, p->color->child_border,
+                         rectangles[i].x,
+                         rectangles[i].y,
+                         rectangles[i].width,
+                         rectangles[i].height);
         }
 
         /* Highlight the side of the border at which the next window will be
@@ -582,138 +1069,189 @@ void x_draw_decoration(Con *con) {
             TAILQ_PREV(con, nodes_head, nodes) == NULL &&
             con->parent->type != CT_FLOATING_CON) {
             if (p->parent_layout == L_SPLITH) {
-                draw_util_rectangle(&(con->frame_buffer), p->color->indicator,
-                                    r->width + (br.width + br.x), br.y, -(br.width + br.x), r->height + br.height);
+                x_fill_frame(con, p->color->indicator,
+                             r->width + (br.width + br.x), br.y, -(br.width + br.x), r->height + br.height);
             } else if (p->parent_layout == L_SPLITV) {
-                draw_util_rectangle(&(con->frame_buffer), p->color->indicator,
-                                    br.x, r->height + (br.height + br.y), r->width + br.width, -(br.height + br.y));
+                x_fill_frame(con, p->color->indicator,
+                             br.x, r->height + (br.height + br.y), r->width + br.width, -(br.height + br.y));
             }
         }
     }
+}
 
-    /* if this is a borderless/1pixel window, we don’t need to render the
-     * decoration. */
-    if (p->border_style != BS_NORMAL)
-        goto copy_pixmaps;
-
-    /* If the parent hasn't been set up yet, skip the decoration rendering
-     * for now. */
-    if (parent->frame_buffer.id == XCB_NONE)
-        goto copy_pixmaps;
+/*
+ * Draws the title bar of the given container (with border style normal) onto
+ * its parent’s pixmap, within its deco_rect.
+ *
+ */
+static void x_draw_title_bar(Con *con, struct deco_render_params *p) {
+    Con *parent = con->parent;
 
-    /* For the first child, we clear the parent pixmap to ensure there's no
-     * garbage left on there. This is important to avoid tearing when using
-     * transparency. */
-    if (con == TAILQ_FIRST(&(con->parent->nodes_head))) {
-        draw_util_clear_surface(&(con->parent->frame_buffer), COLOR_TRANSPARENT);
-        FREE(con->parent->deco_render_params);
-    }
+    /* Everything below is drawn within the deco_rect. */
+    x_damage_frame(parent, con->deco_rect.x, con->deco_rect.y, con->deco_rect.width, con->deco_rect.height);
 
-    /* 4: paint the bar */
+    /* 1: paint the bar */
     draw_util_rectangle(&(parent->frame_buffer), p->color->background,
                         con->deco_rect.x, con->deco_rect.y, con->deco_rect.width, con->deco_rect.height);
 
-    /* 5: draw title border */
+    /* 2: draw title border */
     x_draw_title_border(con, p);
 
-    /* 6: draw the title */
+    /* Tabs which are too narrow to show anything readable (e.g. in a tabbed
+     * container with hundreds of children) only get their bar, which also
+     * saves rendering and storing their titles. */
+    if ((int)con->deco_rect.width < TITLE_MIN_WIDTH) {
+        x_free_title_cache(con);
+        return;
+    }
+
+    /* 3: draw the title */
     int text_offset_y = (con->deco_rect.height - config.font.height) / 2;
 
-    const int title_padding = logical_px(2);
-    const int deco_width = (int)con->deco_rect.width;
-    int mark_width = 0;
+    char *formatted_mark = NULL;
     if (config.show_marks && !TAILQ_EMPTY(&(con->marks_head))) {
-        char *formatted_mark = sstrdup("");
-        bool had_visible_mark = false;
-
         mark_t *mark;
         TAILQ_FOREACH(mark, &(con->marks_head), marks) {
             if (mark->name[0] == '_')
                 continue;
-            had_visible_mark = true;
 
             char *buf;
-            sasprintf(&buf, "%s[%s]", formatted_mark, mark->name);
+            sasprintf(&buf, "%s[%s]", (formatted_mark == NULL ? "" : formatted_mark), mark->name);
             free(formatted_mark);
             formatted_mark = buf;
         }
+    }
+
+    i3String *title = NULL;
+    struct Window *win = con->window;
+    if (win == NULL) {
+        if (con->title_format == NULL) {
+            char *_title;
+            char *tree = con_get_tree_representation(con);
+            sasprintf(&_title, "i3: %s", tree);
+            free(tree);
+
+            title = i3string_from_utf8(_title);
+            FREE(_title);
+        } else {
+            title = con_parse_title_format(con);
+        }
+    } else {
+        title = con->title_format == NULL ? win->name : con_parse_title_format(con);
+    }
+
+    surface_t *title_surface = x_render_title(con, p, title, formatted_mark);
+    draw_util_copy_surface(title_surface, &(parent->frame_buffer),
+                           0, 0, con->deco_rect.x, con->deco_rect.y + text_offset_y,
+                           con->deco_rect.width, config.font.height);
+    FREE(formatted_mark);
+
+    if (title == NULL) {
+        return;
+    }
+
+    if (win == NULL && con->title_format == NULL) {
+        I3STRING_FREE(title);
+    }
+
+    x_draw_decoration_after_title(con, p);
+}
+
+/*
+ * Draws the decoration of the given container onto its parent.
+ *
+ */
+void x_draw_decoration(Con *con) {
+    Con *parent = con->parent;
+
+    if (!x_has_decoration(con))
+        return;
+
+    /* The children of stacked and tabbed containers are drawn all at once,
+     * see x_draw_tab_bar(). */
+    if (parent->layout == L_STACKED || parent->layout == L_TABBED)
+        return;
+
+    const uint64_t stats_start = stats_begin(STATS_X_DRAW_DECORATION);
+
+    /* The params are built on the stack and only copied into the cache when
+     * they changed. */
+    struct deco_render_params params;
+    if (!x_update_deco_params(con, &params, false))
+        goto copy_pixmaps;
+
+    x_draw_frame_decoration(con, &params);
+
+    /* if this is a borderless/1pixel window, we don’t need to render the
+     * decoration. */
+    if (params.border_style != BS_NORMAL)
+        goto copy_pixmaps;
+
+    /* If the parent hasn't been set up yet, skip the decoration rendering
+     * for now. */
+    if (parent->frame_buffer.id == XCB_NONE)
+        goto copy_pixmaps;
 
-        if (had_visible_mark) {
-            i3String *mark = i3string_from_utf8(formatted_mark);
-            mark_width = predict_text_width(mark);
+    /* For the first child, we clear the parent pixmap to ensure there's no
+     * garbage left on there. This is important to avoid tearing when using
+     * transparency. */
+    if (con == TAILQ_FIRST(&(con->parent->nodes_head))) {
+        draw_util_clear_surface(&(con->parent->frame_buffer), COLOR_TRANSPARENT);
+        x_damage_frame(con->parent, 0, 0, con->parent->frame_buffer.width, con->parent->frame_buffer.height);
+        FREE(con->parent->deco_render_params);
+    }
 
-            int mark_offset_x = (config.title_align == ALIGN_RIGHT)
-                                    ? title_padding
-                                    : deco_width - mark_width - title_padding;
+    x_draw_title_bar(con, &params);
 
-            draw_util_text(mark, &(parent->frame_buffer),
-                           p->color->text, p->color->background,
-                           con->deco_rect.x + mark_offset_x,
-                           con->deco_rect.y + text_offset_y, mark_width);
-            I3STRING_FREE(mark);
+copy_pixmaps:
+    x_flush_frame(con);
+    stats_end(STATS_X_DRAW_DECORATION, stats_start);
+}
 
-            mark_width += title_padding;
-        }
+/*
+ * Draws the tab bar of a stacked or tabbed container, that is the decorations
+ * of all of its children, in one pass. Only the tabs whose decoration changed
+ * are redrawn (tabs never overlap), unless the geometry of the bar changed:
+ * then the whole pixmap is cleared and every tab is drawn again.
+ *
+ */
+static void x_draw_tab_bar(Con *con) {
+    if (con->layout != L_STACKED && con->layout != L_TABBED)
+        return;
 
-        FREE(formatted_mark);
+    const uint64_t stats_start = stats_begin(STATS_X_DRAW_DECORATION);
+    Con *child;
+    bool full = con->pixmap_recreated;
+    TAILQ_FOREACH(child, &(con->nodes_head), nodes) {
+        if (full)
+            break;
+        if (!x_has_decoration(child))
+            continue;
+        full = (child->deco_render_params == NULL ||
+                memcmp(&(child->deco_render_params->con_deco_rect), &(child->deco_rect), sizeof(Rect)) != 0);
     }
 
-    i3String *title = NULL;
-    struct Window *win = con->window;
-    if (win == NULL) {
-        if (con->title_format == NULL) {
-            char *_title;
-            char *tree = con_get_tree_representation(con);
-            sasprintf(&_title, "i3: %s", tree);
-            free(tree);
-
-            title = i3string_from_utf8(_title);
-            FREE(_title);
-        } else {
-            title = con_parse_title_format(con);
-        }
-    } else {
-        title = con->title_format == NULL ? win->name : con_parse_title_format(con);
-    }
-    if (title == NULL) {
-        goto copy_pixmaps;
+    if (full && con->frame_buffer.id != XCB_NONE) {
+        draw_util_clear_surface(&(con->frame_buffer), COLOR_TRANSPARENT);
+        x_damage_frame(con, 0, 0, con->frame_buffer.width, con->frame_buffer.height);
+        FREE(con->deco_render_params);
     }
 
-    int title_offset_x;
-    switch (config.title_align) {
-        case ALIGN_LEFT:
-            /* (pad)[text    ](pad)[mark + its pad) */
-            title_offset_x = title_padding;
-            break;
-        case ALIGN_CENTER:
-            /* (pad)[  text  ](pad)[mark + its pad)
-             * To center the text inside its allocated space, the surface
-             * between the brackets, we use the formula
-             * (surface_width - predict_text_width) / 2
-             * where surface_width = deco_width - 2 * pad - mark_width
-             * so, offset = pad + (surface_width - predict_text_width) / 2 =
-             * = … = (deco_width - mark_width - predict_text_width) / 2 */
-            title_offset_x = max(title_padding, (deco_width - mark_width - predict_text_width(title)) / 2);
-            break;
-        case ALIGN_RIGHT:
-            /* [mark + its pad](pad)[    text](pad) */
-            title_offset_x = max(title_padding + mark_width, deco_width - title_padding - predict_text_width(title));
-            break;
-    }
+    TAILQ_FOREACH(child, &(con->nodes_head), nodes) {
+        if (!x_has_decoration(child))
+            continue;
 
-    draw_util_text(title, &(parent->frame_buffer),
-                   p->color->text, p->color->background,
-                   con->deco_rect.x + title_offset_x,
-                   con->deco_rect.y + text_offset_y,
-                   deco_width - mark_width - 2 * title_padding);
+        struct deco_render_params params;
+        if (!x_update_deco_params(child, &params, full))
+            continue;
 
-    if (win == NULL || con->title_format != NULL) {
-        I3STRING_FREE(title);
+        x_draw_frame_decoration(child, &params);
+        if (params.border_style == BS_NORMAL && con->frame_buffer.id != XCB_NONE)
+            x_draw_title_bar(child, &params);
+        x_flush_frame(child);
     }
-
-    x_draw_decoration_after_title(con, p);
-copy_pixmaps:
-    draw_util_copy_surface(&(con->frame_buffer), &(con->frame), 0, 0, 0, 0, con->rect.width, con->rect.height);
+    con->pixmap_recreated = false;
+    stats_end(STATS_X_DRAW_DECORATION, stats_start);
 }
 
 /*
@@ -727,8 +1265,15 @@ void x_deco_recurse(Con *con) {
     bool leaf = TAILQ_EMPTY(&(con->nodes_head)) &&
                 TAILQ_EMPTY(&(con->floating_head));
     con_state *state = state_for_frame(con->frame.id);
+    const uint64_t stats_start = stats_begin(STATS_X_DECO_RECURSE);
+    const stats_x_subsystem_t x_subsystem = stats_x_enter(STATS_X_SUBSYSTEM_DECORATION);
+
+    con->dirty = false;
+    con->child_dirty = false;
 
     if (!leaf) {
+        x_draw_tab_bar(con);
+
         TAILQ_FOREACH(current, &(con->nodes_head), nodes)
         x_deco_recurse(current);
 
@@ -736,13 +1281,60 @@ void x_deco_recurse(Con *con) {
         x_deco_recurse(current);
 
         if (state->mapped) {
-            draw_util_copy_surface(&(con->frame_buffer), &(con->frame), 0, 0, 0, 0, con->rect.width, con->rect.height);
+            x_flush_frame(con);
+        }
+    }
+
+    if ((con->type != CT_ROOT && con->type != CT_OUTPUT) &&
+        (!leaf || con->mapped))
+        x_draw_decoration(con);
+
+    stats_x_leave(x_subsystem);
+    stats_end(STATS_X_DECO_RECURSE, stats_start);
+}
+
+/*
+ * Like x_deco_recurse(), but skips subtrees in which nothing was marked dirty
+ * (see con_set_dirty()). The children of a visited container are always
+ * passed to x_draw_decoration() since redrawing the first child clears the
+ * parent's pixmap; their cached decoration params decide whether anything
+ * has to be painted.
+ *
+ */
+static void x_deco_recurse_dirty(Con *con) {
+    if (con->dirty) {
+        x_deco_recurse(con);
+        return;
+    }
+
+    const uint64_t stats_start = stats_begin(STATS_X_DECO_RECURSE);
+    const stats_x_subsystem_t x_subsystem = stats_x_enter(STATS_X_SUBSYSTEM_DECORATION);
+    Con *current;
+    bool leaf = TAILQ_EMPTY(&(con->nodes_head)) &&
+                TAILQ_EMPTY(&(con->floating_head));
+
+    if (con->child_dirty && !leaf) {
+        con->child_dirty = false;
+        x_draw_tab_bar(con);
+
+        TAILQ_FOREACH(current, &(con->nodes_head), nodes)
+        x_deco_recurse_dirty(current);
+
+        TAILQ_FOREACH(current, &(con->floating_head), floating_windows)
+        x_deco_recurse_dirty(current);
+
+        if (state_for_frame(con->frame.id)->mapped) {
+            x_flush_frame(con);
         }
     }
+    con->child_dirty = false;
 
     if ((con->type != CT_ROOT && con->type != CT_OUTPUT) &&
         (!leaf || con->mapped))
         x_draw_decoration(con);
+
+    stats_x_leave(x_subsystem);
+    stats_end(STATS_X_DECO_RECURSE, stats_start);
 }
 
 /*
@@ -835,6 +1427,54 @@ static void set_shape_state(Con *con, bool need_reshape) {
     }
 }
 
+/* The workspace of the global fullscreen container (if any), which is rendered
+ * even though it might not be the visible workspace of its output. */
+static Con *global_fullscreen_ws;
+
+/*
+ * Returns true if the given container is a workspace which does not show up
+ * on any output, so that none of its windows have to be mapped.
+ *
+ */
+static bool is_hidden_workspace(Con *con) {
+    return con->type == CT_WORKSPACE &&
+           (con->fullscreen_mode != CF_OUTPUT || con_is_internal(con)) &&
+           con != global_fullscreen_ws;
+}
+
+/*
+ * Returns true if the children of the given container can be skipped during
+ * x_push_changes(): the container is a hidden workspace, and all of its
+ * windows were unmapped in a previous push. Nothing below it has to be pushed
+ * until it is woken up again (see con_wake_workspace()).
+ *
+ */
+static bool is_dormant(Con *con) {
+    if (!con->dormant)
+        return false;
+    if (!is_hidden_workspace(con)) {
+        con->dormant = false;
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Handles all children and floating windows of the given node. We recurse in
+ * focus order to display the focused client in a stack first when switching
+ * workspaces (reduces flickering).
+ *
+ */
+static void x_push_children(Con *con) {
+    Con *current;
+    if (is_dormant(con))
+        return;
+
+    TAILQ_FOREACH(current, &(con->focus_head), focused) {
+        x_push_node(current);
+    }
+}
+
 /*
  * This function pushes the properties of each node of the layout tree to
  * X11 if they have changed (like the map state, position of the window, …).
@@ -845,18 +1485,11 @@ void x_push_node(Con *con) {
     Con *current;
     con_state *state;
     Rect rect = con->rect;
+    const uint64_t stats_start = stats_begin(STATS_X_PUSH_NODE);
 
     //DLOG("Pushing changes for node %p / %s\n", con, con->name);
     state = state_for_frame(con->frame.id);
 
-    if (state->name != NULL) {
-        DLOG("pushing name %s for con %p\n", state->name, con);
-
-        xcb_change_property(conn, XCB_PROP_MODE_REPLACE, con->frame.id,
-                            XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8, strlen(state->name), state->name);
-        FREE(state->name);
-    }
-
     if (con->window == NULL) {
         /* Calculate the height of all window decorations which will be drawn on to
          * this frame. */
@@ -873,6 +1506,26 @@ void x_push_node(Con *con) {
             con->mapped = false;
     }
 
+    /* Containers which do not show anything (e.g. split containers without
+     * decorations) do not need a frame window, see x_con_init(). */
+    if (!state->frame_created) {
+        if (con->window == NULL && !con->mapped) {
+            x_push_children(con);
+            stats_end(STATS_X_PUSH_NODE, stats_start);
+            return;
+        }
+        x_con_create_frame(con);
+        x_stack_new_frame(state);
+    }
+
+    if (state->name != NULL) {
+        DLOG("pushing name %s for con %p\n", state->name, con);
+
+        xcb_change_property(conn, XCB_PROP_MODE_REPLACE, con->frame.id,
+                            XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8, strlen(state->name), state->name);
+        FREE(state->name);
+    }
+
     bool need_reshape = false;
 
     /* reparent the child window (when the window was moved due to a sticky
@@ -941,19 +1594,10 @@ void x_push_node(Con *con) {
         /* Check if the container has an unneeded pixmap left over from
          * previously having a border or titlebar. */
         if (!is_pixmap_needed && con->frame_buffer.id != XCB_NONE) {
-            draw_util_surface_free(conn, &(con->frame_buffer));
-            xcb_free_pixmap(conn, con->frame_buffer.id);
-            con->frame_buffer.id = XCB_NONE;
+            x_release_frame_buffer(con, state);
         }
 
         if (is_pixmap_needed && (has_rect_changed || con->frame_buffer.id == XCB_NONE)) {
-            if (con->frame_buffer.id == XCB_NONE) {
-                con->frame_buffer.id = xcb_generate_id(conn);
-            } else {
-                draw_util_surface_free(conn, &(con->frame_buffer));
-                xcb_free_pixmap(conn, con->frame_buffer.id);
-            }
-
             uint16_t win_depth = root_depth;
             if (con->window)
                 win_depth = con->window->depth;
@@ -964,19 +1608,9 @@ void x_push_node(Con *con) {
             int width = MAX((int32_t)rect.width, 1);
             int height = MAX((int32_t)rect.height, 1);
 
-            xcb_create_pixmap(conn, win_depth, con->frame_buffer.id, con->frame.id, width, height);
-            draw_util_surface_init(conn, &(con->frame_buffer), con->frame_buffer.id,
-                                   get_visualtype_by_id(get_visualid_by_depth(win_depth)), width, height);
-
-            /* For the graphics context, we disable GraphicsExposure events.
-             * Those will be sent when a CopyArea request cannot be fulfilled
-             * properly due to parts of the source being unmapped or otherwise
-             * unavailable. Since we always copy from pixmaps to windows, this
-             * is not a concern for us. */
-            xcb_change_gc(conn, con->frame_buffer.gc, XCB_GC_GRAPHICS_EXPOSURES, (uint32_t[]){0});
-
+            if (x_acquire_frame_buffer(con, state, win_depth, width, height))
+                con->pixmap_recreated = true;
             draw_util_surface_set_size(&(con->frame), width, height);
-            con->pixmap_recreated = true;
 
             /* Don’t render the decoration for windows inside a stack which are
              * not visible right now */
@@ -995,25 +1629,44 @@ void x_push_node(Con *con) {
          * buffer and will be processed directly afterwards (the contents of a
          * window get lost when resizing it, therefore we want to provide it as
          * fast as possible) */
-        xcb_flush(conn);
+        if (!workspace_switch_pending)
+            xcb_flush(conn);
         xcb_set_window_rect(conn, con->frame.id, rect);
         if (con->frame_buffer.id != XCB_NONE) {
-            draw_util_copy_surface(&(con->frame_buffer), &(con->frame), 0, 0, 0, 0, con->rect.width, con->rect.height);
+            x_copy_frame(con);
         }
-        xcb_flush(conn);
+        if (!workspace_switch_pending)
+            xcb_flush(conn);
 
         memcpy(&(state->rect), &rect, sizeof(Rect));
         fake_notify = true;
+        con_set_dirty(con);
     }
 
-    /* dito, but for child windows */
+    /* dito, but for child windows. A client which supports
+     * _NET_WM_SYNC_REQUEST gets its next size only once it redrew at the
+     * previous one, so that it does not queue up intermediate sizes. */
     if (con->window != NULL &&
         memcmp(&(state->window_rect), &(con->window_rect), sizeof(Rect)) != 0) {
-        DLOG("setting window rect (%d, %d, %d, %d)\n",
-             con->window_rect.x, con->window_rect.y, con->window_rect.width, con->window_rect.height);
-        xcb_set_window_rect(conn, con->window->id, con->window_rect);
-        memcpy(&(state->window_rect), &(con->window_rect), sizeof(Rect));
-        fake_notify = true;
+        const bool resized = (state->window_rect.width != con->window_rect.width ||
+                              state->window_rect.height != con->window_rect.height);
+        if (resized && con->window->sync_pending) {
+            DLOG("window 0x%08x did not redraw yet, deferring its resize\n", con->window->id);
+        } else {
+            if (resized && state->child_mapped)
+                sync_request_send(con->window);
+            DLOG("setting window rect (%d, %d, %d, %d)\n",
+                 con->window_rect.x, con->window_rect.y, con->window_rect.width, con->window_rect.height);
+            xcb_set_window_rect(conn, con->window->id, con->window_rect);
+            memcpy(&(state->window_rect), &(con->window_rect), sizeof(Rect));
+            fake_notify = true;
+            con_set_dirty(con);
+        }
+    }
+
+    if (memcmp(&(state->deco_rect), &(con->deco_rect), sizeof(Rect)) != 0) {
+        memcpy(&(state->deco_rect), &(con->deco_rect), sizeof(Rect));
+        con_set_dirty(con);
     }
 
     set_shape_state(con, need_reshape);
@@ -1052,15 +1705,19 @@ void x_push_node(Con *con) {
 
         /* copy the pixmap contents to the frame window immediately after mapping */
         if (con->frame_buffer.id != XCB_NONE) {
-            draw_util_copy_surface(&(con->frame_buffer), &(con->frame), 0, 0, 0, 0, con->rect.width, con->rect.height);
+            x_copy_frame(con);
         }
-        xcb_flush(conn);
+        if (!workspace_switch_pending)
+            xcb_flush(conn);
 
         DLOG("mapping container %08x (serial %d)\n", con->frame.id, cookie.sequence);
         state->mapped = con->mapped;
+        con_set_dirty(con);
     }
 
     state->unmap_now = (state->mapped != con->mapped) && !con->mapped;
+    if (state->unmap_now)
+        con_set_dirty(con);
     state->was_floating = con_is_floating(con);
 
     if (fake_notify) {
@@ -1070,12 +1727,9 @@ void x_push_node(Con *con) {
 
     set_hidden_state(con);
 
-    /* Handle all children and floating windows of this node. We recurse
-     * in focus order to display the focused client in a stack first when
-     * switching workspaces (reduces flickering). */
-    TAILQ_FOREACH(current, &(con->focus_head), focused) {
-        x_push_node(current);
-    }
+    x_push_children(con);
+
+    stats_end(STATS_X_PUSH_NODE, stats_start);
 }
 
 /*
@@ -1117,6 +1771,10 @@ static void x_push_node_unmaps(Con *con) {
         }
         state->mapped = con->mapped;
     }
+    state->unmap_now = false;
+
+    if (is_dormant(con))
+        return;
 
     /* handle all children and floating windows of this node */
     TAILQ_FOREACH(current, &(con->nodes_head), nodes)
@@ -1124,6 +1782,14 @@ static void x_push_node_unmaps(Con *con) {
 
     TAILQ_FOREACH(current, &(con->floating_head), floating_windows)
     x_push_node_unmaps(current);
+
+    /* All windows of a hidden workspace are unmapped now, so its subtree can
+     * be skipped until something changes. */
+    if (is_hidden_workspace(con)) {
+        DLOG("Workspace %p / %s is dormant now\n", con, con->name);
+        con->dormant = true;
+        x_release_frame_buffers_below(con);
+    }
 }
 
 /*
@@ -1144,6 +1810,140 @@ static bool is_con_attached(Con *con) {
     return false;
 }
 
+/*
+ * Restacks the frames so that X11 represents the order of state_head, with as
+ * few ConfigureWindow requests as possible: the frames which keep their
+ * relative order (the longest increasing subsequence of their positions in
+ * old_state_head) stay where they are, every other frame is put directly
+ * above the frame below it. Raising a single window therefore costs a single
+ * request instead of one per window above its old position.
+ *
+ * Returns true if the stack changed (or new frames were stacked).
+ *
+ */
+static bool x_restack(const int num_states) {
+    /* The new stack (bottom to top) and the bookkeeping for the longest
+     * increasing subsequence, grown as needed. */
+    static con_state **stack = NULL;
+    static int *tails = NULL;
+    static int *predecessors = NULL;
+    static bool *keep = NULL;
+    static int size = 0;
+
+    if (num_states > size) {
+        size = num_states;
+        stack = srealloc(stack, size * sizeof(con_state *));
+        tails = srealloc(tails, size * sizeof(int));
+        predecessors = srealloc(predecessors, size * sizeof(int));
+        keep = srealloc(keep, size * sizeof(bool));
+    }
+
+    con_state *state;
+    int position = 0;
+    CIRCLEQ_FOREACH_REVERSE(state, &old_state_head, old_state) {
+        state->old_position = position++;
+    }
+
+    /* Frames which were not created yet are skipped, x_stack_new_frame()
+     * puts them into place once they are. */
+    int num = 0;
+    CIRCLEQ_FOREACH_REVERSE(state, &state_head, state) {
+        if (state->frame_created)
+            stack[num++] = state;
+    }
+    assert(num == num_states);
+
+    /* Find the longest subsequence of the new stack whose old positions are
+     * increasing. New frames have no meaningful old position. */
+    int length = 0;
+    bool new_states = false;
+    for (int i = 0; i < num; i++) {
+        keep[i] = false;
+        predecessors[i] = -1;
+        if (stack[i]->initial) {
+            new_states = true;
+            continue;
+        }
+
+        int low = 0;
+        int high = length;
+        while (low < high) {
+            const int mid = low + (high - low) / 2;
+            if (stack[tails[mid]]->old_position < stack[i]->old_position)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+        if (low > 0)
+            predecessors[i] = tails[low - 1];
+        tails[low] = i;
+        if (low == length)
+            length++;
+    }
+
+    int lowest_kept = -1;
+    for (int i = (length > 0 ? tails[length - 1] : -1); i != -1; i = predecessors[i]) {
+        keep[i] = true;
+        lowest_kept = i;
+    }
+
+    /* Going from bottom to top, every moved frame ends up directly above the
+     * (already correctly stacked) frame below it. */
+    bool restacked = false;
+    for (int i = 0; i < num; i++) {
+        state = stack[i];
+        state->initial = false;
+        if (keep[i])
+            continue;
+
+        const uint32_t mask = XCB_CONFIG_WINDOW_SIBLING | XCB_CONFIG_WINDOW_STACK_MODE;
+        if (i > 0) {
+            const uint32_t values[] = {stack[i - 1]->id, XCB_STACK_MODE_ABOVE};
+            xcb_configure_window(conn, state->id, mask, values);
+            restacked = true;
+        } else if (lowest_kept != -1) {
+            const uint32_t values[] = {stack[lowest_kept]->id, XCB_STACK_MODE_BELOW};
+            xcb_configure_window(conn, state->id, mask, values);
+            restacked = true;
+        }
+    }
+
+    return restacked || new_states;
+}
+
+/*
+ * Updates _NET_CLIENT_LIST_STACKING (bottom-to-top stacking order) and
+ * _NET_CLIENT_LIST (initial mapping order) with the num_clients windows which
+ * are managed by i3. Only what differs from the previous values is sent, see
+ * change_root_property().
+ *
+ */
+static void x_update_client_lists(const int num_clients) {
+    static xcb_window_t *client_list_windows = NULL;
+    static int client_list_size = 0;
+
+    if (num_clients > client_list_size) {
+        client_list_size = num_clients;
+        client_list_windows = srealloc(client_list_windows, sizeof(xcb_window_t) * client_list_size);
+    }
+
+    con_state *state;
+    xcb_window_t *walk = client_list_windows;
+    CIRCLEQ_FOREACH_REVERSE(state, &state_head, state) {
+        if (con_has_managed_window(state->con))
+            *walk++ = state->con->window->id;
+    }
+    ewmh_update_client_list_stacking(client_list_windows, num_clients);
+
+    /* reorder by initial mapping */
+    walk = client_list_windows;
+    TAILQ_FOREACH(state, &initial_mapping_head, initial_mapping_order) {
+        if (con_has_managed_window(state->con))
+            *walk++ = state->con->window->id;
+    }
+    ewmh_update_client_list(client_list_windows, num_clients);
+}
+
 /*
  * Pushes all changes (state of each node, see x_push_node() and the window
  * stack) to X11.
@@ -1158,119 +1958,127 @@ static bool is_con_attached(Con *con) {
 void x_push_changes(Con *con) {
     con_state *state;
     xcb_query_pointer_cookie_t pointercookie;
+    const uint64_t stats_start = stats_begin(STATS_X_PUSH_CHANGES);
+    const stats_x_subsystem_t x_subsystem = stats_x_enter(STATS_X_SUBSYSTEM_RENDER);
+    I3_PROBE1(x_push_changes__entry, con);
+    /* Changes like focusing a window on EnterNotify are pushed without a
+     * render, so they have to invalidate the tree dump here. */
+    ipc_invalidate_tree_reply();
+    con_cache_begin();
+
+    /* A workspace switch is pushed in one burst, without flushing in between,
+     * optionally inside a server grab. */
+    const bool switch_burst = workspace_switch_pending;
+    if (switch_burst && config.workspace_switch_grab_server) {
+        DLOG("Grabbing the server for the workspace switch\n");
+        xcb_grab_server(conn);
+    }
 
-    /* If we need to warp later, we request the pointer position as soon as possible */
-    if (warp_to) {
+    /* If we need to warp later, we need the pointer position. The tracked
+     * position is up to date if the most recent event with a timestamp
+     * reported it (e.g. the KeyPress which triggered this change). Otherwise,
+     * we request the pointer position as soon as possible. */
+    const bool query_pointer = (warp_to != NULL &&
+                                (!pointer_position.known || pointer_position.time != last_timestamp));
+    if (query_pointer) {
         pointercookie = xcb_query_pointer(conn, root);
     }
 
     DLOG("-- PUSHING WINDOW STACK --\n");
-    //DLOG("Disabling EnterNotify\n");
-    /* We need to keep SubstructureRedirect around, otherwise clients can send
-     * ConfigureWindow requests and get them applied directly instead of having
-     * them become ConfigureRequests that i3 handles. */
-    uint32_t values[1] = {XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT};
-    CIRCLEQ_FOREACH_REVERSE(state, &state_head, state) {
-        if (state->mapped)
-            xcb_change_window_attributes(conn, state->id, XCB_CW_EVENT_MASK, values);
-    }
-    //DLOG("Done, EnterNotify disabled\n");
+    /* Restacking, moving and mapping windows generates EnterNotify events
+     * which we must not act upon. Instead of removing EnterWindow from the
+     * event mask of every frame (and restoring it afterwards), we bracket all
+     * those requests with two NoOperation requests and ignore EnterNotify
+     * events with a sequence number in between. */
+    const unsigned int first_sequence = xcb_no_operation(conn).sequence;
+    uint32_t values[1];
     bool order_changed = false;
     bool stacking_changed = false;
 
-    /* count first, necessary to (re)allocate memory for the bottom-to-top
-     * stack afterwards */
-    int cnt = 0;
-    CIRCLEQ_FOREACH_REVERSE(state, &state_head, state)
-    if (con_has_managed_window(state->con))
-        cnt++;
-
-    /* The bottom-to-top window stack of all windows which are managed by i3.
-     * Used for x_get_window_stack(). */
-    static xcb_window_t *client_list_windows = NULL;
-    static int client_list_count = 0;
-
-    if (cnt != client_list_count) {
-        client_list_windows = srealloc(client_list_windows, sizeof(xcb_window_t) * cnt);
-        client_list_count = cnt;
-    }
-
-    xcb_window_t *walk = client_list_windows;
-
-    /* X11 correctly represents the stack if we push it from bottom to top */
+    bool new_states = false;
+    int num_states = 0;
+    int num_clients = 0;
     CIRCLEQ_FOREACH_REVERSE(state, &state_head, state) {
         if (con_has_managed_window(state->con))
-            memcpy(walk++, &(state->con->window->id), sizeof(xcb_window_t));
+            num_clients++;
 
-        //DLOG("stack: 0x%08x\n", state->id);
-        con_state *prev = CIRCLEQ_PREV(state, state);
-        con_state *old_prev = CIRCLEQ_PREV(state, old_state);
-        if (prev != old_prev)
+        if (CIRCLEQ_PREV(state, state) != CIRCLEQ_PREV(state, old_state))
             order_changed = true;
-        if ((state->initial || order_changed) && prev != CIRCLEQ_END(&state_head)) {
-            stacking_changed = true;
-            //DLOG("Stacking 0x%08x above 0x%08x\n", prev->id, state->id);
-            uint32_t mask = 0;
-            mask |= XCB_CONFIG_WINDOW_SIBLING;
-            mask |= XCB_CONFIG_WINDOW_STACK_MODE;
-            uint32_t values[] = {state->id, XCB_STACK_MODE_ABOVE};
-
-            xcb_configure_window(conn, prev->id, mask, values);
-        }
-        state->initial = false;
+        if (!state->frame_created)
+            continue;
+        if (state->initial)
+            new_states = true;
+        num_states++;
     }
 
-    /* If we re-stacked something (or a new window appeared), we need to update
-     * the _NET_CLIENT_LIST and _NET_CLIENT_LIST_STACKING hints */
-    if (stacking_changed) {
-        DLOG("Client list changed (%i clients)\n", cnt);
-        ewmh_update_client_list_stacking(client_list_windows, client_list_count);
-
-        walk = client_list_windows;
-
-        /* reorder by initial mapping */
-        TAILQ_FOREACH(state, &initial_mapping_head, initial_mapping_order) {
-            if (con_has_managed_window(state->con))
-                *walk++ = state->con->window->id;
-        }
+    if (order_changed || new_states)
+        stacking_changed = x_restack(num_states);
+
+    /* If we re-stacked something (or a window appeared or disappeared), we
+     * need to update the _NET_CLIENT_LIST and _NET_CLIENT_LIST_STACKING
+     * hints. */
+    static int num_listed_clients = 0;
+    if (stacking_changed || order_changed || num_clients != num_listed_clients) {
+        DLOG("Client list changed (%i clients)\n", num_clients);
+        x_update_client_lists(num_clients);
+        num_listed_clients = num_clients;
+    }
 
-        ewmh_update_client_list(client_list_windows, client_list_count);
+    /* The focused and previously focused containers (and everything inside
+     * them) change their colors. */
+    static Con *last_drawn_focus = NULL;
+    if (focused != last_drawn_focus) {
+        if (last_drawn_focus != NULL && con_exists(last_drawn_focus))
+            con_set_dirty(last_drawn_focus);
+        con_set_dirty(focused);
+        last_drawn_focus = focused;
     }
 
+    Con *global_fullscreen = con_get_fullscreen_con(croot, CF_GLOBAL);
+    global_fullscreen_ws = (global_fullscreen ? con_get_workspace(global_fullscreen) : NULL);
+
     DLOG("PUSHING CHANGES\n");
     x_push_node(con);
 
     if (warp_to) {
-        xcb_query_pointer_reply_t *pointerreply = xcb_query_pointer_reply(conn, pointercookie, NULL);
-        if (!pointerreply) {
-            ELOG("Could not query pointer position, not warping pointer\n");
-        } else {
+        bool have_pointer = true;
+        if (query_pointer) {
+            xcb_query_pointer_reply_t *pointerreply = xcb_query_pointer_reply(conn, pointercookie, NULL);
+            if (!pointerreply) {
+                ELOG("Could not query pointer position, not warping pointer\n");
+                have_pointer = false;
+            } else {
+                x_set_pointer_position(pointerreply->root_x, pointerreply->root_y, last_timestamp);
+                free(pointerreply);
+            }
+        }
+
+        if (have_pointer) {
             int mid_x = warp_to->x + (warp_to->width / 2);
             int mid_y = warp_to->y + (warp_to->height / 2);
 
-            Output *current = get_output_containing(pointerreply->root_x, pointerreply->root_y);
+            Output *current = get_output_containing(pointer_position.x, pointer_position.y);
             Output *target = get_output_containing(mid_x, mid_y);
             if (current != target) {
                 /* Ignore MotionNotify events generated by warping */
                 xcb_change_window_attributes(conn, root, XCB_CW_EVENT_MASK, (uint32_t[]){XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT});
                 xcb_warp_pointer(conn, XCB_NONE, root, 0, 0, 0, 0, mid_x, mid_y);
                 xcb_change_window_attributes(conn, root, XCB_CW_EVENT_MASK, (uint32_t[]){ROOT_EVENT_MASK});
+                x_set_pointer_position(mid_x, mid_y, last_timestamp);
             }
-
-            free(pointerreply);
         }
         warp_to = NULL;
     }
 
-    //DLOG("Re-enabling EnterNotify\n");
-    values[0] = FRAME_EVENT_MASK;
-    CIRCLEQ_FOREACH_REVERSE(state, &state_head, state) {
-        if (state->mapped)
-            xcb_change_window_attributes(conn, state->id, XCB_CW_EVENT_MASK, values);
-    }
-    //DLOG("Done, EnterNotify re-enabled\n");
+    const unsigned int last_sequence = xcb_no_operation(conn).sequence;
+    add_ignore_event_range(first_sequence, last_sequence, XCB_ENTER_NOTIFY);
 
-    x_deco_recurse(con);
+    /* Count the requests between our two NoOperations. Decorations and the
+     * input focus, which are pushed below, are not included. */
+    const unsigned int requests = last_sequence - first_sequence - 1;
+    stats_add_x_requests(STATS_X_PUSH_CHANGES, requests);
+
+    x_deco_recurse_dirty(con);
 
     xcb_window_t to_focus = focused->frame.id;
     if (focused->window != NULL)
@@ -1329,7 +2137,8 @@ void x_push_changes(Con *con) {
         last_focused = XCB_NONE;
     }
 
-    xcb_flush(conn);
+    if (!switch_burst)
+        xcb_flush(conn);
     DLOG("ENDING CHANGES\n");
 
     /* Disable EnterWindow events for windows which will be unmapped in
@@ -1358,7 +2167,44 @@ void x_push_changes(Con *con) {
     //    DLOG("old stack: 0x%08x\n", state->id);
     //}
 
+    con_cache_end();
+    stats_end(STATS_X_PUSH_CHANGES, stats_start);
+    I3_PROBE1(x_push_changes__return, requests);
+
+    if (switch_burst) {
+        ewmh_update_current_desktop();
+        if (config.workspace_switch_grab_server)
+            xcb_ungrab_server(conn);
+        workspace_switch_pending = false;
+    }
+
     xcb_flush(conn);
+    stats_x_leave(x_subsystem);
+    stats_x_render_done();
+
+    ipc_send_tree_event();
+    shmstate_update();
+
+    /* The IPC events of the workspace switch go out once X11 shows it. */
+    if (switch_burst)
+        ipc_release_messages();
+}
+
+/*
+ * Starts a workspace switch: the next x_push_changes() sends all of its
+ * requests to X11 at once (inside a server grab if workspace_switch_grab_server
+ * is enabled) and updates _NET_CURRENT_DESKTOP afterwards. IPC messages are
+ * held until then. Schedules a render, so that the switch is always
+ * completed.
+ *
+ */
+void x_begin_workspace_switch(void) {
+    if (workspace_switch_pending)
+        return;
+
+    workspace_switch_pending = true;
+    ipc_hold_messages();
+    tree_schedule_render();
 }
 
 /*
@@ -1408,7 +2254,7 @@ void update_shmlog_atom(void) {
 }
 
 /*
- * Sets up i3 specific atoms (I3_SOCKET_PATH and I3_CONFIG_PATH)
+ * Sets up i3 specific atoms (I3_SOCKET_PATH, I3_CONFIG_PATH and I3_STATE_PATH)
  *
  */
 void x_set_i3_atoms(void) {
@@ -1419,6 +2265,12 @@ void x_set_i3_atoms(void) {
     xcb_change_property(conn, XCB_PROP_MODE_REPLACE, root, A_I3_PID, XCB_ATOM_CARDINAL, 32, 1, &pid);
     xcb_change_property(conn, XCB_PROP_MODE_REPLACE, root, A_I3_CONFIG_PATH, A_UTF8_STRING, 8,
                         strlen(current_configpath), current_configpath);
+    if (*shmstatename == '\0') {
+        xcb_delete_property(conn, root, A_I3_STATE_PATH);
+    } else {
+        xcb_change_property(conn, XCB_PROP_MODE_REPLACE, root, A_I3_STATE_PATH, A_UTF8_STRING, 8,
+                            strlen(shmstatename), shmstatename);
+    }
     update_shmlog_atom();
 }
 
@@ -1432,6 +2284,19 @@ void x_set_warp_to(Rect *rect) {
         warp_to = rect;
 }
 
+/*
+ * Records the pointer position reported by an event (KeyPress, ButtonPress,
+ * MotionNotify, EnterNotify) with the given timestamp, so that
+ * x_push_changes() does not need to query it for warping.
+ *
+ */
+void x_set_pointer_position(int16_t root_x, int16_t root_y, xcb_timestamp_t time) {
+    pointer_position.known = true;
+    pointer_position.x = root_x;
+    pointer_position.y = root_y;
+    pointer_position.time = time;
+}
+
 /*
  * Applies the given mask to the event mask of every i3 window decoration X11
  * window. This is useful to disable EnterNotify while resizing so that focus
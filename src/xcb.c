@@ -11,6 +11,15 @@
 
 unsigned int xcb_numlock_mask;
 
+/*
+ * Called when creating a window in create_window() failed.
+ *
+ */
+static void create_window_failed(xcb_generic_error_t *error, void *data) {
+    ELOG("Could not create window 0x%08x. Error code: %d.\n",
+         (xcb_window_t)(uintptr_t)data, error->error_code);
+}
+
 /*
  * Convenience wrapper around xcb_create_window which takes care of depth, generating an ID and checking
  * for errors.
@@ -20,7 +29,18 @@ xcb_window_t create_window(xcb_connection_t *conn, Rect dims,
                            uint16_t depth, xcb_visualid_t visual, uint16_t window_class,
                            enum xcursor_cursor_t cursor, bool map, uint32_t mask, uint32_t *values) {
     xcb_window_t result = xcb_generate_id(conn);
+    create_window_with_id(conn, result, dims, depth, visual, window_class, cursor, map, mask, values);
+    return result;
+}
 
+/*
+ * Like create_window(), but uses an ID which was generated before, for windows
+ * which are referred to before they are created (see x_con_init()).
+ *
+ */
+void create_window_with_id(xcb_connection_t *conn, xcb_window_t result, Rect dims,
+                           uint16_t depth, xcb_visualid_t visual, uint16_t window_class,
+                           enum xcursor_cursor_t cursor, bool map, uint32_t mask, uint32_t *values) {
     /* If the window class is XCB_WINDOW_CLASS_INPUT_ONLY, we copy depth and
      * visual id from the parent window. */
     if (window_class == XCB_WINDOW_CLASS_INPUT_ONLY) {
@@ -39,10 +59,7 @@ xcb_window_t create_window(xcb_connection_t *conn, Rect dims,
                                                     mask,
                                                     values);
 
-    xcb_generic_error_t *error = xcb_request_check(conn, gc_cookie);
-    if (error != NULL) {
-        ELOG("Could not create window. Error code: %d.\n", error->error_code);
-    }
+    add_error_callback(gc_cookie.sequence, create_window_failed, (void *)(uintptr_t)result);
 
     /* Set the cursor */
     if (xcursor_supported) {
@@ -63,14 +80,17 @@ xcb_window_t create_window(xcb_connection_t *conn, Rect dims,
     /* Map the window (= make it visible) */
     if (map)
         xcb_map_window(conn, result);
-
-    return result;
 }
 
 /*
  * Generates a configure_notify_event with absolute coordinates (relative to the X root
  * window, not to the client’s frame) for the given client.
  *
+ * The event is only sent when the geometry differs from the one of the last
+ * event sent to the client: clients which send many ConfigureRequests would
+ * otherwise relayout for each of the replies, even though they already know
+ * the geometry i3 enforces.
+ *
  */
 void fake_absolute_configure_notify(Con *con) {
     xcb_rectangle_t absolute;
@@ -82,6 +102,17 @@ void fake_absolute_configure_notify(Con *con) {
     absolute.width = con->window_rect.width;
     absolute.height = con->window_rect.height;
 
+    i3Window *window = con->window;
+    if (window->notified &&
+        window->notified_border_width == con->border_width &&
+        memcmp(&(window->notified_rect), &absolute, sizeof(xcb_rectangle_t)) == 0) {
+        DLOG("fake rect unchanged, not sending a configure notify\n");
+        return;
+    }
+    window->notified = true;
+    window->notified_rect = absolute;
+    window->notified_border_width = con->border_width;
+
     DLOG("fake rect = (%d, %d, %d, %d)\n", absolute.x, absolute.y, absolute.width, absolute.height);
 
     fake_configure_notify(conn, absolute, con->window->id, con->border_width);
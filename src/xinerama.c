@@ -53,6 +53,7 @@ static void query_screens(xcb_connection_t *conn) {
                can always see the complete workspace */
             s->rect.width = min(s->rect.width, screen_info[screen].width);
             s->rect.height = min(s->rect.height, screen_info[screen].height);
+            output_index_invalidate();
         } else {
             s = scalloc(1, sizeof(Output));
             struct output_name *output_name = scalloc(1, sizeof(struct output_name));
@@ -70,6 +71,7 @@ static void query_screens(xcb_connection_t *conn) {
                 TAILQ_INSERT_HEAD(&outputs, s, outputs);
             else
                 TAILQ_INSERT_TAIL(&outputs, s, outputs);
+            output_index_invalidate();
             output_init_con(s);
             init_ws_for_output(s);
             num_screens++;
@@ -97,6 +99,7 @@ static void use_root_output(xcb_connection_t *conn) {
     Output *s = create_root_output(conn);
     s->active = true;
     TAILQ_INSERT_TAIL(&outputs, s, outputs);
+    output_index_invalidate();
     output_init_con(s);
     init_ws_for_output(s);
 }
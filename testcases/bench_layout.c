@@ -0,0 +1,198 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * bench_layout.c: A benchmark of render_con() and the tree operations, which
+ *                 runs without an X server: the layout code is linked against
+ *                 the stub X layer in bench_x_stubs.c and uses fake outputs.
+ *
+ *                 For each synthetic tree, render, focus, move and close are
+ *                 measured separately. Compare the results of the different
+ *                 sizes of a tree to spot asymptotic regressions.
+ *
+ */
+#include "all.h"
+
+#include "bench_parser.h"
+
+#define BENCH_OUTPUTS "1280x800+0+0P,1280x800+1280+0,1280x800+0+800,1280x800+1280+800"
+
+typedef struct scenario {
+    const char *name;
+    /* Builds the tree (of the given size) on the focused output. */
+    void (*build)(int size);
+    int size;
+} scenario;
+
+static Con *open_workspace(const char *name) {
+    Con *ws = workspace_get(name, NULL);
+    workspace_show(ws);
+    return ws;
+}
+
+/*
+ * Nested splits of alternating orientation: every level contains one leaf
+ * and the split container of the next level.
+ *
+ */
+static void build_deep_splits(int depth) {
+    char *name;
+    sasprintf(&name, "deep-%d", depth);
+    Con *ws = open_workspace(name);
+    free(name);
+
+    Con *leaf = tree_open_con(ws, NULL);
+    for (int i = 0; i < depth; i++) {
+        leaf = tree_open_con(leaf->parent, NULL);
+        tree_split(leaf, (i % 2 == 0 ? VERT : HORIZ));
+    }
+    con_activate(leaf);
+}
+
+/*
+ * A single tabbed container with many tabs.
+ *
+ */
+static void build_wide_tabs(int tabs) {
+    char *name;
+    sasprintf(&name, "tabs-%d", tabs);
+    Con *ws = open_workspace(name);
+    free(name);
+
+    Con *leaf = NULL;
+    for (int i = 0; i < tabs; i++)
+        leaf = tree_open_con(ws, NULL);
+    con_activate(leaf);
+    con_set_layout(ws, L_TABBED);
+}
+
+/*
+ * Many workspaces with two windows each on every output.
+ *
+ */
+static void build_workspaces(int per_output) {
+    Con *output;
+    int output_idx = 0;
+    TAILQ_FOREACH(output, &(croot->nodes_head), nodes) {
+        if (con_is_internal(output))
+            continue;
+        workspace_show(con_get_fullscreen_con(output_get_content(output), CF_OUTPUT));
+        for (int i = 0; i < per_output; i++) {
+            char *name;
+            sasprintf(&name, "ws-%d-%d", output_idx, i);
+            Con *ws = workspace_get(name, NULL);
+            free(name);
+            tree_open_con(ws, NULL);
+            tree_open_con(ws, NULL);
+        }
+        output_idx++;
+    }
+    Con *first = TAILQ_FIRST(&(output_get_content(con_get_output(focused))->nodes_head));
+    workspace_show(first);
+}
+
+static void collect_leaves(Con *con, Con ***leaves, int *num, int *size) {
+    if (con_is_leaf(con) && con->type == CT_CON) {
+        if (*num == *size) {
+            *size = (*size == 0 ? 64 : *size * 2);
+            *leaves = srealloc(*leaves, *size * sizeof(Con *));
+        }
+        (*leaves)[(*num)++] = con;
+        return;
+    }
+    Con *child;
+    TAILQ_FOREACH(child, &(con->nodes_head), nodes) {
+        collect_leaves(child, leaves, num, size);
+    }
+}
+
+static void report(const char *operation, uint64_t ops, double seconds, uint64_t allocations) {
+    if (seconds <= 0)
+        seconds = 1e-9;
+    printf("  %-7s %10.0f ops/s %10.2f µs/op", operation, ops / seconds, seconds * 1e6 / ops);
+#if defined(__GLIBC__)
+    printf(" %10.2f allocations/op", (double)allocations / ops);
+#endif
+    printf("\n");
+}
+
+static void run_scenario(const scenario *s, int iterations) {
+    s->build(s->size);
+
+    Con **leaves = NULL;
+    int num_leaves = 0, size = 0;
+    collect_leaves(croot, &leaves, &num_leaves, &size);
+    printf("%s %d: %d leaves\n", s->name, s->size, num_leaves);
+
+    /* render */
+    uint64_t allocations = bench_allocations;
+    double start = bench_now();
+    for (int i = 0; i < iterations; i++)
+        tree_render();
+    report("render", iterations, bench_now() - start, bench_allocations - allocations);
+
+    /* focus, cycling through all leaves */
+    allocations = bench_allocations;
+    start = bench_now();
+    for (int i = 0; i < iterations; i++) {
+        Con *leaf = leaves[i % num_leaves];
+        Con *ws = con_get_workspace(leaf);
+        if (ws != con_get_workspace(focused))
+            workspace_show(ws);
+        con_activate(leaf);
+    }
+    report("focus", iterations, bench_now() - start, bench_allocations - allocations);
+
+    /* move the focused container back and forth */
+    allocations = bench_allocations;
+    start = bench_now();
+    for (int i = 0; i < iterations; i++)
+        tree_move(focused, (i % 2 == 0 ? D_LEFT : D_RIGHT));
+    report("move", iterations, bench_now() - start, bench_allocations - allocations);
+
+    /* close all leaves, which also closes the then empty split containers */
+    allocations = bench_allocations;
+    start = bench_now();
+    for (int i = 0; i < num_leaves; i++)
+        tree_close_internal(leaves[i], DONT_KILL_WINDOW, false);
+    report("close", num_leaves, bench_now() - start, bench_allocations - allocations);
+
+    free(leaves);
+}
+
+int main(int argc, char *argv[]) {
+    const int iterations = bench_iterations(argc, argv, 1);
+    static const scenario scenarios[] = {
+        {"deep splits", build_deep_splits, 32},
+        {"deep splits", build_deep_splits, 128},
+        {"wide tabs", build_wide_tabs, 100},
+        {"wide tabs", build_wide_tabs, 1000},
+        {"workspaces per output", build_workspaces, 16},
+        {"workspaces per output", build_workspaces, 64},
+    };
+
+    shmlog_size = 0;
+    init_logging();
+
+    /* The defaults of load_configuration(), without loading a font. */
+    config.font.height = 16;
+    config.default_border = BS_NORMAL;
+    config.default_floating_border = BS_NORMAL;
+    config.default_border_width = logical_px(2);
+    config.default_floating_border_width = logical_px(2);
+    config.default_orientation = NO_ORIENTATION;
+    config.focus_wrapping = FOCUS_WRAPPING_ON;
+    extract_workspace_names_from_bindings();
+
+    xcb_get_geometry_reply_t geometry = {.width = 2560, .height = 1600};
+    tree_init(&geometry);
+    fake_outputs_init(BENCH_OUTPUTS);
+    tree_render();
+
+    printf("%d iterations, outputs %s\n", iterations, BENCH_OUTPUTS);
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++)
+        run_scenario(&scenarios[i], iterations);
+    return 0;
+}
@@ -0,0 +1,196 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * bench_outputs.c: A benchmark of the output- and workspace-related operations
+ *                  with many outputs, which runs without an X server just like
+ *                  bench.layout (see bench_x_stubs.c).
+ *
+ *                  The scenario consists of 16 fake outputs (a 4x4 grid),
+ *                  100 workspaces assigned round-robin to the outputs and
+ *                  1000 windows (placeholder containers, 10 per workspace).
+ *                  Every operation includes the tree_render() which the
+ *                  corresponding command triggers, so the numbers are the
+ *                  latency as seen by the user (minus X11).
+ *
+ */
+#include "all.h"
+
+#include "bench_parser.h"
+
+#define BENCH_OUTPUTS_X 4
+#define BENCH_OUTPUTS_Y 4
+#define BENCH_NUM_OUTPUTS (BENCH_OUTPUTS_X * BENCH_OUTPUTS_Y)
+#define BENCH_NUM_WORKSPACES 100
+#define BENCH_WINDOWS_PER_WORKSPACE 10
+
+static Output *bench_outputs[BENCH_NUM_OUTPUTS];
+static Con *bench_workspaces[BENCH_NUM_WORKSPACES];
+
+/*
+ * Returns the --fake-outputs specification for a grid of 1280x800 outputs, the
+ * top left one being the primary output.
+ *
+ */
+static char *outputs_spec(void) {
+    char *spec = sstrdup("");
+    for (int y = 0; y < BENCH_OUTPUTS_Y; y++) {
+        for (int x = 0; x < BENCH_OUTPUTS_X; x++) {
+            char *next;
+            sasprintf(&next, "%s%s1280x800+%d+%d%s",
+                      spec, (*spec == '\0' ? "" : ","),
+                      x * 1280, y * 800, (x == 0 && y == 0 ? "P" : ""));
+            free(spec);
+            spec = next;
+        }
+    }
+    return spec;
+}
+
+/*
+ * Equivalent to “workspace <name> output <output>” in the config file, so that
+ * reconnected outputs get their workspaces back (see init_ws_for_output()).
+ *
+ */
+static void assign_workspace(const char *name, const char *output) {
+    struct Workspace_Assignment *assignment = scalloc(1, sizeof(struct Workspace_Assignment));
+    assignment->name = sstrdup(name);
+    assignment->output = sstrdup(output);
+    TAILQ_INSERT_TAIL(&ws_assignments, assignment, ws_assignments);
+    ws_assignment_index_invalidate();
+}
+
+static void build(void) {
+    for (int i = 0; i < BENCH_NUM_WORKSPACES; i++) {
+        char *name, *output;
+        sasprintf(&name, "%d", i + 1);
+        sasprintf(&output, "fake-%d", i % BENCH_NUM_OUTPUTS);
+        assign_workspace(name, output);
+        free(name);
+        free(output);
+    }
+
+    xcb_get_geometry_reply_t geometry = {
+        .width = BENCH_OUTPUTS_X * 1280,
+        .height = BENCH_OUTPUTS_Y * 800,
+    };
+    tree_init(&geometry);
+    char *spec = outputs_spec();
+    fake_outputs_init(spec);
+    free(spec);
+
+    int num_outputs = 0;
+    Output *output;
+    TAILQ_FOREACH(output, &outputs, outputs) {
+        if (num_outputs < BENCH_NUM_OUTPUTS)
+            bench_outputs[num_outputs] = output;
+        num_outputs++;
+    }
+    assert(num_outputs == BENCH_NUM_OUTPUTS);
+
+    for (int i = 0; i < BENCH_NUM_WORKSPACES; i++) {
+        char *name;
+        sasprintf(&name, "%d", i + 1);
+        bench_workspaces[i] = workspace_get(name, NULL);
+        free(name);
+        for (int j = 0; j < BENCH_WINDOWS_PER_WORKSPACE; j++)
+            tree_open_con(bench_workspaces[i], NULL);
+    }
+    workspace_show(bench_workspaces[0]);
+    tree_render();
+}
+
+static void report(const char *operation, uint64_t ops, double seconds, uint64_t allocations) {
+    if (seconds <= 0)
+        seconds = 1e-9;
+    printf("  %-18s %10.0f ops/s %10.2f µs/op", operation, ops / seconds, seconds * 1e6 / ops);
+#if defined(__GLIBC__)
+    printf(" %10.2f allocations/op", (double)allocations / ops);
+#endif
+    printf("\n");
+}
+
+/*
+ * Unplugs the given output (its workspaces move to the first output) and plugs
+ * it in again (its assigned workspaces move back), which is what
+ * randr_query_outputs() does for an output which is turned off and on again.
+ *
+ */
+static void reconnect_output(Output *output) {
+    output->to_be_disabled = true;
+    randr_disable_output(output);
+
+    output->active = true;
+    output_index_invalidate();
+    output_init_con(output);
+    init_ws_for_output(output);
+}
+
+int main(int argc, char *argv[]) {
+    const int iterations = bench_iterations(argc, argv, 1);
+
+    shmlog_size = 0;
+    init_logging();
+
+    /* The defaults of load_configuration(), without loading a font. */
+    config.font.height = 16;
+    config.default_border = BS_NORMAL;
+    config.default_floating_border = BS_NORMAL;
+    config.default_border_width = logical_px(2);
+    config.default_floating_border_width = logical_px(2);
+    config.default_orientation = NO_ORIENTATION;
+    config.focus_wrapping = FOCUS_WRAPPING_ON;
+    extract_workspace_names_from_bindings();
+
+    build();
+    printf("%d iterations, %d outputs, %d workspaces, %d windows\n",
+           iterations, BENCH_NUM_OUTPUTS, BENCH_NUM_WORKSPACES,
+           BENCH_NUM_WORKSPACES * BENCH_WINDOWS_PER_WORKSPACE);
+
+    /* workspace switch, jumping between outputs (7 is coprime to 16) */
+    uint64_t allocations = bench_allocations;
+    double start = bench_now();
+    for (int i = 0; i < iterations; i++) {
+        workspace_show(bench_workspaces[(i * 7) % BENCH_NUM_WORKSPACES]);
+        tree_render();
+    }
+    report("workspace switch", iterations, bench_now() - start, bench_allocations - allocations);
+
+    /* focus output, like cmd_focus_output() */
+    allocations = bench_allocations;
+    start = bench_now();
+    for (int i = 0; i < iterations; i++) {
+        Output *output = bench_outputs[i % BENCH_NUM_OUTPUTS];
+        Con *ws = NULL;
+        GREP_FIRST(ws, output_get_content(output->con), workspace_is_visible(child));
+        workspace_show(ws);
+        tree_render();
+    }
+    report("focus output", iterations, bench_now() - start, bench_allocations - allocations);
+
+    /* output change: reconnect every output but the primary one in turn */
+    allocations = bench_allocations;
+    start = bench_now();
+    for (int i = 0; i < iterations; i++) {
+        reconnect_output(bench_outputs[1 + i % (BENCH_NUM_OUTPUTS - 1)]);
+        tree_render();
+    }
+    report("output change", iterations, bench_now() - start, bench_allocations - allocations);
+
+    /* move workspace to output, always to a different output */
+    allocations = bench_allocations;
+    start = bench_now();
+    for (int i = 0; i < iterations; i++) {
+        Con *ws = bench_workspaces[i % BENCH_NUM_WORKSPACES];
+        Output *output = bench_outputs[(i * 5) % BENCH_NUM_OUTPUTS];
+        if (output == get_output_for_con(ws))
+            output = bench_outputs[(i * 5 + 1) % BENCH_NUM_OUTPUTS];
+        workspace_move_to_output(ws, output);
+        tree_render();
+    }
+    report("move ws to output", iterations, bench_now() - start, bench_allocations - allocations);
+
+    return 0;
+}
@@ -0,0 +1,159 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * bench_parser.c: Helpers for the parser benchmarks (bench.commands_parser,
+ *                 bench.config_parser), which are built from the parsers’
+ *                 TEST_PARSER mains. Heap allocations are counted by
+ *                 replacing malloc(), calloc() and realloc().
+ *
+ */
+#include "bench_parser.h"
+
+#include <err.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+uint64_t bench_allocations = 0;
+
+#if defined(__GLIBC__)
+
+static const bool counts_allocations = true;
+
+/* glibc explicitly supports replacing the allocator, and exports its own
+ * implementation under these names. */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+void *malloc(size_t size) {
+    bench_allocations++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+    bench_allocations++;
+    return __libc_calloc(nmemb, size);
+}
+
+/* Growing a buffer counts as an allocation, too: it usually means copying. */
+void *realloc(void *ptr, size_t size) {
+    bench_allocations++;
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+    __libc_free(ptr);
+}
+
+#else
+
+static const bool counts_allocations = false;
+
+#endif
+
+static int saved_stdout = -1;
+static int saved_stderr = -1;
+
+/*
+ * Reads the whole file into a newly allocated, NUL-terminated buffer.
+ *
+ */
+char *bench_read_file(const char *path, size_t *len) {
+    int fd = open(path, O_RDONLY);
+    struct stat stbuf;
+    if (fd == -1 || fstat(fd, &stbuf) == -1)
+        err(EXIT_FAILURE, "Could not open %s", path);
+
+    char *buf = malloc(stbuf.st_size + 1);
+    if (buf == NULL)
+        err(EXIT_FAILURE, "malloc(%zd)", (ssize_t)stbuf.st_size + 1);
+    size_t read_bytes = 0;
+    while (read_bytes < (size_t)stbuf.st_size) {
+        ssize_t n = read(fd, buf + read_bytes, stbuf.st_size - read_bytes);
+        if (n <= 0)
+            err(EXIT_FAILURE, "Could not read %s", path);
+        read_bytes += n;
+    }
+    close(fd);
+    buf[read_bytes] = '\0';
+    *len = read_bytes;
+    return buf;
+}
+
+/*
+ * Returns the number of iterations given on the command line (at argv[idx]),
+ * or the default.
+ *
+ */
+int bench_iterations(int argc, char *argv[], int idx) {
+    if (argc <= idx)
+        return BENCH_DEFAULT_ITERATIONS;
+    const int iterations = atoi(argv[idx]);
+    if (iterations <= 0)
+        errx(EXIT_FAILURE, "Invalid number of iterations: %s", argv[idx]);
+    return iterations;
+}
+
+/*
+ * Redirects stdout and stderr to /dev/null (or restores them), so that the
+ * output of the TEST_PARSER builds does not dominate the measurement.
+ *
+ */
+void bench_silence(bool silence) {
+    fflush(stdout);
+    fflush(stderr);
+    if (silence) {
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull == -1)
+            err(EXIT_FAILURE, "Could not open /dev/null");
+        saved_stdout = dup(STDOUT_FILENO);
+        saved_stderr = dup(STDERR_FILENO);
+        dup2(devnull, STDOUT_FILENO);
+        dup2(devnull, STDERR_FILENO);
+        close(devnull);
+    } else if (saved_stdout != -1) {
+        dup2(saved_stdout, STDOUT_FILENO);
+        dup2(saved_stderr, STDERR_FILENO);
+        close(saved_stdout);
+        close(saved_stderr);
+        saved_stdout = saved_stderr = -1;
+    }
+}
+
+/*
+ * Returns the current CLOCK_MONOTONIC time in seconds.
+ *
+ */
+double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Prints the throughput of the given number of parses of bytes bytes in
+ * total, and the allocations per parse.
+ *
+ */
+void bench_report(const char *what, uint64_t parses, uint64_t bytes, double seconds, uint64_t allocations) {
+    if (seconds <= 0)
+        seconds = 1e-9;
+    printf("%s: %" PRIu64 " parses in %.3f s\n", what, parses, seconds);
+    printf("  %.0f parses/s, %.2f MB/s, %.2f µs per parse\n",
+           parses / seconds, bytes / seconds / (1024 * 1024), seconds * 1e6 / parses);
+    if (counts_allocations)
+        printf("  %.2f allocations per parse\n", (double)allocations / parses);
+    else
+        printf("  allocations are only counted with glibc\n");
+}
@@ -0,0 +1,60 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * bench_parser.c: Helpers for the parser benchmarks (bench.commands_parser,
+ *                 bench.config_parser), which are built from the parsers’
+ *                 TEST_PARSER mains. Heap allocations are counted by
+ *                 replacing malloc(), calloc() and realloc().
+ *
+ */
+#pragma once
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Used when the number of iterations is not given on the command line. */
+#define BENCH_DEFAULT_ITERATIONS 1000
+
+/**
+ * The number of heap allocations so far (always 0 without glibc).
+ *
+ */
+extern uint64_t bench_allocations;
+
+/**
+ * Reads the whole file into a newly allocated, NUL-terminated buffer.
+ *
+ */
+char *bench_read_file(const char *path, size_t *len);
+
+/**
+ * Returns the number of iterations given on the command line (at argv[idx]),
+ * or the default.
+ *
+ */
+int bench_iterations(int argc, char *argv[], int idx);
+
+/**
+ * Redirects stdout and stderr to /dev/null (or restores them), so that the
+ * output of the TEST_PARSER builds does not dominate the measurement.
+ *
+ */
+void bench_silence(bool silence);
+
+/**
+ * Returns the current CLOCK_MONOTONIC time in seconds.
+ *
+ */
+double bench_now(void);
+
+/**
+ * Prints the throughput of the given number of parses of bytes bytes in
+ * total, and the allocations per parse.
+ *
+ */
+void bench_report(const char *what, uint64_t parses, uint64_t bytes, double seconds, uint64_t allocations);
@@ -0,0 +1,167 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * bench_x_stubs.c: A stub X layer for bench.layout. The layout code (render.c,
+ *                  con.c, tree.c, move.c, workspace.c, …) only reaches X11,
+ *                  IPC clients and the event loop through the functions below,
+ *                  so linking against these instead of x.c, ewmh.c, ipc.c and
+ *                  handlers.c leaves only the geometry to be measured.
+ *
+ *                  Containers created by the benchmark never have a window,
+ *                  so the xcb_*() calls remaining in the layout code are never
+ *                  reached.
+ *
+ */
+#include "all.h"
+
+xcb_connection_t *conn;
+/* NULL, so that logical_px() returns its argument unscaled. */
+xcb_screen_t *root_screen;
+xcb_window_t root;
+uint8_t root_depth;
+struct ev_loop *main_loop;
+char **start_argv;
+
+bool xcursor_supported = false;
+bool shape_supported = false;
+
+Config config;
+/* No key bindings, see extract_workspace_names_from_bindings(). */
+static struct bindings_head no_bindings = TAILQ_HEAD_INITIALIZER(no_bindings);
+struct bindings_head *bindings = &no_bindings;
+struct ws_assignments_head ws_assignments = TAILQ_HEAD_INITIALIZER(ws_assignments);
+
+pid_t command_error_nagbar_pid = -1;
+pid_t config_error_nagbar_pid = -1;
+
+/* x.c */
+
+void x_con_init(Con *con) {
+}
+
+void x_con_kill(Con *con) {
+}
+
+void x_move_win(Con *src, Con *dest) {
+}
+
+void x_push_changes(Con *con) {
+}
+
+void x_push_node(Con *con) {
+}
+
+void x_raise_con(Con *con) {
+}
+
+void x_reparent_child(Con *con, Con *old) {
+}
+
+void x_set_name(Con *con, const char *name) {
+}
+
+void x_set_warp_to(Rect *rect) {
+}
+
+void x_window_kill(xcb_window_t window, kill_window_t kill_window) {
+}
+
+xcb_cursor_t xcursor_get_cursor(enum xcursor_cursor_t c) {
+    return XCB_NONE;
+}
+
+/* ewmh.c */
+
+void ewmh_update_current_desktop(void) {
+}
+
+void ewmh_update_desktop_properties(void) {
+}
+
+void ewmh_update_wm_desktop(void) {
+}
+
+/* handlers.c, main.c */
+
+void add_ignore_event(const int sequence, const int response_type) {
+}
+
+void handle_event(int type, xcb_generic_event_t *event) {
+}
+
+void main_set_x11_cb(bool enable) {
+}
+
+/* ipc.c: there are no IPC clients to notify. */
+
+bool ipc_event_has_recipients(uint32_t message_type, const struct ipc_event_info *info) {
+    return false;
+}
+
+void ipc_event_info_init(struct ipc_event_info *info, const char *change, Con *con) {
+}
+
+void ipc_event_info_free(struct ipc_event_info *info) {
+}
+
+yajl_gen ipc_marshal_workspace_event(const char *change, Con *current, Con *old) {
+    return NULL;
+}
+
+void ipc_send_event(uint32_t message_type, const char *payload, const struct ipc_event_info *info) {
+}
+
+void ipc_send_window_event(const char *property, Con *con) {
+}
+
+void ipc_send_workspace_event(const char *change, Con *current, Con *old) {
+}
+
+void ipc_shutdown(shutdown_reason_t reason, int exempt_fd) {
+}
+
+void dump_node(yajl_gen gen, Con *con, bool inplace_restart) {
+}
+
+/* match.c, window.c, startup.c: the benchmark has no windows. */
+
+void match_init(Match *match) {
+    memset(match, 0, sizeof(Match));
+    match->urgent = U_DONTCHECK;
+    match->window_mode = WM_ANY;
+    match->window_type = UINT32_MAX;
+}
+
+void match_free(Match *match) {
+}
+
+bool match_matches_window(Match *match, i3Window *window) {
+    return false;
+}
+
+void window_free(i3Window *win) {
+    free(win);
+}
+
+void startup_sequence_delete_by_window(i3Window *win) {
+}
+
+/* load_layout.c, restore_layout.c, commands_parser.c */
+
+void tree_append_json(Con *con, const char *buf, const size_t len, char **errormsg) {
+    if (errormsg != NULL)
+        *errormsg = sstrdup("not supported by bench.layout");
+}
+
+void restore_geometry(void) {
+}
+
+void restore_open_placeholder_windows(Con *con) {
+}
+
+char *parse_string(const char **walk, bool as_word) {
+    return NULL;
+}
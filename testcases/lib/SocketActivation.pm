@@ -116,6 +116,10 @@ sub activate_i3 {
             $i3cmd .= ' -C';
         }
 
+        if ($args{record_trace}) {
+            $i3cmd .= qq| --record-trace "$args{record_trace}"|;
+        }
+
         if ($args{valgrind}) {
             $i3cmd =
                 qq|valgrind --log-file="$outdir/valgrind-for-$test.log" | .
@@ -0,0 +1,158 @@
+package i3test::Perf;
+# vim:ts=4:sw=4:expandtab
+
+use strict;
+use warnings;
+use v5.10;
+
+use Test::More;
+use Time::HiRes qw(time);
+use IO::Socket::UNIX;
+use i3test::Util qw(get_socket_path);
+
+use Exporter qw(import);
+our @EXPORT = qw(
+    measure_ms
+    perf_ok
+    ipc_raw_message
+);
+
+=encoding utf-8
+
+=head1 NAME
+
+i3test::Perf - Latency measurements with stored thresholds
+
+=head1 DESCRIPTION
+
+The 9xx-perf-*.t testcases measure how long typical operations take and fail
+when a measurement exceeds its threshold, so that performance regressions are
+caught just like functional ones.
+
+The thresholds are wall-clock times, so the measurements are only meaningful
+when nothing else runs at the same time. The perf testcases are therefore
+skipped unless C<I3_PERF> is set, and should be run one at a time:
+
+  I3_PERF=1 ./complete-run.pl --parallel=1 t/9*-perf-*.t
+
+The thresholds are deliberately generous (an order of magnitude above what a
+typical machine achieves), so that only real regressions fail. On slow machines,
+set C<I3_PERF_SCALE> to multiply all thresholds, e.g. C<I3_PERF_SCALE=3>.
+
+The perf testcases are skipped when i3 runs under valgrind, strace, xtrace or
+with coverage instrumentation, because the measurements would be meaningless.
+
+=cut
+
+# Thresholds in milliseconds, unless the name says otherwise.
+my %thresholds = (
+    # Creating and mapping a window until i3 reparented and mapped it.
+    'map latency' => 50,
+    # Switching between two workspaces with 10 windows each.
+    'workspace switch' => 30,
+    # RUN_COMMAND round trip of a nop command.
+    'run_command round trip' => 5,
+    # GET_TREE with 100 windows open.
+    'get_tree time' => 50,
+    'get_tree bytes per window' => 4096,
+    # Key press until the bound command ran and the result was rendered.
+    'binding latency' => 30,
+);
+
+sub import {
+    my ($class, @args) = @_;
+
+    if (!$ENV{I3_PERF}) {
+        plan skip_all => 'performance tests only run with I3_PERF=1 (see i3test::Perf)';
+    }
+
+    if ($ENV{VALGRIND} || $ENV{STRACE} || $ENV{XTRACE} || $ENV{COVERAGE}) {
+        plan skip_all => 'latency is not meaningful when i3 is instrumented';
+    }
+
+    __PACKAGE__->export_to_level(1, $class, @args);
+}
+
+=head1 EXPORT
+
+=head2 measure_ms($runs, $code)
+
+Calls C<$code> C<$runs> times and returns the median of the durations in
+milliseconds. The median is used so that a single hiccup (e.g. a context
+switch) does not fail the test.
+
+  my $ms = measure_ms(20, sub { cmd 'nop' });
+
+=cut
+sub measure_ms {
+    my ($runs, $code) = @_;
+
+    my @durations;
+    for (1 .. $runs) {
+        my $start = time;
+        $code->();
+        push @durations, (time - $start) * 1000;
+    }
+
+    @durations = sort { $a <=> $b } @durations;
+    return $durations[int($runs / 2)];
+}
+
+=head2 perf_ok($name, $value)
+
+Passes if C<$value> does not exceed the stored threshold for C<$name>
+(multiplied by C<I3_PERF_SCALE>). The value is always printed as a diagnostic,
+so that the numbers can be compared across runs.
+
+  perf_ok('run_command round trip', $ms);
+
+=cut
+sub perf_ok {
+    my ($name, $value) = @_;
+
+    die "No threshold for $name" unless exists($thresholds{$name});
+    my $limit = $thresholds{$name} * ($ENV{I3_PERF_SCALE} // 1);
+
+    diag(sprintf('%s: %.2f (threshold %.2f)', $name, $value, $limit));
+    local $Test::Builder::Level = $Test::Builder::Level + 1;
+    return cmp_ok($value, '<=', $limit, "$name within threshold");
+}
+
+=head2 ipc_raw_message($type, [ $payload ])
+
+Sends an IPC message to i3 on a fresh connection and returns the undecoded
+reply payload. Unlike AnyEvent::I3, this does not include the time needed to
+decode the JSON reply.
+
+  my $tree = ipc_raw_message(4);
+
+=cut
+sub ipc_raw_message {
+    my ($type, $payload) = @_;
+    $payload //= '';
+
+    my $sock = IO::Socket::UNIX->new(Peer => get_socket_path())
+        or die "Could not connect to i3: $!";
+    $sock->print('i3-ipc' . pack('LL', length($payload), $type) . $payload);
+
+    my $header = _read_exactly($sock, 14);
+    my ($magic, $length, $reply_type) = unpack('a6LL', $header);
+    die "Invalid reply magic $magic" unless $magic eq 'i3-ipc';
+    my $reply = _read_exactly($sock, $length);
+    close($sock);
+
+    return $reply;
+}
+
+sub _read_exactly {
+    my ($sock, $length) = @_;
+
+    my $result = '';
+    while (length($result) < $length) {
+        my $n = $sock->read($result, $length - length($result), length($result));
+        die "Could not read from i3: $!" unless $n;
+    }
+    return $result;
+}
+
+1
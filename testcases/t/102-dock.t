@@ -78,6 +78,11 @@ is($docknode->{rect}->{y}, 0, 'dock node placed at y=0');
 is($docknode->{rect}->{width}, $primary->rect->width, 'dock node as wide as the screen');
 is($docknode->{rect}->{height}, 40, 'dock height changed');
 
+# only the dock's output is rendered again, but its workspace needs to make
+# room for the dock
+my $ws = get_ws(focused_ws);
+is($ws->{rect}->{y}, 40, 'workspace starts below the dock');
+
 $window->destroy;
 
 wait_for_unmap $window;
@@ -159,6 +164,21 @@ sync_with_i3;
 @docked = get_dock_clients('bottom');
 is(@docked, 1, 'dock client on bottom');
 
+# setting the same value again does not change anything
+$x->change_property(
+    PROP_MODE_REPLACE,
+    $window->id,
+    $atomname->id,
+    $atomtype->id,
+    32,         # 32 bit integer
+    12,
+    pack('L12', 0, 0, 0, 16, 0, 0, 0, 0, 0, 0, 1280, 0)
+);
+
+sync_with_i3;
+@docked = get_dock_clients('bottom');
+is(@docked, 1, 'dock client still on bottom');
+
 $window->destroy;
 
 wait_for_unmap $window;
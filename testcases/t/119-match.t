@@ -103,4 +103,25 @@ cmd '[title="^\w [3]$"] kill';
 wait_for_unmap $left;
 is_num_children($tmp, 0, 'window killed');
 
+######################################################################
+# check that anchored literals (which are compared as interned strings)
+# only match the exact class
+######################################################################
+
+$tmp = fresh_workspace;
+
+$left = open_window(name => 'left', wm_class => 'special');
+$right = open_window(name => 'right', wm_class => 'specials');
+my $other = open_window(name => 'other', wm_class => 'special');
+is_num_children($tmp, 3, 'three windows opened');
+
+cmd '[class="^special$"] kill';
+wait_for_unmap $left;
+wait_for_unmap $other;
+is_num_children($tmp, 1, 'both windows with the exact class killed');
+
+cmd '[instance="^specials$"] kill';
+wait_for_unmap $right;
+is_num_children($tmp, 0, 'window with the exact instance killed');
+
 done_testing;
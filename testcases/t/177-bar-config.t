@@ -67,6 +67,8 @@ ok($bar_config->{binding_mode_indicator}, 'mode indicator enabled per default');
 is($bar_config->{mode}, 'dock', 'dock mode by default');
 is($bar_config->{position}, 'bottom', 'position bottom by default');
 is($bar_config->{tray_padding}, 2, 'tray_padding ok');
+is($bar_config->{status_redraw_interval}, 0, 'status_redraw_interval 0 by default');
+ok(!$bar_config->{share_status_command}, 'share_status_command off by default');
 
 #####################################################################
 # ensure that reloading cleans up the old bar configs
@@ -91,6 +93,7 @@ bar {
     # workspace buttons.
     # Additionally, i3status will provide a statusline.
     status_command i3status --bar
+    share_status_command yes
 
     output HDMI1
     output HDMI2
@@ -98,6 +101,7 @@ bar {
     tray_output LVDS1
     tray_output HDMI2
     tray_padding 0
+    status_redraw_interval 250 ms
     position top
     mode dock
     font Terminus
@@ -140,6 +144,8 @@ is($bar_config->{position}, 'top', 'position top');
 is_deeply($bar_config->{outputs}, [ 'HDMI1', 'HDMI2' ], 'outputs ok');
 is_deeply($bar_config->{tray_outputs}, [ 'LVDS1', 'HDMI2' ], 'tray_output ok');
 is($bar_config->{tray_padding}, 0, 'tray_padding ok');
+is($bar_config->{status_redraw_interval}, 250, 'status_redraw_interval ok');
+ok($bar_config->{share_status_command}, 'share_status_command on');
 is($bar_config->{font}, 'Terminus', 'font ok');
 is($bar_config->{socket_path}, '/tmp/foobar', 'socket_path ok');
 is_deeply($bar_config->{colors},
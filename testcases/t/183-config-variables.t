@@ -95,6 +95,22 @@ EOT
 
 is(launch_get_border($config), 'none', 'no border');
 
+#####################################################################
+# test that variables are matched case-insensitively, also when they
+# directly follow each other
+#####################################################################
+
+$config = <<'EOT';
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+set $first spe
+set $Second cial
+for_window [title="$FIRST$second title"] border none
+EOT
+
+is(launch_get_border($config), 'none', 'no border');
+
 #####################################################################
 # test that variables with longer name than value don't crash i3 with
 # v3 to v4 conversion.
@@ -227,4 +227,14 @@ is(parser_calls("resize grow left 10 px or 20 ppt"),
    "cmd_resize(grow, left, 10, 20)",
    "resize command with 'or'-construction ok");
 
+################################################################################
+# 5: Verify that log categories can be switched
+################################################################################
+
+is(parser_calls('debuglog on; debuglog bindings off; debuglog match toggle'),
+   "cmd_debuglog(on)\n" .
+   "cmd_debuglog_category(bindings, off)\n" .
+   "cmd_debuglog_category(match, toggle)",
+   'debuglog categories ok');
+
 done_testing;
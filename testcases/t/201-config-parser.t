@@ -198,6 +198,42 @@ is(parser_calls($config),
    $expected,
    'floating_modifier ok');
 
+################################################################################
+# floating_resize_preview
+################################################################################
+
+$config = <<'EOT';
+floating_resize_preview live
+floating_resize_preview outline
+EOT
+
+$expected = <<'EOT';
+cfg_floating_resize_preview(live)
+cfg_floating_resize_preview(outline)
+EOT
+
+is(parser_calls($config),
+   $expected,
+   'floating_resize_preview ok');
+
+################################################################################
+# render_pacing
+################################################################################
+
+$config = <<'EOT';
+render_pacing none
+render_pacing refresh
+EOT
+
+$expected = <<'EOT';
+cfg_render_pacing(none)
+cfg_render_pacing(refresh)
+EOT
+
+is(parser_calls($config),
+   $expected,
+   'render_pacing ok');
+
 ################################################################################
 # default_orientation
 ################################################################################
@@ -392,6 +428,84 @@ is(parser_calls($config),
    $expected,
    'force_display_urgency_hint ok');
 
+################################################################################
+# workspace_switch_grab_server
+################################################################################
+
+$config = <<'EOT';
+workspace_switch_grab_server yes
+workspace_switch_grab_server no
+EOT
+
+$expected = <<'EOT';
+cfg_workspace_switch_grab_server(yes)
+cfg_workspace_switch_grab_server(no)
+EOT
+
+is(parser_calls($config),
+   $expected,
+   'workspace_switch_grab_server ok');
+
+################################################################################
+# focus_follows_mouse_delay
+################################################################################
+
+$config = <<'EOT';
+focus_follows_mouse_delay 0
+focus_follows_mouse_delay 150 ms
+focus_follows_mouse_delay 300ms
+EOT
+
+$expected = <<'EOT';
+cfg_focus_follows_mouse_delay(0)
+cfg_focus_follows_mouse_delay(150)
+cfg_focus_follows_mouse_delay(300)
+EOT
+
+is(parser_calls($config),
+   $expected,
+   'focus_follows_mouse_delay ok');
+
+################################################################################
+# title_update_interval
+################################################################################
+
+$config = <<'EOT';
+title_update_interval 0
+title_update_interval 100 ms
+title_update_interval 250ms
+EOT
+
+$expected = <<'EOT';
+cfg_title_update_interval(0)
+cfg_title_update_interval(100)
+cfg_title_update_interval(250)
+EOT
+
+is(parser_calls($config),
+   $expected,
+   'title_update_interval ok');
+
+################################################################################
+# slow_frame_threshold
+################################################################################
+
+$config = <<'EOT';
+slow_frame_threshold 0
+slow_frame_threshold 16 ms
+slow_frame_threshold 100ms
+EOT
+
+$expected = <<'EOT';
+cfg_slow_frame_threshold(0)
+cfg_slow_frame_threshold(16)
+cfg_slow_frame_threshold(100)
+EOT
+
+is(parser_calls($config),
+   $expected,
+   'slow_frame_threshold ok');
+
 ################################################################################
 # workspace
 ################################################################################
@@ -480,6 +594,8 @@ my $expected_all_tokens = "ERROR: CONFIG: Expected one of these tokens: <end>, '
         floating_minimum_size
         floating_maximum_size
         floating_modifier
+        floating_resize_preview
+        render_pacing
         default_orientation
         workspace_layout
         default_border
@@ -490,6 +606,7 @@ my $expected_all_tokens = "ERROR: CONFIG: Expected one of these tokens: <end>, '
         for_window
         assign
         no_focus
+        focus_follows_mouse_delay
         focus_follows_mouse
         mouse_warping
         focus_wrapping
@@ -499,9 +616,12 @@ my $expected_all_tokens = "ERROR: CONFIG: Expected one of these tokens: <end>, '
         disable_randr15
         disable-randr15
         workspace_auto_back_and_forth
+        workspace_switch_grab_server
         fake_outputs
         fake-outputs
         force_display_urgency_hint
+        title_update_interval
+        slow_frame_threshold
         focus_on_window_activation
         title_align
         show_marks
@@ -733,7 +853,7 @@ EOT
 $expected = <<'EOT';
 cfg_bar_start()
 cfg_bar_output(LVDS-1)
-ERROR: CONFIG: Expected one of these tokens: <end>, '#', 'set', 'i3bar_command', 'status_command', 'socket_path', 'mode', 'hidden_state', 'id', 'modifier', 'wheel_up_cmd', 'wheel_down_cmd', 'bindsym', 'position', 'output', 'tray_output', 'tray_padding', 'font', 'separator_symbol', 'binding_mode_indicator', 'workspace_buttons', 'strip_workspace_numbers', 'strip_workspace_name', 'verbose', 'colors', '}'
+ERROR: CONFIG: Expected one of these tokens: <end>, '#', 'set', 'i3bar_command', 'status_command', 'share_status_command', 'socket_path', 'mode', 'hidden_state', 'id', 'modifier', 'wheel_up_cmd', 'wheel_down_cmd', 'bindsym', 'position', 'output', 'tray_output', 'tray_padding', 'status_redraw_interval', 'font', 'separator_symbol', 'binding_mode_indicator', 'workspace_buttons', 'strip_workspace_numbers', 'strip_workspace_name', 'verbose', 'colors', '}'
 ERROR: CONFIG: (in file <stdin>)
 ERROR: CONFIG: Line   1: bar {
 ERROR: CONFIG: Line   2:     output LVDS-1
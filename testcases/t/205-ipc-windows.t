@@ -23,8 +23,17 @@ my @events = events_for(
     sub { open_window },
     'window');
 
-is(scalar @events, 2, 'Received 2 events');
-is($events[0]->{container}->{focused}, 0, 'Window "new" event received');
-is($events[1]->{container}->{focused}, 1, 'Window "focus" event received');
+is(scalar @events, 3, 'Received 3 events');
+is($events[0]->{change}, 'new', 'Window "new" event received');
+is($events[0]->{container}->{focused}, 0, 'new window not focused yet');
+is($events[1]->{change}, 'focus', 'Window "focus" event received');
+is($events[1]->{container}->{focused}, 1, 'new window focused');
+is($events[2]->{change}, 'mapped', 'Window "mapped" event received');
+
+my $latency = $events[2]->{latency_ns};
+my $total = $latency->{total};
+ok($total > 0, 'total map latency reported');
+is($total, $latency->{properties} + $latency->{placement} + $latency->{render},
+   'total map latency is the sum of its phases');
 
 done_testing;
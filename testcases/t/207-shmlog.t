@@ -64,7 +64,23 @@ unlike($stdout, qr#$random_nop#, 'random nop not found in shm log');
 like($stderr, qr#^$#, 'stderr empty');
 
 ################################################################################
-# 4: disable logging and verify it no longer works
+# 4: verify that the newest messages are complete after the log wrapped
+################################################################################
+
+cmd 'shmlog ' . (64 * 1024);
+
+cmd "nop wrap-$_" for (1 .. 1000);
+
+run [ 'i3-dump-log' ],
+    '>', \$stdout,
+    '2>', \$stderr;
+
+unlike($stdout, qr#wrap-1\b#, 'oldest nop was overwritten');
+like($stdout, qr#wrap-1000\b#, 'newest nop found in shm log');
+like($stderr, qr#^$#, 'stderr empty');
+
+################################################################################
+# 5: disable logging and verify it no longer works
 ################################################################################
 
 cmd 'shmlog off';
@@ -276,5 +276,40 @@ does_i3_live;
 
 close($fh);
 
+################################################################################
+# a valid container followed by an invalid one: nothing must be appended
+################################################################################
+
+$ws = fresh_workspace;
+
+($fh, $filename) = tempfile(UNLINK => 1);
+print $fh <<'EOT';
+{
+    "layout": "splith",
+    "type": "con",
+    "nodes": [
+        {
+            "name": "first",
+            "swallows": [ { "class": "^first$" } ],
+            "type": "con"
+        }
+    ]
+}
+{
+    "name": "second",
+    "swallows": [ { "class": "^second$" }, ],
+    "type": "con"
+}
+EOT
+$fh->flush;
+$reply = cmd "append_layout $filename";
+ok(!$reply->[0]->{success}, 'IPC reply did not indicate success');
+
+does_i3_live;
+
+@content = @{get_ws_content($ws)};
+is(@content, 0, 'the valid container was removed again');
+
+close($fh);
 
 done_testing;
@@ -69,6 +69,13 @@ SKIP: {
     is($events[0]->{binding}->{input_code}, 0,
         'the input_code should be the specified code if the key was bound with bindcode, and otherwise zero');
 
+    my $latency = $events[0]->{latency_ns};
+    is_deeply([ sort keys %$latency ], [ qw(command flush lookup render total) ],
+        'the `latency_ns` field should contain the duration of each phase');
+    cmp_ok($latency->{total}, '>=', $latency->{command},
+        'the total latency includes running the command');
+    ok($events[0]->{event_time} > 0, 'the X11 timestamp of the key event is included');
+
     exit_gracefully($pid);
 
 }
@@ -37,4 +37,22 @@ sub move_subtest {
 subtest 'move left', \&move_subtest, 'move left';
 subtest 'move to workspace', \&move_subtest, 'move to workspace ws_new';
 
+###############################################################################
+# Moving several windows matched by criteria sends one event per window.
+###############################################################################
+
+fresh_workspace;
+my @bulk = map { open_window(wm_class => 'bulk') } 1 .. 3;
+
+my @events = events_for(
+    sub { cmd '[class="bulk"] move to workspace ws_bulk' },
+    'window');
+
+my @move = grep { $_->{change} eq 'move' } @events;
+is(scalar @move, 3, 'Received 3 window::move events');
+is_deeply([ sort map { $_->{container}->{window} } @move ],
+          [ sort map { $_->{id} } @bulk ],
+          'one event for each matched window');
+is(@{get_ws_content('ws_bulk')}, 3, 'all windows moved');
+
 done_testing;
@@ -65,6 +65,19 @@ is(get_visible_name($con), 'custom', 'sanity check: a visible name is set');
 cmd 'title_format %title';
 is(get_visible_name($con), undef, 'the visible name is removed again');
 
+###############################################################################
+# 3: The visible name follows changes of the window title, even though the
+#    formatted title is cached.
+###############################################################################
+
+fresh_workspace;
+$con = open_window(name => 'boring title', wm_class => 'someclass');
+cmd 'title_format "100% %title (%class)"';
+is(get_visible_name($con), '100% boring title (someclass)', 'placeholders and literals are formatted');
+
+$con->name('exciting title');
+is(get_visible_name($con), '100% exciting title (someclass)', 'the visible name is updated when the title changes');
+
 ###############################################################################
 
 done_testing;
@@ -133,6 +133,38 @@ is(@{get_ws($ws)->{floating_nodes}}, 1, 'the sticky window moved to new workspac
 is(get_focused($ws), $focused, 'the sticky window has focus');
 kill_all_windows;
 
+###############################################################################
+# 8: Given a sticky tiling container which is made floating later, when the
+#    workspace is switched, then the container moves to the new workspace. When
+#    it is no longer sticky, it stays where it is.
+###############################################################################
+$tmp = fresh_workspace;
+open_window;
+cmd 'sticky enable';
+cmd 'floating enable';
+$ws = fresh_workspace;
+
+is(@{get_ws($ws)->{floating_nodes}}, 1, 'container made floating after sticky moved');
+
+cmd 'sticky disable';
+fresh_workspace;
+
+is(@{get_ws($ws)->{floating_nodes}}, 1, 'container which is no longer sticky did not move');
+kill_all_windows;
+
+###############################################################################
+# 9: Given a sticky floating container which was closed, when the workspace is
+#    switched, then i3 does not crash.
+###############################################################################
+fresh_workspace;
+my $window = open_floating_window;
+cmd 'sticky enable';
+cmd 'kill';
+wait_for_unmap($window);
+fresh_workspace;
+
+does_i3_live;
+
 ###############################################################################
 
 done_testing;
@@ -0,0 +1,145 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that the render pipeline timing counters, the startup phase
+# timings, the window map latency, the X11 traffic per subsystem, the slab
+# occupancy and the memory accounting can be requested via IPC.
+use i3test;
+
+my $i3 = i3(get_socket_path());
+$i3->connect->recv;
+
+my $stats = $i3->message(12, "")->recv;
+
+for my $name (qw(handle_event render_con x_push_changes x_push_node x_deco_recurse x_draw_decoration)) {
+    ok(exists($stats->{$name}), "stats contain $name");
+    for my $key (qw(calls total_ns max_ns x_requests)) {
+        is(int($stats->{$name}->{$key}), $stats->{$name}->{$key}, "$name.$key is an integer");
+    }
+}
+
+for my $name (qw(configure_request property_notify motion_notify)) {
+    my $count = $stats->{coalesced_events}->{$name};
+    is(int($count), $count, "coalesced_events.$name is an integer");
+}
+
+my $startup = $stats->{startup};
+cmp_ok($startup->{total_ns}, '>', 0, 'startup took some time');
+for my $name (qw(x_connection atoms load_configuration tree_init first_render sockets manage_existing_windows)) {
+    my $phase = $startup->{phases}->{$name};
+    ok(defined($phase), "startup phases contain $name");
+    cmp_ok($phase->{start_ns} + $phase->{duration_ns}, '<=', $startup->{total_ns}, "$name ended before the startup was done");
+}
+ok(!exists($startup->{phases}->{tree_restore}), 'tree_restore did not run');
+cmp_ok($startup->{phases}->{atoms}->{start_ns}, '>=',
+       $startup->{phases}->{x_connection}->{start_ns} + $startup->{phases}->{x_connection}->{duration_ns},
+       'atoms were interned after connecting');
+
+my $before = $stats->{x_push_changes}->{calls};
+
+open_window;
+sync_with_i3;
+
+$stats = $i3->message(12, "")->recv;
+cmp_ok($stats->{x_push_changes}->{calls}, '>', $before, 'x_push_changes calls increased');
+cmp_ok($stats->{x_push_changes}->{x_requests}, '>', 0, 'x_push_changes issued X11 requests');
+cmp_ok($stats->{render_con}->{max_ns}, '<=', $stats->{render_con}->{total_ns}, 'max_ns <= total_ns');
+
+my $x_traffic = $stats->{x_traffic};
+for my $name (qw(other render decoration ewmh bindings manage floating randr)) {
+    ok(defined($x_traffic->{subsystems}->{$name}), "x_traffic subsystems contain $name");
+    ok(defined($x_traffic->{last_render}->{$name}), "x_traffic last_render contains $name");
+}
+cmp_ok($x_traffic->{subsystems}->{render}->{requests}, '>', 0, 'rendering issued X11 requests');
+cmp_ok($x_traffic->{subsystems}->{manage}->{round_trips}, '>', 0, 'managing windows waited for replies');
+cmp_ok($x_traffic->{requests}->{configure_window}, '>', 0, 'ConfigureWindow requests were counted');
+
+my $map_request = $stats->{event_latency}->{MapRequest};
+ok(defined($map_request), 'event_latency contains MapRequest');
+cmp_ok($map_request->{count}, '>', 0, 'MapRequest events were counted');
+is(scalar @{$map_request->{buckets}}, 20, 'histogram has 20 buckets');
+my $sum = 0;
+$sum += $_ for @{$map_request->{buckets}};
+is($sum, $map_request->{count}, 'bucket counts add up to count');
+
+for my $name (qw(properties placement render total)) {
+    my $phase = $stats->{window_map_latency}->{$name};
+    ok(defined($phase), "window_map_latency contains $name");
+    cmp_ok($phase->{count}, '>', 0, "$name: mapped windows were counted");
+}
+cmp_ok($stats->{window_map_latency}->{properties}->{max_ns}, '<=',
+       $stats->{window_map_latency}->{total}->{max_ns}, 'no phase took longer than the total');
+
+for my $name (qw(con window mark)) {
+    my $slab = $stats->{slabs}->{$name};
+    ok(defined($slab), "slabs contain $name");
+    cmp_ok($slab->{in_use}, '<=', $slab->{capacity}, "$name: in_use <= capacity");
+    is($slab->{bytes}, $slab->{capacity} * $slab->{object_size}, "$name: bytes match the capacity");
+}
+cmp_ok($stats->{slabs}->{con}->{in_use}, '>', 0, 'containers are allocated from the slab');
+
+my $windows = $stats->{slabs}->{window}->{in_use};
+my $marks = $stats->{slabs}->{mark}->{in_use};
+my $window = open_window;
+cmd 'mark slab-test';
+$stats = $i3->message(12, "")->recv;
+is($stats->{slabs}->{window}->{in_use}, $windows + 1, 'window allocated from the slab');
+is($stats->{slabs}->{mark}->{in_use}, $marks + 1, 'mark allocated from the slab');
+
+my $capacity = $stats->{slabs}->{window}->{capacity};
+$window->destroy;
+sync_with_i3;
+$stats = $i3->message(12, "")->recv;
+is($stats->{slabs}->{window}->{in_use}, $windows, 'window returned to the slab');
+is($stats->{slabs}->{mark}->{in_use}, $marks, 'mark returned to the slab');
+is($stats->{slabs}->{window}->{capacity}, $capacity, 'slab memory is kept for reuse');
+
+################################################################################
+# Slow frames
+################################################################################
+
+my $slow_frames = $stats->{slow_frames};
+ok(defined($slow_frames), 'slow_frames is included');
+is($slow_frames->{threshold_ns}, 16000000, 'default threshold is 16 ms');
+is(int($slow_frames->{count}), $slow_frames->{count}, 'slow_frames.count is an integer');
+cmp_ok(scalar @{$slow_frames->{frames}}, '<=', $slow_frames->{count}, 'no more frames than counted');
+cmp_ok(scalar @{$slow_frames->{frames}}, '<=', 16, 'at most 16 frames are kept');
+for my $frame (@{$slow_frames->{frames}}) {
+    cmp_ok($frame->{duration_ns}, '>=', $slow_frames->{threshold_ns}, 'frame exceeded the threshold');
+    my $events = 0;
+    $events += $_ for values %{$frame->{events}};
+    cmp_ok($events, '<=', $frame->{num_events}, 'listed events are counted');
+}
+
+################################################################################
+# Memory accounting
+################################################################################
+
+my $memory = $stats->{memory};
+for my $name (qw(malloc calloc realloc strdup strndup asprintf)) {
+    ok(defined($memory->{allocations}->{$name}), "allocations contain $name");
+}
+cmp_ok($memory->{allocations}->{malloc}->{calls}, '>', 0, 'malloc calls were counted');
+cmp_ok($memory->{heap}->{peak_in_use}, '>=', $memory->{heap}->{in_use}, 'peak_in_use >= in_use');
+ok(defined($memory->{ipc_buffers}), 'ipc_buffers is included');
+ok(defined($memory->{shmlog}), 'shmlog is included');
+
+my $calls = $memory->{allocations}->{strdup}->{calls};
+cmd 'mark memory-test';
+$stats = $i3->message(12, "")->recv;
+cmp_ok($stats->{memory}->{allocations}->{strdup}->{calls}, '>', $calls, 'allocations increased');
+
+done_testing;
@@ -0,0 +1,94 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that GET_TREE accepts a payload selecting a subtree, limiting its
+# depth and projecting each node onto a list of fields.
+use i3test;
+
+my $i3 = i3(get_socket_path());
+$i3->connect->recv;
+
+my $tmp = fresh_workspace;
+my $first = open_window;
+my $second = open_window;
+cmd 'split v';
+my $third = open_window;
+sync_with_i3;
+
+my $ws = $i3->message(4, qq|{"workspace": "$tmp"}|)->recv;
+is($ws->{type}, 'workspace', 'workspace is the root of the dump');
+is($ws->{name}, $tmp, 'the requested workspace was dumped');
+
+my $by_id = $i3->message(4, qq|{"con_id": $ws->{id}}|)->recv;
+is($by_id->{id}, $ws->{id}, 'con_id selects the same container');
+is(scalar @{$by_id->{nodes}}, scalar @{$ws->{nodes}}, 'same number of children');
+
+my $flat = $i3->message(4, qq|{"workspace": "$tmp", "depth": 0}|)->recv;
+is(scalar @{$flat->{nodes}}, 0, 'depth 0 omits all children');
+ok(exists($flat->{floating_nodes}), 'floating_nodes is still included');
+
+my $shallow = $i3->message(4, qq|{"workspace": "$tmp", "depth": 1}|)->recv;
+is(scalar @{$shallow->{nodes}}, 2, 'depth 1 includes the direct children');
+my ($split) = grep { @{$ws->{nodes}[$_]{nodes}} > 0 } 0 .. 1;
+is(scalar @{$shallow->{nodes}[$split]{nodes}}, 0, 'grandchildren are omitted');
+
+my $projected = $i3->message(4, qq|{"workspace": "$tmp", "fields": ["name", "window"]}|)->recv;
+is_deeply([ sort keys %$projected ], [ qw(floating_nodes id name nodes window) ],
+    'only the requested fields are included');
+
+my $missing = $i3->message(4, '{"con_id": 1}')->recv;
+ok(!$missing->{success}, 'unknown con_id is an error');
+ok(defined($missing->{error}), 'an error message is included');
+
+$missing = $i3->message(4, '{"workspace": "does-not-exist"}')->recv;
+ok(!$missing->{success}, 'unknown workspace is an error');
+
+################################################################################
+# The save_tree format strips runtime state and suggests swallows criteria.
+################################################################################
+
+my $save_ws = fresh_workspace;
+my $saved_window = open_window(wm_class => 'save.tree', name => 'a (b)');
+cmd 'split v';
+open_window;
+sync_with_i3;
+
+my $saved = $i3->message(4, qq|{"workspace": "$save_ws", "format": "save_tree"}|)->recv;
+ok(!exists($saved->{id}), 'save_tree omits the id');
+is($saved->{type}, 'workspace', 'save_tree keeps the type');
+ok(!exists($saved->{rect}), 'save_tree omits the rect of tiling containers');
+ok(!exists($saved->{focus}), 'save_tree omits the focus stack');
+
+my $saved_split = $saved->{nodes}->[0];
+is($saved_split->{layout}, 'splitv', 'split containers keep their layout');
+ok(!exists($saved_split->{name}), 'split containers have no name');
+
+my $saved_leaf = $saved_split->{nodes}->[0];
+ok(!exists($saved_leaf->{layout}), 'leaf containers have no layout');
+is($saved_leaf->{name}, 'a (b)', 'leaf containers keep their name');
+is_deeply($saved_leaf->{swallows}, [ {
+        class => '^save\.tree$',
+        instance => '^save\.tree$',
+        title => '^a\ \(b\)$',
+    } ], 'swallows criteria match the window exactly');
+
+my $unknown = $i3->message(4, '{"format": "xml"}')->recv;
+ok(!$unknown->{success}, 'unknown format is an error');
+
+my $tree = $i3->message(4, '')->recv;
+is($tree->{type}, 'root', 'an empty payload still dumps the whole tree');
+
+done_testing;
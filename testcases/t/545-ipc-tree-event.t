@@ -0,0 +1,68 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that the tree event describes the containers which were added,
+# removed and changed by a render.
+use i3test;
+
+my $tmp = fresh_workspace;
+my $first = open_window;
+
+sub diff_of {
+    my ($cb) = @_;
+    my @events = events_for($cb, 'tree');
+    my %diff = (added => [], removed => [], moved => [], changed => []);
+    for my $event (@events) {
+        is($event->{change}, 'diff', 'change is diff');
+        push @{$diff{$_}}, @{$event->{$_}} for keys %diff;
+    }
+    return \%diff;
+}
+
+my $second;
+my $diff = diff_of(sub {
+    $second = open_window;
+    sync_with_i3;
+});
+
+my ($added) = grep { $_->{node}->{window} == $second->id } @{$diff->{added}};
+ok(defined($added), 'the new window was added');
+is($added->{list}, 'nodes', 'the new window is a tiling node');
+is($added->{node}->{type}, 'con', 'type is included');
+ok($added->{node}->{focused}, 'the new window is focused');
+ok(!exists($added->{node}->{nodes}), 'children are not included');
+
+my ($unfocused) = grep { exists($_->{focused}) && !$_->{focused} } @{$diff->{changed}};
+ok(defined($unfocused), 'the previously focused window changed');
+ok(!exists($unfocused->{name}), 'unchanged fields are omitted');
+
+my $second_id = $added->{node}->{id};
+$diff = diff_of(sub {
+    cmd 'kill';
+    wait_for_unmap($second);
+    sync_with_i3;
+});
+
+ok((grep { $_ == $second_id } @{$diff->{removed}}), 'the killed window was removed');
+
+$diff = diff_of(sub {
+    cmd 'nop nothing changes';
+    sync_with_i3;
+});
+is(scalar @{$diff->{added}} + scalar @{$diff->{removed}} + scalar @{$diff->{changed}}, 0,
+   'no changes are reported when nothing changed');
+
+done_testing;
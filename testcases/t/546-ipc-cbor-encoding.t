@@ -0,0 +1,63 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that a connection can switch its replies to CBOR.
+use i3test;
+use IO::Socket::UNIX;
+
+my $i3 = i3(get_socket_path());
+$i3->connect->recv;
+
+my $reply = $i3->message(13, 'xml')->recv;
+ok(!$reply->{success}, 'unknown encodings are rejected');
+
+my $sock = IO::Socket::UNIX->new(Peer => get_socket_path());
+ok(defined($sock), 'connected to i3');
+
+sub send_message {
+    my ($type, $payload) = @_;
+    { use bytes; $sock->write("i3-ipc" . pack("LL", length($payload), $type) . $payload); }
+}
+
+sub recv_message {
+    my $header;
+    $sock->read($header, 14);
+    my ($magic, $len, $type) = unpack("a6LL", $header);
+    my $payload = '';
+    $sock->read($payload, $len) if $len > 0;
+    return ($type, $payload);
+}
+
+send_message(13, 'cbor');
+my ($type, $payload) = recv_message;
+is($type, 13, 'got a SET_ENCODING reply');
+is($payload, '{"success":true}', 'the reply is still JSON');
+
+send_message(7, '');
+($type, $payload) = recv_message;
+is($type, 7, 'got a VERSION reply');
+is(ord(substr($payload, 0, 1)), 0xbf, 'the reply is a CBOR map');
+like($payload, qr/\x6ehuman_readable/, 'the reply contains the human_readable key');
+
+send_message(13, 'json');
+($type, $payload) = recv_message;
+is(ord(substr($payload, 0, 1)), 0xbf, 'the switch back is confirmed in CBOR');
+
+send_message(7, '');
+($type, $payload) = recv_message;
+like($payload, qr/^\{"major"/, 'replies are JSON again');
+
+done_testing;
@@ -0,0 +1,44 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that RUN_COMMANDS runs a list of commands and replies with the
+# result of each one.
+use i3test;
+
+my $i3 = i3(get_socket_path());
+$i3->connect->recv;
+
+my $tmp = fresh_workspace;
+open_window;
+open_window;
+
+my $reply = $i3->message(14, '["mark first", "layout tabbed", "nonexistent command"]')->recv;
+is(scalar @$reply, 3, 'one result per command');
+ok($reply->[0]->[0]->{success}, 'mark succeeded');
+ok($reply->[1]->[0]->{success}, 'layout succeeded');
+ok(!$reply->[2]->[0]->{success}, 'the invalid command failed');
+
+is_deeply($i3->get_marks->recv, [ 'first' ], 'mark was set');
+my $ws = get_ws($tmp);
+is($ws->{nodes}->[0]->{layout}, 'tabbed', 'layout was changed');
+
+$reply = $i3->message(14, '["mark')->recv;
+ok(!$reply->{success}, 'invalid payload is an error');
+
+$reply = $i3->message(14, '[]')->recv;
+is_deeply($reply, [], 'an empty list has an empty reply');
+
+done_testing;
@@ -0,0 +1,66 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that subscriptions can be restricted to events matching change
+# types, window criteria and workspace names.
+use i3test;
+
+my $tmp = fresh_workspace;
+my $filtered = open_window(wm_class => 'filtered', name => 'filtered');
+my $other = open_window(wm_class => 'other', name => 'other');
+
+my $i3 = i3(get_socket_path(0));
+$i3->connect->recv;
+
+my @events;
+my $flushed = AnyEvent->condvar;
+$i3->{callbacks}->{(1 << 31) | 3} = sub { push @events, shift };
+$i3->{callbacks}->{(1 << 31) | 7} = sub {
+    my ($event) = @_;
+    $flushed->send if !$event->{first};
+};
+
+my $reply = $i3->message(2, [
+    'tick',
+    { event => 'window', change => [ 'title' ], match => { class => '^filtered$' } },
+    { event => 'window', change => 'focus', workspace => 'does-not-exist' },
+])->recv;
+ok($reply->{success}, 'subscribing with filters succeeded');
+
+$filtered->name('filtered renamed');
+$other->name('other renamed');
+cmd '[class="filtered"] focus';
+sync_with_i3;
+$i3->send_tick('flush');
+$flushed->recv;
+
+is(scalar @events, 1, 'only one window event was received');
+is($events[0]->{change}, 'title', 'it is a title event');
+is($events[0]->{container}->{window}, $filtered->id, 'it is for the matching window');
+
+$reply = $i3->message(2, [ { change => 'title' } ])->recv;
+ok(!$reply->{success}, 'filters need an event type');
+
+$reply = $i3->message(2, [ { event => 'nonexistent' } ])->recv;
+ok(!$reply->{success}, 'unknown event types in filters are rejected');
+
+$reply = $i3->message(2, [ { event => 'window', backpressure => 'drop' } ])->recv;
+ok($reply->{success}, 'subscribing with a backpressure policy succeeded');
+
+$reply = $i3->message(2, [ { event => 'window', backpressure => 'nonexistent' } ])->recv;
+ok(!$reply->{success}, 'unknown backpressure policies are rejected');
+
+done_testing;
@@ -0,0 +1,60 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that i3 handles all messages of a pipelining client, including
+# messages which arrive in several parts.
+use i3test;
+use IO::Socket::UNIX;
+
+my $sock = IO::Socket::UNIX->new(Peer => get_socket_path());
+ok(defined($sock), 'connected to i3');
+
+sub format_message {
+    my ($type, $payload) = @_;
+    my $len;
+    { use bytes; $len = length($payload); }
+    return "i3-ipc" . pack("LL", $len, $type) . $payload;
+}
+
+sub recv_message {
+    my $header;
+    $sock->read($header, 14);
+    my ($magic, $len, $type) = unpack("a6LL", $header);
+    my $payload = '';
+    $sock->read($payload, $len) if $len > 0;
+    return ($type, $payload);
+}
+
+# Ten requests in a single write.
+$sock->syswrite(join('', map { format_message(7, '') } 1 .. 10));
+for my $i (1 .. 10) {
+    my ($type, $payload) = recv_message;
+    is($type, 7, "reply $i is a VERSION reply");
+}
+
+# A request split in the middle of its header and of its payload.
+my $message = format_message(0, 'nop split message');
+$sock->syswrite(substr($message, 0, 5));
+sync_with_i3;
+$sock->syswrite(substr($message, 5, 10));
+sync_with_i3;
+$sock->syswrite(substr($message, 15));
+
+my ($type, $payload) = recv_message;
+is($type, 0, 'got a COMMAND reply');
+is($payload, '[{"success":true}]', 'the split command was run');
+
+done_testing;
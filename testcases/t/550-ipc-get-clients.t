@@ -0,0 +1,38 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that GET_CLIENTS reports the traffic counters of IPC connections.
+use i3test;
+
+my $i3 = i3(get_socket_path());
+$i3->connect->recv;
+$i3->subscribe({ workspace => sub {} })->recv;
+
+my $clients = $i3->message(15, '')->recv;
+my ($self) = grep { $_->{self} } @$clients;
+ok(defined($self), 'the requesting connection is listed');
+is_deeply($self->{events}, [ 'workspace' ], 'subscribed events are listed');
+is($self->{messages_received}, 2, 'two messages were received');
+cmp_ok($self->{bytes_received}, '>', 0, 'bytes were received');
+is($self->{messages_sent}, 1, 'one reply was sent before this one');
+is($self->{queued_bytes}, 0, 'nothing is queued');
+cmp_ok($self->{queued_bytes_max}, '>', 0, 'the high-water mark is set');
+is($self->{encoding}, 'json', 'the encoding is json');
+is($self->{pid}, $$, 'the pid is ours') if defined($self->{pid});
+
+cmp_ok(scalar @$clients, '>=', 2, 'the test harness connection is listed too');
+
+done_testing;
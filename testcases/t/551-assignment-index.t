@@ -0,0 +1,56 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that for_window rules still run in config order when some of them
+# are looked up in the assignment index (exact literals), some are
+# pre-filtered (plain substrings) and some are regular expressions.
+use i3test i3_autostart => 0;
+
+my $config = <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+for_window [class="^indexed\$"] mark --add r1
+for_window [class="dexe"] mark --add r2
+for_window [class="^ind.x"] mark --add r3
+for_window [instance="^indexed\$"] mark --add r4
+for_window [class="^other\$"] mark --add never
+for_window [class="other"] mark --add never2
+for_window [class="^indexed\$" title="second"] mark --add r5
+for_window [title="second"] mark --add r6
+EOT
+
+my $pid = launch_with_config($config);
+
+my $tmp = fresh_workspace;
+
+my $window = open_window(
+    name => 'first',
+    wm_class => 'indexed',
+);
+
+my @content = @{get_ws_content($tmp)};
+is_deeply($content[0]->{marks}, [ qw(r1 r2 r3 r4) ], 'rules ran in config order');
+
+$window->name('second');
+sync_with_i3;
+
+@content = @{get_ws_content($tmp)};
+is_deeply($content[0]->{marks}, [ qw(r1 r2 r3 r4 r5 r6) ], 'title rules ran once the title matched');
+
+exit_gracefully($pid);
+
+done_testing;
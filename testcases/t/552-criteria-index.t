@@ -0,0 +1,45 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that criteria which are answered from the container, window and
+# mark indexes select the same containers as a full scan.
+use i3test;
+
+my $tmp = fresh_workspace;
+
+my $first = open_window;
+my $first_id = get_focused($tmp);
+my $second = open_window;
+my $second_id = get_focused($tmp);
+
+cmd "[id=" . $first->id . "] mark first";
+cmd "[con_id=$second_id] mark second";
+
+my @content = @{get_ws_content($tmp)};
+is_deeply($content[0]->{marks}, [ 'first' ], 'id criterion marked the first window');
+is_deeply($content[1]->{marks}, [ 'second' ], 'con_id criterion marked the second window');
+
+cmd '[con_mark="^first$"] focus';
+is(get_focused($tmp), $first_id, 'anchored mark criterion focused the first window');
+
+cmd '[con_mark="^fir$"] focus';
+cmd '[con_mark="^secon"] focus';
+is(get_focused($tmp), $second_id, 'only a partial anchored mark matched');
+
+cmd "[id=" . $first->id . " con_mark=\"^second\$\"] focus";
+is(get_focused($tmp), $second_id, 'id and mark of different windows do not match');
+
+done_testing;
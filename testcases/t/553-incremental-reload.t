@@ -0,0 +1,60 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+#
+# Verifies that reloading an unchanged configuration does not notify the bars
+# and keeps the key bindings working.
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+bindsym Print nop Print
+
+bar {
+    id bar-first
+    i3bar_command :
+}
+
+bar {
+    id bar-second
+    i3bar_command :
+}
+EOT
+use i3test::XTEST;
+use ExtUtils::PkgConfig;
+
+my @events = events_for(
+    sub { cmd 'reload' },
+    'barconfig_update');
+
+is(scalar @events, 0, 'no barconfig_update event for unchanged bars');
+
+SKIP: {
+    skip "libxcb-xkb too old (need >= 1.11)", 1 unless
+        ExtUtils::PkgConfig->atleast_version('xcb-xkb', '1.11');
+
+is(listen_for_binding(
+    sub {
+        xtest_key_press(107); # Print
+        xtest_key_release(107); # Print
+        xtest_sync_with_i3;
+    },
+    ),
+   'Print',
+   'key binding still works after the reload');
+}
+
+done_testing;
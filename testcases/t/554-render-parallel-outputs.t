@@ -0,0 +1,71 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that rendering many outputs (which happens in parallel) produces
+# the same layout as rendering them one after another.
+#
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+fake-outputs 1024x768+0+0,1024x768+1024+0,1024x768+0+768,1024x768+1024+768
+workspace 1 output fake-0
+workspace 2 output fake-1
+workspace 3 output fake-2
+workspace 4 output fake-3
+default_border none
+EOT
+
+my @origins = ([0, 0], [1024, 0], [0, 768], [1024, 768]);
+my @counts = (1, 2, 4, 2);
+
+for my $num (1 .. 4) {
+    cmd "workspace $num";
+    open_window for 1 .. $counts[$num - 1];
+}
+
+sub check_workspace {
+    my ($num, $layout) = @_;
+    my ($x0, $y0) = @{$origins[$num - 1]};
+    my $ws = get_ws($num);
+    my @nodes = @{$ws->{nodes}};
+    my $count = $counts[$num - 1];
+    is(scalar @nodes, $count, "workspace $num has $count windows");
+
+    my $size = ($layout eq 'splith' ? 1024 : 768) / $count;
+    for my $i (0 .. $#nodes) {
+        my $rect = $nodes[$i]->{rect};
+        if ($layout eq 'splith') {
+            is($rect->{x}, $x0 + $i * $size, "workspace $num window $i x");
+            is($rect->{y}, $y0, "workspace $num window $i y");
+            is($rect->{height}, 768, "workspace $num window $i height");
+        } else {
+            is($rect->{x}, $x0, "workspace $num window $i x");
+            is($rect->{y}, $y0 + $i * $size, "workspace $num window $i y");
+            is($rect->{width}, 1024, "workspace $num window $i width");
+        }
+    }
+}
+
+check_workspace($_, 'splith') for 1 .. 4;
+
+# Change the layout of every output within one render.
+cmd join(', ', map { "workspace $_, layout splitv" } 1 .. 4);
+sync_with_i3;
+
+check_workspace($_, 'splitv') for 1 .. 4;
+
+done_testing;
@@ -0,0 +1,72 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+# Verifies that windows on hidden workspaces stay unmapped while i3 skips
+# those workspaces in x_push_changes(), and that everything is brought up to
+# date when the workspace is shown again or a window is moved onto it.
+use i3test;
+
+my $ws_a = fresh_workspace;
+my $first = open_window;
+ok($first->mapped, 'first window mapped');
+
+my $ws_b = fresh_workspace;
+ok(!$first->mapped, 'first window unmapped after switching away');
+
+# Render a few times while workspace A is hidden.
+my $second = open_window;
+cmd 'split v';
+my $third = open_window;
+ok($second->mapped && $third->mapped, 'windows on workspace B mapped');
+ok(!$first->mapped, 'first window still unmapped');
+
+cmd "workspace $ws_a";
+sync_with_i3;
+ok($first->mapped, 'first window mapped again');
+ok(!$second->mapped && !$third->mapped, 'windows on workspace B unmapped');
+
+###############################################################################
+# Moving a (mapped) window onto a hidden workspace unmaps it.
+###############################################################################
+
+my $moved = open_window;
+ok($moved->mapped, 'window to move mapped');
+cmd "move container to workspace $ws_b";
+sync_with_i3;
+ok(!$moved->mapped, 'window unmapped after moving it to the hidden workspace');
+ok($first->mapped, 'first window still mapped');
+
+cmd "workspace $ws_b";
+sync_with_i3;
+ok($moved->mapped && $second->mapped && $third->mapped,
+   'all windows on workspace B mapped after showing it');
+
+###############################################################################
+# The scratchpad workspace is never visible.
+###############################################################################
+
+cmd '[id="' . $moved->id . '"] move scratchpad';
+sync_with_i3;
+ok(!$moved->mapped, 'window unmapped in the scratchpad');
+
+cmd '[id="' . $moved->id . '"] scratchpad show';
+sync_with_i3;
+ok($moved->mapped, 'scratchpad window mapped when shown');
+
+cmd '[id="' . $moved->id . '"] scratchpad show';
+sync_with_i3;
+ok(!$moved->mapped, 'scratchpad window unmapped when hidden again');
+
+done_testing;
@@ -0,0 +1,51 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+# Verifies that tabbed and stacked containers with many children (whose tabs
+# are too narrow for a title) are laid out and switched between correctly.
+use i3test;
+use List::Util qw(sum);
+
+my $tmp = fresh_workspace;
+cmd 'layout tabbed';
+
+my @windows = map { open_window(name => "tab $_") } 1 .. 100;
+my @cons = @{get_ws_content($tmp)};
+is(scalar @cons, 100, '100 tabs');
+
+my $ws = get_ws($tmp);
+is(sum(map { $_->{deco_rect}->{width} } @cons), $ws->{rect}->{width},
+   'the tabs cover the whole width');
+my @narrow = grep { $_->{deco_rect}->{width} < 20 } @cons;
+ok(@narrow > 0, 'some tabs are narrow');
+
+for my $idx (0, 50, 99, 25) {
+    cmd '[id="' . $windows[$idx]->id . '"] focus';
+    sync_with_i3;
+    is($x->input_focus, $windows[$idx]->id, "tab $idx focused");
+}
+
+cmd 'layout stacking';
+@cons = @{get_ws_content($tmp)};
+my $deco_height = $cons[0]->{deco_rect}->{height};
+is_deeply([ map { $_->{deco_rect}->{y} } @cons ],
+          [ map { $_ * $deco_height } 0 .. 99 ],
+          'the stack titles are below each other');
+
+cmd 'focus up';
+sync_with_i3;
+is($x->input_focus, $windows[24]->id, 'previous stack entry focused');
+
+done_testing;
@@ -0,0 +1,100 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that workspaces are found by name and number (which uses a lookup
+# index) after they were created, renamed, moved to another output and closed.
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+fake-outputs 1024x768+0+0,1024x768+1024+0
+EOT
+
+cmd 'workspace Foo';
+open_window;
+cmd 'workspace 1';
+cmd 'workspace foo';
+is(focused_ws, 'Foo', 'workspace found case-insensitively');
+
+###############################################################################
+# Renaming
+###############################################################################
+
+cmd 'rename workspace Foo to 5: five';
+cmd 'workspace 1';
+cmd 'workspace number 5';
+is(focused_ws, '5: five', 'renamed workspace found by number');
+
+cmd 'workspace 1';
+cmd 'workspace 5: five';
+is(focused_ws, '5: five', 'renamed workspace found by name');
+ok(!workspace_exists('Foo'), 'old name is gone');
+
+cmd 'workspace Foo';
+is(focused_ws, 'Foo', 'old name creates a new workspace');
+cmd 'workspace 1';
+ok(!workspace_exists('Foo'), 'new empty workspace closed again');
+
+###############################################################################
+# Numbered workspaces with the same number: the first one (in tree order) is
+# used. Workspaces are sorted by number, and a new workspace is inserted before
+# existing ones with the same number.
+###############################################################################
+
+cmd 'workspace 7: a';
+open_window;
+cmd 'workspace 7: b';
+open_window;
+cmd 'workspace 1';
+cmd 'workspace number 7';
+is(focused_ws, '7: b', 'first workspace with that number found');
+
+cmd 'rename workspace "7: b" to b';
+cmd 'workspace 1';
+cmd 'workspace number 7';
+is(focused_ws, '7: a', 'remaining workspace with that number found');
+
+###############################################################################
+# Moving to another output
+###############################################################################
+
+cmd 'workspace 5: five';
+cmd 'move workspace to output fake-1';
+is(get_output_for_workspace('5: five'), 'fake-1', 'workspace moved to fake-1');
+cmd 'focus output fake-0';
+cmd 'workspace number 5';
+is(focused_ws, '5: five', 'moved workspace found by number');
+cmd 'focus output fake-0';
+cmd 'workspace 5: five';
+is(focused_ws, '5: five', 'moved workspace found by name');
+
+###############################################################################
+# Closing
+###############################################################################
+
+cmd 'workspace Closed';
+my $window = open_window;
+cmd 'workspace 1';
+cmd 'workspace Closed';
+$window->destroy;
+sync_with_i3;
+cmd 'workspace 1';
+ok(!workspace_exists('Closed'), 'workspace closed');
+cmd 'workspace Closed';
+is(focused_ws, 'Closed', 'closed workspace recreated');
+is(scalar @{get_ws_content('Closed')}, 0, 'recreated workspace is empty');
+
+done_testing;
@@ -0,0 +1,82 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+# Verifies that 'workspace next' and 'workspace prev' (which use a sorted
+# workspace index) follow workspaces with the same number, renames and moves
+# to another output.
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+fake-outputs 1024x768+0+0,1024x768+1024+0
+EOT
+
+sub assert_cmd {
+    my ($command, $expected) = @_;
+
+    cmd $command;
+    sync_with_i3;
+
+    is(focused_ws, $expected, "$command focuses workspace $expected");
+}
+
+################################################################################
+# fake-1 shows workspace 2. A new workspace is inserted before existing ones
+# with the same number, so the workspaces of fake-0 are: 11, 13: b, 13: a, 15,
+# foo
+################################################################################
+
+cmd 'workspace 11'; open_window;
+cmd 'workspace 13: a'; open_window;
+cmd 'workspace 13: b'; open_window;
+cmd 'workspace 15'; open_window;
+cmd 'workspace foo'; open_window;
+
+cmd 'workspace 11';
+assert_cmd('workspace next', '13: b');
+assert_cmd('workspace next', '15');
+assert_cmd('workspace prev', '13: a');
+assert_cmd('workspace prev', '11');
+assert_cmd('workspace prev', '2');
+assert_cmd('workspace prev', 'foo');
+assert_cmd('workspace next', '2');
+assert_cmd('workspace next', '11');
+
+################################################################################
+# Renaming
+################################################################################
+
+cmd 'rename workspace 15 to 12';
+cmd 'workspace 11';
+assert_cmd('workspace next', '12');
+assert_cmd('workspace next', '13: b');
+
+################################################################################
+# Moving to another output
+################################################################################
+
+cmd 'workspace 12';
+cmd 'move workspace to output fake-1';
+cmd 'workspace 11';
+sync_with_i3;
+assert_cmd('workspace next', '12');
+is(get_output_for_workspace('12'), 'fake-1', 'workspace 12 is on fake-1');
+cmd 'workspace 11';
+sync_with_i3;
+assert_cmd('workspace next_on_output', '13: b');
+assert_cmd('workspace prev_on_output', '11');
+assert_cmd('workspace prev_on_output', 'foo');
+
+done_testing;
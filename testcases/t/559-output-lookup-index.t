@@ -0,0 +1,107 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+# Verifies the output lookups which use the spatial output index (pointer
+# position, 'focus output <direction>' and the output of a floating window)
+# with outputs of different sizes and a gap between them:
+#
+#   +--------+--------+--------+
+#   | fake-0 | fake-1 |        |  gap
+#   +--------+--------+ fake-3 +--------+
+#   |     fake-2      |        | fake-4 |
+#   +-----------------+--------+--------+
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+fake-outputs 1024x768+0+0,1024x768+1024+0,2048x768+0+768,1024x1536+2048+0,800x600+3072+936
+EOT
+use List::Util qw(first);
+
+my $i3 = i3(get_socket_path());
+
+sub focused_output {
+    my $tree = $i3->get_tree->recv;
+    my $focused = $tree->{focus}->[0];
+    my $output = first { $_->{id} == $focused } @{$tree->{nodes}};
+    return $output->{name};
+}
+
+sub synced_warp_pointer {
+    my ($x_px, $y_px) = @_;
+    sync_with_i3;
+    $x->root->warp_pointer($x_px, $y_px);
+    sync_with_i3;
+}
+
+################################################################################
+# Moving the pointer focuses the output below it.
+################################################################################
+
+my %points = (
+    'fake-0' => [ 10, 10 ],
+    'fake-1' => [ 2047, 767 ],
+    'fake-2' => [ 1500, 768 ],
+    'fake-3' => [ 2048, 1535 ],
+    'fake-4' => [ 3500, 1000 ],
+);
+for my $output (sort keys %points) {
+    synced_warp_pointer(@{$points{$output}});
+    is(focused_output, $output, "pointer at (@{$points{$output}}) focuses $output");
+}
+
+# The gap does not belong to any output, focus stays where it was.
+synced_warp_pointer(3500, 100);
+is(focused_output, 'fake-4', 'pointer in the gap keeps focus');
+
+################################################################################
+# 'focus output <direction>' picks the closest overlapping output and wraps
+# around to the farthest one.
+################################################################################
+
+sub assert_focus_output {
+    my ($from, $direction, $expected) = @_;
+
+    cmd "focus output $from";
+    cmd "focus output $direction";
+    is(focused_output, $expected, "focus output $direction from $from focuses $expected");
+}
+
+assert_focus_output('fake-0', 'right', 'fake-1');
+assert_focus_output('fake-1', 'right', 'fake-3');
+assert_focus_output('fake-3', 'right', 'fake-4');
+assert_focus_output('fake-3', 'left', 'fake-1');
+assert_focus_output('fake-0', 'down', 'fake-2');
+assert_focus_output('fake-1', 'down', 'fake-2');
+assert_focus_output('fake-2', 'up', 'fake-0');
+assert_focus_output('fake-4', 'right', 'fake-2');
+assert_focus_output('fake-4', 'up', 'fake-4');
+assert_focus_output('fake-0', 'left', 'fake-3');
+
+################################################################################
+# A floating window whose midpoint is in the gap belongs to the output which
+# contains most of it.
+################################################################################
+
+cmd 'focus output fake-3';
+my $ws = fresh_workspace;
+my $window = open_floating_window(rect => [ 0, 0, 600, 400 ]);
+cmd 'move to absolute position 2800 700';
+sync_with_i3;
+
+is(get_output_for_workspace($ws), 'fake-3', 'workspace is on fake-3');
+is(@{get_ws($ws)->{floating_nodes}}, 1, 'floating window stayed on fake-3');
+
+done_testing;
@@ -0,0 +1,91 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+# Verifies workspace switches, which are pushed to X11 in one burst (here
+# inside a server grab) with the IPC events and _NET_CURRENT_DESKTOP following
+# afterwards.
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+workspace_switch_grab_server yes
+EOT
+
+my $root = $x->get_root_window;
+my $_NET_CURRENT_DESKTOP = $x->atom(name => '_NET_CURRENT_DESKTOP')->id;
+my $CARDINAL = $x->atom(name => 'CARDINAL')->id;
+
+sub current_desktop_index {
+    sync_with_i3;
+
+    my $cookie = $x->get_property(0, $root, $_NET_CURRENT_DESKTOP,
+                                  $CARDINAL, 0, 1);
+    my $reply = $x->get_property_reply($cookie->{sequence});
+
+    return undef if $reply->{value_len} != 1;
+    return unpack 'L', $reply->{value};
+}
+
+################################################################################
+# Switching between two workspaces with many windows maps all windows of the
+# new workspace and unmaps all windows of the old one.
+################################################################################
+
+my $first_ws = fresh_workspace;
+my @first = map { open_window } 1..30;
+my $second_ws = fresh_workspace;
+my @second = map { open_window } 1..30;
+
+cmd "workspace $first_ws";
+sync_with_i3;
+is(scalar(grep { $_->mapped } @first), 30, 'all windows of the first workspace mapped');
+is(scalar(grep { $_->mapped } @second), 0, 'no window of the second workspace mapped');
+is($x->input_focus, $first[-1]->id, 'last window of the first workspace focused');
+
+cmd "workspace $second_ws";
+sync_with_i3;
+is(scalar(grep { $_->mapped } @first), 0, 'no window of the first workspace mapped');
+is(scalar(grep { $_->mapped } @second), 30, 'all windows of the second workspace mapped');
+is($x->input_focus, $second[-1]->id, 'last window of the second workspace focused');
+
+does_i3_live;
+
+################################################################################
+# The IPC events of a switch are sent in the usual order, and
+# _NET_CURRENT_DESKTOP is updated.
+################################################################################
+
+my $old_ws = get_ws(focused_ws);
+my $empty_ws = get_unused_workspace;
+
+my @events = events_for(
+    sub { cmd "workspace $empty_ws" },
+    'workspace');
+
+my $current_ws = get_ws(focused_ws);
+is_deeply([ map { $_->{change} } @events ], [ 'init', 'focus' ], 'init and focus events received');
+is($events[1]->{current}->{id}, $current_ws->{id}, 'focus event contains the new workspace');
+is($events[1]->{old}->{id}, $old_ws->{id}, 'focus event contains the old workspace');
+
+is(current_desktop_index, 2, '_NET_CURRENT_DESKTOP points to the new workspace');
+
+@events = events_for(
+    sub { cmd "workspace $second_ws" },
+    'workspace');
+
+is_deeply([ map { $_->{change} } @events ], [ 'focus', 'empty' ], 'focus and empty events received');
+is(current_desktop_index, 1, '_NET_CURRENT_DESKTOP points to the second workspace');
+
+done_testing;
@@ -0,0 +1,71 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that the urgency of workspaces and split containers follows an
+# urgent window when it is moved around the tree (the urgent descendants are
+# counted incrementally instead of being looked up by walking the tree).
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+force_display_urgency_hint 0ms
+EOT
+
+sub set_urgency {
+    my ($win, $urgent) = @_;
+    $win->delete_hint('urgency');
+    $win->add_hint('urgency') if $urgent;
+    sync_with_i3;
+}
+
+sub ws_urgent {
+    my ($name) = @_;
+    return get_ws($name)->{urgent};
+}
+
+my $ws1 = fresh_workspace;
+my $win = open_window;
+open_window;
+my $ws2 = fresh_workspace;
+open_window;
+my $ws3 = fresh_workspace;
+
+set_urgency($win, 1);
+ok(ws_urgent($ws1), 'workspace with the urgent window is urgent');
+
+cmd "[id=\"" . $win->id . "\"] move container to workspace $ws2";
+ok(!ws_urgent($ws1), 'old workspace no longer urgent after moving the window away');
+ok(ws_urgent($ws2), 'new workspace urgent after moving the window there');
+
+cmd "[id=\"" . $win->id . "\"] floating enable";
+ok(ws_urgent($ws2), 'workspace still urgent after floating the window');
+
+cmd "[id=\"" . $win->id . "\"] floating disable";
+ok(ws_urgent($ws2), 'workspace still urgent after tiling the window again');
+
+cmd "[id=\"" . $win->id . "\"] split v";
+ok(ws_urgent($ws2), 'workspace still urgent after splitting the window');
+
+my @urgent = grep { $_->{urgent} } @{get_ws_content($ws2)};
+is(@urgent, 1, 'split container around the window is urgent');
+
+set_urgency($win, 0);
+ok(!ws_urgent($ws2), 'workspace no longer urgent after clearing the hint');
+
+@urgent = grep { $_->{urgent} } @{get_ws_content($ws2)};
+is(@urgent, 0, 'split container no longer urgent');
+
+done_testing;
@@ -0,0 +1,113 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Many-output scalability scenario: 16 fake outputs (a 4x4 grid), 100
+# workspaces and 1000 containers (opened with the “open” command, so that no
+# X11 windows are needed). Verifies that workspace switches, “focus output” and
+# “move workspace to output” behave at this scale and reports their latency
+# (including the IPC round trip) as diagnostics. The headless counterpart,
+# which also covers output reconfiguration, is bench.outputs (make bench).
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+fake-outputs 1280x800+0+0P,1280x800+1280+0,1280x800+2560+0,1280x800+3840+0,1280x800+0+800,1280x800+1280+800,1280x800+2560+800,1280x800+3840+800,1280x800+0+1600,1280x800+1280+1600,1280x800+2560+1600,1280x800+3840+1600,1280x800+0+2400,1280x800+1280+2400,1280x800+2560+2400,1280x800+3840+2400
+EOT
+use Time::HiRes qw(time);
+
+my $num_outputs = 16;
+my $num_workspaces = 100;
+my $windows_per_workspace = 10;
+my $iterations = 200;
+
+my $i3 = i3(get_socket_path());
+
+sub report {
+    my ($operation, $start) = @_;
+    diag(sprintf("%-18s %8.1f µs/op", $operation, (time() - $start) * 1e6 / $iterations));
+}
+
+sub workspace_outputs {
+    my %outputs;
+    for my $ws (@{$i3->get_workspaces->recv}) {
+        $outputs{$ws->{name}} = $ws->{output};
+    }
+    return \%outputs;
+}
+
+################################################################################
+# Set up the scenario: bench-1 … bench-100, round-robin across the outputs.
+################################################################################
+
+for my $i (1 .. $num_workspaces) {
+    my $output = 'fake-' . (($i - 1) % $num_outputs);
+    cmd "focus output $output";
+    cmd "workspace bench-$i";
+    cmd join('; ', ('open') x $windows_per_workspace);
+}
+
+my $ws_outputs = workspace_outputs;
+my @bench = grep { /^bench-/ } keys %$ws_outputs;
+is(scalar @bench, $num_workspaces, 'all workspaces created');
+is($ws_outputs->{'bench-1'}, 'fake-0', 'bench-1 is on fake-0');
+is($ws_outputs->{'bench-100'}, 'fake-3', 'bench-100 is on fake-3');
+is(scalar @{get_ws_content('bench-42')}, $windows_per_workspace, 'bench-42 has all its containers');
+
+################################################################################
+# Workspace switch, jumping between outputs.
+################################################################################
+
+my $start = time();
+for my $i (0 .. $iterations - 1) {
+    cmd 'workspace bench-' . (1 + ($i * 7) % $num_workspaces);
+}
+report('workspace switch', $start);
+is(focused_ws, 'bench-' . (1 + (($iterations - 1) * 7) % $num_workspaces), 'last switched-to workspace focused');
+
+################################################################################
+# Focus output.
+################################################################################
+
+$start = time();
+for my $i (0 .. $iterations - 1) {
+    cmd 'focus output fake-' . ($i % $num_outputs);
+}
+report('focus output', $start);
+is(workspace_outputs->{focused_ws()}, 'fake-' . (($iterations - 1) % $num_outputs),
+   'focused workspace is on the last focused output');
+
+################################################################################
+# Move workspace to output. The workspace switch is not part of the timing.
+################################################################################
+
+my $elapsed = 0;
+my $target;
+for my $i (0 .. $iterations - 1) {
+    cmd 'workspace bench-' . (1 + $i % $num_workspaces);
+    $target = 'fake-' . (($i * 5 + 1) % $num_outputs);
+    my $op_start = time();
+    cmd "move workspace to output $target";
+    $elapsed += time() - $op_start;
+}
+diag(sprintf("%-18s %8.1f µs/op", 'move ws to output', $elapsed * 1e6 / $iterations));
+is(workspace_outputs->{'bench-' . (1 + ($iterations - 1) % $num_workspaces)}, $target,
+   'last moved workspace is on its target output');
+
+$ws_outputs = workspace_outputs;
+@bench = grep { /^bench-/ } keys %$ws_outputs;
+is(scalar @bench, $num_workspaces, 'no workspace got lost');
+
+done_testing;
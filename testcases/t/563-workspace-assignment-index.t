@@ -0,0 +1,53 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies workspace assignments which are resolved through the assignment
+# indexes (by workspace name, by number and by output name): output names are
+# matched case-insensitively, “primary” refers to the primary output and
+# numbered assignments apply to workspaces starting with that number.
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+fake-outputs 1024x768+0+0P,1024x768+1024+0,1024x768+0+768
+
+workspace first output primary
+workspace second output FAKE-1
+workspace 07 output doesnotexist fake-2
+EOT
+
+sub check_output {
+    my ($workspace, $output, $msg) = @_;
+    is(get_output_for_workspace($workspace), $output, $msg);
+}
+
+check_output('second', 'fake-1', 'output names are matched case-insensitively');
+check_output('07', 'fake-2', 'first existing output of a numbered assignment is used');
+
+cmd 'focus output fake-1';
+cmd 'workspace first';
+check_output('first', 'fake-0', 'workspace assigned to “primary” opened on the primary output');
+
+cmd 'focus output fake-0';
+cmd 'workspace 7: seven';
+check_output('7: seven', 'fake-2', 'numbered assignment applies to workspace number 7');
+
+cmd 'focus output fake-2';
+cmd 'workspace second';
+cmd 'move workspace to output fake-0';
+check_output('second', 'fake-0', 'assigned workspace can still be moved away');
+
+done_testing;
@@ -0,0 +1,79 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that repeated presses of a resize or move binding (like key
+# autorepeat generates them) have the same effect as running the command once
+# per press, no matter whether i3 coalesces them into one command.
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+# 107 == Print, 110 == Home, 115 == End
+bindcode 107 move right 10 px
+bindcode 110 resize grow width 10 px
+bindcode 115 move left
+EOT
+use i3test::XTEST;
+use ExtUtils::PkgConfig;
+
+SKIP: {
+    skip "libxcb-xkb too old (need >= 1.11)", 1 unless
+        ExtUtils::PkgConfig->atleast_version('xcb-xkb', '1.11');
+
+sub press_repeatedly {
+    my ($keycode, $times) = @_;
+    # With detectable autorepeat, holding a key results in KeyPress events
+    # only, followed by a single KeyRelease.
+    xtest_key_press($keycode) for (1 .. $times);
+    xtest_key_release($keycode);
+    xtest_sync_with_i3;
+}
+
+################################################################################
+# Floating windows move and grow by the sum of all presses.
+################################################################################
+
+my $tmp = fresh_workspace;
+open_floating_window(rect => [ 100, 100, 200, 150 ]);
+
+my $rect = get_ws($tmp)->{floating_nodes}->[0]->{rect};
+my ($old_x, $old_width) = ($rect->{x}, $rect->{width});
+
+press_repeatedly(107, 5);
+$rect = get_ws($tmp)->{floating_nodes}->[0]->{rect};
+is($rect->{x}, $old_x + 50, 'floating window moved by 5 * 10 px');
+
+press_repeatedly(110, 4);
+$rect = get_ws($tmp)->{floating_nodes}->[0]->{rect};
+is($rect->{width}, $old_width + 40, 'floating window grew by 4 * 10 px');
+
+################################################################################
+# Tiling windows move once per press.
+################################################################################
+
+$tmp = fresh_workspace;
+my $first = open_window;
+my $second = open_window;
+my $third = open_window;
+
+press_repeatedly(115, 2);
+my @nodes = @{get_ws_content($tmp)};
+is($nodes[0]->{window}, $third->id, 'tiling window moved left twice');
+is($nodes[1]->{window}, $first->id, 'first window is now in the middle');
+
+}
+
+done_testing;
@@ -0,0 +1,55 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that clicking a tab or a stacked title focuses the corresponding
+# window, also after the titles moved because a window was closed (the
+# decoration positions are looked up in a table recorded while rendering).
+use i3test;
+use i3test::XTEST;
+
+# Clicks the middle of the decoration of the window at the given index of the
+# workspace's tabbed/stacked container.
+sub click_title {
+    my ($ws, $index) = @_;
+    my $content = get_ws($ws);
+    my $node = $content->{nodes}->[$index];
+    my $click_x = $content->{rect}->{x} + $node->{deco_rect}->{x} + int($node->{deco_rect}->{width} / 2);
+    my $click_y = $content->{rect}->{y} + $node->{deco_rect}->{y} + int($node->{deco_rect}->{height} / 2);
+    xtest_button_press(1, $click_x, $click_y);
+    xtest_button_release(1, $click_x, $click_y);
+    xtest_sync_with_i3;
+}
+
+for my $layout (qw(tabbed stacked)) {
+    my $tmp = fresh_workspace;
+    cmd "layout $layout";
+
+    my @windows = map { open_window } (1 .. 10);
+
+    for my $index (0, 4, 9, 3) {
+        click_title($tmp, $index);
+        is($x->input_focus, $windows[$index]->id, "$layout: clicking title $index focuses its window");
+    }
+
+    # Closing a window moves all following titles.
+    cmd '[id=' . $windows[0]->id . '] kill';
+    sync_with_i3;
+    shift @windows;
+    click_title($tmp, 0);
+    is($x->input_focus, $windows[0]->id, "$layout: clicking the first title after closing a window");
+}
+
+done_testing;
@@ -0,0 +1,47 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that i3 keeps handling other events (here: a new window being
+# mapped) while a floating window is being dragged, and that the drag still
+# ends normally once the button is released.
+use i3test;
+use i3test::XTEST;
+
+my $tmp = fresh_workspace;
+my $floating = open_floating_window(rect => [ 100, 100, 200, 150 ]);
+
+my $node = get_ws($tmp)->{floating_nodes}->[0]->{nodes}->[0];
+my $rect = get_ws($tmp)->{floating_nodes}->[0]->{rect};
+my $click_x = $rect->{x} + int($rect->{width} / 2);
+my $click_y = $rect->{y} + int($node->{deco_rect}->{height} / 2);
+
+xtest_button_press(1, $click_x, $click_y);
+xtest_sync_with_i3;
+
+# With a modal drag loop, the new window would not be mapped before the button
+# is released and open_window would time out.
+my $window = open_window;
+ok($window->mapped, 'window mapped during the drag');
+is(@{get_ws_content($tmp)}, 1, 'tiling window opened during the drag');
+
+xtest_button_release(1, $click_x, $click_y);
+xtest_sync_with_i3;
+
+is(@{get_ws($tmp)->{floating_nodes}}, 1, 'floating window still exists after the drag');
+cmd 'nop still responsive';
+ok(1, 'i3 still responsive after the drag');
+
+done_testing;
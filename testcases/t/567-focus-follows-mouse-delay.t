@@ -0,0 +1,62 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Tests the focus_follows_mouse_delay setting: windows which the pointer only
+# crosses are not focused, the window the pointer rests on is.
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+fake-outputs 1200x1000+0+0
+focus_follows_mouse_delay 200 ms
+EOT
+use Time::HiRes qw(sleep);
+
+sub synced_warp_pointer {
+    my ($x_px, $y_px) = @_;
+    sync_with_i3;
+    $x->root->warp_pointer($x_px, $y_px);
+    sync_with_i3;
+}
+
+synced_warp_pointer(1100, 500);
+my $first = open_window;
+my $second = open_window;
+my $third = open_window;
+is($x->input_focus, $third->id, 'third window focused');
+
+###################################################################
+# Crossing a window does not focus it.
+###################################################################
+
+synced_warp_pointer(600, 500);
+synced_warp_pointer(1100, 500);
+sleep(0.4);
+sync_with_i3;
+is($x->input_focus, $third->id, 'third window still focused after crossing the second');
+
+###################################################################
+# Resting on a window focuses it once the delay expired.
+###################################################################
+
+synced_warp_pointer(100, 500);
+is($x->input_focus, $third->id, 'first window not focused immediately');
+
+sleep(0.4);
+sync_with_i3;
+is($x->input_focus, $first->id, 'first window focused after the delay');
+
+done_testing;
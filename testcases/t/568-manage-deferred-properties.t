@@ -0,0 +1,70 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that the properties which i3 only handles after a new window was
+# mapped (_MOTIF_WM_HINTS) are still applied by the time the window is visible
+# to the tests.
+use i3test;
+use X11::XCB qw(PROP_MODE_REPLACE);
+
+sub set_motif_hints {
+    my ($window, $decorations) = @_;
+
+    my $atom = $x->atom(name => '_MOTIF_WM_HINTS');
+    # flags (MWM_HINTS_DECORATIONS), functions, decorations, input_mode, status
+    $x->change_property(
+        PROP_MODE_REPLACE,
+        $window->id,
+        $atom->id,
+        $atom->id,
+        32,
+        5,
+        pack('L5', 1 << 1, 0, $decorations, 0, 0)
+    );
+}
+
+###############################################################################
+# A tiling window without any decorations.
+###############################################################################
+
+my $tmp = fresh_workspace;
+
+my $window = open_window(before_map => sub { set_motif_hints(shift, 0) });
+my @content = @{get_ws_content($tmp)};
+is(@content, 1, 'one container opened');
+is($content[0]->{border}, 'none', 'motif hints applied to the tiling window');
+
+###############################################################################
+# A floating window which only wants a border.
+###############################################################################
+
+$tmp = fresh_workspace;
+
+$window = open_floating_window(before_map => sub { set_motif_hints(shift, 1 << 1) });
+my $floating = get_ws($tmp)->{floating_nodes}->[0]->{nodes}->[0];
+is($floating->{border}, 'pixel', 'motif hints applied to the floating window');
+
+###############################################################################
+# Windows without the property keep the default border.
+###############################################################################
+
+$tmp = fresh_workspace;
+
+$window = open_window;
+@content = @{get_ws_content($tmp)};
+is($content[0]->{border}, 'normal', 'default border without motif hints');
+
+done_testing;
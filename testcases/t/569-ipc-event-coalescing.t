@@ -0,0 +1,50 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that workspace focus events which are superseded within a single
+# command are dropped, while the order of the remaining events is kept.
+use i3test;
+
+my $ws_a = fresh_workspace;
+open_window;
+my $ws_b = fresh_workspace;
+open_window;
+cmd "workspace $ws_a";
+
+my @events = events_for(
+    sub { cmd "workspace $ws_b; workspace $ws_a; workspace $ws_b" },
+    'workspace');
+
+my @focus = grep { $_->{change} eq 'focus' } @events;
+is(scalar @focus, 2, 'superseded workspace focus event dropped');
+is($focus[0]->{current}->{name}, $ws_a, 'focus event for the other workspace kept');
+is($focus[1]->{current}->{name}, $ws_b, 'final focus event is the last one');
+
+###############################################################################
+# Events of separate commands are not coalesced.
+###############################################################################
+
+@events = events_for(
+    sub {
+        cmd "workspace $ws_a";
+        cmd "workspace $ws_b";
+    },
+    'workspace');
+
+@focus = grep { $_->{change} eq 'focus' } @events;
+is(scalar @focus, 2, 'one focus event per command');
+
+done_testing;
@@ -0,0 +1,71 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that i3 uses WM_DELETE_WINDOW for windows which support it, both
+# when WM_PROTOCOLS was set before mapping the window and when it was changed
+# afterwards (i3 caches the supported protocols).
+use i3test;
+use X11::XCB qw(PROP_MODE_REPLACE);
+
+my $delete_window = $x->atom(name => 'WM_DELETE_WINDOW');
+
+sub recv_delete_window {
+    return wait_for_event 2, sub {
+        my ($event) = @_;
+        # TODO: const
+        return 0 unless $event->{response_type} == 161;
+
+        my ($atom) = unpack "L", $event->{data};
+        return ($atom == $delete_window->id);
+    };
+}
+
+###############################################################################
+# WM_PROTOCOLS set before mapping the window.
+###############################################################################
+
+my $tmp = fresh_workspace;
+
+my $window = open_window({ protocols => [ $delete_window ] });
+cmd 'kill';
+ok(recv_delete_window(), 'received WM_DELETE_WINDOW');
+is(@{get_ws_content($tmp)}, 1, 'window was not killed the hard way');
+
+###############################################################################
+# WM_PROTOCOLS set after the window was mapped.
+###############################################################################
+
+$tmp = fresh_workspace;
+
+$window = open_window;
+my $protocols = $x->atom(name => 'WM_PROTOCOLS');
+my $atom_type = $x->atom(name => 'ATOM');
+$x->change_property(
+    PROP_MODE_REPLACE,
+    $window->id,
+    $protocols->id,
+    $atom_type->id,
+    32,
+    1,
+    pack('L', $delete_window->id)
+);
+sync_with_i3;
+
+cmd 'kill';
+ok(recv_delete_window(), 'received WM_DELETE_WINDOW after WM_PROTOCOLS changed');
+is(@{get_ws_content($tmp)}, 1, 'window was not killed the hard way');
+
+done_testing;
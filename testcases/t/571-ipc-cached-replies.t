@@ -0,0 +1,48 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that the cached GET_WORKSPACES reply is updated when workspaces are
+# renamed, created or focused.
+use i3test;
+
+my $i3 = i3(get_socket_path());
+
+sub workspace_names {
+    return [ map { $_->{name} } @{$i3->get_workspaces->recv} ];
+}
+
+sub focused_name {
+    my ($ws) = grep { $_->{focused} } @{$i3->get_workspaces->recv};
+    return $ws->{name};
+}
+
+my $tmp = fresh_workspace;
+open_window;
+
+is_deeply(workspace_names(), workspace_names(), 'repeated requests return the same reply');
+is(focused_name(), $tmp, 'new workspace focused');
+
+cmd "rename workspace to cached-reply";
+ok((grep { $_ eq 'cached-reply' } @{workspace_names()}), 'renamed workspace listed');
+ok(!(grep { $_ eq $tmp } @{workspace_names()}), 'old name not listed anymore');
+
+my $other = fresh_workspace;
+is(focused_name(), $other, 'focus change reflected');
+
+cmd 'workspace cached-reply';
+is(focused_name(), 'cached-reply', 'focus change back reflected');
+
+done_testing;
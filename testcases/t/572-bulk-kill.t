@@ -0,0 +1,65 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that killing many windows at once (which closes their containers in
+# one bulk close) cleans up the split containers which became empty and leaves
+# the remaining windows focusable.
+use i3test;
+
+###############################################################################
+# Killing all windows of a workspace with nested split containers.
+###############################################################################
+
+my $tmp = fresh_workspace;
+
+for my $i (1 .. 4) {
+    open_window;
+    cmd 'split v';
+    open_window;
+    cmd 'split h';
+    open_window;
+    cmd 'focus parent, focus parent';
+}
+
+cmd 'focus parent' for 1 .. 8;
+cmd 'kill';
+sync_with_i3;
+
+is(@{get_ws_content($tmp)}, 0, 'all containers of the workspace closed');
+
+###############################################################################
+# Killing windows matched by criteria closes only their (now empty) parents.
+###############################################################################
+
+$tmp = fresh_workspace;
+
+my $keep = open_window(wm_class => 'keep');
+for my $i (1 .. 3) {
+    cmd "focus parent" if $i > 1;
+    open_window(wm_class => 'bulk');
+    cmd 'split v';
+    open_window(wm_class => 'bulk');
+}
+
+cmd '[class="bulk"] kill';
+sync_with_i3;
+
+my @content = @{get_ws_content($tmp)};
+is(@content, 1, 'only one container left');
+is($content[0]->{window}, $keep->id, 'the unmatched window is left');
+is(get_focused($tmp), $content[0]->{id}, 'the unmatched window is focused');
+
+done_testing;
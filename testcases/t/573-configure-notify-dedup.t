@@ -0,0 +1,54 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that i3 sends a synthetic ConfigureNotify to a tiling window only
+# when the geometry it enforces changed, not for every ConfigureRequest.
+use i3test;
+
+# Returns the number of synthetic ConfigureNotify events received until i3
+# handled everything sent before calling this function.
+sub count_synthetic_configure_notify {
+    my $rnd = sync_with_i3(dont_wait_for_event => 1);
+
+    my $count = 0;
+    wait_for_event 4, sub {
+        my ($event) = @_;
+        # ConfigureNotify (22) with the bit for synthetic events set.
+        $count++ if $event->{response_type} == (22 | 0x80);
+        return 0 unless $event->{response_type} == 161;
+
+        my ($win, $got_rnd) = unpack "LL", $event->{data};
+        return ($got_rnd == $rnd);
+    };
+    return $count;
+}
+
+fresh_workspace;
+
+my $window = open_window;
+sync_with_i3;
+
+for my $i (1 .. 5) {
+    $window->rect(X11::XCB::Rect->new(x => $i, y => $i, width => 100 + $i, height => 100));
+}
+is(count_synthetic_configure_notify(), 0,
+   'no synthetic ConfigureNotify for ConfigureRequests which do not change anything');
+
+my $other = open_window;
+is(count_synthetic_configure_notify(), 1,
+   'synthetic ConfigureNotify when the geometry changed');
+
+done_testing;
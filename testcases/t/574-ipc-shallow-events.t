@@ -0,0 +1,66 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that subscribing with "payload": "shallow" sends workspace and
+# window events with only the IDs of the children, while other subscribers
+# still get the full containers.
+use i3test;
+
+my $ws_a = fresh_workspace;
+open_window;
+open_window;
+my $ws_b = fresh_workspace;
+
+sub subscribe_and_switch {
+    my @subscriptions = @_;
+
+    my $i3 = i3(get_socket_path(0));
+    $i3->connect->recv;
+
+    my @events;
+    my $flushed = AnyEvent->condvar;
+    $i3->{callbacks}->{(1 << 31) | 0} = sub { push @events, shift };
+    $i3->{callbacks}->{(1 << 31) | 7} = sub {
+        my ($event) = @_;
+        $flushed->send if !$event->{first};
+    };
+
+    my $reply = $i3->message(2, [ 'tick', @subscriptions ])->recv;
+    ok($reply->{success}, 'subscribing succeeded');
+
+    cmd "workspace $ws_a";
+    cmd "workspace $ws_b";
+    $i3->send_tick('flush');
+    $flushed->recv;
+
+    my ($focus) = grep { $_->{change} eq 'focus' && $_->{current}->{name} eq $ws_a } @events;
+    return $focus;
+}
+
+my $event = subscribe_and_switch({ event => 'workspace', payload => 'shallow' });
+is($event->{current}->{type}, 'workspace', 'workspace fields are included');
+is(scalar @{$event->{current}->{nodes}}, 2, 'both children are listed');
+ok(!ref($event->{current}->{nodes}->[0]), 'children are listed by ID');
+
+$event = subscribe_and_switch('workspace', { event => 'workspace', payload => 'shallow' });
+is(ref($event->{current}->{nodes}->[0]), 'HASH', 'unfiltered subscription gets full containers');
+
+my $i3 = i3(get_socket_path(0));
+$i3->connect->recv;
+my $reply = $i3->message(2, [ { event => 'workspace', payload => 'tiny' } ])->recv;
+ok(!$reply->{success}, 'unknown payloads are rejected');
+
+done_testing;
@@ -0,0 +1,85 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Records the X11 events and IPC commands of a session with --record-trace,
+# then replays them with --replay-trace and verifies the report.
+use i3test i3_autostart => 0;
+use File::Temp qw(tempfile);
+use JSON::XS qw(decode_json);
+
+my $config = <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+EOT
+
+my ($fh, $trace) = tempfile('i3-trace-XXXXX', UNLINK => 1, TMPDIR => 1);
+close($fh);
+
+################################################################################
+# Record a session.
+################################################################################
+
+my $pid = launch_with_config($config, record_trace => $trace);
+
+fresh_workspace;
+my $first = open_window;
+my $second = open_window;
+cmd 'layout stacking';
+cmd 'nop trace';
+
+$first->unmap;
+wait_for_unmap $first;
+$second->destroy;
+sync_with_i3;
+
+exit_gracefully($pid);
+
+open($fh, '<', $trace) or die "could not open $trace: $!";
+binmode($fh);
+read($fh, my $magic, 7);
+close($fh);
+is($magic, 'i3trace', 'trace file was written');
+
+################################################################################
+# Replay it.
+################################################################################
+
+my ($config_fh, $config_file) = tempfile('i3-trace-config-XXXXX', UNLINK => 1, TMPDIR => 1);
+print $config_fh $config;
+close($config_fh);
+
+my $output = qx(i3 -c $config_file --replay-trace $trace 2>/dev/null);
+is($?, 0, 'replaying the trace succeeded');
+
+my $report = decode_json($output);
+is($report->{events}->{MapRequest}->{count}, 2, 'both MapRequests were replayed');
+ok(defined($report->{events}->{UnmapNotify}), 'UnmapNotify was replayed');
+ok(defined($report->{events}->{DestroyNotify}), 'DestroyNotify was replayed');
+is($report->{stand_in_windows}, 2, 'one stand-in per window');
+cmp_ok($report->{commands}->{count}, '>=', 3, 'commands were replayed');
+is($report->{mismatched_replies}, 0, 'commands got the recorded replies');
+cmp_ok($report->{render}->{count}, '>', 0, 'rendered between batches');
+cmp_ok($report->{events}->{MapRequest}->{max_ns}, '<=',
+       $report->{events}->{MapRequest}->{total_ns}, 'max_ns <= total_ns');
+
+################################################################################
+# Replaying something which is not a trace fails.
+################################################################################
+
+qx(i3 -c $config_file --replay-trace $config_file 2>/dev/null);
+isnt($?, 0, 'replaying a configuration file fails');
+
+done_testing;
@@ -0,0 +1,71 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that placeholders swallow windows in tree order when several of
+# them match, regardless of which criteria (class, instance, title) matched.
+use i3test;
+use File::Temp qw(tempfile);
+use IO::Handle;
+
+my $ws = fresh_workspace;
+
+my ($fh, $filename) = tempfile(UNLINK => 1);
+print $fh <<'EOT';
+{
+    "layout": "splith",
+    "type": "con",
+    "nodes": [
+        {
+            "type": "con",
+            "swallows": [ { "title": "^swallow" } ]
+        },
+        {
+            "type": "con",
+            "swallows": [ { "instance": "^swallow-instance$" } ]
+        },
+        {
+            "type": "con",
+            "swallows": [ { "class": "^Swallow$" } ]
+        }
+    ]
+}
+EOT
+$fh->flush;
+cmd "append_layout $filename";
+close($fh);
+
+does_i3_live;
+
+sub swallowed_windows {
+    my @nodes = @{get_ws_content($ws)->[0]->{nodes}};
+    return map { $_->{window} } @nodes;
+}
+
+my @windows;
+for my $i (0 .. 2) {
+    push @windows, open_window(
+        name => "swallow $i",
+        wm_class => 'Swallow',
+        instance => 'swallow-instance',
+    );
+}
+
+my @content = @{get_ws_content($ws)};
+is(@content, 1, 'windows were swallowed by the placeholders');
+is_deeply([ swallowed_windows() ], [ map { $_->id } @windows ],
+    'placeholders swallowed the windows in tree order');
+
+done_testing;
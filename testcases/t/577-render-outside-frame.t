@@ -0,0 +1,66 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that rendering outside of a regular render (managing a window,
+# which renders the tree right away, possibly on an invisible workspace, and
+# making a window floating) works while the lookup caches are used, also when
+# three outputs are rendered by the render workers.
+#
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+fake-outputs 1024x768+0+0,1024x768+1024+0,1024x768+2048+0
+workspace 1 output fake-0
+workspace 2 output fake-1
+workspace 3 output fake-2
+assign [class="^hidden\$"] 5
+default_border none
+EOT
+
+my @origins = (0, 1024, 2048);
+
+for my $num (1 .. 3) {
+    cmd "workspace $num";
+    open_window;
+    open_window;
+}
+
+for my $num (1 .. 3) {
+    my @nodes = @{get_ws_content($num)};
+    is(scalar @nodes, 2, "workspace $num has two windows");
+    is($nodes[0]->{rect}->{x}, $origins[$num - 1], "workspace $num window 0 x");
+    is($nodes[1]->{rect}->{x}, $origins[$num - 1] + 512, "workspace $num window 1 x");
+}
+
+cmd 'workspace 3';
+my $floating = open_floating_window;
+is(scalar @{get_ws(3)->{floating_nodes}}, 1, 'floating window opened');
+
+cmd 'floating toggle';
+is(scalar @{get_ws_content(3)}, 3, 'floating window is tiled now');
+
+# The window is assigned to an invisible workspace, so i3 does not map it.
+my $hidden = open_window(wm_class => 'hidden', dont_map => 1);
+$hidden->map;
+sync_with_i3;
+
+is(scalar @{get_ws_content('5')}, 1, 'assigned window opened on workspace 5');
+is(focused_ws, '3', 'still on workspace 3');
+
+does_i3_live;
+
+done_testing;
@@ -0,0 +1,156 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Maps the shared memory state snapshot named in the I3_STATE_PATH atom and
+# verifies its output and workspace tables and the sequence lock after a
+# workspace switch (see include/i3/shmstate.h).
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+fake-outputs 1024x768+0+0,1024x768+1024+0
+workspace 1 output fake-0
+workspace 2 output fake-1
+EOT
+
+use constant {
+    HEADER_SIZE => 6 * 4,
+    OUTPUT_SIZE => 64 + 6 * 4,
+    WORKSPACE_SIZE => 64 + 7 * 4,
+    MAX_OUTPUTS => 32,
+    MAX_WORKSPACES => 256,
+    WS_FOCUSED => 1,
+    WS_VISIBLE => 2,
+};
+
+my $root = $x->get_root_window;
+my $I3_STATE_PATH = $x->atom(name => 'I3_STATE_PATH')->id;
+my $UTF8_STRING = $x->atom(name => 'UTF8_STRING')->id;
+
+my $cookie = $x->get_property(0, $root, $I3_STATE_PATH, $UTF8_STRING, 0, 4096);
+my $reply = $x->get_property_reply($cookie->{sequence});
+my $name = $reply->{value};
+ok(defined($name) && length($name) > 0, 'I3_STATE_PATH is set');
+
+# shm_open(3) names live in /dev/shm on Linux, on FreeBSD the name is a path.
+my $path = ($name =~ m,^/tmp/, ? $name : "/dev/shm$name");
+open(my $fh, '<:mmap', $path) or die "could not map $path: $!";
+
+sub read_at {
+    my ($offset, $length) = @_;
+    seek($fh, $offset, 0);
+    read($fh, my $data, $length) == $length or die "short read at $offset";
+    return $data;
+}
+
+# Reads a consistent snapshot, following the reader side of the sequence lock.
+sub read_snapshot {
+    sync_with_i3;
+
+    while (1) {
+        my $sequence = unpack('L', read_at(8, 4));
+        next if $sequence & 1;
+
+        my ($version, $size, undef, $flags, $num_outputs, $num_workspaces) =
+            unpack('L6', read_at(0, HEADER_SIZE));
+        my @outputs = map {
+            my ($name, $x, $y, $width, $height, $current, $flags) =
+                unpack('Z64 l l L L l L', read_at(HEADER_SIZE + $_ * OUTPUT_SIZE, OUTPUT_SIZE));
+            { name => $name, rect => [ $x, $y, $width, $height ], current_workspace => $current, flags => $flags }
+        } 0 .. $num_outputs - 1;
+        my $workspaces_offset = HEADER_SIZE + MAX_OUTPUTS * OUTPUT_SIZE;
+        my @workspaces = map {
+            my ($name, $num, $output, $x, $y, $width, $height, $flags) =
+                unpack('Z64 l l l l L L L', read_at($workspaces_offset + $_ * WORKSPACE_SIZE, WORKSPACE_SIZE));
+            { name => $name, num => $num, output => $output, rect => [ $x, $y, $width, $height ], flags => $flags }
+        } 0 .. $num_workspaces - 1;
+
+        next if unpack('L', read_at(8, 4)) != $sequence;
+
+        return {
+            version => $version,
+            size => $size,
+            sequence => $sequence,
+            flags => $flags,
+            outputs => \@outputs,
+            workspaces => \@workspaces,
+        };
+    }
+}
+
+sub workspace_index {
+    my ($snapshot, $name) = @_;
+    my @workspaces = @{$snapshot->{workspaces}};
+    my ($index) = grep { $workspaces[$_]->{name} eq $name } 0 .. $#workspaces;
+    return $index;
+}
+
+################################################################################
+# The tables describe both outputs and their visible workspaces.
+################################################################################
+
+cmd 'workspace 1';
+open_window;
+
+my $before = read_snapshot;
+is($before->{version}, 1, 'layout version 1');
+is($before->{size}, HEADER_SIZE + MAX_OUTPUTS * OUTPUT_SIZE + MAX_WORKSPACES * WORKSPACE_SIZE,
+   'size matches the layout');
+is($before->{sequence} % 2, 0, 'sequence is even after a write');
+is($before->{flags}, 0, 'tables are not truncated');
+is_deeply([ map { $_->{name} } @{$before->{outputs}} ], [ 'fake-0', 'fake-1' ], 'both outputs listed');
+is_deeply($before->{outputs}->[1]->{rect}, [ 1024, 0, 1024, 768 ], 'rect of fake-1');
+
+my $ws1 = workspace_index($before, '1');
+my $ws2 = workspace_index($before, '2');
+ok(defined($ws1) && defined($ws2), 'workspaces 1 and 2 listed');
+is($before->{workspaces}->[$ws1]->{num}, 1, 'number of workspace 1');
+is($before->{workspaces}->[$ws1]->{output}, 0, 'workspace 1 is on fake-0');
+is($before->{workspaces}->[$ws1]->{flags}, WS_FOCUSED | WS_VISIBLE, 'workspace 1 is focused and visible');
+is($before->{workspaces}->[$ws2]->{output}, 1, 'workspace 2 is on fake-1');
+is($before->{workspaces}->[$ws2]->{flags}, WS_VISIBLE, 'workspace 2 is only visible');
+is($before->{outputs}->[0]->{current_workspace}, $ws1, 'fake-0 shows workspace 1');
+is($before->{outputs}->[1]->{current_workspace}, $ws2, 'fake-1 shows workspace 2');
+
+################################################################################
+# A workspace switch is published with a new sequence.
+################################################################################
+
+cmd 'workspace foo';
+
+my $after = read_snapshot;
+cmp_ok($after->{sequence}, '>', $before->{sequence}, 'sequence increased');
+is($after->{sequence} % 2, 0, 'sequence is even after the switch');
+
+my $foo = workspace_index($after, 'foo');
+$ws1 = workspace_index($after, '1');
+ok(defined($foo), 'workspace foo listed');
+is($after->{workspaces}->[$foo]->{num}, -1, 'foo is a named workspace');
+is($after->{workspaces}->[$foo]->{output}, 0, 'foo is on fake-0');
+is($after->{workspaces}->[$foo]->{flags}, WS_FOCUSED | WS_VISIBLE, 'foo is focused and visible');
+is($after->{workspaces}->[$ws1]->{flags}, 0, 'workspace 1 is hidden now');
+is($after->{outputs}->[0]->{current_workspace}, $foo, 'fake-0 shows foo');
+
+################################################################################
+# Nothing is written if nothing changed.
+################################################################################
+
+cmd 'nop';
+is(read_snapshot->{sequence}, $after->{sequence}, 'sequence unchanged without changes');
+
+close($fh);
+
+done_testing;
@@ -0,0 +1,28 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Measures the latency from mapping a window until i3 managed and rendered it
+# (see i3test::Perf for the thresholds).
+use i3test;
+use i3test::Perf;
+
+fresh_workspace;
+
+# open_window maps the window, waits for the MapNotify and syncs with i3.
+my $ms = measure_ms(20, sub { open_window });
+perf_ok('map latency', $ms);
+
+done_testing;
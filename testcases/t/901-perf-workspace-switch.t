@@ -0,0 +1,36 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Measures how long switching between two workspaces with 10 windows each
+# takes, until i3 has rendered the new workspace (see i3test::Perf for the
+# thresholds).
+use i3test;
+use i3test::Perf;
+
+my $first = fresh_workspace;
+open_window for (1 .. 10);
+my $second = fresh_workspace;
+open_window for (1 .. 10);
+
+my $target = $first;
+my $ms = measure_ms(20, sub {
+    cmd "workspace $target";
+    sync_with_i3;
+    $target = ($target eq $first ? $second : $first);
+});
+perf_ok('workspace switch', $ms);
+
+done_testing;
@@ -0,0 +1,31 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Measures the RUN_COMMAND round trip of a command which does not change the
+# tree (see i3test::Perf for the thresholds).
+use i3test;
+use i3test::Perf;
+
+fresh_workspace;
+open_window for (1 .. 5);
+
+my $i3 = i3(get_socket_path());
+$i3->connect->recv;
+
+my $ms = measure_ms(100, sub { $i3->command('nop')->recv });
+perf_ok('run_command round trip', $ms);
+
+done_testing;
@@ -0,0 +1,34 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Measures the size of the GET_TREE reply and how long it takes with 100
+# windows open (see i3test::Perf for the thresholds).
+use i3test;
+use i3test::Perf;
+
+my $windows = 100;
+
+for my $n (1 .. $windows) {
+    fresh_workspace if ($n % 10) == 1;
+    open_window;
+}
+
+my $reply;
+my $ms = measure_ms(20, sub { $reply = ipc_raw_message(4) });
+perf_ok('get_tree time', $ms);
+perf_ok('get_tree bytes per window', length($reply) / $windows);
+
+done_testing;
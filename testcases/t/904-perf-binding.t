@@ -0,0 +1,39 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Measures the latency from a key press until the bound command ran and its
+# result was rendered (see i3test::Perf for the thresholds).
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+# 27 == r
+bindcode 27 focus left
+EOT
+use i3test::XTEST;
+use i3test::Perf;
+
+fresh_workspace;
+open_window for (1 .. 5);
+
+my $ms = measure_ms(20, sub {
+    xtest_key_press(27);
+    xtest_key_release(27);
+    xtest_sync_with_i3;
+});
+perf_ok('binding latency', $ms);
+
+done_testing;